@@ -0,0 +1,542 @@
+/*
+ * Hydrogen
+ * Copyright(c) 2002-2008 by Alex >Comix< Cominu [comix@users.sourceforge.net]
+ *
+ * http://www.hydrogen-music.org
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY, without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ */
+
+/*
+ * hydrogen-bench renders songs through the FakeDriver, which calls
+ * audioEngine_process() as fast as possible without any GUI, and
+ * reports the throughput and the duration of the process cycles for
+ * every combination of buffer size, polyphony, interpolation mode
+ * and LADSPA FX.
+ *
+ * With --load it times the song loaders and writers instead, on a
+ * song holding a large number of generated patterns.
+ */
+
+#include <QCoreApplication>
+#include <QCommandLineParser>
+#include <QDir>
+#include <QFile>
+#include <QFileInfo>
+#include <QJsonArray>
+#include <QJsonDocument>
+#include <QJsonObject>
+#include <QProcessEnvironment>
+
+#include <hydrogen/config.h>
+#include <hydrogen/version.h>
+#include <hydrogen/audio_engine.h>
+#include <hydrogen/dsp_profiler.h>
+#include <hydrogen/hydrogen.h>
+#include <hydrogen/Preferences.h>
+#include <hydrogen/basics/instrument.h>
+#include <hydrogen/basics/instrument_list.h>
+#include <hydrogen/basics/note.h>
+#include <hydrogen/basics/pattern.h>
+#include <hydrogen/basics/pattern_list.h>
+#include <hydrogen/basics/song.h>
+#include <hydrogen/fx/Effects.h>
+#include <hydrogen/fx/LadspaFX.h>
+#include <hydrogen/helpers/filesystem.h>
+#include <hydrogen/IO/FakeDriver.h>
+#include <hydrogen/sampler/Sampler.h>
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <vector>
+
+using namespace H2Core;
+
+/** one bar, a step is a 16th note */
+static const int BENCH_PATTERN_LENGTH = 192;
+static const int BENCH_STEP = 12;
+static const int BENCH_BARS = 8;
+
+struct BenchInterpolation {
+	const char* name;
+	Sampler::InterpolateMode mode;
+};
+
+static const BenchInterpolation bench_interpolations[] = {
+	{ "linear", Sampler::LINEAR },
+	{ "cosine", Sampler::COSINE },
+	{ "third", Sampler::THIRD },
+	{ "cubic", Sampler::CUBIC },
+	{ "hermite", Sampler::HERMITE },
+};
+
+/** what a run renders */
+struct BenchSong {
+	QString name;
+	QString filename;
+	int polyphony;          ///< notes per step of the generated pattern, 0 to play the song as it is
+};
+
+/** LADSPA plugin put in the first FX slot */
+struct BenchPlugin {
+	QString filename;
+	QString label;
+};
+
+/** \return the value below which \a fQuantile of the sorted \a values are */
+static float bench_percentile( const std::vector<float>& values, float fQuantile )
+{
+	if ( values.empty() ) {
+		return 0.0f;
+	}
+	return values[ ( size_t )( ( values.size() - 1 ) * fQuantile ) ];
+}
+
+static QList<int> bench_int_list( const QString& sList )
+{
+	QList<int> list;
+	for ( const QString& sValue : sList.split( ',', QString::SkipEmptyParts ) ) {
+		bool bOk;
+		int nValue = sValue.trimmed().toInt( &bOk );
+		if ( bOk && nValue >= 0 ) {
+			list << nValue;
+		}
+	}
+	return list;
+}
+
+/**
+ * Replaces the sequence of \a pSong by #BENCH_BARS bars of a pattern
+ * triggering \a nNotesPerStep notes at every step, spread over the
+ * instruments of the song.
+ */
+static void bench_make_polyphonic( Song* pSong, int nNotesPerStep )
+{
+	InstrumentList* pInstruments = pSong->get_instrument_list();
+	Pattern* pPattern = new Pattern( "bench", "", "", BENCH_PATTERN_LENGTH );
+	int nNote = 0;
+	for ( int nTick = 0; nTick < BENCH_PATTERN_LENGTH; nTick += BENCH_STEP ) {
+		for ( int i = 0; i < nNotesPerStep; ++i, ++nNote ) {
+			Instrument* pInstrument = pInstruments->get( nNote % pInstruments->size() );
+			pPattern->insert_note( new Note( pInstrument, nTick, 0.8f, 0.5f, 0.5f, -1, 0 ) );
+		}
+	}
+	pSong->get_pattern_list()->add( pPattern );
+
+	// the columns do not own their patterns
+	std::vector<PatternList*>* pColumns = pSong->get_pattern_group_vector();
+	for ( PatternList* pColumn : *pColumns ) {
+		pColumn->clear();
+		delete pColumn;
+	}
+	pColumns->clear();
+	for ( int nBar = 0; nBar < BENCH_BARS; ++nBar ) {
+		PatternList* pColumn = new PatternList();
+		pColumn->add( pPattern );
+		pColumns->push_back( pColumn );
+	}
+}
+
+/** \return the number of notes of all the patterns of \a pSong */
+static int bench_count_notes( Song* pSong )
+{
+	int nNotes = 0;
+	PatternList* pPatterns = pSong->get_pattern_list();
+	for ( int i = 0; i < pPatterns->size(); ++i ) {
+		nNotes += pPatterns->get( i )->get_notes()->size();
+	}
+	return nNotes;
+}
+
+/**
+ * Saves \a sSongFile with \a nPatterns more patterns of one note per
+ * instrument at every step, then reads it back with both
+ * SongReader::readSong() and SongReader::readSongDocument(), and as a
+ * binary song read back with SongReader::readSong().
+ * \return false if the song could not be generated or if a reader
+ * loses notes
+ */
+static bool bench_load( const QString& sSongFile, int nPatterns, bool bTable, QJsonArray* pRuns )
+{
+	Song* pSong = Song::load( sSongFile );
+	if ( pSong == nullptr ) {
+		fprintf( stderr, "Can not load %s\n", sSongFile.toLocal8Bit().constData() );
+		return false;
+	}
+	InstrumentList* pInstruments = pSong->get_instrument_list();
+	for ( int nPattern = 0; nPattern < nPatterns; ++nPattern ) {
+		Pattern* pPattern = new Pattern( QString( "bench %1" ).arg( nPattern ), "", "", BENCH_PATTERN_LENGTH );
+		for ( int nTick = 0; nTick < BENCH_PATTERN_LENGTH; nTick += BENCH_STEP ) {
+			for ( int i = 0; i < pInstruments->size(); ++i ) {
+				pPattern->insert_note( new Note( pInstruments->get( i ), nTick, 0.8f, 0.5f, 0.5f, -1, 0 ) );
+			}
+		}
+		pSong->get_pattern_list()->add( pPattern );
+	}
+	int nNotes = bench_count_notes( pSong );
+	QString sFile = Filesystem::tmp_file_path( "bench-load.h2song" );
+	QString sBinFile = Filesystem::tmp_file_path( "bench-load.h2songb" );
+	auto save_start = std::chrono::steady_clock::now();
+	bool bSaved = pSong->save( sFile );
+	auto save_end = std::chrono::steady_clock::now();
+	bSaved = bSaved && pSong->save( sBinFile );
+	auto bin_save_end = std::chrono::steady_clock::now();
+	delete pSong;
+	if ( !bSaved ) {
+		fprintf( stderr, "Can not write %s\n", sFile.toLocal8Bit().constData() );
+		return false;
+	}
+	double saves[] = { std::chrono::duration<double, std::milli>( save_end - save_start ).count(),
+					   std::chrono::duration<double, std::milli>( save_end - save_start ).count(),
+					   std::chrono::duration<double, std::milli>( bin_save_end - save_end ).count() };
+
+	bool bOk = true;
+	const char* readers[] = { "stream", "document", "binary" };
+	for ( int nReader = 0; nReader < 3; ++nReader ) {
+		const char* sReader = readers[ nReader ];
+		QString sReadFile = nReader == 2 ? sBinFile : sFile;
+		auto start = std::chrono::steady_clock::now();
+		SongReader reader;
+		pSong = nReader == 1 ? reader.readSongDocument( sReadFile ) : reader.readSong( sReadFile );
+		auto end = std::chrono::steady_clock::now();
+		int nLoaded = pSong ? bench_count_notes( pSong ) : -1;
+		delete pSong;
+
+		QJsonObject run;
+		run[ "song" ] = QFileInfo( sSongFile ).completeBaseName();
+		run[ "reader" ] = sReader;
+		run[ "bytes" ] = QFileInfo( sReadFile ).size();
+		run[ "patterns" ] = nPatterns;
+		run[ "notes" ] = nLoaded;
+		run[ "load_ms" ] = std::chrono::duration<double, std::milli>( end - start ).count();
+		run[ "save_ms" ] = saves[ nReader ];
+		pRuns->append( run );
+
+		if ( bTable ) {
+			printf( "%-20s %-8s %8lld bytes  %8d notes  load %9.1f ms  save %9.1f ms\n",
+					run[ "song" ].toString().toLocal8Bit().constData(), sReader,
+					( long long )QFileInfo( sReadFile ).size(), nLoaded, run[ "load_ms" ].toDouble(), saves[ nReader ] );
+			fflush( stdout );
+		}
+		if ( nLoaded != nNotes ) {
+			fprintf( stderr, "%s reader: %d notes instead of %d\n", sReader, nLoaded, nNotes );
+			bOk = false;
+		}
+	}
+	QFile::remove( sFile );
+	QFile::remove( sBinFile );
+	return bOk;
+}
+
+/**
+ * Looks for the plugin named or labelled \a sName, or for the first
+ * one with audio ports if \a sName is empty.
+ * \return true if \a pPlugin was found
+ */
+static bool bench_find_plugin( const QString& sName, BenchPlugin* pPlugin )
+{
+#ifdef H2CORE_HAVE_LADSPA
+	for ( LadspaFXInfo* pInfo : Effects::get_instance()->getPluginList() ) {
+		bool bMatch = sName.isEmpty() ? ( pInfo->m_nIAPorts > 0 && pInfo->m_nOAPorts > 0 )
+									  : ( pInfo->m_sName == sName || pInfo->m_sLabel == sName );
+		if ( bMatch ) {
+			pPlugin->filename = pInfo->m_sFilename;
+			pPlugin->label = pInfo->m_sLabel;
+			return true;
+		}
+	}
+#else
+	( void )sName;
+	( void )pPlugin;
+#endif
+	return false;
+}
+
+/** puts \a pPlugin in the first FX slot and disables the others, or disables all of them */
+static void bench_setup_ladspa( const BenchPlugin* pPlugin )
+{
+#ifdef H2CORE_HAVE_LADSPA
+	Effects* pEffects = Effects::get_instance();
+	for ( int nFX = 0; nFX < MAX_FX; ++nFX ) {
+		LadspaFX* pFX = pEffects->getLadspaFX( nFX );
+		if ( pFX ) {
+			pFX->setEnabled( false );
+		}
+	}
+	if ( pPlugin ) {
+		LadspaFX* pFX = LadspaFX::load( pPlugin->filename, pPlugin->label, 44100 );
+		if ( pFX ) {
+			pFX->setEnabled( true );
+		}
+		pEffects->setLadspaFX( pFX, 0 );
+	}
+#else
+	( void )pPlugin;
+#endif
+}
+
+int main( int argc, char** argv )
+{
+	QCoreApplication app( argc, argv );
+	app.setApplicationName( "hydrogen-bench" );
+
+	QCommandLineParser parser;
+	parser.setApplicationDescription( "Renders songs through the audio engine without audio device nor GUI "
+									  "and reports the duration of the process cycles." );
+	parser.addHelpOption();
+	QCommandLineOption rootOption( QStringList() << "r" << "root",
+								   "Hydrogen source directory holding data/ and src/tests/data/.", "dir" );
+	QCommandLineOption bufferOption( QStringList() << "b" << "buffer-sizes",
+									 "Comma separated buffer sizes in frames.", "list", "64,256,1024" );
+	QCommandLineOption polyphonyOption( QStringList() << "p" << "polyphony",
+										"Comma separated numbers of notes per 16th of the generated song, "
+										"0 to skip it.", "list", "1,4,16" );
+	QCommandLineOption interpolationOption( QStringList() << "I" << "interpolation",
+											"Comma separated interpolation modes (linear, cosine, third, "
+											"cubic, hermite) or all.", "list", "linear,cubic" );
+	QCommandLineOption ladspaOption( QStringList() << "l" << "ladspa",
+									 "LADSPA plugin (name or label) used for the runs with FX, "
+									 "the first plugin found by default.", "plugin" );
+	QCommandLineOption noLadspaOption( QStringList() << "n" << "no-ladspa", "Skip the runs with FX." );
+	QCommandLineOption jsonOption( QStringList() << "j" << "json",
+								   "Writes the results as JSON into file, - for the standard output.", "file" );
+	QCommandLineOption loadOption( QStringList() << "L" << "load",
+								   "Times the song loaders on the first song with count generated patterns "
+								   "instead of rendering.", "count" );
+	QCommandLineOption verboseOption( QStringList() << "V" << "verbose",
+									  "Level, if present, may be None, Error, Warning, Info, Debug or 0xHHHH", "level" );
+	parser.addOption( rootOption );
+	parser.addOption( bufferOption );
+	parser.addOption( polyphonyOption );
+	parser.addOption( interpolationOption );
+	parser.addOption( ladspaOption );
+	parser.addOption( noLadspaOption );
+	parser.addOption( jsonOption );
+	parser.addOption( loadOption );
+	parser.addOption( verboseOption );
+	parser.addPositionalArgument( "songs", "Songs to render, the functional test songs by default.", "[songs...]" );
+	parser.process( app );
+
+	QString sRootDir = parser.value( rootOption );
+	if ( sRootDir.isEmpty() ) {
+		sRootDir = QProcessEnvironment::systemEnvironment().value( "H2_HOME", H2_BENCH_SOURCE_DIR );
+	}
+	QString sTestDataDir = sRootDir + "/src/tests/data/";
+	if ( !QFile::exists( sTestDataDir + "functional/test.h2song" ) ) {
+		fprintf( stderr, "No test data in %s, use --root or H2_HOME\n", sRootDir.toLocal8Bit().constData() );
+		return 1;
+	}
+
+	QList<int> bufferSizes = bench_int_list( parser.value( bufferOption ) );
+	bufferSizes.removeAll( 0 );
+	QList<int> polyphonies = bench_int_list( parser.value( polyphonyOption ) );
+	std::vector<BenchInterpolation> interpolations;
+	QStringList interpolationNames = parser.value( interpolationOption ).split( ',', QString::SkipEmptyParts );
+	for ( const BenchInterpolation& interpolation : bench_interpolations ) {
+		if ( interpolationNames.contains( "all" ) || interpolationNames.contains( interpolation.name ) ) {
+			interpolations.push_back( interpolation );
+		}
+	}
+	if ( bufferSizes.isEmpty() || interpolations.empty() ) {
+		fprintf( stderr, "Nothing to run\n" );
+		return 1;
+	}
+
+	// JSON on the standard output replaces the table
+	QString sJsonFile = parser.value( jsonOption );
+	bool bTable = ( sJsonFile != "-" );
+
+	unsigned nLogLevel = Logger::None;
+	if ( parser.isSet( verboseOption ) ) {
+		nLogLevel = Logger::parse_log_level( parser.value( verboseOption ).toLocal8Bit() );
+	}
+	Logger* pLogger = Logger::bootstrap( nLogLevel );
+	Object::bootstrap( pLogger, pLogger->should_log( Logger::Debug ) );
+	Filesystem::bootstrap( pLogger, sRootDir + "/data/" );
+
+	// The Preferences are never deleted, which would save the
+	// benchmark settings into the user configuration.
+	Preferences::create_instance();
+	Preferences* pPref = Preferences::get_instance();
+	pPref->m_sAudioDriver = "Fake";
+	pPref->m_sMidiDriver = "";
+	pPref->m_nBufferSize = bufferSizes.first();
+
+	Hydrogen::create_instance();
+	Hydrogen* pHydrogen = Hydrogen::get_instance();
+
+	std::vector<BenchSong> songs;
+	QStringList songFiles = parser.positionalArguments();
+	if ( songFiles.isEmpty() ) {
+		for ( const QString& sFile : QDir( sTestDataDir + "functional" ).entryList( QStringList() << "*.h2song", QDir::Files, QDir::Name ) ) {
+			songFiles << sTestDataDir + "functional/" + sFile;
+		}
+	}
+	for ( const QString& sFile : songFiles ) {
+		songs.push_back( { QFileInfo( sFile ).completeBaseName(), sFile, 0 } );
+	}
+	for ( int nPolyphony : polyphonies ) {
+		if ( nPolyphony > 0 ) {
+			songs.push_back( { QString( "polyphony-%1" ).arg( nPolyphony ), sTestDataDir + "functional/test.h2song", nPolyphony } );
+		}
+	}
+
+	// runs without FX, then with the plugin if there is one
+	BenchPlugin plugin;
+	std::vector<const BenchPlugin*> plugins;
+	plugins.push_back( nullptr );
+	if ( !parser.isSet( noLadspaOption ) ) {
+		if ( bench_find_plugin( parser.value( ladspaOption ), &plugin ) ) {
+			plugins.push_back( &plugin );
+		} else {
+			fprintf( stderr, "No LADSPA plugin found, running without FX only\n" );
+		}
+	}
+
+	QJsonArray runs;
+	bool bFailed = false;
+	if ( parser.isSet( loadOption ) ) {
+		bFailed = !bench_load( songs.front().filename, parser.value( loadOption ).toInt(), bTable, &runs );
+		songs.clear();
+	}
+	for ( const BenchSong& benchSong : songs ) {
+		Song* pSong = Song::load( benchSong.filename );
+		if ( pSong == nullptr ) {
+			fprintf( stderr, "Can not load %s\n", benchSong.filename.toLocal8Bit().constData() );
+			bFailed = true;
+			continue;
+		}
+		if ( benchSong.polyphony > 0 ) {
+			bench_make_polyphonic( pSong, benchSong.polyphony );
+		}
+		pSong->set_mode( Song::SONG_MODE );
+		pSong->set_loop_enabled( false );
+		pHydrogen->setSong( pSong );
+
+		for ( int nBufferSize : bufferSizes ) {
+			for ( const BenchInterpolation& interpolation : interpolations ) {
+				for ( const BenchPlugin* pRunPlugin : plugins ) {
+					bench_setup_ladspa( pRunPlugin );
+					AudioEngine::get_instance()->get_sampler()->setInterpolateMode( interpolation.mode );
+					pPref->m_nBufferSize = std::min( nBufferSize, MAX_BUFFER_SIZE );
+					// a new driver starts the song from its beginning
+					pHydrogen->restartDrivers();
+
+					AudioOutput* pDriver = pHydrogen->getAudioOutput();
+					if ( pDriver == nullptr || pDriver->class_name() != FakeDriver::class_name() ) {
+						fprintf( stderr, "The fake audio driver could not be started\n" );
+						return 1;
+					}
+					FakeDriver* pFakeDriver = static_cast<FakeDriver*>( pDriver );
+					DspProfiler* pProfiler = pHydrogen->getDspProfiler();
+					pProfiler->reset();
+
+					auto start = std::chrono::steady_clock::now();
+					pHydrogen->sequencer_play();
+					auto end = std::chrono::steady_clock::now();
+					double fWallSeconds = std::chrono::duration<double>( end - start ).count();
+
+					std::vector<float> cycleTimes = pFakeDriver->getCycleTimes();
+					std::sort( cycleTimes.begin(), cycleTimes.end() );
+					unsigned nFrames = pFakeDriver->getBufferSize();
+					unsigned nSampleRate = pFakeDriver->getSampleRate();
+					double fAudioSeconds = ( double )cycleTimes.size() * nFrames / nSampleRate;
+
+					QJsonObject run;
+					run[ "song" ] = benchSong.name;
+					run[ "polyphony" ] = benchSong.polyphony;
+					run[ "buffer_size" ] = ( int )nFrames;
+					run[ "sample_rate" ] = ( int )nSampleRate;
+					run[ "interpolation" ] = interpolation.name;
+					run[ "ladspa" ] = pRunPlugin ? QJsonValue( pRunPlugin->label ) : QJsonValue();
+					run[ "cycles" ] = ( int )cycleTimes.size();
+					run[ "wall_seconds" ] = fWallSeconds;
+					run[ "realtime_factor" ] = fWallSeconds > 0 ? fAudioSeconds / fWallSeconds : 0.0;
+					run[ "budget_ms" ] = 1000.0 * nFrames / nSampleRate;
+
+					QJsonObject cycle;
+					cycle[ "p50_ms" ] = bench_percentile( cycleTimes, 0.5f );
+					cycle[ "p99_ms" ] = bench_percentile( cycleTimes, 0.99f );
+					cycle[ "max_ms" ] = cycleTimes.empty() ? 0.0f : cycleTimes.back();
+					run[ "cycle" ] = cycle;
+
+					// the stages are kept for the last DspProfiler::WINDOW cycles only
+					QJsonObject stages;
+					for ( int nStage = 0; nStage < DspProfiler::STAGES; ++nStage ) {
+						DspProfiler::Stats stats = pProfiler->get_stats( nStage );
+						if ( stats.samples == 0 ) {
+							continue;
+						}
+						QString sName = DspProfiler::stage_name( nStage );
+						if ( nStage >= DspProfiler::LADSPA_SLOT && nStage < DspProfiler::METERING ) {
+							sName += QString( " %1" ).arg( nStage - DspProfiler::LADSPA_SLOT + 1 );
+						}
+						QJsonObject stage;
+						stage[ "p50_ms" ] = stats.p50;
+						stage[ "p99_ms" ] = stats.p99;
+						stage[ "max_ms" ] = stats.max;
+						stages[ sName ] = stage;
+					}
+					run[ "stages" ] = stages;
+
+					QJsonArray voices;
+					for ( int nBucket = 0; nBucket < DspProfiler::VOICE_BUCKETS; ++nBucket ) {
+						DspProfiler::VoiceBucket bucket = pProfiler->get_voice_bucket( nBucket );
+						if ( bucket.cycles == 0 ) {
+							continue;
+						}
+						QJsonObject voice;
+						voice[ "min_voices" ] = bucket.min_voices;
+						voice[ "cycles" ] = bucket.cycles;
+						voice[ "sampler_mean_ms" ] = bucket.mean;
+						voice[ "sampler_max_ms" ] = bucket.max;
+						voices.append( voice );
+					}
+					run[ "voices" ] = voices;
+					runs.append( run );
+
+					if ( bTable ) {
+						printf( "%-20s %5u frames  %-8s %-3s %8.1fx realtime  p50 %7.3f  p99 %7.3f  max %7.3f ms  (budget %.3f ms)\n",
+								benchSong.name.toLocal8Bit().constData(), nFrames, interpolation.name,
+								pRunPlugin ? "FX" : "", run[ "realtime_factor" ].toDouble(),
+								cycle[ "p50_ms" ].toDouble(), cycle[ "p99_ms" ].toDouble(), cycle[ "max_ms" ].toDouble(),
+								run[ "budget_ms" ].toDouble() );
+						fflush( stdout );
+					}
+				}
+			}
+		}
+	}
+
+	if ( !sJsonFile.isEmpty() ) {
+		QJsonObject root;
+		root[ "version" ] = QString::fromStdString( get_version() );
+		root[ "runs" ] = runs;
+		QByteArray json = QJsonDocument( root ).toJson();
+		if ( sJsonFile == "-" ) {
+			fwrite( json.constData(), 1, json.size(), stdout );
+		} else {
+			QFile file( sJsonFile );
+			if ( !file.open( QIODevice::WriteOnly | QIODevice::Truncate ) || file.write( json ) != json.size() ) {
+				fprintf( stderr, "Can not write %s\n", sJsonFile.toLocal8Bit().constData() );
+				return 1;
+			}
+		}
+	}
+
+	return bFailed ? 1 : 0;
+}
@@ -36,6 +36,8 @@
 #include <hydrogen/hydrogen.h>
 #include <hydrogen/basics/instrument_list.h>
 #include <hydrogen/basics/instrument.h>
+#include <hydrogen/basics/pattern.h>
+#include <hydrogen/basics/pattern_list.h>
 #include <hydrogen/globals.h>
 #include <hydrogen/event_queue.h>
 #include <hydrogen/Preferences.h>
@@ -63,6 +65,7 @@ static struct option long_opts[] = {
 	{"bits", required_argument, nullptr, 'b'},
 	{"rate", required_argument, nullptr, 'r'},
 	{"outfile", required_argument, nullptr, 'o'},
+	{"stems", 0, nullptr, 't'},
 	{"interpolation", required_argument, nullptr, 'I'},
 	{"version", 0, nullptr, 'v'},
 	{"verbose", optional_argument, nullptr, 'V'},
@@ -104,6 +107,43 @@ void show_playlist (uint active )
 	cout << endl;
 }
 
+/* Stem of pInstrument exported along with outFilename, or an empty string
+ * if the instrument plays no note in the song. */
+QString stem_filename( Song* pSong, Instrument* pInstrument, const QString& outFilename )
+{
+	bool hasNotes = false;
+	PatternList* pPatternList = pSong->get_pattern_list();
+	for ( int i = 0; i < pPatternList->size() && ! hasNotes; i++ ) {
+		const Pattern::notes_t* notes = pPatternList->get( i )->get_notes();
+		FOREACH_NOTE_CST_IT_BEGIN_END( notes, it ) {
+			if ( it->second->get_instrument() == pInstrument ) {
+				hasNotes = true;
+				break;
+			}
+		}
+	}
+	if ( ! hasNotes ) {
+		return QString();
+	}
+
+	/* foo.wav -> foo-Kick.wav, the id tells apart instruments sharing a name */
+	QString name = pInstrument->get_name();
+	InstrumentList* pInstrumentList = pSong->get_instrument_list();
+	for ( int i = 0; i < pInstrumentList->size(); i++ ) {
+		Instrument* pOther = pInstrumentList->get( i );
+		if ( pOther != pInstrument && pOther->get_name() == name ) {
+			name += QString( "_%1" ).arg( pInstrument->get_id() );
+			break;
+		}
+	}
+
+	int dot = outFilename.lastIndexOf( '.' );
+	if ( dot <= outFilename.lastIndexOf( '/' ) ) {
+		return outFilename + "-" + name;
+	}
+	return outFilename.left( dot ) + "-" + name + outFilename.mid( dot );
+}
+
 #define NELEM(a) ( sizeof(a)/sizeof((a)[0]) )
 
 int main(int argc, char *argv[])
@@ -128,6 +168,7 @@ int main(int argc, char *argv[])
 		QString songFilename;
 		QString playlistFilename;
 		QString outFilename = nullptr;
+		bool exportStems = false;
 		QString sSelectedDriver;
 		bool showVersionOpt = false;
 		const char* logLevelOpt = "Error";
@@ -158,6 +199,9 @@ int main(int argc, char *argv[])
 			case 'o':
 				outFilename = QString::fromLocal8Bit(optarg);
 				break;
+			case 't':
+				exportStems = true;
+				break;
 			case 'i':
 				//install h2drumkit
 				drumkitName = QString::fromLocal8Bit(optarg);
@@ -372,13 +416,23 @@ int main(int argc, char *argv[])
 
 		
 		bool ExportMode = false;
+		int exportRate = 0;
 		if ( ! outFilename.isEmpty() ) {
 			InstrumentList *pInstrumentList = pSong->get_instrument_list();
+			std::map<int, QString> stems;
 			for (auto i = 0; i < pInstrumentList->size(); i++) {
-				pInstrumentList->get(i)->set_currently_exported( true );
+				Instrument *pInstrument = pInstrumentList->get(i);
+				pInstrument->set_currently_exported( true );
+				if ( exportStems ) {
+					QString stem = stem_filename( pSong, pInstrument, outFilename );
+					if ( ! stem.isEmpty() ) {
+						stems[ pInstrument->get_id() ] = stem;
+					}
+				}
 			}
+			/* all stems are rendered in the same pass as the song */
 			pHydrogen->startExportSession(rate, bits);
-			pHydrogen->startExportSong( outFilename );
+			pHydrogen->startExportSong( outFilename, stems );
 			cout << "Export Progress ... ";
 			ExportMode = true;
 		}
@@ -386,6 +440,7 @@ int main(int argc, char *argv[])
 		// Interactive mode
 		while ( ! quit ) {
 			/* FIXME: Someday here will be The Real CLI ;-) */
+			pHydrogen->applyRecordedNoteLengths();
 			Event event = pQueue->pop_event();
 			// if ( event.type > 0) cout << "EVENT TYPE: " << event.type << endl;
 
@@ -396,12 +451,19 @@ int main(int argc, char *argv[])
 	
 				if ( event.value < 100 ) {
 					cout << "\rExport Progress ... " << event.value << "%";
+					if ( exportRate > 0 && rate > 0 ) {
+						cout << " (" << (float)exportRate / rate << "x realtime)";
+					}
+					cout << flush;
 				} else {
 					pHydrogen->stopExportSession();
 					cout << "\rExport Progress ... DONE" << endl;
 					quit = true;
 				}
 				break;
+			case EVENT_PROGRESS_RATE: /* sent along with EVENT_PROGRESS */
+				exportRate = event.value;
+				break;
 			case EVENT_PLAYLIST_LOADSONG: /* Load new song on MIDI event */
 				if( pPlaylist ){
 					QString FirstSongFilename;
@@ -485,6 +547,7 @@ void showUsage()
 	cout << "   -s, --song FILE - Load a song (*.h2song) at startup" << endl;
 	cout << "   -p, --playlist FILE - Load a playlist (*.h2playlist) at startup" << endl;
 	cout << "   -o, --outfile FILE - Output to file (export)" << endl;
+	cout << "   -t, --stems - Also export each instrument to FILE-INSTRUMENT (with -o)" << endl;
 	cout << "   -r, --rate RATE - Set bitrate while exporting file" << endl;
 	cout << "   -b, --bits BITS - Set bits depth while exporting file" << endl;
 	cout << "   -k, --kit drumkit_name - Load a drumkit at startup" << endl;
@@ -30,6 +30,9 @@
 namespace H2Core
 {
 
+class Instrument;
+class InstrumentComponent;
+
 ///
 /// Base abstract class for audio output classes.
 ///
@@ -65,6 +68,33 @@ public:
 		return __track_out_enabled;
 	}
 
+	/**
+	 * Buffers the Sampler mixes the notes of a component of an
+	 * instrument into when has_track_outs() is true.
+	 *
+	 * \return nullptr if the driver has no output for them.
+	 */
+	virtual float* getTrackOut_L( Instrument* pInstr, InstrumentComponent* pCompo ) {
+		UNUSED( pInstr );
+		UNUSED( pCompo );
+		return nullptr;
+	}
+	/** \see getTrackOut_L( Instrument*, InstrumentComponent* ) */
+	virtual float* getTrackOut_R( Instrument* pInstr, InstrumentComponent* pCompo ) {
+		UNUSED( pInstr );
+		UNUSED( pCompo );
+		return nullptr;
+	}
+	/**
+	 * Whether the track outputs get the part of the main mix
+	 * played by each instrument, with the pan and gains of the
+	 * main mix (true), or follow
+	 * Preferences::m_nJackTrackOutputMode (false).
+	 */
+	virtual bool track_outs_follow_main_mix() const {
+		return false;
+	}
+
 protected:
 	/**
 	 * Whether the JackAudioDriver is ordered to create per-track
@@ -73,8 +103,9 @@ protected:
 	 * the Sampler and Hydrogen itself to probe the behavior of
 	 * the JackAudioDriver.
 	 *
-	 * In all other drivers this variable isn't used. It gets
-	 * initialized to false.
+	 * The DiskWriterDriver sets it when stems are exported along
+	 * with the song. In all other drivers this variable isn't
+	 * used. It gets initialized to false.
 	 */
 	bool __track_out_enabled;
 
@@ -26,6 +26,8 @@
 #include <sndfile.h>
 
 #include <inttypes.h>
+#include <map>
+#include <vector>
 
 #include <hydrogen/IO/AudioOutput.h>
 #include <hydrogen/object.h>
@@ -50,6 +52,15 @@ class DiskWriterDriver : public AudioOutput
 		audioProcessCallback	m_processCallback;
 		float*					m_pOut_L;
 		float*					m_pOut_R;
+		/**
+		 * File name of the stem written for each instrument id,
+		 * along with the main mix in #m_sFilename.
+		 */
+		std::map<int, QString>	m_stems;
+		/** Index of the stem buffers of each instrument id. */
+		std::map<int, unsigned>	m_stemIndex;
+		std::vector<float*>		m_stemOuts_L;
+		std::vector<float*>		m_stemOuts_R;
 
 		DiskWriterDriver( audioProcessCallback processCallback, unsigned nSamplerate, int nSampleDepth );
 		~DiskWriterDriver();
@@ -80,6 +91,24 @@ class DiskWriterDriver : public AudioOutput
 			m_sFilename = sFilename;
 		}
 
+		/**
+		 * Sets the stems rendered in the same pass as the main
+		 * mix. Each one holds the part of the main mix played by
+		 * an instrument. An empty #m_sFilename writes the stems
+		 * only. Has to be called before connect().
+		 */
+		void setStems( const std::map<int, QString>& stems ) {
+			m_stems = stems;
+		}
+
+		virtual float* getTrackOut_L( Instrument* pInstr, InstrumentComponent* pCompo );
+		virtual float* getTrackOut_R( Instrument* pInstr, InstrumentComponent* pCompo );
+		/** The stems hold the part of the main mix played by each
+		 * instrument. */
+		virtual bool track_outs_follow_main_mix() const {
+			return true;
+		}
+
 		virtual void play();
 		virtual void stop();
 		virtual void locate( unsigned long nFrame );
@@ -25,6 +25,7 @@
 
 #include <hydrogen/IO/AudioOutput.h>
 #include <inttypes.h>
+#include <vector>
 
 namespace H2Core
 {
@@ -33,6 +34,10 @@ typedef int  ( *audioProcessCallback )( uint32_t, void * );
 
 /**
  * Fake audio driver. Used only for profiling.
+ *
+ * play() runs the process callback as fast as possible until it
+ * asks to stop, e.g. at the end of the song, and keeps the duration
+ * of every cycle.
  */
 class FakeDriver : public AudioOutput
 {
@@ -58,11 +63,18 @@ public:
 	virtual void updateTransportInfo();
 	virtual void setBpm( float fBPM );
 
+	/** \return the durations of the cycles run by the last
+	 * play(), in milliseconds */
+	const std::vector<float>& getCycleTimes() const {
+		return m_cycleTimes;
+	}
+
 private:
 	audioProcessCallback m_processCallback;
 	unsigned m_nBufferSize;
 	float* m_pOut_L;
 	float* m_pOut_R;
+	std::vector<float> m_cycleTimes;
 
 };
 
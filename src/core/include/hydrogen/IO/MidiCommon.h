@@ -25,6 +25,7 @@
 
 #include "hydrogen/config.h"
 #include <hydrogen/object.h>
+#include <cstdint>
 #include <string>
 #include <vector>
 
@@ -56,13 +57,17 @@ public:
 	int m_nData1;
 	int m_nData2;
 	int m_nChannel;
+	/** RealtimeNoteQueue::now() when the message was sent, taken
+	 * from the driver if it knows, 0 for the time it is handled */
+	uint64_t m_nTime;
 	std::vector<unsigned char> m_sysexData;
 
 	MidiMessage()
 			: m_type( UNKNOWN )
 			, m_nData1( -1 )
 			, m_nData2( -1 )
-			, m_nChannel( -1 ) {}
+			, m_nChannel( -1 )
+			, m_nTime( 0 ) {}
 };
 
 
@@ -85,6 +85,19 @@ public:
 
 	// Returns 0 on success.
 	int writeSong( Song *song, const QString& filename );
+
+	/**
+	 * \return the content of \a filename holding \a song, binary if
+	 * it ends with Filesystem::songs_bin_ext. Hold
+	 * AudioEngine::lock_song() while the song may be edited.
+	 */
+	QByteArray serializeSong( Song *song, const QString& filename );
+	/**
+	 * writes \a data into \a filename, replacing it once complete.
+	 * Doesn't touch the song, can be called from any thread.
+	 * \return 0 on success
+	 */
+	static int writeFile( const QString& filename, const QByteArray& data );
 };
 
 };
@@ -181,6 +181,13 @@ public:
 			UI_LAYOUT_TABBED
 	};
 
+	/** note released by the Sampler when #m_nMaxNotes are playing */
+	enum VOICE_STEALING_TYPES {
+			VOICE_STEALING_OLDEST,
+			VOICE_STEALING_QUIETEST,
+			VOICE_STEALING_SAME_INSTRUMENT	///< the oldest of the same instrument, if any
+	};
+
 	QString				__lastspatternDirectory;
 	QString				__lastsampleDirectory; // audio file browser
 	bool				__playsamplesonclicking; // audio file browser
@@ -238,6 +245,14 @@ public:
 	float				m_fMetronomeVolume;
 	/// max notes
 	unsigned			m_nMaxNotes;
+	/// one of #VOICE_STEALING_TYPES
+	int					m_nVoiceStealing;
+	/**
+	 * Number of threads helping the audio thread to render the
+	 * voices of the Sampler, 0 to render them in the audio
+	 * thread alone. Read when the Sampler is created.
+	 */
+	unsigned			m_nRenderThreads;
 	/** 
 	 * Buffer size of the audio.
 	 *
@@ -245,6 +260,49 @@ public:
 	 * size of the freshly opened JACK client.
 	 */
 	unsigned			m_nBufferSize;
+	/**
+	 * Buffer size used by the DiskWriterDriver while exporting a
+	 * song, 0 to use #m_nBufferSize. Capped at MAX_BUFFER_SIZE.
+	 */
+	unsigned			m_nExportBufferSize;
+	/**
+	 * Memory budget of the SampleCache in MB. Decoded samples no
+	 * longer used by any drumkit or song are kept up to it.
+	 */
+	unsigned			m_nSampleCacheSize;
+	/**
+	 * Keep the decoded and transformed samples in the
+	 * SampleDiskCache, so that the next sessions map them instead of
+	 * decoding them again. Read when Hydrogen is created.
+	 */
+	bool				m_bSampleDiskCache;
+	/** Disk budget of the SampleDiskCache in MB. */
+	unsigned			m_nSampleDiskCacheSize;
+	/**
+	 * Samples whose decoded data is larger than this, in MB, are
+	 * streamed from disk: only their head is kept in memory. 0
+	 * disables streaming. Read when the Sampler is created.
+	 */
+	unsigned			m_nSampleStreamThreshold;
+	/**
+	 * Keep the samples of 8, 16 and 24 bit files in their own
+	 * integer format and convert them to float while rendering,
+	 * instead of decoding them to float. Read when the SampleCache
+	 * is created.
+	 */
+	bool				m_bCompactSamples;
+	/**
+	 * Resample the samples played at another rate or pitch in the
+	 * background, so that the voices play the resampled copies
+	 * instead of interpolating every frame. Read when the Sampler
+	 * is created.
+	 */
+	bool				m_bResampleVariants;
+	/**
+	 * Resample the copies of #m_bResampleVariants with a windowed
+	 * sinc instead of the interpolation of the Sampler.
+	 */
+	bool				m_bBandLimitedVariants;
 	/** 
 	 * Sample rate of the audio.
 	 *
@@ -29,7 +29,10 @@
 #include <hydrogen/synth/Synth.h>
 
 #include <pthread.h>
+#include <atomic>
+#include <mutex>
 #include <string>
+#include <vector>
 #include <cassert>
 
 
@@ -48,6 +51,9 @@
 namespace H2Core
 {
 
+class Song;
+class SongSnapshot;
+
 /**
  * Audio Engine main class (Singleton).
  *
@@ -88,7 +94,7 @@ public:
 	 * _pthread_mutex_lock()_ (pthread.h) to lock the AudioEngine
 	 * and transfer ownership of the #__engine_mutex to the
 	 * calling thread. Only this very thread can unlock() the
-	 * engine again.
+	 * engine again. The song is locked as well, see lock_song().
 	 *
 	 * The documentation below may serve as a guide for future
 	 * implementations. At the moment the logging of the locking
@@ -126,7 +132,8 @@ public:
 	 *
 	 * This function is equivalent to lock() but calls
 	 * _pthread_mutex_trylock()_ (pthread.h) instead and returns a
-	 * bool depending on its results.
+	 * bool depending on its results. Used by the audio thread, it
+	 * leaves the song unlocked, see lock_song().
 	 *
 	 * \param file File the locking occurs in.
 	 * \param line Line of the file the locking occurs in.
@@ -143,8 +150,46 @@ public:
 	 *
 	 * Calls _pthread_mutex_unlock()_ (pthread.h) on the address
 	 * of #__engine_mutex and leaves #__locker untouched.
+	 *
+	 * Unless the engine was locked with try_lock(), the notes
+	 * edited while it was locked are published afterwards, see
+	 * unlock_song(). The audio thread may run a cycle on the
+	 * previous SongSnapshot in between.
 	 */
 	void unlock();
+
+	/**
+	 * Lock the song against the other editing threads without
+	 * stopping the audio thread.
+	 *
+	 * The audio thread plays the notes of the current Song from
+	 * the SongSnapshot published last, which it takes with
+	 * acquire_song_snapshot() and never waits for. Threads only
+	 * adding, removing or changing notes should hold lock_song()
+	 * instead of lock(), so the audio thread keeps processing
+	 * while they work. Notes changed in place need a call to
+	 * Pattern::touch() to be published.
+	 *
+	 * lock() locks the song as well, so neither lock() nor
+	 * lock_song() may be called with the song locked.
+	 */
+	void lock_song();
+	/**
+	 * Publish a new SongSnapshot if the notes changed since the
+	 * last one and release lock_song().
+	 */
+	void unlock_song();
+	/**
+	 * Set the song the snapshots are made of, called with
+	 * lock() or lock_song() held. \a song may be nullptr.
+	 */
+	void set_song( Song* song );
+	/**
+	 * Called by the audio thread right after try_lock() to get
+	 * the notes to play. The snapshot stays valid until it calls
+	 * unlock().
+	 */
+	SongSnapshot* acquire_song_snapshot();
 	
 	
 	 static float compute_tick_size(int sampleRate, int bpm, int resolution);
@@ -176,6 +221,30 @@ private:
 	  */
 	pthread_mutex_t __engine_mutex;
 
+	/** Held by lock_song(), guards the members below. */
+	std::mutex __song_mutex;
+	/** The song snapshots are made of, see set_song(). */
+	Song* __song;
+	/** set_song() was called since the last snapshot */
+	bool __song_changed;
+	/** Pattern::get_last_revision() as of the last snapshot */
+	int __published_revision;
+	/** The last published snapshot, the only member the audio thread reads. */
+	std::atomic<SongSnapshot*> __song_snapshot;
+	/** Version of the snapshot the audio thread acquired last. */
+	std::atomic<int> __song_snapshot_in_use;
+	/** Replaced snapshots the audio thread may still be reading. */
+	std::vector<SongSnapshot*> __retired_snapshots;
+	/** The engine was locked with lock(), which holds #__song_mutex too. */
+	bool __engine_holds_song;
+
+	/**
+	 * Compile and publish a new SongSnapshot if needed and free
+	 * the retired ones the audio thread no longer uses, called
+	 * with #__song_mutex held and #__engine_mutex released.
+	 */
+	void publish_song();
+
 	/**
 	 * This struct is most probably intended to be used for
 	 * logging the locking of the AudioEngine. But neither it nor
@@ -51,6 +51,13 @@ class ADSR : private Object
 		/** destructor */
 		~ADSR();
 
+		/**
+		 * overwrite parameters and state with those of \a other,
+		 * does not allocate, used to recycle pooled notes
+		 * \param other the ADSR to copy from
+		 */
+		void copy_from( const ADSR* other );
+
 		/**
 		 * __attack setter
 		 * \param value the new value
@@ -89,6 +96,14 @@ class ADSR : private Object
 		 * \param step the increment to be added to __ticks
 		 */
 		float get_value( float step );
+		/**
+		 * fill a buffer with consecutive envelope values,
+		 * equivalent to calling get_value() \a nFrames times
+		 * \param pBuffer destination, at least \a nFrames long
+		 * \param nFrames number of values to compute
+		 * \param step the increment to be added to __ticks for each value
+		 */
+		void get_values( float* pBuffer, int nFrames, float step );
 		/**
 		 * sets state to RELEASE,
 		 * returns 0 if the state is IDLE,
@@ -96,6 +111,11 @@ class ADSR : private Object
 		 * set state to RELEASE, save __release_value and return it.
 		 * */
 		float release();
+		/**
+		 * \return the last value computed, 1.0 during the attack so
+		 * a note just started is never taken for a quiet one
+		 */
+		float get_level() const;
 
 	private:
 		unsigned int __attack;		///< Attack tick count
@@ -124,6 +144,11 @@ inline void ADSR::set_attack( unsigned int value )
 	__attack = value;
 }
 
+inline float ADSR::get_level() const
+{
+	return __state == ATTACK ? 1.0f : __value;
+}
+
 inline unsigned int ADSR::get_attack()
 {
 	return __attack;
@@ -73,6 +73,10 @@ class DrumkitComponent : public H2Core::Object
 		void						set_outs( int nBufferPos, float valL, float valR );
 		float						get_out_L( int nBufferPos );
 		float						get_out_R( int nBufferPos );
+		/** raw left output buffer, #MAX_BUFFER_SIZE frames, used by the block renderer */
+		float*						get_out_L_buffer();
+		/** raw right output buffer, #MAX_BUFFER_SIZE frames, used by the block renderer */
+		float*						get_out_R_buffer();
 
 	private:
 		int		__id;
@@ -91,6 +95,16 @@ class DrumkitComponent : public H2Core::Object
 };
 
 // DEFINITIONS
+inline float* DrumkitComponent::get_out_L_buffer()
+{
+	return __out_L;
+}
+
+inline float* DrumkitComponent::get_out_R_buffer()
+{
+	return __out_R;
+}
+
 /** Sets the name of the DrumkitComponent #__name.
  * \param name New name. */
 inline void DrumkitComponent::set_name( const QString& name )
@@ -0,0 +1,153 @@
+/*
+ * Hydrogen
+ * Copyright(c) 2002-2008 by Alex >Comix< Cominu [comix@users.sourceforge.net]
+ *
+ * http://www.hydrogen-music.org
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY, without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ */
+
+#ifndef H2C_DRUMKIT_INDEX_H
+#define H2C_DRUMKIT_INDEX_H
+
+#include <cassert>
+#include <map>
+#include <mutex>
+#include <vector>
+
+#include <QtCore/QStringList>
+
+#include <hydrogen/object.h>
+
+namespace H2Core
+{
+
+class Drumkit;
+
+/**
+ * Index of the system and user drumkits, kept in the cache dir.
+ *
+ * Listing the drumkit library used to parse every drumkit.xml, which
+ * takes a long time on large libraries or network storage. The index
+ * holds what the library views need, and refresh() parses again only
+ * the drumkit.xml files which changed since the last refresh, of this
+ * session or of a previous one.
+ *
+ * A drumkit directory is only listed again when its mtime changed,
+ * the drumkit.xml files are compared by mtime and size.
+ */
+class DrumkitIndex : public H2Core::Object
+{
+		H2_OBJECT
+	public:
+		/** what the index knows about a drumkit */
+		struct Entry {
+			QString path;           ///< the drumkit directory
+			bool system;            ///< found in the system drumkits directory
+			qint64 mtime;           ///< of drumkit.xml, in ms since the epoch
+			qint64 size;            ///< of drumkit.xml
+			QString name;
+			QString author;
+			QString info;
+			QString license;
+			QString image;
+			QStringList components; ///< names of the drumkit components
+			QStringList instruments;///< names of the instruments, in order
+			QStringList samples;    ///< paths of the samples of all the layers
+			qint64 samples_size;    ///< bytes of the existing sample files
+		};
+
+		/**
+		 * If #__instance equals 0, a new DrumkitIndex singleton
+		 * indexing Filesystem::sys_drumkits_dir() and
+		 * Filesystem::usr_drumkits_dir() will be created and
+		 * stored in it. The index is read from
+		 * Filesystem::cache_dir() but not refreshed.
+		 *
+		 * It is called in Hydrogen::create_instance().
+		 */
+		static void create_instance();
+		/**
+		 * Returns a pointer to the current DrumkitIndex
+		 * singleton stored in #__instance.
+		 */
+		static DrumkitIndex* get_instance() { assert(__instance); return __instance; }
+
+		/**
+		 * constructor, reads \a index_file if it exists
+		 * \param index_file where the index is kept
+		 * \param sys_dir the system drumkits directory
+		 * \param usr_dir the user drumkits directory
+		 */
+		DrumkitIndex( const QString& index_file, const QString& sys_dir, const QString& usr_dir );
+		~DrumkitIndex();
+
+		/**
+		 * brings the index up to date with the drumkit
+		 * directories and saves it if it changed
+		 * \return true if it changed
+		 */
+		bool refresh();
+		/**
+		 * \param system true for the system drumkits, false for
+		 * the user ones
+		 * \return the entries in the order of their directories
+		 */
+		std::vector<Entry> get_drumkits( bool system ) const;
+		/**
+		 * looks for the drumkit named \a name, a user drumkit
+		 * hiding a system one of the same name
+		 * \return false if there is none
+		 */
+		bool find( const QString& name, Entry* entry ) const;
+		/** \return the number of drumkit.xml parsed by the last refresh() */
+		int get_parsed() const;
+
+	private:
+		/**
+		 * Object holding the current DrumkitIndex singleton. It
+		 * is initialized with NULL, set with create_instance(),
+		 * and accessed with get_instance().
+		 */
+		static DrumkitIndex* __instance;
+
+		/** a drumkits directory as of the last refresh() */
+		struct Root {
+			qint64 mtime;
+			QStringList dirs;       ///< its subdirectories
+		};
+
+		/** fills \a entry out of the drumkit.xml of \a path, parsing it */
+		static bool read_entry( const QString& path, Entry* entry );
+		/** refreshes the entries of \a dir into \a entries, called locked */
+		bool refresh_root( const QString& dir, bool system, std::vector<Entry>& entries );
+		bool load();
+		bool save() const;
+
+		QString __index_file;
+		QString __sys_dir;
+		QString __usr_dir;
+		mutable std::mutex __mutex;
+		std::map<QString, Root> __roots;
+		std::vector<Entry> __entries;
+		int __parsed;
+};
+
+};
+
+#endif // H2C_DRUMKIT_INDEX_H
+
+/* vim: set softtabstop=4 noexpandtab: */
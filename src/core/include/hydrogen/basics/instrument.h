@@ -93,6 +93,16 @@ class Instrument : public H2Core::Object
 		 */
 		void load_from( Drumkit* drumkit, Instrument* instrument, bool is_live = true );
 
+		/**
+		 * takes the components and the members load_from() would
+		 * set from an instrument prepared beforehand, which gets the
+		 * previous components in exchange. Nothing is loaded nor
+		 * allocated, it is meant to be called with the AudioEngine
+		 * locked.
+		 * \param instrument the prepared instrument
+		 */
+		void take_from( Instrument* instrument );
+
 		/**
 		 * Calls the InstrumentLayer::load_sample() member
 		 * function of all layers of each component of the
@@ -193,7 +203,11 @@ class Instrument : public H2Core::Object
 		/** get the filter cutoff of the instrument */
 		float get_filter_cutoff() const;
 
-		/** set the left peak of the instrument */
+		/**
+		 * set the left peak of the instrument during the current
+		 * process cycle, only used by the audio thread which hands
+		 * it over to the Meters
+		 */
 		void set_peak_l( float val );
 		/** get the left peak of the instrument */
 		float get_peak_l() const;
@@ -201,6 +215,14 @@ class Instrument : public H2Core::Object
 		void set_peak_r( float val );
 		/** get the right peak of the instrument */
 		float get_peak_r() const;
+		/** set the sum of the squared left output values, see set_peak_l() */
+		void set_energy_l( float val );
+		/** get the sum of the squared left output values */
+		float get_energy_l() const;
+		/** set the sum of the squared right output values */
+		void set_energy_r( float val );
+		/** get the sum of the squared right output values */
+		float get_energy_r() const;
 
 		/** set the fx level of the instrument */
 		void set_fx_level( float level, int index );
@@ -284,6 +306,8 @@ class Instrument : public H2Core::Object
 		float					__pan_r;				///< right pan of the instrument
 		float					__peak_l;				///< left current peak value
 		float					__peak_r;				///< right current peak value
+		float					__energy_l;				///< left current sum of squares
+		float					__energy_r;				///< right current sum of squares
 		ADSR*					__adsr;					///< attack delay sustain release instance
 		bool					__filter_active;		///< is filter active?
 		float					__filter_cutoff;		///< filter cutoff (0..1)
@@ -297,7 +321,7 @@ class Instrument : public H2Core::Object
 		bool					__soloed;				///< is the instrument in solo mode?
 		bool					__muted;				///< is the instrument muted?
 		int						__mute_group;			///< mute group of the instrument
-		int						__queued;				///< count the number of notes queued within Sampler::__playing_notes_queue or std::priority_queue m_songNoteQueue
+		int						__queued;				///< count the number of notes queued within Sampler::m_pPlayingNotes or std::priority_queue m_songNoteQueue
 		float					__fx_level[MAX_FX];		///< Ladspa FX level array
 		int						__hihat_grp;			///< the instrument is part of a hihat
 		int						__lower_cc;				///< lower cc level
@@ -482,6 +506,26 @@ inline float Instrument::get_peak_r() const
 	return __peak_r;
 }
 
+inline void Instrument::set_energy_l( float val )
+{
+	__energy_l = val;
+}
+
+inline float Instrument::get_energy_l() const
+{
+	return __energy_l;
+}
+
+inline void Instrument::set_energy_r( float val )
+{
+	__energy_r = val;
+}
+
+inline float Instrument::get_energy_r() const
+{
+	return __energy_r;
+}
+
 inline void Instrument::set_fx_level( float level, int index )
 {
 	__fx_level[index] = level;
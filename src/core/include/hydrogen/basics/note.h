@@ -26,6 +26,9 @@
 #include <hydrogen/object.h>
 #include <hydrogen/basics/instrument.h>
 
+#include <utility>
+#include <vector>
+
 #define KEY_MIN                 0
 #define KEY_MAX                 11
 #define OCTAVE_MIN              -3
@@ -51,6 +54,7 @@ namespace H2Core
 {
 
 class XMLNode;
+class XMLStreamReader;
 class ADSR;
 class Instrument;
 class InstrumentList;
@@ -58,6 +62,9 @@ class InstrumentList;
 struct SelectedLayerInfo {
 	int SelectedLayer;		///< selected layer during layer selection
 	float SamplePosition;	///< place marker for overlapping process() cycles
+	int StreamID;			///< disk stream of a streamed sample, -1 if none
+	int VariantID;			///< resampled copy of the sample being played, -1 if none
+	int VariantPosition;	///< place marker within the resampled copy
 };
 
 /**
@@ -93,6 +100,26 @@ class Note : public H2Core::Object
 		/** destructor */
 		~Note();
 
+		/**
+		 * reinitialise the note as the matching constructor would,
+		 * reusing the already allocated ADSR and layer storage
+		 * \param instrument the instrument played by this note
+		 * \param position the position of the note within the pattern
+		 * \param velocity it's velocity
+		 * \param pan_l left pan
+		 * \param pan_r right pan
+		 * \param length it's length
+		 * \param pitch it's pitch
+		 */
+		void reset( Instrument* instrument, int position, float velocity, float pan_l, float pan_r, int length, float pitch );
+		/**
+		 * reinitialise the note as a copy of \a other,
+		 * reusing the already allocated ADSR and layer storage
+		 * \param other the note to copy
+		 * \param instrument if set will be used as note instrument
+		 */
+		void reset( Note* other, Instrument* instrument=nullptr );
+
 		/*
 		 * save the note within the given XMLNode
 		 * \param node the XMLNode to feed
@@ -105,6 +132,15 @@ class Note : public H2Core::Object
 		 * \return a new Note instance
 		 */
 		static Note* load_from( XMLNode* node, InstrumentList* instruments );
+		/**
+		 * load a note from an XMLStreamReader positioned on its
+		 * element, and move past its end
+		 * \param reader the XMLStreamReader to read from
+		 * \param instruments the current instrument list to search
+		 * instrument into, nullptr to call map_instrument() later
+		 * \return a new Note instance
+		 */
+		static Note* load_from( XMLStreamReader* reader, InstrumentList* instruments );
 
 		/** output details through logger with DEBUG severity */
 		void dump();
@@ -296,6 +332,14 @@ class Note : public H2Core::Object
 		 * \param val_r the right channel value
 		 */
 		void compute_lr_values( float* val_l, float* val_r );
+		/**
+		 * compute left and right output based on filters for a
+		 * whole block, in place
+		 * \param buf_l the left channel values
+		 * \param buf_r the right channel values
+		 * \param nFrames number of frames in both buffers
+		 */
+		void compute_lr_values( float* buf_l, float* buf_r, int nFrames );
 
 	private:
 		Instrument*		__instrument;   ///< the instrument to be played by this note
@@ -314,7 +358,7 @@ class Note : public H2Core::Object
 		float			__cut_off;            ///< filter cutoff [0;1]
 		float			__resonance;          ///< filter resonant frequency [0;1]
 		int				__humanize_delay;       ///< used in "humanize" function
-		std::map< int, SelectedLayerInfo* > __layers_selected;
+		std::vector< std::pair< int, SelectedLayerInfo > > __layers_selected;	///< layer state per drumkit component id
 		float			__bpfb_l;             ///< left band pass filter buffer
 		float			__bpfb_r;             ///< right band pass filter buffer
 		float			__lpfb_l;             ///< left low pass filter buffer
@@ -324,7 +368,11 @@ class Note : public H2Core::Object
 		bool			__note_off;            ///< note type on|off
 		bool			__just_recorded;       ///< used in record+delete
 		float			__probability;        ///< note probability
+		int				__pool_index;           ///< slot within the NotePool, -1 if heap allocated
 		static const char* __key_str[]; ///< used to build QString from #__key an #__octave
+		/** set #__adsr, #__instrument_id and #__layers_selected from #__instrument */
+		void init_instrument_state();
+		friend class NotePool;
 };
 
 // DEFINITIONS
@@ -461,7 +509,12 @@ inline void Note::set_probability( float value )
 
 inline SelectedLayerInfo* Note::get_layer_selected( int CompoID )
 {
-	return __layers_selected[ CompoID ];
+	for ( auto& layer : __layers_selected ) {
+		if ( layer.first == CompoID ) {
+			return &layer.second;
+		}
+	}
+	return nullptr;
 }
 
 inline void Note::set_humanize_delay( int value )
@@ -574,6 +627,28 @@ inline void Note::compute_lr_values( float* val_l, float* val_r )
 	*val_r = __lpfb_r;
 }
 
+inline void Note::compute_lr_values( float* buf_l, float* buf_r, int nFrames )
+{
+	float cut_off = __instrument->get_filter_cutoff();
+	float resonance = __instrument->get_filter_resonance();
+	float bpfb_l = __bpfb_l;
+	float bpfb_r = __bpfb_r;
+	float lpfb_l = __lpfb_l;
+	float lpfb_r = __lpfb_r;
+	for ( int i = 0; i < nFrames; ++i ) {
+		bpfb_l  =  resonance * bpfb_l  + cut_off * ( buf_l[ i ] - lpfb_l );
+		lpfb_l +=  cut_off   * bpfb_l;
+		bpfb_r  =  resonance * bpfb_r  + cut_off * ( buf_r[ i ] - lpfb_r );
+		lpfb_r +=  cut_off   * bpfb_r;
+		buf_l[ i ] = lpfb_l;
+		buf_r[ i ] = lpfb_r;
+	}
+	__bpfb_l = bpfb_l;
+	__bpfb_r = bpfb_r;
+	__lpfb_l = lpfb_l;
+	__lpfb_r = lpfb_r;
+}
+
 };
 
 #endif // H2C_NOTE_H
@@ -0,0 +1,155 @@
+/*
+ * Hydrogen
+ * Copyright(c) 2002-2008 by Alex >Comix< Cominu [comix@users.sourceforge.net]
+ *
+ * http://www.hydrogen-music.org
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY, without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ */
+
+#ifndef H2C_NOTE_POOL_H
+#define H2C_NOTE_POOL_H
+
+#include <hydrogen/object.h>
+#include <hydrogen/basics/note.h>
+
+#include <atomic>
+#include <cassert>
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+/** Number of notes preallocated by the H2Core::NotePool. */
+#define NOTE_POOL_SIZE 4096
+/** Number of drumkit components a pooled note can hold without allocating. */
+#define NOTE_POOL_COMPONENTS 8
+
+namespace H2Core
+{
+
+class ADSR;
+class Instrument;
+
+/**
+ * Preallocated notes for the audio thread.
+ *
+ * The sequencer, the MIDI input and the sampler take their notes
+ * from here instead of the heap. A pooled note comes with its ADSR
+ * and room for its per component layer state, so acquire() and
+ * release() neither allocate nor lock. The free list is a lock-free
+ * stack of indices, its head carries a tag against ABA.
+ *
+ * When the pool runs dry acquire() falls back to the heap and counts
+ * it, release() accepts both kinds of notes.
+ */
+class NotePool : public H2Core::Object
+{
+		H2_OBJECT
+	public:
+		/**
+		 * If #__instance equals 0, a new NotePool singleton
+		 * will be created and stored in it.
+		 *
+		 * It is called in Hydrogen::audioEngine_init().
+		 */
+		static void create_instance();
+		/**
+		 * Returns a pointer to the current NotePool singleton
+		 * stored in #__instance.
+		 */
+		static NotePool* get_instance() { assert(__instance); return __instance; }
+
+		/**
+		 * constructor
+		 * \param nCapacity number of notes to preallocate
+		 */
+		explicit NotePool( int nCapacity );
+		/** destructor, deletes the pooled notes */
+		~NotePool();
+
+		/**
+		 * get a note initialised as by the matching Note constructor
+		 * \param instrument the instrument played by this note
+		 * \param position the position of the note within the pattern
+		 * \param velocity it's velocity
+		 * \param pan_l left pan
+		 * \param pan_r right pan
+		 * \param length it's length
+		 * \param pitch it's pitch
+		 */
+		Note* acquire( Instrument* instrument, int position, float velocity, float pan_l, float pan_r, int length, float pitch );
+		/**
+		 * get a note initialised as a copy of \a other
+		 * \param other the note to copy
+		 * \param instrument if set will be used as note instrument
+		 */
+		Note* acquire( Note* other, Instrument* instrument=nullptr );
+		/**
+		 * give a note back, pooled notes are recycled and
+		 * heap allocated ones deleted
+		 * \param note the note to release, may be nullptr
+		 */
+		void release( Note* note );
+
+		/** number of preallocated notes */
+		int get_capacity() const;
+		/** number of notes currently in the free list */
+		int get_available() const;
+		/** number of times acquire() had to fall back to the heap */
+		int get_exhausted_count() const;
+
+	private:
+		/**
+		 * Object holding the current NotePool singleton. It is
+		 * initialized with NULL, set with create_instance(), and
+		 * accessed with get_instance().
+		 */
+		static NotePool* __instance;
+
+		/** pop a note from the free list, nullptr if empty */
+		Note* pop();
+		/** push the note at \a nIndex on the free list */
+		void push( uint32_t nIndex );
+
+		std::vector<Note*> __notes;						///< all pooled notes, indexed by Note::__pool_index
+		std::unique_ptr<std::atomic<uint32_t>[]> __next;	///< free list links
+		std::atomic<uint64_t> __head;					///< tag in the upper, index in the lower 32 bits
+		std::atomic<int> __available;					///< notes in the free list
+		std::atomic<int> __exhausted;					///< heap fallbacks
+};
+
+// DEFINITIONS
+
+inline int NotePool::get_capacity() const
+{
+	return __notes.size();
+}
+
+inline int NotePool::get_available() const
+{
+	return __available.load( std::memory_order_relaxed );
+}
+
+inline int NotePool::get_exhausted_count() const
+{
+	return __exhausted.load( std::memory_order_relaxed );
+}
+
+};
+
+#endif // H2C_NOTE_POOL_H
+
+/* vim: set softtabstop=4 noexpandtab: */
@@ -24,6 +24,7 @@
 #define H2C_PATTERN_H
 
 #include <set>
+#include <atomic>
 
 #include <hydrogen/object.h>
 #include <hydrogen/basics/note.h>
@@ -32,6 +33,7 @@ namespace H2Core
 {
 
 class XMLNode;
+class XMLStreamReader;
 class Instrument;
 class InstrumentList;
 class PatternList;
@@ -107,6 +109,24 @@ class Pattern : public H2Core::Object
 		const virtual_patterns_t* get_virtual_patterns() const;
 		///< get the flattened virtual pattern set
 		const virtual_patterns_t* get_flattened_virtual_patterns() const;
+		/**
+		 * get the revision of the pattern, renewed each time its
+		 * notes, its length or its virtual patterns are changed
+		 */
+		int get_revision() const;
+		/**
+		 * hand out a new revision number, shared by all patterns
+		 * and pattern lists
+		 */
+		static int next_revision();
+		///< get the most recent revision handed out by next_revision()
+		static int get_last_revision();
+		/**
+		 * renew the revision of the pattern, to be called after
+		 * changing one of its notes in place so the change reaches
+		 * the audio engine, see AudioEngine::unlock_song()
+		 */
+		void touch();
 
 		/**
 		 * insert a new note within __notes
@@ -198,6 +218,8 @@ class Pattern : public H2Core::Object
 		notes_t __notes;                                        ///< a multimap (hash with possible multiple values for one key) of note
 		virtual_patterns_t __virtual_patterns;                  ///< a list of patterns directly referenced by this one
 		virtual_patterns_t __flattened_virtual_patterns;        ///< the complete list of virtual patterns
+		int __revision;                                         ///< see get_revision()
+		static std::atomic<int> __last_revision;                ///< see next_revision()
 		/**
 		 * load a pattern from an XMLNode
 		 * \param node the XMLDode to read from
@@ -205,6 +227,14 @@ class Pattern : public H2Core::Object
 		 * \return a new Pattern instance
 		 */
 		static Pattern* load_from( XMLNode* node, InstrumentList* instruments );
+		/**
+		 * load a pattern from an XMLStreamReader positioned on
+		 * its element, and move past its end
+		 * \param reader the XMLStreamReader to read from
+		 * \param instruments the current instrument list to search instrument into
+		 * \return a new Pattern instance
+		 */
+		static Pattern* load_from( XMLStreamReader* reader, InstrumentList* instruments );
 };
 
 #define FOREACH_NOTE_CST_IT_BEGIN_END(_notes,_it) \
@@ -254,6 +284,7 @@ inline const QString& Pattern::get_category() const
 inline void Pattern::set_length( int length )
 {
 	__length = length;
+	__revision = next_revision();
 }
 
 inline int Pattern::get_length() const
@@ -276,9 +307,30 @@ inline const Pattern::virtual_patterns_t* Pattern::get_flattened_virtual_pattern
 	return &__flattened_virtual_patterns;
 }
 
+inline int Pattern::get_revision() const
+{
+	return __revision;
+}
+
+inline int Pattern::next_revision()
+{
+	return ++__last_revision;
+}
+
+inline int Pattern::get_last_revision()
+{
+	return __last_revision;
+}
+
+inline void Pattern::touch()
+{
+	__revision = next_revision();
+}
+
 inline void Pattern::insert_note( Note* note, int position )
 {
 	__notes.insert( std::make_pair( ( position==-1 ? note->get_position() : position ), note ) );
+	__revision = next_revision();
 }
 
 inline bool Pattern::virtual_patterns_empty() const
@@ -289,22 +341,26 @@ inline bool Pattern::virtual_patterns_empty() const
 inline void Pattern::virtual_patterns_clear()
 {
 	__virtual_patterns.clear();
+	__revision = next_revision();
 }
 
 inline void Pattern::virtual_patterns_add( Pattern* pattern )
 {
 	__virtual_patterns.insert( pattern );
+	__revision = next_revision();
 }
 
 inline void Pattern::virtual_patterns_del( Pattern* pattern )
 {
 	virtual_patterns_cst_it_t it = __virtual_patterns.find( pattern );
 	if ( it!=__virtual_patterns.end() ) __virtual_patterns.erase( it );
+	__revision = next_revision();
 }
 
 inline void Pattern::flattened_virtual_patterns_clear()
 {
 	__flattened_virtual_patterns.clear();
+	__revision = next_revision();
 }
 
 };
@@ -26,6 +26,7 @@
 #include <vector>
 
 #include <hydrogen/object.h>
+#include <hydrogen/basics/pattern.h>
 
 namespace H2Core
 {
@@ -149,9 +150,16 @@ class PatternList : public H2Core::Object
 		 * \param sourceName base name to start with
 		 */
 		QString find_unused_pattern_name( QString sourceName );
+		/**
+		 * get the revision of the list, renewed each time
+		 * patterns are added, removed or reordered
+		 * (see Pattern::next_revision())
+		 */
+		int get_revision() const;
 
 	private:
 		std::vector<Pattern*> __patterns;            ///< the list of patterns
+		int __revision;                              ///< see get_revision()
 };
 
 // DEFINITIONS
@@ -164,6 +172,12 @@ inline int PatternList::size() const
 inline void PatternList::clear()
 {
 	__patterns.clear();
+	__revision = Pattern::next_revision();
+}
+
+inline int PatternList::get_revision() const
+{
+	return __revision;
 }
 
 };
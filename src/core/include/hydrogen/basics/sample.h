@@ -28,6 +28,7 @@
 #include <sndfile.h>
 
 #include <hydrogen/object.h>
+#include <hydrogen/basics/sample_cache.h>
 
 namespace H2Core
 {
@@ -173,6 +174,11 @@ class Sample : public H2Core::Object
 		 * velocity, and @a pan as arguments after
 		 * successfully loading the sample.
 		 *
+		 * The transformed data is kept in the SampleDiskCache,
+		 * if there is one, and mapped from it the next time
+		 * the same file is loaded with the same
+		 * transformations.
+		 *
 		 * \param filepath the file to load audio data from
 		 * \param loops transformation parameters
 		 * \param rubber band transformation parameters
@@ -191,9 +197,18 @@ class Sample : public H2Core::Object
 		 * Load the sample stored in #__filepath into
 		 * #__data_l and #__data_r.
 		 *
-		 * It uses libsndfile for reading both the content and
-		 * the metadata of the sample file. The latter is
-		 * stored in #__frames and #__sample_rate.
+		 * The data is requested from the SampleCache, which
+		 * decodes the file using SampleData::decode() only if
+		 * no other Sample did load it yet. The data is then
+		 * shared with the other samples of the same file,
+		 * held by #__shared_data, until a transformation
+		 * requires a private copy. The metadata is stored in
+		 * #__frames and #__sample_rate.
+		 *
+		 * A file found by is_streamable() is not cached: only
+		 * its first #STREAM_HEAD_FRAMES frames are decoded,
+		 * the Sampler reads the rest from disk while playing.
+		 * #__frames still holds the length of the whole file.
 		 *
 		 * Hydrogen does only support up to #SAMPLE_CHANNELS
 		 * (two per default) channels in the audio file. If
@@ -291,10 +306,26 @@ class Sample : public H2Core::Object
 		 * #__frames time sizeof( float ) * 2 
 		 */
 		int get_size() const;
-		/** \return #__data_l*/
+		/** \return #__data_l, nullptr if the data is kept in a compact format, see read_data() */
 		float* get_data_l() const;
-		/** \return #__data_r*/
+		/** \return #__data_r, equal to #__data_l for a mono sample */
 		float* get_data_r() const;
+		/** \return the storage of the frames, see SampleData::Format */
+		SampleData::Format get_format() const;
+		/** \return the frames of the left channel in the format returned by get_format() */
+		const void* get_raw_data_l() const;
+		/** \return the frames of the right channel in the format returned by get_format() */
+		const void* get_raw_data_r() const;
+		/** \return true if both channels share the same frames */
+		bool is_mono() const;
+		/**
+		 * converts frames of the data to float, whatever its format
+		 * \param first the first frame, less than get_head_frames()
+		 * \param count the number of frames to convert
+		 * \param out_l receives the left channel
+		 * \param out_r receives the right channel, may be nullptr
+		 */
+		void read_data( int first, int count, float* out_l, float* out_r ) const;
 		/**
 		 * #__is_modified setter
 		 * \param value the new value for #__is_modified
@@ -317,13 +348,68 @@ class Sample : public H2Core::Object
 		static Loops::LoopMode parse_loop_mode( const QString& string );
 		/** \return mode member of #__loops as a string */
 		QString get_loop_mode_string() const;
+		/** \return true if the data is shared with other samples through the SampleCache */
+		bool is_shared() const;
+		/** \return the data shared through the SampleCache, nullptr if the data is owned */
+		const std::shared_ptr<SampleData>& get_shared_data() const;
+		/**
+		 * \return the key identifying the data in memory, the one
+		 * of the SampleCache extended by the transformations
+		 * applied, empty if the file can not be read
+		 */
+		QString get_data_key() const;
+
+		/** number of frames kept in memory by a streamed sample */
+		static const int STREAM_HEAD_FRAMES = 65536;
+		/**
+		 * \return true if the file \a filepath is large enough
+		 * to be streamed, see Preferences::m_nSampleStreamThreshold
+		 */
+		static bool is_streamable( const QString& filepath );
+		/**
+		 * \return true if only the head of the data is in
+		 * memory, the Sampler streams the rest from disk
+		 */
+		bool is_streamed() const;
+		/**
+		 * \return the number of frames held by #__data_l and
+		 * #__data_r, which is less than #__frames for a
+		 * streamed sample
+		 */
+		int get_head_frames() const;
+		/**
+		 * load the part of the data of a streamed sample which
+		 * is not in memory. The transformations call it
+		 * before touching the data.
+		 * \return false if the file could not be read again
+		 */
+		bool unstream();
 
 	private:
+		/** release the data, deleting it unless it is shared */
+		void free_data();
+		/** make a private copy of the data before modifying it, if it is shared */
+		void detach();
+		/** make a private float copy of the data, if it is kept in a compact format */
+		void expand();
+		/** give the right channel frames of its own, if they are shared with the left one */
+		void split_channels();
+		/**
+		 * \return the SampleDiskCache key of \a filepath
+		 * transformed by the other arguments, empty if there is
+		 * nothing to transform or the file can not be read
+		 */
+		static QString get_transformed_key( const QString& filepath, const Loops& loops, const Rubberband& rubber,
+											const VelocityEnvelope& velocity, const PanEnvelope& pan );
+
 		QString				__filepath;          ///< filepath of the sample
 		int					__frames;            ///< number of frames in this sample
 		int					__sample_rate;       ///< samplerate for this sample
-		float*				__data_l;            ///< left channel data
-		float*				__data_r;            ///< right channel data
+		float*				__data_l;            ///< left channel data, nullptr if the shared data is compact
+		float*				__data_r;            ///< right channel data, equal to #__data_l if mono
+		std::shared_ptr<SampleData> __shared_data; ///< owner of the data if it is shared, nullptr if the data is owned
+		bool				__streamed;          ///< true if only the head of the data is loaded
+		int					__head_frames;       ///< number of loaded frames of a streamed sample
 		bool				__is_modified;       ///< true if sample is modified
 		PanEnvelope			__pan_envelope;      ///< pan envelope vector
 		VelocityEnvelope	__velocity_envelope; ///< velocity envelope vector
@@ -337,17 +423,37 @@ class Sample : public H2Core::Object
 
 inline void Sample::unload()
 {
-	if( __data_l ) delete __data_l;
-	if( __data_r ) delete __data_r;
+	free_data();
 	__frames = __sample_rate = 0;
+	__streamed = false;
+	__head_frames = 0;
 	/** #__is_modified = false; leave this unchanged as pan,
 	    velocity, loop and rubberband are kept unchanged */
-	__data_l = __data_r = nullptr;
 }
 
 inline bool Sample::is_empty() const
 {
-	return ( __data_l==__data_r==0 );
+	return ( __data_l==nullptr && __shared_data==nullptr );
+}
+
+inline bool Sample::is_shared() const
+{
+	return __shared_data != nullptr;
+}
+
+inline const std::shared_ptr<SampleData>& Sample::get_shared_data() const
+{
+	return __shared_data;
+}
+
+inline bool Sample::is_streamed() const
+{
+	return __streamed;
+}
+
+inline int Sample::get_head_frames() const
+{
+	return __streamed ? __head_frames : __frames;
 }
 
 inline const QString Sample::get_filepath() const
@@ -400,6 +506,26 @@ inline float* Sample::get_data_r() const
 	return __data_r;
 }
 
+inline SampleData::Format Sample::get_format() const
+{
+	return ( __data_l==nullptr && __shared_data!=nullptr ) ? __shared_data->format : SampleData::FLOAT;
+}
+
+inline const void* Sample::get_raw_data_l() const
+{
+	return get_format()==SampleData::FLOAT ? ( const void* )__data_l : __shared_data->pcm_l;
+}
+
+inline const void* Sample::get_raw_data_r() const
+{
+	return get_format()==SampleData::FLOAT ? ( const void* )__data_r : __shared_data->pcm_r;
+}
+
+inline bool Sample::is_mono() const
+{
+	return get_raw_data_l()==get_raw_data_r();
+}
+
 inline void Sample::set_is_modified( bool is_modified )
 {
 	__is_modified = is_modified;
@@ -0,0 +1,278 @@
+/*
+ * Hydrogen
+ * Copyright(c) 2002-2008 by Alex >Comix< Cominu [comix@users.sourceforge.net]
+ *
+ * http://www.hydrogen-music.org
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY, without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ */
+
+#ifndef H2C_SAMPLE_CACHE_H
+#define H2C_SAMPLE_CACHE_H
+
+#include <cassert>
+#include <cstdint>
+#include <list>
+#include <map>
+#include <memory>
+#include <mutex>
+
+#include <hydrogen/object.h>
+
+class QFile;
+
+namespace H2Core
+{
+
+/**
+ * Decoded audio data of a sample file, never modified once decoded.
+ *
+ * It is shared between all the Sample objects loaded from the same
+ * file. A Sample about to change its data makes a private copy first.
+ *
+ * The frames of a mono file are stored once, both channels pointing
+ * to them. The frames of an 8, 16 or 24 bit PCM file may be kept as
+ * integers, see #Format, and are then converted to float while being
+ * read, exactly as libsndfile would have converted them.
+ */
+class SampleData : public H2Core::Object
+{
+		H2_OBJECT
+	public:
+		/** storage of the frames of a channel */
+		enum Format {
+			FLOAT,          ///< 32 bit float, in #data_l and #data_r
+			INT16,          ///< 16 bit integers, in #pcm_l and #pcm_r
+			INT24           ///< packed little endian 24 bit integers, in #pcm_l and #pcm_r
+		};
+
+		/** reads the frames of a #FLOAT channel */
+		struct FloatReader {
+			const float* data;
+			float operator[]( int i ) const { return data[ i ]; }
+		};
+		/** reads the frames of an #INT16 channel */
+		struct Int16Reader {
+			const int16_t* data;
+			float operator[]( int i ) const { return data[ i ] * ( 1.0f / 0x8000 ); }
+		};
+		/** reads the frames of an #INT24 channel */
+		struct Int24Reader {
+			const uint8_t* data;
+			float operator[]( int i ) const {
+				const uint8_t* p = data + 3 * i;
+				int32_t v = ( int32_t )( ( uint32_t )p[ 0 ] << 8 | ( uint32_t )p[ 1 ] << 16 | ( uint32_t )p[ 2 ] << 24 );
+				return v * ( 1.0f / 0x80000000 );
+			}
+		};
+
+		/**
+		 * allocates \a frames frames per channel
+		 * \param frames the number of frames per channel
+		 * \param sample_rate the sample rate of the data
+		 * \param channels 1 to store the frames once for both channels
+		 * \param format the storage of the frames
+		 */
+		SampleData( int frames, int sample_rate, int channels = 2, Format format = FLOAT );
+		/**
+		 * uses frames mapped from a file, the left channel
+		 * followed by the right one unless \a channels is 1
+		 * \param mapping the mapped file, owned by the data
+		 * \param map the first frame of the left channel within
+		 * the mapping
+		 * \param frames the number of frames per channel
+		 * \param sample_rate the sample rate of the data
+		 * \param channels 1 if the frames are stored once for
+		 * both channels
+		 * \param format the storage of the frames
+		 */
+		SampleData( QFile* mapping, char* map, int frames, int sample_rate, int channels, Format format );
+		/** destructor */
+		~SampleData();
+
+		/**
+		 * Reads a sample file through libsndfile.
+		 *
+		 * Hydrogen does only support up to #SAMPLE_CHANNELS
+		 * (two per default) channels in the audio file. If
+		 * there are more, only the first two channels are
+		 * used. The content of a mono file is used for both
+		 * channels.
+		 *
+		 * \param filepath the file to decode
+		 * \param max_frames decode only the first \a max_frames
+		 * frames of the file, all of them if negative
+		 * \param compact keep the frames of an 8, 16 or 24 bit PCM
+		 * file as integers
+		 * \return the decoded data, nullptr if the file could
+		 * not be read
+		 */
+		static std::shared_ptr<SampleData> decode( const QString& filepath, int max_frames = -1, bool compact = false );
+
+		/** \return the number of bytes a frame of a channel takes in \a format */
+		static int get_frame_size( Format format );
+
+		/**
+		 * converts frames of a channel to float
+		 * \param format the storage of the frames
+		 * \param data the frames of the channel
+		 * \param first the first frame to convert
+		 * \param count the number of frames to convert
+		 * \param out receives the converted frames
+		 */
+		static void read_channel( Format format, const void* data, int first, int count, float* out );
+		/**
+		 * converts frames to float
+		 * \param first the first frame to convert
+		 * \param count the number of frames to convert
+		 * \param out_l receives the left channel
+		 * \param out_r receives the right channel, may be nullptr
+		 */
+		void read( int first, int count, float* out_l, float* out_r ) const;
+
+		/** \return true if both channels share the same frames */
+		bool is_mono() const { return channels == 1; }
+
+		/** \return the size of the data in bytes */
+		long long get_size() const {
+			return ( long long )frames * get_frame_size( format ) * channels;
+		}
+
+		float* data_l;          ///< left channel data, nullptr unless #FLOAT
+		float* data_r;          ///< right channel data, nullptr unless #FLOAT
+		char* pcm_l;            ///< left channel data, nullptr if #FLOAT
+		char* pcm_r;            ///< right channel data, nullptr if #FLOAT
+		int frames;             ///< number of frames per channel
+		int file_frames;        ///< number of frames of the file, more than #frames if only its head was decoded
+		int sample_rate;        ///< samplerate of the data
+		int channels;           ///< 1 if both channels point to the same frames, 2 otherwise
+		Format format;          ///< storage of the frames
+		QFile* mapping;         ///< file the frames are mapped from, nullptr if they are allocated
+};
+
+/**
+ * Process-wide cache of decoded sample files.
+ *
+ * The files are identified by their canonical path, modification
+ * time and size, so a kit referenced by several songs or reached
+ * through different paths is decoded only once, and a file changed on
+ * disk is decoded again. Its data is shared by reference counting
+ * between all the Sample objects using it.
+ *
+ * Data no Sample uses anymore stays in the cache until the cache
+ * exceeds its budget, the least recently used data being dropped
+ * first. Data still in use is never dropped, it would not free
+ * anything, so the cache may exceed its budget while the samples in
+ * use do.
+ */
+class SampleCache : public H2Core::Object
+{
+		H2_OBJECT
+	public:
+		/**
+		 * If #__instance equals 0, a new SampleCache
+		 * singleton will be created and stored in it. Its
+		 * budget is taken from Preferences::m_nSampleCacheSize,
+		 * its format from Preferences::m_bCompactSamples.
+		 *
+		 * It is called in Hydrogen::create_instance().
+		 */
+		static void create_instance();
+		/**
+		 * Returns a pointer to the current SampleCache
+		 * singleton stored in #__instance.
+		 */
+		static SampleCache* get_instance() { assert(__instance); return __instance; }
+		/** \return true once create_instance() was called */
+		static bool has_instance() { return __instance != nullptr; }
+
+		/**
+		 * constructor
+		 * \param budget number of bytes kept for data not in use
+		 * \param compact keep the frames of integer files as
+		 * integers, see SampleData::decode()
+		 */
+		explicit SampleCache( long long budget, bool compact = false );
+		~SampleCache();
+
+		/**
+		 * \param filepath the sample file
+		 * \return the cached data of \a filepath, decoded if it
+		 * is not in the cache yet, nullptr if the file could not
+		 * be read
+		 */
+		std::shared_ptr<SampleData> load( const QString& filepath );
+
+		/**
+		 * \param filepath the sample file
+		 * \return the key identifying the content of \a filepath,
+		 * made of its canonical path, modification time and size,
+		 * empty if it can not be read
+		 */
+		static QString get_key( const QString& filepath );
+
+		/** \return true if the frames of integer files are kept as integers */
+		bool is_compact() const { return __compact; }
+
+		/** \param budget number of bytes kept for data not in use */
+		void set_budget( long long budget );
+		/** \return the number of bytes kept for data not in use */
+		long long get_budget() const;
+		/** \return the size of all the cached data in bytes */
+		long long get_size() const;
+		/** \return the number of cached files */
+		int get_count() const;
+		/** \return the number of load() served from the cache */
+		int get_hits() const;
+		/** \return the number of load() which had to decode a file */
+		int get_misses() const;
+		/** \return the number of files dropped to honour the budget */
+		int get_evictions() const;
+		/** drops all the cached data, samples in use keep theirs */
+		void clear();
+
+	private:
+		/**
+		 * Object holding the current SampleCache singleton. It
+		 * is initialized with NULL, set with create_instance(),
+		 * and accessed with get_instance().
+		 */
+		static SampleCache* __instance;
+
+		struct Entry {
+			std::shared_ptr<SampleData> data;
+			std::list<QString>::iterator lru;
+		};
+
+		/** drops the least recently used data not in use until the budget is met, called locked */
+		void evict();
+
+		mutable std::mutex __mutex;
+		std::map<QString, Entry> __entries;     ///< by canonical path, modification time and size
+		std::list<QString> __lru;               ///< keys of #__entries, most recently used first
+		long long __budget;
+		bool __compact;
+		long long __size;
+		int __hits;
+		int __misses;
+		int __evictions;
+};
+
+};
+
+#endif // H2C_SAMPLE_CACHE_H
+
+/* vim: set softtabstop=4 noexpandtab: */
@@ -0,0 +1,149 @@
+/*
+ * Hydrogen
+ * Copyright(c) 2002-2008 by Alex >Comix< Cominu [comix@users.sourceforge.net]
+ *
+ * http://www.hydrogen-music.org
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY, without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ */
+
+#ifndef H2C_SAMPLE_DISK_CACHE_H
+#define H2C_SAMPLE_DISK_CACHE_H
+
+#include <cassert>
+#include <memory>
+#include <mutex>
+
+#include <hydrogen/object.h>
+
+namespace H2Core
+{
+
+class SampleData;
+class SamplePeaks;
+
+/**
+ * Process-wide cache of decoded sample data on disk.
+ *
+ * Decoding a sample file, and stretching it with rubberband, is by
+ * far the slowest part of loading a drumkit or a song. The
+ * SampleCache and Sample::load() store the data they had to compute
+ * here, and the next session maps it from disk instead of computing
+ * it again.
+ *
+ * The entries are files of cache_dir()/samples named after a hash of
+ * their key. A key has to identify the data completely: the
+ * SampleCache uses SampleCache::get_key(), which changes with the
+ * sample file, Sample::load() adds the transformations it applied.
+ *
+ * The SamplePeaks of the data are kept beside it, under the same key.
+ *
+ * The cache is kept below its budget by removing the entries read
+ * least recently.
+ */
+class SampleDiskCache : public H2Core::Object
+{
+		H2_OBJECT
+	public:
+		/**
+		 * If #__instance equals 0 and
+		 * Preferences::m_bSampleDiskCache is set, a new
+		 * SampleDiskCache singleton will be created and stored
+		 * in it. Its budget is taken from
+		 * Preferences::m_nSampleDiskCacheSize.
+		 *
+		 * It is called in Hydrogen::create_instance().
+		 */
+		static void create_instance();
+		/**
+		 * Returns a pointer to the current SampleDiskCache
+		 * singleton stored in #__instance.
+		 */
+		static SampleDiskCache* get_instance() { assert(__instance); return __instance; }
+		/** \return true if the cache was created */
+		static bool has_instance() { return __instance != nullptr; }
+
+		/**
+		 * constructor
+		 * \param dir the directory of the entries, created if
+		 * needed
+		 * \param budget number of bytes the entries may take
+		 */
+		SampleDiskCache( const QString& dir, long long budget );
+		~SampleDiskCache();
+
+		/**
+		 * \param key identifies the data
+		 * \return the data stored for \a key, mapped from its
+		 * file, nullptr if there is none
+		 */
+		std::shared_ptr<SampleData> load( const QString& key );
+		/**
+		 * stores \a data for \a key, replacing the data already
+		 * stored for it
+		 * \return true on success
+		 */
+		bool store( const QString& key, const SampleData& data );
+		/**
+		 * \param key identifies the data the peaks summarize
+		 * \return the peaks stored for \a key, nullptr if there
+		 * are none
+		 */
+		std::shared_ptr<SamplePeaks> load_peaks( const QString& key );
+		/**
+		 * stores \a peaks for \a key, replacing the peaks
+		 * already stored for it
+		 * \return true on success
+		 */
+		bool store_peaks( const QString& key, const SamplePeaks& peaks );
+
+		/** \return the directory of the entries */
+		const QString& get_dir() const { return __dir; }
+		/** \return the size of all the entries in bytes */
+		long long get_size() const;
+		/** \return the number of load() served from disk */
+		int get_hits() const;
+		/** \return the number of load() finding no entry */
+		int get_misses() const;
+		/** removes all the entries */
+		void clear();
+
+	private:
+		/**
+		 * Object holding the current SampleDiskCache singleton.
+		 * It is initialized with NULL, set with
+		 * create_instance(), and accessed with get_instance().
+		 */
+		static SampleDiskCache* __instance;
+
+		/** \return the file of the entry of \a key ending with \a ext */
+		QString get_path( const QString& key, const char* ext ) const;
+		/** removes the entries read least recently until the budget is met, called locked */
+		void prune();
+
+		QString __dir;
+		long long __budget;
+		mutable std::mutex __mutex;
+		long long __size;
+		int __hits;
+		int __misses;
+};
+
+};
+
+#endif // H2C_SAMPLE_DISK_CACHE_H
+
+/* vim: set softtabstop=4 noexpandtab: */
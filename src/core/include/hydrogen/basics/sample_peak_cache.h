@@ -0,0 +1,146 @@
+/*
+ * Hydrogen
+ * Copyright(c) 2002-2008 by Alex >Comix< Cominu [comix@users.sourceforge.net]
+ *
+ * http://www.hydrogen-music.org
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY, without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ */
+
+
+#ifndef H2C_SAMPLE_PEAK_CACHE_H
+#define H2C_SAMPLE_PEAK_CACHE_H
+
+#include <atomic>
+#include <cassert>
+#include <deque>
+#include <map>
+#include <memory>
+#include <pthread.h>
+
+#include <hydrogen/object.h>
+
+namespace H2Core
+{
+
+class Sample;
+class SampleData;
+class SamplePeaks;
+
+/**
+ * Process-wide cache of the SamplePeaks the waveform displays draw.
+ *
+ * The peaks are computed by a thread of their own, which pushes
+ * #EVENT_SAMPLE_PEAKS_READY once they are ready, and stored by the
+ * SampleDiskCache beside the data they summarize, so a sample is
+ * only summarized once. They are identified by the key of their data,
+ * see Sample::get_data_key().
+ */
+class SamplePeakCache : public H2Core::Object
+{
+		H2_OBJECT
+	public:
+		/**
+		 * If #__instance equals 0, a new SamplePeakCache
+		 * singleton will be created and stored in it.
+		 *
+		 * It is called in Hydrogen::create_instance().
+		 */
+		static void create_instance();
+		/**
+		 * Returns a pointer to the current SamplePeakCache
+		 * singleton stored in #__instance.
+		 */
+		static SamplePeakCache* get_instance() { assert(__instance); return __instance; }
+		/** \return true once create_instance() was called */
+		static bool has_instance() { return __instance != nullptr; }
+
+		/**
+		 * constructor
+		 * \param entries the number of peaks kept in memory
+		 */
+		SamplePeakCache( int entries );
+		/** stops the computation in progress */
+		~SamplePeakCache();
+
+		/**
+		 * \return the peaks of the data of \a sample, nullptr if
+		 * they are not computed yet or can not be
+		 */
+		std::shared_ptr<SamplePeaks> get( const Sample* sample );
+		/**
+		 * \return the peaks of the sample file \a filepath,
+		 * which is not decoded for the purpose, nullptr if they
+		 * are not computed yet or can not be
+		 */
+		std::shared_ptr<SamplePeaks> get( const QString& filepath );
+
+	private:
+		/**
+		 * Object holding the current SamplePeakCache singleton.
+		 * It is initialized with NULL, set with
+		 * create_instance(), and accessed with get_instance().
+		 */
+		static SamplePeakCache* __instance;
+
+		/** peaks to compute */
+		struct Job {
+			QString key;
+			QString filepath;                       ///< the file to read if there is no #data
+			std::shared_ptr<SampleData> data;       ///< the data to summarize, may be nullptr
+			int frames;                             ///< the number of frames expected, negative if unknown
+		};
+		struct Entry {
+			std::shared_ptr<SamplePeaks> peaks;     ///< nullptr if they could not be computed
+			int frames;                             ///< Job::frames
+			int last_use;
+			bool pending;                           ///< the peaks are being computed
+		};
+
+		/**
+		 * look for the peaks of a key
+		 * \param key the key of the data
+		 * \param frames the number of frames of the data,
+		 * negative if unknown
+		 * \param peaks receives the peaks found
+		 * \return false if the peaks have to be computed
+		 */
+		bool find( const QString& key, int frames, std::shared_ptr<SamplePeaks>* peaks );
+		/** queue \a job, starting #__thread if needed */
+		void queue( const Job& job );
+		/** entry point of #__thread */
+		static void* worker_thread( void* pParam );
+		/** computes the queued peaks until asked to stop */
+		void work();
+		/** removes the entries used least recently, called locked */
+		void evict();
+
+		int __entries_max;
+		std::map<QString, Entry> __entries;
+		std::deque<Job> __jobs;
+		int __use;                                  ///< the last Entry::last_use
+		pthread_mutex_t __mutex;
+		pthread_cond_t __cond;
+		pthread_t __thread;
+		bool __started;                             ///< __thread has to be joined
+		std::atomic<bool> __quit;
+};
+
+};
+
+#endif // H2C_SAMPLE_PEAK_CACHE_H
+
+/* vim: set softtabstop=4 noexpandtab: */
@@ -0,0 +1,155 @@
+/*
+ * Hydrogen
+ * Copyright(c) 2002-2008 by Alex >Comix< Cominu [comix@users.sourceforge.net]
+ *
+ * http://www.hydrogen-music.org
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY, without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ */
+
+
+#ifndef H2C_SAMPLE_PEAKS_H
+#define H2C_SAMPLE_PEAKS_H
+
+#include <atomic>
+#include <memory>
+#include <vector>
+
+#include <hydrogen/object.h>
+
+class QIODevice;
+
+namespace H2Core
+{
+
+class SampleData;
+
+/**
+ * SamplePeaks summarizes the frames of a sample for drawing its
+ * waveform at any zoom level.
+ *
+ * Each channel is summarized by a pyramid of levels: a peak of the
+ * first level holds the minimum, maximum and RMS of up to
+ * #MAX_BUCKET_FRAMES frames, a peak of each following level those of
+ * two peaks of the level below. The first level of a short sample
+ * holds at least #MIN_BUCKETS peaks, so its whole waveform is drawn
+ * at full detail. A query picks the coarsest level still finer than
+ * the requested resolution, so drawing a waveform takes a time
+ * proportional to its width rather than to the length of the sample.
+ *
+ * The peaks are computed once, see SamplePeakCache, and never
+ * changed afterwards.
+ */
+class SamplePeaks : public H2Core::Object
+{
+		H2_OBJECT
+	public:
+		/** largest number of frames summarized by a peak of the first level */
+		static const int MAX_BUCKET_FRAMES = 64;
+		/** smallest number of peaks of the first level, unless there are less frames */
+		static const int MIN_BUCKETS = 2048;
+
+		/** summary of a range of frames of a channel */
+		struct Peak {
+			float min;
+			float max;
+			float rms;
+		};
+
+		/**
+		 * constructor, see compute()
+		 * \param frames the number of frames summarized
+		 * \param channels 1 if both channels are the same, 2 otherwise
+		 */
+		SamplePeaks( int frames, int channels );
+		~SamplePeaks();
+
+		/**
+		 * summarizes \a data
+		 * \param cancel stops the computation once set, may be nullptr
+		 * \return the peaks, nullptr if cancelled
+		 */
+		static std::shared_ptr<SamplePeaks> compute( const SampleData& data, const std::atomic<bool>* cancel = nullptr );
+		/**
+		 * summarizes the sample file \a filepath, read through
+		 * libsndfile a chunk at a time instead of being decoded
+		 * as a whole
+		 * \param cancel stops the computation once set, may be nullptr
+		 * \return the peaks, nullptr if the file could not be
+		 * read or the computation was cancelled
+		 */
+		static std::shared_ptr<SamplePeaks> compute( const QString& filepath, const std::atomic<bool>* cancel = nullptr );
+
+		/**
+		 * summarizes consecutive ranges of frames of a channel
+		 * \param channel 0 for the left channel, 1 for the right one
+		 * \param first the first frame of the first range, may be
+		 * negative or past the end, such ranges are empty
+		 * \param frames_per_peak the number of frames of each
+		 * range, ranges shorter than get_bucket_frames() are
+		 * summarized at the resolution of the first level
+		 * \param count the number of ranges
+		 * \param out receives \a count peaks
+		 */
+		void get_peaks( int channel, double first, double frames_per_peak, int count, Peak* out ) const;
+
+		/** \return the number of frames summarized */
+		int get_frames() const { return __frames; }
+		/** \return 1 if both channels are the same, 2 otherwise */
+		int get_channels() const { return __channels; }
+		/** \return the number of frames summarized by a peak of the first level */
+		int get_bucket_frames() const { return __bucket_frames; }
+		/** \return the number of levels of the pyramids */
+		int get_levels() const { return __levels[ 0 ].size(); }
+		/** \return the size of the peaks in bytes */
+		long long get_size() const;
+
+		/**
+		 * writes the peaks to \a device, to be read back by read()
+		 * \return true on success
+		 */
+		bool write( QIODevice* device ) const;
+		/** \return the peaks written by write(), nullptr if \a device holds none */
+		static std::shared_ptr<SamplePeaks> read( QIODevice* device );
+
+	private:
+		/** adds \a count frames to the first level */
+		void append( const float* data_l, const float* data_r, int count );
+		/** summarizes the last frames appended and builds the other levels */
+		void finish();
+		/** \return the number of frames a peak at \a idx of \a level summarizes */
+		int get_peak_frames( int level, int idx ) const;
+
+		/** a peak of the first level being summarized */
+		struct Bucket {
+			float min;
+			float max;
+			double sum;             ///< sum of the squares of the frames
+		};
+
+		int __frames;
+		int __channels;
+		int __bucket_frames;                            ///< see get_bucket_frames()
+		std::vector<std::vector<Peak>> __levels[ 2 ];   ///< the pyramid of each channel, the first level first
+		Bucket __bucket[ 2 ];                           ///< see append()
+		int __appended;                                 ///< frames appended so far
+};
+
+};
+
+#endif // H2C_SAMPLE_PEAKS_H
+
+/* vim: set softtabstop=4 noexpandtab: */
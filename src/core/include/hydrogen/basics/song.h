@@ -46,6 +46,7 @@ class Song;
 class DrumkitComponent;
 class PatternList;
 class AutomationPath;
+class XMLStreamReader;
 
 /**
 \ingroup H2CORE
@@ -418,13 +419,42 @@ class SongReader : public H2Core::Object
 		SongReader();
 		~SongReader();
 		const QString getPath( const QString& filename );
+		/**
+		 * Reads a song in a single pass. The patterns, which hold
+		 * nearly all the elements of a song, are built while the
+		 * file is read, the other sections are copied into a
+		 * small document and read from there.
+		 *
+		 * Binary songs, see SongBinary, are read from their
+		 * mapping instead.
+		 * \return nullptr on error
+		 */
 		Song* readSong( const QString& filename );
+		/**
+		 * Reads a song from a document holding the whole file.
+		 * Slower than readSong() on large songs, it is kept to
+		 * compare both.
+		 * \return nullptr on error
+		 */
+		Song* readSongDocument( const QString& filename );
 
 	private:
 		QString m_sSongVersion;
 
+		/**
+		 * builds the song out of \a songNode
+		 * \param patterns the patterns already read by readSong(),
+		 * their notes are not mapped to the instruments yet. They
+		 * are owned by the song or deleted on error. If nullptr,
+		 * they are read from \a songNode.
+		 */
+		Song* readSongNode( QDomNode songNode, PatternList* patterns, const QString& filename );
 		/// Dato un XmlNode restituisce un oggetto Pattern
 		Pattern* getPattern( QDomNode pattern, InstrumentList* instrList );
+		/// reads the pattern \a reader is on, the notes keep their instrument id only
+		Pattern* readPattern( XMLStreamReader& reader );
+		/// reads a song encoded by SongBinary::encode()
+		Song* readSongBinary( const QString& filename );
 };
 
 };
@@ -0,0 +1,112 @@
+/*
+ * Hydrogen
+ * Copyright(c) 2002-2008 by Alex >Comix< Cominu [comix@users.sourceforge.net]
+ *
+ * http://www.hydrogen-music.org
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY, without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ */
+
+#ifndef H2C_SONG_BINARY_H
+#define H2C_SONG_BINARY_H
+
+#include <QtCore/QFile>
+#include <QtXml/QDomDocument>
+
+#include <hydrogen/object.h>
+
+namespace H2Core
+{
+
+class Pattern;
+class Song;
+
+/**
+ * Binary song file, written instead of the XML one when the file name
+ * ends with Filesystem::songs_bin_ext.
+ *
+ * The file starts with a header and a table of chunks, each one
+ * identified by four characters:
+ * - "XML " the song document without its patternList, holding the
+ *   instruments, the sequence, the timeline and the automation
+ *   paths, read by SongReader like any other song
+ * - "PATS" one fixed size record per pattern, pointing at its
+ *   strings and at its notes
+ * - "STRS" the UTF-8 strings of the patterns
+ * - "NOTE" one fixed size record per note, the notes of a pattern
+ *   being contiguous
+ *
+ * The file is mapped and the records are read in place, a pattern
+ * can be read without the others. Unknown chunks are skipped, new
+ * ones can be added without changing the version.
+ */
+class SongBinary : public H2Core::Object
+{
+		H2_OBJECT
+	public:
+		SongBinary();
+		~SongBinary();
+
+		/** \return true if \a filename starts with the binary song header */
+		static bool is_binary( const QString& filename );
+		/**
+		 * \return the content of a binary song file holding \a song
+		 * \param doc the song document, without its patternList
+		 * \param song the song holding the patterns
+		 */
+		static QByteArray encode( const QDomDocument& doc, Song* song );
+
+		/**
+		 * maps \a filename and checks its chunks
+		 * \return true on success
+		 */
+		bool open( const QString& filename );
+		/**
+		 * parses the XML chunk into \a doc
+		 * \return true on success
+		 */
+		bool read_document( QDomDocument& doc ) const;
+		/** \return the number of patterns */
+		int get_pattern_count() const { return __pattern_count; }
+		/** \return the name of the pattern at \a idx */
+		QString get_pattern_name( int idx ) const;
+		/**
+		 * builds the pattern at \a idx and its notes, which keep
+		 * their instrument id only, see Note::map_instrument()
+		 */
+		Pattern* read_pattern( int idx ) const;
+
+	private:
+		/** \return the UTF-8 string at \a offset in the string chunk */
+		QString read_string( quint32 offset, quint32 size ) const;
+
+		QFile __file;
+		const uchar* __map;
+		const char* __xml;
+		qint64 __xml_size;
+		const uchar* __patterns;
+		int __pattern_count;
+		const char* __strings;
+		qint64 __strings_size;
+		const uchar* __notes;
+		qint64 __note_count;
+};
+
+};
+
+#endif // H2C_SONG_BINARY_H
+
+/* vim: set softtabstop=4 noexpandtab: */
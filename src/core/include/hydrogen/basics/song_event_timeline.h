@@ -0,0 +1,161 @@
+/*
+ * Hydrogen
+ * Copyright(c) 2002-2008 by Alex >Comix< Cominu [comix@users.sourceforge.net]
+ *
+ * http://www.hydrogen-music.org
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY, without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ */
+
+
+#ifndef H2C_SONG_EVENT_TIMELINE_H
+#define H2C_SONG_EVENT_TIMELINE_H
+
+#include <vector>
+
+#include <hydrogen/object.h>
+
+namespace H2Core
+{
+
+class Song;
+class Pattern;
+class PatternList;
+
+/**
+ * SongEventTimeline is a compiled, tick sorted view of the pattern
+ * group sequence of a Song, used by the audio engine in song mode.
+ *
+ * Each column of the song is flattened (virtual patterns included)
+ * once and the ticks holding notes are stored in a sorted array, so
+ * the engine only has to advance a cursor instead of scanning every
+ * pattern at every tick. The notes themselves are looked up in the
+ * SongSnapshot the timeline is part of when they are played.
+ *
+ * Columns are compiled again only when their PatternList or one of
+ * their patterns got a new revision (see Pattern::get_revision()).
+ * This happens in the threads editing the song, each snapshot
+ * starting from a copy of the timeline of the previous one.
+ */
+class SongEventTimeline : public H2Core::Object
+{
+		H2_OBJECT
+	public:
+		/** a tick of a column holding notes of one of its patterns */
+		struct Event {
+			int tick;                       ///< position relative to the start of the column
+			int pattern;                    ///< index within Column::patterns
+		};
+
+		/** compiled form of one PatternList of the pattern group sequence */
+		struct Column {
+			PatternList* list;              ///< the source pattern list
+			int list_revision;              ///< revision of #list when compiled
+			int start_tick;                 ///< first tick of the column within the song
+			int length;                     ///< length of the column in ticks
+			std::vector<Pattern*> patterns; ///< the patterns and their flattened virtual patterns, in playback order
+			std::vector<int> revisions;     ///< revisions of #patterns when compiled
+			std::vector<Event> events;      ///< events sorted by tick
+		};
+
+		/** constructor */
+		SongEventTimeline();
+		/** copy constructor, the lookup cursor is not copied */
+		SongEventTimeline( const SongEventTimeline& other );
+		/** destructor */
+		~SongEventTimeline();
+
+		/**
+		 * bring the timeline in line with the given song, only
+		 * the columns which changed are compiled again
+		 * \param song the song to follow
+		 * \return true if anything had to be compiled
+		 */
+		bool update( Song* song );
+		/** forget the current song and all compiled columns */
+		void clear();
+
+		/** returns the number of columns */
+		int size() const;
+		/** returns the total length of the song in ticks */
+		int get_song_size() const;
+		/**
+		 * get a compiled column
+		 * \param idx the index of the column
+		 * \return nullptr if out of bounds
+		 */
+		const Column* get_column( int idx ) const;
+
+		/**
+		 * find the column playing at a given tick, starting the
+		 * search at the column found by the previous call
+		 * \param tick the tick to look for
+		 * \param loop_mode if true, ticks past the end of the song wrap around
+		 * \param start_tick receives the first tick of the found column
+		 * \param song_size receives the song size if the tick had
+		 * to be wrapped, 0 otherwise
+		 * \return the index of the column, -1 if not found
+		 */
+		int find_column( int tick, bool loop_mode, int* start_tick, int* song_size );
+		/**
+		 * get the events of a column at a given tick. Consecutive
+		 * ticks are served by advancing an internal cursor.
+		 * \param column the index of the column
+		 * \param tick the position within the column
+		 * \param first receives the index of the first event
+		 * \param last receives the index past the last event
+		 */
+		void get_events( int column, int tick, int* first, int* last );
+
+	private:
+		Song* __song;                       ///< the song the timeline was compiled from
+		int __revision;                     ///< Pattern::get_last_revision() at the last update
+		int __song_size;                    ///< total length in ticks
+		std::vector<Column> __columns;      ///< the compiled columns
+		int __cursor_column;                ///< column of the last lookup
+		int __cursor_event;                 ///< event following the last lookup
+
+		/** returns true if the column is still in line with its pattern list */
+		static bool is_up_to_date( const Column& column, PatternList* list );
+		/** compile a column from a pattern list */
+		static void compile( Column* column, PatternList* list );
+};
+
+// DEFINITIONS
+
+inline int SongEventTimeline::size() const
+{
+	return __columns.size();
+}
+
+inline int SongEventTimeline::get_song_size() const
+{
+	return __song_size;
+}
+
+inline const SongEventTimeline::Column* SongEventTimeline::get_column( int idx ) const
+{
+	if ( idx < 0 || idx >= ( int )__columns.size() ) {
+		return nullptr;
+	}
+	return &__columns[ idx ];
+}
+
+};
+
+#endif // H2C_SONG_EVENT_TIMELINE_H
+
+/* vim: set softtabstop=4 noexpandtab: */
@@ -0,0 +1,146 @@
+/*
+ * Hydrogen
+ * Copyright(c) 2002-2008 by Alex >Comix< Cominu [comix@users.sourceforge.net]
+ *
+ * http://www.hydrogen-music.org
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY, without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ */
+
+#ifndef H2C_SONG_SNAPSHOT_H
+#define H2C_SONG_SNAPSHOT_H
+
+#include <atomic>
+#include <map>
+#include <memory>
+#include <vector>
+
+#include <hydrogen/object.h>
+#include <hydrogen/basics/song_event_timeline.h>
+
+namespace H2Core
+{
+
+class Note;
+class Pattern;
+class Song;
+
+/**
+ * SongSnapshot is a versioned copy of the notes of a Song, which the
+ * audio engine plays from instead of the patterns themselves.
+ *
+ * Snapshots are built by the threads editing the song, published by
+ * the AudioEngine and never changed once published, so the audio
+ * thread can read them without taking AudioEngine::lock(). The
+ * notes of a pattern are copied once per revision of the pattern
+ * (see Pattern::get_revision()) and shared by the following
+ * snapshots until the pattern changes again.
+ *
+ * The SongEventTimeline of a snapshot is the only part the audio
+ * thread writes to, its lookup cursor.
+ */
+class SongSnapshot : public H2Core::Object
+{
+		H2_OBJECT
+	public:
+		/** the notes of one pattern, as of one of its revisions */
+		class PatternNotes
+		{
+			public:
+				/** copies the notes of \a pattern */
+				PatternNotes( const Pattern* pattern );
+				~PatternNotes();
+
+				/**
+				 * get the notes found at a given tick
+				 * \param tick the position within the pattern
+				 * \param first receives the index of the first note
+				 * \param last receives the index past the last note
+				 */
+				void get_range( int tick, int* first, int* last ) const;
+				/** \return the copy of the note at \a idx */
+				Note* get_note( int idx ) const { return __notes[ idx ]; }
+				/**
+				 * \return true if the note at \a idx got recorded
+				 * and was not played since, see Note::get_just_recorded()
+				 */
+				bool is_just_recorded( int idx ) const;
+				/**
+				 * called by the audio thread when it plays the note
+				 * at \a idx, which is no longer just recorded then
+				 */
+				void set_played( int idx ) const;
+				/**
+				 * hand the played state of the notes back to the
+				 * notes of \a pattern they were copied from,
+				 * called with AudioEngine::lock_song() held
+				 */
+				void sync_played( Pattern* pattern ) const;
+
+				int get_revision() const { return __revision; }
+				int size() const { return __notes.size(); }
+
+			private:
+				int __revision;                     ///< revision of the pattern when copied
+				std::vector<int> __ticks;           ///< position of each note, sorted
+				std::vector<Note*> __notes;         ///< the copies, owned
+				std::vector<const Note*> __sources; ///< the notes they were copied from, only compared
+				std::unique_ptr<std::atomic<bool>[]> __played; ///< see set_played()
+				mutable std::atomic<bool> __played_any; ///< one of #__played is set
+		};
+
+		/**
+		 * compile a snapshot of \a song
+		 * \param song the song to copy, may be nullptr
+		 * \param previous the snapshot of the same song to reuse
+		 * the unchanged patterns of, may be nullptr
+		 * \param version the version of the new snapshot
+		 */
+		SongSnapshot( Song* song, const SongSnapshot* previous, int version );
+		~SongSnapshot();
+
+		/** \return the version handed to the constructor */
+		int get_version() const { return __version; }
+		/** \return false if it holds the same notes as the previous snapshot */
+		bool has_changed() const { return __changed; }
+		/**
+		 * \return the notes of \a pattern, nullptr if it is not
+		 * part of the song
+		 */
+		const PatternNotes* get_notes( const Pattern* pattern ) const;
+		/** \return the compiled pattern group sequence */
+		SongEventTimeline* get_timeline() { return &__timeline; }
+		/**
+		 * hand the played state of all the notes back to the
+		 * song, called with AudioEngine::lock_song() held
+		 */
+		void sync_played() const;
+
+	private:
+		typedef std::map<const Pattern*, std::shared_ptr<PatternNotes> > notes_map_t;
+
+		int __version;
+		bool __changed;
+		Song* __song;
+		notes_map_t __notes;
+		SongEventTimeline __timeline;
+};
+
+};
+
+#endif // H2C_SONG_SNAPSHOT_H
+
+/* vim: set softtabstop=4 noexpandtab: */
@@ -0,0 +1,117 @@
+/*
+ * Hydrogen
+ * Copyright(c) 2002-2008 by Alex >Comix< Cominu [comix@users.sourceforge.net]
+ *
+ * http://www.hydrogen-music.org
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY, without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ */
+
+#ifndef H2C_DRUMKIT_LOADER_H
+#define H2C_DRUMKIT_LOADER_H
+
+#include <atomic>
+#include <memory>
+#include <vector>
+#include <pthread.h>
+
+#include <hydrogen/object.h>
+
+namespace H2Core
+{
+
+class Drumkit;
+class DrumkitComponent;
+class InstrumentList;
+class SampleData;
+
+/**
+ * DrumkitLoader prepares the instruments and components of a drumkit
+ * away from the song, so that Hydrogen::loadDrumkit() only has to swap
+ * them in.
+ *
+ * The samples of all the layers are first decoded into the
+ * SampleCache by a pool of threads, then the instruments are built
+ * from the cached data. Nothing of the song nor of the audio engine is
+ * touched while doing so.
+ *
+ * run() does the work on the calling thread, start() on a thread of
+ * its own, which pushes #EVENT_DRUMKIT_LOAD_PROGRESS while the
+ * samples are decoded and #EVENT_DRUMKIT_LOADED once done.
+ */
+class DrumkitLoader : public H2Core::Object
+{
+		H2_OBJECT
+	public:
+		/**
+		 * \param pDrumkit the drumkit to load. It is copied, the
+		 * caller may delete it at once.
+		 * \param nThreads number of threads decoding the samples,
+		 * 0 for one per CPU
+		 */
+		DrumkitLoader( Drumkit* pDrumkit, int nThreads = 0 );
+		/** cancels a running load and deletes whatever was not taken */
+		~DrumkitLoader();
+
+		/** prepares the drumkit on the calling thread */
+		void run();
+		/**
+		 * prepares the drumkit on a thread of its own
+		 * \return false if the thread could not be created
+		 */
+		bool start();
+		/** asks a running load to stop, it does not notify its end */
+		void cancel();
+		/** \return true once the instruments and components are prepared */
+		bool is_done() const;
+
+		/** \return the copy of the drumkit being loaded */
+		Drumkit* get_drumkit() const { return __drumkit; }
+		/** \return the prepared instruments, owned by the loader */
+		InstrumentList* get_instruments() const { return __instruments; }
+		/** \return the prepared components, owned by the loader */
+		std::vector<DrumkitComponent*>* get_components() { return &__components; }
+
+	private:
+		/** entry point of the thread created by start() */
+		static void* loader_thread( void* pParam );
+		/** entry point of the decoding threads */
+		static void* decoder_thread( void* pParam );
+		/** decodes the samples until there are none left */
+		void decode();
+
+		Drumkit* __drumkit;
+		InstrumentList* __instruments;
+		std::vector<DrumkitComponent*> __components;
+		int __threads;
+		bool __notify;                          ///< push the progress events
+		pthread_t __thread;
+		bool __started;                         ///< __thread has to be joined
+		std::atomic<bool> __cancelled;
+		std::atomic<bool> __done;
+
+		std::vector<QString> __paths;           ///< the sample files of all the layers
+		/** keeps the decoded data in the cache until the instruments use it */
+		std::vector<std::shared_ptr<SampleData>> __decoded;
+		std::atomic<int> __next;                ///< next entry of #__paths to decode
+		std::atomic<int> __decoded_count;
+};
+
+};
+
+#endif // H2C_DRUMKIT_LOADER_H
+
+/* vim: set softtabstop=4 noexpandtab: */
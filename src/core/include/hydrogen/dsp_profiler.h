@@ -0,0 +1,139 @@
+/*
+ * Hydrogen
+ * Copyright(c) 2002-2008 by Alex >Comix< Cominu [comix@users.sourceforge.net]
+ *
+ * http://www.hydrogen-music.org
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY, without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ */
+
+#ifndef H2C_DSP_PROFILER_H
+#define H2C_DSP_PROFILER_H
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+
+#include <hydrogen/object.h>
+
+namespace H2Core
+{
+
+/**
+ * DspProfiler keeps the durations of the stages of
+ * audioEngine_process() over the last #WINDOW process cycles.
+ *
+ * The audio thread only stores the durations (taken from a
+ * monotonic clock) into fixed size rings of relaxed atomics, so
+ * recording never blocks nor allocates. The percentiles are
+ * computed by the reader, usually the GUI, from a copy of a ring.
+ *
+ * The durations of Sampler::process() are additionally collected in
+ * a histogram by the number of voices playing at the start of the
+ * cycle, to tell how the rendering scales with the polyphony.
+ */
+class DspProfiler : public H2Core::Object
+{
+		H2_OBJECT
+	public:
+		/** the stages of a process cycle */
+		enum Stage {
+			TRANSPORT,                      ///< audioEngine_process_transport()
+			NOTE_QUEUE,                     ///< audioEngine_updateNoteQueue()
+			PLAY_NOTES,                     ///< audioEngine_process_playNotes()
+			SAMPLER,                        ///< Sampler::process() and mixdown
+			SYNTH,                          ///< Synth::process() and mixdown
+			LADSPA,                         ///< all LADSPA slots
+			LADSPA_SLOT,                    ///< first of #MAX_FX single LADSPA slots
+			METERING = LADSPA_SLOT + MAX_FX,///< peak metering
+			TOTAL,                          ///< the whole process cycle
+			STAGES
+		};
+		/** number of cycles the percentiles are computed from */
+		static const int WINDOW = 1024;
+		/** voice count buckets: 0, 1, 2-3, 4-7, ... and 128 and more */
+		static const int VOICE_BUCKETS = 9;
+
+		/** timings of a stage in milliseconds */
+		struct Stats {
+			float p50;
+			float p99;
+			float max;
+			int samples;                    ///< cycles in the window
+		};
+		/** Sampler::process() timings of a voice count bucket */
+		struct VoiceBucket {
+			int min_voices;
+			int cycles;                     ///< cycles since the last reset
+			float mean;                     ///< milliseconds
+			float max;                      ///< milliseconds
+		};
+
+		typedef std::chrono::steady_clock Clock;
+
+		DspProfiler();
+		~DspProfiler();
+
+		/** \return a monotonic timestamp in nanoseconds */
+		static inline uint64_t now() {
+			return std::chrono::duration_cast<std::chrono::nanoseconds>(
+				Clock::now().time_since_epoch() ).count();
+		}
+
+		/**
+		 * store the duration of a stage, real-time safe
+		 * \param stage the profiled stage
+		 * \param start_ns timestamp taken by now() at the start of the stage
+		 * \param end_ns timestamp taken by now() at the end of the stage
+		 */
+		void record( int stage, uint64_t start_ns, uint64_t end_ns );
+		/**
+		 * store the duration of Sampler::process() in the histogram, real-time safe
+		 * \param voices number of voices playing at the start of the cycle
+		 * \param start_ns timestamp taken by now() at the start of the stage
+		 * \param end_ns timestamp taken by now() at the end of the stage
+		 */
+		void record_voices( int voices, uint64_t start_ns, uint64_t end_ns );
+		/** \return the last duration of a stage in milliseconds */
+		float get_last( int stage ) const;
+		/** \return p50, p99 and max of a stage over the window */
+		Stats get_stats( int stage ) const;
+		/** \return the Sampler::process() timings of a voice count bucket */
+		VoiceBucket get_voice_bucket( int bucket ) const;
+		/** forget all the timings, cycles recorded meanwhile may partly survive */
+		void reset();
+
+		/** \return the name of a stage, the same for all the LADSPA slots */
+		static const char* stage_name( int stage );
+
+	private:
+		struct Ring {
+			std::atomic<uint32_t> ns[ WINDOW ];
+			std::atomic<unsigned> count;    ///< number of durations written
+		};
+		struct Bucket {
+			std::atomic<unsigned> cycles;
+			std::atomic<uint64_t> total_ns;
+			std::atomic<uint32_t> max_ns;
+		};
+
+		Ring __rings[ STAGES ];
+		Bucket __voice_buckets[ VOICE_BUCKETS ];
+};
+
+};
+
+#endif // H2C_DSP_PROFILER_H
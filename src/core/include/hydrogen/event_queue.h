@@ -24,11 +24,12 @@
 #define EVENT_QUEUE_H
 
 #include <hydrogen/object.h>
+#include <hydrogen/mpsc_ring.h>
 #include <hydrogen/basics/note.h>
 #include <cassert>
 
 /** Maximum number of events to be stored in the
-    H2Core::EventQueue::__events_buffer.*/
+    H2Core::EventQueue::__events. Has to be a power of two.*/
 #define MAX_EVENTS 1024
 
 namespace H2Core
@@ -103,6 +104,13 @@ enum EventType {
 	EVENT_METRONOME,
 	EVENT_RECALCULATERUBBERBAND,
 	EVENT_PROGRESS,
+	/** Sent by the DiskWriterDriver along with #EVENT_PROGRESS. Its
+	 * value is the number of frames rendered per second since the
+	 * start of the export.
+	 *
+	 * Handled by EventListener::progressRateEvent().
+	 */
+	EVENT_PROGRESS_RATE,
 	EVENT_JACK_SESSION,
 	EVENT_PLAYLIST_LOADSONG,
 	EVENT_UNDO_REDO,
@@ -119,6 +127,26 @@ enum EventType {
 	 *       (updated the title and status bar).
 	 */
 	EVENT_UPDATE_SONG,
+	/** Sent by the DrumkitLoader started by
+	 * Hydrogen::loadDrumkitAsync() while decoding the samples. Its
+	 * value is the percentage of samples decoded.
+	 *
+	 * Handled by EventListener::drumkitLoadProgressEvent().
+	 */
+	EVENT_DRUMKIT_LOAD_PROGRESS,
+	/** Sent by the DrumkitLoader started by
+	 * Hydrogen::loadDrumkitAsync() once the drumkit is ready to be
+	 * swapped in by Hydrogen::finishDrumkitLoad().
+	 *
+	 * Handled by EventListener::drumkitLoadedEvent().
+	 */
+	EVENT_DRUMKIT_LOADED,
+	/** Sent by the SamplePeakCache whenever the peaks of a sample
+	 * are ready to be drawn.
+	 *
+	 * Handled by EventListener::samplePeaksReadyEvent().
+	 */
+	EVENT_SAMPLE_PEAKS_READY,
 	/**
 	 * Triggering HydrogenApp::quitEvent() and enables a shutdown of
 	 * the entire application via the command line.
@@ -173,37 +201,50 @@ public:/**
 	/**
 	 * Queues the next event into the EventQueue.
 	 *
-	 * The event itself will be constructed inside the function
-	 * and will be two properties: an EventType @a type and a
-	 * value @a nValue. Since the event written to the queue most
-	 * recently is indexed with #__write_index, this variable is
-	 * incremented once and its modulo with respect to #MAX_EVENTS
-	 * is calculated to determine the position of insertion into
-	 * #__events_buffer.
+	 * It is safe to call from any number of threads at once and
+	 * does neither lock nor allocate, so the audio and MIDI
+	 * threads can use it, see MpscRing.
 	 *
-	 * The modulo operation is necessary because #__write_index
-	 * will be only incremented and does not respect the actual
-	 * length of #__events_buffer itself.
+	 * If the queue is full, the event is dropped and counted
+	 * instead of overwriting events the consumer did not read
+	 * yet.
 	 *
 	 * \param type Type of the event, which will be queued.
 	 * \param nValue Value specifying the content of the new event.
+	 * \return false if the event was dropped.
 	 */
-	void push_event( const EventType type, const int nValue );
+	bool push_event( const EventType type, const int nValue );
 	/**
 	 * Reads out the next event of the EventQueue.
 	 *
-	 * Since the event read out most recently is indexed with
-	 * #__read_index, this variable is incremented once and its
-	 * modulo with respect to #MAX_EVENTS is calculated to
-	 * determine the event returned from #__events_buffer. 
-	 *
-	 * The modulo operation is necessary because #__read_index
-	 * will be only incremented and does not respect the actual
-	 * length of #__events_buffer itself.
+	 * There must only be one consumer at a time, usually
+	 * HydrogenApp::onEventQueueTimer().
 	 *
-	 * \return Next event in line.
+	 * \return Next event in line or an event of type
+	 * #H2Core::EVENT_NONE if the queue is empty.
 	 */
 	Event pop_event();
+	/**
+	 * Reads out up to \a nMax events at once.
+	 *
+	 * \param pEvents Array of at least \a nMax events to fill.
+	 * \param nMax Maximum number of events to read.
+	 * \return Number of events written to \a pEvents.
+	 */
+	int pop_events( Event* pEvents, int nMax );
+
+	/** \return Number of events dropped because the queue was full. */
+	unsigned get_dropped_events() const {
+		return __events.get_dropped();
+	}
+	/** \return Largest number of events waiting in the queue so far. */
+	unsigned get_high_water_mark() const {
+		return __events.get_high_water_mark();
+	}
+	/** Resets the high water mark to the current number of events. */
+	void reset_high_water_mark() {
+		__events.reset_high_water_mark();
+	}
 
 	struct AddMidiNoteVector {
 		int m_column;       //position
@@ -225,8 +266,7 @@ private:
 	/**
 	 * Constructor of the EventQueue class.
 	 *
-	 * It fills all #MAX_EVENTS slots of the #__events_buffer with
-	 * #H2Core::EVENT_NONE and assigns itself to #__instance. Called by
+	 * It assigns itself to #__instance. Called by
 	 * create_instance().
 	 */
 	EventQueue();
@@ -237,27 +277,8 @@ private:
 	 */
 	static EventQueue *__instance;
 
-	/**
-	 * Continuously growing number indexing the event, which has
-	 * been read from the EventQueue most recently.
-	 *
-	 * It is incremented with each call to pop_event(). 
-	 */
-	unsigned int __read_index;
-	/**
-	 * Continuously growing number indexing the event, which has
-	 * been written to the EventQueue most recently.
-	 *
-	 * It is incremented with each call to push_event(). 
-	 */
-	unsigned int __write_index;
-	/**
-	 * Array of all events contained in the EventQueue.
-	 *
-	 * Its length is set to #MAX_EVENTS and it gets initialized
-	 * with #H2Core::EVENT_NONE in EventQueue().
-	 */
-	Event __events_buffer[ MAX_EVENTS ];
+	/** All events contained in the EventQueue. */
+	MpscRing<Event, MAX_EVENTS> __events;
 };
 
 };
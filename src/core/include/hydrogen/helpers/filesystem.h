@@ -24,6 +24,8 @@ class Filesystem : public H2Core::Object
 			is_executable=0x10
 		};
 		static const QString songs_ext;
+		/** extension of the songs saved with SongBinary */
+		static const QString songs_bin_ext;
 		static const QString scripts_ext;
 		static const QString patterns_ext;
 		static const QString playlist_ext;
@@ -4,6 +4,8 @@
 
 #include <hydrogen/object.h>
 #include <QtCore/QString>
+#include <QtCore/QFile>
+#include <QtCore/QXmlStreamReader>
 #include <QtXml/QDomDocument>
 
 namespace H2Core
@@ -151,6 +153,65 @@ class XMLDoc : public H2Core::Object, public QDomDocument
 		XMLNode set_root( const QString& node_name, const QString& xmlns = nullptr );
 };
 
+/**
+ * XMLStreamReader is a QXmlStreamReader reading a file in a single
+ * forward pass, without building a document.
+ *
+ * The elements are visited with readNextStartElement(), which stops
+ * at the end of the current element, their values are read with the
+ * read_* methods. A small element can still be copied into a
+ * QDomDocument with read_element() to be handed over to the XMLNode
+ * based loaders.
+*/
+class XMLStreamReader : public H2Core::Object, public QXmlStreamReader
+{
+		H2_OBJECT
+	public:
+		/** basic constructor */
+		XMLStreamReader( );
+		/**
+		 * open an xml file, converting the files of the TinyXML
+		 * days as LocalFileMng::openXmlDocument() does
+		 * \param filepath the path to the file to read from
+		 */
+		bool open( const QString& filepath );
+		/**
+		 * reads the text of the current element and moves past its end
+		 * \param default_value the value returned if the element is empty
+		 */
+		QString read_string( const QString& default_value );
+		/**
+		 * reads an integer from the text of the current element and moves past its end
+		 * \param default_value the value returned if the element is empty
+		 */
+		int read_int( int default_value );
+		/**
+		 * reads a float from the text of the current element and moves past its end
+		 * \param default_value the value returned if the element is empty
+		 */
+		float read_float( float default_value );
+		/**
+		 * reads a boolean from the text of the current element and moves past its end
+		 * \param default_value the value returned if the element is empty
+		 */
+		bool read_bool( bool default_value );
+		/**
+		 * copies the current element and its content into \a doc
+		 * and moves past its end
+		 * \param doc the document owning the copy
+		 * \return the copy, not appended to any node yet
+		 */
+		QDomElement read_element( QDomDocument& doc );
+		/**
+		 * logs the parse error, if any, with its position
+		 * \return true if there was an error
+		 */
+		bool report_error();
+	private:
+		QFile __file;
+		QString __filepath;
+};
+
 };
 
 #endif  // H2C_XML_H
@@ -29,12 +29,16 @@
 #include <hydrogen/basics/sample.h>
 #include <hydrogen/object.h>
 #include <hydrogen/timeline.h>
+#include <hydrogen/dsp_profiler.h>
+#include <hydrogen/meters.h>
+#include <hydrogen/drumkit_loader.h>
 #include <hydrogen/IO/AudioOutput.h>
 #include <hydrogen/IO/MidiInput.h>
 #include <hydrogen/IO/MidiOutput.h>
 #include <hydrogen/basics/drumkit.h>
 #include <hydrogen/core_action_controller.h>
 #include <cassert>
+#include <map>
 #include <hydrogen/timehelper.h>
 // Engine states  (It's ok to use ==, <, and > when testing)
 /**
@@ -198,6 +202,17 @@ public:
 
 		void			removeSong();
 
+		/**
+		 * Plays a note live, recording it into the current pattern
+		 * if Preferences::getRecordEvents() is set while playing.
+		 *
+		 * The note is heard through a RealtimeNoteQueue, starting
+		 * at the frame matching \a nTime one process cycle later.
+		 * The AudioEngine is only locked for recording.
+		 *
+		 * \param nTime RealtimeNoteQueue::now() when the note was
+		 * played, 0 for right now
+		 */
 		void			addRealtimeNote ( int instrument,
 							  float velocity,
 							  float pan_L=1.0,
@@ -205,16 +220,34 @@ public:
 							  float pitch=0.0,
 							  bool noteoff=false,
 							  bool forcePlay=false,
-							  int msg1=0 );
-
-		float			getMasterPeak_L();
-		void			setMasterPeak_L( float value );
-
-		float			getMasterPeak_R();
-		void			setMasterPeak_R( float value );
+							  int msg1=0,
+							  uint64_t nTime=0 );
+		/**
+		 * Releases notes played live, through the same queue as
+		 * addRealtimeNote() so it never overtakes a note played
+		 * before it.
+		 * \param instrument index of the instrument whose notes are
+		 * released
+		 * \param key MIDI key whose notes are released instead, -1
+		 * if none
+		 * \param nTime RealtimeNoteQueue::now() when the note was
+		 * released, 0 for right now
+		 * \param nLength length in ticks given to the note recorded
+		 * at \a nNoteOnTick by applyRecordedNoteLengths() if the
+		 * instrument still plays once the audio thread releases it,
+		 * -1 if none was recorded
+		 * \param nNoteOnTick position of the recorded note
+		 */
+		void			addRealtimeNoteOff( int instrument, int key, uint64_t nTime=0,
+											int nLength=-1, int nNoteOnTick=0 );
+		/**
+		 * Gives the recorded notes the lengths queued for them by
+		 * the audio thread, see addRealtimeNoteOff(). It waits for
+		 * AudioEngine::lock_song(), so it is called regularly by the
+		 * thread handling the events and never by the audio thread.
+		 */
+		void			applyRecordedNoteLengths();
 
-		void			getLadspaFXPeak( int nFX, float *fL, float *fR );
-		void			setLadspaFXPeak( int nFX, float fL, float fR );
 	/**
 	 * \return The global variable H2Core::m_nPatternTickPosition
 	 */
@@ -328,9 +361,50 @@ public:
 
 		float			getProcessTime();
 		float			getMaxProcessTime();
+		/** \return the per stage timings of the audio engine
+		 * process cycle, NULL while the engine is uninitialized */
+		DspProfiler*		getDspProfiler();
+		/** \return the levels of the mixer strips, published once
+		 * per process cycle, NULL while the engine is uninitialized */
+		Meters*			getMeters();
 
+		/**
+		 * Loads a drumkit into the current song.
+		 *
+		 * The samples are decoded by a DrumkitLoader, in parallel,
+		 * while the audio engine keeps playing the previous kit.
+		 * The new instruments are then swapped in with the
+		 * AudioEngine locked once.
+		 *
+		 * \param pDrumkitInfo the drumkit to load
+		 * \param conditional keep the instruments in excess of the
+		 * new kit which have notes
+		 * \return 0 on success
+		 */
 		int			loadDrumkit( Drumkit *pDrumkitInfo );
 		int			loadDrumkit( Drumkit *pDrumkitInfo, bool conditional );
+		/**
+		 * Starts loading a drumkit in the background, canceling a
+		 * load still running.
+		 *
+		 * #EVENT_DRUMKIT_LOAD_PROGRESS is pushed while the samples
+		 * are decoded and #EVENT_DRUMKIT_LOADED once the kit is
+		 * ready. finishDrumkitLoad() has then to be called by the
+		 * thread handling the events, as it changes the song.
+		 *
+		 * \param pDrumkitInfo the drumkit to load, the caller may
+		 * delete it at once
+		 * \param conditional see loadDrumkit()
+		 * \return false if the loading could not be started
+		 */
+		bool			loadDrumkitAsync( Drumkit *pDrumkitInfo, bool conditional );
+		/**
+		 * Swaps in the drumkit prepared since loadDrumkitAsync().
+		 * \return 0 on success, -1 if no drumkit is ready
+		 */
+		int			finishDrumkitLoad();
+		/** \return true while a drumkit is loaded in the background */
+		bool			isDrumkitLoading() const;
 
 		/** Test if an Instrument has some Note in the Pattern (used to
 		    test before deleting an Instrument)*/
@@ -545,6 +619,12 @@ void			previewSample( Sample *pSample );
 	void			startExportSession( int rate, int depth );
 	void			stopExportSession();
 	void			startExportSong( const QString& filename );
+	/**
+	 * Exports the song to \a filename and, in the same pass, the
+	 * part of it played by each instrument to the file \a stems
+	 * maps its id to. An empty \a filename exports the stems only.
+	 */
+	void			startExportSong( const QString& filename, const std::map<int, QString>& stems );
 	void			stopExportSong();
 	
 	CoreActionController* 	getCoreActionController() const;
@@ -626,6 +706,9 @@ private:
 	 */
 	void initBeatcounter();
 
+	/** queues a note played by addRealtimeNote() for the audio thread */
+	void queueRealtimeNote( int instrument, float velocity, float pan_L, float pan_R, int msg1, uint64_t nTime );
+
 	// beatcounter
 	float			m_ntaktoMeterCompute;	///< beatcounter note length
 	int			m_nbeatsToCount;	///< beatcounter beats to count
@@ -684,6 +767,21 @@ private:
 	/// Deleting instruments too soon leads to potential crashes.
 	std::list<Instrument*> 	__instrument_death_row; 
 
+	/** loader started by loadDrumkitAsync(), NULL if none */
+	DrumkitLoader*		m_pDrumkitLoader;
+	/** \a conditional argument of loadDrumkitAsync() */
+	bool			m_bDrumkitLoadConditional;
+
+	/**
+	 * Swaps the instruments and components prepared by \a
+	 * pLoader into the song.
+	 *
+	 * The instruments of the song are kept, the notes of the
+	 * patterns pointing to them, and take the components and
+	 * parameters of the new ones through Instrument::take_from().
+	 */
+	int publishDrumkit( DrumkitLoader* pLoader, bool conditional );
+
 	/** 
 	 * Constructor, entry point, and initialization of the
 	 * Hydrogen application.
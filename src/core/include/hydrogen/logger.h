@@ -23,15 +23,20 @@
 #ifndef H2C_LOGGER_H
 #define H2C_LOGGER_H
 
+#include <atomic>
 #include <cassert>
-#include <list>
+#include <cstdio>
 #include <pthread.h>
+#include <type_traits>
 
 #include "hydrogen/config.h"
 
 class QString;
 class QStringList;
 
+/** Maximum number of numeric arguments of a Logger::log_fmt() record. */
+#define LOGGER_MAX_ARGS 4
+
 namespace H2Core {
 
 /**
@@ -53,8 +58,17 @@ class Logger {
 			AELockTracing   = 0x20
 		};
 
-		/** message queue type */
-		typedef std::list<QString> queue_t;
+		/** numeric argument of a record written by log_fmt() */
+		struct Arg {
+			bool integer;
+			union {
+				long long n;
+				double f;
+			};
+		};
+
+		/** buffer of the records written by one thread, defined in logger.cpp */
+		class Ring;
 
 		/**
 		 * create the logger instance if not exists, set the log level and return the instance
@@ -110,7 +124,49 @@ class Logger {
 		 * \param func_name the name of the calling function/method
 		 * \param msg the message to log
 		 */
-		void log( unsigned level, const QString& class_name, const char* func_name, const QString& msg );
+		void log( unsigned level, const char* class_name, const char* func_name, const QString& msg );
+		/**
+		 * the real-time safe log function
+		 *
+		 * It neither locks nor allocates and only stores a compact
+		 * record, see register_thread() for the buffer of the
+		 * calling thread. \a format is
+		 * filled with \a args like QString::arg() would, by the
+		 * logger thread.
+		 *
+		 * \param level used to output the corresponding level string
+		 * \param class_name the name of the calling class
+		 * \param func_name the name of the calling function/method
+		 * \param format a string literal containing %1, %2, ...
+		 * \param args up to #LOGGER_MAX_ARGS numbers
+		 */
+		template<typename... Args>
+		void log_fmt( unsigned level, const char* class_name, const char* func_name, const char* format, Args... args ) {
+			static_assert( sizeof...( Args ) <= LOGGER_MAX_ARGS, "too many arguments to log" );
+			Arg argv[ sizeof...( Args ) + 1 ] = { to_arg( args )... };
+			push_record( level, class_name, func_name, format, nullptr, argv, sizeof...( Args ) );
+		}
+		/**
+		 * \return the number of records dropped because a buffer
+		 * was full or a real-time thread had none
+		 */
+		unsigned dropped_records() const            { return __dropped.load( std::memory_order_relaxed ); }
+		/**
+		 * Marks the calling thread as real-time and gives it its
+		 * buffer, allocated if need be. Called by the real-time
+		 * threads Hydrogen starts, before they enter their loop.
+		 *
+		 * A real-time thread never allocates a buffer when it logs,
+		 * its records are dropped if it has none. Threads with a
+		 * real-time scheduling policy count as real-time as well.
+		 */
+		void register_thread();
+		/**
+		 * Keeps \a n buffers spare for the real-time threads which
+		 * cannot call register_thread(), like those of the audio
+		 * drivers. The other threads do not take them.
+		 */
+		void reserve_rings( unsigned n );
 		/**
 		 * needed for being able to access logger internal
 		 * \param param is a pointer to the logger instance
@@ -126,15 +182,48 @@ class Logger {
 		 */
 		static Logger* __instance;
 		bool __use_file;                ///< write log to file if set to true
-		bool __running;                 ///< set to true when the logger thread is running
-		pthread_mutex_t __mutex;        ///< lock for adding or removing elements only
-		queue_t __msg_queue;            ///< the message queue
+		std::atomic<bool> __running;    ///< set to true when the logger thread is running
+		std::atomic<Ring*> __rings;     ///< buffers of all threads which logged so far
+		std::atomic<unsigned long long> __sequence;    ///< orders the records of all threads
+		std::atomic<unsigned> __dropped;///< records lost because a buffer was full
 		static unsigned __bit_msk;      ///< the bitmask of log_level_t
 		static const char* __levels[];  ///< levels strings
 
 		/** constructor */
 		Logger();
 
+		template<typename T>
+		static Arg to_arg( T value ) {
+			static_assert( std::is_arithmetic<T>::value || std::is_enum<T>::value, "only numbers can be logged" );
+			Arg arg;
+			arg.integer = !std::is_floating_point<T>::value;
+			if ( arg.integer ) {
+				arg.n = ( long long )value;
+			} else {
+				arg.f = ( double )value;
+			}
+			return arg;
+		}
+
+		/**
+		 * append a record to the buffer of the calling thread
+		 * \param msg message to log as is if \a format is nullptr
+		 */
+		void push_record( unsigned level, const char* class_name, const char* func_name,
+						  const char* format, const QString* msg, const Arg* args, int nArgs );
+		/**
+		 * the buffer of the calling thread, registered on first use
+		 * \return nullptr if a real-time thread found none to take
+		 */
+		Ring* thread_ring();
+		/** prepend \a ring to #__rings */
+		void add_ring( Ring* ring );
+		/**
+		 * format and write out the records of all threads
+		 * \return false if there was none
+		 */
+		bool flush( FILE* log_file );
+
 #ifndef HAVE_SSCANF
 		/**
 		 * convert an hex string to an integer.
@@ -0,0 +1,173 @@
+/*
+ * Hydrogen
+ * Copyright(c) 2002-2008 by Alex >Comix< Cominu [comix@users.sourceforge.net]
+ *
+ * http://www.hydrogen-music.org
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY, without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ */
+
+#ifndef H2C_METERS_H
+#define H2C_METERS_H
+
+#include <atomic>
+#include <cstdint>
+
+#include <hydrogen/config.h>
+#include <hydrogen/object.h>
+
+namespace H2Core
+{
+
+/**
+ * Meters collects the levels of all the strips of the mixer and
+ * hands them to a single reader, usually the GUI.
+ *
+ * The audio thread adds the levels of each strip during a process
+ * cycle and publishes them once per cycle with publish(), into one
+ * of three frames swapped through an atomic index. The reader takes
+ * the frame published last with take(), so neither side ever waits
+ * for the other nor reads a frame being written.
+ *
+ * The peaks and RMS values of a frame cover all the cycles published
+ * since the frame the reader took before, so no peak is lost when
+ * the reader polls slower than the audio thread publishes.
+ */
+class Meters : public H2Core::Object
+{
+		H2_OBJECT
+	public:
+		/** the strips, the FX, components and instruments by index */
+		enum Strip {
+			MASTER,                                 ///< the main output
+			PLAYBACK_TRACK,                         ///< Sampler::__playback_instrument
+			FX,                                     ///< first of #MAX_FX LADSPA slots
+			COMPONENT = FX + MAX_FX,                ///< first of #MAX_COMPONENTS song components
+			INSTRUMENT = COMPONENT + MAX_COMPONENTS,///< first of #MAX_INSTRUMENTS instruments
+			STRIPS = INSTRUMENT + MAX_INSTRUMENTS
+		};
+		/** time a peak is held for, in milliseconds */
+		static const int HOLD_MS = 1500;
+
+		/** levels of a strip, as linear amplitudes */
+		struct Levels {
+			float peak_l;
+			float peak_r;
+			float rms_l;
+			float rms_r;
+			float hold_l;                   ///< highest peak of the last #HOLD_MS
+			float hold_r;
+		};
+		/** levels published by the audio thread */
+		struct Frame {
+			unsigned sequence;              ///< number of the last cycle published
+			unsigned cycles;                ///< cycles since the frame taken before
+			int components;                 ///< components metered
+			int instruments;                ///< instruments metered
+			/** the strips past #components and #instruments are not set */
+			Levels strips[ STRIPS ];
+
+			/** \return the levels of \a strip, nullptr if not set */
+			const Levels* get( int strip ) const {
+				if ( strip < 0
+					 || ( strip < INSTRUMENT && strip >= COMPONENT + components )
+					 || strip >= INSTRUMENT + instruments ) {
+					return nullptr;
+				}
+				return &strips[ strip ];
+			}
+		};
+
+		Meters();
+		~Meters();
+
+		/**
+		 * add a buffer to the levels of a strip, real-time safe
+		 * \param strip one of #Strip, plus the index for FX,
+		 * components and instruments
+		 * \param pL left channel
+		 * \param pR right channel, may be \a pL
+		 * \param nFrames frames of both buffers
+		 */
+		void add_buffer( int strip, const float* pL, const float* pR, unsigned nFrames );
+		/**
+		 * add levels computed elsewhere to a strip, real-time safe
+		 * \param strip see add_buffer()
+		 * \param fPeak_L highest absolute value of the left channel
+		 * \param fPeak_R highest absolute value of the right channel
+		 * \param fEnergy_L sum of the squared values of the left channel
+		 * \param fEnergy_R sum of the squared values of the right channel
+		 */
+		void add_levels( int strip, float fPeak_L, float fPeak_R, float fEnergy_L, float fEnergy_R );
+		/**
+		 * publish the levels added since the last call, real-time
+		 * safe, called once per process cycle by the audio thread
+		 * \param nFrames frames of the cycle
+		 * \param nSampleRate sample rate, for the hold time
+		 * \param nComponents number of components of the song
+		 * \param nInstruments number of instruments of the song
+		 */
+		void publish( unsigned nFrames, unsigned nSampleRate, int nComponents, int nInstruments );
+		/**
+		 * take the levels published last, called by a single
+		 * reader thread
+		 * \return nullptr if nothing was published since the last
+		 * call, else a frame valid until the next call
+		 */
+		const Frame* take();
+
+	private:
+		/** FRESH bit of #__ready, set by publish(), cleared by take() */
+		static const int FRESH = 4;
+
+		struct Sum {
+			float peak[ 2 ];
+			double energy[ 2 ];
+		};
+		struct Hold {
+			float peak[ 2 ];
+			unsigned age[ 2 ];              ///< frames since the peak
+		};
+
+		/** apply one cycle to a strip and fill its levels */
+		void publish_strip( int strip, Levels* pLevels, bool bRestart, unsigned nFrames, unsigned nHoldFrames );
+		/** forget the sums and holds of strips [\a first, \a last) */
+		void clear( int first, int last );
+
+		// audio thread only
+		Sum __cycle[ STRIPS ];              ///< levels of the current cycle
+		Sum __total[ STRIPS ];              ///< levels since the frame taken last
+		Hold __hold[ STRIPS ];
+		uint64_t __total_frames;
+		unsigned __total_cycles;
+		unsigned __published;               ///< sequence of the last frame published
+		int __components;
+		int __instruments;
+		int __write;                        ///< frame written by publish()
+
+		// reader only
+		int __read;                         ///< frame handed out by take()
+
+		Frame __frames[ 3 ];
+		std::atomic<int> __ready;           ///< frame published last, plus #FRESH
+		std::atomic<unsigned> __consumed;   ///< sequence of the frame taken last
+};
+
+};
+
+#endif // H2C_METERS_H
+
+/* vim: set softtabstop=4 noexpandtab: */
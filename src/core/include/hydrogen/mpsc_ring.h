@@ -0,0 +1,154 @@
+/*
+ * Hydrogen
+ * Copyright(c) 2002-2008 by Alex >Comix< Cominu [comix@users.sourceforge.net]
+ *
+ * http://www.hydrogen-music.org
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY, without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ */
+
+#ifndef H2C_MPSC_RING_H
+#define H2C_MPSC_RING_H
+
+#include <atomic>
+
+namespace H2Core
+{
+
+/**
+ * Bounded lock-free queue of \a N items of \a T, \a N a power of two,
+ * filled by any number of threads and read by a single one.
+ *
+ * A producer claims the slot at #__write_index with a
+ * compare-and-swap, copies the item and publishes it by a release
+ * store to the sequence number of the slot. Pushing neither blocks
+ * nor allocates, so the audio and MIDI threads can use it. If the
+ * ring is full the item is dropped and counted instead of
+ * overwriting items the consumer did not read yet.
+ */
+template <typename T, unsigned N>
+class MpscRing
+{
+	static_assert( N > 0 && ( N & ( N - 1 ) ) == 0, "MpscRing size has to be a power of two" );
+
+	public:
+		MpscRing()
+			: __write_index( 0 )
+			, __read_index( 0 )
+			, __dropped( 0 )
+			, __high_water_mark( 0 )
+		{
+			for ( unsigned i = 0; i < N; ++i ) {
+				__slots[ i ].sequence.store( i, std::memory_order_relaxed );
+			}
+		}
+
+		/**
+		 * queue a copy of \a item, real-time safe
+		 * \return false if the ring is full
+		 */
+		bool push( const T& item )
+		{
+			unsigned nIndex = __write_index.load( std::memory_order_relaxed );
+			Slot* pSlot;
+			for ( ;; ) {
+				pSlot = &__slots[ nIndex & ( N - 1 ) ];
+				unsigned nSequence = pSlot->sequence.load( std::memory_order_acquire );
+				int nDiff = ( int )( nSequence - nIndex );
+				if ( nDiff == 0 ) {
+					// the slot is free, try to claim it
+					if ( __write_index.compare_exchange_weak( nIndex, nIndex + 1, std::memory_order_relaxed ) ) {
+						break;
+					}
+				} else if ( nDiff < 0 ) {
+					// the slot still holds an item from the previous lap
+					__dropped.fetch_add( 1, std::memory_order_relaxed );
+					return false;
+				} else {
+					// another producer claimed it first
+					nIndex = __write_index.load( std::memory_order_relaxed );
+				}
+			}
+
+			pSlot->item = item;
+			pSlot->sequence.store( nIndex + 1, std::memory_order_release );
+
+			unsigned nQueued = nIndex + 1 - __read_index.load( std::memory_order_relaxed );
+			unsigned nHighWaterMark = __high_water_mark.load( std::memory_order_relaxed );
+			while ( nQueued > nHighWaterMark &&
+					!__high_water_mark.compare_exchange_weak( nHighWaterMark, nQueued, std::memory_order_relaxed ) ) {
+			}
+			return true;
+		}
+
+		/** \return the oldest item, nullptr if none. Single consumer only. */
+		const T* front() const
+		{
+			unsigned nIndex = __read_index.load( std::memory_order_relaxed );
+			const Slot* pSlot = &__slots[ nIndex & ( N - 1 ) ];
+			if ( pSlot->sequence.load( std::memory_order_acquire ) != nIndex + 1 ) {
+				// not published yet
+				return nullptr;
+			}
+			return &pSlot->item;
+		}
+
+		/** drop the item returned by front() */
+		void pop()
+		{
+			unsigned nIndex = __read_index.load( std::memory_order_relaxed );
+			Slot* pSlot = &__slots[ nIndex & ( N - 1 ) ];
+			if ( pSlot->sequence.load( std::memory_order_acquire ) != nIndex + 1 ) {
+				return;
+			}
+			// hand the slot over to the producers of the next lap
+			pSlot->sequence.store( nIndex + N, std::memory_order_release );
+			__read_index.store( nIndex + 1, std::memory_order_relaxed );
+		}
+
+		/** \return number of items dropped because the ring was full */
+		unsigned get_dropped() const {
+			return __dropped.load( std::memory_order_relaxed );
+		}
+		/** \return largest number of items waiting so far */
+		unsigned get_high_water_mark() const {
+			return __high_water_mark.load( std::memory_order_relaxed );
+		}
+		/** resets the high water mark to the number of items waiting */
+		void reset_high_water_mark() {
+			__high_water_mark.store( __write_index.load( std::memory_order_relaxed )
+									 - __read_index.load( std::memory_order_relaxed ),
+									 std::memory_order_relaxed );
+		}
+
+	private:
+		struct Slot {
+			std::atomic<unsigned> sequence; ///< index + 1 once written, index + N once read
+			T item;
+		};
+
+		Slot __slots[ N ];
+		std::atomic<unsigned> __write_index;  ///< next slot to claim, only grows
+		std::atomic<unsigned> __read_index;   ///< next slot to read, only grows
+		std::atomic<unsigned> __dropped;
+		std::atomic<unsigned> __high_water_mark;
+};
+
+};
+
+#endif // H2C_MPSC_RING_H
+
+/* vim: set softtabstop=4 noexpandtab: */
@@ -136,6 +136,21 @@ class Object {
 #define ___WARNINGLOG(x) __LOG_STATIC(H2Core::Logger::Warning,  (x) );
 #define ___ERRORLOG(x)  __LOG_STATIC( H2Core::Logger::Error,    (x) );
 
+// real-time safe logging macros, taking a string literal with %1, %2, ...
+// and up to LOGGER_MAX_ARGS numbers, formatted by the logger thread
+#define __LOG_METHOD_FMT( lvl, ... )  if( __logger->should_log( (lvl) ) )         { __logger->log_fmt( (lvl), class_name(), __FUNCTION__, __VA_ARGS__ ); }
+#define __LOG_STATIC_FMT( lvl, ... )  if( H2Core::Logger::get_instance()->should_log( (lvl) ) )   { H2Core::Logger::get_instance()->log_fmt( (lvl), 0, __PRETTY_FUNCTION__, __VA_ARGS__ ); }
+
+#define DEBUGLOG_FMT(...)       __LOG_METHOD_FMT( H2Core::Logger::Debug,   __VA_ARGS__ );
+#define INFOLOG_FMT(...)        __LOG_METHOD_FMT( H2Core::Logger::Info,    __VA_ARGS__ );
+#define WARNINGLOG_FMT(...)     __LOG_METHOD_FMT( H2Core::Logger::Warning, __VA_ARGS__ );
+#define ERRORLOG_FMT(...)       __LOG_METHOD_FMT( H2Core::Logger::Error,   __VA_ARGS__ );
+
+#define ___DEBUGLOG_FMT(...)    __LOG_STATIC_FMT( H2Core::Logger::Debug,   __VA_ARGS__ );
+#define ___INFOLOG_FMT(...)     __LOG_STATIC_FMT( H2Core::Logger::Info,    __VA_ARGS__ );
+#define ___WARNINGLOG_FMT(...)  __LOG_STATIC_FMT( H2Core::Logger::Warning, __VA_ARGS__ );
+#define ___ERRORLOG_FMT(...)    __LOG_STATIC_FMT( H2Core::Logger::Error,   __VA_ARGS__ );
+
 };
 
 #endif // H2C_OBJECT_H
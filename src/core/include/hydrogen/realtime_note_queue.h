@@ -0,0 +1,122 @@
+/*
+ * Hydrogen
+ * Copyright(c) 2002-2008 by Alex >Comix< Cominu [comix@users.sourceforge.net]
+ *
+ * http://www.hydrogen-music.org
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY, without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ */
+
+#ifndef H2C_REALTIME_NOTE_QUEUE_H
+#define H2C_REALTIME_NOTE_QUEUE_H
+
+#include <chrono>
+#include <cstdint>
+
+#include <hydrogen/object.h>
+#include <hydrogen/mpsc_ring.h>
+
+namespace H2Core
+{
+
+/**
+ * Notes played live, by MIDI input or the keyboard, on their way to
+ * the audio thread.
+ *
+ * Any thread pushes events stamped with the time they were played
+ * at, the driver time of a MIDI event when known. The audio thread
+ * takes them once per process cycle and starts each note at the
+ * frame matching its time within the previous cycle, see
+ * frame_offset(). The notes keep the spacing they were played with,
+ * at the cost of one cycle of latency, instead of all starting at
+ * the beginning of a cycle.
+ *
+ * Same MpscRing as the EventQueue: pushing never blocks nor
+ * allocates, an event is dropped if the ring is full.
+ */
+class RealtimeNoteQueue : public H2Core::Object
+{
+		H2_OBJECT
+	public:
+		/** number of events queued at most, a power of two */
+		static const unsigned SIZE = 256;
+
+		struct Event {
+			enum Type {
+				NOTE_ON,
+				NOTE_OFF,                   ///< releases the notes of #instrument
+				KEY_OFF                     ///< releases the notes of the MIDI #key
+			};
+			Type type;
+			uint64_t time;                  ///< now() when played
+			int instrument;                 ///< index within the instrument list of the song
+			int key;                        ///< MIDI key, -1 if none
+			float velocity;
+			float pan_L;
+			float pan_R;
+			int length;                     ///< recorded length in ticks of the note released, -1 if none
+			int note_on_tick;               ///< position of the recorded note whose #length it is
+		};
+
+		RealtimeNoteQueue();
+		~RealtimeNoteQueue();
+
+		/** \return a monotonic timestamp in nanoseconds */
+		static inline uint64_t now() {
+			return std::chrono::duration_cast<std::chrono::nanoseconds>(
+				std::chrono::steady_clock::now().time_since_epoch() ).count();
+		}
+		/**
+		 * \return the frame of a cycle at which an event played at
+		 * \a nTime starts, 0 if it precedes \a nWindowStart, the last
+		 * frame if it is later than the cycle
+		 * \param nWindowStart now() at the start of the window the
+		 * cycle plays, usually the start of the previous cycle
+		 * \param nSampleRate frames per second
+		 * \param nFrames frames of the cycle
+		 */
+		static int frame_offset( uint64_t nTime, uint64_t nWindowStart, unsigned nSampleRate, unsigned nFrames );
+
+		/**
+		 * queue \a event, real-time safe
+		 * \return false if the queue is full
+		 */
+		bool push( const Event& event ) {
+			return __events.push( event );
+		}
+		/** \return the oldest event, nullptr if none. Single consumer only. */
+		const Event* front() const {
+			return __events.front();
+		}
+		/** drop the event returned by front() */
+		void pop() {
+			__events.pop();
+		}
+
+		/** \return number of events dropped because the queue was full */
+		unsigned get_dropped() const {
+			return __events.get_dropped();
+		}
+
+	private:
+		MpscRing<Event, SIZE> __events;
+};
+
+};
+
+#endif // H2C_REALTIME_NOTE_QUEUE_H
+
+/* vim: set softtabstop=4 noexpandtab: */
@@ -28,6 +28,7 @@
 #include <hydrogen/globals.h>
 
 #include <inttypes.h>
+#include <memory>
 #include <vector>
 
 
@@ -42,6 +43,11 @@ class Instrument;
 struct SelectedLayerInfo;
 class InstrumentComponent;
 class AudioOutput;
+class SamplerWorkers;
+class SamplerStreams;
+class SamplerVariants;
+class SamplerVoices;
+class SampleData;
 
 ///
 /// Waveform based sampler.
@@ -73,13 +79,31 @@ public:
 
 	void stop_playing_notes( Instrument *instr = nullptr );
 
-	int get_playing_notes_number() {
-		return __playing_notes_queue.size();
+	int get_playing_notes_number() const;
+
+	/** \return false if streamed samples only play their head,
+	 * see Preferences::m_nSampleStreamThreshold */
+	bool has_streams() const {
+		return m_pStreams != nullptr;
 	}
+	/** \return number of blocks of streamed samples played silent
+	 * because the disk was late */
+	int get_stream_underruns() const;
+	/** \return number of streamed samples being played */
+	int get_active_streams() const;
+	/** \return number of samples resampled in the background, see
+	 * Preferences::m_bResampleVariants */
+	int get_resampled_variants() const;
 
 	void preview_sample( Sample* sample, int length );
 	void preview_instrument( Instrument* instr );
 
+	/**
+	 * Gives the note recorded at \a noteOnTick the length it was
+	 * held for. The song has to be held with
+	 * AudioEngine::lock_song(), see
+	 * Hydrogen::applyRecordedNoteLengths().
+	 */
 	void setPlayingNotelength( Instrument* instrument, unsigned long ticks, unsigned long noteOnTick );
 	bool is_instrument_playing( Instrument* pInstr );
 
@@ -114,9 +138,20 @@ public:
 		void reinitialize_playback_track();
 
 private:
-	std::vector<Note*> __playing_notes_queue;
+	/** the notes being played, by slot. See SamplerVoices. */
+	SamplerVoices *m_pPlayingNotes;
 	std::vector<Note*> __queuedNoteOffs;
 
+	/** \return the number of notes played at most right now, see
+	 * Preferences::m_nMaxNotes */
+	int get_max_notes() const;
+	/**
+	 * Releases a playing note to make room for a new one, chosen
+	 * according to Preferences::m_nVoiceStealing.
+	 * \param pInstr instrument of the new note, nullptr if none
+	 */
+	void steal_note( Instrument* pInstr );
+
 	/** Maximum number of layers to be used in the Instrument
 	    editor. It will be inferred from
 	    InstrumentComponent::m_nMaxLayers, which itself is
@@ -128,7 +163,157 @@ private:
 
 	int __playBackSamplePosition;
 
-	bool __render_note( Note* pNote, unsigned nBufferSize, Song* pSong );
+	/** Scratch buffers of #MAX_BUFFER_SIZE frames used to render
+	 * a single voice block by block. */
+	float *m_pRawBuffer_L;		///< interpolated sample data (left)
+	float *m_pRawBuffer_R;		///< interpolated sample data (right)
+	float *m_pVoiceBuffer_L;	///< enveloped and filtered voice (left)
+	float *m_pVoiceBuffer_R;	///< enveloped and filtered voice (right)
+	float *m_pEnvelopeBuffer;	///< ADSR gain for each frame of the block
+
+	/**
+	 * One component of a playing note, ready to be rendered.
+	 *
+	 * Voices are filled in slot order by __prepare_note(),
+	 * rendered by render_voice() and mixed by mix_voice(), again
+	 * in slot order.
+	 */
+	struct Voice {
+		Note *pNote;
+		Sample *pSample;
+		SelectedLayerInfo *pSelectedLayerInfo;
+		InstrumentComponent *pCompo;
+		DrumkitComponent *pDrumCompo;
+		int nInitialSilence;
+		float cost_L;
+		float cost_R;
+		float cost_track_L;
+		float cost_track_R;
+		float fLayerPitch;
+		bool bResample;
+		/** copy of the sample resampled in the background, played
+		 * instead of interpolating pSample, nullptr if none */
+		const SampleData *pVariant;
+		int nResult;			///< index of the result within #m_renderResults
+		float *pVoice_L;		///< enveloped and filtered voice (left)
+		float *pVoice_R;		///< enveloped and filtered voice (right)
+		float *pRaw_L;			///< room for the interpolated sample data (left)
+		float *pRaw_R;			///< room for the interpolated sample data (right)
+		// set by render_voice()
+		int nFrames;			///< number of rendered frames
+		const float *pSend_L;	///< FX send source (left)
+		const float *pSend_R;	///< FX send source (right)
+		bool bEnded;
+	};
+	/** a contiguous range of #m_voices belonging to the same note */
+	struct VoiceJob {
+		int nFirst;
+		int nCount;
+	};
+
+	std::vector<Voice> m_voices;		///< voices waiting for render_voices()
+	std::vector<VoiceJob> m_voiceJobs;	///< #m_voices grouped by note
+	/** per component results of the notes, as returned by the
+	 * old per note render loop */
+	std::vector<char> m_renderResults;
+	/** first index within #m_renderResults and number of results
+	 * of each slot of #m_pPlayingNotes */
+	std::vector<VoiceJob> m_noteResults;
+
+	/** Parallel rendering, nullptr if the voices are rendered by
+	 * the audio thread alone. See Preferences::m_nRenderThreads. */
+	SamplerWorkers *m_pWorkers;
+	int m_nVoiceSlots;			///< voices rendered in a single batch
+	float *m_pSlotBuffers;		///< 4 buffers of #MAX_BUFFER_SIZE per slot
+	/** one envelope buffer per worker, the first is #m_pEnvelopeBuffer */
+	std::vector<float*> m_envelopeBuffers;
+	uint32_t m_nRenderFrames;	///< size of the buffer being rendered by process()
+	Song *m_pRenderSong;		///< song being rendered by process()
+	/** AudioOutput::track_outs_follow_main_mix() of the driver
+	 * rendered for by process() */
+	bool m_bTrackOutsMainMix;
+
+	/** Disk streams of the streamed samples, nullptr if streaming
+	 * is disabled. See Preferences::m_nSampleStreamThreshold. */
+	SamplerStreams *m_pStreams;
+	int m_nPlaybackStream;		///< stream of the playback track
+
+	/**
+	 * Keeps a disk stream of \a pSample ready to deliver the frames
+	 * from \a nFrame on. Audio thread only.
+	 * \param nStream the stream used so far, -1 if none
+	 * \param pOwner identifies the reader of the stream
+	 * \return the stream to use from now on, -1 if \a pSample is
+	 * not streamed or no stream is left
+	 */
+	int prepare_stream( int nStream, const void* pOwner, Sample* pSample, int nFrame );
+	/** frames of a sample in their storage format, see get_sample_data() */
+	struct SampleBlock;
+	/**
+	 * Fills \a pBlock with the frames [\a nFirst, \a nLast) of \a
+	 * pSample. They are taken from the head of the sample if
+	 * possible, from \a nStream otherwise. Real-time safe, the
+	 * frames are never read from the file.
+	 * \return false on underrun
+	 */
+	bool get_sample_data( Sample* pSample, int nStream, int nFirst, int nLast, SampleBlock* pBlock );
+
+	/** Resampled copies of the samples, nullptr if they are
+	 * disabled. See Preferences::m_bResampleVariants. */
+	SamplerVariants *m_pVariants;
+
+	/**
+	 * \return the number of frames of a sample at \a nSampleRate
+	 * played per frame at \a nDriverRate, with the pitch \a fPitch
+	 */
+	static float compute_step( float fPitch, int nSampleRate, int nDriverRate );
+	/**
+	 * Looks for the copy of \a pSample resampled for \a fPitch and
+	 * \a nDriverRate. A note keeps playing the copy it started
+	 * with, or interpolates the sample to its end. Audio thread
+	 * only.
+	 * \return the copy to play, nullptr if the sample has to be
+	 * interpolated
+	 */
+	const SampleData* prepare_variant( SelectedLayerInfo* pSelectedLayer, Sample* pSample, float fPitch, int nDriverRate );
+	/** resamples \a source for SamplerVariants, \a pContext being the Sampler */
+	static std::shared_ptr<SampleData> build_variant( void* pContext, const SampleData& source, float fStep, int nSampleRate );
+	/**
+	 * Points \a ppData_L and \a ppData_R to \a nFrames float
+	 * frames of \a block from \a nFirst on. Frames in a compact
+	 * format are converted into \a pBuffer_L and \a pBuffer_R,
+	 * the right channel of a mono sample is the left one.
+	 */
+	static void read_block( const SampleBlock& block, int nFirst, int nFrames, float* pBuffer_L, float* pBuffer_R,
+							const float** ppData_L, const float** ppData_R );
+	/**
+	 * Resamples \a nFrames frames of the channel \a pData of \a
+	 * block into \a pOut, see resample_block().
+	 */
+	void resample_channel( const SampleBlock& block, const void* pData, int nSampleFrames,
+						   double fSamplePos, float fStep, float* pOut, int nFrames );
+	/** resample_channel() once the storage of the frames is known */
+	template < typename Reader >
+	void resample_reader( const Reader& data, int nSampleFrames, double fSamplePos, float fStep, float* pOut, int nFrames );
+
+	/**
+	 * Selects the layers of \a pNote and computes the gains of its
+	 * components, appending them to #m_voices.
+	 */
+	void __prepare_note( Note* pNote, unsigned nBufferSize, Song* pSong );
+	/** render and mix #m_voices, then clear it */
+	void render_voices( Song* pSong );
+	/** renders the voices of the job \a nJob of #m_voiceJobs */
+	static void render_job( void* pContext, int nJob, int nWorker );
+	/**
+	 * Renders \a voice into its own buffers, updating the sample
+	 * position and the envelope of its note. It does not touch
+	 * anything shared with other notes.
+	 * \param nWorker selects the scratch buffers, 0 for the calling thread
+	 */
+	void render_voice( Voice& voice, int nWorker );
+	/** mixes a rendered \a voice into the outputs and the FX sends */
+	void mix_voice( Voice& voice, Song* pSong );
 
 		InterpolateMode __interpolateMode;
 
@@ -232,36 +417,42 @@ private:
 				return( a0 * mu * mu2 + a1 * mu2 + a2 * mu + a3 );
 		};
 
-	bool __render_note_no_resample(
-		Sample *pSample,
-		Note *pNote,
-		SelectedLayerInfo *pSelectedLayerInfo,
-		InstrumentComponent *pCompo,
-		DrumkitComponent *pDrumCompo,
-		int nBufferSize,
-		int nInitialSilence,
-		float cost_L,
-		float cost_R,
-		float cost_track_L,
-			float cost_track_R,
-		Song* pSong
-	);
+	/**
+	 * Resamples \a nFrames frames of a channel into \a pOut,
+	 * starting at \a fSamplePos and advancing by \a fStep. The
+	 * interpolation \a mode is a template parameter so it is
+	 * resolved once per block instead of once per frame. \a data
+	 * is one of the SampleData readers, so frames kept as integers
+	 * are converted by the interpolation itself.
+	 */
+	template < InterpolateMode mode, typename Reader >
+	static void resample_block( const Reader& data, int nSampleFrames,
+								double fSamplePos, float fStep,
+								float* pOut, int nFrames );
 
-	bool __render_note_resample(
-		Sample *pSample,
+	/**
+	 * Mixes the voice held in \a pVoice_L and \a pVoice_R into
+	 * the track outputs (if any), the DrumkitComponent outputs and
+	 * the main outputs, updating the peaks of the Instrument of
+	 * \a pNote.
+	 */
+	void mix_voice_block(
 		Note *pNote,
-		SelectedLayerInfo *pSelectedLayerInfo,
 		InstrumentComponent *pCompo,
 		DrumkitComponent *pDrumCompo,
-		int nBufferSize,
-		int nInitialSilence,
+		const float *pVoice_L,
+		const float *pVoice_R,
+		int nBufferPos,
+		int nFrames,
 		float cost_L,
 		float cost_R,
 		float cost_track_L,
-		float cost_track_R,
-			float fLayerPitch,
-		Song* pSong
+		float cost_track_R
 	);
+
+	bool __render_note_no_resample( Voice& voice, int nWorker );
+
+	bool __render_note_resample( Voice& voice, int nWorker );
 };
 
 } // namespace
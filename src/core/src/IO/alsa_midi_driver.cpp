@@ -29,6 +29,7 @@
 
 #include <hydrogen/globals.h>
 #include <hydrogen/event_queue.h>
+#include <hydrogen/realtime_note_queue.h>
 
 #include <pthread.h>
 #include <hydrogen/basics/note.h>
@@ -54,6 +55,10 @@ struct pollfd *pfd;
 int portId;
 int clientId;
 int outPortId;
+/** queue stamping the events of the input port, -1 if none */
+int queueId = -1;
+/** RealtimeNoteQueue::now() when #queueId was started */
+uint64_t queueStart = 0;
 
 
 void* alsaMidiDriver_thread( void* param )
@@ -99,6 +104,27 @@ void* alsaMidiDriver_thread( void* param )
 
 	clientId = snd_seq_client_id( seq_handle );
 
+	// Have the sequencer stamp the incoming events with the real time
+	// of a queue, so they keep their spacing however late this thread
+	// handles them.
+	queueId = snd_seq_alloc_named_queue( seq_handle, "Hydrogen" );
+	if ( queueId >= 0 ) {
+		snd_seq_port_info_t *pinfo;
+		snd_seq_port_info_alloca( &pinfo );
+		snd_seq_get_port_info( seq_handle, portId, pinfo );
+		snd_seq_port_info_set_timestamping( pinfo, 1 );
+		snd_seq_port_info_set_timestamp_queue( pinfo, queueId );
+		snd_seq_port_info_set_timestamp_real( pinfo, 1 );
+		if ( snd_seq_set_port_info( seq_handle, portId, pinfo ) < 0
+			 || snd_seq_start_queue( seq_handle, queueId, nullptr ) < 0 ) {
+			__WARNINGLOG( "Error setting up the timestamps of the MIDI input" );
+			queueId = -1;
+		} else {
+			snd_seq_drain_output( seq_handle );
+			queueStart = RealtimeNoteQueue::now();
+		}
+	}
+
 #ifdef H2CORE_HAVE_LASH
 	if ( Preferences::get_instance()->useLash() ){
 		LashClient* lashClient = LashClient::get_instance();
@@ -190,6 +216,7 @@ void* alsaMidiDriver_thread( void* param )
 	}
 	snd_seq_close ( seq_handle );
 	seq_handle = nullptr;
+	queueId = -1;
 	__INFOLOG( "MIDI Thread DESTROY" );
 
 	pthread_exit( nullptr );
@@ -261,6 +288,10 @@ void AlsaMidiDriver::midi_action( snd_seq_t *seq_handle )
 		if ( m_bActive && ev != nullptr ) {
 
 			MidiMessage msg;
+			if ( queueId >= 0 && ev->queue == queueId && snd_seq_ev_is_real( ev ) ) {
+				msg.m_nTime = queueStart + ( uint64_t )ev->time.time.tv_sec * 1000000000ull
+					+ ev->time.time.tv_nsec;
+			}
 
 			switch ( ev->type ) {
 			case SND_SEQ_EVENT_NOTEON:
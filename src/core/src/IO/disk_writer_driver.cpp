@@ -28,10 +28,14 @@
 #include <hydrogen/timeline.h>
 #include <hydrogen/basics/pattern.h>
 #include <hydrogen/basics/pattern_list.h>
+#include <hydrogen/basics/instrument.h>
 #include <hydrogen/IO/DiskWriterDriver.h>
 
 #include <pthread.h>
+#include <algorithm>
 #include <cassert>
+#include <chrono>
+#include <cstring>
 
 #if defined(WIN32) || _DOXYGEN_
 #include <windows.h>
@@ -50,48 +54,190 @@ namespace H2Core
 
 pthread_t diskWriterDriverThread;
 
-void* diskWriterDriver_thread( void* param )
+/** Frames collected before they are handed to the writer thread. */
+#define DISK_WRITER_CHUNK_FRAMES 65536
+
+/**
+ * Two chunks of interleaved frames shared by the render thread and
+ * the writer thread. The render thread fills one chunk while the
+ * writer thread encodes the other, so libsndfile does not slow the
+ * rendering down. Without a writer thread the render thread encodes
+ * each chunk itself once it is full.
+ */
+class DiskWriterChunks
 {
-	Object* __object = ( Object* )param;	
-	DiskWriterDriver *pDriver = ( DiskWriterDriver* )param;
+	public:
+		DiskWriterChunks( SNDFILE* pFile, unsigned nCapacity )
+			: m_pFile( pFile )
+			, m_nCapacity( nCapacity )
+			, m_nFilling( 0 )
+			, m_bDone( false )
+			, m_bThreaded( false )
+		{
+			for ( int i = 0; i < 2; ++i ) {
+				m_pData[ i ] = new float[ nCapacity * 2 ];	// always stereo
+				m_nFrames[ i ] = 0;
+				m_bFull[ i ] = false;
+			}
+			pthread_mutex_init( &m_mutex, nullptr );
+			pthread_cond_init( &m_cond, nullptr );
+		}
 
-	EventQueue::get_instance()->push_event( EVENT_PROGRESS, 0 );
-	
-	pDriver->setBpm( Hydrogen::get_instance()->getSong()->__bpm );
-	pDriver->audioEngine_process_checkBPMChanged();
-	
-	__INFOLOG( "DiskWriterDriver thread start" );
+		~DiskWriterChunks()
+		{
+			pthread_cond_destroy( &m_cond );
+			pthread_mutex_destroy( &m_mutex );
+			delete[] m_pData[ 0 ];
+			delete[] m_pData[ 1 ];
+		}
 
-	// always rolling, no user interaction
-	pDriver->m_transport.m_status = TransportInfo::ROLLING;
+		/** start the writer thread, \return false if the chunks are written synchronously */
+		bool start()
+		{
+			m_bThreaded = pthread_create( &m_thread, nullptr, writer_thread, this ) == 0;
+			return m_bThreaded;
+		}
+
+		/** wait for the writer thread to write the last chunk, see finish() */
+		void join()
+		{
+			if ( m_bThreaded ) {
+				pthread_join( m_thread, nullptr );
+			}
+		}
+
+		/** room for \a nFrames frames at the end of the chunk being filled */
+		float* reserve( unsigned nFrames )
+		{
+			if ( m_nFrames[ m_nFilling ] + nFrames > m_nCapacity ) {
+				submit();
+			}
+			return m_pData[ m_nFilling ] + m_nFrames[ m_nFilling ] * 2;
+		}
+
+		/** \a nFrames frames have been written to the last reserve() */
+		void commit( unsigned nFrames )
+		{
+			m_nFrames[ m_nFilling ] += nFrames;
+		}
+
+		/** hand the remaining frames to the writer thread and let it end */
+		void finish()
+		{
+			if ( m_nFrames[ m_nFilling ] > 0 ) {
+				submit();
+			}
+			if ( !m_bThreaded ) {
+				return;
+			}
+			pthread_mutex_lock( &m_mutex );
+			m_bDone = true;
+			pthread_cond_broadcast( &m_cond );
+			pthread_mutex_unlock( &m_mutex );
+		}
+
+		static void* writer_thread( void* param )
+		{
+			DiskWriterChunks* pChunks = static_cast<DiskWriterChunks*>( param );
+			pChunks->write_chunks();
+			return nullptr;
+		}
+
+	private:
+		/** hand the chunk being filled to the writer and wait for the other one */
+		void submit()
+		{
+			if ( !m_bThreaded ) {
+				write_chunk( m_nFilling );
+				m_nFrames[ m_nFilling ] = 0;
+				return;
+			}
+			pthread_mutex_lock( &m_mutex );
+			m_bFull[ m_nFilling ] = true;
+			pthread_cond_broadcast( &m_cond );
+			m_nFilling ^= 1;
+			while ( m_bFull[ m_nFilling ] ) {
+				pthread_cond_wait( &m_cond, &m_mutex );
+			}
+			pthread_mutex_unlock( &m_mutex );
+			m_nFrames[ m_nFilling ] = 0;
+		}
+
+		void write_chunks()
+		{
+			int nChunk = 0;
+			for ( ;; ) {
+				pthread_mutex_lock( &m_mutex );
+				while ( !m_bFull[ nChunk ] && !m_bDone ) {
+					pthread_cond_wait( &m_cond, &m_mutex );
+				}
+				bool bFull = m_bFull[ nChunk ];
+				pthread_mutex_unlock( &m_mutex );
+				if ( !bFull ) {
+					break;
+				}
 
+				write_chunk( nChunk );
+
+				pthread_mutex_lock( &m_mutex );
+				m_bFull[ nChunk ] = false;
+				pthread_cond_broadcast( &m_cond );
+				pthread_mutex_unlock( &m_mutex );
+				nChunk ^= 1;
+			}
+		}
+
+		void write_chunk( int nChunk )
+		{
+			sf_count_t res = sf_writef_float( m_pFile, m_pData[ nChunk ], m_nFrames[ nChunk ] );
+			if ( res != ( sf_count_t )m_nFrames[ nChunk ] ) {
+				___ERRORLOG( "Error during sf_write_float" );
+			}
+		}
+
+		SNDFILE* m_pFile;
+		unsigned m_nCapacity;
+		float* m_pData[ 2 ];
+		unsigned m_nFrames[ 2 ];
+		bool m_bFull[ 2 ];		///< waiting for or being written by the writer thread
+		int m_nFilling;			///< chunk filled by the render thread
+		bool m_bDone;
+		bool m_bThreaded;		///< the writer thread is running
+		pthread_t m_thread;
+		pthread_mutex_t m_mutex;
+		pthread_cond_t m_cond;
+};
+
+/** format of the file \a sFilename, derived from its extension */
+static SF_INFO diskWriterDriver_soundInfo( const QString& sFilename, unsigned nSampleRate, int nSampleDepth )
+{
 	SF_INFO soundInfo;
-	soundInfo.samplerate = pDriver->m_nSampleRate;
+	soundInfo.samplerate = nSampleRate;
 //	soundInfo.frames = -1;//getNFrames();		///\todo: da terminare
 	soundInfo.channels = 2;
 	//default format
 	int sfformat = 0x010000; //wav format (default)
 	int bits = 0x0002; //16 bit PCM (default)
 	//sf_format switch
-	if( pDriver->m_sFilename.endsWith(".aiff") || pDriver->m_sFilename.endsWith(".AIFF") ){
+	if( sFilename.endsWith(".aiff") || sFilename.endsWith(".AIFF") ){
 		sfformat =  0x020000; //Apple/SGI AIFF format (big endian)
 	}
-	if( pDriver->m_sFilename.endsWith(".flac") || pDriver->m_sFilename.endsWith(".FLAC") ){
+	if( sFilename.endsWith(".flac") || sFilename.endsWith(".FLAC") ){
 		sfformat =  0x170000; //FLAC lossless file format
 	}
-	if( ( pDriver->m_nSampleDepth == 8 ) && ( pDriver->m_sFilename.endsWith(".aiff") || pDriver->m_sFilename.endsWith(".AIFF") ) ){
+	if( ( nSampleDepth == 8 ) && ( sFilename.endsWith(".aiff") || sFilename.endsWith(".AIFF") ) ){
 		bits = 0x0001; //Signed 8 bit data works with aiff
 	}
-	if( ( pDriver->m_nSampleDepth == 8 ) && ( pDriver->m_sFilename.endsWith(".wav") || pDriver->m_sFilename.endsWith(".WAV") ) ){
+	if( ( nSampleDepth == 8 ) && ( sFilename.endsWith(".wav") || sFilename.endsWith(".WAV") ) ){
 		bits = 0x0005; //Unsigned 8 bit data needed for Microsoft WAV format
 	}
-	if( pDriver->m_nSampleDepth == 16 ){
+	if( nSampleDepth == 16 ){
 		bits = 0x0002; //Signed 16 bit data
 	}
-	if( pDriver->m_nSampleDepth == 24 ){
+	if( nSampleDepth == 24 ){
 		bits = 0x0003; //Signed 24 bit data
 	}
-	if( pDriver->m_nSampleDepth == 32 ){
+	if( nSampleDepth == 32 ){
 		bits = 0x0004; ////Signed 32 bit data
 	}
 
@@ -100,7 +246,7 @@ void* diskWriterDriver_thread( void* param )
 //	#ifdef HAVE_OGGVORBIS
 
 	//ogg vorbis option
-	if( pDriver->m_sFilename.endsWith( ".ogg" ) | pDriver->m_sFilename.endsWith( ".OGG" ) )
+	if( sFilename.endsWith( ".ogg" ) | sFilename.endsWith( ".OGG" ) )
 		soundInfo.format = SF_FORMAT_OGG | SF_FORMAT_VORBIS;
 
 //	#endif
@@ -137,18 +283,104 @@ void* diskWriterDriver_thread( void* param )
 ///used for ogg
 //          SF_FORMAT_VORBIS
 
-	if ( !sf_format_check( &soundInfo ) ) {
-		__ERRORLOG( "Error in soundInfo" );
-		return nullptr;
+	return soundInfo;
+}
+
+/** interleave a stereo buffer, clipping it to [-1,1] */
+static void diskWriterDriver_interleave( float *pData, const float *pData_L, const float *pData_R, unsigned nFrames )
+{
+	for ( unsigned i = 0; i < nFrames; i++ ) {
+		if(pData_L[i] > 1){
+			pData[i * 2] = 1;
+		}
+		else if(pData_L[i] < -1){
+			pData[i * 2] = -1;
+		}else
+		{
+			pData[i * 2] = pData_L[i];
+		}
+		
+		if(pData_R[i] > 1){
+			pData[i * 2 + 1] = 1;
+		}
+		else if(pData_R[i] < -1){
+			pData[i * 2 + 1] = -1;
+		}else
+		{
+			pData[i * 2 + 1] = pData_R[i];
+		}
+	}
+}
+
+/** a file written by the DiskWriterDriver and its writer thread */
+struct DiskWriterOutput
+{
+	QString sFilename;
+	const float* pOut_L;
+	const float* pOut_R;
+	SNDFILE* pFile;
+	DiskWriterChunks* pChunks;
+};
+
+void* diskWriterDriver_thread( void* param )
+{
+	Object* __object = ( Object* )param;	
+	DiskWriterDriver *pDriver = ( DiskWriterDriver* )param;
+
+	EventQueue::get_instance()->push_event( EVENT_PROGRESS, 0 );
+	
+	pDriver->setBpm( Hydrogen::get_instance()->getSong()->__bpm );
+	pDriver->audioEngine_process_checkBPMChanged();
+	
+	__INFOLOG( "DiskWriterDriver thread start" );
+
+	// always rolling, no user interaction
+	pDriver->m_transport.m_status = TransportInfo::ROLLING;
+
+	// The main mix and every stem get their own file, encoded in
+	// their own thread while the next frames are rendered.
+	std::vector<DiskWriterOutput> outputs;
+	if ( !pDriver->m_sFilename.isEmpty() ) {
+		outputs.push_back( { pDriver->m_sFilename, pDriver->m_pOut_L, pDriver->m_pOut_R, nullptr, nullptr } );
+	}
+	for ( auto it = pDriver->m_stems.begin(); it != pDriver->m_stems.end(); ++it ) {
+		unsigned nStem = pDriver->m_stemIndex[ it->first ];
+		outputs.push_back( { it->second, pDriver->m_stemOuts_L[ nStem ], pDriver->m_stemOuts_R[ nStem ], nullptr, nullptr } );
 	}
 
+	unsigned nChunkFrames = std::max( ( unsigned )DISK_WRITER_CHUNK_FRAMES, pDriver->m_nBufferSize );
+	for ( auto it = outputs.begin(); it != outputs.end(); ) {
+		SF_INFO soundInfo = diskWriterDriver_soundInfo( it->sFilename, pDriver->m_nSampleRate, pDriver->m_nSampleDepth );
+		if ( !sf_format_check( &soundInfo ) ) {
+			__ERRORLOG( "Error in soundInfo" );
+			it = outputs.erase( it );
+			continue;
+		}
+
+		it->pFile = sf_open( it->sFilename.toLocal8Bit(), SFM_WRITE, &soundInfo );
+		if ( it->pFile == nullptr ) {
+			__ERRORLOG( QString( "Unable to open %1: %2" ).arg( it->sFilename ).arg( sf_strerror( nullptr ) ) );
+			it = outputs.erase( it );
+			continue;
+		}
+		++it;
+	}
 
-	SNDFILE* m_file = sf_open( pDriver->m_sFilename.toLocal8Bit(), SFM_WRITE, &soundInfo );
+	if ( outputs.empty() ) {
+		__ERRORLOG( "No file to export to" );
+		EventQueue::get_instance()->push_event( EVENT_PROGRESS, 100 );
+		return nullptr;
+	}
 
-	float *pData = new float[ pDriver->m_nBufferSize * 2 ];	// always stereo
+	for ( DiskWriterOutput& output : outputs ) {
+		output.pChunks = new DiskWriterChunks( output.pFile, nChunkFrames );
+		if ( !output.pChunks->start() ) {
+			__WARNINGLOG( QString( "Can't start the writer thread of %1, writing it synchronously" ).arg( output.sFilename ) );
+		}
+	}
 
-	float *pData_L = pDriver->m_pOut_L;
-	float *pData_R = pDriver->m_pOut_R;
+	auto renderStart = std::chrono::steady_clock::now();
+	long long nRenderedFrames = 0;
 
 
 	Hydrogen* pEngine = Hydrogen::get_instance();
@@ -224,44 +456,46 @@ void* diskWriterDriver_thread( void* param )
 			
 			//pDriver->m_transport.m_nFrames = frameNumber;
 			
-			int ret = pDriver->m_processCallback( usedBuffer, nullptr );
-			
-			for ( unsigned i = 0; i < usedBuffer; i++ ) {
-				if(pData_L[i] > 1){
-					pData[i * 2] = 1;
-				}
-				else if(pData_L[i] < -1){
-					pData[i * 2] = -1;
-				}else
-				{
-					pData[i * 2] = pData_L[i];
-				}
-				
-				if(pData_R[i] > 1){
-					pData[i * 2 + 1] = 1;
-				}
-				else if(pData_R[i] < -1){
-					pData[i * 2 + 1] = -1;
-				}else
-				{
-					pData[i * 2 + 1] = pData_R[i];
-				}
+			// the Sampler only adds to the stem buffers
+			for ( unsigned nStem = 0; nStem < pDriver->m_stemOuts_L.size(); ++nStem ) {
+				memset( pDriver->m_stemOuts_L[ nStem ], 0, usedBuffer * sizeof( float ) );
+				memset( pDriver->m_stemOuts_R[ nStem ], 0, usedBuffer * sizeof( float ) );
 			}
-			int res = sf_writef_float( m_file, pData, usedBuffer );
-			if ( res != ( int )usedBuffer ) {
-				__ERRORLOG( "Error during sf_write_float" );
+
+			int ret = pDriver->m_processCallback( usedBuffer, nullptr );
+			nRenderedFrames += usedBuffer;
+
+			for ( DiskWriterOutput& output : outputs ) {
+				float *pData = output.pChunks->reserve( usedBuffer );
+				diskWriterDriver_interleave( pData, output.pOut_L, output.pOut_R, usedBuffer );
+				output.pChunks->commit( usedBuffer );
 			}
 		}
 		
+		// the rate comes first, a progress of 100 ends the export
+		double fElapsed = std::chrono::duration<double>( std::chrono::steady_clock::now() - renderStart ).count();
+		if ( fElapsed > 0 ) {
+			EventQueue::get_instance()->push_event( EVENT_PROGRESS_RATE, ( int )( nRenderedFrames / fElapsed ) );
+		}
+
 		// this progress bar method is not exact but ok enough to give users a usable visible progress feedback
+		// the end is reported once the file is complete
 		float fPercent = ( float )(patternPosition +1) / ( float )nColumns * 100.0;
-		EventQueue::get_instance()->push_event( EVENT_PROGRESS, ( int )fPercent );
+		if ( patternPosition + 1 < nColumns ) {
+			EventQueue::get_instance()->push_event( EVENT_PROGRESS, ( int )fPercent );
+		}
 	}
 
-	delete[] pData;
-	pData = nullptr;
+	for ( DiskWriterOutput& output : outputs ) {
+		output.pChunks->finish();
+	}
+	for ( DiskWriterOutput& output : outputs ) {
+		output.pChunks->join();
+		delete output.pChunks;
+		sf_close( output.pFile );
+	}
 
-	sf_close( m_file );
+	EventQueue::get_instance()->push_event( EVENT_PROGRESS, 100 );
 
 	__INFOLOG( "DiskWriterDriver thread end" );
 
@@ -314,6 +548,15 @@ int DiskWriterDriver::init( unsigned nBufferSize )
 int DiskWriterDriver::connect()
 {
 	INFOLOG( "[startExport]" );
+
+	// buffers of the stems, filled by the Sampler through getTrackOut_L/R()
+	m_stemIndex.clear();
+	for ( auto it = m_stems.begin(); it != m_stems.end(); ++it ) {
+		m_stemIndex[ it->first ] = m_stemOuts_L.size();
+		m_stemOuts_L.push_back( new float[ m_nBufferSize ] );
+		m_stemOuts_R.push_back( new float[ m_nBufferSize ] );
+	}
+	__track_out_enabled = !m_stems.empty();
 	
 	pthread_attr_t attr;
 	pthread_attr_init( &attr );
@@ -334,6 +577,34 @@ void DiskWriterDriver::disconnect()
 	delete[] m_pOut_R;
 	m_pOut_R = nullptr;
 
+	__track_out_enabled = false;
+	for ( unsigned nStem = 0; nStem < m_stemOuts_L.size(); ++nStem ) {
+		delete[] m_stemOuts_L[ nStem ];
+		delete[] m_stemOuts_R[ nStem ];
+	}
+	m_stemOuts_L.clear();
+	m_stemOuts_R.clear();
+	m_stemIndex.clear();
+}
+
+float* DiskWriterDriver::getTrackOut_L( Instrument* pInstr, InstrumentComponent* pCompo )
+{
+	UNUSED( pCompo );
+	auto it = m_stemIndex.find( pInstr->get_id() );
+	if ( it == m_stemIndex.end() ) {
+		return nullptr;
+	}
+	return m_stemOuts_L[ it->second ];
+}
+
+float* DiskWriterDriver::getTrackOut_R( Instrument* pInstr, InstrumentComponent* pCompo )
+{
+	UNUSED( pCompo );
+	auto it = m_stemIndex.find( pInstr->get_id() );
+	if ( it == m_stemIndex.end() ) {
+		return nullptr;
+	}
+	return m_stemOuts_R[ it->second ];
 }
 
 
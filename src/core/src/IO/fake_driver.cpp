@@ -21,6 +21,7 @@
  */
 
 #include <hydrogen/IO/FakeDriver.h>
+#include <hydrogen/dsp_profiler.h>
 
 namespace H2Core
 {
@@ -100,9 +101,13 @@ void FakeDriver::play()
 {
 	m_transport.m_status = TransportInfo::ROLLING;
 
-	while ( m_processCallback( m_nBufferSize, nullptr ) == 0 ) {
-		// process...
-	}
+	m_cycleTimes.clear();
+	int nRes;
+	do {
+		uint64_t nStart = DspProfiler::now();
+		nRes = m_processCallback( m_nBufferSize, nullptr );
+		m_cycleTimes.push_back( ( DspProfiler::now() - nStart ) / 1000000.0f );
+	} while ( nRes == 0 );
 }
 
 void FakeDriver::stop()
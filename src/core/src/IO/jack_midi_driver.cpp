@@ -32,6 +32,7 @@
 #include <hydrogen/hydrogen.h>
 #include <hydrogen/globals.h>
 #include <hydrogen/event_queue.h>
+#include <hydrogen/realtime_note_queue.h>
 #include <hydrogen/basics/note.h>
 #include <hydrogen/basics/instrument.h>
 #include <hydrogen/basics/instrument_list.h>
@@ -82,6 +83,11 @@ JackMidiDriver::JackMidiWrite(jack_nframes_t nframes)
 	events = jack_midi_get_event_count(buf);
 #endif
 
+	/* map the JACK time of the events onto RealtimeNoteQueue::now() */
+	jack_nframes_t cycle_frame = jack_last_frame_time(jack_client);
+	jack_time_t jack_now = jack_get_time();
+	uint64_t now = RealtimeNoteQueue::now();
+
 	for (i = 0; i < events; i++) {
 		MidiMessage msg;
 
@@ -102,6 +108,9 @@ JackMidiDriver::JackMidiWrite(jack_nframes_t nframes)
 		memset(buffer, 0, sizeof(buffer));
 		memcpy(buffer, event.buffer, error);
 
+		int64_t delta = (int64_t)jack_frames_to_time(jack_client, cycle_frame + event.time) - (int64_t)jack_now;
+		msg.m_nTime = now + delta * 1000;
+
 		switch (buffer[0] >> 4) {
 		case 0x8:	 /* note off */
 			msg.m_type = MidiMessage::NOTE_OFF;
@@ -301,7 +301,7 @@ void MidiInput::handleNoteOnMessage( const MidiMessage& msg )
 			}
 		}
 
-		pEngine->addRealtimeNote( nInstrument, fVelocity, fPan_L, fPan_R, 0.0, false, true, nNote );
+		pEngine->addRealtimeNote( nInstrument, fVelocity, fPan_L, fPan_R, 0.0, false, true, nNote, msg.m_nTime );
 	}
 
 	__noteOnTick = pEngine->__getMidiRealtimeNoteTickPosition();
@@ -368,32 +368,21 @@ void MidiInput::handleNoteOffMessage( const MidiMessage& msg, bool CymbalChoke )
 		fStep = 1;
 	}
 
-	bool use_note_off = AudioEngine::get_instance()->get_sampler()->is_instrument_playing( pInstr );
-	if(use_note_off){
-		if ( Preferences::get_instance()->__playselectedinstrument ){
-			AudioEngine::get_instance()->get_sampler()->midi_keyboard_note_off( msg.m_nData1 );
-		}
-		else
-		{
-			if ( pInstrList->size() < nInstrument +1 ) {
-				return;
-			}
-			
-			Note *pOffNote = new Note( pInstr,
-										0.0,
-										0.0,
-										0.0,
-										0.0,
-										-1,
-										0 );
-			pOffNote->set_note_off( true );
-			AudioEngine::get_instance()->get_sampler()->note_on( pOffNote );
-			delete pOffNote;
-		}
-		
-		if(Preferences::get_instance()->getRecordEvents()) {
-			AudioEngine::get_instance()->get_sampler()->setPlayingNotelength( pInstr, notelength * fStep, __noteOnTick );
+	// The audio thread checks whether the notes are still playing,
+	// and gives the recorded one its length if so.
+	int nLength = -1;
+	if ( Preferences::get_instance()->getRecordEvents() ) {
+		nLength = notelength * fStep;
+	}
+	if ( Preferences::get_instance()->__playselectedinstrument ){
+		pEngine->addRealtimeNoteOff( nInstrument, msg.m_nData1, msg.m_nTime, nLength, __noteOnTick );
+	}
+	else
+	{
+		if ( pInstrList->size() < nInstrument +1 ) {
+			return;
 		}
+		pEngine->addRealtimeNoteOff( nInstrument, -1, msg.m_nTime, nLength, __noteOnTick );
 	}
 }
 
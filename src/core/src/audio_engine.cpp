@@ -23,7 +23,9 @@
 #include <hydrogen/audio_engine.h>
 
 #include <hydrogen/fx/Effects.h>
+#include <hydrogen/basics/pattern.h>
 #include <hydrogen/basics/song.h>
+#include <hydrogen/basics/song_snapshot.h>
 #include <hydrogen/IO/AudioOutput.h>
 #include <hydrogen/sampler/Sampler.h>
 
@@ -49,6 +51,12 @@ AudioEngine::AudioEngine()
 		: Object( __class_name )
 		, __sampler( nullptr )
 		, __synth( nullptr )
+		, __song( nullptr )
+		, __song_changed( false )
+		, __published_revision( -1 )
+		, __song_snapshot( new SongSnapshot( nullptr, nullptr, 1 ) )
+		, __song_snapshot_in_use( 0 )
+		, __engine_holds_song( false )
 {
 	__instance = this;
 	INFOLOG( "INIT" );
@@ -76,6 +84,11 @@ AudioEngine::~AudioEngine()
 //	delete Sequencer::get_instance();
 	delete __sampler;
 	delete __synth;
+
+	for ( SongSnapshot* snapshot : __retired_snapshots ) {
+		delete snapshot;
+	}
+	delete __song_snapshot.load();
 }
 
 
@@ -101,6 +114,13 @@ void AudioEngine::lock( const char* file, unsigned int line, const char* functio
 	__locker.file = file;
 	__locker.line = line;
 	__locker.function = function;
+
+	// the threads holding the engine may edit any part of the song
+	__song_mutex.lock();
+	__engine_holds_song = true;
+	if ( !__song_changed ) {
+		__song_snapshot.load( std::memory_order_relaxed )->sync_played();
+	}
 }
 
 
@@ -115,6 +135,7 @@ bool AudioEngine::try_lock( const char* file, unsigned int line, const char* fun
 	__locker.file = file;
 	__locker.line = line;
 	__locker.function = function;
+	__engine_holds_song = false;
 	return true;
 }
 
@@ -128,9 +149,84 @@ float AudioEngine::compute_tick_size(int sampleRate, int bpm, int resolution)
 
 void AudioEngine::unlock()
 {
+	bool holds_song = __engine_holds_song;
+	__engine_holds_song = false;
+	if ( holds_song ) {
+		// The audio thread is between two cycles and takes the
+		// current snapshot or a newer one next, so the retired
+		// ones can go.
+		__song_snapshot_in_use.store( __song_snapshot.load( std::memory_order_relaxed )->get_version(),
+									  std::memory_order_release );
+	}
 	// Leave "__locker" dirty.
 	pthread_mutex_unlock( &__engine_mutex );
+
+	if ( holds_song ) {
+		// The audio thread keeps on playing the previous snapshot
+		// while the new one is compiled.
+		publish_song();
+		__song_mutex.unlock();
+	}
 }
 
+void AudioEngine::lock_song()
+{
+	__song_mutex.lock();
+	if ( !__song_changed ) {
+		__song_snapshot.load( std::memory_order_relaxed )->sync_played();
+	}
+}
+
+void AudioEngine::unlock_song()
+{
+	publish_song();
+	__song_mutex.unlock();
+}
+
+void AudioEngine::set_song( Song* song )
+{
+	__song = song;
+	__song_changed = true;
+}
+
+SongSnapshot* AudioEngine::acquire_song_snapshot()
+{
+	SongSnapshot* snapshot = __song_snapshot.load( std::memory_order_acquire );
+	__song_snapshot_in_use.store( snapshot->get_version(), std::memory_order_release );
+	return snapshot;
+}
+
+void AudioEngine::publish_song()
+{
+	SongSnapshot* current = __song_snapshot.load( std::memory_order_relaxed );
+	int revision = Pattern::get_last_revision();
+	if ( __song_changed || revision != __published_revision ) {
+		// the previous snapshot is only reused for the same song
+		SongSnapshot* snapshot = new SongSnapshot( __song, __song_changed ? nullptr : current,
+												   current->get_version() + 1 );
+		__song_changed = false;
+		__published_revision = revision;
+		if ( snapshot->has_changed() ) {
+			__song_snapshot.store( snapshot, std::memory_order_release );
+			__retired_snapshots.push_back( current );
+		} else {
+			delete snapshot;
+		}
+	}
+
+	// The audio thread moves on to newer versions only, so it is
+	// done with the ones older than the one it acquired last. It
+	// never gets here, try_lock() leaves the song to the others.
+	int in_use = __song_snapshot_in_use.load( std::memory_order_acquire );
+	std::vector<SongSnapshot*>::iterator it = __retired_snapshots.begin();
+	while ( it != __retired_snapshots.end() ) {
+		if ( ( *it )->get_version() < in_use ) {
+			delete *it;
+			it = __retired_snapshots.erase( it );
+		} else {
+			++it;
+		}
+	}
+}
 
 }; // namespace H2Core
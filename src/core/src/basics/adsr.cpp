@@ -92,6 +92,19 @@ ADSR::ADSR( const ADSR* other ) : Object( __class_name ),
 
 ADSR::~ADSR() { }
 
+void ADSR::copy_from( const ADSR* other )
+{
+	__attack = other->__attack;
+	__decay = other->__decay;
+	__sustain = other->__sustain;
+	__release = other->__release;
+	__state = other->__state;
+	__ticks = other->__ticks;
+	__value = other->__value;
+	__release_value = other->__release_value;
+	normalise();
+}
+
 //#define convex_exponant
 //#define concave_exponant
 
@@ -148,6 +161,22 @@ float ADSR::get_value( float step )
 	return __value;
 }
 
+void ADSR::get_values( float* pBuffer, int nFrames, float step )
+{
+	int i = 0;
+	while ( i < nFrames ) {
+		if ( __state == SUSTAIN || __state == IDLE ) {
+			// constant from here on, no need to walk the state machine
+			float fValue = get_value( step );
+			for ( ; i < nFrames; ++i ) {
+				pBuffer[ i ] = fValue;
+			}
+			return;
+		}
+		pBuffer[ i++ ] = get_value( step );
+	}
+}
+
 void ADSR::attack()
 {
 	__state = ATTACK;
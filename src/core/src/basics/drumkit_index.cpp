@@ -0,0 +1,278 @@
+/*
+ * Hydrogen
+ * Copyright(c) 2002-2008 by Alex >Comix< Cominu [comix@users.sourceforge.net]
+ *
+ * http://www.hydrogen-music.org
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY, without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ */
+
+#include <hydrogen/basics/drumkit_index.h>
+
+#include <QDataStream>
+#include <QDateTime>
+#include <QDir>
+#include <QFile>
+#include <QFileInfo>
+#include <QSaveFile>
+
+#include <hydrogen/basics/drumkit.h>
+#include <hydrogen/basics/drumkit_component.h>
+#include <hydrogen/basics/instrument.h>
+#include <hydrogen/basics/instrument_component.h>
+#include <hydrogen/basics/instrument_layer.h>
+#include <hydrogen/basics/instrument_list.h>
+#include <hydrogen/basics/sample.h>
+#include <hydrogen/helpers/filesystem.h>
+
+namespace H2Core
+{
+
+const char* DrumkitIndex::__class_name = "DrumkitIndex";
+
+DrumkitIndex* DrumkitIndex::__instance = nullptr;
+
+/** "H2DI" */
+static const quint32 DRUMKIT_INDEX_MAGIC = 0x48324449;
+/** bumped whenever Entry changes */
+static const quint32 DRUMKIT_INDEX_VERSION = 1;
+
+void DrumkitIndex::create_instance()
+{
+	if ( __instance == nullptr ) {
+		__instance = new DrumkitIndex( Filesystem::cache_dir() + "drumkits.idx",
+									   Filesystem::sys_drumkits_dir(), Filesystem::usr_drumkits_dir() );
+	}
+}
+
+DrumkitIndex::DrumkitIndex( const QString& index_file, const QString& sys_dir, const QString& usr_dir ) : Object( __class_name ),
+	__index_file( index_file ),
+	__sys_dir( sys_dir ),
+	__usr_dir( usr_dir ),
+	__parsed( 0 )
+{
+	if ( QFile::exists( __index_file ) && !load() ) {
+		WARNINGLOG( QString( "Ignoring %1" ).arg( __index_file ) );
+		__roots.clear();
+		__entries.clear();
+	}
+	INFOLOG( QString( "INIT, %1 drumkits indexed" ).arg( __entries.size() ) );
+}
+
+DrumkitIndex::~DrumkitIndex()
+{
+	if ( __instance == this ) {
+		__instance = nullptr;
+	}
+}
+
+bool DrumkitIndex::read_entry( const QString& path, Entry* entry )
+{
+	Drumkit* drumkit = Drumkit::load_file( Filesystem::drumkit_file( path ), false );
+	if ( drumkit == nullptr ) {
+		return false;
+	}
+	entry->name = drumkit->get_name();
+	entry->author = drumkit->get_author();
+	entry->info = drumkit->get_info();
+	entry->license = drumkit->get_license();
+	entry->image = drumkit->get_image();
+	entry->components.clear();
+	for ( DrumkitComponent* component : *drumkit->get_components() ) {
+		entry->components << component->get_name();
+	}
+	entry->instruments.clear();
+	entry->samples.clear();
+	entry->samples_size = 0;
+	InstrumentList* instruments = drumkit->get_instruments();
+	for ( int i = 0; i < instruments->size(); i++ ) {
+		Instrument* instrument = instruments->get( i );
+		entry->instruments << instrument->get_name();
+		for ( InstrumentComponent* component : *instrument->get_components() ) {
+			for ( int n = 0; n < InstrumentComponent::getMaxLayers(); n++ ) {
+				InstrumentLayer* layer = component->get_layer( n );
+				if ( layer == nullptr || layer->get_sample() == nullptr ) {
+					continue;
+				}
+				QString sample = layer->get_sample()->get_filepath();
+				entry->samples << sample;
+				entry->samples_size += QFileInfo( sample ).size();
+			}
+		}
+	}
+	delete drumkit;
+	return true;
+}
+
+bool DrumkitIndex::refresh_root( const QString& dir, bool system, std::vector<Entry>& entries )
+{
+	bool changed = false;
+	qint64 mtime = QFileInfo( dir ).lastModified().toMSecsSinceEpoch();
+	auto root = __roots.find( dir );
+	if ( root == __roots.end() || root->second.mtime != mtime ) {
+		// a drumkit was added, removed or renamed
+		Root listed;
+		listed.mtime = mtime;
+		listed.dirs = QDir( dir ).entryList( QDir::Dirs | QDir::Readable | QDir::NoDotAndDotDot );
+		__roots[ dir ] = listed;
+		root = __roots.find( dir );
+		changed = true;
+	}
+
+	std::map<QString, const Entry*> previous;
+	for ( const Entry& entry : __entries ) {
+		previous[ entry.path ] = &entry;
+	}
+	for ( const QString& name : root->second.dirs ) {
+		QString path = dir + name;
+		QFileInfo file( Filesystem::drumkit_file( path ) );
+		if ( !file.isReadable() ) {
+			continue;
+		}
+		qint64 file_mtime = file.lastModified().toMSecsSinceEpoch();
+		auto it = previous.find( path );
+		if ( it != previous.end() && it->second->mtime == file_mtime && it->second->size == file.size() ) {
+			entries.push_back( *it->second );
+			continue;
+		}
+		Entry entry;
+		entry.path = path;
+		entry.system = system;
+		entry.mtime = file_mtime;
+		entry.size = file.size();
+		__parsed++;
+		changed = true;
+		if ( read_entry( path, &entry ) ) {
+			entries.push_back( entry );
+		} else {
+			ERRORLOG( QString( "drumkit %1 is not usable" ).arg( path ) );
+		}
+	}
+	return changed;
+}
+
+bool DrumkitIndex::refresh()
+{
+	std::lock_guard<std::mutex> lock( __mutex );
+	__parsed = 0;
+	std::vector<Entry> entries;
+	bool changed = refresh_root( __sys_dir, true, entries );
+	changed = refresh_root( __usr_dir, false, entries ) || changed;
+	// a removed drumkit leaves its directory
+	changed = changed || entries.size() != __entries.size();
+	__entries.swap( entries );
+	if ( changed ) {
+		INFOLOG( QString( "%1 drumkits indexed, %2 parsed" ).arg( __entries.size() ).arg( __parsed ) );
+		save();
+	}
+	return changed;
+}
+
+std::vector<DrumkitIndex::Entry> DrumkitIndex::get_drumkits( bool system ) const
+{
+	std::lock_guard<std::mutex> lock( __mutex );
+	std::vector<Entry> drumkits;
+	for ( const Entry& entry : __entries ) {
+		if ( entry.system == system ) {
+			drumkits.push_back( entry );
+		}
+	}
+	return drumkits;
+}
+
+bool DrumkitIndex::find( const QString& name, Entry* entry ) const
+{
+	std::lock_guard<std::mutex> lock( __mutex );
+	const Entry* found = nullptr;
+	for ( const Entry& candidate : __entries ) {
+		if ( candidate.name == name && ( found == nullptr || found->system ) ) {
+			found = &candidate;
+		}
+	}
+	if ( found == nullptr ) {
+		return false;
+	}
+	*entry = *found;
+	return true;
+}
+
+int DrumkitIndex::get_parsed() const
+{
+	std::lock_guard<std::mutex> lock( __mutex );
+	return __parsed;
+}
+
+bool DrumkitIndex::load()
+{
+	QFile file( __index_file );
+	if ( !file.open( QIODevice::ReadOnly ) ) {
+		return false;
+	}
+	QDataStream in( &file );
+	in.setVersion( QDataStream::Qt_5_0 );
+	quint32 magic, version, roots, entries;
+	in >> magic >> version;
+	if ( magic != DRUMKIT_INDEX_MAGIC || version != DRUMKIT_INDEX_VERSION ) {
+		return false;
+	}
+	in >> roots;
+	for ( quint32 i = 0; i < roots && in.status() == QDataStream::Ok; i++ ) {
+		QString dir;
+		Root root;
+		in >> dir >> root.mtime >> root.dirs;
+		__roots[ dir ] = root;
+	}
+	in >> entries;
+	for ( quint32 i = 0; i < entries && in.status() == QDataStream::Ok; i++ ) {
+		Entry entry;
+		in >> entry.path >> entry.system >> entry.mtime >> entry.size
+		   >> entry.name >> entry.author >> entry.info >> entry.license >> entry.image
+		   >> entry.components >> entry.instruments >> entry.samples >> entry.samples_size;
+		__entries.push_back( entry );
+	}
+	return in.status() == QDataStream::Ok;
+}
+
+bool DrumkitIndex::save() const
+{
+	QSaveFile file( __index_file );
+	if ( !file.open( QIODevice::WriteOnly ) ) {
+		ERRORLOG( QString( "Unable to write %1: %2" ).arg( __index_file ).arg( file.errorString() ) );
+		return false;
+	}
+	QDataStream out( &file );
+	out.setVersion( QDataStream::Qt_5_0 );
+	out << DRUMKIT_INDEX_MAGIC << DRUMKIT_INDEX_VERSION;
+	out << ( quint32 )__roots.size();
+	for ( const auto& root : __roots ) {
+		out << root.first << root.second.mtime << root.second.dirs;
+	}
+	out << ( quint32 )__entries.size();
+	for ( const Entry& entry : __entries ) {
+		out << entry.path << entry.system << entry.mtime << entry.size
+			<< entry.name << entry.author << entry.info << entry.license << entry.image
+			<< entry.components << entry.instruments << entry.samples << entry.samples_size;
+	}
+	if ( out.status() != QDataStream::Ok || !file.commit() ) {
+		ERRORLOG( QString( "Unable to write %1: %2" ).arg( __index_file ).arg( file.errorString() ) );
+		return false;
+	}
+	return true;
+}
+
+};
+
+/* vim: set softtabstop=4 noexpandtab: */
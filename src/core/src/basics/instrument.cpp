@@ -22,6 +22,7 @@
 
 #include <hydrogen/basics/instrument.h>
 
+#include <algorithm>
 #include <cassert>
 
 #include <hydrogen/audio_engine.h>
@@ -52,6 +53,8 @@ Instrument::Instrument( const int id, const QString& name, ADSR* adsr )
 	, __pan_r( 1.0 )
 	, __peak_l( 0.0 )
 	, __peak_r( 0.0 )
+	, __energy_l( 0.0 )
+	, __energy_r( 0.0 )
 	, __adsr( adsr )
 	, __filter_active( false )
 	, __filter_cutoff( 1.0 )
@@ -101,8 +104,10 @@ Instrument::Instrument( Instrument* other )
 	, __volume( other->get_volume() )
 	, __pan_l( other->get_pan_l() )
 	, __pan_r( other->get_pan_r() )
-	, __peak_l( other->get_peak_l() )
-	, __peak_r( other->get_peak_r() )
+	, __peak_l( 0.0 )
+	, __peak_r( 0.0 )
+	, __energy_l( 0.0 )
+	, __energy_r( 0.0 )
 	, __adsr( new ADSR( *( other->get_adsr() ) ) )
 	, __filter_active( other->is_filter_active() )
 	, __filter_cutoff( other->get_filter_cutoff() )
@@ -247,6 +252,34 @@ void Instrument::load_from( Drumkit* pDrumkit, Instrument* pInstrument, bool is_
 	}
 }
 
+void Instrument::take_from( Instrument* pInstrument )
+{
+	std::swap( __components, pInstrument->__components );
+	std::swap( __adsr, pInstrument->__adsr );
+
+	this->set_id( pInstrument->get_id() );
+	this->set_name( pInstrument->get_name() );
+	this->set_drumkit_name( pInstrument->get_drumkit_name() );
+	this->set_gain( pInstrument->get_gain() );
+	this->set_volume( pInstrument->get_volume() );
+	this->set_pan_l( pInstrument->get_pan_l() );
+	this->set_pan_r( pInstrument->get_pan_r() );
+	this->set_filter_active( pInstrument->is_filter_active() );
+	this->set_filter_cutoff( pInstrument->get_filter_cutoff() );
+	this->set_filter_resonance( pInstrument->get_filter_resonance() );
+	this->set_random_pitch_factor( pInstrument->get_random_pitch_factor() );
+	this->set_muted( pInstrument->is_muted() );
+	this->set_mute_group( pInstrument->get_mute_group() );
+	this->set_midi_out_channel( pInstrument->get_midi_out_channel() );
+	this->set_midi_out_note( pInstrument->get_midi_out_note() );
+	this->set_stop_notes( pInstrument->is_stop_notes() );
+	this->set_sample_selection_alg( pInstrument->sample_selection_alg() );
+	this->set_hihat_grp( pInstrument->get_hihat_grp() );
+	this->set_lower_cc( pInstrument->get_lower_cc() );
+	this->set_higher_cc( pInstrument->get_higher_cc() );
+	this->set_apply_velocity ( pInstrument->get_apply_velocity() );
+}
+
 void Instrument::load_from( const QString& dk_name, const QString& instrument_name, bool is_live )
 {
 	Drumkit* pDrumkit = Drumkit::load_by_name( dk_name );
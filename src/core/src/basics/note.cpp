@@ -39,93 +39,109 @@ const char* Note::__key_str[] = { "C", "Cs", "D", "Ef", "E", "F", "Fs", "G", "Af
 
 Note::Note( Instrument* instrument, int position, float velocity, float pan_l, float pan_r, int length, float pitch )
 	: Object( __class_name ),
-	  __instrument( instrument ),
-	  __instrument_id( 0 ),
-	  __specific_compo_id( -1 ),
-	  __position( position ),
-	  __velocity( velocity ),
-	  __pan_l( PAN_MAX ),
-	  __pan_r( PAN_MAX ),
-	  __length( length ),
-	  __pitch( pitch ),
-	  __key( C ),
-	  __octave( P8 ),
 	  __adsr( nullptr ),
-	  __lead_lag( 0.0 ),
-	  __cut_off( 1.0 ),
-	  __resonance( 0.0 ),
-	  __humanize_delay( 0 ),
-	  __bpfb_l( 0.0 ),
-	  __bpfb_r( 0.0 ),
-	  __lpfb_l( 0.0 ),
-	  __lpfb_r( 0.0 ),
-	  __pattern_idx( 0 ),
-	  __midi_msg( -1 ),
-	  __note_off( false ),
-	  __just_recorded( false ),
-	  __probability( 1.0f )
-{
-	if ( __instrument != nullptr ) {
-		__adsr = __instrument->copy_adsr();
-		__instrument_id = __instrument->get_id();
+	  __pool_index( -1 )
+{
+	reset( instrument, position, velocity, pan_l, pan_r, length, pitch );
+}
 
-		for (std::vector<InstrumentComponent*>::iterator it = __instrument->get_components()->begin() ; it !=__instrument->get_components()->end(); ++it) {
-			InstrumentComponent *pCompo = *it;
+Note::Note( Note* other, Instrument* instrument )
+	: Object( __class_name ),
+	  __adsr( nullptr ),
+	  __pool_index( -1 )
+{
+	reset( other, instrument );
+}
 
-			SelectedLayerInfo *sampleInfo = new SelectedLayerInfo;
-			sampleInfo->SelectedLayer = -1;
-			sampleInfo->SamplePosition = 0;
+void Note::reset( Instrument* instrument, int position, float velocity, float pan_l, float pan_r, int length, float pitch )
+{
+	__instrument = instrument;
+	__instrument_id = 0;
+	__specific_compo_id = -1;
+	__position = position;
+	__velocity = velocity;
+	__pan_l = PAN_MAX;
+	__pan_r = PAN_MAX;
+	__length = length;
+	__pitch = pitch;
+	__key = C;
+	__octave = P8;
+	__lead_lag = 0.0;
+	__cut_off = 1.0;
+	__resonance = 0.0;
+	__humanize_delay = 0;
+	__bpfb_l = 0.0;
+	__bpfb_r = 0.0;
+	__lpfb_l = 0.0;
+	__lpfb_r = 0.0;
+	__pattern_idx = 0;
+	__midi_msg = -1;
+	__note_off = false;
+	__just_recorded = false;
+	__probability = 1.0f;
 
-			__layers_selected[ pCompo->get_drumkit_componentID() ] = sampleInfo;
-		}
-	}
+	init_instrument_state();
 
 	set_pan_l(pan_l);
 	set_pan_r(pan_r);
 }
 
-Note::Note( Note* other, Instrument* instrument )
-	: Object( __class_name ),
-	  __instrument( other->get_instrument() ),
-	  __instrument_id( 0 ),
-	  __specific_compo_id( -1 ),
-	  __position( other->get_position() ),
-	  __velocity( other->get_velocity() ),
-	  __pan_l( other->get_pan_l() ),
-	  __pan_r( other->get_pan_r() ),
-	  __length( other->get_length() ),
-	  __pitch( other->get_pitch() ),
-	  __key( other->get_key() ),
-	  __octave( other->get_octave() ),
-	  __adsr( nullptr ),
-	  __lead_lag( other->get_lead_lag() ),
-	  __cut_off( other->get_cut_off() ),
-	  __resonance( other->get_resonance() ),
-	  __humanize_delay( other->get_humanize_delay() ),
-	  __bpfb_l( other->get_bpfb_l() ),
-	  __bpfb_r( other->get_bpfb_r() ),
-	  __lpfb_l( other->get_lpfb_l() ),
-	  __lpfb_r( other->get_lpfb_r() ),
-	  __pattern_idx( other->get_pattern_idx() ),
-	  __midi_msg( other->get_midi_msg() ),
-	  __note_off( other->get_note_off() ),
-	  __just_recorded( other->get_just_recorded() ),
-	  __probability( other->get_probability() )
-{
-	if ( instrument != nullptr ) __instrument = instrument;
-	if ( __instrument != nullptr ) {
+void Note::reset( Note* other, Instrument* instrument )
+{
+	__instrument = ( instrument != nullptr ? instrument : other->get_instrument() );
+	__instrument_id = 0;
+	__specific_compo_id = -1;
+	__position = other->get_position();
+	__velocity = other->get_velocity();
+	__pan_l = other->get_pan_l();
+	__pan_r = other->get_pan_r();
+	__length = other->get_length();
+	__pitch = other->get_pitch();
+	__key = other->get_key();
+	__octave = other->get_octave();
+	__lead_lag = other->get_lead_lag();
+	__cut_off = other->get_cut_off();
+	__resonance = other->get_resonance();
+	__humanize_delay = other->get_humanize_delay();
+	__bpfb_l = other->get_bpfb_l();
+	__bpfb_r = other->get_bpfb_r();
+	__lpfb_l = other->get_lpfb_l();
+	__lpfb_r = other->get_lpfb_r();
+	__pattern_idx = other->get_pattern_idx();
+	__midi_msg = other->get_midi_msg();
+	__note_off = other->get_note_off();
+	__just_recorded = other->get_just_recorded();
+	__probability = other->get_probability();
+
+	init_instrument_state();
+}
+
+void Note::init_instrument_state()
+{
+	__layers_selected.clear();
+	if ( __instrument == nullptr ) {
+		return;
+	}
+
+	// a recycled note keeps its ADSR, only the values are copied
+	if ( __adsr != nullptr ) {
+		__adsr->copy_from( __instrument->get_adsr() );
+	} else {
 		__adsr = __instrument->copy_adsr();
-		__instrument_id = __instrument->get_id();
+	}
+	__instrument_id = __instrument->get_id();
 
-		for (std::vector<InstrumentComponent*>::iterator it = __instrument->get_components()->begin() ; it !=__instrument->get_components()->end(); ++it) {
-			InstrumentComponent *pCompo = *it;
+	for (std::vector<InstrumentComponent*>::iterator it = __instrument->get_components()->begin() ; it !=__instrument->get_components()->end(); ++it) {
+		InstrumentComponent *pCompo = *it;
 
-			SelectedLayerInfo *sampleInfo = new SelectedLayerInfo;
-			sampleInfo->SelectedLayer = -1;
-			sampleInfo->SamplePosition = 0;
+		SelectedLayerInfo sampleInfo;
+		sampleInfo.SelectedLayer = -1;
+		sampleInfo.SamplePosition = 0;
+		sampleInfo.StreamID = -1;
+		sampleInfo.VariantID = -1;
+		sampleInfo.VariantPosition = 0;
 
-			__layers_selected[ pCompo->get_drumkit_componentID() ] = sampleInfo;
-		}
+		__layers_selected.push_back( std::make_pair( pCompo->get_drumkit_componentID(), sampleInfo ) );
 	}
 }
 
@@ -172,6 +188,7 @@ void Note::map_instrument( InstrumentList* instruments )
 	} else {
 		__instrument = instr;
 	}
+	init_instrument_state();
 }
 
 QString Note::key_to_string()
@@ -246,6 +263,52 @@ Note* Note::load_from( XMLNode* node, InstrumentList* instruments )
 	return note;
 }
 
+Note* Note::load_from( XMLStreamReader* reader, InstrumentList* instruments )
+{
+	int position = 0, length = -1, instrument_id = EMPTY_INSTR_ID;
+	float velocity = 0.8f, pan_l = 0.5f, pan_r = 0.5f, pitch = 0.0f, lead_lag = 0.0f, probability = 1.0f;
+	QString key = "C0";
+	bool note_off = false;
+	while ( reader->readNextStartElement() ) {
+		QStringRef name = reader->name();
+		if ( name == "position" ) {
+			position = reader->read_int( 0 );
+		} else if ( name == "velocity" ) {
+			velocity = reader->read_float( 0.8f );
+		} else if ( name == "pan_L" ) {
+			pan_l = reader->read_float( 0.5f );
+		} else if ( name == "pan_R" ) {
+			pan_r = reader->read_float( 0.5f );
+		} else if ( name == "length" ) {
+			length = reader->read_int( -1 );
+		} else if ( name == "pitch" ) {
+			pitch = reader->read_float( 0.0f );
+		} else if ( name == "leadlag" ) {
+			lead_lag = reader->read_float( 0.0f );
+		} else if ( name == "key" ) {
+			key = reader->read_string( "C0" );
+		} else if ( name == "note_off" ) {
+			note_off = reader->read_bool( false );
+		} else if ( name == "instrument" ) {
+			instrument_id = reader->read_int( EMPTY_INSTR_ID );
+		} else if ( name == "probability" ) {
+			probability = reader->read_float( 1.0f );
+		} else {
+			reader->skipCurrentElement();
+		}
+	}
+	Note* note = new Note( nullptr, position, velocity, pan_l, pan_r, length, pitch );
+	note->set_lead_lag( lead_lag );
+	note->set_key_octave( key );
+	note->set_note_off( note_off );
+	note->set_instrument_id( instrument_id );
+	if ( instruments != nullptr ) {
+		note->map_instrument( instruments );
+	}
+	note->set_probability( probability );
+	return note;
+}
+
 };
 
 /* vim: set softtabstop=4 noexpandtab: */
@@ -0,0 +1,142 @@
+/*
+ * Hydrogen
+ * Copyright(c) 2002-2008 by Alex >Comix< Cominu [comix@users.sourceforge.net]
+ *
+ * http://www.hydrogen-music.org
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY, without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ */
+
+#include <hydrogen/basics/note_pool.h>
+
+#include <hydrogen/basics/adsr.h>
+
+namespace H2Core
+{
+
+const char* NotePool::__class_name = "NotePool";
+NotePool* NotePool::__instance = nullptr;
+
+static const uint32_t NIL = 0xffffffff;
+
+void NotePool::create_instance()
+{
+	if ( __instance == nullptr ) {
+		__instance = new NotePool( NOTE_POOL_SIZE );
+	}
+}
+
+NotePool::NotePool( int nCapacity )
+	: Object( __class_name ),
+	  __next( new std::atomic<uint32_t>[ nCapacity ] ),
+	  __head( NIL ),
+	  __available( 0 ),
+	  __exhausted( 0 )
+{
+	__notes.reserve( nCapacity );
+	for ( int i = 0; i < nCapacity; i++ ) {
+		Note* pNote = new Note( nullptr, 0, 0.0, 0.0, 0.0, -1, 0 );
+		pNote->__pool_index = i;
+		pNote->__adsr = new ADSR();
+		pNote->__layers_selected.reserve( NOTE_POOL_COMPONENTS );
+		__notes.push_back( pNote );
+	}
+	// push in reverse order so that the first acquired notes are the first allocated
+	for ( int i = nCapacity - 1; i >= 0; i-- ) {
+		push( i );
+	}
+	INFOLOG( QString( "%1 notes preallocated" ).arg( nCapacity ) );
+}
+
+NotePool::~NotePool()
+{
+	if ( __available.load() != get_capacity() ) {
+		ERRORLOG( QString( "%1 notes still in use" ).arg( get_capacity() - __available.load() ) );
+	}
+	for ( auto pNote : __notes ) {
+		delete pNote;
+	}
+	__notes.clear();
+	if ( __instance == this ) {
+		__instance = nullptr;
+	}
+}
+
+Note* NotePool::pop()
+{
+	uint64_t nHead = __head.load( std::memory_order_acquire );
+	for ( ;; ) {
+		uint32_t nIndex = (uint32_t)nHead;
+		if ( nIndex == NIL ) {
+			return nullptr;
+		}
+		uint64_t nNewHead = ( ( ( nHead >> 32 ) + 1 ) << 32 ) | __next[ nIndex ].load( std::memory_order_relaxed );
+		if ( __head.compare_exchange_weak( nHead, nNewHead, std::memory_order_acq_rel, std::memory_order_acquire ) ) {
+			__available.fetch_sub( 1, std::memory_order_relaxed );
+			return __notes[ nIndex ];
+		}
+	}
+}
+
+void NotePool::push( uint32_t nIndex )
+{
+	uint64_t nHead = __head.load( std::memory_order_relaxed );
+	uint64_t nNewHead;
+	do {
+		__next[ nIndex ].store( (uint32_t)nHead, std::memory_order_relaxed );
+		nNewHead = ( ( ( nHead >> 32 ) + 1 ) << 32 ) | nIndex;
+	} while ( !__head.compare_exchange_weak( nHead, nNewHead, std::memory_order_release, std::memory_order_relaxed ) );
+	__available.fetch_add( 1, std::memory_order_relaxed );
+}
+
+Note* NotePool::acquire( Instrument* instrument, int position, float velocity, float pan_l, float pan_r, int length, float pitch )
+{
+	Note* pNote = pop();
+	if ( pNote == nullptr ) {
+		__exhausted.fetch_add( 1, std::memory_order_relaxed );
+		return new Note( instrument, position, velocity, pan_l, pan_r, length, pitch );
+	}
+	pNote->reset( instrument, position, velocity, pan_l, pan_r, length, pitch );
+	return pNote;
+}
+
+Note* NotePool::acquire( Note* other, Instrument* instrument )
+{
+	Note* pNote = pop();
+	if ( pNote == nullptr ) {
+		__exhausted.fetch_add( 1, std::memory_order_relaxed );
+		return new Note( other, instrument );
+	}
+	pNote->reset( other, instrument );
+	return pNote;
+}
+
+void NotePool::release( Note* note )
+{
+	if ( note == nullptr ) {
+		return;
+	}
+	if ( note->__pool_index < 0 ) {
+		delete note;
+		return;
+	}
+	assert( note->__pool_index < get_capacity() && __notes[ note->__pool_index ] == note );
+	push( note->__pool_index );
+}
+
+};
+
+/* vim: set softtabstop=4 noexpandtab: */
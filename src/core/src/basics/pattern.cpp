@@ -37,12 +37,15 @@ namespace H2Core
 
 const char* Pattern::__class_name = "Pattern";
 
+std::atomic<int> Pattern::__last_revision( 0 );
+
 Pattern::Pattern( const QString& name, const QString& info, const QString& category, int length )
 	: Object( __class_name )
 	, __length( length )
 	, __name( name )
 	, __info( info )
 	, __category( category )
+	, __revision( next_revision() )
 {
 }
 
@@ -52,6 +55,7 @@ Pattern::Pattern( Pattern* other )
 	, __name( other->get_name() )
 	, __info( other->get_info() )
 	, __category( other->get_category() )
+	, __revision( next_revision() )
 {
 	FOREACH_NOTE_CST_IT_BEGIN_END( other->get_notes(),it ) {
 		__notes.insert( std::make_pair( it->first, new Note( it->second ) ) );
@@ -69,6 +73,26 @@ Pattern* Pattern::load_file( const QString& pattern_path, InstrumentList* instru
 {
 	INFOLOG( QString( "Load pattern %1" ).arg( pattern_path ) );
 	if ( !Filesystem::file_readable( pattern_path ) ) return nullptr;
+
+	// the notes are read in a single pass, the documents this
+	// does not fit are validated and handed over to the legacy
+	// code below
+	XMLStreamReader reader;
+	if ( reader.open( pattern_path ) && reader.readNextStartElement() && reader.name() == "drumkit_pattern" ) {
+		while ( reader.readNextStartElement() ) {
+			if ( reader.name() != "pattern" ) {
+				reader.skipCurrentElement();
+				continue;
+			}
+			Pattern* pattern = load_from( &reader, instruments );
+			if ( pattern != nullptr && !reader.hasError() ) {
+				return pattern;
+			}
+			delete pattern;
+			break;
+		}
+	}
+
 	XMLDoc doc;
 	if( !doc.read( pattern_path, Filesystem::pattern_xsd_path() ) ) {
 		return Legacy::load_drumkit_pattern( pattern_path, instruments );
@@ -112,6 +136,44 @@ Pattern* Pattern::load_from( XMLNode* node, InstrumentList* instruments )
 	return pattern;
 }
 
+Pattern* Pattern::load_from( XMLStreamReader* reader, InstrumentList* instruments )
+{
+	QString name, info, category = "unknown";
+	int size = -1;
+	Pattern* pattern = new Pattern( name, info, category, size );
+	while ( reader->readNextStartElement() ) {
+		QStringRef element = reader->name();
+		if ( element == "name" ) {
+			name = reader->read_string( nullptr );
+		} else if ( element == "info" ) {
+			info = reader->read_string( "" );
+		} else if ( element == "category" ) {
+			category = reader->read_string( "unknown" );
+		} else if ( element == "size" ) {
+			size = reader->read_int( -1 );
+		} else if ( element == "noteList" ) {
+			while ( reader->readNextStartElement() ) {
+				if ( reader->name() == "note" ) {
+					pattern->insert_note( Note::load_from( reader, instruments ) );
+				} else {
+					reader->skipCurrentElement();
+				}
+			}
+		} else if ( element == "pattern_name" ) {
+			// written by older versions, left to the legacy code
+			delete pattern;
+			return nullptr;
+		} else {
+			reader->skipCurrentElement();
+		}
+	}
+	pattern->set_name( name.isEmpty() ? "unknown" : name );
+	pattern->set_info( info );
+	pattern->set_category( category );
+	pattern->set_length( size );
+	return pattern;
+}
+
 bool Pattern::save_file( const QString& drumkit_name, const QString& author, const QString& license, const QString& pattern_path, bool overwrite ) const
 {
 	INFOLOG( QString( "Saving pattern into %1" ).arg( pattern_path ) );
@@ -203,6 +265,7 @@ void Pattern::remove_note( Note* note )
 	for( notes_it_t it=__notes.begin(); it!=__notes.end(); ++it ) {
 		if( it->second==note ) {
 			__notes.erase( it );
+			__revision = next_revision();
 			break;
 		}
 	}
@@ -229,17 +292,18 @@ void Pattern::purge_instrument( Instrument* instr )
 		assert( note );
 		if ( note->get_instrument() == instr ) {
 			if ( !locked ) {
-				H2Core::AudioEngine::get_instance()->lock( RIGHT_HERE );
+				H2Core::AudioEngine::get_instance()->lock_song();
 				locked = true;
 			}
 			slate.push_back( note );
 			__notes.erase( it++ );
+			__revision = next_revision();
 		} else {
 			++it;
 		}
 	}
 	if ( locked ) {
-		H2Core::AudioEngine::get_instance()->unlock();
+		H2Core::AudioEngine::get_instance()->unlock_song();
 		while ( slate.size() ) {
 			delete slate.front();
 			slate.pop_front();
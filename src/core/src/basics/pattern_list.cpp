@@ -31,10 +31,12 @@ namespace H2Core
 const char* PatternList::__class_name = "PatternList";
 
 PatternList::PatternList() : Object( __class_name )
+	, __revision( Pattern::next_revision() )
 {
 }
 
 PatternList::PatternList( PatternList* other ) : Object( __class_name )
+	, __revision( Pattern::next_revision() )
 {
 	assert( __patterns.size() == 0 );
 	for ( int i=0; i<other->size(); i++ ) {
@@ -57,6 +59,7 @@ void PatternList::operator<<( Pattern* pattern )
 		if( __patterns[i]==pattern ) return;
 	}
 	__patterns.push_back( pattern );
+	__revision = Pattern::next_revision();
 }
 
 void PatternList::add( Pattern* pattern )
@@ -66,6 +69,7 @@ void PatternList::add( Pattern* pattern )
 		if( __patterns[i]==pattern ) return;
 	}
 	__patterns.push_back( pattern );
+	__revision = Pattern::next_revision();
 }
 
 void PatternList::insert( int idx, Pattern* pattern )
@@ -75,6 +79,7 @@ void PatternList::insert( int idx, Pattern* pattern )
 		if( __patterns[i]==pattern ) return;
 	}
 	__patterns.insert( __patterns.begin() + idx, pattern );
+	__revision = Pattern::next_revision();
 }
 
 Pattern* PatternList::operator[]( int idx )
@@ -120,6 +125,7 @@ Pattern* PatternList::del( int idx )
 	assert( idx >= 0 && idx < __patterns.size() );
 	Pattern* pattern = __patterns[idx];
 	__patterns.erase( __patterns.begin() + idx );
+	__revision = Pattern::next_revision();
 	return pattern;
 }
 
@@ -128,6 +134,7 @@ Pattern* PatternList::del( Pattern* pattern )
 	for( int i=0; i<__patterns.size(); i++ ) {
 		if( __patterns[i]==pattern ) {
 			__patterns.erase( __patterns.begin() + i );
+			__revision = Pattern::next_revision();
 			return pattern;
 		}
 	}
@@ -149,6 +156,7 @@ Pattern* PatternList::replace( int idx, Pattern* pattern )
 
 	__patterns.insert( __patterns.begin() + idx, pattern );
 	__patterns.erase( __patterns.begin() + idx + 1 );
+	__revision = Pattern::next_revision();
 
 	//create return pattern after patternlist tätatä to return the right one
 	Pattern* ret = __patterns[idx];
@@ -179,6 +187,7 @@ void PatternList::swap( int idx_a, int idx_b )
 	Pattern* tmp = __patterns[idx_a];
 	__patterns[idx_a] = __patterns[idx_b];
 	__patterns[idx_b] = tmp;
+	__revision = Pattern::next_revision();
 }
 
 void PatternList::move( int idx_a, int idx_b )
@@ -190,6 +199,7 @@ void PatternList::move( int idx_a, int idx_b )
 	Pattern* tmp = __patterns[idx_a];
 	__patterns.erase( __patterns.begin() + idx_a );
 	__patterns.insert( __patterns.begin() + idx_b, tmp );
+	__revision = Pattern::next_revision();
 }
 
 void PatternList::flattened_virtual_patterns_compute()
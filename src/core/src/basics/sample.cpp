@@ -29,6 +29,9 @@
 #include <hydrogen/Preferences.h>
 #include <hydrogen/helpers/filesystem.h>
 #include <hydrogen/basics/sample.h>
+#include <hydrogen/basics/sample_cache.h>
+#include <hydrogen/basics/sample_disk_cache.h>
+#include <hydrogen/IO/AudioOutput.h>
 
 #if defined(H2CORE_HAVE_RUBBERBAND) || _DOXYGEN_
 #include <rubberband/RubberBandStretcher.h>
@@ -44,6 +47,8 @@ const char* EnvelopePoint::__class_name = "EnvolopePoint";
 
 const char* Sample::__loop_modes[] = { "forward", "reverse", "pingpong" };
 
+const int Sample::STREAM_HEAD_FRAMES;
+
 #if defined(H2CORE_HAVE_RUBBERBAND) || _DOXYGEN_
 static double compute_pitch_scale( const Sample::Rubberband& r );
 static RubberBand::RubberBandStretcher::Options compute_rubberband_options( const Sample::Rubberband& r );
@@ -73,6 +78,8 @@ Sample::Sample( const QString& filepath,  int frames, int sample_rate, float* da
 	__sample_rate( sample_rate ),
 	__data_l( data_l ),
 	__data_r( data_r ),
+	__streamed( false ),
+	__head_frames( 0 ),
 	__is_modified( false )
 {
 	assert( filepath.lastIndexOf( "/" ) >0 );
@@ -84,19 +91,30 @@ Sample::Sample( Sample* pOther ): Object( __class_name ),
 	__sample_rate( pOther->get_sample_rate() ),
 	__data_l( nullptr ),
 	__data_r( nullptr ),
+	__streamed( pOther->__streamed ),
+	__head_frames( pOther->__head_frames ),
 	__is_modified( pOther->get_is_modified() ),
 	__loops( pOther->__loops ),
 	__rubberband( pOther->__rubberband )
 {
-	__data_l = new float[__frames];
-	__data_r = new float[__frames];
+	if ( pOther->__shared_data != nullptr ) {
+		// the data is immutable as long as it is shared
+		__shared_data = pOther->__shared_data;
+		__data_l = pOther->__data_l;
+		__data_r = pOther->__data_r;
+	} else {
+		__data_l = new float[__frames];
+		__data_r = pOther->is_mono() ? __data_l : new float[__frames];
 	
-	// Since the third argument of memcpy takes the number of bytes,
-	// which are about to be copied, and the data is given in float,
-	// which are  four bytes each, the number of copied frames
-	// `__frames` has to be multiplied by four.
-	memcpy( __data_l, pOther->get_data_l(), __frames * 4 );
-	memcpy( __data_r, pOther->get_data_r(), __frames * 4 );
+		// Since the third argument of memcpy takes the number of bytes,
+		// which are about to be copied, and the data is given in float,
+		// which are  four bytes each, the number of copied frames
+		// `__frames` has to be multiplied by four.
+		memcpy( __data_l, pOther->get_data_l(), __frames * 4 );
+		if ( __data_r != __data_l ) {
+			memcpy( __data_r, pOther->get_data_r(), __frames * 4 );
+		}
+	}
 
 	PanEnvelope* pPan = pOther->get_pan_envelope();
 	for( int i=0; i<pPan->size(); i++ ) {
@@ -111,8 +129,61 @@ Sample::Sample( Sample* pOther ): Object( __class_name ),
 
 Sample::~Sample()
 {
-	if( __data_l!=nullptr ) delete[] __data_l;
-	if( __data_r!=nullptr ) delete[] __data_r;
+	free_data();
+}
+
+void Sample::free_data()
+{
+	if ( __shared_data == nullptr ) {
+		if( __data_r!=nullptr && __data_r!=__data_l ) delete[] __data_r;
+		if( __data_l!=nullptr ) delete[] __data_l;
+	}
+	__shared_data.reset();
+	__data_l = __data_r = nullptr;
+}
+
+void Sample::detach()
+{
+	if ( __shared_data == nullptr ) {
+		return;
+	}
+	// a compact format is converted on the way
+	bool bMono = is_mono();
+	float* data_l = new float[ __frames ];
+	float* data_r = bMono ? data_l : new float[ __frames ];
+	read_data( 0, __frames, data_l, bMono ? nullptr : data_r );
+	__shared_data.reset();
+	__data_l = data_l;
+	__data_r = data_r;
+}
+
+void Sample::expand()
+{
+	if ( get_format() != SampleData::FLOAT ) {
+		detach();
+	}
+}
+
+void Sample::split_channels()
+{
+	detach();
+	if ( __data_r != __data_l ) {
+		return;
+	}
+	__data_r = new float[ __frames ];
+	memcpy( __data_r, __data_l, __frames * sizeof( float ) );
+}
+
+void Sample::read_data( int nFirst, int nCount, float* pOut_L, float* pOut_R ) const
+{
+	if ( __shared_data != nullptr ) {
+		__shared_data->read( nFirst, nCount, pOut_L, pOut_R );
+		return;
+	}
+	memcpy( pOut_L, __data_l + nFirst, nCount * sizeof( float ) );
+	if ( pOut_R != nullptr ) {
+		memcpy( pOut_R, __data_r + nFirst, nCount * sizeof( float ) );
+	}
 }
 
 void Sample::set_filename( const QString& filename )
@@ -144,15 +215,92 @@ Sample* Sample::load( const QString& filepath )
 
 Sample* Sample::load( const QString& filepath, const Loops& loops, const Rubberband& rubber, const VelocityEnvelope& velocity, const PanEnvelope& pan )
 {
+	QString sKey;
+	if ( SampleDiskCache::has_instance() ) {
+		sKey = get_transformed_key( filepath, loops, rubber, velocity, pan );
+	}
+	if ( !sKey.isEmpty() ) {
+		std::shared_ptr<SampleData> pData = SampleDiskCache::get_instance()->load( sKey );
+		if ( pData != nullptr ) {
+			// transformed during a previous session, only the
+			// parameters are left to restore
+			Sample* pSample = new Sample( filepath );
+			pSample->__shared_data = pData;
+			pSample->__data_l = pData->data_l;
+			pSample->__data_r = pData->data_r;
+			pSample->__frames = pData->frames;
+			pSample->__sample_rate = pData->sample_rate;
+			pSample->__loops = loops;
+			if ( rubber.use ) {
+				pSample->__rubberband = rubber;
+			}
+			for ( auto& pPoint : velocity ) {
+				pSample->__velocity_envelope.emplace_back( std::make_unique<EnvelopePoint>( pPoint.get() ) );
+			}
+			for ( auto& pPoint : pan ) {
+				pSample->__pan_envelope.emplace_back( std::make_unique<EnvelopePoint>( pPoint.get() ) );
+			}
+			pSample->__is_modified = true;
+			return pSample;
+		}
+	}
+
 	Sample* pSample = Sample::load( filepath );
 	
 	if( pSample ){
 		pSample->apply( loops, rubber, velocity, pan );
+		// a transformation which failed would not be restored
+		// the same way
+		if ( !sKey.isEmpty() && pSample->__is_modified && !pSample->__streamed && pSample->__loops == loops
+			 && ( !rubber.use || pSample->__rubberband == rubber ) ) {
+			std::shared_ptr<SampleData> pData = pSample->__shared_data;
+			if ( pData == nullptr ) {
+				pData = std::make_shared<SampleData>( pSample->__frames, pSample->__sample_rate, pSample->is_mono() ? 1 : 2 );
+				pSample->read_data( 0, pSample->__frames, pData->data_l, pData->is_mono() ? nullptr : pData->data_r );
+			}
+			SampleDiskCache::get_instance()->store( sKey, *pData );
+		}
 	}
 
 	return pSample;
 }
 
+QString Sample::get_transformed_key( const QString& filepath, const Loops& loops, const Rubberband& rubber,
+									 const VelocityEnvelope& velocity, const PanEnvelope& pan )
+{
+	if ( loops == Loops() && !rubber.use && velocity.empty() && pan.empty() ) {
+		return QString();
+	}
+	QString sKey = SampleCache::get_key( filepath );
+	if ( sKey.isEmpty() ) {
+		return QString();
+	}
+	sKey += QString( "|loops %1 %2 %3 %4 %5" )
+		.arg( loops.start_frame ).arg( loops.loop_frame ).arg( loops.end_frame ).arg( loops.count ).arg( loops.mode );
+	if ( rubber.use ) {
+		// the stretched length depends on the tempo, the library
+		// output on the size of the blocks it is fed
+		Hydrogen* pHydrogen = Hydrogen::get_instance();
+#ifdef H2CORE_HAVE_RUBBERBAND
+		AudioOutput* pAudioOutput = pHydrogen->getAudioOutput();
+		sKey += QString( "|rubberband %1" ).arg( pAudioOutput != nullptr ? pAudioOutput->getBufferSize() : 0 );
+#else
+		sKey += QString( "|rubberband-cli %1" ).arg( Preferences::get_instance()->m_rubberBandCLIexecutable );
+#endif
+		sKey += QString( " %1 %2 %3 %4" )
+			.arg( rubber.divider ).arg( rubber.pitch ).arg( rubber.c_settings ).arg( pHydrogen->getNewBpmJTM() );
+	}
+	sKey += "|velocity";
+	for ( auto& pPoint : velocity ) {
+		sKey += QString( " %1:%2" ).arg( pPoint->frame ).arg( pPoint->value );
+	}
+	sKey += "|pan";
+	for ( auto& pPoint : pan ) {
+		sKey += QString( " %1:%2" ).arg( pPoint->frame ).arg( pPoint->value );
+	}
+	return sKey;
+}
+
 void Sample::apply( const Loops& loops, const Rubberband& rubber, const VelocityEnvelope& velocity, const PanEnvelope& pan )
 {
 	apply_loops( loops );
@@ -165,80 +313,100 @@ void Sample::apply( const Loops& loops, const Rubberband& rubber, const Velocity
 #endif
 }
 
-bool Sample::load()
+QString Sample::get_data_key() const
 {
-	// Will contain a bunch of metadata about the loaded sample.
+	QString sKey;
+	if ( __is_modified ) {
+		sKey = get_transformed_key( __filepath, __loops, __rubberband, __velocity_envelope, __pan_envelope );
+	}
+	return sKey.isEmpty() ? SampleCache::get_key( __filepath ) : sKey;
+}
+
+bool Sample::is_streamable( const QString& filepath )
+{
+	unsigned nThreshold = Preferences::get_instance()->m_nSampleStreamThreshold;
+	if ( nThreshold == 0 ) {
+		return false;
+	}
 	SF_INFO sound_info;
-	
-	// Opens file in read-only mode.
-	SNDFILE* file = sf_open( __filepath.toLocal8Bit(), SFM_READ, &sound_info );
+	sound_info.format = 0;
+	SNDFILE* file = sf_open( filepath.toLocal8Bit(), SFM_READ, &sound_info );
 	if ( !file ) {
-		ERRORLOG( QString( "[Sample::load] Error loading file %1" ).arg( __filepath ) );
+		// reported by whoever tries to load it
 		return false;
 	}
-	
-	// Sanity check. SAMPLE_CHANNELS is defined in
-	// core/include/hydrogen/globals.h and set to 2.
-	if ( sound_info.channels > SAMPLE_CHANNELS ) {
-		WARNINGLOG( QString( "can't handle %1 channels, only 2 will be used" ).arg( sound_info.channels ) );
-		sound_info.channels = SAMPLE_CHANNELS;
-	}
-	if ( sound_info.frames > ( std::numeric_limits<int>::max()/sound_info.channels ) ) {
-		WARNINGLOG( QString( "sample frames count (%1) and channels (%2) are too much, truncate it." ).arg( sound_info.frames ).arg( sound_info.channels ) );
-		sound_info.frames = ( std::numeric_limits<int>::max()/sound_info.channels );
-	}
+	sf_close( file );
+	return sound_info.frames > STREAM_HEAD_FRAMES
+		&& ( long long )sound_info.frames * sizeof( float ) * 2 > ( long long )nThreshold * 1024 * 1024;
+}
 
-	// Create an array, which will hold the block of samples read
-	// from file.
-	float* buffer = new float[ sound_info.frames * sound_info.channels ];
-	
-	//memset( buffer, 0, sound_info.frames *sound_info.channels );
-	
-	// Read all frames into `buffer'. Libsndfile does seamlessly
-	// convert the format of the underlying data on the fly. The
-	// output will be an array of floats regardless of file's
-	// encoding (e.g. 16 bit PCM).
-	sf_count_t count = sf_read_float( file, buffer, sound_info.frames * sound_info.channels );
-	if( count==0 ){
-		WARNINGLOG( QString( "%1 is an empty sample" ).arg( __filepath ) );
+bool Sample::load()
+{
+	bool bStreamed = is_streamable( __filepath );
+	std::shared_ptr<SampleData> pData;
+	if ( bStreamed ) {
+		// the head is private to this sample, caching it would
+		// only hand out truncated data
+		pData = SampleData::decode( __filepath, STREAM_HEAD_FRAMES,
+									SampleCache::has_instance() && SampleCache::get_instance()->is_compact() );
+	} else if ( SampleCache::has_instance() ) {
+		pData = SampleCache::get_instance()->load( __filepath );
+	} else {
+		pData = SampleData::decode( __filepath );
 	}
-	
-	// Deallocate the handler.
-	if ( sf_close( file ) != 0 ){
-		WARNINGLOG( QString( "Unable to close sample file %1" ).arg( __filepath ) );
+	if ( pData == nullptr ) {
+		ERRORLOG( QString( "[Sample::load] Error loading file %1" ).arg( __filepath ) );
+		return false;
 	}
-	
+
 	// Flush the current content of the left and right channel and
 	// the current metadata.
 	unload();
-	
-	// Save the metadata of the loaded file into private members
-	// of the Sample class.
-	__frames = sound_info.frames;
-	__sample_rate = sound_info.samplerate;
-
-	// Split the loaded frames into left and right channel. 
-	// If only one channels was present in the underlying data,
-	// duplicate its content.
-	__data_l = new float[ sound_info.frames ];
-	__data_r = new float[ sound_info.frames ];
-	if ( sound_info.channels == 1 ) {
-		memcpy( __data_l, buffer, __frames * sizeof( float ) );
-		memcpy( __data_r, buffer, __frames * sizeof( float ) );
-	} else if ( sound_info.channels == SAMPLE_CHANNELS ) {
-		for ( int i = 0; i < __frames; i++ ) {
-			__data_l[i] = buffer[i * SAMPLE_CHANNELS];
-			__data_r[i] = buffer[i * SAMPLE_CHANNELS + 1];
-		}
+
+	// Share the decoded data, it is copied by detach() as soon as
+	// a transformation has to modify it.
+	__shared_data = pData;
+	__data_l = pData->data_l;
+	__data_r = pData->data_r;
+	__frames = pData->file_frames;
+	__sample_rate = pData->sample_rate;
+	__streamed = bStreamed;
+	__head_frames = pData->frames;
+
+	return true;
+}
+
+bool Sample::unstream()
+{
+	if ( !__streamed ) {
+		return true;
+	}
+	std::shared_ptr<SampleData> pData;
+	if ( SampleCache::has_instance() ) {
+		pData = SampleCache::get_instance()->load( __filepath );
+	} else {
+		pData = SampleData::decode( __filepath );
+	}
+	if ( pData == nullptr ) {
+		ERRORLOG( QString( "Unable to load the streamed part of %1" ).arg( __filepath ) );
+		return false;
 	}
-	delete[] buffer;
 
+	free_data();
+	__shared_data = pData;
+	__data_l = pData->data_l;
+	__data_r = pData->data_r;
+	__frames = pData->frames;
+	__streamed = false;
+	__head_frames = 0;
 	return true;
 }
 
 bool Sample::apply_loops( const Loops& lo )
 {
 	if( __loops == lo ) return true;
+	if( !unstream() ) return false;
+	expand();
 	if( lo.start_frame<0 ) {
 		ERRORLOG( QString( "start_frame %1 < 0 is not allowed" ).arg( lo.start_frame ) );
 		return false;
@@ -266,8 +434,10 @@ bool Sample::apply_loops( const Loops& lo )
 	int loop_length =  lo.end_frame - lo.loop_frame;
 	int new_length = full_length + loop_length * lo.count;
 
+	// a mono sample stays mono, the right channel copies below
+	// write the same frames again
 	float* new_data_l = new float[ new_length ];
-	float* new_data_r = new float[ new_length ];
+	float* new_data_r = __data_r==__data_l ? new_data_l : new float[ new_length ];
 
 	// copy full_length frames to new_data
 	if ( lo.mode==Loops::REVERSE && ( lo.count==0 || full_loop ) ) {
@@ -310,8 +480,7 @@ bool Sample::apply_loops( const Loops& lo )
 		assert( x==new_length );
 	}
 	__loops = lo;
-	delete [] __data_l;
-	delete [] __data_r;
+	free_data();
 	__data_l = new_data_l;
 	__data_r = new_data_r;
 	__frames = new_length;
@@ -332,6 +501,11 @@ void Sample::apply_velocity( const VelocityEnvelope& v )
 	
 	__velocity_envelope.clear();
 	if ( v.size() > 0 ) {
+		if ( !unstream() ) {
+			return;
+		}
+		detach();
+		bool bMono = is_mono();
 		float inv_resolution = __frames / 841.0F;
 		for ( int i = 1; i < v.size(); i++ ) {
 			float y = ( 91 - v[i - 1]->value ) / 91.0F;
@@ -343,7 +517,9 @@ void Sample::apply_velocity( const VelocityEnvelope& v )
 			float step = ( y - k ) / length;;
 			for ( int z = start_frame ; z < end_frame; z++ ) {
 				__data_l[z] = __data_l[z] * y;
-				__data_r[z] = __data_r[z] * y;
+				if ( !bMono ) {
+					__data_r[z] = __data_r[z] * y;
+				}
 				y-=step;
 			}
 		}
@@ -365,6 +541,11 @@ void Sample::apply_pan( const PanEnvelope& p )
 	
 	__pan_envelope.clear();
 	if ( p.size() > 0 ) {
+		if ( !unstream() ) {
+			return;
+		}
+		// the channels are panned apart
+		split_channels();
 		float inv_resolution = __frames / 841.0F;
 		for ( int i = 1; i < p.size(); i++ ) {
 			float y = ( 45 - p[i - 1]->value ) / 45.0F;
@@ -405,6 +586,8 @@ void Sample::apply_rubberband( const Rubberband& rb )
 #ifdef H2CORE_HAVE_RUBBERBAND
 	//if( __rubberband == rb ) return;
 	if( !rb.use ) return;
+	if( !unstream() ) return;
+	expand();
 	// compute rubberband options
 	double output_duration = 60.0 / Hydrogen::get_instance()->getNewBpmJTM() * rb.divider;
 	double time_ratio = output_duration / get_sample_duration();
@@ -499,8 +682,7 @@ void Sample::apply_rubberband( const Rubberband& rb )
 
 	// DEBUGLOG( QString( "%1 frames processed, %2 frames retrieved" ).arg( __frames ).arg( retrieved ) );
 	// final data buffers
-	delete [] __data_l;
-	delete [] __data_r;
+	free_data();
 	__data_l = new float[ retrieved ];
 	__data_r = new float[ retrieved ];
 	memcpy( __data_l, out_data_l, retrieved*sizeof( float ) );
@@ -567,8 +749,9 @@ bool Sample::exec_rubberband_cli( const Rubberband& rb )
 			return false;
 		}
 
-		Sample* p_Rubberbanded = Sample::load( rubberResultPath.toLocal8Bit() );
-		if( p_Rubberbanded==nullptr ) {
+		// the result is a temporary file, it has nothing to do in the SampleCache
+		std::shared_ptr<SampleData> pRubberbanded = SampleData::decode( rubberResultPath );
+		if( pRubberbanded==nullptr ) {
 			return false;
 		}
 
@@ -576,14 +759,13 @@ bool Sample::exec_rubberband_cli( const Rubberband& rb )
 
 		QFile( rubberResultPath ).remove();
 
-		__frames = p_Rubberbanded->get_frames();
-		__data_l = p_Rubberbanded->get_data_l();
-		__data_r = p_Rubberbanded->get_data_r();
-		p_Rubberbanded->__data_l = nullptr;
-		p_Rubberbanded->__data_r = nullptr;
+		free_data();
+		__shared_data = pRubberbanded;
+		__frames = pRubberbanded->frames;
+		__data_l = pRubberbanded->data_l;
+		__data_r = pRubberbanded->data_r;
 		__is_modified = true;
 		__rubberband = rb;
-		delete p_Rubberbanded;
 	}
 	return true;
 }
@@ -600,10 +782,16 @@ Sample::Loops::LoopMode Sample::parse_loop_mode( const QString& string )
 
 bool Sample::write( const QString& path, int format )
 {
+	if ( !unstream() ) {
+		return false;
+	}
+	// whatever the format the data is kept in
+	std::vector<float> data_l( __frames ), data_r( __frames );
+	read_data( 0, __frames, data_l.data(), data_r.data() );
 	float* obuf = new float[ SAMPLE_CHANNELS * __frames ];
 	for ( int i = 0; i < __frames; ++i ) {
-		float value_l = __data_l[i];
-		float value_r = __data_r[i];
+		float value_l = data_l[i];
+		float value_r = data_r[i];
 		if ( value_l > 1.f ) value_l = 1.f;
 		else if ( value_l < -1.f ) value_l = -1.f;
 		else if ( value_r > 1.f ) value_r = 1.f;
@@ -0,0 +1,439 @@
+/*
+ * Hydrogen
+ * Copyright(c) 2002-2008 by Alex >Comix< Cominu [comix@users.sourceforge.net]
+ *
+ * http://www.hydrogen-music.org
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY, without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ */
+
+#include <hydrogen/basics/sample_cache.h>
+
+#include <cstring>
+#include <limits>
+
+#include <sndfile.h>
+
+#include <QFile>
+#include <QFileInfo>
+#include <QDateTime>
+
+#include <hydrogen/Preferences.h>
+#include <hydrogen/basics/sample_disk_cache.h>
+
+namespace H2Core
+{
+
+const char* SampleData::__class_name = "SampleData";
+const char* SampleCache::__class_name = "SampleCache";
+
+SampleCache* SampleCache::__instance = nullptr;
+
+/* SampleData */
+SampleData::SampleData( int nFrames, int nSampleRate, int nChannels, Format format ) : Object( __class_name ),
+	data_l( nullptr ),
+	data_r( nullptr ),
+	pcm_l( nullptr ),
+	pcm_r( nullptr ),
+	frames( nFrames ),
+	file_frames( nFrames ),
+	sample_rate( nSampleRate ),
+	channels( nChannels ),
+	format( format ),
+	mapping( nullptr )
+{
+	assert( channels == 1 || channels == 2 );
+	if ( format == FLOAT ) {
+		data_l = new float[ nFrames ];
+		data_r = channels == 1 ? data_l : new float[ nFrames ];
+	} else {
+		pcm_l = new char[ ( size_t )nFrames * get_frame_size( format ) ];
+		pcm_r = channels == 1 ? pcm_l : new char[ ( size_t )nFrames * get_frame_size( format ) ];
+	}
+}
+
+SampleData::SampleData( QFile* pMapping, char* pMap, int nFrames, int nSampleRate, int nChannels, Format format )
+	: Object( __class_name ),
+	data_l( nullptr ),
+	data_r( nullptr ),
+	pcm_l( nullptr ),
+	pcm_r( nullptr ),
+	frames( nFrames ),
+	file_frames( nFrames ),
+	sample_rate( nSampleRate ),
+	channels( nChannels ),
+	format( format ),
+	mapping( pMapping )
+{
+	assert( channels == 1 || channels == 2 );
+	char* pMap_R = channels == 1 ? pMap : pMap + ( size_t )nFrames * get_frame_size( format );
+	if ( format == FLOAT ) {
+		data_l = reinterpret_cast<float*>( pMap );
+		data_r = reinterpret_cast<float*>( pMap_R );
+	} else {
+		pcm_l = pMap;
+		pcm_r = pMap_R;
+	}
+}
+
+SampleData::~SampleData()
+{
+	if ( mapping != nullptr ) {
+		// unmaps the frames
+		delete mapping;
+		return;
+	}
+	if ( data_r != data_l ) {
+		delete[] data_r;
+	}
+	delete[] data_l;
+	if ( pcm_r != pcm_l ) {
+		delete[] pcm_r;
+	}
+	delete[] pcm_l;
+}
+
+int SampleData::get_frame_size( Format format )
+{
+	switch ( format ) {
+	case INT16:
+		return sizeof( int16_t );
+	case INT24:
+		return 3;
+	default:
+		return sizeof( float );
+	}
+}
+
+/** splits the \a nChannels interleaved channels of \a pBuffer, \a pOut_R may be \a pOut_L for a mono file */
+template < typename T >
+static void deinterleave( const T* pBuffer, int nChannels, int nFrames, T* pOut_L, T* pOut_R )
+{
+	if ( nChannels == 1 ) {
+		memcpy( pOut_L, pBuffer, nFrames * sizeof( T ) );
+		if ( pOut_R != pOut_L ) {
+			memcpy( pOut_R, pBuffer, nFrames * sizeof( T ) );
+		}
+		return;
+	}
+	for ( int i = 0; i < nFrames; i++ ) {
+		pOut_L[i] = pBuffer[i * nChannels];
+		pOut_R[i] = pBuffer[i * nChannels + 1];
+	}
+}
+
+/** keeps the 24 most significant bits of the 32 bit integers returned by sf_readf_int() */
+static void pack_int24( const int* pBuffer, int nCount, char* pOut )
+{
+	for ( int i = 0; i < nCount; i++ ) {
+		uint32_t v = ( uint32_t )pBuffer[ i ];
+		pOut[ 3 * i ] = ( char )( v >> 8 );
+		pOut[ 3 * i + 1 ] = ( char )( v >> 16 );
+		pOut[ 3 * i + 2 ] = ( char )( v >> 24 );
+	}
+}
+
+std::shared_ptr<SampleData> SampleData::decode( const QString& filepath, int nMaxFrames, bool bCompact )
+{
+	// Will contain a bunch of metadata about the loaded sample.
+	SF_INFO sound_info;
+
+	// Opens file in read-only mode.
+	SNDFILE* file = sf_open( filepath.toLocal8Bit(), SFM_READ, &sound_info );
+	if ( !file ) {
+		ERRORLOG( QString( "Error loading file %1" ).arg( filepath ) );
+		return nullptr;
+	}
+
+	// Sanity check. SAMPLE_CHANNELS is defined in
+	// core/include/hydrogen/globals.h and set to 2.
+	int nFileChannels = sound_info.channels;
+	if ( sound_info.channels > SAMPLE_CHANNELS ) {
+		WARNINGLOG( QString( "can't handle %1 channels, only 2 will be used" ).arg( sound_info.channels ) );
+		sound_info.channels = SAMPLE_CHANNELS;
+	}
+	if ( sound_info.frames > ( std::numeric_limits<int>::max()/nFileChannels ) ) {
+		WARNINGLOG( QString( "sample frames count (%1) and channels (%2) are too much, truncate it." ).arg( sound_info.frames ).arg( nFileChannels ) );
+		sound_info.frames = ( std::numeric_limits<int>::max()/nFileChannels );
+	}
+	sf_count_t nFileFrames = sound_info.frames;
+	if ( nMaxFrames >= 0 && sound_info.frames > nMaxFrames ) {
+		sound_info.frames = nMaxFrames;
+	}
+
+	// The integer formats libsndfile converts to float by a mere
+	// scaling can be kept as they are and be converted while being
+	// read.
+	Format format = FLOAT;
+	if ( bCompact ) {
+		switch ( sound_info.format & SF_FORMAT_SUBMASK ) {
+		case SF_FORMAT_PCM_S8:
+		case SF_FORMAT_PCM_U8:
+		case SF_FORMAT_PCM_16:
+			format = INT16;
+			break;
+		case SF_FORMAT_PCM_24:
+			format = INT24;
+			break;
+		default:
+			break;
+		}
+	}
+
+	// The frames of a mono file are stored once for both channels.
+	std::shared_ptr<SampleData> pData = std::make_shared<SampleData>( ( int )sound_info.frames, sound_info.samplerate,
+																	  nFileChannels == 1 ? 1 : 2, format );
+	pData->file_frames = ( int )nFileFrames;
+
+	// Read all frames into `buffer', which holds the interleaved
+	// channels of the file, and split them into left and right
+	// channel. Libsndfile does seamlessly convert the format of the
+	// underlying data on the fly.
+	int nSamples = pData->frames * nFileChannels;
+	sf_count_t count = 0;
+	if ( format == FLOAT ) {
+		float* buffer = new float[ nSamples ];
+		count = sf_readf_float( file, buffer, pData->frames );
+		deinterleave( buffer, nFileChannels, pData->frames, pData->data_l, pData->data_r );
+		delete[] buffer;
+	} else if ( format == INT16 ) {
+		short* buffer = new short[ nSamples ];
+		count = sf_readf_short( file, buffer, pData->frames );
+		deinterleave( buffer, nFileChannels, pData->frames,
+					  reinterpret_cast<short*>( pData->pcm_l ), reinterpret_cast<short*>( pData->pcm_r ) );
+		delete[] buffer;
+	} else {
+		int* buffer = new int[ nSamples ];
+		count = sf_readf_int( file, buffer, pData->frames );
+		int* channel = new int[ pData->frames ];
+		for ( int nChannel = 0; nChannel < pData->channels; nChannel++ ) {
+			for ( int i = 0; i < pData->frames; i++ ) {
+				channel[i] = buffer[i * nFileChannels + nChannel];
+			}
+			pack_int24( channel, pData->frames, nChannel == 0 ? pData->pcm_l : pData->pcm_r );
+		}
+		delete[] channel;
+		delete[] buffer;
+	}
+	if( count==0 ){
+		WARNINGLOG( QString( "%1 is an empty sample" ).arg( filepath ) );
+	}
+
+	// Deallocate the handler.
+	if ( sf_close( file ) != 0 ){
+		WARNINGLOG( QString( "Unable to close sample file %1" ).arg( filepath ) );
+	}
+
+	return pData;
+}
+
+/** converts \a nCount frames of \a reader from \a nFirst on */
+template < typename Reader >
+static void read_frames( const Reader& reader, int nFirst, int nCount, float* pOut )
+{
+	for ( int i = 0; i < nCount; i++ ) {
+		pOut[i] = reader[ nFirst + i ];
+	}
+}
+
+void SampleData::read_channel( Format format, const void* pData, int nFirst, int nCount, float* pOut )
+{
+	switch ( format ) {
+	case FLOAT:
+		memcpy( pOut, static_cast<const float*>( pData ) + nFirst, nCount * sizeof( float ) );
+		break;
+	case INT16:
+		read_frames( Int16Reader{ static_cast<const int16_t*>( pData ) }, nFirst, nCount, pOut );
+		break;
+	case INT24:
+		read_frames( Int24Reader{ static_cast<const uint8_t*>( pData ) }, nFirst, nCount, pOut );
+		break;
+	}
+}
+
+void SampleData::read( int nFirst, int nCount, float* pOut_L, float* pOut_R ) const
+{
+	assert( nFirst >= 0 && nFirst + nCount <= frames );
+	const void* pData_L = format == FLOAT ? ( const void* )data_l : pcm_l;
+	const void* pData_R = format == FLOAT ? ( const void* )data_r : pcm_r;
+	read_channel( format, pData_L, nFirst, nCount, pOut_L );
+	if ( pOut_R != nullptr ) {
+		read_channel( format, pData_R, nFirst, nCount, pOut_R );
+	}
+}
+/* SampleData */
+
+
+void SampleCache::create_instance()
+{
+	if ( __instance == nullptr ) {
+		Preferences* pPref = Preferences::get_instance();
+		__instance = new SampleCache( ( long long )pPref->m_nSampleCacheSize * 1024 * 1024, pPref->m_bCompactSamples );
+	}
+}
+
+SampleCache::SampleCache( long long budget, bool compact ) : Object( __class_name ),
+	__budget( budget ),
+	__compact( compact ),
+	__size( 0 ),
+	__hits( 0 ),
+	__misses( 0 ),
+	__evictions( 0 )
+{
+	INFOLOG( QString( "INIT, budget %1 MB%2" ).arg( budget / ( 1024 * 1024 ) ).arg( compact ? ", compact" : "" ) );
+}
+
+SampleCache::~SampleCache()
+{
+	clear();
+	if ( __instance == this ) {
+		__instance = nullptr;
+	}
+}
+
+QString SampleCache::get_key( const QString& filepath )
+{
+	QFileInfo info( filepath );
+	QString sCanonicalPath = info.canonicalFilePath();
+	if ( sCanonicalPath.isEmpty() ) {
+		return QString();
+	}
+	return QString( "%1|%2|%3" )
+		.arg( sCanonicalPath )
+		.arg( info.lastModified().toMSecsSinceEpoch() )
+		.arg( info.size() );
+}
+
+std::shared_ptr<SampleData> SampleCache::load( const QString& filepath )
+{
+	QString sKey = get_key( filepath );
+	if ( sKey.isEmpty() ) {
+		ERRORLOG( QString( "Unable to read %1" ).arg( filepath ) );
+		return nullptr;
+	}
+
+	{
+		std::lock_guard<std::mutex> lock( __mutex );
+		auto it = __entries.find( sKey );
+		if ( it != __entries.end() ) {
+			__lru.splice( __lru.begin(), __lru, it->second.lru );
+			__hits++;
+			return it->second.data;
+		}
+	}
+
+	// decoding can take a while, other files are served meanwhile,
+	// a file decoded during a previous session is mapped instead
+	QString sDiskKey = __compact ? sKey + "|compact" : sKey;
+	std::shared_ptr<SampleData> pData;
+	if ( SampleDiskCache::has_instance() ) {
+		pData = SampleDiskCache::get_instance()->load( sDiskKey );
+	}
+	if ( pData == nullptr ) {
+		pData = SampleData::decode( filepath, -1, __compact );
+		if ( pData == nullptr ) {
+			return nullptr;
+		}
+		if ( SampleDiskCache::has_instance() ) {
+			SampleDiskCache::get_instance()->store( sDiskKey, *pData );
+		}
+	}
+
+	std::lock_guard<std::mutex> lock( __mutex );
+	__misses++;
+	auto it = __entries.find( sKey );
+	if ( it != __entries.end() ) {
+		// decoded by another thread at the same time
+		__lru.splice( __lru.begin(), __lru, it->second.lru );
+		return it->second.data;
+	}
+	__lru.push_front( sKey );
+	__entries[ sKey ] = Entry{ pData, __lru.begin() };
+	__size += pData->get_size();
+	evict();
+	return pData;
+}
+
+void SampleCache::evict()
+{
+	auto it = __lru.end();
+	while ( __size > __budget && it != __lru.begin() ) {
+		--it;
+		auto entry = __entries.find( *it );
+		// the cache holds the only reference, nobody uses it
+		if ( entry->second.data.use_count() == 1 ) {
+			__size -= entry->second.data->get_size();
+			__entries.erase( entry );
+			it = __lru.erase( it );
+			__evictions++;
+		}
+	}
+}
+
+void SampleCache::set_budget( long long budget )
+{
+	std::lock_guard<std::mutex> lock( __mutex );
+	__budget = budget;
+	evict();
+}
+
+long long SampleCache::get_budget() const
+{
+	std::lock_guard<std::mutex> lock( __mutex );
+	return __budget;
+}
+
+long long SampleCache::get_size() const
+{
+	std::lock_guard<std::mutex> lock( __mutex );
+	return __size;
+}
+
+int SampleCache::get_count() const
+{
+	std::lock_guard<std::mutex> lock( __mutex );
+	return __entries.size();
+}
+
+int SampleCache::get_hits() const
+{
+	std::lock_guard<std::mutex> lock( __mutex );
+	return __hits;
+}
+
+int SampleCache::get_misses() const
+{
+	std::lock_guard<std::mutex> lock( __mutex );
+	return __misses;
+}
+
+int SampleCache::get_evictions() const
+{
+	std::lock_guard<std::mutex> lock( __mutex );
+	return __evictions;
+}
+
+void SampleCache::clear()
+{
+	std::lock_guard<std::mutex> lock( __mutex );
+	__entries.clear();
+	__lru.clear();
+	__size = 0;
+}
+
+};
+
+/* vim: set softtabstop=4 noexpandtab: */
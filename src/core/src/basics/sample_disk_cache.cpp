@@ -0,0 +1,289 @@
+/*
+ * Hydrogen
+ * Copyright(c) 2002-2008 by Alex >Comix< Cominu [comix@users.sourceforge.net]
+ *
+ * http://www.hydrogen-music.org
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY, without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ */
+
+#include <hydrogen/basics/sample_disk_cache.h>
+
+#include <algorithm>
+#include <cstring>
+
+#include <QCryptographicHash>
+#include <QDateTime>
+#include <QDir>
+#include <QFile>
+#include <QFileInfo>
+#include <QSaveFile>
+
+#include <hydrogen/Preferences.h>
+#include <hydrogen/basics/sample_cache.h>
+#include <hydrogen/basics/sample_peaks.h>
+#include <hydrogen/helpers/filesystem.h>
+
+namespace H2Core
+{
+
+const char* SampleDiskCache::__class_name = "SampleDiskCache";
+
+SampleDiskCache* SampleDiskCache::__instance = nullptr;
+
+/** suffix of the entries holding data */
+static const char* SAMPLE_DISK_CACHE_EXT = ".h2sd";
+/** suffix of the entries holding peaks */
+static const char* SAMPLE_DISK_CACHE_PEAKS_EXT = ".h2sp";
+/** bumped whenever the layout of an entry changes */
+static const uint32_t SAMPLE_DISK_CACHE_VERSION = 1;
+
+/**
+ * Header of an entry, followed by the frames of the left channel and
+ * those of the right one unless there is a single channel. Its size
+ * keeps the frames aligned within the mapping.
+ */
+struct SampleDiskCacheHeader {
+	char magic[4];          ///< "H2SD"
+	uint32_t version;       ///< #SAMPLE_DISK_CACHE_VERSION, also rejects the other byte order
+	uint32_t format;        ///< SampleData::Format
+	uint32_t channels;
+	int32_t frames;
+	int32_t file_frames;
+	int32_t sample_rate;
+	uint32_t reserved;
+};
+
+/** \return the entries of \a dir, data and peaks */
+static QFileInfoList get_entries( const QString& dir )
+{
+	return QDir( dir ).entryInfoList( QStringList() << QString( "*" ) + SAMPLE_DISK_CACHE_EXT
+									  << QString( "*" ) + SAMPLE_DISK_CACHE_PEAKS_EXT, QDir::Files );
+}
+
+void SampleDiskCache::create_instance()
+{
+	Preferences* pPref = Preferences::get_instance();
+	if ( __instance == nullptr && pPref->m_bSampleDiskCache ) {
+		__instance = new SampleDiskCache( Filesystem::cache_dir() + "samples",
+										  ( long long )pPref->m_nSampleDiskCacheSize * 1024 * 1024 );
+	}
+}
+
+SampleDiskCache::SampleDiskCache( const QString& dir, long long budget ) : Object( __class_name ),
+	__dir( dir ),
+	__budget( budget ),
+	__size( 0 ),
+	__hits( 0 ),
+	__misses( 0 )
+{
+	if ( !QDir().mkpath( __dir ) ) {
+		ERRORLOG( QString( "Unable to create %1" ).arg( __dir ) );
+	}
+	for ( const QFileInfo& info : get_entries( __dir ) ) {
+		__size += info.size();
+	}
+	INFOLOG( QString( "INIT, %1, %2 of %3 MB used" )
+			 .arg( __dir ).arg( __size / ( 1024 * 1024 ) ).arg( budget / ( 1024 * 1024 ) ) );
+	std::lock_guard<std::mutex> lock( __mutex );
+	prune();
+}
+
+SampleDiskCache::~SampleDiskCache()
+{
+	if ( __instance == this ) {
+		__instance = nullptr;
+	}
+}
+
+QString SampleDiskCache::get_path( const QString& key, const char* ext ) const
+{
+	QByteArray hash = QCryptographicHash::hash( key.toUtf8(), QCryptographicHash::Sha1 ).toHex();
+	return __dir + "/" + QString::fromLatin1( hash ) + ext;
+}
+
+std::shared_ptr<SampleData> SampleDiskCache::load( const QString& key )
+{
+	QString sPath = get_path( key, SAMPLE_DISK_CACHE_EXT );
+	QFile* pFile = new QFile( sPath );
+	if ( !pFile->open( QIODevice::ReadOnly ) ) {
+		delete pFile;
+		std::lock_guard<std::mutex> lock( __mutex );
+		__misses++;
+		return nullptr;
+	}
+
+	SampleDiskCacheHeader header;
+	bool bValid = pFile->read( reinterpret_cast<char*>( &header ), sizeof( header ) ) == sizeof( header )
+		&& memcmp( header.magic, "H2SD", 4 ) == 0
+		&& header.version == SAMPLE_DISK_CACHE_VERSION
+		&& header.format <= SampleData::INT24
+		&& ( header.channels == 1 || header.channels == 2 )
+		&& header.frames > 0
+		&& pFile->size() == ( qint64 )sizeof( header )
+			+ ( qint64 )header.frames * SampleData::get_frame_size( ( SampleData::Format )header.format ) * header.channels;
+	uchar* pMap = bValid ? pFile->map( sizeof( header ), pFile->size() - sizeof( header ) ) : nullptr;
+	if ( pMap == nullptr ) {
+		// written by another version or truncated, it is replaced
+		// once the data is computed again
+		WARNINGLOG( QString( "Ignoring %1" ).arg( sPath ) );
+		delete pFile;
+		std::lock_guard<std::mutex> lock( __mutex );
+		__misses++;
+		return nullptr;
+	}
+
+	// the mapping outlives the descriptor
+	pFile->close();
+
+	// the pages are read now rather than by the audio thread when
+	// the sample is first played
+	volatile char nTouched = 0;
+	qint64 nMapSize = ( qint64 )header.frames * SampleData::get_frame_size( ( SampleData::Format )header.format ) * header.channels;
+	for ( qint64 i = 0; i < nMapSize; i += 4096 ) {
+		nTouched += pMap[ i ];
+	}
+
+	std::shared_ptr<SampleData> pData = std::make_shared<SampleData>( pFile, reinterpret_cast<char*>( pMap ), header.frames,
+																	  header.sample_rate, header.channels,
+																	  ( SampleData::Format )header.format );
+	pData->file_frames = header.file_frames;
+	std::lock_guard<std::mutex> lock( __mutex );
+	__hits++;
+	return pData;
+}
+
+bool SampleDiskCache::store( const QString& key, const SampleData& data )
+{
+	SampleDiskCacheHeader header;
+	memset( &header, 0, sizeof( header ) );
+	memcpy( header.magic, "H2SD", 4 );
+	header.version = SAMPLE_DISK_CACHE_VERSION;
+	header.format = data.format;
+	header.channels = data.channels;
+	header.frames = data.frames;
+	header.file_frames = data.file_frames;
+	header.sample_rate = data.sample_rate;
+	if ( data.frames <= 0 ) {
+		return false;
+	}
+
+	// written aside and renamed once complete, a concurrent load()
+	// maps either the old entry or the new one
+	QString sPath = get_path( key, SAMPLE_DISK_CACHE_EXT );
+	qint64 nOldSize = QFileInfo( sPath ).size();
+	QSaveFile file( sPath );
+	qint64 nChannelSize = ( qint64 )data.frames * SampleData::get_frame_size( data.format );
+	const char* pData_L = data.format == SampleData::FLOAT ? reinterpret_cast<const char*>( data.data_l ) : data.pcm_l;
+	const char* pData_R = data.format == SampleData::FLOAT ? reinterpret_cast<const char*>( data.data_r ) : data.pcm_r;
+	if ( !file.open( QIODevice::WriteOnly )
+		 || file.write( reinterpret_cast<const char*>( &header ), sizeof( header ) ) != sizeof( header )
+		 || file.write( pData_L, nChannelSize ) != nChannelSize
+		 || ( data.channels == 2 && file.write( pData_R, nChannelSize ) != nChannelSize )
+		 || !file.commit() ) {
+		WARNINGLOG( QString( "Unable to write %1: %2" ).arg( sPath ).arg( file.errorString() ) );
+		return false;
+	}
+
+	std::lock_guard<std::mutex> lock( __mutex );
+	__size += QFileInfo( sPath ).size() - nOldSize;
+	prune();
+	return true;
+}
+
+std::shared_ptr<SamplePeaks> SampleDiskCache::load_peaks( const QString& key )
+{
+	QString sPath = get_path( key, SAMPLE_DISK_CACHE_PEAKS_EXT );
+	QFile file( sPath );
+	if ( !file.open( QIODevice::ReadOnly ) ) {
+		return nullptr;
+	}
+	std::shared_ptr<SamplePeaks> pPeaks = SamplePeaks::read( &file );
+	if ( pPeaks == nullptr ) {
+		// replaced once computed again
+		WARNINGLOG( QString( "Ignoring %1" ).arg( sPath ) );
+	}
+	return pPeaks;
+}
+
+bool SampleDiskCache::store_peaks( const QString& key, const SamplePeaks& peaks )
+{
+	QString sPath = get_path( key, SAMPLE_DISK_CACHE_PEAKS_EXT );
+	qint64 nOldSize = QFileInfo( sPath ).size();
+	QSaveFile file( sPath );
+	if ( !file.open( QIODevice::WriteOnly ) || !peaks.write( &file ) || !file.commit() ) {
+		WARNINGLOG( QString( "Unable to write %1: %2" ).arg( sPath ).arg( file.errorString() ) );
+		return false;
+	}
+
+	std::lock_guard<std::mutex> lock( __mutex );
+	__size += QFileInfo( sPath ).size() - nOldSize;
+	prune();
+	return true;
+}
+
+void SampleDiskCache::prune()
+{
+	if ( __size <= __budget ) {
+		return;
+	}
+	QFileInfoList entries = get_entries( __dir );
+	std::sort( entries.begin(), entries.end(), []( const QFileInfo& a, const QFileInfo& b ) {
+		return a.lastRead() < b.lastRead();
+	} );
+	// removing a mapped entry unlinks it, its data stays valid
+	// until it is unmapped
+	for ( const QFileInfo& info : entries ) {
+		if ( __size <= __budget ) {
+			break;
+		}
+		if ( QFile::remove( info.absoluteFilePath() ) ) {
+			__size -= info.size();
+		}
+	}
+	__size = std::max( __size, 0LL );
+}
+
+long long SampleDiskCache::get_size() const
+{
+	std::lock_guard<std::mutex> lock( __mutex );
+	return __size;
+}
+
+int SampleDiskCache::get_hits() const
+{
+	std::lock_guard<std::mutex> lock( __mutex );
+	return __hits;
+}
+
+int SampleDiskCache::get_misses() const
+{
+	std::lock_guard<std::mutex> lock( __mutex );
+	return __misses;
+}
+
+void SampleDiskCache::clear()
+{
+	std::lock_guard<std::mutex> lock( __mutex );
+	for ( const QFileInfo& info : get_entries( __dir ) ) {
+		QFile::remove( info.absoluteFilePath() );
+	}
+	__size = 0;
+}
+
+};
+
+/* vim: set softtabstop=4 noexpandtab: */
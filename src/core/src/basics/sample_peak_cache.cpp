@@ -0,0 +1,221 @@
+/*
+ * Hydrogen
+ * Copyright(c) 2002-2008 by Alex >Comix< Cominu [comix@users.sourceforge.net]
+ *
+ * http://www.hydrogen-music.org
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY, without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ */
+
+
+#include <hydrogen/basics/sample_peak_cache.h>
+
+#include <hydrogen/event_queue.h>
+#include <hydrogen/basics/sample.h>
+#include <hydrogen/basics/sample_cache.h>
+#include <hydrogen/basics/sample_disk_cache.h>
+#include <hydrogen/basics/sample_peaks.h>
+
+namespace H2Core
+{
+
+const char* SamplePeakCache::__class_name = "SamplePeakCache";
+
+SamplePeakCache* SamplePeakCache::__instance = nullptr;
+
+void SamplePeakCache::create_instance()
+{
+	if ( __instance == nullptr ) {
+		__instance = new SamplePeakCache( 256 );
+	}
+}
+
+SamplePeakCache::SamplePeakCache( int entries ) : Object( __class_name ),
+	__entries_max( entries ),
+	__use( 0 ),
+	__started( false ),
+	__quit( false )
+{
+	pthread_mutex_init( &__mutex, nullptr );
+	pthread_cond_init( &__cond, nullptr );
+}
+
+SamplePeakCache::~SamplePeakCache()
+{
+	pthread_mutex_lock( &__mutex );
+	__quit.store( true );
+	pthread_cond_broadcast( &__cond );
+	pthread_mutex_unlock( &__mutex );
+	if ( __started ) {
+		pthread_join( __thread, nullptr );
+	}
+	pthread_cond_destroy( &__cond );
+	pthread_mutex_destroy( &__mutex );
+
+	if ( __instance == this ) {
+		__instance = nullptr;
+	}
+}
+
+std::shared_ptr<SamplePeaks> SamplePeakCache::get( const Sample* sample )
+{
+	if ( sample == nullptr || sample->get_frames() <= 0 ) {
+		return nullptr;
+	}
+	Job job{ sample->get_data_key(), sample->get_filepath(), nullptr, sample->get_frames() };
+	std::shared_ptr<SamplePeaks> pPeaks;
+	if ( job.key.isEmpty() || find( job.key, job.frames, &pPeaks ) ) {
+		return pPeaks;
+	}
+
+	// a streamed sample is read from its file
+	if ( !sample->is_streamed() ) {
+		job.data = sample->get_shared_data();
+		if ( job.data == nullptr ) {
+			// owned data may be changed or freed meanwhile, a copy
+			// is summarized instead
+			job.data = std::make_shared<SampleData>( sample->get_frames(), sample->get_sample_rate(), sample->is_mono() ? 1 : 2 );
+			sample->read_data( 0, sample->get_frames(), job.data->data_l, sample->is_mono() ? nullptr : job.data->data_r );
+		}
+	}
+	queue( job );
+	return nullptr;
+}
+
+std::shared_ptr<SamplePeaks> SamplePeakCache::get( const QString& filepath )
+{
+	Job job{ SampleCache::get_key( filepath ), filepath, nullptr, -1 };
+	std::shared_ptr<SamplePeaks> pPeaks;
+	if ( job.key.isEmpty() || find( job.key, job.frames, &pPeaks ) ) {
+		return pPeaks;
+	}
+	queue( job );
+	return nullptr;
+}
+
+bool SamplePeakCache::find( const QString& key, int frames, std::shared_ptr<SamplePeaks>* peaks )
+{
+	pthread_mutex_lock( &__mutex );
+	auto it = __entries.find( key );
+	bool bFound = it != __entries.end();
+	if ( bFound && !it->second.pending && frames >= 0 && it->second.frames >= 0 && frames != it->second.frames ) {
+		// the key does not tell apart samples stretched at
+		// different tempos
+		__entries.erase( it );
+		bFound = false;
+	}
+	if ( bFound ) {
+		it->second.last_use = ++__use;
+		*peaks = it->second.peaks;
+	}
+	pthread_mutex_unlock( &__mutex );
+	return bFound;
+}
+
+void SamplePeakCache::queue( const Job& job )
+{
+	pthread_mutex_lock( &__mutex );
+	__entries[ job.key ] = Entry{ nullptr, job.frames, ++__use, true };
+	__jobs.push_back( job );
+	if ( !__started ) {
+		if ( pthread_create( &__thread, nullptr, worker_thread, this ) == 0 ) {
+			__started = true;
+		} else {
+			ERRORLOG( "Can't create the sample peaks thread" );
+		}
+	}
+	pthread_cond_signal( &__cond );
+	pthread_mutex_unlock( &__mutex );
+}
+
+void* SamplePeakCache::worker_thread( void* pParam )
+{
+	static_cast<SamplePeakCache*>( pParam )->work();
+	return nullptr;
+}
+
+void SamplePeakCache::work()
+{
+	for ( ;; ) {
+		pthread_mutex_lock( &__mutex );
+		while ( !__quit.load() && __jobs.empty() ) {
+			pthread_cond_wait( &__cond, &__mutex );
+		}
+		if ( __quit.load() ) {
+			pthread_mutex_unlock( &__mutex );
+			return;
+		}
+		Job job = __jobs.front();
+		__jobs.pop_front();
+		pthread_mutex_unlock( &__mutex );
+
+		// summarized during a previous session
+		std::shared_ptr<SamplePeaks> pPeaks;
+		if ( SampleDiskCache::has_instance() ) {
+			pPeaks = SampleDiskCache::get_instance()->load_peaks( job.key );
+			if ( pPeaks != nullptr && job.frames >= 0 && pPeaks->get_frames() != job.frames ) {
+				pPeaks = nullptr;
+			}
+		}
+		if ( pPeaks == nullptr ) {
+			if ( job.data != nullptr ) {
+				pPeaks = SamplePeaks::compute( *job.data, &__quit );
+			} else {
+				pPeaks = SamplePeaks::compute( job.filepath, &__quit );
+			}
+			if ( __quit.load() ) {
+				return;
+			}
+			if ( pPeaks != nullptr && SampleDiskCache::has_instance() ) {
+				SampleDiskCache::get_instance()->store_peaks( job.key, *pPeaks );
+			}
+		}
+		job.data = nullptr;
+
+		pthread_mutex_lock( &__mutex );
+		auto it = __entries.find( job.key );
+		if ( it != __entries.end() && it->second.pending ) {
+			it->second.peaks = pPeaks;
+			it->second.pending = false;
+		}
+		evict();
+		pthread_mutex_unlock( &__mutex );
+
+		if ( pPeaks != nullptr ) {
+			EventQueue::get_instance()->push_event( EVENT_SAMPLE_PEAKS_READY, 0 );
+		}
+	}
+}
+
+void SamplePeakCache::evict()
+{
+	while ( ( int )__entries.size() > __entries_max ) {
+		auto oldest = __entries.end();
+		for ( auto it = __entries.begin(); it != __entries.end(); ++it ) {
+			if ( !it->second.pending && ( oldest == __entries.end() || it->second.last_use < oldest->second.last_use ) ) {
+				oldest = it;
+			}
+		}
+		if ( oldest == __entries.end() ) {
+			return;
+		}
+		__entries.erase( oldest );
+	}
+}
+
+};
+
+/* vim: set softtabstop=4 noexpandtab: */
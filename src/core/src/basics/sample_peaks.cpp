@@ -0,0 +1,327 @@
+/*
+ * Hydrogen
+ * Copyright(c) 2002-2008 by Alex >Comix< Cominu [comix@users.sourceforge.net]
+ *
+ * http://www.hydrogen-music.org
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY, without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ */
+
+
+#include <hydrogen/basics/sample_peaks.h>
+
+#include <algorithm>
+#include <cfloat>
+#include <cmath>
+#include <cstring>
+#include <limits>
+
+#include <sndfile.h>
+
+#include <QIODevice>
+
+#include <hydrogen/basics/sample_cache.h>
+
+namespace H2Core
+{
+
+const char* SamplePeaks::__class_name = "SamplePeaks";
+
+/** bumped whenever the layout written by SamplePeaks::write() changes */
+static const uint32_t SAMPLE_PEAKS_VERSION = 1;
+/** number of frames read at once while computing the peaks */
+static const int SAMPLE_PEAKS_CHUNK = 4096;
+
+/** Header written by SamplePeaks::write(), followed by the levels of each channel. */
+struct SamplePeaksHeader {
+	char magic[4];          ///< "H2SP"
+	uint32_t version;       ///< #SAMPLE_PEAKS_VERSION, also rejects the other byte order
+	uint32_t channels;
+	int32_t frames;
+	int32_t bucket_frames;
+	uint32_t reserved;
+};
+
+/** \return the number of frames summarized by a peak of the first level of \a frames frames */
+static int get_first_bucket_frames( int frames )
+{
+	int nBucket = SamplePeaks::MAX_BUCKET_FRAMES;
+	while ( nBucket > 1 && frames / nBucket < SamplePeaks::MIN_BUCKETS ) {
+		nBucket /= 2;
+	}
+	return nBucket;
+}
+
+/** \return the number of peaks of each level summarizing \a frames frames */
+static std::vector<int> get_level_sizes( int frames, int bucket_frames )
+{
+	std::vector<int> sizes;
+	int nSize = ( frames + bucket_frames - 1 ) / bucket_frames;
+	sizes.push_back( nSize );
+	while ( nSize > 1 ) {
+		nSize = ( nSize + 1 ) / 2;
+		sizes.push_back( nSize );
+	}
+	return sizes;
+}
+
+SamplePeaks::SamplePeaks( int frames, int channels )
+	: Object( __class_name ),
+	  __frames( std::max( frames, 0 ) ),
+	  __channels( channels == 1 ? 1 : 2 ),
+	  __bucket_frames( get_first_bucket_frames( __frames ) ),
+	  __appended( 0 )
+{
+	for ( int c = 0; c < __channels; c++ ) {
+		__levels[ c ].resize( 1 );
+		__levels[ c ][ 0 ].reserve( ( __frames + __bucket_frames - 1 ) / __bucket_frames );
+		__bucket[ c ] = Bucket{ FLT_MAX, -FLT_MAX, 0.0 };
+	}
+}
+
+SamplePeaks::~SamplePeaks()
+{
+}
+
+std::shared_ptr<SamplePeaks> SamplePeaks::compute( const SampleData& data, const std::atomic<bool>* cancel )
+{
+	std::shared_ptr<SamplePeaks> pPeaks = std::make_shared<SamplePeaks>( data.frames, data.channels );
+	std::vector<float> data_l( SAMPLE_PEAKS_CHUNK ), data_r( SAMPLE_PEAKS_CHUNK );
+	for ( int nFirst = 0; nFirst < data.frames; nFirst += SAMPLE_PEAKS_CHUNK ) {
+		if ( cancel != nullptr && cancel->load( std::memory_order_relaxed ) ) {
+			return nullptr;
+		}
+		int nCount = std::min( SAMPLE_PEAKS_CHUNK, data.frames - nFirst );
+		data.read( nFirst, nCount, data_l.data(), data.is_mono() ? nullptr : data_r.data() );
+		pPeaks->append( data_l.data(), data_r.data(), nCount );
+	}
+	pPeaks->finish();
+	return pPeaks;
+}
+
+std::shared_ptr<SamplePeaks> SamplePeaks::compute( const QString& filepath, const std::atomic<bool>* cancel )
+{
+	SF_INFO sound_info;
+	sound_info.format = 0;
+	SNDFILE* file = sf_open( filepath.toLocal8Bit(), SFM_READ, &sound_info );
+	if ( !file ) {
+		ERRORLOG( QString( "Error loading file %1" ).arg( filepath ) );
+		return nullptr;
+	}
+
+	// the first two channels are used, as by SampleData::decode()
+	int nFileChannels = sound_info.channels;
+	int nFrames = ( int )std::min( sound_info.frames, ( sf_count_t )std::numeric_limits<int>::max() );
+	std::shared_ptr<SamplePeaks> pPeaks = std::make_shared<SamplePeaks>( nFrames, nFileChannels == 1 ? 1 : 2 );
+	std::vector<float> buffer( SAMPLE_PEAKS_CHUNK * nFileChannels );
+	std::vector<float> data_l( SAMPLE_PEAKS_CHUNK ), data_r( SAMPLE_PEAKS_CHUNK );
+	int nRead = 0;
+	while ( nRead < nFrames ) {
+		if ( cancel != nullptr && cancel->load( std::memory_order_relaxed ) ) {
+			sf_close( file );
+			return nullptr;
+		}
+		int nCount = ( int )sf_readf_float( file, buffer.data(), std::min( SAMPLE_PEAKS_CHUNK, nFrames - nRead ) );
+		if ( nCount <= 0 ) {
+			break;
+		}
+		for ( int i = 0; i < nCount; i++ ) {
+			data_l[ i ] = buffer[ i * nFileChannels ];
+			data_r[ i ] = nFileChannels > 1 ? buffer[ i * nFileChannels + 1 ] : data_l[ i ];
+		}
+		pPeaks->append( data_l.data(), data_r.data(), nCount );
+		nRead += nCount;
+	}
+	if ( sf_close( file ) != 0 ) {
+		WARNINGLOG( QString( "Unable to close sample file %1" ).arg( filepath ) );
+	}
+
+	pPeaks->finish();
+	return pPeaks;
+}
+
+void SamplePeaks::append( const float* data_l, const float* data_r, int count )
+{
+	for ( int i = 0; i < count; i++ ) {
+		for ( int c = 0; c < __channels; c++ ) {
+			float fValue = c == 0 ? data_l[ i ] : data_r[ i ];
+			Bucket& bucket = __bucket[ c ];
+			bucket.min = std::min( bucket.min, fValue );
+			bucket.max = std::max( bucket.max, fValue );
+			bucket.sum += ( double )fValue * fValue;
+		}
+		if ( ++__appended % __bucket_frames == 0 ) {
+			for ( int c = 0; c < __channels; c++ ) {
+				Bucket& bucket = __bucket[ c ];
+				__levels[ c ][ 0 ].push_back( Peak{ bucket.min, bucket.max, ( float )std::sqrt( bucket.sum / __bucket_frames ) } );
+				bucket = Bucket{ FLT_MAX, -FLT_MAX, 0.0 };
+			}
+		}
+	}
+}
+
+void SamplePeaks::finish()
+{
+	int nPartial = __appended % __bucket_frames;
+	for ( int c = 0; c < __channels; c++ ) {
+		if ( nPartial > 0 ) {
+			Bucket& bucket = __bucket[ c ];
+			__levels[ c ][ 0 ].push_back( Peak{ bucket.min, bucket.max, ( float )std::sqrt( bucket.sum / nPartial ) } );
+			bucket = Bucket{ FLT_MAX, -FLT_MAX, 0.0 };
+		}
+	}
+	// a file may hold less frames than it announced
+	__frames = __appended;
+
+	for ( int c = 0; c < __channels; c++ ) {
+		std::vector<std::vector<Peak>>& levels = __levels[ c ];
+		levels.resize( 1 );
+		for ( int nLevel = 1; levels.back().size() > 1; nLevel++ ) {
+			const std::vector<Peak>& below = levels[ nLevel - 1 ];
+			std::vector<Peak> level( ( below.size() + 1 ) / 2 );
+			for ( int i = 0; i < ( int )level.size(); i++ ) {
+				const Peak& a = below[ 2 * i ];
+				if ( 2 * i + 1 == ( int )below.size() ) {
+					level[ i ] = a;
+					continue;
+				}
+				const Peak& b = below[ 2 * i + 1 ];
+				double fFrames_a = get_peak_frames( nLevel - 1, 2 * i );
+				double fFrames_b = get_peak_frames( nLevel - 1, 2 * i + 1 );
+				level[ i ].min = std::min( a.min, b.min );
+				level[ i ].max = std::max( a.max, b.max );
+				level[ i ].rms = ( float )std::sqrt( ( ( double )a.rms * a.rms * fFrames_a + ( double )b.rms * b.rms * fFrames_b )
+													 / ( fFrames_a + fFrames_b ) );
+			}
+			levels.push_back( std::move( level ) );
+		}
+	}
+}
+
+int SamplePeaks::get_peak_frames( int level, int idx ) const
+{
+	long long nBucket = ( long long )__bucket_frames << level;
+	return ( int )std::max( 0LL, std::min( nBucket, ( long long )__frames - idx * nBucket ) );
+}
+
+void SamplePeaks::get_peaks( int channel, double first, double frames_per_peak, int count, Peak* out ) const
+{
+	const std::vector<std::vector<Peak>>& levels = __levels[ ( channel > 0 && __channels > 1 ) ? 1 : 0 ];
+	int nLevel = 0;
+	while ( nLevel + 1 < ( int )levels.size() && std::ldexp( ( double )__bucket_frames, nLevel + 1 ) <= frames_per_peak ) {
+		nLevel++;
+	}
+	const std::vector<Peak>& peaks = levels[ nLevel ];
+	double fBucket = std::ldexp( ( double )__bucket_frames, nLevel );
+
+	for ( int i = 0; i < count; i++ ) {
+		double fStart = std::max( first + i * frames_per_peak, 0.0 );
+		double fEnd = std::min( first + ( i + 1 ) * frames_per_peak, ( double )__frames );
+		if ( peaks.empty() || fEnd <= fStart ) {
+			out[ i ] = Peak{ 0, 0, 0 };
+			continue;
+		}
+		// a range spans a few peaks of the level at most
+		int nFirst = ( int )( fStart / fBucket );
+		int nLast = std::max( nFirst, std::min( ( int )std::ceil( fEnd / fBucket ) - 1, ( int )peaks.size() - 1 ) );
+		Peak peak{ FLT_MAX, -FLT_MAX, 0 };
+		double fSum = 0, fFrames = 0;
+		for ( int j = nFirst; j <= nLast; j++ ) {
+			double fWeight = get_peak_frames( nLevel, j );
+			peak.min = std::min( peak.min, peaks[ j ].min );
+			peak.max = std::max( peak.max, peaks[ j ].max );
+			fSum += ( double )peaks[ j ].rms * peaks[ j ].rms * fWeight;
+			fFrames += fWeight;
+		}
+		peak.rms = fFrames > 0 ? ( float )std::sqrt( fSum / fFrames ) : 0;
+		out[ i ] = peak;
+	}
+}
+
+long long SamplePeaks::get_size() const
+{
+	long long nSize = 0;
+	for ( int c = 0; c < __channels; c++ ) {
+		for ( const std::vector<Peak>& level : __levels[ c ] ) {
+			nSize += level.size() * sizeof( Peak );
+		}
+	}
+	return nSize;
+}
+
+bool SamplePeaks::write( QIODevice* device ) const
+{
+	SamplePeaksHeader header;
+	memset( &header, 0, sizeof( header ) );
+	memcpy( header.magic, "H2SP", 4 );
+	header.version = SAMPLE_PEAKS_VERSION;
+	header.channels = __channels;
+	header.frames = __frames;
+	header.bucket_frames = __bucket_frames;
+	if ( device->write( reinterpret_cast<const char*>( &header ), sizeof( header ) ) != sizeof( header ) ) {
+		return false;
+	}
+	for ( int c = 0; c < __channels; c++ ) {
+		for ( const std::vector<Peak>& level : __levels[ c ] ) {
+			qint64 nSize = level.size() * sizeof( Peak );
+			if ( device->write( reinterpret_cast<const char*>( level.data() ), nSize ) != nSize ) {
+				return false;
+			}
+		}
+	}
+	return true;
+}
+
+std::shared_ptr<SamplePeaks> SamplePeaks::read( QIODevice* device )
+{
+	SamplePeaksHeader header;
+	if ( device->read( reinterpret_cast<char*>( &header ), sizeof( header ) ) != sizeof( header )
+		 || memcmp( header.magic, "H2SP", 4 ) != 0
+		 || header.version != SAMPLE_PEAKS_VERSION
+		 || ( header.channels != 1 && header.channels != 2 )
+		 || header.frames < 0 ) {
+		return nullptr;
+	}
+
+	if ( header.bucket_frames < 1 || header.bucket_frames > MAX_BUCKET_FRAMES ) {
+		return nullptr;
+	}
+
+	std::shared_ptr<SamplePeaks> pPeaks = std::make_shared<SamplePeaks>( header.frames, header.channels );
+	// a file may hold less frames than it announced
+	pPeaks->__bucket_frames = header.bucket_frames;
+	pPeaks->__appended = header.frames;
+	std::vector<int> sizes = get_level_sizes( header.frames, pPeaks->__bucket_frames );
+	for ( int c = 0; c < pPeaks->__channels; c++ ) {
+		std::vector<std::vector<Peak>>& levels = pPeaks->__levels[ c ];
+		levels.resize( sizes.size() );
+		for ( int nLevel = 0; nLevel < ( int )sizes.size(); nLevel++ ) {
+			levels[ nLevel ].resize( sizes[ nLevel ] );
+			qint64 nSize = sizes[ nLevel ] * sizeof( Peak );
+			if ( device->read( reinterpret_cast<char*>( levels[ nLevel ].data() ), nSize ) != nSize ) {
+				return nullptr;
+			}
+		}
+	}
+	if ( !device->atEnd() ) {
+		return nullptr;
+	}
+	return pPeaks;
+}
+
+};
+
+/* vim: set softtabstop=4 noexpandtab: */
@@ -32,6 +32,7 @@
 #include <hydrogen/globals.h>
 #include <hydrogen/timeline.h>
 #include <hydrogen/basics/song.h>
+#include <hydrogen/basics/song_binary.h>
 #include <hydrogen/basics/drumkit_component.h>
 #include <hydrogen/basics/sample.h>
 #include <hydrogen/basics/instrument.h>
@@ -604,8 +605,82 @@ Song* SongReader::readSong( const QString& filename )
 		return nullptr;
 	}
 
+	if ( SongBinary::is_binary( FileName ) ) {
+		return readSongBinary( FileName );
+	}
+
+	INFOLOG( "Reading " + FileName );
+
+	XMLStreamReader reader;
+	if ( !reader.open( FileName ) ) {
+		return nullptr;
+	}
+	if ( !reader.readNextStartElement() || reader.name() != "song" ) {
+		reader.report_error();
+		ERRORLOG( "Error reading song: song node not found" );
+		return nullptr;
+	}
+
+	QDomDocument doc;
+	QDomElement songNode = doc.createElement( "song" );
+	doc.appendChild( songNode );
+	PatternList* pPatternList = nullptr;
+	while ( reader.readNextStartElement() ) {
+		if ( reader.name() == "patternList" && pPatternList == nullptr ) {
+			pPatternList = new PatternList();
+			while ( reader.readNextStartElement() ) {
+				if ( reader.name() == "pattern" ) {
+					pPatternList->add( readPattern( reader ) );
+				} else {
+					reader.skipCurrentElement();
+				}
+			}
+		} else {
+			songNode.appendChild( reader.read_element( doc ) );
+		}
+	}
+	if ( reader.report_error() ) {
+		delete pPatternList;
+		return nullptr;
+	}
+	if ( pPatternList == nullptr ) {
+		pPatternList = new PatternList();
+	}
+
+	return readSongNode( songNode, pPatternList, FileName );
+}
+
+Song* SongReader::readSongBinary( const QString& filename )
+{
+	INFOLOG( "Reading binary song " + filename );
+
+	SongBinary binary;
+	QDomDocument doc;
+	if ( !binary.open( filename ) || !binary.read_document( doc ) ) {
+		return nullptr;
+	}
+	QDomElement songNode = doc.documentElement();
+	if ( songNode.tagName() != "song" ) {
+		ERRORLOG( "Error reading song: song node not found" );
+		return nullptr;
+	}
+
+	PatternList* pPatternList = new PatternList();
+	for ( int i = 0; i < binary.get_pattern_count(); i++ ) {
+		pPatternList->add( binary.read_pattern( i ) );
+	}
+
+	return readSongNode( songNode, pPatternList, filename );
+}
+
+Song* SongReader::readSongDocument( const QString& filename )
+{
+	QString FileName = getPath ( filename );
+	if ( FileName.isEmpty() ) {
+		return nullptr;
+	}
+
 	INFOLOG( "Reading " + FileName );
-	Song* pSong = nullptr;
 
 	QDomDocument doc = LocalFileMng::openXmlDocument( FileName );
 	QDomNodeList nodeList = doc.elementsByTagName( "song" );
@@ -615,7 +690,12 @@ Song* SongReader::readSong( const QString& filename )
 		return nullptr;
 	}
 
-	QDomNode songNode = nodeList.at( 0 );
+	return readSongNode( nodeList.at( 0 ), nullptr, FileName );
+}
+
+Song* SongReader::readSongNode( QDomNode songNode, PatternList* pPatternList, const QString& FileName )
+{
+	Song* pSong = nullptr;
 
 	m_sSongVersion = LocalFileMng::readXmlString( songNode, "version", "Unknown version" );
 
@@ -996,29 +1076,52 @@ Song* SongReader::readSong( const QString& filename )
 		pSong->set_instrument_list( pInstrList );
 	} else {
 		ERRORLOG( "Error reading song: instrumentList node not found" );
+		delete pPatternList;
 		delete pSong;
 		return nullptr;
 	}
 
 	// Pattern list
-	QDomNode patterns = songNode.firstChildElement( "patternList" );
-
-	PatternList* pPatternList = new PatternList();
 	int pattern_count = 0;
+	if ( pPatternList != nullptr ) {
+		// read by readSong(), the notes get their instrument now
+		pattern_count = pPatternList->size();
+		for ( int i = 0; i < pattern_count; i++ ) {
+			Pattern* pPattern = pPatternList->get( i );
+			std::vector<Note*> skipped;
+			for ( auto it = pPattern->get_notes()->begin(); it != pPattern->get_notes()->end(); ++it ) {
+				Note* pNote = it->second;
+				if ( !pInstrList->find( pNote->get_instrument_id() ) ) {
+					ERRORLOG( QString( "Instrument with ID: '%1' not found. Note skipped." ).arg( pNote->get_instrument_id() ) );
+					skipped.push_back( pNote );
+				} else {
+					pNote->map_instrument( pInstrList );
+				}
+			}
+			for ( Note* pNote : skipped ) {
+				pPattern->remove_note( pNote );
+				delete pNote;
+			}
+		}
+	} else {
+		QDomNode patterns = songNode.firstChildElement( "patternList" );
 
-	QDomNode patternNode =  patterns.firstChildElement( "pattern" );
-	while (  !patternNode.isNull()  ) {
-		pattern_count++;
-		Pattern* pPattern = getPattern( patternNode, pInstrList );
-		if ( pPattern ) {
-			pPatternList->add( pPattern );
-		} else {
-			ERRORLOG( "Error loading pattern" );
-			delete pPatternList;
-			delete pSong;
-			return nullptr;
+		pPatternList = new PatternList();
+
+		QDomNode patternNode =  patterns.firstChildElement( "pattern" );
+		while (  !patternNode.isNull()  ) {
+			pattern_count++;
+			Pattern* pPattern = getPattern( patternNode, pInstrList );
+			if ( pPattern ) {
+				pPatternList->add( pPattern );
+			} else {
+				ERRORLOG( "Error loading pattern" );
+				delete pPatternList;
+				delete pSong;
+				return nullptr;
+			}
+			patternNode = ( QDomNode ) patternNode.nextSiblingElement( "pattern" );
 		}
-		patternNode = ( QDomNode ) patternNode.nextSiblingElement( "pattern" );
 	}
 	if ( pattern_count == 0 ) {
 		WARNINGLOG( "0 patterns?" );
@@ -1358,4 +1461,62 @@ Pattern* SongReader::getPattern( QDomNode pattern, InstrumentList* instrList )
 
 	return pPattern;
 }
+Pattern* SongReader::readPattern( XMLStreamReader& reader )
+{
+	QString sName;
+	QString sInfo;
+	QString sCategory;
+	int nSize = -1;
+
+	Pattern* pPattern = new Pattern( sName, sInfo, sCategory, nSize );
+	while ( reader.readNextStartElement() ) {
+		QStringRef element = reader.name();
+		if ( element == "name" ) {
+			sName = reader.read_string( sName );
+		} else if ( element == "info" ) {
+			sInfo = reader.read_string( sInfo );
+		} else if ( element == "category" ) {
+			sCategory = reader.read_string( sCategory );
+		} else if ( element == "size" ) {
+			nSize = reader.read_int( nSize );
+		} else if ( element == "noteList" ) {
+			while ( reader.readNextStartElement() ) {
+				if ( reader.name() == "note" ) {
+					pPattern->insert_note( Note::load_from( &reader, nullptr ) );
+				} else {
+					reader.skipCurrentElement();
+				}
+			}
+		} else if ( element == "sequenceList" ) {
+			// Back compatibility code. Version < 0.9.4
+			while ( reader.readNextStartElement() ) {
+				if ( reader.name() != "sequence" ) {
+					reader.skipCurrentElement();
+					continue;
+				}
+				while ( reader.readNextStartElement() ) {
+					if ( reader.name() != "noteList" ) {
+						reader.skipCurrentElement();
+						continue;
+					}
+					while ( reader.readNextStartElement() ) {
+						if ( reader.name() == "note" ) {
+							pPattern->insert_note( Note::load_from( &reader, nullptr ) );
+						} else {
+							reader.skipCurrentElement();
+						}
+					}
+				}
+			}
+		} else {
+			reader.skipCurrentElement();
+		}
+	}
+	pPattern->set_name( sName );
+	pPattern->set_info( sInfo );
+	pPattern->set_category( sCategory );
+	pPattern->set_length( nSize );
+
+	return pPattern;
+}
 };
@@ -0,0 +1,320 @@
+/*
+ * Hydrogen
+ * Copyright(c) 2002-2008 by Alex >Comix< Cominu [comix@users.sourceforge.net]
+ *
+ * http://www.hydrogen-music.org
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY, without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ */
+
+#include <hydrogen/basics/song_binary.h>
+
+#include <cassert>
+#include <cstring>
+#include <vector>
+
+#include <hydrogen/basics/instrument.h>
+#include <hydrogen/basics/note.h>
+#include <hydrogen/basics/pattern.h>
+#include <hydrogen/basics/pattern_list.h>
+#include <hydrogen/basics/song.h>
+
+namespace H2Core
+{
+
+const char* SongBinary::__class_name = "SongBinary";
+
+/** bumped whenever the layout of a chunk changes */
+static const uint32_t SONG_BINARY_VERSION = 1;
+
+/** start of the file, followed by #SongBinaryHeader::chunks #SongBinaryChunk */
+struct SongBinaryHeader {
+	char magic[4];          ///< "H2SB"
+	uint32_t version;       ///< #SONG_BINARY_VERSION, also rejects the other byte order
+	uint32_t chunks;
+	uint32_t reserved;
+};
+
+struct SongBinaryChunk {
+	char id[4];
+	uint32_t reserved;
+	uint64_t offset;        ///< from the start of the file
+	uint64_t size;          ///< in bytes
+};
+
+/** a record of the "PATS" chunk, the strings are in the "STRS" chunk */
+struct SongBinaryPattern {
+	uint32_t name;
+	uint32_t name_size;
+	uint32_t info;
+	uint32_t info_size;
+	uint32_t category;
+	uint32_t category_size;
+	int32_t length;
+	uint32_t reserved;
+	uint64_t first_note;    ///< index of its first record in the "NOTE" chunk
+	uint64_t notes;
+};
+
+/** a record of the "NOTE" chunk */
+struct SongBinaryNote {
+	int32_t position;
+	int32_t length;
+	int32_t instrument;
+	float velocity;
+	float pan_l;
+	float pan_r;
+	float pitch;
+	float lead_lag;
+	float probability;
+	int8_t key;
+	int8_t octave;
+	uint8_t note_off;
+	uint8_t reserved;
+};
+
+/** \return \a size rounded up to keep the chunks aligned */
+static qint64 song_binary_align( qint64 size )
+{
+	return ( size + 7 ) & ~( qint64 )7;
+}
+
+SongBinary::SongBinary() : Object( __class_name ),
+	__map( nullptr ),
+	__xml( nullptr ),
+	__xml_size( 0 ),
+	__patterns( nullptr ),
+	__pattern_count( 0 ),
+	__strings( nullptr ),
+	__strings_size( 0 ),
+	__notes( nullptr ),
+	__note_count( 0 )
+{
+}
+
+SongBinary::~SongBinary()
+{
+	// the QFile unmaps the file
+}
+
+bool SongBinary::is_binary( const QString& filename )
+{
+	QFile file( filename );
+	char magic[4];
+	return file.open( QIODevice::ReadOnly )
+		&& file.read( magic, sizeof( magic ) ) == sizeof( magic )
+		&& memcmp( magic, "H2SB", 4 ) == 0;
+}
+
+QByteArray SongBinary::encode( const QDomDocument& doc, Song* song )
+{
+	QByteArray xml = doc.toByteArray( 1 );
+	QByteArray strings;
+	std::vector<SongBinaryPattern> patterns;
+	std::vector<SongBinaryNote> notes;
+
+	auto add_string = [&strings]( const QString& str, uint32_t* offset, uint32_t* size ) {
+		QByteArray utf8 = str.toUtf8();
+		*offset = strings.size();
+		*size = utf8.size();
+		strings += utf8;
+	};
+
+	PatternList* pattern_list = song->get_pattern_list();
+	for ( int i = 0; i < pattern_list->size(); i++ ) {
+		Pattern* pattern = pattern_list->get( i );
+		SongBinaryPattern record;
+		memset( &record, 0, sizeof( record ) );
+		add_string( pattern->get_name(), &record.name, &record.name_size );
+		add_string( pattern->get_info(), &record.info, &record.info_size );
+		add_string( pattern->get_category(), &record.category, &record.category_size );
+		record.length = pattern->get_length();
+		record.first_note = notes.size();
+
+		const Pattern::notes_t* pattern_notes = pattern->get_notes();
+		FOREACH_NOTE_CST_IT_BEGIN_END( pattern_notes, it ) {
+			Note* note = it->second;
+			SongBinaryNote note_record;
+			memset( &note_record, 0, sizeof( note_record ) );
+			note_record.position = note->get_position();
+			note_record.length = note->get_length();
+			note_record.instrument = note->get_instrument()->get_id();
+			note_record.velocity = note->get_velocity();
+			note_record.pan_l = note->get_pan_l();
+			note_record.pan_r = note->get_pan_r();
+			note_record.pitch = note->get_pitch();
+			note_record.lead_lag = note->get_lead_lag();
+			note_record.probability = note->get_probability();
+			note_record.key = note->get_key();
+			note_record.octave = note->get_octave();
+			note_record.note_off = note->get_note_off();
+			notes.push_back( note_record );
+		}
+		record.notes = notes.size() - record.first_note;
+		patterns.push_back( record );
+	}
+
+	const char* ids[] = { "XML ", "PATS", "STRS", "NOTE" };
+	const char* data[] = { xml.constData(), reinterpret_cast<const char*>( patterns.data() ),
+						   strings.constData(), reinterpret_cast<const char*>( notes.data() ) };
+	qint64 sizes[] = { xml.size(), ( qint64 )( patterns.size() * sizeof( SongBinaryPattern ) ),
+					   strings.size(), ( qint64 )( notes.size() * sizeof( SongBinaryNote ) ) };
+	const int nChunks = 4;
+
+	SongBinaryHeader header;
+	memset( &header, 0, sizeof( header ) );
+	memcpy( header.magic, "H2SB", 4 );
+	header.version = SONG_BINARY_VERSION;
+	header.chunks = nChunks;
+
+	SongBinaryChunk chunks[ nChunks ];
+	qint64 offset = sizeof( header ) + sizeof( chunks );
+	for ( int i = 0; i < nChunks; i++ ) {
+		memset( &chunks[ i ], 0, sizeof( SongBinaryChunk ) );
+		memcpy( chunks[ i ].id, ids[ i ], 4 );
+		chunks[ i ].offset = offset;
+		chunks[ i ].size = sizes[ i ];
+		offset = song_binary_align( offset + sizes[ i ] );
+	}
+
+	QByteArray file;
+	file.reserve( offset );
+	file.append( reinterpret_cast<const char*>( &header ), sizeof( header ) );
+	file.append( reinterpret_cast<const char*>( chunks ), sizeof( chunks ) );
+	for ( int i = 0; i < nChunks; i++ ) {
+		file.append( data[ i ], sizes[ i ] );
+		file.append( QByteArray( song_binary_align( sizes[ i ] ) - sizes[ i ], '\0' ) );
+	}
+	INFOLOG( QString( "%1 patterns, %2 notes encoded" ).arg( patterns.size() ).arg( notes.size() ) );
+	return file;
+}
+
+bool SongBinary::open( const QString& filename )
+{
+	__file.setFileName( filename );
+	if ( !__file.open( QIODevice::ReadOnly ) ) {
+		ERRORLOG( QString( "Unable to open %1 for reading" ).arg( filename ) );
+		return false;
+	}
+	qint64 size = __file.size();
+	__map = size >= ( qint64 )sizeof( SongBinaryHeader ) ? __file.map( 0, size ) : nullptr;
+	if ( __map == nullptr ) {
+		ERRORLOG( QString( "Unable to map %1" ).arg( filename ) );
+		return false;
+	}
+
+	SongBinaryHeader header;
+	memcpy( &header, __map, sizeof( header ) );
+	if ( memcmp( header.magic, "H2SB", 4 ) != 0 || header.version != SONG_BINARY_VERSION
+		 || ( qint64 )( sizeof( header ) + ( quint64 )header.chunks * sizeof( SongBinaryChunk ) ) > size ) {
+		ERRORLOG( QString( "%1 is not a binary song of version %2" ).arg( filename ).arg( SONG_BINARY_VERSION ) );
+		return false;
+	}
+
+	for ( uint32_t i = 0; i < header.chunks; i++ ) {
+		SongBinaryChunk chunk;
+		memcpy( &chunk, __map + sizeof( header ) + i * sizeof( chunk ), sizeof( chunk ) );
+		if ( chunk.offset > ( quint64 )size || chunk.size > ( quint64 )size - chunk.offset ) {
+			ERRORLOG( QString( "%1 is truncated" ).arg( filename ) );
+			return false;
+		}
+		const uchar* pData = __map + chunk.offset;
+		if ( memcmp( chunk.id, "XML ", 4 ) == 0 ) {
+			__xml = reinterpret_cast<const char*>( pData );
+			__xml_size = chunk.size;
+		} else if ( memcmp( chunk.id, "PATS", 4 ) == 0 ) {
+			__patterns = pData;
+			__pattern_count = chunk.size / sizeof( SongBinaryPattern );
+		} else if ( memcmp( chunk.id, "STRS", 4 ) == 0 ) {
+			__strings = reinterpret_cast<const char*>( pData );
+			__strings_size = chunk.size;
+		} else if ( memcmp( chunk.id, "NOTE", 4 ) == 0 ) {
+			__notes = pData;
+			__note_count = chunk.size / sizeof( SongBinaryNote );
+		}
+	}
+	if ( __xml == nullptr ) {
+		ERRORLOG( QString( "%1 has no song document" ).arg( filename ) );
+		return false;
+	}
+
+	// read_pattern() relies on the records pointing within the file
+	for ( int i = 0; i < __pattern_count; i++ ) {
+		SongBinaryPattern record;
+		memcpy( &record, __patterns + i * sizeof( record ), sizeof( record ) );
+		if ( ( qint64 )record.name + record.name_size > __strings_size
+			 || ( qint64 )record.info + record.info_size > __strings_size
+			 || ( qint64 )record.category + record.category_size > __strings_size
+			 || record.first_note > ( quint64 )__note_count || record.notes > ( quint64 )__note_count - record.first_note ) {
+			ERRORLOG( QString( "%1: pattern %2 is invalid" ).arg( filename ).arg( i ) );
+			return false;
+		}
+	}
+	return true;
+}
+
+bool SongBinary::read_document( QDomDocument& doc ) const
+{
+	QString msg;
+	int line, column;
+	if ( !doc.setContent( QByteArray::fromRawData( __xml, __xml_size ), &msg, &line, &column ) ) {
+		ERRORLOG( QString( "Unable to read the song document of %1, line %2 column %3: %4" )
+				  .arg( __file.fileName() ).arg( line ).arg( column ).arg( msg ) );
+		return false;
+	}
+	return true;
+}
+
+QString SongBinary::read_string( quint32 offset, quint32 size ) const
+{
+	return size == 0 ? QString( "" ) : QString::fromUtf8( __strings + offset, size );
+}
+
+QString SongBinary::get_pattern_name( int idx ) const
+{
+	assert( idx >= 0 && idx < __pattern_count );
+	SongBinaryPattern record;
+	memcpy( &record, __patterns + idx * sizeof( record ), sizeof( record ) );
+	return read_string( record.name, record.name_size );
+}
+
+Pattern* SongBinary::read_pattern( int idx ) const
+{
+	assert( idx >= 0 && idx < __pattern_count );
+	SongBinaryPattern record;
+	memcpy( &record, __patterns + idx * sizeof( record ), sizeof( record ) );
+	Pattern* pattern = new Pattern( read_string( record.name, record.name_size ),
+									read_string( record.info, record.info_size ),
+									read_string( record.category, record.category_size ),
+									record.length );
+	for ( quint64 i = record.first_note; i < record.first_note + record.notes; i++ ) {
+		SongBinaryNote note_record;
+		memcpy( &note_record, __notes + i * sizeof( note_record ), sizeof( note_record ) );
+		Note* note = new Note( nullptr, note_record.position, note_record.velocity,
+							   note_record.pan_l, note_record.pan_r, note_record.length, note_record.pitch );
+		note->set_lead_lag( note_record.lead_lag );
+		note->set_key_octave( ( Note::Key )note_record.key, ( Note::Octave )note_record.octave );
+		note->set_note_off( note_record.note_off != 0 );
+		note->set_instrument_id( note_record.instrument );
+		note->set_probability( note_record.probability );
+		pattern->insert_note( note );
+	}
+	return pattern;
+}
+
+};
+
+/* vim: set softtabstop=4 noexpandtab: */
@@ -0,0 +1,271 @@
+/*
+ * Hydrogen
+ * Copyright(c) 2002-2008 by Alex >Comix< Cominu [comix@users.sourceforge.net]
+ *
+ * http://www.hydrogen-music.org
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY, without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ */
+
+
+#include <hydrogen/basics/song_event_timeline.h>
+
+#include <algorithm>
+
+#include <hydrogen/globals.h>
+#include <hydrogen/basics/song.h>
+#include <hydrogen/basics/pattern.h>
+#include <hydrogen/basics/pattern_list.h>
+
+namespace H2Core
+{
+
+const char* SongEventTimeline::__class_name = "SongEventTimeline";
+
+static bool event_tick_less( const SongEventTimeline::Event& a, const SongEventTimeline::Event& b )
+{
+	return a.tick < b.tick;
+}
+
+SongEventTimeline::SongEventTimeline()
+	: Object( __class_name )
+	, __song( nullptr )
+	, __revision( -1 )
+	, __song_size( 0 )
+	, __cursor_column( -1 )
+	, __cursor_event( 0 )
+{
+}
+
+SongEventTimeline::SongEventTimeline( const SongEventTimeline& other )
+	: Object( __class_name )
+	, __song( other.__song )
+	, __revision( other.__revision )
+	, __song_size( other.__song_size )
+	, __columns( other.__columns )
+	, __cursor_column( -1 )
+	, __cursor_event( 0 )
+{
+}
+
+SongEventTimeline::~SongEventTimeline()
+{
+}
+
+void SongEventTimeline::clear()
+{
+	__song = nullptr;
+	__revision = -1;
+	__song_size = 0;
+	__columns.clear();
+	__cursor_column = -1;
+	__cursor_event = 0;
+}
+
+bool SongEventTimeline::is_up_to_date( const Column& column, PatternList* list )
+{
+	// An unchanged list means unchanged direct patterns. They come
+	// before their virtual patterns in #patterns, so a removed
+	// virtual pattern is noticed through the revision of its owner
+	// before it could be dereferenced.
+	if ( column.list != list || column.list_revision != list->get_revision() ) {
+		return false;
+	}
+	for ( int i = 0; i < ( int )column.patterns.size(); ++i ) {
+		if ( column.patterns[ i ]->get_revision() != column.revisions[ i ] ) {
+			return false;
+		}
+	}
+	return true;
+}
+
+void SongEventTimeline::compile( Column* column, PatternList* list )
+{
+	column->list = list;
+	column->list_revision = list->get_revision();
+	column->patterns.clear();
+	column->revisions.clear();
+	column->events.clear();
+
+	// same length rule as findPatternInTick()
+	if ( list->size() != 0 ) {
+		column->length = list->get( 0 )->get_length();
+	} else {
+		column->length = MAX_NOTES;
+	}
+
+	// same order as the playing pattern list built by the engine
+	for ( int i = 0; i < list->size(); ++i ) {
+		Pattern* pattern = list->get( i );
+		if ( std::find( column->patterns.begin(), column->patterns.end(), pattern ) == column->patterns.end() ) {
+			column->patterns.push_back( pattern );
+		}
+		const Pattern::virtual_patterns_t* virtuals = pattern->get_flattened_virtual_patterns();
+		for ( Pattern::virtual_patterns_cst_it_t it = virtuals->begin(); it != virtuals->end(); ++it ) {
+			if ( std::find( column->patterns.begin(), column->patterns.end(), *it ) == column->patterns.end() ) {
+				column->patterns.push_back( *it );
+			}
+		}
+	}
+
+	for ( int i = 0; i < ( int )column->patterns.size(); ++i ) {
+		Pattern* pattern = column->patterns[ i ];
+		column->revisions.push_back( pattern->get_revision() );
+		const Pattern::notes_t* notes = pattern->get_notes();
+		int last_tick = -1;
+		for ( Pattern::notes_cst_it_t it = notes->begin(); it != notes->end(); ++it ) {
+			if ( it->first == last_tick ) {
+				continue;
+			}
+			last_tick = it->first;
+			if ( last_tick < 0 || last_tick >= column->length ) {
+				continue;
+			}
+			Event event;
+			event.tick = last_tick;
+			event.pattern = i;
+			column->events.push_back( event );
+		}
+	}
+	// keep the pattern order within a tick
+	std::stable_sort( column->events.begin(), column->events.end(), event_tick_less );
+}
+
+bool SongEventTimeline::update( Song* song )
+{
+	std::vector<PatternList*>* groups = song->get_pattern_group_vector();
+	int revision = Pattern::get_last_revision();
+	if ( song == __song && revision == __revision && groups->size() == __columns.size() ) {
+		return false;
+	}
+
+	bool changed = ( song != __song );
+	__song = song;
+	__revision = revision;
+
+	if ( groups->size() != __columns.size() ) {
+		Column empty;
+		empty.list = nullptr;
+		empty.list_revision = -1;
+		empty.start_tick = 0;
+		empty.length = 0;
+		__columns.resize( groups->size(), empty );
+		changed = true;
+	}
+
+	int start_tick = 0;
+	for ( int i = 0; i < ( int )__columns.size(); ++i ) {
+		Column& column = __columns[ i ];
+		PatternList* list = ( *groups )[ i ];
+		if ( changed || !is_up_to_date( column, list ) ) {
+			compile( &column, list );
+			changed = true;
+		}
+		column.start_tick = start_tick;
+		start_tick += column.length;
+	}
+	__song_size = start_tick;
+
+	if ( changed ) {
+		__cursor_column = -1;
+		__cursor_event = 0;
+	}
+	return changed;
+}
+
+int SongEventTimeline::find_column( int tick, bool loop_mode, int* start_tick, int* song_size )
+{
+	*song_size = 0;
+	if ( __columns.empty() || __song_size <= 0 || tick < 0 ) {
+		return -1;
+	}
+
+	// ticks of the following turns are added on top of the song size
+	if ( tick >= __song_size ) {
+		if ( !loop_mode ) {
+			return -1;
+		}
+		*song_size = __song_size;
+		tick = tick % __song_size;
+	}
+
+	// most of the time we are still in the same column or in the next one
+	for ( int idx = __cursor_column; idx >= 0 && idx <= __cursor_column + 1 && idx < ( int )__columns.size(); ++idx ) {
+		const Column& column = __columns[ idx ];
+		if ( tick >= column.start_tick && tick < column.start_tick + column.length ) {
+			if ( idx != __cursor_column ) {
+				__cursor_column = idx;
+				__cursor_event = 0;
+			}
+			*start_tick = column.start_tick;
+			return idx;
+		}
+	}
+
+	// last column starting at or before tick
+	int lo = 0;
+	int hi = __columns.size();
+	while ( hi - lo > 1 ) {
+		int mid = ( lo + hi ) / 2;
+		if ( __columns[ mid ].start_tick <= tick ) {
+			lo = mid;
+		} else {
+			hi = mid;
+		}
+	}
+	__cursor_column = lo;
+	__cursor_event = 0;
+	*start_tick = __columns[ lo ].start_tick;
+	return lo;
+}
+
+void SongEventTimeline::get_events( int column, int tick, int* first, int* last )
+{
+	*first = 0;
+	*last = 0;
+	if ( column < 0 || column >= ( int )__columns.size() ) {
+		return;
+	}
+	const std::vector<Event>& events = __columns[ column ].events;
+	int size = events.size();
+
+	int i;
+	if ( column == __cursor_column && __cursor_event <= size
+		 && ( __cursor_event == 0 || events[ __cursor_event - 1 ].tick < tick ) ) {
+		i = __cursor_event;
+		while ( i < size && events[ i ].tick < tick ) {
+			++i;
+		}
+	} else {
+		Event key;
+		key.tick = tick;
+		key.pattern = 0;
+		i = std::lower_bound( events.begin(), events.end(), key, event_tick_less ) - events.begin();
+		__cursor_column = column;
+	}
+
+	int j = i;
+	while ( j < size && events[ j ].tick == tick ) {
+		++j;
+	}
+	*first = i;
+	*last = j;
+	__cursor_event = j;
+}
+
+};
+
+/* vim: set softtabstop=4 noexpandtab: */
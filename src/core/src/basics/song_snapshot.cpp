@@ -0,0 +1,182 @@
+/*
+ * Hydrogen
+ * Copyright(c) 2002-2008 by Alex >Comix< Cominu [comix@users.sourceforge.net]
+ *
+ * http://www.hydrogen-music.org
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY, without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ */
+
+#include <hydrogen/basics/song_snapshot.h>
+
+#include <algorithm>
+
+#include <hydrogen/basics/note.h>
+#include <hydrogen/basics/pattern.h>
+#include <hydrogen/basics/pattern_list.h>
+#include <hydrogen/basics/song.h>
+
+namespace H2Core
+{
+
+const char* SongSnapshot::__class_name = "SongSnapshot";
+
+SongSnapshot::PatternNotes::PatternNotes( const Pattern* pattern )
+	: __revision( pattern->get_revision() )
+	, __played_any( false )
+{
+	const Pattern::notes_t* notes = pattern->get_notes();
+	__ticks.reserve( notes->size() );
+	__notes.reserve( notes->size() );
+	__sources.reserve( notes->size() );
+	FOREACH_NOTE_CST_IT_BEGIN_END( notes, it ) {
+		__ticks.push_back( it->first );
+		Note* copy = new Note( it->second );
+		// not copied by Note( Note* ), read by the destructive recording
+		copy->set_instrument_id( it->second->get_instrument_id() );
+		copy->set_specific_compo_id( it->second->get_specific_compo_id() );
+		__notes.push_back( copy );
+		__sources.push_back( it->second );
+	}
+	__played.reset( new std::atomic<bool>[ __notes.size() ] );
+	for ( int i = 0; i < ( int )__notes.size(); i++ ) {
+		__played[ i ].store( false, std::memory_order_relaxed );
+	}
+}
+
+SongSnapshot::PatternNotes::~PatternNotes()
+{
+	for ( Note* note : __notes ) {
+		delete note;
+	}
+}
+
+void SongSnapshot::PatternNotes::get_range( int tick, int* first, int* last ) const
+{
+	auto range = std::equal_range( __ticks.begin(), __ticks.end(), tick );
+	*first = range.first - __ticks.begin();
+	*last = range.second - __ticks.begin();
+}
+
+bool SongSnapshot::PatternNotes::is_just_recorded( int idx ) const
+{
+	return __notes[ idx ]->get_just_recorded()
+		&& !__played[ idx ].load( std::memory_order_relaxed );
+}
+
+void SongSnapshot::PatternNotes::set_played( int idx ) const
+{
+	if ( is_just_recorded( idx ) ) {
+		__played[ idx ].store( true, std::memory_order_release );
+		__played_any.store( true, std::memory_order_release );
+	}
+}
+
+void SongSnapshot::PatternNotes::sync_played( Pattern* pattern ) const
+{
+	if ( !__played_any.load( std::memory_order_acquire ) ) {
+		return;
+	}
+	// The source notes may have been deleted since, they are only
+	// compared to the ones still in the pattern.
+	const Pattern::notes_t* notes = pattern->get_notes();
+	for ( int i = 0; i < ( int )__notes.size(); i++ ) {
+		if ( !__played[ i ].load( std::memory_order_acquire ) ) {
+			continue;
+		}
+		FOREACH_NOTE_CST_IT_BOUND( notes, it, __ticks[ i ] ) {
+			if ( it->second == __sources[ i ] ) {
+				it->second->set_just_recorded( false );
+				break;
+			}
+		}
+	}
+}
+
+SongSnapshot::SongSnapshot( Song* song, const SongSnapshot* previous, int version )
+	: Object( __class_name )
+	, __version( version )
+	, __changed( previous == nullptr )
+	, __song( song )
+	, __timeline( previous != nullptr ? previous->__timeline : SongEventTimeline() )
+{
+	if ( song == nullptr ) {
+		__timeline.clear();
+		__changed = __changed || previous->__song != nullptr;
+		return;
+	}
+
+	PatternList* patterns = song->get_pattern_list();
+	for ( int i = 0; i < patterns->size(); i++ ) {
+		Pattern* pattern = patterns->get( i );
+		std::shared_ptr<PatternNotes> notes;
+		if ( previous != nullptr ) {
+			notes_map_t::const_iterator it = previous->__notes.find( pattern );
+			if ( it != previous->__notes.end() ) {
+				if ( it->second->get_revision() == pattern->get_revision() ) {
+					notes = it->second;
+				} else {
+					// the notes played until now are copied as such
+					it->second->sync_played( pattern );
+				}
+			}
+		}
+		if ( notes == nullptr ) {
+			notes = std::make_shared<PatternNotes>( pattern );
+			__changed = true;
+		}
+		__notes[ pattern ] = notes;
+	}
+	if ( previous != nullptr && previous->__notes.size() != __notes.size() ) {
+		__changed = true;
+	}
+
+	if ( __timeline.update( song ) ) {
+		__changed = true;
+	}
+}
+
+SongSnapshot::~SongSnapshot()
+{
+}
+
+const SongSnapshot::PatternNotes* SongSnapshot::get_notes( const Pattern* pattern ) const
+{
+	notes_map_t::const_iterator it = __notes.find( pattern );
+	if ( it == __notes.end() ) {
+		return nullptr;
+	}
+	return it->second.get();
+}
+
+void SongSnapshot::sync_played() const
+{
+	if ( __song == nullptr ) {
+		return;
+	}
+	PatternList* patterns = __song->get_pattern_list();
+	for ( int i = 0; i < patterns->size(); i++ ) {
+		Pattern* pattern = patterns->get( i );
+		notes_map_t::const_iterator it = __notes.find( pattern );
+		if ( it != __notes.end() ) {
+			it->second->sync_played( pattern );
+		}
+	}
+}
+
+};
+
+/* vim: set softtabstop=4 noexpandtab: */
@@ -491,8 +491,8 @@ bool CoreActionController::isSongPathValid( const QString& songPath ) {
 		}
 	}
 	
-	if ( songFileInfo.suffix() != "h2song" ) {
-		ERRORLOG( QString( "Error: Unable to handle path [%1]. The provided file must have the suffix '.h2song'!" )
+	if ( songFileInfo.suffix() != "h2song" && songFileInfo.suffix() != "h2songb" ) {
+		ERRORLOG( QString( "Error: Unable to handle path [%1]. The provided file must have the suffix '.h2song' or '.h2songb'!" )
 					.arg( songPath.toLocal8Bit().data() ));
 		return false;
 	}
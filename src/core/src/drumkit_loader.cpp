@@ -0,0 +1,207 @@
+/*
+ * Hydrogen
+ * Copyright(c) 2002-2008 by Alex >Comix< Cominu [comix@users.sourceforge.net]
+ *
+ * http://www.hydrogen-music.org
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY, without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ */
+
+#include <hydrogen/drumkit_loader.h>
+
+#include <algorithm>
+#include <thread>
+
+#include <QSet>
+
+#include <hydrogen/event_queue.h>
+#include <hydrogen/basics/drumkit.h>
+#include <hydrogen/basics/drumkit_component.h>
+#include <hydrogen/basics/instrument.h>
+#include <hydrogen/basics/instrument_component.h>
+#include <hydrogen/basics/instrument_layer.h>
+#include <hydrogen/basics/instrument_list.h>
+#include <hydrogen/basics/sample.h>
+#include <hydrogen/basics/sample_cache.h>
+
+namespace H2Core
+{
+
+const char* DrumkitLoader::__class_name = "DrumkitLoader";
+
+DrumkitLoader::DrumkitLoader( Drumkit* pDrumkit, int nThreads )
+	: Object( __class_name ),
+	  __drumkit( new Drumkit( pDrumkit ) ),
+	  __instruments( new InstrumentList() ),
+	  __threads( nThreads ),
+	  __notify( false ),
+	  __started( false ),
+	  __cancelled( false ),
+	  __done( false ),
+	  __next( 0 ),
+	  __decoded_count( 0 )
+{
+	if ( __threads <= 0 ) {
+		__threads = std::max( 1U, std::thread::hardware_concurrency() );
+	}
+
+	// a sample shared by several layers is decoded once
+	QSet<QString> paths;
+	InstrumentList* pInstrList = __drumkit->get_instruments();
+	for ( int nInstr = 0; nInstr < pInstrList->size(); ++nInstr ) {
+		for ( auto& pComponent : *pInstrList->get( nInstr )->get_components() ) {
+			for ( int nLayer = 0; nLayer < InstrumentComponent::getMaxLayers(); nLayer++ ) {
+				InstrumentLayer* pLayer = pComponent->get_layer( nLayer );
+				if ( pLayer == nullptr || pLayer->get_sample() == nullptr ) {
+					continue;
+				}
+				QString sPath = __drumkit->get_path() + "/" + pLayer->get_sample()->get_filename();
+				if ( !paths.contains( sPath ) ) {
+					paths.insert( sPath );
+					__paths.push_back( sPath );
+				}
+			}
+		}
+	}
+	__decoded.resize( __paths.size() );
+}
+
+DrumkitLoader::~DrumkitLoader()
+{
+	cancel();
+	if ( __started ) {
+		pthread_join( __thread, nullptr );
+	}
+	for ( auto& pComponent : __components ) {
+		delete pComponent;
+	}
+	delete __instruments;
+	delete __drumkit;
+}
+
+bool DrumkitLoader::start()
+{
+	assert( !__started );
+	__notify = true;
+	if ( pthread_create( &__thread, nullptr, loader_thread, this ) != 0 ) {
+		ERRORLOG( "Can't create the drumkit loader thread" );
+		return false;
+	}
+	__started = true;
+	return true;
+}
+
+void* DrumkitLoader::loader_thread( void* pParam )
+{
+	DrumkitLoader* pLoader = static_cast<DrumkitLoader*>( pParam );
+	pLoader->run();
+	if ( pLoader->is_done() ) {
+		EventQueue::get_instance()->push_event( EVENT_DRUMKIT_LOADED, 0 );
+	}
+	return nullptr;
+}
+
+void DrumkitLoader::cancel()
+{
+	__cancelled.store( true );
+}
+
+bool DrumkitLoader::is_done() const
+{
+	return __done.load( std::memory_order_acquire );
+}
+
+void DrumkitLoader::run()
+{
+	INFOLOG( QString( "Loading drumkit %1, %2 samples on %3 threads" )
+			 .arg( __drumkit->get_name() ).arg( __paths.size() ).arg( __threads ) );
+
+	// decode the samples into the SampleCache, the calling thread
+	// being one of the decoders
+	int nThreads = std::min( __threads, ( int )__paths.size() );
+	std::vector<pthread_t> threads;
+	for ( int i = 1; i < nThreads; ++i ) {
+		pthread_t thread;
+		if ( pthread_create( &thread, nullptr, decoder_thread, this ) != 0 ) {
+			WARNINGLOG( QString( "Can't create drumkit decoder %1" ).arg( i ) );
+			break;
+		}
+		threads.push_back( thread );
+	}
+	decode();
+	for ( auto& thread : threads ) {
+		pthread_join( thread, nullptr );
+	}
+	if ( __cancelled.load() ) {
+		return;
+	}
+
+	// build the instruments out of the cached data, the song is not
+	// touched so nothing has to be locked
+	InstrumentList* pInstrList = __drumkit->get_instruments();
+	for ( int nInstr = 0; nInstr < pInstrList->size(); ++nInstr ) {
+		if ( __cancelled.load() ) {
+			return;
+		}
+		Instrument* pInstr = new Instrument();
+		pInstr->load_from( __drumkit, pInstrList->get( nInstr ), false );
+		__instruments->add( pInstr );
+	}
+	for ( auto& pSrcComponent : *__drumkit->get_components() ) {
+		DrumkitComponent* pComponent = new DrumkitComponent( pSrcComponent->get_id(), pSrcComponent->get_name() );
+		pComponent->load_from( pSrcComponent, false );
+		__components.push_back( pComponent );
+	}
+
+	// the instruments hold the data now
+	__decoded.clear();
+	__done.store( true, std::memory_order_release );
+}
+
+void* DrumkitLoader::decoder_thread( void* pParam )
+{
+	static_cast<DrumkitLoader*>( pParam )->decode();
+	return nullptr;
+}
+
+void DrumkitLoader::decode()
+{
+	SampleCache* pCache = SampleCache::get_instance();
+	int nPaths = __paths.size();
+	for ( ;; ) {
+		if ( __cancelled.load( std::memory_order_relaxed ) ) {
+			return;
+		}
+		int nPath = __next.fetch_add( 1 );
+		if ( nPath >= nPaths ) {
+			return;
+		}
+		// a file failing to decode is reported again by Sample::load(),
+		// which also takes care of the head of a streamed one
+		if ( !Sample::is_streamable( __paths[ nPath ] ) ) {
+			__decoded[ nPath ] = pCache->load( __paths[ nPath ] );
+		}
+
+		int nDecoded = __decoded_count.fetch_add( 1 ) + 1;
+		if ( __notify && nDecoded * 100 / nPaths != ( nDecoded - 1 ) * 100 / nPaths ) {
+			EventQueue::get_instance()->push_event( EVENT_DRUMKIT_LOAD_PROGRESS, nDecoded * 100 / nPaths );
+		}
+	}
+}
+
+};
+
+/* vim: set softtabstop=4 noexpandtab: */
@@ -0,0 +1,171 @@
+/*
+ * Hydrogen
+ * Copyright(c) 2002-2008 by Alex >Comix< Cominu [comix@users.sourceforge.net]
+ *
+ * http://www.hydrogen-music.org
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY, without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ */
+
+#include <hydrogen/dsp_profiler.h>
+
+#include <algorithm>
+
+namespace H2Core
+{
+
+const char* DspProfiler::__class_name = "DspProfiler";
+
+static inline uint32_t dsp_profiler_duration( uint64_t start_ns, uint64_t end_ns )
+{
+	uint64_t ns = ( end_ns > start_ns ) ? end_ns - start_ns : 0;
+	return ( ns > UINT32_MAX ) ? UINT32_MAX : ( uint32_t )ns;
+}
+
+static inline float dsp_profiler_ms( uint64_t ns )
+{
+	return ns / 1000000.0f;
+}
+
+DspProfiler::DspProfiler()
+	: Object( __class_name )
+{
+	reset();
+}
+
+DspProfiler::~DspProfiler()
+{
+}
+
+void DspProfiler::reset()
+{
+	for ( int nStage = 0; nStage < STAGES; ++nStage ) {
+		for ( int i = 0; i < WINDOW; ++i ) {
+			__rings[ nStage ].ns[ i ].store( 0, std::memory_order_relaxed );
+		}
+		__rings[ nStage ].count.store( 0, std::memory_order_release );
+	}
+	for ( int nBucket = 0; nBucket < VOICE_BUCKETS; ++nBucket ) {
+		__voice_buckets[ nBucket ].cycles.store( 0, std::memory_order_relaxed );
+		__voice_buckets[ nBucket ].total_ns.store( 0, std::memory_order_relaxed );
+		__voice_buckets[ nBucket ].max_ns.store( 0, std::memory_order_relaxed );
+	}
+}
+
+void DspProfiler::record( int stage, uint64_t start_ns, uint64_t end_ns )
+{
+	Ring& ring = __rings[ stage ];
+	// only the audio thread writes, a plain load/store pair is enough
+	unsigned nCount = ring.count.load( std::memory_order_relaxed );
+	ring.ns[ nCount % WINDOW ].store( dsp_profiler_duration( start_ns, end_ns ), std::memory_order_relaxed );
+	ring.count.store( nCount + 1, std::memory_order_release );
+}
+
+void DspProfiler::record_voices( int voices, uint64_t start_ns, uint64_t end_ns )
+{
+	int nBucket = 0;
+	while ( voices > 0 && nBucket < VOICE_BUCKETS - 1 ) {
+		voices >>= 1;
+		++nBucket;
+	}
+	uint32_t ns = dsp_profiler_duration( start_ns, end_ns );
+	Bucket& bucket = __voice_buckets[ nBucket ];
+	bucket.total_ns.store( bucket.total_ns.load( std::memory_order_relaxed ) + ns, std::memory_order_relaxed );
+	if ( ns > bucket.max_ns.load( std::memory_order_relaxed ) ) {
+		bucket.max_ns.store( ns, std::memory_order_relaxed );
+	}
+	bucket.cycles.store( bucket.cycles.load( std::memory_order_relaxed ) + 1, std::memory_order_release );
+}
+
+float DspProfiler::get_last( int stage ) const
+{
+	const Ring& ring = __rings[ stage ];
+	unsigned nCount = ring.count.load( std::memory_order_acquire );
+	if ( nCount == 0 ) {
+		return 0.0f;
+	}
+	return dsp_profiler_ms( ring.ns[ ( nCount - 1 ) % WINDOW ].load( std::memory_order_relaxed ) );
+}
+
+DspProfiler::Stats DspProfiler::get_stats( int stage ) const
+{
+	Stats stats = { 0.0f, 0.0f, 0.0f, 0 };
+	const Ring& ring = __rings[ stage ];
+	unsigned nCount = ring.count.load( std::memory_order_acquire );
+	int nSamples = std::min( nCount, ( unsigned )WINDOW );
+	if ( nSamples == 0 ) {
+		return stats;
+	}
+
+	// the writer may overwrite some of the oldest durations while
+	// they are copied, which only shifts the window by a few cycles
+	uint32_t samples[ WINDOW ];
+	for ( int i = 0; i < nSamples; ++i ) {
+		samples[ i ] = ring.ns[ i ].load( std::memory_order_relaxed );
+	}
+
+	uint32_t* pEnd = samples + nSamples;
+	uint32_t* p50 = samples + ( nSamples - 1 ) / 2;
+	std::nth_element( samples, p50, pEnd );
+	stats.p50 = dsp_profiler_ms( *p50 );
+	uint32_t* p99 = samples + ( nSamples - 1 ) * 99 / 100;
+	std::nth_element( p50, p99, pEnd );
+	stats.p99 = dsp_profiler_ms( *p99 );
+	stats.max = dsp_profiler_ms( *std::max_element( p99, pEnd ) );
+	stats.samples = nSamples;
+	return stats;
+}
+
+DspProfiler::VoiceBucket DspProfiler::get_voice_bucket( int bucket ) const
+{
+	VoiceBucket voiceBucket;
+	voiceBucket.min_voices = ( bucket == 0 ) ? 0 : 1 << ( bucket - 1 );
+	const Bucket& b = __voice_buckets[ bucket ];
+	voiceBucket.cycles = b.cycles.load( std::memory_order_acquire );
+	uint64_t nTotal = b.total_ns.load( std::memory_order_relaxed );
+	voiceBucket.mean = ( voiceBucket.cycles > 0 ) ? dsp_profiler_ms( nTotal ) / voiceBucket.cycles : 0.0f;
+	voiceBucket.max = dsp_profiler_ms( b.max_ns.load( std::memory_order_relaxed ) );
+	return voiceBucket;
+}
+
+const char* DspProfiler::stage_name( int stage )
+{
+	if ( stage >= LADSPA_SLOT && stage < LADSPA_SLOT + MAX_FX ) {
+		return "FX slot";
+	}
+	switch ( stage ) {
+	case TRANSPORT:
+		return "Transport";
+	case NOTE_QUEUE:
+		return "Note queue";
+	case PLAY_NOTES:
+		return "Play notes";
+	case SAMPLER:
+		return "Sampler";
+	case SYNTH:
+		return "Synth";
+	case LADSPA:
+		return "LADSPA";
+	case METERING:
+		return "Metering";
+	case TOTAL:
+		return "Total";
+	default:
+		return "";
+	}
+}
+
+};
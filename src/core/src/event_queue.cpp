@@ -38,15 +38,8 @@ const char* EventQueue::__class_name = "EventQueue";
 
 EventQueue::EventQueue()
 		: Object( __class_name )
-		, __read_index( 0 )
-		, __write_index( 0 )
 {
 	__instance = this;
-
-	for ( int i = 0; i < MAX_EVENTS; ++i ) {
-		__events_buffer[ i ].type = EVENT_NONE;
-		__events_buffer[ i ].value = 0;
-	}
 }
 
 
@@ -56,30 +49,37 @@ EventQueue::~EventQueue()
 }
 
 
-void EventQueue::push_event( const EventType type, const int nValue )
+bool EventQueue::push_event( const EventType type, const int nValue )
 {
-	unsigned int nIndex = ++__write_index;
-	nIndex = nIndex % MAX_EVENTS;
 	Event ev;
 	ev.type = type;
 	ev.value = nValue;
-//	INFOLOG( QString( "[pushEvent] %1 : %2 %3" ).arg( nIndex ).arg( ev.type ).arg( ev.value ) );
-	__events_buffer[ nIndex ] = ev;
+//	INFOLOG( QString( "[pushEvent] %1 %2" ).arg( type ).arg( nValue ) );
+	return __events.push( ev );
 }
 
 
 Event EventQueue::pop_event()
 {
-	if ( __read_index == __write_index ) {
-		Event ev;
+	Event ev;
+	if ( pop_events( &ev, 1 ) == 0 ) {
 		ev.type = EVENT_NONE;
 		ev.value = 0;
-		return ev;
 	}
-	unsigned int nIndex = ++__read_index;
-	nIndex = nIndex % MAX_EVENTS;
-//	INFOLOG( QString( "[popEvent] %1 : %2 %3" ).arg( nIndex ).arg( __events_buffer[ nIndex ].type ).arg( __events_buffer[ nIndex ].value ) );
-	return __events_buffer[ nIndex ];
+	return ev;
+}
+
+
+int EventQueue::pop_events( Event* pEvents, int nMax )
+{
+	int nEvents = 0;
+	const Event* pEvent;
+	while ( nEvents < nMax && ( pEvent = __events.front() ) != nullptr ) {
+		pEvents[ nEvents++ ] = *pEvent;
+//		INFOLOG( QString( "[popEvent] %1 %2" ).arg( pEvent->type ).arg( pEvent->value ) );
+		__events.pop();
+	}
+	return nEvents;
 }
 
 };
@@ -46,6 +46,7 @@
 #define PATTERN_FILTER  "*.h2pattern"
 #define PLAYLIST_FILTER "*.h2playlist"
 #define SONG_FILTER     "*.h2song"
+#define SONG_BIN_FILTER "*.h2songb"
 
 namespace H2Core
 {
@@ -55,10 +56,11 @@ const char* Filesystem::__class_name = "Filesystem";
 
 const QString Filesystem::scripts_ext = ".sh";
 const QString Filesystem::songs_ext = ".h2song";
+const QString Filesystem::songs_bin_ext = ".h2songb";
 const QString Filesystem::patterns_ext = ".h2pattern";
 const QString Filesystem::playlist_ext = ".h2playlist";
 const QString Filesystem::scripts_filter_name = "Hydrogen Scripts (*.sh)";
-const QString Filesystem::songs_filter_name = "Hydrogen Songs (*.h2song)";
+const QString Filesystem::songs_filter_name = "Hydrogen Songs (*.h2song *.h2songb)";
 const QString Filesystem::patterns_filter_name = "Hydrogen Patterns (*.h2pattern)";
 const QString Filesystem::playlists_filter_name = "Hydrogen Playlists (*.h2playlist)";
 
@@ -618,7 +620,7 @@ QStringList Filesystem::pattern_list( const QString& path)
 // SONGS
 QStringList Filesystem::song_list( )
 {
-	return QDir( songs_dir() ).entryList( QStringList( SONG_FILTER ), QDir::Files | QDir::Readable | QDir::NoDotAndDotDot );
+	return QDir( songs_dir() ).entryList( QStringList() << SONG_FILTER << SONG_BIN_FILTER, QDir::Files | QDir::Readable | QDir::NoDotAndDotDot );
 }
 
 QStringList Filesystem::song_list_cleared( )
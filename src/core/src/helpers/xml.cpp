@@ -1,9 +1,11 @@
 
 #include <hydrogen/helpers/xml.h>
+#include <hydrogen/LocalFileMng.h>
 
 #include <QtCore/QFile>
 #include <QtCore/QLocale>
 #include <QtCore/QString>
+#include <QtCore/QTextCodec>
 #include <QtCore/QTextStream>
 #include <QtXmlPatterns/QXmlSchema>
 #include <QtXmlPatterns/QXmlSchemaValidator>
@@ -253,4 +255,89 @@ XMLNode XMLDoc::set_root( const QString& node_name, const QString& xmlns )
 	return root;
 }
 
+const char* XMLStreamReader::__class_name ="XMLStreamReader";
+
+XMLStreamReader::XMLStreamReader( ) : Object( __class_name ) { }
+
+bool XMLStreamReader::open( const QString& filepath )
+{
+	__filepath = filepath;
+	__file.setFileName( filepath );
+	if ( !__file.open( QIODevice::ReadOnly ) ) {
+		ERRORLOG( QString( "Unable to open %1 for reading" ).arg( filepath ) );
+		return false;
+	}
+	if ( LocalFileMng::checkTinyXMLCompatMode( filepath ) ) {
+		QString enc = QTextCodec::codecForLocale()->name();
+		if( enc == QString("System") ) {
+			enc = "UTF-8";
+		}
+		QByteArray buf = QString("<?xml version='1.0' encoding='%1' ?>\n").arg( enc ).toLocal8Bit();
+		while( !__file.atEnd() ) {
+			QByteArray line = __file.readLine();
+			LocalFileMng::convertFromTinyXMLString( &line );
+			buf += line;
+		}
+		__file.close();
+		addData( buf );
+	} else {
+		setDevice( &__file );
+	}
+	return true;
+}
+
+QString XMLStreamReader::read_string( const QString& default_value )
+{
+	QString text = readElementText( QXmlStreamReader::SkipChildElements );
+	return text.isEmpty() ? default_value : text;
+}
+
+int XMLStreamReader::read_int( int default_value )
+{
+	QString text = readElementText( QXmlStreamReader::SkipChildElements );
+	return text.isEmpty() ? default_value : QLocale::c().toInt( text );
+}
+
+float XMLStreamReader::read_float( float default_value )
+{
+	QString text = readElementText( QXmlStreamReader::SkipChildElements );
+	return text.isEmpty() ? default_value : QLocale::c().toFloat( text );
+}
+
+bool XMLStreamReader::read_bool( bool default_value )
+{
+	QString text = readElementText( QXmlStreamReader::SkipChildElements );
+	return text.isEmpty() ? default_value : text == "true";
+}
+
+QDomElement XMLStreamReader::read_element( QDomDocument& doc )
+{
+	QDomElement element = doc.createElement( name().toString() );
+	for ( const QXmlStreamAttribute& attribute : attributes() ) {
+		element.setAttribute( attribute.qualifiedName().toString(), attribute.value().toString() );
+	}
+	while ( !atEnd() ) {
+		readNext();
+		if ( isStartElement() ) {
+			element.appendChild( read_element( doc ) );
+		} else if ( isCharacters() && !isWhitespace() ) {
+			// whitespace only text is dropped, as QDomDocument does
+			element.appendChild( doc.createTextNode( text().toString() ) );
+		} else if ( isEndElement() ) {
+			break;
+		}
+	}
+	return element;
+}
+
+bool XMLStreamReader::report_error()
+{
+	if ( !hasError() ) {
+		return false;
+	}
+	ERRORLOG( QString( "Unable to read XML document %1, line %2 column %3: %4" )
+			  .arg( __filepath ).arg( lineNumber() ).arg( columnNumber() ).arg( errorString() ) );
+	return true;
+}
+
 };
@@ -47,17 +47,27 @@
 #include <hydrogen/basics/drumkit_component.h>
 #include <hydrogen/h2_exception.h>
 #include <hydrogen/audio_engine.h>
+#include <hydrogen/dsp_profiler.h>
+#include <hydrogen/meters.h>
+#include <hydrogen/mpsc_ring.h>
+#include <hydrogen/realtime_note_queue.h>
 #include <hydrogen/basics/instrument.h>
 #include <hydrogen/basics/instrument_component.h>
 #include <hydrogen/basics/instrument_list.h>
 #include <hydrogen/basics/instrument_layer.h>
 #include <hydrogen/basics/playlist.h>
 #include <hydrogen/basics/sample.h>
+#include <hydrogen/basics/sample_cache.h>
+#include <hydrogen/basics/sample_disk_cache.h>
+#include <hydrogen/basics/sample_peak_cache.h>
+#include <hydrogen/basics/drumkit_index.h>
 #include <hydrogen/basics/automation_path.h>
 #include <hydrogen/hydrogen.h>
 #include <hydrogen/basics/pattern.h>
 #include <hydrogen/basics/pattern_list.h>
+#include <hydrogen/basics/song_snapshot.h>
 #include <hydrogen/basics/note.h>
+#include <hydrogen/basics/note_pool.h>
 #include <hydrogen/helpers/filesystem.h>
 #include <hydrogen/fx/LadspaFX.h>
 #include <hydrogen/fx/Effects.h>
@@ -96,8 +106,6 @@ namespace H2Core
 // GLOBALS
 
 // info
-float				m_fMasterPeak_L = 0.0f;		///< Master peak (left channel)
-float				m_fMasterPeak_R = 0.0f;		///< Master peak (right channel)
 float				m_fProcessTime = 0.0f;		///< time used in process function
 float				m_fMaxProcessTime = 0.0f;	///< max ms usable in process with no xrun
 //~ info
@@ -294,11 +302,6 @@ float *				m_pMainBuffer_R = nullptr;
  */	
 int				m_audioEngineState = STATE_UNINITIALIZED;	
 
-#if defined(H2CORE_HAVE_LADSPA) || _DOXYGEN_
-float				m_fFXPeak_L[MAX_FX];
-float				m_fFXPeak_R[MAX_FX];
-#endif
-
 /**
  * Beginning of the current pattern in ticks.
  *
@@ -327,6 +330,61 @@ int				m_nLookaheadFrames = 0;
     second loop.*/
 int				m_nSongSizeInTicks = 0;
 
+/**
+ * Notes of the current Song the audio thread plays during a cycle.
+ *
+ * Set at the beginning of audioEngine_process() with
+ * AudioEngine::acquire_song_snapshot(), so the notes are read without
+ * waiting for the threads editing them. In Song::SONG_MODE its
+ * SongEventTimeline is used instead of findPatternInTick() and
+ * instead of scanning every playing pattern at every tick.
+ */
+SongSnapshot*			m_pSongSnapshot = nullptr;
+
+/**
+ * Timings of the stages of audioEngine_process().
+ *
+ * Created in audioEngine_init(), destroyed in audioEngine_destroy(),
+ * written by audioEngine_process() only and read through
+ * Hydrogen::getDspProfiler().
+ */
+DspProfiler*			m_pDspProfiler = nullptr;
+
+/**
+ * Levels of the mixer strips.
+ *
+ * Created in audioEngine_init(), destroyed in audioEngine_destroy(),
+ * published by audioEngine_process() only and taken by the GUI
+ * through Hydrogen::getMeters().
+ */
+Meters*				m_pMeters = nullptr;
+
+/**
+ * Notes played live, by MIDI input or the keyboard.
+ *
+ * Created in audioEngine_init(), destroyed in audioEngine_destroy(),
+ * filled by Hydrogen::addRealtimeNote() and
+ * Hydrogen::addRealtimeNoteOff() and drained by
+ * audioEngine_process_realtimeNotes() only.
+ */
+RealtimeNoteQueue*		m_pRealtimeNoteQueue = nullptr;
+/** RealtimeNoteQueue::now() at the start of the previous process
+ * cycle, 0 before the first one. */
+uint64_t			m_nRealtimeWindowStart = 0;
+
+/** Length recorded for a note still playing when it was released. */
+struct RecordedNoteLength {
+	int instrument;		///< index within the instrument list of the song
+	int length;			///< in ticks
+	int note_on_tick;	///< position of the recorded note
+};
+/**
+ * Filled by audioEngine_process_realtimeNotes() and applied by
+ * Hydrogen::applyRecordedNoteLengths(), which takes the song lock the
+ * audio thread must not wait for.
+ */
+MpscRing<RecordedNoteLength, 64>	m_recordedNoteLengths;
+
 /** Updated in audioEngine_updateNoteQueue().*/
 struct timeval			m_currentTickTime;
 
@@ -380,7 +438,6 @@ void				audioEngine_destroy();
 /**
  * If the audio engine is in state #m_audioEngineState #STATE_READY,
  * this function will
- * - sets #m_fMasterPeak_L and #m_fMasterPeak_R to 0.0f
  * - sets TransportInfo::m_nFrames to @a nTotalFrames
  * - sets m_nSongPos and m_nPatternStartTick to -1
  * - m_nPatternTickPosition to 0
@@ -399,7 +456,6 @@ int				audioEngine_start( bool bLockEngine = false, unsigned nTotalFrames = 0 );
 /**
  * If the audio engine is in state #m_audioEngineState #STATE_PLAYING,
  * this function will
- * - sets #m_fMasterPeak_L and #m_fMasterPeak_R to 0.0f
  * - sets #m_audioEngineState to #STATE_READY
  * - sets #m_nPatternStartTick to -1
  * - deletes all copied Note in song notes queue #m_songNoteQueue and
@@ -469,8 +525,8 @@ static void			audioEngine_noteOn( Note *note );
  * EVENT_PATTERN_CHANGED event will be pushed to the EventQueue.
  * - writes the audio output of the Sampler, Synth, and the LadspaFX
  * (if #H2CORE_HAVE_LADSPA is defined) to #m_pMainBuffer_L and
- * #m_pMainBuffer_R and sets we peak values for #m_fFXPeak_L,
- * #m_fFXPeak_R, #m_fMasterPeak_L, and #m_fMasterPeak_R.
+ * #m_pMainBuffer_R and publishes the levels of all the strips to
+ * #m_pMeters.
  * - finally increments the transport position
  * TransportInfo::m_nFrames with the buffersize @a nframes. So, if
  * this function is called during the next cycle, the transport is
@@ -522,6 +578,22 @@ inline void			audioEngine_clearNoteQueue();
  */
 inline void			audioEngine_process_checkBPMChanged(Song *pSong);
 inline void			audioEngine_process_playNotes( unsigned long nframes );
+/**
+ * Moves the notes played live since the previous cycle from
+ * #m_pRealtimeNoteQueue into #m_songNoteQueue.
+ *
+ * An event played at \a nCycleStart or later belongs to the next
+ * cycle. The others start at the frame matching their time within
+ * the previous cycle, using the humanize delay of the note, so
+ * Sampler::note_on() delays them within this one. Note-offs are
+ * handed to the Sampler right away, or in the next cycle if a note
+ * queued before them is not playing yet.
+ *
+ * \param nframes Buffersize.
+ * \param nCycleStart RealtimeNoteQueue::now() at the start of
+ * audioEngine_process().
+ */
+inline void			audioEngine_process_realtimeNotes( unsigned long nframes, uint64_t nCycleStart );
 /**
  * Updating the TransportInfo of the audio driver.
  *
@@ -605,6 +677,27 @@ inline unsigned		audioEngine_renderNote( Note* pNote, const unsigned& nBufferSiz
 inline int			audioEngine_updateNoteQueue( unsigned nFrames );
 inline void			audioEngine_prepNoteQueue();
 
+/**
+ * Copy the notes of a pattern located at the current
+ * #m_nPatternTickPosition into #m_songNoteQueue.
+ *
+ * Swing, humanization and lead/lag are applied to the copies. If @a
+ * bErase is set, the notes are scheduled for deletion first
+ * (destructive recording).
+ *
+ * \param pSong Current Song.
+ * \param pNotes Notes of the pattern in #m_pSongSnapshot, may be
+ * nullptr for a pattern not published yet.
+ * \param nPattern Index of the pattern in #m_pPlayingPatterns.
+ * \param nTick Current tick.
+ * \param bErase Whether to schedule the notes for deletion.
+ * \param nLeadLagFactor Frames corresponding to a lead/lag of 1.
+ * \param nMaxTimeHumanize Frames corresponding to a humanization of 1.
+ */
+inline void			audioEngine_queuePatternNotes( Song* pSong, const SongSnapshot::PatternNotes* pNotes,
+												   int nPattern, int nTick, bool bErase,
+												   int nLeadLagFactor, int nMaxTimeHumanize );
+
 /**
  * Find a PatternList corresponding to the supplied tick position @a
  * nTick.
@@ -687,15 +780,6 @@ void				audioEngine_startAudioDrivers();
  */
 void				audioEngine_stopAudioDrivers();
 
-/** Gets the current time.
- * \return Current time obtained by gettimeofday()*/
-inline timeval currentTime2()
-{
-	struct timeval now;
-	gettimeofday( &now, nullptr );
-	return now;
-}
-
 inline int randomValue( int max )
 {
 	return rand() % max;
@@ -746,8 +830,16 @@ void audioEngine_init()
 		return;
 	}
 
+	NotePool::create_instance();
+	// The first records of the audio thread must not allocate. A
+	// JACK client has its process and its timebase thread.
+	Logger::get_instance()->reserve_rings( 2 );
 	m_pPlayingPatterns = new PatternList();
 	m_pNextPatterns = new PatternList();
+	m_pDspProfiler = new DspProfiler();
+	m_pMeters = new Meters();
+	m_pRealtimeNoteQueue = new RealtimeNoteQueue();
+	m_nRealtimeWindowStart = 0;
 	m_nSongPos = -1;
 	m_nSelectedPatternNumber = 0;
 	m_nSelectedInstrumentNumber = 0;
@@ -801,12 +893,12 @@ void audioEngine_destroy()
 	// delete all copied notes in the song notes queue
 	while ( !m_songNoteQueue.empty() ) {
 		m_songNoteQueue.top()->get_instrument()->dequeue();
-		delete m_songNoteQueue.top();
+		NotePool::get_instance()->release( m_songNoteQueue.top() );
 		m_songNoteQueue.pop();
 	}
 	// delete all copied notes in the midi notes queue
 	for ( unsigned i = 0; i < m_midiNoteQueue.size(); ++i ) {
-		delete m_midiNoteQueue[i];
+		NotePool::get_instance()->release( m_midiNoteQueue[i] );
 	}
 	m_midiNoteQueue.clear();
 
@@ -821,6 +913,15 @@ void audioEngine_destroy()
 	delete m_pNextPatterns;
 	m_pNextPatterns = nullptr;
 
+	delete m_pDspProfiler;
+	m_pDspProfiler = nullptr;
+
+	delete m_pMeters;
+	m_pMeters = nullptr;
+
+	delete m_pRealtimeNoteQueue;
+	m_pRealtimeNoteQueue = nullptr;
+
 	delete m_pMetronomeInstrument;
 	m_pMetronomeInstrument = nullptr;
 
@@ -844,8 +945,6 @@ int audioEngine_start( bool bLockEngine, unsigned nTotalFrames )
 		return 0;	// FIXME!!
 	}
 
-	m_fMasterPeak_L = 0.0f;
-	m_fMasterPeak_R = 0.0f;
 	// Reset the current transport position.
 	m_pAudioDriver->m_transport.m_nFrames = nTotalFrames;
 	m_nSongPos = -1;
@@ -885,21 +984,19 @@ void audioEngine_stop( bool bLockEngine )
 	m_audioEngineState = STATE_READY;
 	EventQueue::get_instance()->push_event( EVENT_STATE, STATE_READY );
 
-	m_fMasterPeak_L = 0.0f;
-	m_fMasterPeak_R = 0.0f;
 	//	m_nPatternTickPosition = 0;
 	m_nPatternStartTick = -1;
 
 	// delete all copied notes in the song notes queue
 	while(!m_songNoteQueue.empty()){
 		m_songNoteQueue.top()->get_instrument()->dequeue();
-		delete m_songNoteQueue.top();
+		NotePool::get_instance()->release( m_songNoteQueue.top() );
 		m_songNoteQueue.pop();
 	}
 
 	// delete all copied notes in the midi notes queue
 	for ( unsigned i = 0; i < m_midiNoteQueue.size(); ++i ) {
-		delete m_midiNoteQueue[i];
+		NotePool::get_instance()->release( m_midiNoteQueue[i] );
 	}
 	m_midiNoteQueue.clear();
 
@@ -1026,16 +1123,16 @@ inline void audioEngine_process_playNotes( unsigned long nframes )
 					  */
 			Instrument * noteInstrument = pNote->get_instrument();
 			if ( noteInstrument->is_stop_notes() ){
-				Note *pOffNote = new Note( noteInstrument,
-										   0.0,
-										   0.0,
-										   0.0,
-										   0.0,
-										   -1,
-										   0 );
+				Note *pOffNote = NotePool::get_instance()->acquire( noteInstrument,
+																   0.0,
+																   0.0,
+																   0.0,
+																   0.0,
+																   -1,
+																   0 );
 				pOffNote->set_note_off( true );
 				AudioEngine::get_instance()->get_sampler()->note_on( pOffNote );
-				delete pOffNote;
+				NotePool::get_instance()->release( pOffNote );
 			}
 
 			AudioEngine::get_instance()->get_sampler()->note_on( pNote );
@@ -1044,7 +1141,7 @@ inline void audioEngine_process_playNotes( unsigned long nframes )
 			// raise noteOn event
 			int nInstrument = pSong->get_instrument_list()->index( pNote->get_instrument() );
 			if( pNote->get_note_off() ){
-				delete pNote;
+				NotePool::get_instance()->release( pNote );
 			}
 
 			EventQueue::get_instance()->push_event( EVENT_NOTEON, nInstrument );
@@ -1056,6 +1153,93 @@ inline void audioEngine_process_playNotes( unsigned long nframes )
 	}
 }
 
+inline void audioEngine_process_realtimeNotes( unsigned long nframes, uint64_t nCycleStart )
+{
+	Hydrogen* pHydrogen = Hydrogen::get_instance();
+	Song* pSong = pHydrogen->getSong();
+	Sampler* pSampler = AudioEngine::get_instance()->get_sampler();
+
+	unsigned long framepos;
+	if (  m_audioEngineState == STATE_PLAYING ) {
+		framepos = m_pAudioDriver->m_transport.m_nFrames;
+	} else {
+		// use this to support realtime events when not playing
+		framepos = pHydrogen->getRealtimeFrames();
+	}
+	float fTickSize = m_pAudioDriver->m_transport.m_nTickSize;
+
+	// the first cycle has no previous one to map the events into
+	uint64_t nWindowStart = m_nRealtimeWindowStart != 0 ? m_nRealtimeWindowStart : nCycleStart;
+	m_nRealtimeWindowStart = nCycleStart;
+
+	bool bNoteOn = false;
+	const RealtimeNoteQueue::Event* pEvent;
+	while ( ( pEvent = m_pRealtimeNoteQueue->front() ) != nullptr ) {
+		if ( pEvent->time >= nCycleStart ) {
+			break;
+		}
+		if ( pEvent->type != RealtimeNoteQueue::Event::NOTE_ON && bNoteOn ) {
+			// must not release the notes queued before it
+			break;
+		}
+
+		Instrument* pInstr = nullptr;
+		if ( pSong != nullptr && pEvent->instrument >= 0
+			 && pEvent->instrument < pSong->get_instrument_list()->size() ) {
+			pInstr = pSong->get_instrument_list()->get( pEvent->instrument );
+		}
+
+		// the recorded note gets the length it was held for, as long
+		// as it still plays. Changing the pattern is left to the
+		// thread handling the events.
+		if ( pEvent->type != RealtimeNoteQueue::Event::NOTE_ON && pEvent->length != -1
+			 && pInstr != nullptr && pSampler->is_instrument_playing( pInstr ) ) {
+			RecordedNoteLength length;
+			length.instrument = pEvent->instrument;
+			length.length = pEvent->length;
+			length.note_on_tick = pEvent->note_on_tick;
+			// dropped and counted if full
+			m_recordedNoteLengths.push( length );
+		}
+
+		switch ( pEvent->type ) {
+		case RealtimeNoteQueue::Event::NOTE_ON:
+			if ( pInstr != nullptr ) {
+				unsigned long nFrame = framepos + RealtimeNoteQueue::frame_offset(
+					pEvent->time, nWindowStart, m_pAudioDriver->getSampleRate(), nframes );
+				int nTick = ( int )( nFrame / fTickSize );
+				Note* pNote = NotePool::get_instance()->acquire( pInstr, nTick, pEvent->velocity,
+																 pEvent->pan_L, pEvent->pan_R, -1, 0 );
+				// the frames between the tick and the event
+				pNote->set_humanize_delay( ( int )nFrame - ( int )( nTick * fTickSize ) );
+				if ( pEvent->key != -1 ) {
+					int divider = pEvent->key / 12;
+					pNote->set_midi_info( ( Note::Key )( pEvent->key - ( 12 * divider ) ),
+										  ( Note::Octave )( divider - 3 ), pEvent->key );
+				}
+				pInstr->enqueue();
+				m_songNoteQueue.push( pNote );
+				bNoteOn = true;
+			}
+			break;
+
+		case RealtimeNoteQueue::Event::NOTE_OFF:
+			if ( pInstr != nullptr && pSampler->is_instrument_playing( pInstr ) ) {
+				Note *pOffNote = NotePool::get_instance()->acquire( pInstr, 0, 0.0, 0.0, 0.0, -1, 0 );
+				pOffNote->set_note_off( true );
+				pSampler->note_on( pOffNote );
+				NotePool::get_instance()->release( pOffNote );
+			}
+			break;
+
+		case RealtimeNoteQueue::Event::KEY_OFF:
+			pSampler->midi_keyboard_note_off( pEvent->key );
+			break;
+		}
+		m_pRealtimeNoteQueue->pop();
+	}
+}
+
 
 void audioEngine_seek( long long nFrames, bool bLoopMode )
 {
@@ -1164,7 +1348,7 @@ void audioEngine_clearNoteQueue()
 	// delete all copied notes in the song notes queue
 	while (!m_songNoteQueue.empty()) {
 		m_songNoteQueue.top()->get_instrument()->dequeue();
-		delete m_songNoteQueue.top();
+		NotePool::get_instance()->release( m_songNoteQueue.top() );
 		m_songNoteQueue.pop();
 	}
 
@@ -1172,7 +1356,7 @@ void audioEngine_clearNoteQueue()
 
 	// delete all copied notes in the midi notes queue
 	for ( unsigned i = 0; i < m_midiNoteQueue.size(); ++i ) {
-		delete m_midiNoteQueue[i];
+		NotePool::get_instance()->release( m_midiNoteQueue[i] );
 	}
 	m_midiNoteQueue.clear();
 
@@ -1263,7 +1447,7 @@ int audioEngine_process( uint32_t nframes, void* /*arg*/ )
 	// 	    .arg( m_pAudioDriver->m_transport.m_nFrames )
 	// 	    .arg( m_pAudioDriver->m_transport.m_nTickSize )
 	// 	    .arg( m_pAudioDriver->m_transport.m_nBPM ) );
-	timeval startTimeval = currentTime2();
+	uint64_t nStartTime = DspProfiler::now();
 
 	// Resetting all audio output buffers with zeros.
 	audioEngine_process_clearAudioBuffers( nframes );
@@ -1273,21 +1457,27 @@ int audioEngine_process( uint32_t nframes, void* /*arg*/ )
 	 * alsa driver shutdown). The try_lock *should* only fail in rare circumstances
 	 * (like shutting down drivers). In such cases, it seems to be ok to interrupt
 	 * audio processing.
+	 *
+	 * The DiskWriterDriver is not bound to a realtime deadline and
+	 * writes whatever ends up in the buffers. Skipping a cycle would
+	 * leave a gap of silence in the exported file, so it waits for
+	 * the lock instead.
 	 */
-	if(!AudioEngine::get_instance()->try_lock( RIGHT_HERE )){
+	if ( Hydrogen::get_instance()->getIsExportSessionActive() ) {
+		AudioEngine::get_instance()->lock( RIGHT_HERE );
+	} else if ( !AudioEngine::get_instance()->try_lock( RIGHT_HERE ) ) {
 		return 0;
 	}
 
+	m_pSongSnapshot = AudioEngine::get_instance()->acquire_song_snapshot();
+
 	if ( m_audioEngineState < STATE_READY) {
 		AudioEngine::get_instance()->unlock();
 		return 0;
 	}
 
 	if ( m_nBufferSize != nframes ) {
-		___INFOLOG(
-			   QString( "Buffer size changed. Old size = %1, new size = %2" )
-			   .arg( m_nBufferSize )
-			   .arg( nframes ) );
+		___INFOLOG_FMT( "Buffer size changed. Old size = %1, new size = %2", m_nBufferSize, nframes );
 		m_nBufferSize = nframes;
 	}
 
@@ -1301,8 +1491,11 @@ int audioEngine_process( uint32_t nframes, void* /*arg*/ )
 	// the one used by the JACK server, and adjust the current
 	// transport position if it was changed by an user interaction
 	// (e.g. clicking on the timeline).
+	uint64_t nStageStart = DspProfiler::now();
 	audioEngine_process_transport();
-	
+	uint64_t nStageEnd = DspProfiler::now();
+	m_pDspProfiler->record( DspProfiler::TRANSPORT, nStageStart, nStageEnd );
+
 
 	// ___INFOLOG( QString( "[after process] status: %1, frame: %2, ticksize: %3, bpm: %4" )
 	// 	    .arg( m_pAudioDriver->m_transport.m_status )
@@ -1315,9 +1508,12 @@ int audioEngine_process( uint32_t nframes, void* /*arg*/ )
 	bool sendPatternChange = false;
 	// always update note queue.. could come from pattern or realtime input
 	// (midi, keyboard)
+	nStageStart = DspProfiler::now();
 	int res2 = audioEngine_updateNoteQueue( nframes );
+	nStageEnd = DspProfiler::now();
+	m_pDspProfiler->record( DspProfiler::NOTE_QUEUE, nStageStart, nStageEnd );
 	if ( res2 == -1 ) {	// end of song
-		___INFOLOG( "End of song received, calling engine_stop()" );
+		___INFOLOG_FMT( "End of song received, calling engine_stop()" );
 		AudioEngine::get_instance()->unlock();
 		m_pAudioDriver->stop();
 		m_pAudioDriver->locate( 0 ); // locate 0, reposition from start of the song
@@ -1325,7 +1521,7 @@ int audioEngine_process( uint32_t nframes, void* /*arg*/ )
 		if ( ( m_pAudioDriver->class_name() == DiskWriterDriver::class_name() )
 			 || ( m_pAudioDriver->class_name() == FakeDriver::class_name() )
 			 ) {
-			___INFOLOG( "End of song." );
+			___INFOLOG_FMT( "End of song." );
 			
 			return 1;	// kill the audio AudioDriver thread
 		}
@@ -1344,18 +1540,30 @@ int audioEngine_process( uint32_t nframes, void* /*arg*/ )
 	}
 
 	// play all notes
+	nStageStart = nStageEnd;
+	// DspProfiler::now() reads the clock of RealtimeNoteQueue::now()
+	audioEngine_process_realtimeNotes( nframes, nStartTime );
 	audioEngine_process_playNotes( nframes );
+	nStageEnd = DspProfiler::now();
+	m_pDspProfiler->record( DspProfiler::PLAY_NOTES, nStageStart, nStageEnd );
 
 	// SAMPLER
-	AudioEngine::get_instance()->get_sampler()->process( nframes, pSong );
-	float* out_L = AudioEngine::get_instance()->get_sampler()->__main_out_L;
-	float* out_R = AudioEngine::get_instance()->get_sampler()->__main_out_R;
+	Sampler* pSampler = AudioEngine::get_instance()->get_sampler();
+	int nVoices = pSampler->get_playing_notes_number();
+	nStageStart = nStageEnd;
+	pSampler->process( nframes, pSong );
+	float* out_L = pSampler->__main_out_L;
+	float* out_R = pSampler->__main_out_R;
 	for ( unsigned i = 0; i < nframes; ++i ) {
 		m_pMainBuffer_L[ i ] += out_L[ i ];
 		m_pMainBuffer_R[ i ] += out_R[ i ];
 	}
+	nStageEnd = DspProfiler::now();
+	m_pDspProfiler->record( DspProfiler::SAMPLER, nStageStart, nStageEnd );
+	m_pDspProfiler->record_voices( nVoices, nStageStart, nStageEnd );
 
 	// SYNTH
+	nStageStart = nStageEnd;
 	AudioEngine::get_instance()->get_synth()->process( nframes );
 	out_L = AudioEngine::get_instance()->get_synth()->m_pOut_L;
 	out_R = AudioEngine::get_instance()->get_synth()->m_pOut_R;
@@ -1363,9 +1571,10 @@ int audioEngine_process( uint32_t nframes, void* /*arg*/ )
 		m_pMainBuffer_L[ i ] += out_L[ i ];
 		m_pMainBuffer_R[ i ] += out_R[ i ];
 	}
+	nStageEnd = DspProfiler::now();
+	m_pDspProfiler->record( DspProfiler::SYNTH, nStageStart, nStageEnd );
 
-	timeval renderTime_end = currentTime2();
-	timeval ladspaTime_start = renderTime_end;
+	uint64_t nLadspaStart = nStageEnd;
 
 #ifdef H2CORE_HAVE_LADSPA
 	// Process LADSPA FX
@@ -1373,6 +1582,7 @@ int audioEngine_process( uint32_t nframes, void* /*arg*/ )
 		for ( unsigned nFX = 0; nFX < MAX_FX; ++nFX ) {
 			LadspaFX *pFX = Effects::get_instance()->getLadspaFX( nFX );
 			if ( ( pFX ) && ( pFX->isEnabled() ) ) {
+				nStageStart = DspProfiler::now();
 				pFX->processFX( nframes );
 
 				float *buf_L, *buf_R;
@@ -1387,68 +1597,82 @@ int audioEngine_process( uint32_t nframes, void* /*arg*/ )
 				for ( unsigned i = 0; i < nframes; ++i ) {
 					m_pMainBuffer_L[ i ] += buf_L[ i ];
 					m_pMainBuffer_R[ i ] += buf_R[ i ];
-					if ( buf_L[ i ] > m_fFXPeak_L[nFX] )
-						m_fFXPeak_L[nFX] = buf_L[ i ];
-
-					if ( buf_R[ i ] > m_fFXPeak_R[nFX] )
-						m_fFXPeak_R[nFX] = buf_R[ i ];
 				}
+				m_pMeters->add_buffer( Meters::FX + nFX, buf_L, buf_R, nframes );
+				m_pDspProfiler->record( DspProfiler::LADSPA_SLOT + nFX, nStageStart, DspProfiler::now() );
 			}
 		}
 	}
 #endif
-	timeval ladspaTime_end = currentTime2();
+	nStageEnd = DspProfiler::now();
+	m_pDspProfiler->record( DspProfiler::LADSPA, nLadspaStart, nStageEnd );
 
-	// update master peaks
-	float val_L, val_R;
+	// publish the levels of all the strips
+	nStageStart = nStageEnd;
 	if ( m_audioEngineState >= STATE_READY ) {
-		for ( unsigned i = 0; i < nframes; ++i ) {
-			val_L = m_pMainBuffer_L[i];
-			val_R = m_pMainBuffer_R[i];
+		m_pMeters->add_buffer( Meters::MASTER, m_pMainBuffer_L, m_pMainBuffer_R, nframes );
 
-			if ( val_L > m_fMasterPeak_L )
-				m_fMasterPeak_L = val_L;
-
-			if ( val_R > m_fMasterPeak_R )
-				m_fMasterPeak_R = val_R;
-
-			for (std::vector<DrumkitComponent*>::iterator it = pSong->get_components()->begin() ; it != pSong->get_components()->end(); ++it) {
-				DrumkitComponent* drumkit_component = *it;
-
-				float compo_val_L = drumkit_component->get_out_L(i);
-				float compo_val_R = drumkit_component->get_out_R(i);
+		std::vector<DrumkitComponent*>* pComponents = pSong->get_components();
+		for ( int nCompo = 0; nCompo < ( int )pComponents->size() && nCompo < MAX_COMPONENTS; ++nCompo ) {
+			DrumkitComponent* pCompo = ( *pComponents )[ nCompo ];
+			m_pMeters->add_buffer( Meters::COMPONENT + nCompo, pCompo->get_out_L_buffer(),
+								   pCompo->get_out_R_buffer(), nframes );
+		}
 
-				if( compo_val_L > drumkit_component->get_peak_l() )
-					drumkit_component->set_peak_l( compo_val_L );
-				if( compo_val_R > drumkit_component->get_peak_r() )
-					drumkit_component->set_peak_r( compo_val_R );
-			}
+		// the instrument levels were summed up by the Sampler
+		InstrumentList* pInstruments = pSong->get_instrument_list();
+		int nInstruments = std::min( pInstruments->size(), MAX_INSTRUMENTS );
+		for ( int nInstr = 0; nInstr < nInstruments; ++nInstr ) {
+			Instrument* pInstr = pInstruments->get( nInstr );
+			m_pMeters->add_levels( Meters::INSTRUMENT + nInstr, pInstr->get_peak_l(), pInstr->get_peak_r(),
+								   pInstr->get_energy_l(), pInstr->get_energy_r() );
+			pInstr->set_peak_l( 0.0f );
+			pInstr->set_peak_r( 0.0f );
+			pInstr->set_energy_l( 0.0f );
+			pInstr->set_energy_r( 0.0f );
 		}
+		Instrument* pPlayback = pSampler->__playback_instrument;
+		m_pMeters->add_levels( Meters::PLAYBACK_TRACK, pPlayback->get_peak_l(), pPlayback->get_peak_r(),
+							   pPlayback->get_energy_l(), pPlayback->get_energy_r() );
+		pPlayback->set_peak_l( 0.0f );
+		pPlayback->set_peak_r( 0.0f );
+		pPlayback->set_energy_l( 0.0f );
+		pPlayback->set_energy_r( 0.0f );
+
+		m_pMeters->publish( nframes, m_pAudioDriver->getSampleRate(), pComponents->size(), nInstruments );
 	}
 
+	nStageEnd = DspProfiler::now();
+	m_pDspProfiler->record( DspProfiler::METERING, nStageStart, nStageEnd );
+
 	// update total frames number
 	if ( m_audioEngineState == STATE_PLAYING ) {
 		m_pAudioDriver->m_transport.m_nFrames += nframes;
 	}
 
-	timeval finishTimeval = currentTime2();
-	m_fProcessTime =
-			( finishTimeval.tv_sec - startTimeval.tv_sec ) * 1000.0
-			+ ( finishTimeval.tv_usec - startTimeval.tv_usec ) / 1000.0;
+	m_pDspProfiler->record( DspProfiler::TOTAL, nStartTime, nStageEnd );
+	m_fProcessTime = m_pDspProfiler->get_last( DspProfiler::TOTAL );
 
 	float sampleRate = ( float )m_pAudioDriver->getSampleRate();
 	m_fMaxProcessTime = 1000.0 / ( sampleRate / nframes );
 
 #ifdef CONFIG_DEBUG
 	if ( m_fProcessTime > m_fMaxProcessTime ) {
-		___WARNINGLOG( "" );
-		___WARNINGLOG( "----XRUN----" );
-		___WARNINGLOG( QString( "XRUN of %1 msec (%2 > %3)" )
-					   .arg( ( m_fProcessTime - m_fMaxProcessTime ) )
-					   .arg( m_fProcessTime ).arg( m_fMaxProcessTime ) );
-		___WARNINGLOG( QString( "Ladspa process time = %1" ).arg( fLadspaTime ) );
-		___WARNINGLOG( "------------" );
-		___WARNINGLOG( "" );
+		___WARNINGLOG_FMT( "----XRUN----" );
+		___WARNINGLOG_FMT( "XRUN of %1 msec (%2 > %3)",
+						   m_fProcessTime - m_fMaxProcessTime,
+						   m_fProcessTime, m_fMaxProcessTime );
+		___WARNINGLOG_FMT( "Transport = %1, note queue = %2, play notes = %3 msec",
+						   m_pDspProfiler->get_last( DspProfiler::TRANSPORT ),
+						   m_pDspProfiler->get_last( DspProfiler::NOTE_QUEUE ),
+						   m_pDspProfiler->get_last( DspProfiler::PLAY_NOTES ) );
+		___WARNINGLOG_FMT( "Sampler = %1 msec (%2 voices), synth = %3 msec",
+						   m_pDspProfiler->get_last( DspProfiler::SAMPLER ), nVoices,
+						   m_pDspProfiler->get_last( DspProfiler::SYNTH ) );
+		___WARNINGLOG_FMT( "Ladspa process time = %1 msec, metering = %2 msec",
+						   m_pDspProfiler->get_last( DspProfiler::LADSPA ),
+						   m_pDspProfiler->get_last( DspProfiler::METERING ) );
+		___WARNINGLOG_FMT( "------------" );
 		// raise xRun event
 		EventQueue::get_instance()->push_event( EVENT_XRUN, -1 );
 	}
@@ -1541,6 +1765,9 @@ void audioEngine_setSong( Song* pNewSong )
 		m_pPlayingPatterns->add( pNewSong->get_pattern_list()->get( 0 ) );
 	}
 
+	// the notes of the song get published on unlock()
+	AudioEngine::get_instance()->set_song( pNewSong );
+
 	audioEngine_renameJackPorts( pNewSong );
 
 	m_pAudioDriver->setBpm( pNewSong->__bpm );
@@ -1559,6 +1786,8 @@ void audioEngine_removeSong()
 {
 	AudioEngine::get_instance()->lock( RIGHT_HERE );
 
+	AudioEngine::get_instance()->set_song( nullptr );
+
 	if ( m_audioEngineState == STATE_PLAYING ) {
 		m_pAudioDriver->stop();
 		audioEngine_stop( false );
@@ -1582,6 +1811,106 @@ void audioEngine_removeSong()
 	EventQueue::get_instance()->push_event( EVENT_STATE, STATE_PREPARED );
 }
 
+inline void audioEngine_queuePatternNotes( Song* pSong, const SongSnapshot::PatternNotes* pNotes,
+										   int nPattern, int nTick, bool bErase,
+										   int nLeadLagFactor, int nMaxTimeHumanize )
+{
+	if ( pNotes == nullptr ) {
+		// not published yet
+		return;
+	}
+	int nFirst, nLast;
+	pNotes->get_range( m_nPatternTickPosition, &nFirst, &nLast );
+	// Delete notes before attempting to play them
+	if ( bErase ) {
+		for ( int nNote = nFirst; nNote < nLast; ++nNote ) {
+			Note* pNote = pNotes->get_note( nNote );
+			assert( pNote != nullptr );
+			if ( pNotes->is_just_recorded( nNote ) == false ) {
+				EventQueue::AddMidiNoteVector noteAction;
+				noteAction.m_column = pNote->get_position();
+				noteAction.m_row = pNote->get_instrument_id();
+				noteAction.m_pattern = nPattern;
+				noteAction.f_velocity = pNote->get_velocity();
+				noteAction.f_pan_L = pNote->get_pan_l();
+				noteAction.f_pan_R = pNote->get_pan_r();
+				noteAction.m_length = -1;
+				noteAction.no_octaveKeyVal = pNote->get_octave();
+				noteAction.nk_noteKeyVal = pNote->get_key();
+				noteAction.b_isInstrumentMode = false;
+				noteAction.b_isMidi = false;
+				noteAction.b_noteExist = false;
+				EventQueue::get_instance()->m_addMidiNoteVector.push_back(noteAction);
+			}
+		}
+	}
+
+	// Perform a loop over all notes, which are enclose
+	// the position of the current tick (notes won't be
+	// altered!). After some humanization was applied to onset
+	// of each note, it will be added to `m_songNoteQueue` for
+	// playback.
+	for ( int nNote = nFirst; nNote < nLast; ++nNote ) {
+		Note *pNote = pNotes->get_note( nNote );
+		if ( pNote ) {
+			pNotes->set_played( nNote );
+			int nOffset = 0;
+
+			// Swing //
+			// Add a constant and periodic offset at
+			// predefined positions to the note position.
+			// TODO: incorporate the factor of 6.0 either
+			// in Song::__swing_factor or make it a member
+			// variable.
+			float fSwingFactor = pSong->get_swing_factor();
+			if ( ( ( m_nPatternTickPosition % 12 ) == 0 )
+				 && ( ( m_nPatternTickPosition % 24 ) != 0 ) ) {
+				nOffset += ( int )(
+							6.0
+							* m_pAudioDriver->m_transport.m_nTickSize
+							* fSwingFactor
+							);
+			}
+
+			// Humanize - Time parameter //
+			// Add a random offset to each note. Due to
+			// the nature of the Gaussian distribution,
+			// the factor Song::__humanize_time_value will
+			// also scale the variance of the generated
+			// random variable.
+			if ( pSong->get_humanize_time_value() != 0 ) {
+				nOffset += ( int )(
+							getGaussian( 0.3 )
+							* pSong->get_humanize_time_value()
+							* nMaxTimeHumanize
+							);
+			}
+
+			// Lead or Lag - timing parameter //
+			// Add a constant offset to all notes.
+			nOffset += (int) ( pNote->get_lead_lag()
+							   * nLeadLagFactor);
+
+			// No note is allowed to start prior to the
+			// beginning of the song.
+			if((nTick == 0) && (nOffset < 0)) {
+				nOffset = 0;
+			}
+			
+			// Generate a copy of the current note, assign
+			// it the new offset, and push it to the list
+			// of all notes, which are about to be played
+			// back.
+			// TODO: Why a copy?
+			Note *pCopiedNote = NotePool::get_instance()->acquire( pNote );
+			pCopiedNote->set_position( nTick );
+			pCopiedNote->set_humanize_delay( nOffset );
+			pNote->get_instrument()->enqueue();
+			m_songNoteQueue.push( pCopiedNote );
+		}
+	}
+}
+
 inline int audioEngine_updateNoteQueue( unsigned nFrames )
 {
 	Hydrogen* pHydrogen = Hydrogen::get_instance();
@@ -1633,6 +1962,8 @@ inline int audioEngine_updateNoteQueue( unsigned nFrames )
 	// Get initial timestamp for first tick
 	gettimeofday( &m_currentTickTime, nullptr );
 
+	SongEventTimeline* pTimeline = m_pSongSnapshot->get_timeline();
+
 	// A tick is the most fine-grained time scale within Hydrogen.
 	for ( int tick = tickNumber_start; tick < tickNumber_end; tick++ ) {
 		
@@ -1662,7 +1993,7 @@ inline int audioEngine_updateNoteQueue( unsigned nFrames )
 		//////////////////////////////////////////////////////////////
 		// SONG MODE
 		if ( pSong->get_mode() == Song::SONG_MODE ) {
-			if ( pSong->get_pattern_group_vector()->size() == 0 ) {
+			if ( pTimeline->size() == 0 ) {
 				// there's no song!!
 				___ERRORLOG( "no patterns in song." );
 				m_pAudioDriver->stop();
@@ -1671,14 +2002,17 @@ inline int audioEngine_updateNoteQueue( unsigned nFrames )
 
 			// Return the pattern list number based on the current
 			// tick and writes the starting position of the current
-			// pattern into `m_nPatternStartTick`.
-			m_nSongPos = findPatternInTick( tick, pSong->is_loop_enabled(), &m_nPatternStartTick );
-
+			// pattern into `m_nPatternStartTick`. The compiled
+			// timeline answers this from the column found during
+			// the previous tick in most cases.
+			//
 			// The `m_nSongSizeInTicks` variable is only set to some
-			// value other than zero in `findPatternInTick()` if
-			// either the pattern list was not found of loop mode was
-			// enabled and will contain the total size of the song in
-			// ticks.
+			// value other than zero if loop mode was enabled and
+			// `tick` lies beyond the end of the song. It will then
+			// contain the total size of the song in ticks.
+			m_nSongPos = pTimeline->find_column( tick, pSong->is_loop_enabled(),
+												 &m_nPatternStartTick, &m_nSongSizeInTicks );
+
 			if ( m_nSongSizeInTicks != 0 ) {
 				// When using the JACK audio driver the overall
 				// transport position will be managed by an external
@@ -1698,41 +2032,33 @@ inline int audioEngine_updateNoteQueue( unsigned nFrames )
 				bSendPatternChange = true;
 			}
 
-			// If no pattern list could not be found, either choose
-			// the first one if loop mode is activate or the
-			// function returns indicating that the end of the song is
-			// reached.
+			// If no pattern list could be found the end of the song
+			// is reached (in loop mode every tick maps to a pattern
+			// list).
 			if ( m_nSongPos == -1 ) {
 				___INFOLOG( "song pos = -1" );
-				if ( pSong->is_loop_enabled() == true ) {
-					// TODO: This function call should be redundant
-					// since `findPatternInTick()` is deterministic
-					// and was already invoked with
-					// `pSong->is_loop_enabled()` as second argument.
-					m_nSongPos = findPatternInTick( 0, true, &m_nPatternStartTick );
-				} else {
-
-					___INFOLOG( "End of Song" );
-
-					if( Hydrogen::get_instance()->getMidiOutput() != nullptr ){
-						Hydrogen::get_instance()->getMidiOutput()->handleQueueAllNoteOff();
-					}
+				___INFOLOG( "End of Song" );
 
-					return -1;
+				if( Hydrogen::get_instance()->getMidiOutput() != nullptr ){
+					Hydrogen::get_instance()->getMidiOutput()->handleQueueAllNoteOff();
 				}
+
+				return -1;
 			}
 			
-			// Obtain the current PatternList and use it to overwrite
-			// the on in `m_pPlayingPatterns.
-			// TODO: Why overwriting it for each and every tick
-			//       without check if it did changed? This is highly
-			//       inefficient.
-			PatternList *pPatternList = ( *( pSong->get_pattern_group_vector() ) )[m_nSongPos];
-			m_pPlayingPatterns->clear();
-			for ( int i=0; i< pPatternList->size(); ++i ) {
-				Pattern* pPattern = pPatternList->get(i);
-				m_pPlayingPatterns->add( pPattern );
-				pPattern->extand_with_flattened_virtual_patterns( m_pPlayingPatterns );
+			// Make `m_pPlayingPatterns` hold the patterns of the
+			// current column. It is only rewritten when the column
+			// changed or got edited.
+			const SongEventTimeline::Column* pColumn = pTimeline->get_column( m_nSongPos );
+			bool bSamePatterns = ( m_pPlayingPatterns->size() == ( int )pColumn->patterns.size() );
+			for ( int i = 0; bSamePatterns && i < m_pPlayingPatterns->size(); ++i ) {
+				bSamePatterns = ( m_pPlayingPatterns->get( i ) == pColumn->patterns[ i ] );
+			}
+			if ( ! bSamePatterns ) {
+				m_pPlayingPatterns->clear();
+				for ( int i = 0; i < ( int )pColumn->patterns.size(); ++i ) {
+					m_pPlayingPatterns->add( pColumn->patterns[ i ] );
+				}
 			}
 			// Set destructive record depending on punch area
 			doErase = doErase && Preferences::get_instance()->inPunchArea(m_nSongPos);
@@ -1830,14 +2156,14 @@ inline int audioEngine_updateNoteQueue( unsigned nFrames )
 				m_pMetronomeInstrument->set_volume(
 							Preferences::get_instance()->m_fMetronomeVolume
 							);
-				Note *pMetronomeNote = new Note( m_pMetronomeInstrument,
-												 tick,
-												 fVelocity,
-												 0.5,
-												 0.5,
-												 -1,
-												 fPitch
-												 );
+				Note *pMetronomeNote = NotePool::get_instance()->acquire( m_pMetronomeInstrument,
+																		  tick,
+																		  fVelocity,
+																		  0.5,
+																		  0.5,
+																		  -1,
+																		  fPitch
+																		  );
 				m_pMetronomeInstrument->enqueue();
 				m_songNoteQueue.push( pMetronomeNote );
 			}
@@ -1846,101 +2172,26 @@ inline int audioEngine_updateNoteQueue( unsigned nFrames )
 		//////////////////////////////////////////////////////////////
 		// Update the notes queue.
 		// 
-		if ( m_pPlayingPatterns->size() != 0 ) {
+		if ( pSong->get_mode() == Song::SONG_MODE ) {
+			// Only visit the patterns of the current column which
+			// hold notes at this tick.
+			const SongEventTimeline::Column* pColumn = pTimeline->get_column( m_nSongPos );
+			int nFirstEvent, nLastEvent;
+			pTimeline->get_events( m_nSongPos, m_nPatternTickPosition,
+								   &nFirstEvent, &nLastEvent );
+			for ( int nEvent = nFirstEvent; nEvent < nLastEvent; ++nEvent ) {
+				int nPat = pColumn->events[ nEvent ].pattern;
+				audioEngine_queuePatternNotes( pSong, m_pSongSnapshot->get_notes( pColumn->patterns[ nPat ] ),
+											   nPat, tick, doErase, nLeadLagFactor, nMaxTimeHumanize );
+			}
+		} else if ( m_pPlayingPatterns->size() != 0 ) {
 			for ( unsigned nPat = 0 ;
 				  nPat < m_pPlayingPatterns->size() ;
 				  ++nPat ) {
 				Pattern *pPattern = m_pPlayingPatterns->get( nPat );
 				assert( pPattern != nullptr );
-				Pattern::notes_t* notes = (Pattern::notes_t*)pPattern->get_notes();
-				// Delete notes before attempting to play them
-				if ( doErase ) {
-					FOREACH_NOTE_IT_BOUND(notes,it,m_nPatternTickPosition) {
-						Note* pNote = it->second;
-						assert( pNote != nullptr );
-						if ( pNote->get_just_recorded() == false ) {
-							EventQueue::AddMidiNoteVector noteAction;
-							noteAction.m_column = pNote->get_position();
-							noteAction.m_row = pNote->get_instrument_id();
-							noteAction.m_pattern = nPat;
-							noteAction.f_velocity = pNote->get_velocity();
-							noteAction.f_pan_L = pNote->get_pan_l();
-							noteAction.f_pan_R = pNote->get_pan_r();
-							noteAction.m_length = -1;
-							noteAction.no_octaveKeyVal = pNote->get_octave();
-							noteAction.nk_noteKeyVal = pNote->get_key();
-							noteAction.b_isInstrumentMode = false;
-							noteAction.b_isMidi = false;
-							noteAction.b_noteExist = false;
-							EventQueue::get_instance()->m_addMidiNoteVector.push_back(noteAction);
-						}
-					}
-				}
-
-				// Perform a loop over all notes, which are enclose
-				// the position of the current tick, using a constant
-				// iterator (notes won't be altered!). After some
-				// humanization was applied to onset of each note, it
-				// will be added to `m_songNoteQueue` for playback.
-				FOREACH_NOTE_CST_IT_BOUND(notes,it,m_nPatternTickPosition) {
-					Note *pNote = it->second;
-					if ( pNote ) {
-						pNote->set_just_recorded( false );
-						int nOffset = 0;
-
-						// Swing //
-						// Add a constant and periodic offset at
-						// predefined positions to the note position.
-						// TODO: incorporate the factor of 6.0 either
-						// in Song::__swing_factor or make it a member
-						// variable.
-						float fSwingFactor = pSong->get_swing_factor();
-						if ( ( ( m_nPatternTickPosition % 12 ) == 0 )
-							 && ( ( m_nPatternTickPosition % 24 ) != 0 ) ) {
-							nOffset += ( int )(
-										6.0
-										* m_pAudioDriver->m_transport.m_nTickSize
-										* fSwingFactor
-										);
-						}
-
-						// Humanize - Time parameter //
-						// Add a random offset to each note. Due to
-						// the nature of the Gaussian distribution,
-						// the factor Song::__humanize_time_value will
-						// also scale the variance of the generated
-						// random variable.
-						if ( pSong->get_humanize_time_value() != 0 ) {
-							nOffset += ( int )(
-										getGaussian( 0.3 )
-										* pSong->get_humanize_time_value()
-										* nMaxTimeHumanize
-										);
-						}
-
-						// Lead or Lag - timing parameter //
-						// Add a constant offset to all notes.
-						nOffset += (int) ( pNote->get_lead_lag()
-										   * nLeadLagFactor);
-
-						// No note is allowed to start prior to the
-						// beginning of the song.
-						if((tick == 0) && (nOffset < 0)) {
-							nOffset = 0;
-						}
-						
-						// Generate a copy of the current note, assign
-						// it the new offset, and push it to the list
-						// of all notes, which are about to be played
-						// back.
-						// TODO: Why a copy?
-						Note *pCopiedNote = new Note( pNote );
-						pCopiedNote->set_position( tick );
-						pCopiedNote->set_humanize_delay( nOffset );
-						pNote->get_instrument()->enqueue();
-						m_songNoteQueue.push( pCopiedNote );
-					}
-				}
+				audioEngine_queuePatternNotes( pSong, m_pSongSnapshot->get_notes( pPattern ),
+											   nPat, tick, doErase, nLeadLagFactor, nMaxTimeHumanize );
 			}
 		}
 	}
@@ -2025,7 +2276,7 @@ void audioEngine_noteOn( Note *note )
 	if ( ( m_audioEngineState != STATE_READY )
 		 && ( m_audioEngineState != STATE_PLAYING ) ) {
 		___ERRORLOG( "Error the audio engine is not in READY state" );
-		delete note;
+		NotePool::get_instance()->release( note );
 		return;
 	}
 
@@ -2372,6 +2623,8 @@ Hydrogen::Hydrogen()
 	m_pTimeline = new Timeline();
 	m_pCoreActionController = new CoreActionController();
 	m_bActiveGUI = false;
+	m_pDrumkitLoader = nullptr;
+	m_bDrumkitLoadConditional = true;
 
 	initBeatcounter();
 	InstrumentComponent::setMaxLayers( Preferences::get_instance()->getMaxLayers() );
@@ -2410,6 +2663,13 @@ Hydrogen::~Hydrogen()
 	}
 #endif
 
+	delete m_pDrumkitLoader;
+	m_pDrumkitLoader = nullptr;
+	// stops the computation of the waveform peaks
+	if ( SamplePeakCache::has_instance() ) {
+		delete SamplePeakCache::get_instance();
+	}
+
 	if ( m_audioEngineState == STATE_PLAYING ) {
 		audioEngine_stop();
 	}
@@ -2431,6 +2691,10 @@ void Hydrogen::create_instance()
 	Logger::create_instance();
 	MidiMap::create_instance();
 	Preferences::create_instance();
+	SampleCache::create_instance();
+	SampleDiskCache::create_instance();
+	SamplePeakCache::create_instance();
+	DrumkitIndex::create_instance();
 	EventQueue::create_instance();
 	MidiActionManager::create_instance();
 
@@ -2513,6 +2777,7 @@ void Hydrogen::setSong( Song *pSong )
 	if ( pCurrentSong ) {
 		
 		AudioEngine::get_instance()->lock( RIGHT_HERE );
+		AudioEngine::get_instance()->set_song( nullptr );
 		delete pCurrentSong;
 		pCurrentSong = nullptr;
 
@@ -2567,29 +2832,47 @@ void Hydrogen::addRealtimeNote(	int		instrument,
 								float	pitch,
 								bool	noteOff,
 								bool	forcePlay,
-								int		msg1 )
+								int		msg1,
+								uint64_t	nTime )
 {
 	UNUSED( pitch );
 
 	Preferences *pPreferences = Preferences::get_instance();
-	unsigned int nRealColumn = 0;
 	unsigned res = pPreferences->getPatternEditorGridResolution();
 	int nBase = pPreferences->isPatternEditorUsingTriplets() ? 3 : 4;
 	int scalar = ( 4 * MAX_NOTES ) / ( res * nBase );
 	bool hearnote = forcePlay;
 	int currentPatternNumber;
 
-	AudioEngine::get_instance()->lock( RIGHT_HERE );
+	if ( nTime == 0 ) {
+		nTime = RealtimeNoteQueue::now();
+	}
 
 	Song *pSong = getSong();
+	if ( pSong == nullptr ) {
+		return;
+	}
 	if ( !pPreferences->__playselectedinstrument ) {
 		if ( instrument >= ( int ) pSong->get_instrument_list()->size() ) {
 			// unused instrument
-			AudioEngine::get_instance()->unlock();
 			return;
 		}
 	}
 
+	if ( !pPreferences->getRecordEvents() || m_audioEngineState != STATE_PLAYING ) {
+		// Nothing to record, the audio thread plays the note
+		// without the audio engine being locked.
+		if ( m_audioEngineState != STATE_PLAYING && pPreferences->getHearNewNotes() ) {
+			hearnote = true;
+		}
+		if ( hearnote ) {
+			queueRealtimeNote( instrument, velocity, pan_L, pan_R, msg1, nTime );
+		}
+		return;
+	}
+
+	AudioEngine::get_instance()->lock( RIGHT_HERE );
+
 	// Get current partern and column, compensating for "lookahead" if required
 	const Pattern* currentPattern = nullptr;
 	unsigned int column = 0;
@@ -2668,8 +2951,6 @@ void Hydrogen::addRealtimeNote(	int		instrument,
 		}
 	}
 
-	nRealColumn = getRealtimeTickPosition();
-
 	if ( pPreferences->getQuantizeEvents() ) {
 		// quantize it to scale
 		unsigned qcolumn = ( unsigned )::round( column / ( double )scalar ) * scalar;
@@ -2886,35 +3167,83 @@ void Hydrogen::addRealtimeNote(	int		instrument,
 			hearnote = true;
 	} /* if .. STATE_PLAYING */
 
-	if ( !pPreferences->__playselectedinstrument ) {
-		if ( hearnote && instrRef ) {
-			Note *pNote2 = new Note( instrRef, nRealColumn, velocity, pan_L, pan_R, -1, 0 );
-			midi_noteOn( pNote2 );
-		}
-	} else if ( hearnote  ) {
-		Instrument* pInstr = pSong->get_instrument_list()->get( getSelectedInstrumentNumber() );
-		Note *pNote2 = new Note( pInstr, nRealColumn, velocity, pan_L, pan_R, -1, 0 );
+	AudioEngine::get_instance()->unlock(); // unlock the audio engine
 
-		int divider = msg1 / 12;
-		Note::Octave octave = (Note::Octave)(divider -3);
-		Note::Key notehigh = (Note::Key)(msg1 - (12 * divider));
+	if ( hearnote ) {
+		queueRealtimeNote( instrument, velocity, pan_L, pan_R, msg1, nTime );
+	}
+}
 
-		//ERRORLOG( QString( "octave: %1, note: %2, instrument %3" ).arg( octave ).arg(notehigh).arg(instrument));
-		pNote2->set_midi_info( notehigh, octave, msg1 );
-		midi_noteOn( pNote2 );
+void Hydrogen::queueRealtimeNote( int instrument, float velocity, float pan_L, float pan_R, int msg1, uint64_t nTime )
+{
+	if ( m_pRealtimeNoteQueue == nullptr ) {
+		return;
 	}
 
-	AudioEngine::get_instance()->unlock(); // unlock the audio engine
+	RealtimeNoteQueue::Event event;
+	event.type = RealtimeNoteQueue::Event::NOTE_ON;
+	event.time = nTime;
+	event.velocity = velocity;
+	event.pan_L = pan_L;
+	event.pan_R = pan_R;
+	event.length = -1;
+	event.note_on_tick = 0;
+	if ( Preferences::get_instance()->__playselectedinstrument ) {
+		event.instrument = getSelectedInstrumentNumber();
+		event.key = msg1;
+	} else {
+		event.instrument = m_nInstrumentLookupTable[ instrument ];
+		event.key = -1;
+	}
+	if ( !m_pRealtimeNoteQueue->push( event ) ) {
+		WARNINGLOG( "Realtime note queue full, note dropped" );
+	}
 }
 
-float Hydrogen::getMasterPeak_L()
+void Hydrogen::addRealtimeNoteOff( int instrument, int key, uint64_t nTime, int nLength, int nNoteOnTick )
 {
-	return m_fMasterPeak_L;
+	if ( m_pRealtimeNoteQueue == nullptr ) {
+		return;
+	}
+
+	RealtimeNoteQueue::Event event;
+	event.type = ( key != -1 ) ? RealtimeNoteQueue::Event::KEY_OFF : RealtimeNoteQueue::Event::NOTE_OFF;
+	event.time = ( nTime != 0 ) ? nTime : RealtimeNoteQueue::now();
+	event.instrument = instrument;
+	event.key = key;
+	event.velocity = 0.0;
+	event.pan_L = 0.0;
+	event.pan_R = 0.0;
+	event.length = nLength;
+	event.note_on_tick = nNoteOnTick;
+	if ( !m_pRealtimeNoteQueue->push( event ) ) {
+		WARNINGLOG( "Realtime note queue full, note-off dropped" );
+	}
 }
 
-float Hydrogen::getMasterPeak_R()
+void Hydrogen::applyRecordedNoteLengths()
 {
-	return m_fMasterPeak_R;
+	if ( m_recordedNoteLengths.front() == nullptr ) {
+		return;
+	}
+
+	AudioEngine::get_instance()->lock_song();
+	Sampler* pSampler = AudioEngine::get_instance()->get_sampler();
+	Song* pSong = getSong();
+	const RecordedNoteLength* pLength;
+	while ( ( pLength = m_recordedNoteLengths.front() ) != nullptr ) {
+		// the song or instrument may have gone since it was released
+		InstrumentList* pInstrList = pSong != nullptr ? pSong->get_instrument_list() : nullptr;
+		if ( pInstrList != nullptr && pLength->instrument >= 0
+			 && pLength->instrument < pInstrList->size() ) {
+			pSampler->setPlayingNotelength( pInstrList->get( pLength->instrument ),
+											pLength->length, pLength->note_on_tick );
+		}
+		m_recordedNoteLengths.pop();
+	}
+	AudioEngine::get_instance()->unlock_song(); // publish the new lengths
+
+	EventQueue::get_instance()->push_event( EVENT_PATTERN_MODIFIED, -1 );
 }
 
 unsigned long Hydrogen::getTickPosition()
@@ -3104,6 +3433,11 @@ void Hydrogen::stopExportSession()
 
 /// Export a song to a wav file
 void Hydrogen::startExportSong( const QString& filename)
+{
+	startExportSong( filename, std::map<int, QString>() );
+}
+
+void Hydrogen::startExportSong( const QString& filename, const std::map<int, QString>& stems )
 {
 	// reset
 	m_pAudioDriver->m_transport.m_nFrames = 0; // reset total frames
@@ -3115,7 +3449,14 @@ void Hydrogen::startExportSong( const QString& filename)
 
 	Preferences *pPref = Preferences::get_instance();
 
-	int res = m_pAudioDriver->init( pPref->m_nBufferSize );
+	// Offline rendering has no latency constraint, larger blocks
+	// reduce the per-cycle overhead of the engine.
+	unsigned nBufferSize = pPref->m_nBufferSize;
+	if ( pPref->m_nExportBufferSize > 0 ) {
+		nBufferSize = std::min( pPref->m_nExportBufferSize, (unsigned)MAX_BUFFER_SIZE );
+	}
+
+	int res = m_pAudioDriver->init( nBufferSize );
 	if ( res != 0 ) {
 		ERRORLOG( "Error starting disk writer driver [DiskWriterDriver::init()]" );
 	}
@@ -3129,6 +3470,7 @@ void Hydrogen::startExportSong( const QString& filename)
 
 	DiskWriterDriver* pDiskWriterDriver = (DiskWriterDriver*) m_pAudioDriver;
 	pDiskWriterDriver->setFileName( filename );
+	pDiskWriterDriver->setStems( stems );
 	
 	res = m_pAudioDriver->connect();
 	if ( res != 0 ) {
@@ -3167,16 +3509,6 @@ MidiOutput* Hydrogen::getMidiOutput()
 	return m_pMidiDriverOut;
 }
 
-void Hydrogen::setMasterPeak_L( float value )
-{
-	m_fMasterPeak_L = value;
-}
-
-void Hydrogen::setMasterPeak_R( float value )
-{
-	m_fMasterPeak_R = value;
-}
-
 int Hydrogen::getState()
 {
 	return m_audioEngineState;
@@ -3200,6 +3532,16 @@ float Hydrogen::getMaxProcessTime()
 	return m_fMaxProcessTime;
 }
 
+DspProfiler* Hydrogen::getDspProfiler()
+{
+	return m_pDspProfiler;
+}
+
+Meters* Hydrogen::getMeters()
+{
+	return m_pMeters;
+}
+
 
 // Setting conditional to true will keep instruments that have notes if new kit has less instruments than the old one
 int Hydrogen::loadDrumkit( Drumkit *pDrumkitInfo )
@@ -3211,37 +3553,61 @@ int Hydrogen::loadDrumkit( Drumkit *pDrumkitInfo, bool conditional )
 {
 	assert ( pDrumkitInfo );
 
-	int old_ae_state = m_audioEngineState;
-	if( m_audioEngineState >= STATE_READY ) {
-		m_audioEngineState = STATE_PREPARED;
-	}
+	DrumkitLoader loader( pDrumkitInfo );
+	loader.run();
 
-	INFOLOG( pDrumkitInfo->get_name() );
-	m_currentDrumkit = pDrumkitInfo->get_name();
+	return publishDrumkit( &loader, conditional );
+}
 
-	std::vector<DrumkitComponent*>* pSongCompoList= getSong()->get_components();
-	std::vector<DrumkitComponent*>* pDrumkitCompoList = pDrumkitInfo->get_components();
-	
-	AudioEngine::get_instance()->lock( RIGHT_HERE );	
-	for( auto &pComponent : *pSongCompoList ){
-		delete pComponent;
+bool Hydrogen::loadDrumkitAsync( Drumkit *pDrumkitInfo, bool conditional )
+{
+	assert ( pDrumkitInfo );
+
+	// the previous load is outdated
+	delete m_pDrumkitLoader;
+
+	m_bDrumkitLoadConditional = conditional;
+	m_pDrumkitLoader = new DrumkitLoader( pDrumkitInfo );
+	if ( !m_pDrumkitLoader->start() ) {
+		delete m_pDrumkitLoader;
+		m_pDrumkitLoader = nullptr;
+		return false;
 	}
-	pSongCompoList->clear();
-	AudioEngine::get_instance()->unlock();
-	
-	for (std::vector<DrumkitComponent*>::iterator it = pDrumkitCompoList->begin() ; it != pDrumkitCompoList->end(); ++it) {
-		DrumkitComponent* pSrcComponent = *it;
-		DrumkitComponent* pNewComponent = new DrumkitComponent( pSrcComponent->get_id(), pSrcComponent->get_name() );
-		pNewComponent->load_from( pSrcComponent );
+	return true;
+}
 
-		pSongCompoList->push_back( pNewComponent );
+int Hydrogen::finishDrumkitLoad()
+{
+	if ( m_pDrumkitLoader == nullptr || !m_pDrumkitLoader->is_done() ) {
+		return -1;
 	}
 
+	int nRes = publishDrumkit( m_pDrumkitLoader, m_bDrumkitLoadConditional );
+	delete m_pDrumkitLoader;
+	m_pDrumkitLoader = nullptr;
+	return nRes;
+}
+
+bool Hydrogen::isDrumkitLoading() const
+{
+	return m_pDrumkitLoader != nullptr;
+}
+
+int Hydrogen::publishDrumkit( DrumkitLoader* pLoader, bool conditional )
+{
+	if ( !pLoader->is_done() ) {
+		return -1;
+	}
+
+	Drumkit* pDrumkitInfo = pLoader->get_drumkit();
+	INFOLOG( pDrumkitInfo->get_name() );
+	m_currentDrumkit = pDrumkitInfo->get_name();
+
 	//current instrument list
 	InstrumentList *pSongInstrList = getSong()->get_instrument_list();
 	
 	//new instrument list
-	InstrumentList *pDrumkitInstrList = pDrumkitInfo->get_instruments();
+	InstrumentList *pDrumkitInstrList = pLoader->get_instruments();
 	
 	/*
 	 * If the old drumkit is bigger then the new drumkit,
@@ -3266,31 +3632,34 @@ int Hydrogen::loadDrumkit( Drumkit *pDrumkitInfo, bool conditional )
 	
 	//needed for the new delete function
 	int instrumentDiff =  pSongInstrList->size() - pDrumkitInstrList->size();
-	
-	for ( unsigned nInstr = 0; nInstr < pDrumkitInstrList->size(); ++nInstr ) {
-		Instrument *pInstr = nullptr;
-		if ( nInstr < pSongInstrList->size() ) {
-			//instrument exists already
-			pInstr = pSongInstrList->get( nInstr );
-			assert( pInstr );
-		} else {
-			pInstr = new Instrument();
-			// The instrument isn't playing yet; no need for locking
-			// :-) - Jakob Lund.  AudioEngine::get_instance()->lock(
-			// "Hydrogen::loadDrumkit" );
-			pSongInstrList->add( pInstr );
-			// AudioEngine::get_instance()->unlock();
-		}
 
+	// Everything was loaded beforehand, the audio engine is held
+	// for a few pointer swaps only and keeps on playing the
+	// previous kit until the end of its current cycle. The notes
+	// still ringing on the replaced instruments are cut.
+	AudioEngine::get_instance()->lock( RIGHT_HERE );
+	getSong()->get_components()->swap( *pLoader->get_components() );
+
+	Sampler* pSampler = AudioEngine::get_instance()->get_sampler();
+	int nSongInstruments = pSongInstrList->size();
+	for ( int nInstr = 0; nInstr < pDrumkitInstrList->size(); ++nInstr ) {
 		Instrument *pNewInstr = pDrumkitInstrList->get( nInstr );
-		assert( pNewInstr );
-		INFOLOG( QString( "Loading instrument (%1 of %2) [%3]" )
-				 .arg( nInstr + 1 )
-				 .arg( pDrumkitInstrList->size() )
-				 .arg( pNewInstr->get_name() ) );
+		if ( nInstr < nSongInstruments ) {
+			// instrument exists already, the patterns refer to it.
+			// Its voices hold layers and samples of the old kit,
+			// which go away with the loader.
+			Instrument *pSongInstr = pSongInstrList->get( nInstr );
+			pSampler->stop_playing_notes( pSongInstr );
+			pSongInstr->take_from( pNewInstr );
+		} else {
+			pSongInstrList->add( pNewInstr );
+		}
+	}
+	AudioEngine::get_instance()->unlock();
 
-		// Moved code from here right into the Instrument class - Jakob Lund.
-		pInstr->load_from( pDrumkitInfo, pNewInstr );
+	// the instruments added to the song are not the loader's anymore
+	while ( pDrumkitInstrList->size() > nSongInstruments ) {
+		pDrumkitInstrList->del( pDrumkitInstrList->size() - 1 );
 	}
 
 	//wolke: new delete function
@@ -3309,8 +3678,6 @@ int Hydrogen::loadDrumkit( Drumkit *pDrumkitInfo, bool conditional )
 	AudioEngine::get_instance()->unlock();
 #endif
 
-	m_audioEngineState = old_ae_state;
-	
 	m_pCoreActionController->initExternalControlInterfaces();
 
 	return 0;	//ok
@@ -3393,6 +3760,11 @@ void Hydrogen::removeInstrument( int instrumentNumber, bool conditional )
 	setSelectedInstrumentNumber( instrumentNumber - 1 );
 	getSong()->set_is_modified( true );
 	AudioEngine::get_instance()->unlock();
+	// The audio thread may have started a cycle on the snapshot
+	// published before the removal, which still has notes of the
+	// instrument. Wait for it to finish.
+	AudioEngine::get_instance()->lock( RIGHT_HERE );
+	AudioEngine::get_instance()->unlock();
 
 	// At this point the instrument has been removed from both the
 	// instrument list and every pattern in the song.  Hence there's no way
@@ -3510,25 +3882,6 @@ void Hydrogen::setPatternPos( int pos )
 	AudioEngine::get_instance()->unlock();
 }
 
-void Hydrogen::getLadspaFXPeak( int nFX, float *fL, float *fR )
-{
-#ifdef H2CORE_HAVE_LADSPA
-	( *fL ) = m_fFXPeak_L[nFX];
-	( *fR ) = m_fFXPeak_R[nFX];
-#else
-	( *fL ) = 0;
-	( *fR ) = 0;
-#endif
-}
-
-void Hydrogen::setLadspaFXPeak( int nFX, float fL, float fR )
-{
-#ifdef H2CORE_HAVE_LADSPA
-	m_fFXPeak_L[nFX] = fL;
-	m_fFXPeak_R[nFX] = fR;
-#endif
-}
-
 void Hydrogen::onTapTempoAccelEvent()
 {
 #ifndef WIN32
@@ -37,6 +37,7 @@
 #include <hydrogen/Preferences.h>
 #include <hydrogen/timeline.h>
 #include <hydrogen/basics/song.h>
+#include <hydrogen/basics/song_binary.h>
 #include <hydrogen/basics/drumkit.h>
 #include <hydrogen/basics/sample.h>
 #include <hydrogen/helpers/filesystem.h>
@@ -53,6 +54,7 @@
 //#include <QCoreApplication>
 #include <QVector>
 #include <QDomDocument>
+#include <QSaveFile>
 #include <QLocale>
 
 namespace H2Core
@@ -328,7 +330,38 @@ SongWriter::~SongWriter()
 int SongWriter::writeSong( Song * pSong, const QString& filename )
 {
 	INFOLOG( "Saving song " + filename );
-	int rv = 0; // return value
+	int rv = writeFile( filename, serializeSong( pSong, filename ) );
+
+	if( rv ) {
+		WARNINGLOG("File save reported an error.");
+	} else {
+		pSong->set_is_modified( false );
+		INFOLOG("Save was successful.");
+	}
+
+	pSong->set_filename( filename );
+
+	return rv;
+}
+
+
+int SongWriter::writeFile( const QString& filename, const QByteArray& data )
+{
+	// written aside and renamed once complete, an interrupted
+	// save leaves the previous file untouched
+	QSaveFile file( filename );
+	if ( data.isEmpty() || !file.open( QIODevice::WriteOnly )
+		 || file.write( data ) != data.size() || !file.commit() ) {
+		ERRORLOG( QString( "Unable to write %1: %2" ).arg( filename ).arg( file.errorString() ) );
+		return 1;
+	}
+	return 0;
+}
+
+
+QByteArray SongWriter::serializeSong( Song * pSong, const QString& filename )
+{
+	bool bBinary = filename.endsWith( Filesystem::songs_bin_ext );
 
 	// FIXME: has the file write-permssion?
 	// FIXME: verificare che il file non sia gia' esistente
@@ -509,51 +542,53 @@ int SongWriter::writeSong( Song * pSong, const QString& filename )
 	songNode.appendChild( instrumentListNode );
 
 
-	// pattern list
-	QDomNode patternListNode = doc.createElement( "patternList" );
-
+	// pattern list, binary songs carry the patterns in chunks of their own
 	unsigned nPatterns = pSong->get_pattern_list()->size();
-	for ( unsigned i = 0; i < nPatterns; i++ ) {
-		const Pattern *pPattern = pSong->get_pattern_list()->get( i );
+	if ( !bBinary ) {
+		QDomNode patternListNode = doc.createElement( "patternList" );
 
-		// pattern
-		QDomNode patternNode = doc.createElement( "pattern" );
-		LocalFileMng::writeXmlString( patternNode, "name", pPattern->get_name() );
-		LocalFileMng::writeXmlString( patternNode, "category", pPattern->get_category() );
-		LocalFileMng::writeXmlString( patternNode, "size", QString("%1").arg( pPattern->get_length() ) );
-		LocalFileMng::writeXmlString( patternNode, "info", pPattern->get_info() );
-
-		QDomNode noteListNode = doc.createElement( "noteList" );
-		const Pattern::notes_t* notes = pPattern->get_notes();
-		FOREACH_NOTE_CST_IT_BEGIN_END(notes,it) {
-			Note *pNote = it->second;
-			assert( pNote );
-
-			QDomNode noteNode = doc.createElement( "note" );
-			LocalFileMng::writeXmlString( noteNode, "position", QString("%1").arg( pNote->get_position() ) );
-			LocalFileMng::writeXmlString( noteNode, "leadlag", QString("%1").arg( pNote->get_lead_lag() ) );
-			LocalFileMng::writeXmlString( noteNode, "velocity", QString("%1").arg( pNote->get_velocity() ) );
-			LocalFileMng::writeXmlString( noteNode, "pan_L", QString("%1").arg( pNote->get_pan_l() ) );
-			LocalFileMng::writeXmlString( noteNode, "pan_R", QString("%1").arg( pNote->get_pan_r() ) );
-			LocalFileMng::writeXmlString( noteNode, "pitch", QString("%1").arg( pNote->get_pitch() ) );
-			LocalFileMng::writeXmlString( noteNode, "probability", QString("%1").arg( pNote->get_probability() ) );
-
-			LocalFileMng::writeXmlString( noteNode, "key", pNote->key_to_string() );
-
-			LocalFileMng::writeXmlString( noteNode, "length", QString("%1").arg( pNote->get_length() ) );
-			LocalFileMng::writeXmlString( noteNode, "instrument", QString("%1").arg( pNote->get_instrument()->get_id() ) );
-
-			QString noteoff = "false";
-			if ( pNote->get_note_off() ) noteoff = "true";
-			LocalFileMng::writeXmlString( noteNode, "note_off", noteoff );
-			noteListNode.appendChild( noteNode );
+		for ( unsigned i = 0; i < nPatterns; i++ ) {
+			const Pattern *pPattern = pSong->get_pattern_list()->get( i );
 
-		}
-		patternNode.appendChild( noteListNode );
+			// pattern
+			QDomNode patternNode = doc.createElement( "pattern" );
+			LocalFileMng::writeXmlString( patternNode, "name", pPattern->get_name() );
+			LocalFileMng::writeXmlString( patternNode, "category", pPattern->get_category() );
+			LocalFileMng::writeXmlString( patternNode, "size", QString("%1").arg( pPattern->get_length() ) );
+			LocalFileMng::writeXmlString( patternNode, "info", pPattern->get_info() );
+
+			QDomNode noteListNode = doc.createElement( "noteList" );
+			const Pattern::notes_t* notes = pPattern->get_notes();
+			FOREACH_NOTE_CST_IT_BEGIN_END(notes,it) {
+				Note *pNote = it->second;
+				assert( pNote );
+
+				QDomNode noteNode = doc.createElement( "note" );
+				LocalFileMng::writeXmlString( noteNode, "position", QString("%1").arg( pNote->get_position() ) );
+				LocalFileMng::writeXmlString( noteNode, "leadlag", QString("%1").arg( pNote->get_lead_lag() ) );
+				LocalFileMng::writeXmlString( noteNode, "velocity", QString("%1").arg( pNote->get_velocity() ) );
+				LocalFileMng::writeXmlString( noteNode, "pan_L", QString("%1").arg( pNote->get_pan_l() ) );
+				LocalFileMng::writeXmlString( noteNode, "pan_R", QString("%1").arg( pNote->get_pan_r() ) );
+				LocalFileMng::writeXmlString( noteNode, "pitch", QString("%1").arg( pNote->get_pitch() ) );
+				LocalFileMng::writeXmlString( noteNode, "probability", QString("%1").arg( pNote->get_probability() ) );
+
+				LocalFileMng::writeXmlString( noteNode, "key", pNote->key_to_string() );
+
+				LocalFileMng::writeXmlString( noteNode, "length", QString("%1").arg( pNote->get_length() ) );
+				LocalFileMng::writeXmlString( noteNode, "instrument", QString("%1").arg( pNote->get_instrument()->get_id() ) );
+
+				QString noteoff = "false";
+				if ( pNote->get_note_off() ) noteoff = "true";
+				LocalFileMng::writeXmlString( noteNode, "note_off", noteoff );
+				noteListNode.appendChild( noteNode );
+
+			}
+			patternNode.appendChild( noteListNode );
 
-		patternListNode.appendChild( patternNode );
+			patternListNode.appendChild( patternNode );
+		}
+		songNode.appendChild( patternListNode );
 	}
-	songNode.appendChild( patternListNode );
 
 	QDomNode virtualPatternListNode = doc.createElement( "virtualPatternList" );
 	for ( unsigned i = 0; i < nPatterns; i++ ) {
@@ -677,28 +712,10 @@ int SongWriter::writeSong( Song * pSong, const QString& filename )
 	}
 	songNode.appendChild( automationPathsTag );
 
-	QFile file(filename);
-	if ( !file.open(QIODevice::WriteOnly) )
-		rv = 1;
-
-	QTextStream TextStream( &file );
-	doc.save( TextStream, 1 );
-
-	if( file.size() == 0)
-		rv = 1;
-
-	file.close();
-
-	if( rv ) {
-		WARNINGLOG("File save reported an error.");
-	} else {
-		pSong->set_is_modified( false );
-		INFOLOG("Save was successful.");
+	if ( bBinary ) {
+		return SongBinary::encode( doc, pSong );
 	}
-
-	pSong->set_filename( filename );
-
-	return rv;
+	return doc.toByteArray( 1 );
 }
 
 };
@@ -22,18 +22,25 @@
 
 #include "hydrogen/logger.h"
 
+#include <algorithm>
 #include <cstdio>
+#include <vector>
 #include <QtCore/QDir>
 #include <QtCore/QString>
 
 #ifdef WIN32
 #include <windows.h>
-#define LOGGER_SLEEP Sleep( 100 )
+#define LOGGER_SLEEP Sleep( 50 )
+#define LOGGER_WAIT Sleep( 1 )
 #else
 #include <unistd.h>
-#define LOGGER_SLEEP do { usleep( 500000 ); usleep( 500000 ); } while (0)
+#define LOGGER_SLEEP usleep( 50000 )
+#define LOGGER_WAIT usleep( 1000 )
 #endif
 
+/** Number of records buffered per thread, has to be a power of two. */
+#define LOGGER_RING_SIZE 1024
+
 namespace H2Core {
 
 unsigned Logger::__bit_msk = 0;
@@ -42,6 +49,56 @@ const char* Logger::__levels[] = { "None", "Error", "Warning", "Info", "Debug" }
 
 pthread_t loggerThread;
 
+/** a message waiting to be formatted by the logger thread */
+struct LogRecord {
+	unsigned long long sequence;
+	unsigned level;
+	int nArgs;
+	const char* class_name;
+	const char* func_name;
+	const char* format;     ///< nullptr if msg is to be logged
+	QString msg;            ///< shared with the caller, released by the logger thread
+	Logger::Arg args[ LOGGER_MAX_ARGS ];
+};
+
+/**
+ * single producer, single consumer ring buffer of the records of one
+ * thread
+ */
+class Logger::Ring {
+	public:
+		Ring( bool owned, bool reserved ) : next( nullptr ), owned( owned ), reserved( reserved ), head( 0 ), tail( 0 ) { }
+
+		Ring* next;                     ///< next buffer in Logger::__rings
+		std::atomic<bool> owned;        ///< a running thread writes to it
+		const bool reserved;            ///< only taken by real-time threads, see Logger::reserve_rings()
+		std::atomic<unsigned> head;     ///< next record to write, moved by the owning thread
+		std::atomic<unsigned> tail;     ///< next record to read, moved by the logger thread
+		LogRecord records[ LOGGER_RING_SIZE ];
+};
+
+/** gives the buffer of a thread back when the thread ends */
+struct RingOwner {
+	Logger::Ring* ring = nullptr;
+	bool realtime = false;          ///< see Logger::register_thread()
+	~RingOwner() {
+		if ( ring ) {
+			ring->owned.store( false, std::memory_order_release );
+		}
+	}
+};
+static thread_local RingOwner ringOwner;
+
+/** whether the calling thread runs with a realtime scheduling policy */
+static bool is_realtime_thread() {
+	int policy;
+	struct sched_param param;
+	if ( pthread_getschedparam( pthread_self(), &policy, &param ) != 0 ) {
+		return true;
+	}
+	return policy == SCHED_FIFO || policy == SCHED_RR;
+}
+
 void* loggerThread_func( void* param ) {
 	if ( param == nullptr ) return nullptr;
 	Logger* logger = ( Logger* )param;
@@ -66,28 +123,12 @@ void* loggerThread_func( void* param ) {
 			fprintf( stderr, "Error: can't open log file for writing...\n" );
 		}
 	}
-	Logger::queue_t* queue = &logger->__msg_queue;
-	Logger::queue_t::iterator it, last;
-	//QString tmpString;
 	while ( logger->__running ) {
 		LOGGER_SLEEP;
-		if( !queue->empty() ) {
-			for( it = last = queue->begin() ; it != queue->end() ; ++it ) {
-				last = it;
-				fprintf( stdout, "%s", it->toLocal8Bit().data() );
-				if( log_file ) {
-					fprintf( log_file, "%s", it->toLocal8Bit().data() );
-					fflush( log_file );
-				}
-			}
-			// remove all in front of last
-			queue->erase( queue->begin(), last );
-			// lock before removing last
-			pthread_mutex_lock( &logger->__mutex );
-			queue->pop_front();
-			pthread_mutex_unlock( &logger->__mutex );
-		}
+		logger->flush( log_file );
 	}
+	// what has been logged while stopping
+	logger->flush( log_file );
 	if ( log_file ) {
 		fprintf( log_file, "Stop logger" );
 		fclose( log_file );
@@ -110,25 +151,118 @@ Logger* Logger::create_instance() {
 	return __instance;
 }
 
-Logger::Logger() : __use_file( false ), __running( true ) {
+Logger::Logger() : __use_file( false ), __running( true ), __rings( nullptr ), __sequence( 0 ), __dropped( 0 ) {
 	__instance = this;
 	pthread_attr_t attr;
 	pthread_attr_init( &attr );
-	pthread_mutex_init( &__mutex, nullptr );
 	pthread_create( &loggerThread, &attr, loggerThread_func, this );
 }
 
 Logger::~Logger() {
 	__running = false;
 	pthread_join( loggerThread, nullptr );
+	// The rings are not freed, the threads owning them release them
+	// when they end, possibly after the logger is gone.
+}
+
+void Logger::log( unsigned level, const char* class_name, const char* func_name, const QString& msg ) {
+	push_record( level, class_name, func_name, nullptr, &msg, nullptr, 0 );
+}
+
+void Logger::add_ring( Ring* ring ) {
+	ring->next = __rings.load( std::memory_order_relaxed );
+	while ( !__rings.compare_exchange_weak( ring->next, ring, std::memory_order_release, std::memory_order_relaxed ) ) {
+	}
+}
+
+void Logger::register_thread() {
+	ringOwner.realtime = true;
+	if ( thread_ring() == nullptr ) {
+		Ring* ring = new Ring( true, true );
+		add_ring( ring );
+		ringOwner.ring = ring;
+	}
+}
+
+void Logger::reserve_rings( unsigned n ) {
+	for ( Ring* ring = __rings.load( std::memory_order_acquire ); ring && n > 0; ring = ring->next ) {
+		if ( ring->reserved && !ring->owned.load( std::memory_order_acquire ) ) {
+			--n;
+		}
+	}
+	for ( ; n > 0; --n ) {
+		add_ring( new Ring( false, true ) );
+	}
 }
 
-void Logger::log( unsigned level, const QString& class_name, const char* func_name, const QString& msg ) {
+Logger::Ring* Logger::thread_ring() {
+	if ( ringOwner.ring ) {
+		return ringOwner.ring;
+	}
+	bool realtime = ringOwner.realtime || is_realtime_thread();
 
+	// take over the ring of a thread which ended, or a reserved one
+	for ( Ring* ring = __rings.load( std::memory_order_acquire ); ring; ring = ring->next ) {
+		if ( ring->reserved && !realtime ) {
+			continue;
+		}
+		bool owned = false;
+		if ( ring->owned.compare_exchange_strong( owned, true, std::memory_order_acq_rel ) ) {
+			ringOwner.ring = ring;
+			return ring;
+		}
+	}
+
+	if ( realtime ) {
+		// must not allocate
+		return nullptr;
+	}
+	Ring* ring = new Ring( true, false );
+	add_ring( ring );
+	ringOwner.ring = ring;
+	return ring;
+}
+
+void Logger::push_record( unsigned level, const char* class_name, const char* func_name,
+						  const char* format, const QString* msg, const Arg* args, int nArgs ) {
 	if( level == None ){
 		return;
 	}
 
+	Ring* ring = thread_ring();
+	if ( ring == nullptr ) {
+		// a real-time thread which found no spare buffer
+		__dropped.fetch_add( 1, std::memory_order_relaxed );
+		return;
+	}
+	unsigned head = ring->head.load( std::memory_order_relaxed );
+	while ( head - ring->tail.load( std::memory_order_acquire ) >= LOGGER_RING_SIZE ) {
+		// Only realtime threads lose messages, the others wait for
+		// the logger thread to catch up.
+		if ( ringOwner.realtime || is_realtime_thread() || !__running ) {
+			__dropped.fetch_add( 1, std::memory_order_relaxed );
+			return;
+		}
+		LOGGER_WAIT;
+	}
+
+	LogRecord& record = ring->records[ head & ( LOGGER_RING_SIZE - 1 ) ];
+	record.sequence = __sequence.fetch_add( 1, std::memory_order_relaxed );
+	record.level = level;
+	record.class_name = class_name;
+	record.func_name = func_name;
+	record.format = format;
+	if ( msg ) {
+		record.msg = *msg;
+	}
+	record.nArgs = nArgs;
+	for ( int i = 0; i < nArgs; ++i ) {
+		record.args[ i ] = args[ i ];
+	}
+	ring->head.store( head + 1, std::memory_order_release );
+}
+
+bool Logger::flush( FILE* log_file ) {
 	const char* prefix[] = { "", "(E) ", "(W) ", "(I) ", "(D) " };
 #ifdef WIN32
 	const char* color[] = { "", "", "", "", "" };
@@ -136,35 +270,89 @@ void Logger::log( unsigned level, const QString& class_name, const char* func_na
 	const char* color[] = { "", "\033[31m", "\033[36m", "\033[32m", "\033[35m" };
 #endif // WIN32
 
-	int i;
-	switch( level ) {
-	case Error:
-		i = 1;
-		break;
-	case Warning:
-		i = 2;
-		break;
-	case Info:
-		i = 3;
-		break;
-	case Debug:
-		i = 4;
-		break;
-	default:
-		i = 0;
-		break;
-	}
-
-	QString tmp = QString( "%1%2%3::%4 %5\033[0m\n" )
-				  .arg( color[i] )
-				  .arg( prefix[i] )
-				  .arg( class_name )
-				  .arg( func_name )
-				  .arg( msg );
-
-	pthread_mutex_lock( &__mutex );
-	__msg_queue.push_back( tmp );
-	pthread_mutex_unlock( &__mutex );
+	// collect the records of all threads and bring them back in order
+	std::vector<LogRecord*> records;
+	std::vector<std::pair<Ring*, unsigned>> heads;
+	for ( Ring* ring = __rings.load( std::memory_order_acquire ); ring; ring = ring->next ) {
+		unsigned tail = ring->tail.load( std::memory_order_relaxed );
+		unsigned head = ring->head.load( std::memory_order_acquire );
+		for ( unsigned n = tail; n != head; ++n ) {
+			records.push_back( &ring->records[ n & ( LOGGER_RING_SIZE - 1 ) ] );
+		}
+		heads.push_back( std::make_pair( ring, head ) );
+	}
+	std::sort( records.begin(), records.end(),
+			   []( const LogRecord* a, const LogRecord* b ) { return a->sequence < b->sequence; } );
+
+	QString out;
+	for ( LogRecord* record : records ) {
+		int i;
+		switch( record->level ) {
+		case Error:
+			i = 1;
+			break;
+		case Warning:
+			i = 2;
+			break;
+		case Info:
+			i = 3;
+			break;
+		case Debug:
+			i = 4;
+			break;
+		default:
+			i = 0;
+			break;
+		}
+
+		QString msg;
+		if ( record->format ) {
+			msg = record->format;
+			for ( int n = 0; n < record->nArgs; ++n ) {
+				if ( record->args[ n ].integer ) {
+					msg = msg.arg( record->args[ n ].n );
+				} else {
+					msg = msg.arg( record->args[ n ].f );
+				}
+			}
+		} else {
+			msg = record->msg;
+			record->msg = QString();
+		}
+
+		out += QString( "%1%2%3::%4 %5\033[0m\n" )
+			   .arg( color[i] )
+			   .arg( prefix[i] )
+			   .arg( record->class_name )
+			   .arg( record->func_name )
+			   .arg( msg );
+	}
+
+	// hand the records back to their threads
+	for ( auto& ring : heads ) {
+		ring.first->tail.store( ring.second, std::memory_order_release );
+	}
+
+	static unsigned reported = 0;
+	unsigned dropped = __dropped.load( std::memory_order_relaxed );
+	if ( dropped != reported ) {
+		out += QString( "%1%2Logger::flush %3 messages dropped\033[0m\n" )
+			   .arg( color[2] ).arg( prefix[2] ).arg( dropped - reported );
+		reported = dropped;
+	}
+
+	if ( out.isEmpty() ) {
+		return false;
+	}
+
+	// one write per batch
+	QByteArray data = out.toLocal8Bit();
+	fwrite( data.constData(), 1, data.size(), stdout );
+	if( log_file ) {
+		fwrite( data.constData(), 1, data.size(), log_file );
+		fflush( log_file );
+	}
+	return true;
 }
 
 unsigned Logger::parse_log_level( const char* level ) {
@@ -0,0 +1,195 @@
+/*
+ * Hydrogen
+ * Copyright(c) 2002-2008 by Alex >Comix< Cominu [comix@users.sourceforge.net]
+ *
+ * http://www.hydrogen-music.org
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY, without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ */
+
+#include <hydrogen/meters.h>
+
+#include <algorithm>
+#include <cmath>
+
+namespace H2Core
+{
+
+const char* Meters::__class_name = "Meters";
+
+Meters::Meters()
+	: Object( __class_name )
+	, __total_frames( 0 )
+	, __total_cycles( 0 )
+	, __published( 0 )
+	, __components( 0 )
+	, __instruments( 0 )
+	, __write( 0 )
+	, __read( 2 )
+	, __ready( 1 )
+	, __consumed( 0 )
+{
+	clear( 0, STRIPS );
+	for ( Frame& frame : __frames ) {
+		frame.sequence = 0;
+		frame.cycles = 0;
+		frame.components = 0;
+		frame.instruments = 0;
+	}
+}
+
+Meters::~Meters()
+{
+}
+
+void Meters::clear( int first, int last )
+{
+	for ( int nStrip = first; nStrip < last; ++nStrip ) {
+		for ( int c = 0; c < 2; ++c ) {
+			__cycle[ nStrip ].peak[ c ] = 0.0f;
+			__cycle[ nStrip ].energy[ c ] = 0.0;
+			__total[ nStrip ].peak[ c ] = 0.0f;
+			__total[ nStrip ].energy[ c ] = 0.0;
+			__hold[ nStrip ].peak[ c ] = 0.0f;
+			__hold[ nStrip ].age[ c ] = 0;
+		}
+	}
+}
+
+void Meters::add_buffer( int strip, const float* pL, const float* pR, unsigned nFrames )
+{
+	float fPeak_L = 0.0f;
+	float fEnergy_L = 0.0f;
+	for ( unsigned i = 0; i < nFrames; ++i ) {
+		fPeak_L = std::max( fPeak_L, std::fabs( pL[ i ] ) );
+		fEnergy_L += pL[ i ] * pL[ i ];
+	}
+	if ( pR == pL ) {
+		add_levels( strip, fPeak_L, fPeak_L, fEnergy_L, fEnergy_L );
+		return;
+	}
+	float fPeak_R = 0.0f;
+	float fEnergy_R = 0.0f;
+	for ( unsigned i = 0; i < nFrames; ++i ) {
+		fPeak_R = std::max( fPeak_R, std::fabs( pR[ i ] ) );
+		fEnergy_R += pR[ i ] * pR[ i ];
+	}
+	add_levels( strip, fPeak_L, fPeak_R, fEnergy_L, fEnergy_R );
+}
+
+void Meters::add_levels( int strip, float fPeak_L, float fPeak_R, float fEnergy_L, float fEnergy_R )
+{
+	if ( strip < 0 || strip >= STRIPS ) {
+		return;
+	}
+	Sum& cycle = __cycle[ strip ];
+	cycle.peak[ 0 ] = std::max( cycle.peak[ 0 ], fPeak_L );
+	cycle.peak[ 1 ] = std::max( cycle.peak[ 1 ], fPeak_R );
+	cycle.energy[ 0 ] += fEnergy_L;
+	cycle.energy[ 1 ] += fEnergy_R;
+}
+
+void Meters::publish_strip( int strip, Levels* pLevels, bool bRestart, unsigned nFrames, unsigned nHoldFrames )
+{
+	Sum& cycle = __cycle[ strip ];
+	Sum& total = __total[ strip ];
+	Hold& hold = __hold[ strip ];
+	float rms[ 2 ];
+	for ( int c = 0; c < 2; ++c ) {
+		if ( bRestart ) {
+			total.peak[ c ] = cycle.peak[ c ];
+			total.energy[ c ] = cycle.energy[ c ];
+		} else {
+			total.peak[ c ] = std::max( total.peak[ c ], cycle.peak[ c ] );
+			total.energy[ c ] += cycle.energy[ c ];
+		}
+		if ( cycle.peak[ c ] >= hold.peak[ c ] || hold.age[ c ] >= nHoldFrames ) {
+			hold.peak[ c ] = cycle.peak[ c ];
+			hold.age[ c ] = 0;
+		} else {
+			hold.age[ c ] += nFrames;
+		}
+		cycle.peak[ c ] = 0.0f;
+		cycle.energy[ c ] = 0.0;
+		rms[ c ] = ( __total_frames > 0 ) ? std::sqrt( total.energy[ c ] / __total_frames ) : 0.0f;
+	}
+	pLevels->peak_l = total.peak[ 0 ];
+	pLevels->peak_r = total.peak[ 1 ];
+	pLevels->rms_l = rms[ 0 ];
+	pLevels->rms_r = rms[ 1 ];
+	pLevels->hold_l = hold.peak[ 0 ];
+	pLevels->hold_r = hold.peak[ 1 ];
+}
+
+void Meters::publish( unsigned nFrames, unsigned nSampleRate, int nComponents, int nInstruments )
+{
+	nComponents = std::max( 0, std::min( nComponents, ( int )MAX_COMPONENTS ) );
+	nInstruments = std::max( 0, std::min( nInstruments, ( int )MAX_INSTRUMENTS ) );
+	// strips dropped meanwhile must not show up again with old levels
+	if ( nComponents < __components ) {
+		clear( COMPONENT + nComponents, COMPONENT + __components );
+	}
+	if ( nInstruments < __instruments ) {
+		clear( INSTRUMENT + nInstruments, INSTRUMENT + __instruments );
+	}
+	__components = nComponents;
+	__instruments = nInstruments;
+
+	// Unless the reader took the frame published last, the cycles it
+	// missed are summed up with this one. A frame taken while being
+	// replaced is at worst counted twice, which only keeps a peak a
+	// little longer.
+	bool bRestart = __consumed.load( std::memory_order_acquire ) == __published;
+	if ( bRestart ) {
+		__total_frames = 0;
+		__total_cycles = 0;
+	}
+	__total_frames += nFrames;
+	++__total_cycles;
+	unsigned nHoldFrames = ( uint64_t )nSampleRate * HOLD_MS / 1000;
+
+	Frame& frame = __frames[ __write ];
+	frame.sequence = __published + 1;
+	frame.cycles = __total_cycles;
+	frame.components = nComponents;
+	frame.instruments = nInstruments;
+	for ( int nStrip = 0; nStrip < COMPONENT + nComponents; ++nStrip ) {
+		publish_strip( nStrip, &frame.strips[ nStrip ], bRestart, nFrames, nHoldFrames );
+	}
+	for ( int nStrip = INSTRUMENT; nStrip < INSTRUMENT + nInstruments; ++nStrip ) {
+		publish_strip( nStrip, &frame.strips[ nStrip ], bRestart, nFrames, nHoldFrames );
+	}
+	__published = frame.sequence;
+
+	int nReady = __ready.exchange( __write | FRESH, std::memory_order_acq_rel );
+	__write = nReady & ~FRESH;
+}
+
+const Meters::Frame* Meters::take()
+{
+	if ( !( __ready.load( std::memory_order_relaxed ) & FRESH ) ) {
+		return nullptr;
+	}
+	int nReady = __ready.exchange( __read, std::memory_order_acq_rel );
+	__read = nReady & ~FRESH;
+	const Frame* pFrame = &__frames[ __read ];
+	__consumed.store( pFrame->sequence, std::memory_order_release );
+	return pFrame;
+}
+
+};
+
+/* vim: set softtabstop=4 noexpandtab: */
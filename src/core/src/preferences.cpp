@@ -143,7 +143,17 @@ Preferences::Preferences()
 	m_bUseMetronome = false;
 	m_fMetronomeVolume = 0.5;
 	m_nMaxNotes = 256;
+	m_nVoiceStealing = VOICE_STEALING_OLDEST;
+	m_nRenderThreads = 0;
 	m_nBufferSize = 1024;
+	m_nExportBufferSize = 0;
+	m_nSampleCacheSize = 1024;
+	m_bSampleDiskCache = true;
+	m_nSampleDiskCacheSize = 2048;
+	m_nSampleStreamThreshold = 8;
+	m_bCompactSamples = false;
+	m_bResampleVariants = true;
+	m_bBandLimitedVariants = false;
 	m_nSampleRate = 44100;
 
 	//___ oss driver properties ___
@@ -384,7 +394,17 @@ void Preferences::loadPreferences( bool bGlobal )
 				m_bUseMetronome = LocalFileMng::readXmlBool( audioEngineNode, "use_metronome", m_bUseMetronome );
 				m_fMetronomeVolume = LocalFileMng::readXmlFloat( audioEngineNode, "metronome_volume", 0.5f );
 				m_nMaxNotes = LocalFileMng::readXmlInt( audioEngineNode, "maxNotes", m_nMaxNotes );
+				m_nVoiceStealing = LocalFileMng::readXmlInt( audioEngineNode, "voice_stealing", m_nVoiceStealing );
+				m_nRenderThreads = LocalFileMng::readXmlInt( audioEngineNode, "render_threads", m_nRenderThreads );
 				m_nBufferSize = LocalFileMng::readXmlInt( audioEngineNode, "buffer_size", m_nBufferSize );
+				m_nExportBufferSize = LocalFileMng::readXmlInt( audioEngineNode, "export_buffer_size", m_nExportBufferSize );
+				m_nSampleCacheSize = LocalFileMng::readXmlInt( audioEngineNode, "sample_cache_size", m_nSampleCacheSize );
+				m_bSampleDiskCache = LocalFileMng::readXmlBool( audioEngineNode, "sample_disk_cache", m_bSampleDiskCache );
+				m_nSampleDiskCacheSize = LocalFileMng::readXmlInt( audioEngineNode, "sample_disk_cache_size", m_nSampleDiskCacheSize );
+				m_nSampleStreamThreshold = LocalFileMng::readXmlInt( audioEngineNode, "sample_stream_threshold", m_nSampleStreamThreshold );
+				m_bCompactSamples = LocalFileMng::readXmlBool( audioEngineNode, "compact_samples", m_bCompactSamples );
+				m_bResampleVariants = LocalFileMng::readXmlBool( audioEngineNode, "resample_variants", m_bResampleVariants );
+				m_bBandLimitedVariants = LocalFileMng::readXmlBool( audioEngineNode, "band_limited_variants", m_bBandLimitedVariants );
 				m_nSampleRate = LocalFileMng::readXmlInt( audioEngineNode, "samplerate", m_nSampleRate );
 
 				//// OSS DRIVER ////
@@ -774,7 +794,17 @@ void Preferences::savePreferences()
 		LocalFileMng::writeXmlString( audioEngineNode, "use_metronome", m_bUseMetronome ? "true": "false" );
 		LocalFileMng::writeXmlString( audioEngineNode, "metronome_volume", QString("%1").arg( m_fMetronomeVolume ) );
 		LocalFileMng::writeXmlString( audioEngineNode, "maxNotes", QString("%1").arg( m_nMaxNotes ) );
+		LocalFileMng::writeXmlString( audioEngineNode, "voice_stealing", QString("%1").arg( m_nVoiceStealing ) );
+		LocalFileMng::writeXmlString( audioEngineNode, "render_threads", QString("%1").arg( m_nRenderThreads ) );
 		LocalFileMng::writeXmlString( audioEngineNode, "buffer_size", QString("%1").arg( m_nBufferSize ) );
+		LocalFileMng::writeXmlString( audioEngineNode, "export_buffer_size", QString("%1").arg( m_nExportBufferSize ) );
+		LocalFileMng::writeXmlString( audioEngineNode, "sample_cache_size", QString("%1").arg( m_nSampleCacheSize ) );
+		LocalFileMng::writeXmlString( audioEngineNode, "sample_disk_cache", m_bSampleDiskCache ? "true": "false" );
+		LocalFileMng::writeXmlString( audioEngineNode, "sample_disk_cache_size", QString("%1").arg( m_nSampleDiskCacheSize ) );
+		LocalFileMng::writeXmlString( audioEngineNode, "sample_stream_threshold", QString("%1").arg( m_nSampleStreamThreshold ) );
+		LocalFileMng::writeXmlString( audioEngineNode, "compact_samples", m_bCompactSamples ? "true": "false" );
+		LocalFileMng::writeXmlString( audioEngineNode, "resample_variants", m_bResampleVariants ? "true": "false" );
+		LocalFileMng::writeXmlString( audioEngineNode, "band_limited_variants", m_bBandLimitedVariants ? "true": "false" );
 		LocalFileMng::writeXmlString( audioEngineNode, "samplerate", QString("%1").arg( m_nSampleRate ) );
 
 		//// OSS DRIVER ////
@@ -0,0 +1,55 @@
+/*
+ * Hydrogen
+ * Copyright(c) 2002-2008 by Alex >Comix< Cominu [comix@users.sourceforge.net]
+ *
+ * http://www.hydrogen-music.org
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY, without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ */
+
+#include <hydrogen/realtime_note_queue.h>
+
+namespace H2Core
+{
+
+const char* RealtimeNoteQueue::__class_name = "RealtimeNoteQueue";
+
+RealtimeNoteQueue::RealtimeNoteQueue()
+	: Object( __class_name )
+{
+}
+
+RealtimeNoteQueue::~RealtimeNoteQueue()
+{
+}
+
+int RealtimeNoteQueue::frame_offset( uint64_t nTime, uint64_t nWindowStart, unsigned nSampleRate, unsigned nFrames )
+{
+	if ( nTime <= nWindowStart || nFrames == 0 ) {
+		return 0;
+	}
+	uint64_t nDelta = nTime - nWindowStart;
+	// a second is longer than any cycle, and keeps the product in range
+	if ( nDelta >= 1000000000ull ) {
+		return ( int )nFrames - 1;
+	}
+	uint64_t nOffset = nDelta * nSampleRate / 1000000000ull;
+	return nOffset < nFrames ? ( int )nOffset : ( int )nFrames - 1;
+}
+
+};
+
+/* vim: set softtabstop=4 noexpandtab: */
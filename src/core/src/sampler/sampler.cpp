@@ -23,6 +23,7 @@
 #include <cassert>
 #include <cmath>
 #include <cstdlib>
+#include <algorithm>
 
 #include <hydrogen/IO/AudioOutput.h>
 #include <hydrogen/IO/jack_audio_driver.h>
@@ -37,6 +38,7 @@
 #include <hydrogen/basics/instrument_list.h>
 #include <hydrogen/basics/instrument_layer.h>
 #include <hydrogen/basics/note.h>
+#include <hydrogen/basics/note_pool.h>
 #include <hydrogen/Preferences.h>
 #include <hydrogen/basics/sample.h>
 #include <hydrogen/basics/song.h>
@@ -48,6 +50,12 @@
 #include <hydrogen/fx/Effects.h>
 #include <hydrogen/sampler/Sampler.h>
 
+#include "sampler_kernels.h"
+#include "sampler_streams.h"
+#include "sampler_variants.h"
+#include "sampler_voices.h"
+#include "sampler_workers.h"
+
 #include <iostream>
 #include <QDebug>
 
@@ -56,6 +64,21 @@ namespace H2Core
 
 const char* Sampler::__class_name = "Sampler";
 
+/** Voices rendered by the workers before they are mixed. */
+static const int SAMPLER_VOICE_SLOTS = 64;
+/** Scheduling priority of the workers, the same as the ALSA and OSS drivers. */
+static const int SAMPLER_WORKER_PRIORITY = 50;
+/** Streamed samples played at the same time, beyond their head. */
+static const int SAMPLER_STREAMS = 32;
+/** Resampled copies of the samples kept at the same time. */
+static const int SAMPLER_VARIANTS = 64;
+/** Half the number of taps of the band-limited resampling, at the
+ * lower of both rates. */
+static const int SAMPLER_SINC_TAPS = 16;
+/** Notes played at the same time at least, the most the max notes
+ * setting of the preferences dialog allows. */
+static const int SAMPLER_NOTES = 512;
+
 
 static Instrument* create_instrument(int id, const QString& filepath, float volume )
 {
@@ -79,6 +102,52 @@ Sampler::Sampler()
 	__main_out_L = new float[ MAX_BUFFER_SIZE ];
 	__main_out_R = new float[ MAX_BUFFER_SIZE ];
 
+	m_pRawBuffer_L = new float[ MAX_BUFFER_SIZE ];
+	m_pRawBuffer_R = new float[ MAX_BUFFER_SIZE ];
+	m_pVoiceBuffer_L = new float[ MAX_BUFFER_SIZE ];
+	m_pVoiceBuffer_R = new float[ MAX_BUFFER_SIZE ];
+	m_pEnvelopeBuffer = new float[ MAX_BUFFER_SIZE ];
+
+	// select the render kernels now rather than in the audio thread
+	INFOLOG( QString( "Using %1 render kernels" ).arg( get_sampler_kernels().name ) );
+
+	// Without workers every voice is rendered and mixed right away
+	// through the buffers above, so a single slot is enough.
+	m_pWorkers = nullptr;
+	m_nVoiceSlots = 1;
+	m_pSlotBuffers = nullptr;
+	m_envelopeBuffers.push_back( m_pEnvelopeBuffer );
+	m_nRenderFrames = 0;
+	m_pRenderSong = nullptr;
+	m_bTrackOutsMainMix = false;
+
+	int nThreads = Preferences::get_instance()->m_nRenderThreads;
+	if ( nThreads > 0 ) {
+		m_pWorkers = new SamplerWorkers( nThreads, SAMPLER_WORKER_PRIORITY );
+		m_nVoiceSlots = std::max( SAMPLER_VOICE_SLOTS, MAX_COMPONENTS );
+		m_pSlotBuffers = new float[ m_nVoiceSlots * 4 * MAX_BUFFER_SIZE ];
+		for ( int i = 0; i < m_pWorkers->get_threads(); ++i ) {
+			m_envelopeBuffers.push_back( new float[ MAX_BUFFER_SIZE ] );
+		}
+	}
+	m_voices.reserve( std::max( m_nVoiceSlots, MAX_COMPONENTS ) );
+	m_voiceJobs.reserve( std::max( m_nVoiceSlots, MAX_COMPONENTS ) );
+	m_pPlayingNotes = new SamplerVoices( std::max( SAMPLER_NOTES, ( int )Preferences::get_instance()->m_nMaxNotes ) );
+	m_noteResults.reserve( m_pPlayingNotes->capacity() );
+	m_renderResults.reserve( m_pPlayingNotes->capacity() * MAX_COMPONENTS );
+	__queuedNoteOffs.reserve( m_pPlayingNotes->capacity() );
+
+	m_pStreams = nullptr;
+	m_nPlaybackStream = -1;
+	if ( Preferences::get_instance()->m_nSampleStreamThreshold > 0 ) {
+		m_pStreams = new SamplerStreams( SAMPLER_STREAMS );
+	}
+
+	m_pVariants = nullptr;
+	if ( Preferences::get_instance()->m_bResampleVariants ) {
+		m_pVariants = new SamplerVariants( SAMPLER_VARIANTS, build_variant, this );
+	}
+
 	m_nMaxLayers = InstrumentComponent::getMaxLayers();
 
 	QString sEmptySampleFilename = Filesystem::empty_sample_path();
@@ -97,9 +166,29 @@ Sampler::~Sampler()
 {
 	INFOLOG( "DESTROY" );
 
+	delete m_pWorkers;
+	m_pWorkers = nullptr;
+	delete m_pPlayingNotes;
+	m_pPlayingNotes = nullptr;
+	delete m_pStreams;
+	m_pStreams = nullptr;
+	// its builder thread uses the sampler
+	delete m_pVariants;
+	m_pVariants = nullptr;
+	delete[] m_pSlotBuffers;
+	for ( unsigned i = 1; i < m_envelopeBuffers.size(); ++i ) {
+		delete[] m_envelopeBuffers[ i ];
+	}
+
 	delete[] __main_out_L;
 	delete[] __main_out_R;
 
+	delete[] m_pRawBuffer_L;
+	delete[] m_pRawBuffer_R;
+	delete[] m_pVoiceBuffer_L;
+	delete[] m_pVoiceBuffer_R;
+	delete[] m_pEnvelopeBuffer;
+
 	delete __preview_instrument;
 	__preview_instrument = nullptr;
 
@@ -120,13 +209,10 @@ void Sampler::process( uint32_t nFrames, Song* pSong )
 	// Track output queues are zeroed by
 	// audioEngine_process_clearAudioBuffers()
 
-	// Max notes limit
-	int m_nMaxNotes = Preferences::get_instance()->m_nMaxNotes;
-	while ( ( int )__playing_notes_queue.size() > m_nMaxNotes ) {
-		Note *oldNote = __playing_notes_queue[ 0 ];
-		__playing_notes_queue.erase( __playing_notes_queue.begin() );
-		oldNote->get_instrument()->dequeue();
-		delete oldNote;	// FIXME: send note-off instead of removing the note from the list?
+	// Max notes limit, note_on() keeps to it unless it was lowered
+	int nMaxNotes = get_max_notes();
+	while ( m_pPlayingNotes->size() > nMaxNotes ) {
+		steal_note( nullptr );
 	}
 
 	for (std::vector<DrumkitComponent*>::iterator it = pSong->get_components()->begin() ; it != pSong->get_components()->end(); ++it) {
@@ -136,44 +222,302 @@ void Sampler::process( uint32_t nFrames, Song* pSong )
 
 
 	// eseguo tutte le note nella lista di note in esecuzione
-	unsigned i = 0;
-	Note* pNote;
-	while ( i < __playing_notes_queue.size() ) {
-		pNote = __playing_notes_queue[ i ];		// recupero una nuova nota
-		if ( __render_note( pNote, nFrames, pSong ) ) {	// la nota e' finita
-			__playing_notes_queue.erase( __playing_notes_queue.begin() + i );
+	// The voices are prepared and mixed in slot order. Only the
+	// rendering in between may be spread over the workers, so the
+	// output does not depend on their number.
+	m_nRenderFrames = nFrames;
+	m_pRenderSong = pSong;
+	m_bTrackOutsMainMix = audio_output->track_outs_follow_main_mix();
+	m_noteResults.clear();
+	m_renderResults.clear();
+	for ( int n = 0; n < m_pPlayingNotes->size(); ++n ) {
+		Note* pNote = m_pPlayingNotes->get( n );
+		Instrument* pInstr = pNote->get_instrument();
+		int nComponents = pInstr != nullptr ? pInstr->get_components()->size() : 0;
+		if ( m_pWorkers == nullptr || ( int )m_voices.size() + nComponents > m_nVoiceSlots ) {
+			render_voices( pSong );
+		}
+		__prepare_note( pNote, nFrames, pSong );
+	}
+	render_voices( pSong );
+
+	// From the last slot down, the note moved into the slot of an
+	// ended one has already been checked.
+	for ( int nNote = m_pPlayingNotes->size() - 1; nNote >= 0; --nNote ) {
+		Note* pNote = m_pPlayingNotes->get( nNote );
+		const VoiceJob& result = m_noteResults[ nNote ];
+		bool bEnded = true;
+		for ( int nResult = 0; nResult < result.nCount; ++nResult ) {
+			if ( !m_renderResults[ result.nFirst + nResult ] ) {
+				bEnded = false;
+				break;
+			}
+		}
+		if ( bEnded ) {	// la nota e' finita
+			m_pPlayingNotes->remove( nNote );
 			pNote->get_instrument()->dequeue();
 			__queuedNoteOffs.push_back( pNote );
-//			delete pNote;
-//			pNote = NULL;
-		} else {
-			++i; // carico la prox nota
 		}
 	}
 
 	//Queue midi note off messages for notes that have a length specified for them
 
-	while ( !__queuedNoteOffs.empty() ) {
-		pNote =  __queuedNoteOffs[0];
-		MidiOutput* pMidiOut = Hydrogen::get_instance()->getMidiOutput();
-		
+	MidiOutput* pMidiOut = Hydrogen::get_instance()->getMidiOutput();
+	for ( Note* pNote : __queuedNoteOffs ) {
 		if( pMidiOut != nullptr && !pNote->get_instrument()->is_muted() ){
 			pMidiOut->handleQueueNoteOff( pNote->get_instrument()->get_midi_out_channel(), pNote->get_midi_key(),  pNote->get_midi_velocity() );
 		}
-		
-		__queuedNoteOffs.erase( __queuedNoteOffs.begin() );
-		
-		if( pNote != nullptr ){
-			delete pNote;
-		}
-		
-		pNote = nullptr;
-	}//while
+		NotePool::get_instance()->release( pNote );
+	}
+	__queuedNoteOffs.clear();
 
 	processPlaybackTrack(nFrames);
+
+	if ( m_pStreams != nullptr ) {
+		m_pStreams->collect();
+	}
+	if ( m_pVariants != nullptr ) {
+		// the copies made for another driver rate are dropped, and
+		// made again as soon as they are asked for
+		m_pVariants->collect( audio_output->getSampleRate() );
+	}
+}
+
+int Sampler::get_playing_notes_number() const
+{
+	return m_pPlayingNotes->size();
+}
+
+int Sampler::get_max_notes() const
+{
+	return std::min( ( int )Preferences::get_instance()->m_nMaxNotes, m_pPlayingNotes->capacity() );
+}
+
+void Sampler::steal_note( Instrument* pInstr )
+{
+	int nSlot = -1;
+	switch ( Preferences::get_instance()->m_nVoiceStealing ) {
+	case Preferences::VOICE_STEALING_SAME_INSTRUMENT:
+		if ( pInstr != nullptr ) {
+			nSlot = m_pPlayingNotes->first( SamplerVoices::INSTRUMENT, SamplerVoices::key( pInstr ) );
+		}
+		break;
+	case Preferences::VOICE_STEALING_QUIETEST: {
+		// only scanned once all the slots allowed are used
+		float fQuietest = 0.0f;
+		for ( int n = 0; n < m_pPlayingNotes->size(); ++n ) {
+			Note* pNote = m_pPlayingNotes->get( n );
+			float fLevel = pNote->get_velocity() * pNote->get_adsr()->get_level();
+			if ( nSlot == -1 || fLevel < fQuietest ) {
+				nSlot = n;
+				fQuietest = fLevel;
+			}
+		}
+		break;
+	}
+	default:
+		break;
+	}
+	if ( nSlot == -1 ) {
+		nSlot = m_pPlayingNotes->first( SamplerVoices::AGE, 0 );
+	}
+	if ( nSlot == -1 ) {
+		return;
+	}
+
+	Note *pOldNote = m_pPlayingNotes->get( nSlot );
+	m_pPlayingNotes->remove( nSlot );
+	pOldNote->get_instrument()->dequeue();
+	NotePool::get_instance()->release( pOldNote );	// FIXME: send note-off instead of removing the note from the list?
+}
+
+int Sampler::get_stream_underruns() const
+{
+	return m_pStreams != nullptr ? m_pStreams->get_underruns() : 0;
+}
+
+int Sampler::get_active_streams() const
+{
+	return m_pStreams != nullptr ? m_pStreams->get_active() : 0;
+}
+
+int Sampler::get_resampled_variants() const
+{
+	return m_pVariants != nullptr ? m_pVariants->get_ready() : 0;
+}
+
+int Sampler::prepare_stream( int nStream, const void* pOwner, Sample* pSample, int nFrame )
+{
+	if ( m_pStreams == nullptr || !pSample->is_streamed() ) {
+		return -1;
+	}
+	// the head is played from memory, the stream starts early
+	// enough to take over before its end
+	nFrame = std::max( nFrame, pSample->get_head_frames() - SamplerStreams::WINDOW_FRAMES );
+	if ( m_pStreams->use( nStream, pOwner, pSample, nFrame ) ) {
+		return nStream;
+	}
+	m_pStreams->close( nStream, pOwner );
+	return m_pStreams->open( pOwner, pSample, nFrame );
+}
+
+struct Sampler::SampleBlock {
+	const void* pData_L;		///< left channel
+	const void* pData_R;		///< right channel, equal to #pData_L if mono
+	SampleData::Format format;	///< storage of the frames
+	int nBase;					///< frame of the sample at index 0 of the data
+};
+
+bool Sampler::get_sample_data( Sample* pSample, int nStream, int nFirst, int nLast, SampleBlock* pBlock )
+{
+	if ( nLast <= pSample->get_head_frames() ) {
+		pBlock->pData_L = pSample->get_raw_data_l();
+		pBlock->pData_R = pSample->get_raw_data_r();
+		pBlock->format = pSample->get_format();
+		pBlock->nBase = 0;
+		return true;
+	}
+	if ( m_pStreams == nullptr ) {
+		return false;
+	}
+	// the stream windows are always float
+	const float* pData_L;
+	const float* pData_R;
+	// Both PENDING and MISSED are counted as underruns and played
+	// silent. A MISSED stream, left behind the voice or never
+	// claimed, is reopened by prepare_stream() for the next block,
+	// the file is never read from here.
+	if ( m_pStreams->window( nStream, nFirst, nLast, &pData_L, &pData_R ) != SamplerStreams::READY ) {
+		return false;
+	}
+	pBlock->pData_L = pData_L;
+	pBlock->pData_R = pData_R;
+	pBlock->format = SampleData::FLOAT;
+	pBlock->nBase = nFirst;
+	return true;
+}
+
+void Sampler::read_block( const SampleBlock& block, int nFirst, int nFrames, float* pBuffer_L, float* pBuffer_R,
+						  const float** ppData_L, const float** ppData_R )
+{
+	int nOffset = nFirst - block.nBase;
+	if ( block.format == SampleData::FLOAT ) {
+		*ppData_L = static_cast<const float*>( block.pData_L ) + nOffset;
+		*ppData_R = static_cast<const float*>( block.pData_R ) + nOffset;
+		return;
+	}
+	SampleData::read_channel( block.format, block.pData_L, nOffset, nFrames, pBuffer_L );
+	*ppData_L = pBuffer_L;
+	if ( block.pData_R == block.pData_L ) {
+		*ppData_R = pBuffer_L;
+	} else {
+		SampleData::read_channel( block.format, block.pData_R, nOffset, nFrames, pBuffer_R );
+		*ppData_R = pBuffer_R;
+	}
+}
+
+
+
+float Sampler::compute_step( float fPitch, int nSampleRate, int nDriverRate )
+{
+	//	constant^12 = 2, so constant = 2^(1/12) = 1.059463.
+	float fStep = pow( 1.0594630943593, ( double )fPitch );
+	fStep *= ( float )nSampleRate / nDriverRate; // Adjust for audio driver sample rate
+	return fStep;
+}
+
+const SampleData* Sampler::prepare_variant( SelectedLayerInfo* pSelectedLayer, Sample* pSample, float fPitch, int nDriverRate )
+{
+	// only the data shared through the SampleCache is immutable
+	if ( m_pVariants == nullptr || !pSample->is_shared() || pSample->is_streamed() ) {
+		pSelectedLayer->VariantID = -1;
+		return nullptr;
+	}
+	const std::shared_ptr<SampleData>& pSource = pSample->get_shared_data();
+	float fStep = compute_step( fPitch, pSample->get_sample_rate(), nDriverRate );
+	if ( pSelectedLayer->VariantID < 0 ) {
+		// a note switches to a copy only when it starts
+		if ( pSelectedLayer->SamplePosition != 0 ) {
+			return nullptr;
+		}
+		pSelectedLayer->VariantID = m_pVariants->find( pSource, fStep, nDriverRate, fPitch != 0.0 );
+		pSelectedLayer->VariantPosition = 0;
+	}
+	const SampleData* pVariant = m_pVariants->use( pSelectedLayer->VariantID, pSource.get(), fStep, nDriverRate );
+	if ( pVariant == nullptr ) {
+		// the copy is gone, the note goes on from the same position
+		pSelectedLayer->VariantID = -1;
+	}
+	return pVariant;
 }
 
+/**
+ * Resamples \a nFrames frames of a channel into \a pOut with a
+ * windowed sinc, cutting off at the lower of both rates.
+ */
+template < typename Reader >
+static void resample_sinc( const Reader& data, int nSampleFrames, float fStep, float* pOut, int nFrames )
+{
+	double fCutoff = std::min( 1.0, 1.0 / fStep );
+	int nTaps = ( int )ceil( SAMPLER_SINC_TAPS / fCutoff );
+	double fSamplePos = 0;
+	for ( int i = 0; i < nFrames; ++i ) {
+		int nSamplePos = ( int )fSamplePos;
+		double fDiff = fSamplePos - nSamplePos;
+		double fVal = 0.0;
+		for ( int k = 1 - nTaps; k <= nTaps; ++k ) {
+			int nPos = nSamplePos + k;
+			if ( nPos < 0 || nPos >= nSampleFrames ) {
+				continue;
+			}
+			double x = k - fDiff;
+			// Blackman window over [-nTaps, nTaps]
+			double fWindow = 0.42 + 0.5 * cos( M_PI * x / nTaps ) + 0.08 * cos( 2 * M_PI * x / nTaps );
+			double fArg = M_PI * fCutoff * x;
+			double fSinc = fArg == 0.0 ? 1.0 : sin( fArg ) / fArg;
+			fVal += data[ nPos ] * fCutoff * fSinc * fWindow;
+		}
+		pOut[ i ] = fVal;
+		fSamplePos += fStep;
+	}
+}
 
+std::shared_ptr<SampleData> Sampler::build_variant( void* pContext, const SampleData& source, float fStep, int nSampleRate )
+{
+	Sampler* pSampler = static_cast<Sampler*>( pContext );
+	int nFrames = ( int )( source.frames / fStep );
+	if ( nFrames <= 0 ) {
+		return nullptr;
+	}
+	std::shared_ptr<SampleData> pVariant = std::make_shared<SampleData>( nFrames, nSampleRate, source.channels );
+
+	SampleBlock block;
+	block.format = source.format;
+	block.pData_L = source.format == SampleData::FLOAT ? ( const void* )source.data_l : source.pcm_l;
+	block.pData_R = source.format == SampleData::FLOAT ? ( const void* )source.data_r : source.pcm_r;
+	block.nBase = 0;
+
+	// a mono copy is resampled once
+	const void* channels[] = { block.pData_L, block.pData_R };
+	float* outputs[] = { pVariant->data_l, pVariant->data_r };
+	for ( int nChannel = 0; nChannel < source.channels; ++nChannel ) {
+		if ( !Preferences::get_instance()->m_bBandLimitedVariants ) {
+			// the interpolation the voices would use
+			pSampler->resample_channel( block, channels[ nChannel ], source.frames, 0.0, fStep,
+										outputs[ nChannel ], nFrames );
+		} else if ( source.format == SampleData::INT16 ) {
+			resample_sinc( SampleData::Int16Reader{ static_cast<const int16_t*>( channels[ nChannel ] ) },
+						   source.frames, fStep, outputs[ nChannel ], nFrames );
+		} else if ( source.format == SampleData::INT24 ) {
+			resample_sinc( SampleData::Int24Reader{ static_cast<const uint8_t*>( channels[ nChannel ] ) },
+						   source.frames, fStep, outputs[ nChannel ], nFrames );
+		} else {
+			resample_sinc( SampleData::FloatReader{ static_cast<const float*>( channels[ nChannel ] ) },
+						   source.frames, fStep, outputs[ nChannel ], nFrames );
+		}
+	}
+	return pVariant;
+}
 
 void Sampler::note_on( Note *note )
 {
@@ -187,8 +531,9 @@ void Sampler::note_on( Note *note )
 	int mute_grp = pInstr->get_mute_group();
 	if ( mute_grp != -1 ) {
 		// remove all notes using the same mute group
-		for ( unsigned j = 0; j < __playing_notes_queue.size(); j++ ) {	// delete older note
-			Note *pNote = __playing_notes_queue[ j ];
+		for ( int j = m_pPlayingNotes->first( SamplerVoices::MUTE_GROUP, mute_grp ); j != -1;
+			  j = m_pPlayingNotes->next( SamplerVoices::MUTE_GROUP, j ) ) {	// delete older note
+			Note *pNote = m_pPlayingNotes->get( j );
 			if ( ( pNote->get_instrument() != pInstr )  && ( pNote->get_instrument()->get_mute_group() == mute_grp ) ) {
 				pNote->get_adsr()->release();
 			}
@@ -197,30 +542,27 @@ void Sampler::note_on( Note *note )
 
 	//note off notes
 	if( note->get_note_off() ){
-		for ( unsigned j = 0; j < __playing_notes_queue.size(); j++ ) {
-			Note *pNote = __playing_notes_queue[ j ];
-
-			if ( ( pNote->get_instrument() == pInstr ) ) {
-				//ERRORLOG("note_off");
-				pNote->get_adsr()->release();
-			}
+		for ( int j = m_pPlayingNotes->first( SamplerVoices::INSTRUMENT, SamplerVoices::key( pInstr ) ); j != -1;
+			  j = m_pPlayingNotes->next( SamplerVoices::INSTRUMENT, j ) ) {
+			//ERRORLOG("note_off");
+			m_pPlayingNotes->get( j )->get_adsr()->release();
 		}
 	}
 
 	pInstr->enqueue();
 	if( !note->get_note_off() ){
-		__playing_notes_queue.push_back( note );
+		if ( m_pPlayingNotes->size() >= get_max_notes() ) {
+			steal_note( pInstr );
+		}
+		m_pPlayingNotes->add( note );
 	}
 }
 
 void Sampler::midi_keyboard_note_off( int key )
 {
-	for ( unsigned j = 0; j < __playing_notes_queue.size(); j++ ) {
-		Note *pNote = __playing_notes_queue[ j ];
-
-		if ( ( pNote->get_midi_msg() == key) ) {
-			pNote->get_adsr()->release();
-		}
+	for ( int j = m_pPlayingNotes->first( SamplerVoices::MIDI_KEY, key ); j != -1;
+		  j = m_pPlayingNotes->next( SamplerVoices::MIDI_KEY, j ) ) {
+		m_pPlayingNotes->get( j )->get_adsr()->release();
 	}
 }
 
@@ -235,20 +577,18 @@ void Sampler::note_off( Note* note )
 
 	Instrument *pInstr = note->get_instrument();
 	// find the notes using the same instrument, and release them
-	for ( unsigned j = 0; j < __playing_notes_queue.size(); j++ ) {
-		Note *pNote = __playing_notes_queue[ j ];
-		if ( pNote->get_instrument() == pInstr ) {
-			pNote->get_adsr()->release();
-		}
+	for ( int j = m_pPlayingNotes->first( SamplerVoices::INSTRUMENT, SamplerVoices::key( pInstr ) ); j != -1;
+		  j = m_pPlayingNotes->next( SamplerVoices::INSTRUMENT, j ) ) {
+		m_pPlayingNotes->get( j )->get_adsr()->release();
 	}
-	delete note;
+	NotePool::get_instance()->release( note );
 }
 
 
-/// Render a note
-/// Return false: the note is not ended
-/// Return true: the note is ended
-bool Sampler::__render_note( Note* pNote, unsigned nBufferSize, Song* pSong )
+/// Prepare the voices of a note
+/// Its entry of m_noteResults tells whether the note is ended once
+/// the voices have been rendered
+void Sampler::__prepare_note( Note* pNote, unsigned nBufferSize, Song* pSong )
 {
 	//infoLog( "[renderNote] instr: " + pNote->getInstrument()->m_sName );
 	assert( pSong );
@@ -263,18 +603,25 @@ bool Sampler::__render_note( Note* pNote, unsigned nBufferSize, Song* pSong )
 		nFramepos = pEngine->getRealtimeFrames();
 	}
 
+	VoiceJob result;
+	result.nFirst = m_renderResults.size();
+	result.nCount = 0;
+
 	Instrument *pInstr = pNote->get_instrument();
 	if ( !pInstr ) {
 		ERRORLOG( "NULL instrument" );
-		return 1;
+		m_noteResults.push_back( result );
+		return;
 	}
 
-	bool nReturnValues [pInstr->get_components()->size()];
-	
-	for(int i = 0; i < pInstr->get_components()->size(); i++){
-		nReturnValues[i] = false;
-	}
-	
+	result.nCount = pInstr->get_components()->size();
+	m_noteResults.push_back( result );
+	m_renderResults.resize( result.nFirst + result.nCount, false );
+	char* nReturnValues = m_renderResults.data() + result.nFirst;
+
+	VoiceJob job;
+	job.nFirst = m_voices.size();
+
 	int nReturnValueIndex = 0;
 	int nAlreadySelectedLayer = -1;
 
@@ -338,7 +685,7 @@ bool Sampler::__render_note( Note* pNote, unsigned nBufferSize, Song* pSong )
 					}
 
 					if ( !pSample ){
-						WARNINGLOG( "Velocity did fall into a hole between the instrument layers." );
+						WARNINGLOG_FMT( "Velocity did fall into a hole between the instrument layers." );
 						// There are a small distance between the
 						// layers of the instruments the velocity of
 						// the pNote has fallen into. This can if the
@@ -407,7 +754,7 @@ bool Sampler::__render_note( Note* pNote, unsigned nBufferSize, Song* pSong )
 						// for the nearest sample and play this
 						// one instead.
 						if ( __foundSamples == 0 ){
-							WARNINGLOG( "Velocity did fall into a hole between the instrument layers." );
+							WARNINGLOG_FMT( "Velocity did fall into a hole between the instrument layers." );
 							float shortestDistance = 1.0f;
 							int nearestLayer = -1;
 							for ( unsigned nLayer = 0; nLayer < m_nMaxLayers; ++nLayer ){
@@ -487,7 +834,7 @@ bool Sampler::__render_note( Note* pNote, unsigned nBufferSize, Song* pSong )
 						// for the nearest sample and play this
 						// one instead.
 						if ( __foundSamples == 0 ){
-							WARNINGLOG( "Velocity did fall into a hole between the instrument layers." );
+							WARNINGLOG_FMT( "Velocity did fall into a hole between the instrument layers." );
 							float shortestDistance = 1.0f;
 							int nearestLayer = -1;
 							for ( unsigned nLayer = 0; nLayer < m_nMaxLayers; ++nLayer ){
@@ -548,7 +895,7 @@ bool Sampler::__render_note( Note* pNote, unsigned nBufferSize, Song* pSong )
 		}
 
 		if ( pSelectedLayer->SamplePosition >= pSample->get_frames() ) {
-			WARNINGLOG( "sample position out of bounds. The layer has been resized during note play?" );
+			WARNINGLOG_FMT( "sample position out of bounds. The layer has been resized during note play?" );
 			nReturnValues[nReturnValueIndex] = true;
 			continue;
 		}
@@ -563,7 +910,7 @@ bool Sampler::__render_note( Note* pNote, unsigned nBufferSize, Song* pSong )
 				int noteStartInFramesNoHumanize = ( int )pNote->get_position() * audio_output->m_transport.m_nTickSize;
 				if ( noteStartInFramesNoHumanize > ( int )( nFramepos + nBufferSize ) ) {
 					// this note is not valid. it's in the future...let's skip it....
-					ERRORLOG( QString( "Note pos in the future?? Current frames: %1, note frame pos: %2" ).arg( nFramepos ).arg(noteStartInFramesNoHumanize ) );
+					ERRORLOG_FMT( "Note pos in the future?? Current frames: %1, note frame pos: %2", nFramepos, noteStartInFramesNoHumanize );
 					//pNote->dumpInfo();
 					nReturnValues[nReturnValueIndex] = true;
 					continue;
@@ -660,16 +1007,132 @@ bool Sampler::__render_note( Note* pNote, unsigned nBufferSize, Song* pSong )
 			}
 		}
 
-		if ( fTotalPitch == 0.0 && pSample->get_sample_rate() == audio_output->getSampleRate() ) // NO RESAMPLE
-			nReturnValues[nReturnValueIndex] = __render_note_no_resample( pSample, pNote, pSelectedLayer, pCompo, pMainCompo, nBufferSize, nInitialSilence, cost_L, cost_R, cost_track_L, cost_track_R, pSong );
-		else // RESAMPLE
-			nReturnValues[nReturnValueIndex] = __render_note_resample( pSample, pNote, pSelectedLayer, pCompo, pMainCompo, nBufferSize, nInitialSilence, cost_L, cost_R, cost_track_L, cost_track_R, fLayerPitch, pSong );
+		// the disk stream of a long sample is filled while its head is played
+		pSelectedLayer->StreamID = prepare_stream( pSelectedLayer->StreamID, pSelectedLayer, pSample,
+												   ( int )pSelectedLayer->SamplePosition - 1 );
+
+		Voice voice;
+		voice.pNote = pNote;
+		voice.pSample = pSample;
+		voice.pSelectedLayerInfo = pSelectedLayer;
+		voice.pCompo = pCompo;
+		voice.pDrumCompo = pMainCompo;
+		voice.nInitialSilence = nInitialSilence;
+		voice.cost_L = cost_L;
+		voice.cost_R = cost_R;
+		voice.cost_track_L = cost_track_L;
+		voice.cost_track_R = cost_track_R;
+		voice.fLayerPitch = fLayerPitch;
+		voice.bResample = !( fTotalPitch == 0.0 && pSample->get_sample_rate() == audio_output->getSampleRate() ); // RESAMPLE
+		// a copy resampled in the background is played as it is
+		voice.pVariant = voice.bResample
+			? prepare_variant( pSelectedLayer, pSample, fTotalPitch, audio_output->getSampleRate() )
+			: nullptr;
+		voice.nResult = result.nFirst + nReturnValueIndex;
+		if ( m_pSlotBuffers != nullptr ) {
+			float* pSlot = m_pSlotBuffers + m_voices.size() * 4 * MAX_BUFFER_SIZE;
+			voice.pVoice_L = pSlot;
+			voice.pVoice_R = pSlot + MAX_BUFFER_SIZE;
+			voice.pRaw_L = pSlot + 2 * MAX_BUFFER_SIZE;
+			voice.pRaw_R = pSlot + 3 * MAX_BUFFER_SIZE;
+		} else {
+			voice.pVoice_L = m_pVoiceBuffer_L;
+			voice.pVoice_R = m_pVoiceBuffer_R;
+			voice.pRaw_L = m_pRawBuffer_L;
+			voice.pRaw_R = m_pRawBuffer_R;
+		}
+		voice.nFrames = 0;
+		voice.pSend_L = nullptr;
+		voice.pSend_R = nullptr;
+		voice.bEnded = true;
+		m_voices.push_back( voice );
 
 		nReturnValueIndex++;
 	}
-	for ( unsigned i = 0 ; i < pInstr->get_components()->size() ; i++ )
-		if ( !nReturnValues[i] ) return false;
-	return true;
+
+	// the components of a note share its envelope and filter, they
+	// are rendered one after the other by the same worker
+	job.nCount = m_voices.size() - job.nFirst;
+	if ( job.nCount > 0 ) {
+		m_voiceJobs.push_back( job );
+	}
+}
+
+void Sampler::render_voices( Song* pSong )
+{
+	if ( m_voices.empty() ) {
+		return;
+	}
+
+	if ( m_pWorkers != nullptr && m_voiceJobs.size() > 1 ) {
+		m_pWorkers->run( render_job, this, m_voiceJobs.size() );
+		for ( auto& voice : m_voices ) {
+			mix_voice( voice, pSong );
+		}
+	} else {
+		for ( auto& voice : m_voices ) {
+			render_voice( voice, 0 );
+			mix_voice( voice, pSong );
+		}
+	}
+
+	for ( const auto& voice : m_voices ) {
+		m_renderResults[ voice.nResult ] = voice.bEnded;
+	}
+	m_voices.clear();
+	m_voiceJobs.clear();
+}
+
+void Sampler::render_job( void* pContext, int nJob, int nWorker )
+{
+	Sampler* pSampler = static_cast<Sampler*>( pContext );
+	const VoiceJob& job = pSampler->m_voiceJobs[ nJob ];
+	for ( int i = job.nFirst; i < job.nFirst + job.nCount; ++i ) {
+		pSampler->render_voice( pSampler->m_voices[ i ], nWorker );
+	}
+}
+
+void Sampler::render_voice( Voice& voice, int nWorker )
+{
+	if ( voice.bResample ) {
+		voice.bEnded = __render_note_resample( voice, nWorker );
+	} else {
+		voice.bEnded = __render_note_no_resample( voice, nWorker );
+	}
+}
+
+void Sampler::mix_voice( Voice& voice, Song* pSong )
+{
+	if ( voice.nFrames <= 0 ) {
+		return;
+	}
+
+	mix_voice_block( voice.pNote, voice.pCompo, voice.pDrumCompo, voice.pVoice_L, voice.pVoice_R,
+					 voice.nInitialSilence, voice.nFrames,
+					 voice.cost_L, voice.cost_R, voice.cost_track_L, voice.cost_track_R );
+
+#ifdef H2CORE_HAVE_LADSPA
+	// LADSPA
+	if ( voice.pNote->get_instrument()->is_muted() || pSong->__is_muted ) {
+		return;
+	}
+	const SamplerKernels& kernels = get_sampler_kernels();
+	float masterVol = pSong->get_volume();
+	for ( unsigned nFX = 0; nFX < MAX_FX; ++nFX ) {
+		LadspaFX *pFX = Effects::get_instance()->getLadspaFX( nFX );
+		float fLevel = voice.pNote->get_instrument()->get_fx_level( nFX );
+		if ( ( pFX ) && ( fLevel != 0.0 ) ) {
+			fLevel = fLevel * pFX->getVolume();
+
+			float fFXCost_L = fLevel * masterVol;
+			float fFXCost_R = fLevel * masterVol;
+
+			kernels.mix( pFX->m_pBuffer_L + voice.nInitialSilence, voice.pSend_L, fFXCost_L, voice.nFrames );
+			kernels.mix( pFX->m_pBuffer_R + voice.nInitialSilence, voice.pSend_R, fFXCost_R, voice.nFrames );
+		}
+	}
+	// ~LADSPA
+#endif
 }
 
 bool Sampler::processPlaybackTrack(int nBufferSize)
@@ -691,11 +1154,15 @@ bool Sampler::processPlaybackTrack(int nBufferSize)
 	float fVal_L;
 	float fVal_R;
 
-	float *pSample_data_L = pSample->get_data_l();
-	float *pSample_data_R = pSample->get_data_r();
+	const float *pSample_data_L;
+	const float *pSample_data_R;
+	SampleBlock block;
 	
-	float fInstrPeak_L = __playback_instrument->get_peak_l(); // this value will be reset to 0 by the mixer..
-	float fInstrPeak_R = __playback_instrument->get_peak_r(); // this value will be reset to 0 by the mixer..
+	// reset to 0 by audioEngine_process() once handed to the Meters
+	float fInstrPeak_L = __playback_instrument->get_peak_l();
+	float fInstrPeak_R = __playback_instrument->get_peak_r();
+	float fInstrEnergy_L = __playback_instrument->get_energy_l();
+	float fInstrEnergy_R = __playback_instrument->get_energy_r();
 
 	assert(pSample);
 
@@ -713,7 +1180,6 @@ bool Sampler::processPlaybackTrack(int nBufferSize)
 		}
 
 		int nInitialSamplePos = ( int ) __playBackSamplePosition;
-		int nSamplePos = nInitialSamplePos;
 	
 		int nTimes = nInitialBufferPos + nAvail_bytes;
 	
@@ -721,6 +1187,16 @@ bool Sampler::processPlaybackTrack(int nBufferSize)
 			//playback track has ended..
 			return true;
 		}
+
+		// a long track is streamed from disk
+		m_nPlaybackStream = prepare_stream( m_nPlaybackStream, &__playBackSamplePosition, pSample, nInitialSamplePos );
+		if ( nAvail_bytes <= 0
+			 || !get_sample_data( pSample, m_nPlaybackStream, nInitialSamplePos, nInitialSamplePos + nAvail_bytes, &block ) ) {
+			return true;
+		}
+		read_block( block, nInitialSamplePos, nAvail_bytes, m_pRawBuffer_L, m_pRawBuffer_R,
+					&pSample_data_L, &pSample_data_R );
+		int nSamplePos = 0;
 	
 		for ( int nBufferPos = nInitialBufferPos; nBufferPos < nTimes; ++nBufferPos ) {
 			fVal_L = pSample_data_L[ nSamplePos ];
@@ -732,12 +1208,14 @@ bool Sampler::processPlaybackTrack(int nBufferSize)
 			//pDrumCompo->set_outs( nBufferPos, fVal_L, fVal_R );
 	
 			// to main mix
-			if ( fVal_L > fInstrPeak_L ) {
-				fInstrPeak_L = fVal_L;
+			if ( std::fabs( fVal_L ) > fInstrPeak_L ) {
+				fInstrPeak_L = std::fabs( fVal_L );
 			}
-			if ( fVal_R > fInstrPeak_R ) {
-				fInstrPeak_R = fVal_R;
+			if ( std::fabs( fVal_R ) > fInstrPeak_R ) {
+				fInstrPeak_R = std::fabs( fVal_R );
 			}
+			fInstrEnergy_L += fVal_L * fVal_L;
+			fInstrEnergy_R += fVal_R * fVal_R;
 			
 			__main_out_L[nBufferPos] += fVal_L;
 			__main_out_R[nBufferPos] += fVal_R;
@@ -764,59 +1242,42 @@ bool Sampler::processPlaybackTrack(int nBufferSize)
 			nAvail_bytes = nBufferSize;
 		}
 
+		// a long track is streamed from disk, the positions are
+		// then relative to the first frame of the window
+		int nFirst = std::max( ( int )fSamplePos - 1, 0 );
+		int nLast = std::min( ( int )( fSamplePos + nAvail_bytes * fStep ) + 4, nSampleFrames );
+		m_nPlaybackStream = prepare_stream( m_nPlaybackStream, &__playBackSamplePosition, pSample, nFirst );
+		if ( nAvail_bytes <= 0
+			 || !get_sample_data( pSample, m_nPlaybackStream, nFirst, nLast, &block ) ) {
+			return true;
+		}
+		fSamplePos -= block.nBase;
+		nSampleFrames -= block.nBase;
+
+		// the sampler's interpolation, into the raw buffers which
+		// are not used by the voices anymore
+		resample_channel( block, block.pData_L, nSampleFrames, fSamplePos, fStep, m_pRawBuffer_L, nAvail_bytes );
+		pSample_data_L = m_pRawBuffer_L;
+		pSample_data_R = m_pRawBuffer_L;
+		if ( block.pData_R != block.pData_L ) {
+			resample_channel( block, block.pData_R, nSampleFrames, fSamplePos, fStep, m_pRawBuffer_R, nAvail_bytes );
+			pSample_data_R = m_pRawBuffer_R;
+		}
+
 		int nTimes = nInitialBufferPos + nAvail_bytes;
 	
 		for ( int nBufferPos = nInitialBufferPos; nBufferPos < nTimes; ++nBufferPos ) {
-			int nSamplePos = ( int ) fSamplePos;
-			double fDiff = fSamplePos - nSamplePos;
-			if ( ( nSamplePos + 1 ) >= nSampleFrames ) {
-				//we reach the last audioframe.
-				//set this last frame to zero do nothing wrong.
-							fVal_L = 0.0;
-							fVal_R = 0.0;
-			} else {
-				// some interpolation methods need 4 frames data.
-					float last_l;
-					float last_r;
-					if ( ( nSamplePos + 2 ) >= nSampleFrames ) {
-						last_l = 0.0;
-						last_r = 0.0;
-					} else {
-						last_l =  pSample_data_L[nSamplePos + 2];
-						last_r =  pSample_data_R[nSamplePos + 2];
-					}
-	
-					switch( __interpolateMode ){
-	
-							case LINEAR:
-									fVal_L = pSample_data_L[nSamplePos] * (1 - fDiff ) + pSample_data_L[nSamplePos + 1] * fDiff;
-									fVal_R = pSample_data_R[nSamplePos] * (1 - fDiff ) + pSample_data_R[nSamplePos + 1] * fDiff;
-									break;
-							case COSINE:
-									fVal_L = cosine_Interpolate( pSample_data_L[nSamplePos], pSample_data_L[nSamplePos + 1], fDiff);
-									fVal_R = cosine_Interpolate( pSample_data_R[nSamplePos], pSample_data_R[nSamplePos + 1], fDiff);
-									break;
-							case THIRD:
-									fVal_L = third_Interpolate( pSample_data_L[ nSamplePos -1], pSample_data_L[nSamplePos], pSample_data_L[nSamplePos + 1], last_l, fDiff);
-									fVal_R = third_Interpolate( pSample_data_R[ nSamplePos -1], pSample_data_R[nSamplePos], pSample_data_R[nSamplePos + 1], last_r, fDiff);
-									break;
-							case CUBIC:
-									fVal_L = cubic_Interpolate( pSample_data_L[ nSamplePos -1], pSample_data_L[nSamplePos], pSample_data_L[nSamplePos + 1], last_l, fDiff);
-									fVal_R = cubic_Interpolate( pSample_data_R[ nSamplePos -1], pSample_data_R[nSamplePos], pSample_data_R[nSamplePos + 1], last_r, fDiff);
-									break;
-							case HERMITE:
-									fVal_L = hermite_Interpolate( pSample_data_L[ nSamplePos -1], pSample_data_L[nSamplePos], pSample_data_L[nSamplePos + 1], last_l, fDiff);
-									fVal_R = hermite_Interpolate( pSample_data_R[ nSamplePos -1], pSample_data_R[nSamplePos], pSample_data_R[nSamplePos + 1], last_r, fDiff);
-									break;
-					}
-			}
+			fVal_L = pSample_data_L[ nBufferPos - nInitialBufferPos ];
+			fVal_R = pSample_data_R[ nBufferPos - nInitialBufferPos ];
 			
-			if ( fVal_L > fInstrPeak_L ) {
-				fInstrPeak_L = fVal_L;
+			if ( std::fabs( fVal_L ) > fInstrPeak_L ) {
+				fInstrPeak_L = std::fabs( fVal_L );
 			}
-			if ( fVal_R > fInstrPeak_R ) {
-				fInstrPeak_R = fVal_R;
+			if ( std::fabs( fVal_R ) > fInstrPeak_R ) {
+				fInstrPeak_R = std::fabs( fVal_R );
 			}
+			fInstrEnergy_L += fVal_L * fVal_L;
+			fInstrEnergy_R += fVal_R * fVal_R;
 
 			__main_out_L[nBufferPos] += fVal_L;
 			__main_out_R[nBufferPos] += fVal_R;
@@ -828,26 +1289,71 @@ bool Sampler::processPlaybackTrack(int nBufferSize)
 	
 	__playback_instrument->set_peak_l( fInstrPeak_L );
 	__playback_instrument->set_peak_r( fInstrPeak_R );
+	__playback_instrument->set_energy_l( fInstrEnergy_L );
+	__playback_instrument->set_energy_r( fInstrEnergy_R );
 
 	return true;
 }
 
-bool Sampler::__render_note_no_resample(
-	Sample *pSample,
+void Sampler::mix_voice_block(
 	Note *pNote,
-	SelectedLayerInfo *pSelectedLayerInfo,
 	InstrumentComponent *pCompo,
 	DrumkitComponent *pDrumCompo,
-	int nBufferSize,
-	int nInitialSilence,
+	const float *pVoice_L,
+	const float *pVoice_R,
+	int nBufferPos,
+	int nFrames,
 	float cost_L,
 	float cost_R,
 	float cost_track_L,
-	float cost_track_R,
-	Song* pSong
+	float cost_track_R
 )
 {
+	const SamplerKernels& kernels = get_sampler_kernels();
+
 	AudioOutput* pAudioOutput = Hydrogen::get_instance()->getAudioOutput();
+	if ( pAudioOutput->has_track_outs() ) {
+		// The stems of an export hold the part of the main mix
+		// played by the instrument, the JACK track outputs follow
+		// Preferences::m_nJackTrackOutputMode.
+		if ( m_bTrackOutsMainMix ) {
+			cost_track_L = cost_L;
+			cost_track_R = cost_R;
+		}
+		float *pTrackOutL = pAudioOutput->getTrackOut_L( pNote->get_instrument(), pCompo );
+		float *pTrackOutR = pAudioOutput->getTrackOut_R( pNote->get_instrument(), pCompo );
+		if ( pTrackOutL ) {
+			kernels.mix( pTrackOutL + nBufferPos, pVoice_L, cost_track_L, nFrames );
+		}
+		if ( pTrackOutR ) {
+			kernels.mix( pTrackOutR + nBufferPos, pVoice_R, cost_track_R, nFrames );
+		}
+	}
+
+	Instrument* pInstr = pNote->get_instrument();
+	// the instrument levels are reset to 0 by audioEngine_process()
+	// once handed to the Meters
+	float fInstrEnergy_L = pInstr->get_energy_l();
+	float fInstrEnergy_R = pInstr->get_energy_r();
+	float fInstrPeak_L = kernels.mix_peak( __main_out_L + nBufferPos, pDrumCompo->get_out_L_buffer() + nBufferPos,
+										   pVoice_L, cost_L, pInstr->get_peak_l(), &fInstrEnergy_L, nFrames );
+	float fInstrPeak_R = kernels.mix_peak( __main_out_R + nBufferPos, pDrumCompo->get_out_R_buffer() + nBufferPos,
+										   pVoice_R, cost_R, pInstr->get_peak_r(), &fInstrEnergy_R, nFrames );
+	pInstr->set_peak_l( fInstrPeak_L );
+	pInstr->set_peak_r( fInstrPeak_R );
+	pInstr->set_energy_l( fInstrEnergy_L );
+	pInstr->set_energy_r( fInstrEnergy_R );
+}
+
+bool Sampler::__render_note_no_resample( Voice& voice, int nWorker )
+{
+	AudioOutput* pAudioOutput = Hydrogen::get_instance()->getAudioOutput();
+	const SamplerKernels& kernels = get_sampler_kernels();
+	float* pEnvelope = m_envelopeBuffers[ nWorker ];
+	Note *pNote = voice.pNote;
+	SelectedLayerInfo *pSelectedLayerInfo = voice.pSelectedLayerInfo;
+	int nBufferSize = m_nRenderFrames;
+	int nInitialSilence = voice.nInitialSilence;
 	bool retValue = true; // the note is ended
 
 	int nNoteLength = -1;
@@ -855,7 +1361,7 @@ bool Sampler::__render_note_no_resample(
 		nNoteLength = ( int )( pNote->get_length() * pAudioOutput->m_transport.m_nTickSize );
 	}
 
-	int nAvail_bytes = pSample->get_frames() - ( int )pSelectedLayerInfo->SamplePosition;	// verifico il numero di frame disponibili ancora da eseguire
+	int nAvail_bytes = voice.pSample->get_frames() - ( int )pSelectedLayerInfo->SamplePosition;	// verifico il numero di frame disponibili ancora da eseguire
 
 	if ( nAvail_bytes > nBufferSize - nInitialSilence ) {	// il sample e' piu' grande del buffersize
 		// imposto il numero dei bytes disponibili uguale al buffersize
@@ -863,156 +1369,186 @@ bool Sampler::__render_note_no_resample(
 		retValue = false; // the note is not ended yet
 	}
 
+	if ( nAvail_bytes <= 0 ) {
+		return retValue;
+	}
 
-	//ADSR *pADSR = pNote->m_pADSR;
-
-	int nInitialBufferPos = nInitialSilence;
 	int nInitialSamplePos = ( int )pSelectedLayerInfo->SamplePosition;
-	int nSamplePos = nInitialSamplePos;
-	int nTimes = nInitialBufferPos + nAvail_bytes;
-
-	float *pSample_data_L = pSample->get_data_l();
-	float *pSample_data_R = pSample->get_data_r();
-
-	float fInstrPeak_L = pNote->get_instrument()->get_peak_l(); // this value will be reset to 0 by the mixer..
-	float fInstrPeak_R = pNote->get_instrument()->get_peak_r(); // this value will be reset to 0 by the mixer..
-
-	float fADSRValue;
-	float fVal_L;
-	float fVal_R;
-
-
-#ifdef H2CORE_HAVE_JACK
-	JackAudioDriver* pJackAudioDriver = nullptr;
-	float *		pTrackOutL = nullptr;
-	float *		pTrackOutR = nullptr;
 
-	if( pAudioOutput->has_track_outs()
-	&& (pJackAudioDriver = dynamic_cast<JackAudioDriver*>(pAudioOutput)) ) {
-		 pTrackOutL = pJackAudioDriver->getTrackOut_L( pNote->get_instrument(), pCompo );
-		pTrackOutR = pJackAudioDriver->getTrackOut_R( pNote->get_instrument(), pCompo );
+	const float *pSample_data_L;
+	const float *pSample_data_R;
+	SampleBlock block;
+	if ( get_sample_data( voice.pSample, pSelectedLayerInfo->StreamID, nInitialSamplePos, nInitialSamplePos + nAvail_bytes,
+						  &block ) ) {
+		// frames kept as integers are converted into the raw buffers
+		read_block( block, nInitialSamplePos, nAvail_bytes, voice.pRaw_L, voice.pRaw_R,
+					&pSample_data_L, &pSample_data_R );
+	} else {
+		// the disk stream is late, the block is played silent
+		memset( voice.pRaw_L, 0, nAvail_bytes * sizeof( float ) );
+		memset( voice.pRaw_R, 0, nAvail_bytes * sizeof( float ) );
+		pSample_data_L = voice.pRaw_L;
+		pSample_data_R = voice.pRaw_R;
 	}
-#endif
-
-	for ( int nBufferPos = nInitialBufferPos; nBufferPos < nTimes; ++nBufferPos ) {
-		if ( ( nNoteLength != -1 ) && ( nNoteLength <= pSelectedLayerInfo->SamplePosition ) ) {
-						if ( pNote->get_adsr()->release() == 0 ) {
-				retValue = true;	// the note is ended
-			}
-		}
 
-		fADSRValue = pNote->get_adsr()->get_value( 1 );
-		fVal_L = pSample_data_L[ nSamplePos ] * fADSRValue;
-		fVal_R = pSample_data_R[ nSamplePos ] * fADSRValue;
-
-		// Low pass resonant filter
-		if ( pNote->get_instrument()->is_filter_active() ) {
-			pNote->compute_lr_values( &fVal_L, &fVal_R );
-		}
-
-#ifdef H2CORE_HAVE_JACK
-		if(  pTrackOutL ) {
-			 pTrackOutL[nBufferPos] += fVal_L * cost_track_L;
-		}
-		if( pTrackOutR ) {
-			pTrackOutR[nBufferPos] += fVal_R * cost_track_R;
-		}
-#endif
-
-		fVal_L = fVal_L * cost_L;
-		fVal_R = fVal_R * cost_R;
-
-		// update instr peak
-		if ( fVal_L > fInstrPeak_L ) {
-			fInstrPeak_L = fVal_L;
-		}
-		if ( fVal_R > fInstrPeak_R ) {
-			fInstrPeak_R = fVal_R;
-		}
+	// The sample position does not move while the block is rendered,
+	// so the release condition holds for the whole block or not at all.
+	ADSR* pADSR = pNote->get_adsr();
+	bool bRelease = ( nNoteLength != -1 ) && ( nNoteLength <= pSelectedLayerInfo->SamplePosition );
+	if ( bRelease ) {
+		pADSR->release();
+	}
 
-		pDrumCompo->set_outs( nBufferPos, fVal_L, fVal_R );
+	// ADSR envelope
+	pADSR->get_values( pEnvelope, nAvail_bytes, 1 );
+	kernels.mul( voice.pVoice_L, pSample_data_L, pEnvelope, nAvail_bytes );
+	kernels.mul( voice.pVoice_R, pSample_data_R, pEnvelope, nAvail_bytes );
 
-		// to main mix
-		__main_out_L[nBufferPos] += fVal_L;
-		__main_out_R[nBufferPos] += fVal_R;
+	if ( bRelease && pADSR->release() == 0 ) {
+		retValue = true;	// the note is ended
+	}
 
-		++nSamplePos;
+	// Low pass resonant filter
+	if ( pNote->get_instrument()->is_filter_active() ) {
+		pNote->compute_lr_values( voice.pVoice_L, voice.pVoice_R, nAvail_bytes );
 	}
-	pSelectedLayerInfo->SamplePosition += nAvail_bytes;
-	pNote->get_instrument()->set_peak_l( fInstrPeak_L );
-	pNote->get_instrument()->set_peak_r( fInstrPeak_R );
 
+	pSelectedLayerInfo->SamplePosition += nAvail_bytes;
 
-#ifdef H2CORE_HAVE_LADSPA
-	// LADSPA
-	// change the below return logic if you add code after that ifdef
-	if (pNote->get_instrument()->is_muted() || pSong->__is_muted) return retValue;
-	float masterVol =  pSong->get_volume();
-	for ( unsigned nFX = 0; nFX < MAX_FX; ++nFX ) {
-		LadspaFX *pFX = Effects::get_instance()->getLadspaFX( nFX );
+	// the FX sends use the sample data without envelope and filter.
+	// It belongs to the voice until the mix: its raw buffers, the
+	// sample, or the window of its own stream, which only moves on
+	// at its next block.
+	voice.nFrames = nAvail_bytes;
+	voice.pSend_L = pSample_data_L;
+	voice.pSend_R = pSample_data_R;
 
-		float fLevel = pNote->get_instrument()->get_fx_level( nFX );
+	return retValue;
+}
 
-		if ( ( pFX ) && ( fLevel != 0.0 ) ) {
-			fLevel = fLevel * pFX->getVolume();
-			float *pBuf_L = pFX->m_pBuffer_L;
-			float *pBuf_R = pFX->m_pBuffer_R;
 
-			float fFXCost_L = fLevel * masterVol;
-			float fFXCost_R = fLevel * masterVol;
+template < Sampler::InterpolateMode mode, typename Reader >
+void Sampler::resample_block( const Reader& data, int nSampleFrames,
+							  double fSamplePos, float fStep,
+							  float* pOut, int nFrames )
+{
+	for ( int i = 0; i < nFrames; ++i ) {
+		int nSamplePos = ( int )fSamplePos;
+		double fDiff = fSamplePos - nSamplePos;
+		float fVal;
+		if ( ( nSamplePos + 1 ) >= nSampleFrames ) {
+			//we reach the last audioframe.
+			//set this last frame to zero do nothing wrong.
+			fVal = 0.0;
+		} else {
+			// some interpolation methods need 4 frames data.
+			float first = 0.0;
+			float last = 0.0;
+			if ( nSamplePos > 0 ) {
+				first = data[nSamplePos - 1];
+			}
+			if ( ( nSamplePos + 2 ) < nSampleFrames ) {
+				last = data[nSamplePos + 2];
+			}
 
-			int nBufferPos = nInitialBufferPos;
-			int nSamplePos = nInitialSamplePos;
-			for ( int i = 0; i < nAvail_bytes; ++i ) {
-				pBuf_L[ nBufferPos ] += pSample_data_L[ nSamplePos ] * fFXCost_L;
-				pBuf_R[ nBufferPos ] += pSample_data_R[ nSamplePos ] * fFXCost_R;
-				++nSamplePos;
-				++nBufferPos;
+			switch( mode ){
+
+			case LINEAR:
+				fVal = data[nSamplePos] * (1 - fDiff ) + data[nSamplePos + 1] * fDiff;
+				break;
+			case COSINE:
+				fVal = cosine_Interpolate( data[nSamplePos], data[nSamplePos + 1], fDiff);
+				break;
+			case THIRD:
+				fVal = third_Interpolate( first, data[nSamplePos], data[nSamplePos + 1], last, fDiff);
+				break;
+			case CUBIC:
+				fVal = cubic_Interpolate( first, data[nSamplePos], data[nSamplePos + 1], last, fDiff);
+				break;
+			case HERMITE:
+			default:
+				fVal = hermite_Interpolate( first, data[nSamplePos], data[nSamplePos + 1], last, fDiff);
+				break;
 			}
 		}
+		pOut[ i ] = fVal;
+		fSamplePos += fStep;
 	}
-	// ~LADSPA
-#endif
-
-	return retValue;
 }
 
+template < typename Reader >
+void Sampler::resample_reader( const Reader& data, int nSampleFrames, double fSamplePos, float fStep, float* pOut, int nFrames )
+{
+	switch( __interpolateMode ){
+	case LINEAR:
+		resample_block<LINEAR>( data, nSampleFrames, fSamplePos, fStep, pOut, nFrames );
+		break;
+	case COSINE:
+		resample_block<COSINE>( data, nSampleFrames, fSamplePos, fStep, pOut, nFrames );
+		break;
+	case THIRD:
+		resample_block<THIRD>( data, nSampleFrames, fSamplePos, fStep, pOut, nFrames );
+		break;
+	case CUBIC:
+		resample_block<CUBIC>( data, nSampleFrames, fSamplePos, fStep, pOut, nFrames );
+		break;
+	case HERMITE:
+		resample_block<HERMITE>( data, nSampleFrames, fSamplePos, fStep, pOut, nFrames );
+		break;
+	}
+}
 
+void Sampler::resample_channel( const SampleBlock& block, const void* pData, int nSampleFrames,
+								double fSamplePos, float fStep, float* pOut, int nFrames )
+{
+	switch ( block.format ) {
+	case SampleData::FLOAT:
+		resample_reader( SampleData::FloatReader{ static_cast<const float*>( pData ) },
+						 nSampleFrames, fSamplePos, fStep, pOut, nFrames );
+		break;
+	case SampleData::INT16:
+		resample_reader( SampleData::Int16Reader{ static_cast<const int16_t*>( pData ) },
+						 nSampleFrames, fSamplePos, fStep, pOut, nFrames );
+		break;
+	case SampleData::INT24:
+		resample_reader( SampleData::Int24Reader{ static_cast<const uint8_t*>( pData ) },
+						 nSampleFrames, fSamplePos, fStep, pOut, nFrames );
+		break;
+	}
+}
 
-bool Sampler::__render_note_resample(
-	Sample *pSample,
-	Note *pNote,
-	SelectedLayerInfo *pSelectedLayerInfo,
-	InstrumentComponent *pCompo,
-	DrumkitComponent *pDrumCompo,
-	int nBufferSize,
-	int nInitialSilence,
-	float cost_L,
-	float cost_R,
-	float cost_track_L,
-	float cost_track_R,
-	float fLayerPitch,
-	Song* pSong
-)
+bool Sampler::__render_note_resample( Voice& voice, int nWorker )
 {
 	AudioOutput* pAudioOutput = Hydrogen::get_instance()->getAudioOutput();
+	const SamplerKernels& kernels = get_sampler_kernels();
+	float* pEnvelope = m_envelopeBuffers[ nWorker ];
+	Note *pNote = voice.pNote;
+	Sample *pSample = voice.pSample;
+	SelectedLayerInfo *pSelectedLayerInfo = voice.pSelectedLayerInfo;
+	int nBufferSize = m_nRenderFrames;
+	int nInitialSilence = voice.nInitialSilence;
 
 	int nNoteLength = -1;
 	if ( pNote->get_length() != -1 ) {
 		float resampledTickSize = AudioEngine::compute_tick_size( pSample->get_sample_rate(),
 		                                                          pAudioOutput->m_transport.m_nBPM,
-		                                                          pSong->__resolution );
-		
+		                                                          m_pRenderSong->__resolution );
+
 		nNoteLength = ( int )( pNote->get_length() * resampledTickSize);
 	}
-	float fNotePitch = pNote->get_total_pitch() + fLayerPitch;
+	float fNotePitch = pNote->get_total_pitch() + voice.fLayerPitch;
 
-	float fStep = pow( 1.0594630943593, ( double )fNotePitch );
+	float fStep = compute_step( fNotePitch, pSample->get_sample_rate(), pAudioOutput->getSampleRate() );
 //	_ERRORLOG( QString("pitch: %1, step: %2" ).arg(fNotePitch).arg( fStep) );
-	fStep *= ( float )pSample->get_sample_rate() / pAudioOutput->getSampleRate(); // Adjust for audio driver sample rate
 
 	// verifico il numero di frame disponibili ancora da eseguire
-	int nAvail_bytes = ( int )( ( float )( pSample->get_frames() - pSelectedLayerInfo->SamplePosition ) / fStep );
+	const SampleData *pVariant = voice.pVariant;
+	int nAvail_bytes;
+	if ( pVariant != nullptr ) {
+		nAvail_bytes = pVariant->frames - pSelectedLayerInfo->VariantPosition;
+	} else {
+		nAvail_bytes = ( int )( ( float )( pSample->get_frames() - pSelectedLayerInfo->SamplePosition ) / fStep );
+	}
 
 
 	bool retValue = true; // the note is ended
@@ -1022,237 +1558,117 @@ bool Sampler::__render_note_resample(
 		retValue = false; // the note is not ended yet
 	}
 
-	//	ADSR *pADSR = pNote->m_pADSR;
-
-	int nInitialBufferPos = nInitialSilence;
-	//float fInitialSamplePos = pNote->get_sample_position( pCompo->get_drumkit_componentID() );
-	double fSamplePos = pSelectedLayerInfo->SamplePosition;
-	int nTimes = nInitialBufferPos + nAvail_bytes;
-
-	float *pSample_data_L = pSample->get_data_l();
-	float *pSample_data_R = pSample->get_data_r();
-
-	float fInstrPeak_L = pNote->get_instrument()->get_peak_l(); // this value will be reset to 0 by the mixer..
-	float fInstrPeak_R = pNote->get_instrument()->get_peak_r(); // this value will be reset to 0 by the mixer..
-
-	float fADSRValue = 1.0;
-	float fVal_L;
-	float fVal_R;
-	int nSampleFrames = pSample->get_frames();
-
-
-#ifdef H2CORE_HAVE_JACK
-	JackAudioDriver* pJackAudioDriver = nullptr;
-	float *		pTrackOutL = nullptr;
-	float *		pTrackOutR = nullptr;
-
-	if( pAudioOutput->has_track_outs()
-	&& (pJackAudioDriver = dynamic_cast<JackAudioDriver*>(pAudioOutput)) ) {
-				pTrackOutL = pJackAudioDriver->getTrackOut_L( pNote->get_instrument(), pCompo );
-				pTrackOutR = pJackAudioDriver->getTrackOut_R( pNote->get_instrument(), pCompo );
+	if ( nAvail_bytes <= 0 ) {
+		return retValue;
 	}
-#endif
 
-	for ( int nBufferPos = nInitialBufferPos; nBufferPos < nTimes; ++nBufferPos ) {
-		if ( ( nNoteLength != -1 ) && ( nNoteLength <= pSelectedLayerInfo->SamplePosition ) ) {
-						if ( pNote->get_adsr()->release() == 0 ) {
-				retValue = 1;	// the note is ended
-			}
+	// Interpolation: the mode is resolved once for the whole block.
+	// The result is kept in the raw buffers since the FX sends
+	// use the sample data without envelope and filter.
+	// The interpolation reads one frame before and two after the
+	// position, one more is kept for rounding errors.
+	// A streamed sample is read in windows of at most
+	// SamplerStreams::WINDOW_FRAMES frames, which a high pitch may
+	// need several of.
+	const float *pRaw_L = voice.pRaw_L;
+	const float *pRaw_R = voice.pRaw_R;
+	if ( pVariant != nullptr ) {
+		// resampled in the background, nothing left to interpolate
+		pRaw_L = pVariant->data_l + pSelectedLayerInfo->VariantPosition;
+		pRaw_R = pVariant->data_r + pSelectedLayerInfo->VariantPosition;
+	}
+	int nMaxSpan = std::max( ( int )( ( SamplerStreams::WINDOW_FRAMES - 8 ) / fStep ), 1 );
+	for ( int nDone = 0; pVariant == nullptr && nDone < nAvail_bytes; ) {
+		double fStart = pSelectedLayerInfo->SamplePosition + nDone * fStep;
+		int nCount = nAvail_bytes - nDone;
+		int nFirst = std::max( ( int )fStart - 1, 0 );
+		int nLast = std::min( ( int )( fStart + nCount * fStep ) + 4, pSample->get_frames() );
+		if ( nLast > pSample->get_head_frames() && nLast - nFirst > SamplerStreams::WINDOW_FRAMES ) {
+			nCount = std::min( nCount, nMaxSpan );
+			nLast = std::min( ( int )( fStart + nCount * fStep ) + 4, pSample->get_frames() );
 		}
 
-		int nSamplePos = ( int )fSamplePos;
-		double fDiff = fSamplePos - nSamplePos;
-		if ( ( nSamplePos + 1 ) >= nSampleFrames ) {
-			//we reach the last audioframe.
-			//set this last frame to zero do nothing wrong.
-						fVal_L = 0.0;
-						fVal_R = 0.0;
+		SampleBlock block;
+		if ( !get_sample_data( pSample, pSelectedLayerInfo->StreamID, nFirst, nLast, &block ) ) {
+			// the disk stream is late, the block is played silent
+			memset( voice.pRaw_L + nDone, 0, nCount * sizeof( float ) );
+			memset( voice.pRaw_R + nDone, 0, nCount * sizeof( float ) );
 		} else {
-			// some interpolation methods need 4 frames data.
-				float last_l;
-				float last_r;
-				if ( ( nSamplePos + 2 ) >= nSampleFrames ) {
-					last_l = 0.0;
-					last_r = 0.0;
-				} else {
-					last_l =  pSample_data_L[nSamplePos + 2];
-					last_r =  pSample_data_R[nSamplePos + 2];
-				}
-
-				switch( __interpolateMode ){
-
-						case LINEAR:
-								fVal_L = pSample_data_L[nSamplePos] * (1 - fDiff ) + pSample_data_L[nSamplePos + 1] * fDiff;
-								fVal_R = pSample_data_R[nSamplePos] * (1 - fDiff ) + pSample_data_R[nSamplePos + 1] * fDiff;
-								//fVal_L = linear_Interpolate( pSample_data_L[nSamplePos], pSample_data_L[nSamplePos + 1], fDiff);
-								//fVal_R = linear_Interpolate( pSample_data_R[nSamplePos], pSample_data_R[nSamplePos + 1], fDiff);
-								break;
-						case COSINE:
-								fVal_L = cosine_Interpolate( pSample_data_L[nSamplePos], pSample_data_L[nSamplePos + 1], fDiff);
-								fVal_R = cosine_Interpolate( pSample_data_R[nSamplePos], pSample_data_R[nSamplePos + 1], fDiff);
-								break;
-						case THIRD:
-								fVal_L = third_Interpolate( pSample_data_L[ nSamplePos -1], pSample_data_L[nSamplePos], pSample_data_L[nSamplePos + 1], last_l, fDiff);
-								fVal_R = third_Interpolate( pSample_data_R[ nSamplePos -1], pSample_data_R[nSamplePos], pSample_data_R[nSamplePos + 1], last_r, fDiff);
-								break;
-						case CUBIC:
-								fVal_L = cubic_Interpolate( pSample_data_L[ nSamplePos -1], pSample_data_L[nSamplePos], pSample_data_L[nSamplePos + 1], last_l, fDiff);
-								fVal_R = cubic_Interpolate( pSample_data_R[ nSamplePos -1], pSample_data_R[nSamplePos], pSample_data_R[nSamplePos + 1], last_r, fDiff);
-								break;
-						case HERMITE:
-								fVal_L = hermite_Interpolate( pSample_data_L[ nSamplePos -1], pSample_data_L[nSamplePos], pSample_data_L[nSamplePos + 1], last_l, fDiff);
-								fVal_R = hermite_Interpolate( pSample_data_R[ nSamplePos -1], pSample_data_R[nSamplePos], pSample_data_R[nSamplePos + 1], last_r, fDiff);
-								break;
-				}
-		}
-
-		// ADSR envelope
-		fADSRValue = pNote->get_adsr()->get_value( fStep );
-		fVal_L = fVal_L * fADSRValue;
-		fVal_R = fVal_R * fADSRValue;
-		// Low pass resonant filter
-		if ( pNote->get_instrument()->is_filter_active() ) {
-			pNote->compute_lr_values( &fVal_L, &fVal_R );
-		}
-
-
-
-#ifdef H2CORE_HAVE_JACK
-		if( 		pTrackOutL ) {
-					pTrackOutL[nBufferPos] += fVal_L * cost_track_L;
-		}
-		if( 		pTrackOutR ) {
-					pTrackOutR[nBufferPos] += fVal_R * cost_track_R;
-		}
-#endif
-
-		fVal_L = fVal_L * cost_L;
-		fVal_R = fVal_R * cost_R;
-
-		// update instr peak
-		if ( fVal_L > fInstrPeak_L ) {
-			fInstrPeak_L = fVal_L;
-		}
-		if ( fVal_R > fInstrPeak_R ) {
-			fInstrPeak_R = fVal_R;
+			// the positions are relative to the first frame of the data,
+			// the single channel of a mono sample is resampled once
+			int nFrames = pSample->get_frames() - block.nBase;
+			double fSamplePos = fStart - block.nBase;
+			resample_channel( block, block.pData_L, nFrames, fSamplePos, fStep, voice.pRaw_L + nDone, nCount );
+			if ( block.pData_R != block.pData_L ) {
+				resample_channel( block, block.pData_R, nFrames, fSamplePos, fStep, voice.pRaw_R + nDone, nCount );
+			} else if ( nCount == nAvail_bytes ) {
+				pRaw_R = voice.pRaw_L;
+			} else {
+				memcpy( voice.pRaw_R + nDone, voice.pRaw_L + nDone, nCount * sizeof( float ) );
+			}
 		}
-
-		pDrumCompo->set_outs( nBufferPos, fVal_L, fVal_R );
-
-		// to main mix
-		__main_out_L[nBufferPos] += fVal_L;
-		__main_out_R[nBufferPos] += fVal_R;
-
-		fSamplePos += fStep;
+		nDone += nCount;
 	}
-	pSelectedLayerInfo->SamplePosition += nAvail_bytes * fStep;
-	pNote->get_instrument()->set_peak_l( fInstrPeak_L );
-	pNote->get_instrument()->set_peak_r( fInstrPeak_R );
-
-
-
-#ifdef H2CORE_HAVE_LADSPA
-	// LADSPA
-	// change the below return logic if you add code after that ifdef
-	if (pNote->get_instrument()->is_muted() || pSong->__is_muted) return retValue;
-	float masterVol = pSong->get_volume();
-	for ( unsigned nFX = 0; nFX < MAX_FX; ++nFX ) {
-		LadspaFX *pFX = Effects::get_instance()->getLadspaFX( nFX );
-		float fLevel = pNote->get_instrument()->get_fx_level( nFX );
-		if ( ( pFX ) && ( fLevel != 0.0 ) ) {
-			fLevel = fLevel * pFX->getVolume();
 
-			float *pBuf_L = pFX->m_pBuffer_L;
-			float *pBuf_R = pFX->m_pBuffer_R;
+	// The sample position does not move while the block is rendered,
+	// so the release condition holds for the whole block or not at all.
+	ADSR* pADSR = pNote->get_adsr();
+	bool bRelease = ( nNoteLength != -1 ) && ( nNoteLength <= pSelectedLayerInfo->SamplePosition );
+	if ( bRelease ) {
+		pADSR->release();
+	}
 
-//			float fFXCost_L = cost_L * fLevel;
-//			float fFXCost_R = cost_R * fLevel;
-			float fFXCost_L = fLevel * masterVol;
-			float fFXCost_R = fLevel * masterVol;
+	// ADSR envelope
+	pADSR->get_values( pEnvelope, nAvail_bytes, fStep );
+	kernels.mul( voice.pVoice_L, pRaw_L, pEnvelope, nAvail_bytes );
+	kernels.mul( voice.pVoice_R, pRaw_R, pEnvelope, nAvail_bytes );
 
-			int nBufferPos = nInitialBufferPos;
-			float fSamplePos = pSelectedLayerInfo->SamplePosition;
-			for ( int i = 0; i < nAvail_bytes; ++i ) {
-				int nSamplePos = ( int )fSamplePos;
-				double fDiff = fSamplePos - nSamplePos;
-
-				if ( ( nSamplePos + 1 ) >= nSampleFrames ) {
-					//we reach the last audioframe.
-					//set this last frame to zero do nothing wrong.
-					fVal_L = 0.0;
-					fVal_R = 0.0;
-				} else {
-					// some interpolation methods need 4 frames data.
-					float last_l;
-					float last_r;
-					if ( ( nSamplePos + 2 ) >= nSampleFrames ) {
-						last_l = 0.0;
-						last_r = 0.0;
-					}else
-					{
-						last_l =  pSample_data_L[nSamplePos + 2];
-						last_r =  pSample_data_R[nSamplePos + 2];
-					}
+	if ( bRelease && pADSR->release() == 0 ) {
+		retValue = true;	// the note is ended
+	}
 
-					switch( __interpolateMode ){
-
-					case LINEAR:
-						fVal_L = pSample_data_L[nSamplePos] * (1 - fDiff ) + pSample_data_L[nSamplePos + 1] * fDiff;
-						fVal_R = pSample_data_R[nSamplePos] * (1 - fDiff ) + pSample_data_R[nSamplePos + 1] * fDiff;
-						break;
-					case COSINE:
-						fVal_L = cosine_Interpolate( pSample_data_L[nSamplePos], pSample_data_L[nSamplePos + 1], fDiff);
-						fVal_R = cosine_Interpolate( pSample_data_R[nSamplePos], pSample_data_R[nSamplePos + 1], fDiff);
-						break;
-					case THIRD:
-						fVal_L = third_Interpolate( pSample_data_L[ nSamplePos -1], pSample_data_L[nSamplePos], pSample_data_L[nSamplePos + 1], last_l, fDiff);
-						fVal_R = third_Interpolate( pSample_data_R[ nSamplePos -1], pSample_data_R[nSamplePos], pSample_data_R[nSamplePos + 1], last_r, fDiff);
-						break;
-					case CUBIC:
-						fVal_L = cubic_Interpolate( pSample_data_L[ nSamplePos -1], pSample_data_L[nSamplePos], pSample_data_L[nSamplePos + 1], last_l, fDiff);
-						fVal_R = cubic_Interpolate( pSample_data_R[ nSamplePos -1], pSample_data_R[nSamplePos], pSample_data_R[nSamplePos + 1], last_r, fDiff);
-						break;
-					case HERMITE:
-						fVal_L = hermite_Interpolate( pSample_data_L[ nSamplePos -1], pSample_data_L[nSamplePos], pSample_data_L[nSamplePos + 1], last_l, fDiff);
-						fVal_R = hermite_Interpolate( pSample_data_R[ nSamplePos -1], pSample_data_R[nSamplePos], pSample_data_R[nSamplePos + 1], last_r, fDiff);
-						break;
-					}
-				}
+	// Low pass resonant filter
+	if ( pNote->get_instrument()->is_filter_active() ) {
+		pNote->compute_lr_values( voice.pVoice_L, voice.pVoice_R, nAvail_bytes );
+	}
 
-				pBuf_L[ nBufferPos ] += fVal_L * fFXCost_L;
-								pBuf_R[ nBufferPos ] += fVal_R * fFXCost_R;
-				fSamplePos += fStep;
-				++nBufferPos;
-			}
-		}
+	if ( pVariant != nullptr ) {
+		// the sample position follows, should the note go on
+		// without the copy
+		pSelectedLayerInfo->VariantPosition += nAvail_bytes;
+		pSelectedLayerInfo->SamplePosition = pSelectedLayerInfo->VariantPosition * fStep;
+	} else {
+		pSelectedLayerInfo->SamplePosition += nAvail_bytes * fStep;
 	}
-#endif
+
+	voice.nFrames = nAvail_bytes;
+	voice.pSend_L = pRaw_L;
+	voice.pSend_R = pRaw_R;
 
 	return retValue;
 }
 
 
+
 void Sampler::stop_playing_notes( Instrument* instrument )
 {
 	if ( instrument ) { // stop all notes using this instrument
-		for ( unsigned i = 0; i < __playing_notes_queue.size(); ) {
-			Note *pNote = __playing_notes_queue[ i ];
+		int i;
+		while ( ( i = m_pPlayingNotes->first( SamplerVoices::INSTRUMENT, SamplerVoices::key( instrument ) ) ) != -1 ) {
+			Note *pNote = m_pPlayingNotes->get( i );
 			assert( pNote );
-			if ( pNote->get_instrument() == instrument ) {
-				delete pNote;
-				instrument->dequeue();
-				__playing_notes_queue.erase( __playing_notes_queue.begin() + i );
-			}
-			++i;
+			m_pPlayingNotes->remove( i );
+			NotePool::get_instance()->release( pNote );
+			instrument->dequeue();
 		}
 	} else { // stop all notes
 		// delete all copied notes in the playing notes queue
-		for ( unsigned i = 0; i < __playing_notes_queue.size(); ++i ) {
-			Note *pNote = __playing_notes_queue[i];
+		for ( int i = 0; i < m_pPlayingNotes->size(); ++i ) {
+			Note *pNote = m_pPlayingNotes->get( i );
 			pNote->get_instrument()->dequeue();
-			delete pNote;
+			NotePool::get_instance()->release( pNote );
 		}
-		__playing_notes_queue.clear();
+		m_pPlayingNotes->clear();
 	}
 }
 
@@ -1269,7 +1685,7 @@ void Sampler::preview_sample( Sample* sample, int length )
 
 		pLayer->set_sample( sample );
 
-		Note *pPreviewNote = new Note( __preview_instrument, 0, 1.0, 0.5, 0.5, length, 0 );
+		Note *pPreviewNote = NotePool::get_instance()->acquire( __preview_instrument, 0, 1.0, 0.5, 0.5, length, 0 );
 
 		stop_playing_notes( __preview_instrument );
 		note_on( pPreviewNote );
@@ -1292,7 +1708,7 @@ void Sampler::preview_instrument( Instrument* instr )
 	__preview_instrument = instr;
 	instr->set_is_preview_instrument(true);
 
-	Note *pPreviewNote = new Note( __preview_instrument, 0, 1.0, 0.5, 0.5, MAX_NOTES, 0 );
+	Note *pPreviewNote = NotePool::get_instance()->acquire( __preview_instrument, 0, 1.0, 0.5, 0.5, MAX_NOTES, 0 );
 
 	note_on( pPreviewNote );	// exclusive note
 	AudioEngine::get_instance()->unlock();
@@ -1340,24 +1756,21 @@ void Sampler::setPlayingNotelength( Instrument* instrument, unsigned long ticks,
 							if( !Preferences::get_instance()->__playselectedinstrument ){
 								if ( pNote->get_instrument() == instrument
 								&& pNote->get_position() == noteOnTick ) {
-									AudioEngine::get_instance()->lock( RIGHT_HERE );
-
 									if ( ticks >  patternsize )
 										ticks = patternsize - noteOnTick;
 									pNote->set_length( ticks );
+									pCurrentPattern->touch();
 									Hydrogen::get_instance()->getSong()->set_is_modified( true );
-									AudioEngine::get_instance()->unlock(); // unlock the audio engine
 								}
 							}else
 							{
 								if ( pNote->get_instrument() == pEngine->getSong()->get_instrument_list()->get( pEngine->getSelectedInstrumentNumber())
 								&& pNote->get_position() == noteOnTick ) {
-									AudioEngine::get_instance()->lock( RIGHT_HERE );
 									if ( ticks >  patternsize )
 										ticks = patternsize - noteOnTick;
 									pNote->set_length( ticks );
+									pCurrentPattern->touch();
 									Hydrogen::get_instance()->getSong()->set_is_modified( true );
-									AudioEngine::get_instance()->unlock(); // unlock the audio engine
 								}
 							}
 						}
@@ -1365,18 +1778,12 @@ void Sampler::setPlayingNotelength( Instrument* instrument, unsigned long ticks,
 				}
 			}
 		}
-
-	EventQueue::get_instance()->push_event( EVENT_PATTERN_MODIFIED, -1 );
 }
 
 bool Sampler::is_instrument_playing( Instrument* instrument )
 {
-	if ( instrument ) { // stop all notes using this instrument
-		for ( unsigned j = 0; j < __playing_notes_queue.size(); j++ ) {
-			if ( instrument->get_name() == __playing_notes_queue[ j ]->get_instrument()->get_name()){
-				return true;
-			}
-		}
+	if ( instrument ) {
+		return m_pPlayingNotes->first( SamplerVoices::INSTRUMENT, SamplerVoices::key( instrument ) ) != -1;
 	}
 	return false;
 }
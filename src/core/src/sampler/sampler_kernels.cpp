@@ -0,0 +1,193 @@
+/*
+ * Hydrogen
+ * Copyright(c) 2002-2008 by Alex >Comix< Cominu [comix@users.sourceforge.net]
+ *
+ * http://www.hydrogen-music.org
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY, without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ */
+
+
+#include "sampler_kernels.h"
+
+#include <cmath>
+
+#if ( defined( __GNUC__ ) || defined( __clang__ ) ) && ( defined( __x86_64__ ) || defined( __i386__ ) )
+#define H2_SAMPLER_KERNELS_X86
+#include <immintrin.h>
+#endif
+
+namespace H2Core
+{
+
+static void mul_scalar( float* pDst, const float* pSrc, const float* pGain, int nFrames )
+{
+	for ( int i = 0; i < nFrames; ++i ) {
+		pDst[ i ] = pSrc[ i ] * pGain[ i ];
+	}
+}
+
+static void mix_scalar( float* pDst, const float* pSrc, float fGain, int nFrames )
+{
+	for ( int i = 0; i < nFrames; ++i ) {
+		pDst[ i ] += pSrc[ i ] * fGain;
+	}
+}
+
+static float mix_peak_scalar( float* pDst1, float* pDst2, const float* pSrc, float fGain, float fPeak, float* pEnergy, int nFrames )
+{
+	float fEnergy = 0.0f;
+	for ( int i = 0; i < nFrames; ++i ) {
+		float fVal = pSrc[ i ] * fGain;
+		float fAbs = std::fabs( fVal );
+		if ( fAbs > fPeak ) {
+			fPeak = fAbs;
+		}
+		fEnergy += fVal * fVal;
+		pDst1[ i ] += fVal;
+		pDst2[ i ] += fVal;
+	}
+	*pEnergy += fEnergy;
+	return fPeak;
+}
+
+#ifdef H2_SAMPLER_KERNELS_X86
+
+__attribute__(( target( "sse2" ) ))
+static void mul_sse2( float* pDst, const float* pSrc, const float* pGain, int nFrames )
+{
+	int i = 0;
+	for ( ; i + 4 <= nFrames; i += 4 ) {
+		_mm_storeu_ps( pDst + i, _mm_mul_ps( _mm_loadu_ps( pSrc + i ), _mm_loadu_ps( pGain + i ) ) );
+	}
+	mul_scalar( pDst + i, pSrc + i, pGain + i, nFrames - i );
+}
+
+__attribute__(( target( "sse2" ) ))
+static void mix_sse2( float* pDst, const float* pSrc, float fGain, int nFrames )
+{
+	const __m128 gain = _mm_set1_ps( fGain );
+	int i = 0;
+	for ( ; i + 4 <= nFrames; i += 4 ) {
+		__m128 val = _mm_mul_ps( _mm_loadu_ps( pSrc + i ), gain );
+		_mm_storeu_ps( pDst + i, _mm_add_ps( _mm_loadu_ps( pDst + i ), val ) );
+	}
+	mix_scalar( pDst + i, pSrc + i, fGain, nFrames - i );
+}
+
+__attribute__(( target( "sse2" ) ))
+static float mix_peak_sse2( float* pDst1, float* pDst2, const float* pSrc, float fGain, float fPeak, float* pEnergy, int nFrames )
+{
+	const __m128 gain = _mm_set1_ps( fGain );
+	const __m128 sign = _mm_set1_ps( -0.0f );
+	__m128 peak = _mm_set1_ps( fPeak );
+	__m128 energy = _mm_setzero_ps();
+	int i = 0;
+	for ( ; i + 4 <= nFrames; i += 4 ) {
+		__m128 val = _mm_mul_ps( _mm_loadu_ps( pSrc + i ), gain );
+		peak = _mm_max_ps( peak, _mm_andnot_ps( sign, val ) );
+		energy = _mm_add_ps( energy, _mm_mul_ps( val, val ) );
+		_mm_storeu_ps( pDst1 + i, _mm_add_ps( _mm_loadu_ps( pDst1 + i ), val ) );
+		_mm_storeu_ps( pDst2 + i, _mm_add_ps( _mm_loadu_ps( pDst2 + i ), val ) );
+	}
+	float peaks[ 4 ];
+	float energies[ 4 ];
+	_mm_storeu_ps( peaks, peak );
+	_mm_storeu_ps( energies, energy );
+	for ( int n = 0; n < 4; ++n ) {
+		if ( peaks[ n ] > fPeak ) {
+			fPeak = peaks[ n ];
+		}
+		*pEnergy += energies[ n ];
+	}
+	return mix_peak_scalar( pDst1 + i, pDst2 + i, pSrc + i, fGain, fPeak, pEnergy, nFrames - i );
+}
+
+__attribute__(( target( "avx2" ) ))
+static void mul_avx2( float* pDst, const float* pSrc, const float* pGain, int nFrames )
+{
+	int i = 0;
+	for ( ; i + 8 <= nFrames; i += 8 ) {
+		_mm256_storeu_ps( pDst + i, _mm256_mul_ps( _mm256_loadu_ps( pSrc + i ), _mm256_loadu_ps( pGain + i ) ) );
+	}
+	mul_scalar( pDst + i, pSrc + i, pGain + i, nFrames - i );
+}
+
+__attribute__(( target( "avx2" ) ))
+static void mix_avx2( float* pDst, const float* pSrc, float fGain, int nFrames )
+{
+	const __m256 gain = _mm256_set1_ps( fGain );
+	int i = 0;
+	for ( ; i + 8 <= nFrames; i += 8 ) {
+		__m256 val = _mm256_mul_ps( _mm256_loadu_ps( pSrc + i ), gain );
+		_mm256_storeu_ps( pDst + i, _mm256_add_ps( _mm256_loadu_ps( pDst + i ), val ) );
+	}
+	mix_scalar( pDst + i, pSrc + i, fGain, nFrames - i );
+}
+
+__attribute__(( target( "avx2" ) ))
+static float mix_peak_avx2( float* pDst1, float* pDst2, const float* pSrc, float fGain, float fPeak, float* pEnergy, int nFrames )
+{
+	const __m256 gain = _mm256_set1_ps( fGain );
+	const __m256 sign = _mm256_set1_ps( -0.0f );
+	__m256 peak = _mm256_set1_ps( fPeak );
+	__m256 energy = _mm256_setzero_ps();
+	int i = 0;
+	for ( ; i + 8 <= nFrames; i += 8 ) {
+		__m256 val = _mm256_mul_ps( _mm256_loadu_ps( pSrc + i ), gain );
+		peak = _mm256_max_ps( peak, _mm256_andnot_ps( sign, val ) );
+		energy = _mm256_add_ps( energy, _mm256_mul_ps( val, val ) );
+		_mm256_storeu_ps( pDst1 + i, _mm256_add_ps( _mm256_loadu_ps( pDst1 + i ), val ) );
+		_mm256_storeu_ps( pDst2 + i, _mm256_add_ps( _mm256_loadu_ps( pDst2 + i ), val ) );
+	}
+	float peaks[ 8 ];
+	float energies[ 8 ];
+	_mm256_storeu_ps( peaks, peak );
+	_mm256_storeu_ps( energies, energy );
+	for ( int n = 0; n < 8; ++n ) {
+		if ( peaks[ n ] > fPeak ) {
+			fPeak = peaks[ n ];
+		}
+		*pEnergy += energies[ n ];
+	}
+	return mix_peak_scalar( pDst1 + i, pDst2 + i, pSrc + i, fGain, fPeak, pEnergy, nFrames - i );
+}
+
+#endif // H2_SAMPLER_KERNELS_X86
+
+static SamplerKernels select_sampler_kernels()
+{
+#ifdef H2_SAMPLER_KERNELS_X86
+	__builtin_cpu_init();
+	if ( __builtin_cpu_supports( "avx2" ) ) {
+		return SamplerKernels { "AVX2", mul_avx2, mix_avx2, mix_peak_avx2 };
+	}
+	if ( __builtin_cpu_supports( "sse2" ) ) {
+		return SamplerKernels { "SSE2", mul_sse2, mix_sse2, mix_peak_sse2 };
+	}
+#endif
+	return SamplerKernels { "scalar", mul_scalar, mix_scalar, mix_peak_scalar };
+}
+
+const SamplerKernels& get_sampler_kernels()
+{
+	static const SamplerKernels kernels = select_sampler_kernels();
+	return kernels;
+}
+
+};
+
+/* vim: set softtabstop=4 noexpandtab: */
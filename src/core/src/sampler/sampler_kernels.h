@@ -0,0 +1,63 @@
+/*
+ * Hydrogen
+ * Copyright(c) 2002-2008 by Alex >Comix< Cominu [comix@users.sourceforge.net]
+ *
+ * http://www.hydrogen-music.org
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY, without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ */
+
+
+#ifndef H2C_SAMPLER_KERNELS_H
+#define H2C_SAMPLER_KERNELS_H
+
+namespace H2Core
+{
+
+/**
+ * Block kernels used by the Sampler to render a voice.
+ *
+ * Every kernel works on contiguous float buffers of \a nFrames
+ * frames. The implementation (AVX2, SSE2 or plain C) is picked once
+ * at runtime by get_sampler_kernels() depending on what the CPU
+ * supports. All variants perform the same sequence of separate
+ * multiplications and additions, so their output is identical. Only
+ * the energy summed up by mix_peak() may differ in rounding.
+ */
+struct SamplerKernels
+{
+	/** name of the selected implementation, for logging */
+	const char* name;
+	/** pDst[i] = pSrc[i] * pGain[i] */
+	void ( *mul )( float* pDst, const float* pSrc, const float* pGain, int nFrames );
+	/** pDst[i] += pSrc[i] * fGain */
+	void ( *mix )( float* pDst, const float* pSrc, float fGain, int nFrames );
+	/**
+	 * pDst1[i] += pSrc[i] * fGain and pDst2[i] += pSrc[i] * fGain,
+	 * adds the squares of the scaled values to \a pEnergy and
+	 * returns the maximum of \a fPeak and their absolute values
+	 */
+	float ( *mix_peak )( float* pDst1, float* pDst2, const float* pSrc, float fGain, float fPeak, float* pEnergy, int nFrames );
+};
+
+/** returns the kernel table best suited for the running CPU */
+const SamplerKernels& get_sampler_kernels();
+
+};
+
+#endif // H2C_SAMPLER_KERNELS_H
+
+/* vim: set softtabstop=4 noexpandtab: */
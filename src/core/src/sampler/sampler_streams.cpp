@@ -0,0 +1,313 @@
+/*
+ * Hydrogen
+ * Copyright(c) 2002-2008 by Alex >Comix< Cominu [comix@users.sourceforge.net]
+ *
+ * http://www.hydrogen-music.org
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY, without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ */
+
+
+#include "sampler_streams.h"
+
+#include <algorithm>
+#include <unistd.h>
+
+#include <hydrogen/basics/sample.h>
+
+namespace H2Core
+{
+
+const char* SamplerStreams::__class_name = "SamplerStreams";
+
+const int SamplerStreams::RING_FRAMES;
+const int SamplerStreams::WINDOW_FRAMES;
+const int SamplerStreams::READ_FRAMES;
+
+static_assert( ( SamplerStreams::RING_FRAMES & ( SamplerStreams::RING_FRAMES - 1 ) ) == 0,
+			   "the ring size has to be a power of two" );
+static_assert( SamplerStreams::WINDOW_FRAMES < Sample::STREAM_HEAD_FRAMES,
+			   "a stream has to start before the end of the head" );
+static_assert( SamplerStreams::WINDOW_FRAMES <= SamplerStreams::RING_FRAMES,
+			   "a window has to fit in the ring" );
+
+/** idle time of the disk thread, in microseconds */
+static const int SAMPLER_STREAMS_IDLE = 2000;
+
+SamplerStreams::SamplerStreams( int nStreams )
+	: Object( __class_name ),
+	  __streams( nStreams ),
+	  __quit( false ),
+	  __cycle( 0 ),
+	  __underruns( 0 ),
+	  __active( 0 )
+{
+	for ( auto& stream : __streams ) {
+		stream.state.store( FREE );
+		stream.pOwner = nullptr;
+		stream.pSample = nullptr;
+		stream.nFrames = 0;
+		stream.nFirst = 0;
+		stream.nWritten.store( 0 );
+		stream.nConsumed.store( 0 );
+		stream.nUsed.store( 0 );
+		stream.pFile = nullptr;
+		stream.nChannels = 0;
+		stream.pRing_L = new float[ RING_FRAMES + WINDOW_FRAMES ];
+		stream.pRing_R = new float[ RING_FRAMES + WINDOW_FRAMES ];
+	}
+	INFOLOG( QString( "%1 streams of %2 frames" ).arg( nStreams ).arg( RING_FRAMES ) );
+
+	if ( pthread_create( &__thread, nullptr, disk_thread, this ) != 0 ) {
+		ERRORLOG( "Can't create the disk thread, streamed samples will only play their head" );
+		__quit.store( true );
+	}
+}
+
+SamplerStreams::~SamplerStreams()
+{
+	if ( !__quit.load() ) {
+		__quit.store( true );
+		pthread_join( __thread, nullptr );
+	}
+	for ( auto& stream : __streams ) {
+		if ( stream.pFile != nullptr ) {
+			sf_close( stream.pFile );
+		}
+		delete[] stream.pRing_L;
+		delete[] stream.pRing_R;
+	}
+}
+
+int SamplerStreams::open( const void* pOwner, const Sample* pSample, int nFirst )
+{
+	unsigned nCycle = __cycle.load( std::memory_order_relaxed );
+	for ( unsigned i = 0; i < __streams.size(); ++i ) {
+		Stream& stream = __streams[ i ];
+		if ( stream.state.load( std::memory_order_acquire ) != FREE ) {
+			continue;
+		}
+		stream.pOwner = pOwner;
+		stream.pSample = pSample;
+		// the disk thread cleared the previous path, nothing is freed here
+		stream.sPath = pSample->get_filepath();
+		stream.nFrames = pSample->get_frames();
+		stream.nFirst = nFirst;
+		stream.nWritten.store( nFirst, std::memory_order_relaxed );
+		stream.nConsumed.store( nFirst, std::memory_order_relaxed );
+		stream.nUsed.store( nCycle, std::memory_order_relaxed );
+		stream.state.store( REQUESTED, std::memory_order_release );
+		return i;
+	}
+	return -1;
+}
+
+bool SamplerStreams::use( int nStream, const void* pOwner, const Sample* pSample, int nFrame )
+{
+	if ( nStream < 0 ) {
+		return false;
+	}
+	Stream& stream = __streams[ nStream ];
+	int nState = stream.state.load( std::memory_order_acquire );
+	if ( ( nState != REQUESTED && nState != ACTIVE )
+		 || stream.pOwner != pOwner || stream.pSample != pSample
+		 || stream.nFrames != pSample->get_frames() ) {
+		return false;
+	}
+	// going back or far ahead, the stream is better restarted
+	if ( nFrame < stream.nConsumed.load( std::memory_order_relaxed )
+		 || nFrame > stream.nWritten.load( std::memory_order_relaxed ) + RING_FRAMES ) {
+		return false;
+	}
+	stream.nUsed.store( __cycle.load( std::memory_order_relaxed ), std::memory_order_relaxed );
+	return true;
+}
+
+void SamplerStreams::close( int nStream, const void* pOwner )
+{
+	if ( nStream < 0 ) {
+		return;
+	}
+	Stream& stream = __streams[ nStream ];
+	int nState = stream.state.load( std::memory_order_acquire );
+	if ( ( nState == REQUESTED || nState == ACTIVE ) && stream.pOwner == pOwner ) {
+		// the disk thread only moves a stream from REQUESTED to
+		// ACTIVE, which fails once it is CLOSING
+		stream.state.store( CLOSING, std::memory_order_release );
+	}
+}
+
+void SamplerStreams::collect()
+{
+	unsigned nCycle = __cycle.load( std::memory_order_relaxed );
+	int nActive = 0;
+	for ( auto& stream : __streams ) {
+		int nState = stream.state.load( std::memory_order_acquire );
+		if ( nState != REQUESTED && nState != ACTIVE ) {
+			continue;
+		}
+		if ( stream.nUsed.load( std::memory_order_relaxed ) != nCycle ) {
+			// the voice has ended
+			stream.state.store( CLOSING, std::memory_order_release );
+		} else {
+			nActive++;
+		}
+	}
+	__active.store( nActive, std::memory_order_relaxed );
+	__cycle.store( nCycle + 1, std::memory_order_relaxed );
+}
+
+SamplerStreams::Window SamplerStreams::window( int nStream, int nFirst, int nLast, const float** ppData_L, const float** ppData_R )
+{
+	if ( nStream < 0 || nLast - nFirst > WINDOW_FRAMES ) {
+		__underruns.fetch_add( 1, std::memory_order_relaxed );
+		return MISSED;
+	}
+	Stream& stream = __streams[ nStream ];
+	stream.nUsed.store( __cycle.load( std::memory_order_relaxed ), std::memory_order_relaxed );
+	if ( nFirst < stream.nConsumed.load( std::memory_order_relaxed ) ) {
+		__underruns.fetch_add( 1, std::memory_order_relaxed );
+		return MISSED;
+	}
+	// the frames before are not needed anymore, even if the
+	// requested ones are not there yet
+	stream.nConsumed.store( nFirst, std::memory_order_release );
+	if ( nLast > stream.nWritten.load( std::memory_order_acquire ) ) {
+		__underruns.fetch_add( 1, std::memory_order_relaxed );
+		return PENDING;
+	}
+	int nPos = nFirst & ( RING_FRAMES - 1 );
+	*ppData_L = stream.pRing_L + nPos;
+	*ppData_R = stream.pRing_R + nPos;
+	return READY;
+}
+
+void* SamplerStreams::disk_thread( void* pParam )
+{
+	static_cast<SamplerStreams*>( pParam )->work();
+	return nullptr;
+}
+
+void SamplerStreams::work()
+{
+	std::vector<float> buffer;
+	while ( !__quit.load() ) {
+		// one read per stream and pass, so that a stream far
+		// behind does not starve the others
+		bool bBusy = false;
+		for ( auto& stream : __streams ) {
+			switch ( stream.state.load( std::memory_order_acquire ) ) {
+			case REQUESTED:
+				start( stream );
+				bBusy = true;
+				break;
+			case ACTIVE:
+				if ( fill( stream, buffer ) ) {
+					bBusy = true;
+				}
+				break;
+			case CLOSING:
+				stop( stream );
+				break;
+			default:
+				break;
+			}
+		}
+		if ( !bBusy ) {
+			usleep( SAMPLER_STREAMS_IDLE );
+		}
+	}
+}
+
+void SamplerStreams::start( Stream& stream )
+{
+	SF_INFO sound_info;
+	sound_info.format = 0;
+	stream.pFile = sf_open( stream.sPath.toLocal8Bit(), SFM_READ, &sound_info );
+	if ( stream.pFile == nullptr ) {
+		// the stream delivers silence
+		ERRORLOG( QString( "Unable to stream %1" ).arg( stream.sPath ) );
+	} else {
+		stream.nChannels = sound_info.channels;
+		if ( sf_seek( stream.pFile, stream.nFirst, SEEK_SET ) < 0 ) {
+			ERRORLOG( QString( "Unable to seek %1 to %2" ).arg( stream.sPath ).arg( stream.nFirst ) );
+			sf_close( stream.pFile );
+			stream.pFile = nullptr;
+		}
+	}
+	int nExpected = REQUESTED;
+	stream.state.compare_exchange_strong( nExpected, ACTIVE, std::memory_order_acq_rel );
+}
+
+bool SamplerStreams::fill( Stream& stream, std::vector<float>& buffer )
+{
+	int nWritten = stream.nWritten.load( std::memory_order_relaxed );
+	int nConsumed = stream.nConsumed.load( std::memory_order_acquire );
+	if ( nWritten < nConsumed ) {
+		// the reader went past the buffered frames, skip ahead
+		if ( stream.pFile != nullptr && sf_seek( stream.pFile, nConsumed, SEEK_SET ) < 0 ) {
+			sf_close( stream.pFile );
+			stream.pFile = nullptr;
+		}
+		nWritten = nConsumed;
+	}
+	int nCount = std::min( std::min( nConsumed + RING_FRAMES, stream.nFrames ) - nWritten, READ_FRAMES );
+	if ( nCount <= 0 ) {
+		return false;
+	}
+
+	int nRead = 0;
+	if ( stream.pFile != nullptr ) {
+		buffer.resize( READ_FRAMES * stream.nChannels );
+		nRead = std::max( ( int )sf_readf_float( stream.pFile, buffer.data(), nCount ), 0 );
+	}
+	// a mono file is played on both channels, more than two
+	// channels are dropped as by SampleData::decode()
+	int nRight = stream.nChannels > 1 ? 1 : 0;
+	for ( int i = 0; i < nCount; ++i ) {
+		float fVal_L = 0.0;
+		float fVal_R = 0.0;
+		if ( i < nRead ) {
+			fVal_L = buffer[ i * stream.nChannels ];
+			fVal_R = buffer[ i * stream.nChannels + nRight ];
+		}
+		int nPos = ( nWritten + i ) & ( RING_FRAMES - 1 );
+		stream.pRing_L[ nPos ] = fVal_L;
+		stream.pRing_R[ nPos ] = fVal_R;
+		if ( nPos < WINDOW_FRAMES ) {
+			stream.pRing_L[ RING_FRAMES + nPos ] = fVal_L;
+			stream.pRing_R[ RING_FRAMES + nPos ] = fVal_R;
+		}
+	}
+	// nWritten may only be moved by this thread, the reader only
+	// moves nConsumed
+	stream.nWritten.store( nWritten + nCount, std::memory_order_release );
+	return true;
+}
+
+void SamplerStreams::stop( Stream& stream )
+{
+	if ( stream.pFile != nullptr ) {
+		sf_close( stream.pFile );
+		stream.pFile = nullptr;
+	}
+	stream.sPath.clear();
+	stream.state.store( FREE, std::memory_order_release );
+}
+
+};
+
+/* vim: set softtabstop=4 noexpandtab: */
@@ -0,0 +1,168 @@
+/*
+ * Hydrogen
+ * Copyright(c) 2002-2008 by Alex >Comix< Cominu [comix@users.sourceforge.net]
+ *
+ * http://www.hydrogen-music.org
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY, without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ */
+
+
+#ifndef H2C_SAMPLER_STREAMS_H
+#define H2C_SAMPLER_STREAMS_H
+
+#include <hydrogen/object.h>
+#include <hydrogen/globals.h>
+
+#include <atomic>
+#include <pthread.h>
+#include <vector>
+
+#include <sndfile.h>
+
+namespace H2Core
+{
+
+class Sample;
+
+/**
+ * Disk streams feeding the voices of streamed samples.
+ *
+ * A streamed Sample only holds the head of its data in memory. As
+ * soon as a voice starts to play it, the Sampler opens a stream which
+ * a background thread fills from the file into a ring buffer, ahead of
+ * the render cursor and before the end of the head is reached.
+ *
+ * The streams are claimed, checked and collected by the audio thread
+ * only. window() may also be called by the render workers, each
+ * stream being read by a single voice.
+ *
+ * The ring buffers are followed by a copy of their first
+ * #WINDOW_FRAMES frames, so that a window never wraps around.
+ */
+class SamplerStreams : public H2Core::Object
+{
+		H2_OBJECT
+	public:
+		/** frames buffered ahead of the read cursor of a stream */
+		static const int RING_FRAMES = 65536;
+		/** largest number of frames a single window() may span */
+		static const int WINDOW_FRAMES = 4 * MAX_BUFFER_SIZE;
+		/** frames read from a file at once */
+		static const int READ_FRAMES = 4096;
+
+		/** result of window() */
+		enum Window {
+			READY,		///< the frames are buffered
+			PENDING,	///< the disk thread is late, an underrun
+			MISSED		///< the frames will never be buffered, the stream has to be reopened
+		};
+
+		/**
+		 * constructor, allocates the buffers and starts the disk thread
+		 * \param nStreams number of streams playing at the same time
+		 */
+		SamplerStreams( int nStreams );
+		/** destructor, joins the disk thread and closes the files */
+		~SamplerStreams();
+
+		/**
+		 * claims a stream of \a pSample starting at the frame
+		 * \a nFirst. Audio thread only.
+		 * \param pOwner whatever identifies the reader, used by use() and close()
+		 * \param pSample the streamed sample
+		 * \param nFirst first frame the stream will deliver
+		 * \return the stream, -1 if all of them are busy
+		 */
+		int open( const void* pOwner, const Sample* pSample, int nFirst );
+		/**
+		 * checks that \a nStream is still open for \a pOwner and
+		 * \a pSample and may deliver the frames from \a nFrame on,
+		 * and keeps it from being collected. Audio thread only.
+		 */
+		bool use( int nStream, const void* pOwner, const Sample* pSample, int nFrame );
+		/** closes \a nStream if it is open for \a pOwner. Audio thread only. */
+		void close( int nStream, const void* pOwner );
+		/**
+		 * closes the streams neither opened nor used nor read since
+		 * the last call. Called by the audio thread at the end of a
+		 * cycle.
+		 */
+		void collect();
+
+		/**
+		 * points \a ppData_L and \a ppData_R to the frames
+		 * [\a nFirst, \a nLast) of \a nStream. The frames before \a
+		 * nFirst are dropped, the pointers are valid until the
+		 * next call for the same stream. Underruns are counted.
+		 */
+		Window window( int nStream, int nFirst, int nLast, const float** ppData_L, const float** ppData_R );
+
+		/** \return number of windows which could not be delivered so far */
+		int get_underruns() const { return __underruns.load( std::memory_order_relaxed ); }
+		/** \return number of streams open during the last cycle */
+		int get_active() const { return __active.load( std::memory_order_relaxed ); }
+
+	private:
+		enum State {
+			FREE,			///< may be claimed by open()
+			REQUESTED,		///< claimed, the disk thread has to open the file
+			ACTIVE,			///< filled by the disk thread
+			CLOSING			///< the disk thread has to close the file
+		};
+
+		struct Stream {
+			std::atomic<int> state;
+			// set by open(), read by the audio thread
+			const void* pOwner;
+			const Sample* pSample;
+			// set by open(), read by the disk thread
+			QString sPath;
+			int nFrames;					///< frames of the whole sample
+			int nFirst;						///< first frame of the stream
+			std::atomic<int> nWritten;		///< end of the buffered frames
+			std::atomic<int> nConsumed;		///< first frame still needed by the reader
+			std::atomic<unsigned> nUsed;	///< last cycle the stream was used in
+			// disk thread only
+			SNDFILE* pFile;
+			int nChannels;
+			float* pRing_L;					///< #RING_FRAMES + #WINDOW_FRAMES frames
+			float* pRing_R;
+		};
+
+		static void* disk_thread( void* pParam );
+		/** body of the disk thread */
+		void work();
+		/** opens the file of a REQUESTED stream */
+		void start( Stream& stream );
+		/** reads the next frames of an ACTIVE stream, \return false if it is full */
+		bool fill( Stream& stream, std::vector<float>& buffer );
+		/** releases a CLOSING stream */
+		void stop( Stream& stream );
+
+		std::vector<Stream> __streams;
+		pthread_t __thread;
+		std::atomic<bool> __quit;
+		std::atomic<unsigned> __cycle;		///< incremented by collect()
+		std::atomic<int> __underruns;
+		std::atomic<int> __active;
+};
+
+};
+
+#endif // H2C_SAMPLER_STREAMS_H
+
+/* vim: set softtabstop=4 noexpandtab: */
@@ -0,0 +1,184 @@
+/*
+ * Hydrogen
+ * Copyright(c) 2002-2008 by Alex >Comix< Cominu [comix@users.sourceforge.net]
+ *
+ * http://www.hydrogen-music.org
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY, without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ */
+
+
+#include "sampler_variants.h"
+
+#include <unistd.h>
+
+#include <hydrogen/basics/sample_cache.h>
+
+namespace H2Core
+{
+
+const char* SamplerVariants::__class_name = "SamplerVariants";
+
+const int SamplerVariants::PITCHED_REQUESTS;
+const unsigned SamplerVariants::IDLE_CYCLES;
+
+/** idle time of the builder thread, in microseconds */
+static const int SAMPLER_VARIANTS_IDLE = 10000;
+
+SamplerVariants::SamplerVariants( int nVariants, Builder builder, void* pContext )
+	: Object( __class_name ),
+	  __variants( nVariants ),
+	  __builder( builder ),
+	  __context( pContext ),
+	  __quit( false ),
+	  __cycle( 0 ),
+	  __ready( 0 )
+{
+	for ( auto& variant : __variants ) {
+		variant.state.store( FREE );
+		variant.fStep = 1.0;
+		variant.nSampleRate = 0;
+		variant.bPitched = false;
+		variant.nRequests.store( 0 );
+		variant.nUsed = 0;
+	}
+	INFOLOG( QString( "%1 variants" ).arg( nVariants ) );
+
+	if ( pthread_create( &__thread, nullptr, builder_thread, this ) != 0 ) {
+		ERRORLOG( "Can't create the variant builder thread, the samples will be resampled while playing" );
+		__quit.store( true );
+	}
+}
+
+SamplerVariants::~SamplerVariants()
+{
+	if ( !__quit.load() ) {
+		__quit.store( true );
+		pthread_join( __thread, nullptr );
+	}
+}
+
+int SamplerVariants::find( const std::shared_ptr<SampleData>& pSource, float fStep, int nSampleRate, bool bPitched )
+{
+	int nFree = -1;
+	for ( unsigned i = 0; i < __variants.size(); ++i ) {
+		Variant& variant = __variants[ i ];
+		int nState = variant.state.load( std::memory_order_acquire );
+		if ( nState == FREE ) {
+			if ( nFree < 0 ) {
+				nFree = i;
+			}
+			continue;
+		}
+		if ( ( nState != REQUESTED && nState != READY )
+			 || variant.pSource != pSource || variant.fStep != fStep || variant.nSampleRate != nSampleRate ) {
+			continue;
+		}
+		variant.nUsed = __cycle;
+		if ( nState == READY ) {
+			return i;
+		}
+		variant.nRequests.fetch_add( 1, std::memory_order_relaxed );
+		return -1;
+	}
+	if ( nFree < 0 || __quit.load( std::memory_order_relaxed ) ) {
+		return -1;
+	}
+	// the builder thread cleared the previous source, taking a
+	// reference does not free anything
+	Variant& variant = __variants[ nFree ];
+	variant.pSource = pSource;
+	variant.fStep = fStep;
+	variant.nSampleRate = nSampleRate;
+	variant.bPitched = bPitched;
+	variant.nRequests.store( 1, std::memory_order_relaxed );
+	variant.nUsed = __cycle;
+	variant.state.store( REQUESTED, std::memory_order_release );
+	return -1;
+}
+
+const SampleData* SamplerVariants::use( int nVariant, const SampleData* pSource, float fStep, int nSampleRate )
+{
+	if ( nVariant < 0 ) {
+		return nullptr;
+	}
+	Variant& variant = __variants[ nVariant ];
+	if ( variant.state.load( std::memory_order_acquire ) != READY
+		 || variant.pSource.get() != pSource || variant.fStep != fStep || variant.nSampleRate != nSampleRate ) {
+		return nullptr;
+	}
+	variant.nUsed = __cycle;
+	return variant.pData.get();
+}
+
+void SamplerVariants::collect( int nSampleRate )
+{
+	int nReady = 0;
+	for ( auto& variant : __variants ) {
+		int nState = variant.state.load( std::memory_order_acquire );
+		if ( nState != REQUESTED && nState != READY ) {
+			continue;
+		}
+		if ( variant.nSampleRate != nSampleRate || __cycle - variant.nUsed > IDLE_CYCLES ) {
+			// the builder thread only moves a variant from
+			// REQUESTED to READY, which fails once it is CLOSING
+			variant.state.store( CLOSING, std::memory_order_release );
+		} else if ( nState == READY ) {
+			nReady++;
+		}
+	}
+	__ready.store( nReady, std::memory_order_relaxed );
+	__cycle++;
+}
+
+void* SamplerVariants::builder_thread( void* pParam )
+{
+	static_cast<SamplerVariants*>( pParam )->work();
+	return nullptr;
+}
+
+void SamplerVariants::work()
+{
+	while ( !__quit.load() ) {
+		bool bBusy = false;
+		for ( auto& variant : __variants ) {
+			if ( __quit.load() ) {
+				break;
+			}
+			int nState = variant.state.load( std::memory_order_acquire );
+			if ( nState == REQUESTED && variant.pData == nullptr
+				 && ( !variant.bPitched || variant.nRequests.load( std::memory_order_relaxed ) >= PITCHED_REQUESTS ) ) {
+				variant.pData = __builder( __context, *variant.pSource, variant.fStep, variant.nSampleRate );
+				if ( variant.pData != nullptr ) {
+					int nExpected = REQUESTED;
+					variant.state.compare_exchange_strong( nExpected, READY, std::memory_order_acq_rel );
+					bBusy = true;
+				}
+			} else if ( nState == CLOSING ) {
+				variant.pData.reset();
+				variant.pSource.reset();
+				variant.state.store( FREE, std::memory_order_release );
+			}
+		}
+		if ( !bBusy ) {
+			usleep( SAMPLER_VARIANTS_IDLE );
+		}
+	}
+}
+
+};
+
+/* vim: set softtabstop=4 noexpandtab: */
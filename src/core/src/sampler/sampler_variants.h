@@ -0,0 +1,148 @@
+/*
+ * Hydrogen
+ * Copyright(c) 2002-2008 by Alex >Comix< Cominu [comix@users.sourceforge.net]
+ *
+ * http://www.hydrogen-music.org
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY, without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ */
+
+
+#ifndef H2C_SAMPLER_VARIANTS_H
+#define H2C_SAMPLER_VARIANTS_H
+
+#include <hydrogen/object.h>
+
+#include <atomic>
+#include <memory>
+#include <pthread.h>
+#include <vector>
+
+namespace H2Core
+{
+
+class SampleData;
+
+/**
+ * Copies of sample data resampled in the background.
+ *
+ * A voice playing a sample at another rate than the driver's, or at
+ * another pitch, has to interpolate every frame it plays. The Sampler
+ * asks for a copy of the data resampled for that rate and pitch when
+ * such a note starts, and the notes starting once it is built play the
+ * copy as it is.
+ *
+ * A copy for the driver rate alone is built as soon as it is asked
+ * for, a pitched one only once it was asked for #PITCHED_REQUESTS
+ * times, so that humanized pitches do not fill the cache with copies
+ * used by a single note.
+ *
+ * The variants are claimed, checked and collected by the audio thread
+ * only. The builder thread only builds REQUESTED variants and releases
+ * CLOSING ones, so the data of a READY variant stays valid until the
+ * next collect().
+ */
+class SamplerVariants : public H2Core::Object
+{
+		H2_OBJECT
+	public:
+		/** requests needed before a pitched variant is built */
+		static const int PITCHED_REQUESTS = 4;
+		/** cycles an unused variant is kept */
+		static const unsigned IDLE_CYCLES = 8192;
+
+		/**
+		 * Resamples \a source by \a fStep for the rate \a
+		 * nSampleRate. Called by the builder thread.
+		 */
+		typedef std::shared_ptr<SampleData> ( *Builder )( void* pContext, const SampleData& source,
+														   float fStep, int nSampleRate );
+
+		/**
+		 * constructor, starts the builder thread
+		 * \param nVariants number of variants kept at the same time
+		 * \param builder resamples the data
+		 * \param pContext passed to \a builder
+		 */
+		SamplerVariants( int nVariants, Builder builder, void* pContext );
+		/** destructor, joins the builder thread and releases the data */
+		~SamplerVariants();
+
+		/**
+		 * looks for the variant of \a pSource resampled by \a
+		 * fStep for \a nSampleRate, asking for it if there is
+		 * none. Audio thread only.
+		 * \param bPitched true if \a fStep is not only due to the
+		 * sample rate
+		 * \return the variant, -1 if it is not built yet
+		 */
+		int find( const std::shared_ptr<SampleData>& pSource, float fStep, int nSampleRate, bool bPitched );
+		/**
+		 * checks that \a nVariant is still the variant of \a
+		 * pSource for \a fStep and \a nSampleRate, and keeps it
+		 * from being collected. Audio thread only.
+		 * \return its data, nullptr if it is gone
+		 */
+		const SampleData* use( int nVariant, const SampleData* pSource, float fStep, int nSampleRate );
+		/**
+		 * releases the variants not used for #IDLE_CYCLES cycles
+		 * and those of another rate than \a nSampleRate. Called
+		 * by the audio thread at the end of a cycle.
+		 */
+		void collect( int nSampleRate );
+
+		/** \return number of variants ready to be played */
+		int get_ready() const { return __ready.load( std::memory_order_relaxed ); }
+
+	private:
+		enum State {
+			FREE,			///< may be claimed by find()
+			REQUESTED,		///< claimed, the builder thread has to build it
+			READY,			///< built
+			CLOSING			///< the builder thread has to release it
+		};
+
+		struct Variant {
+			std::atomic<int> state;
+			// set by find()
+			std::shared_ptr<SampleData> pSource;
+			float fStep;
+			int nSampleRate;
+			bool bPitched;
+			std::atomic<int> nRequests;
+			unsigned nUsed;					///< last cycle the variant was asked for
+			// set by the builder thread
+			std::shared_ptr<SampleData> pData;
+		};
+
+		static void* builder_thread( void* pParam );
+		/** body of the builder thread */
+		void work();
+
+		std::vector<Variant> __variants;
+		Builder __builder;
+		void* __context;
+		pthread_t __thread;
+		std::atomic<bool> __quit;
+		unsigned __cycle;					///< incremented by collect()
+		std::atomic<int> __ready;
+};
+
+};
+
+#endif // H2C_SAMPLER_VARIANTS_H
+
+/* vim: set softtabstop=4 noexpandtab: */
@@ -0,0 +1,221 @@
+/*
+ * Hydrogen
+ * Copyright(c) 2002-2008 by Alex >Comix< Cominu [comix@users.sourceforge.net]
+ *
+ * http://www.hydrogen-music.org
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY, without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ */
+
+
+#include "sampler_voices.h"
+
+#include <hydrogen/basics/instrument.h>
+#include <hydrogen/basics/note.h>
+
+namespace H2Core
+{
+
+const char* SamplerVoices::__class_name = "SamplerVoices";
+
+SamplerVoices::SamplerVoices( int nCapacity )
+	: Object( __class_name )
+	, __size( 0 )
+{
+	__slots.resize( nCapacity > 0 ? nCapacity : 1 );
+	// at most half full, the probe sequences stay short
+	int nBits = 3;
+	while ( ( 1 << nBits ) < 2 * capacity() ) {
+		++nBits;
+	}
+	__mask = ( 1u << nBits ) - 1;
+	__shift = 64 - nBits;
+	for ( int list = 0; list < LISTS; ++list ) {
+		__heads[ list ].resize( __mask + 1 );
+	}
+	clear();
+}
+
+SamplerVoices::~SamplerVoices()
+{
+}
+
+void SamplerVoices::clear()
+{
+	for ( Slot& slot : __slots ) {
+		slot.pNote = nullptr;
+		for ( int list = 0; list < LISTS; ++list ) {
+			slot.links[ list ].bLinked = false;
+		}
+	}
+	__size = 0;
+	for ( int list = 0; list < LISTS; ++list ) {
+		for ( Head& head : __heads[ list ] ) {
+			head.key = 0;
+			head.nFirst = -1;
+			head.nLast = -1;
+		}
+	}
+}
+
+bool SamplerVoices::add( Note* pNote )
+{
+	if ( __size == capacity() ) {
+		return false;
+	}
+	int nSlot = __size++;
+	Slot& slot = __slots[ nSlot ];
+	slot.pNote = pNote;
+
+	link( AGE, nSlot, 0 );
+	Instrument* pInstr = pNote->get_instrument();
+	link( INSTRUMENT, nSlot, key( pInstr ) );
+	if ( pInstr != nullptr && pInstr->get_mute_group() != -1 ) {
+		link( MUTE_GROUP, nSlot, pInstr->get_mute_group() );
+	}
+	if ( pNote->get_midi_msg() != -1 ) {
+		link( MIDI_KEY, nSlot, pNote->get_midi_msg() );
+	}
+	return true;
+}
+
+void SamplerVoices::remove( int nSlot )
+{
+	for ( int list = 0; list < LISTS; ++list ) {
+		unlink( ( List )list, nSlot );
+	}
+
+	int nLast = --__size;
+	if ( nSlot != nLast ) {
+		// the last note takes the freed slot, its neighbours and
+		// heads follow
+		__slots[ nSlot ] = __slots[ nLast ];
+		for ( int list = 0; list < LISTS; ++list ) {
+			const Link& slotLink = __slots[ nSlot ].links[ list ];
+			if ( !slotLink.bLinked ) {
+				continue;
+			}
+			Head& head = __heads[ list ][ find( ( List )list, slotLink.key ) ];
+			if ( slotLink.nPrev != -1 ) {
+				__slots[ slotLink.nPrev ].links[ list ].nNext = nSlot;
+			} else {
+				head.nFirst = nSlot;
+			}
+			if ( slotLink.nNext != -1 ) {
+				__slots[ slotLink.nNext ].links[ list ].nPrev = nSlot;
+			} else {
+				head.nLast = nSlot;
+			}
+		}
+	}
+	__slots[ nLast ].pNote = nullptr;
+	for ( int list = 0; list < LISTS; ++list ) {
+		__slots[ nLast ].links[ list ].bLinked = false;
+	}
+}
+
+int SamplerVoices::first( List list, intptr_t key ) const
+{
+	return __heads[ list ][ find( list, key ) ].nFirst;
+}
+
+unsigned SamplerVoices::home( intptr_t key ) const
+{
+	// Fibonacci hashing, the pointers and small numbers used as keys
+	// spread over the whole table
+	return ( ( uint64_t )key * 0x9E3779B97F4A7C15ull ) >> __shift;
+}
+
+int SamplerVoices::find( List list, intptr_t key ) const
+{
+	const std::vector<Head>& heads = __heads[ list ];
+	unsigned nEntry = home( key );
+	while ( heads[ nEntry ].nFirst != -1 && heads[ nEntry ].key != key ) {
+		nEntry = ( nEntry + 1 ) & __mask;
+	}
+	return nEntry;
+}
+
+void SamplerVoices::erase( List list, int nEntry )
+{
+	std::vector<Head>& heads = __heads[ list ];
+	unsigned nFree = nEntry;
+	unsigned nProbe = nEntry;
+	for ( ;; ) {
+		nProbe = ( nProbe + 1 ) & __mask;
+		if ( heads[ nProbe ].nFirst == -1 ) {
+			break;
+		}
+		// an entry stays where it is if its home lies between the
+		// free entry and itself
+		unsigned nHome = home( heads[ nProbe ].key );
+		bool bStays = ( nFree <= nProbe ) ? ( nFree < nHome && nHome <= nProbe )
+			: ( nFree < nHome || nHome <= nProbe );
+		if ( !bStays ) {
+			heads[ nFree ] = heads[ nProbe ];
+			nFree = nProbe;
+		}
+	}
+	heads[ nFree ].nFirst = -1;
+	heads[ nFree ].nLast = -1;
+}
+
+void SamplerVoices::link( List list, int nSlot, intptr_t key )
+{
+	Link& slotLink = __slots[ nSlot ].links[ list ];
+	slotLink.key = key;
+	slotLink.nNext = -1;
+	slotLink.bLinked = true;
+
+	Head& head = __heads[ list ][ find( list, key ) ];
+	if ( head.nFirst == -1 ) {
+		head.key = key;
+		head.nFirst = nSlot;
+		slotLink.nPrev = -1;
+	} else {
+		slotLink.nPrev = head.nLast;
+		__slots[ head.nLast ].links[ list ].nNext = nSlot;
+	}
+	head.nLast = nSlot;
+}
+
+void SamplerVoices::unlink( List list, int nSlot )
+{
+	Link& slotLink = __slots[ nSlot ].links[ list ];
+	if ( !slotLink.bLinked ) {
+		return;
+	}
+	int nEntry = find( list, slotLink.key );
+	Head& head = __heads[ list ][ nEntry ];
+	if ( slotLink.nPrev != -1 ) {
+		__slots[ slotLink.nPrev ].links[ list ].nNext = slotLink.nNext;
+	} else {
+		head.nFirst = slotLink.nNext;
+	}
+	if ( slotLink.nNext != -1 ) {
+		__slots[ slotLink.nNext ].links[ list ].nPrev = slotLink.nPrev;
+	} else {
+		head.nLast = slotLink.nPrev;
+	}
+	if ( head.nFirst == -1 ) {
+		erase( list, nEntry );
+	}
+	slotLink.bLinked = false;
+}
+
+};
+
+/* vim: set softtabstop=4 noexpandtab: */
@@ -0,0 +1,136 @@
+/*
+ * Hydrogen
+ * Copyright(c) 2002-2008 by Alex >Comix< Cominu [comix@users.sourceforge.net]
+ *
+ * http://www.hydrogen-music.org
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY, without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ */
+
+
+#ifndef H2C_SAMPLER_VOICES_H
+#define H2C_SAMPLER_VOICES_H
+
+#include <hydrogen/object.h>
+
+#include <cstdint>
+#include <vector>
+
+namespace H2Core
+{
+
+class Note;
+
+/**
+ * The notes played by the Sampler.
+ *
+ * The notes are kept in a fixed number of slots, the first size()
+ * of them being used. Removing a note moves the last one into its
+ * slot, so adding and removing never shift the others nor
+ * allocate.
+ *
+ * Each note is also linked into intrusive lists, in the order the
+ * notes were added: all the notes, the notes of its instrument, of
+ * its mute group and of its MIDI key. Releasing the notes of an
+ * instrument or a mute group, or finding the oldest note to steal,
+ * thus only visits the notes involved. The heads of the lists are
+ * kept in fixed size hash tables.
+ *
+ * Used by the audio thread, or with the AudioEngine locked.
+ */
+class SamplerVoices : public H2Core::Object
+{
+		H2_OBJECT
+	public:
+		/** the lists a note is linked into */
+		enum List {
+			AGE,			///< all the notes, a single list of key 0
+			INSTRUMENT,		///< by Note::get_instrument()
+			MUTE_GROUP,		///< by Instrument::get_mute_group(), unless -1
+			MIDI_KEY,		///< by Note::get_midi_msg(), unless -1
+			LISTS
+		};
+
+		/** \param nCapacity number of notes played at most */
+		SamplerVoices( int nCapacity );
+		~SamplerVoices();
+
+		int capacity() const { return __slots.size(); }
+		int size() const { return __size; }
+		/** \return the note of a used slot */
+		Note* get( int nSlot ) const { return __slots[ nSlot ].pNote; }
+
+		/**
+		 * adds \a pNote after all the others, the mute group being
+		 * the one of its instrument right now
+		 * \return false if all the slots are used
+		 */
+		bool add( Note* pNote );
+		/** removes the note of \a nSlot, the last note takes its slot */
+		void remove( int nSlot );
+		/** forgets all the notes */
+		void clear();
+
+		/**
+		 * \return the slot of the oldest note of \a key in \a
+		 * list, -1 if none. Use key( Instrument* ) for #INSTRUMENT.
+		 */
+		int first( List list, intptr_t key ) const;
+		/** \return the slot of the next newer note in the same list, -1 if none */
+		int next( List list, int nSlot ) const { return __slots[ nSlot ].links[ list ].nNext; }
+
+		/** \return the key of \a p in the #INSTRUMENT list */
+		static intptr_t key( const void* p ) { return reinterpret_cast<intptr_t>( p ); }
+
+	private:
+		struct Link {
+			intptr_t key;
+			int nPrev;
+			int nNext;
+			bool bLinked;
+		};
+		struct Slot {
+			Note* pNote;
+			Link links[ LISTS ];
+		};
+		/** oldest and newest note of a key, unused if nFirst is -1 */
+		struct Head {
+			intptr_t key;
+			int nFirst;
+			int nLast;
+		};
+
+		/** \return the entry \a key is looked up from */
+		unsigned home( intptr_t key ) const;
+		/** \return the entry of \a key in \a list, or the free entry it would take */
+		int find( List list, intptr_t key ) const;
+		/** drops the entry \a nEntry of \a list, moving back the ones probed past it */
+		void erase( List list, int nEntry );
+		void link( List list, int nSlot, intptr_t key );
+		void unlink( List list, int nSlot );
+
+		std::vector<Slot> __slots;
+		int __size;
+		std::vector<Head> __heads[ LISTS ];	///< open addressing, a power of two each
+		unsigned __mask;
+		int __shift;
+};
+
+};
+
+#endif // H2C_SAMPLER_VOICES_H
+
+/* vim: set softtabstop=4 noexpandtab: */
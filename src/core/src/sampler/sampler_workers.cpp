@@ -0,0 +1,242 @@
+/*
+ * Hydrogen
+ * Copyright(c) 2002-2008 by Alex >Comix< Cominu [comix@users.sourceforge.net]
+ *
+ * http://www.hydrogen-music.org
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY, without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ */
+
+
+#include "sampler_workers.h"
+
+#include <cerrno>
+#include <chrono>
+#include <sched.h>
+
+namespace H2Core
+{
+
+/** time the calling thread spins for the jobs in progress before blocking */
+static const uint64_t SAMPLER_WORKERS_SPIN_NS = 20000;
+/** a wait longer than this makes the following runs serial */
+static const uint64_t SAMPLER_WORKERS_LATE_NS = 1000000;
+/** number of runs rendered by the calling thread alone after a late one */
+static const int SAMPLER_WORKERS_SERIAL_RUNS = 1000;
+
+const char* SamplerWorkers::__class_name = "SamplerWorkers";
+
+static inline uint64_t now()
+{
+	return std::chrono::duration_cast<std::chrono::nanoseconds>(
+		std::chrono::steady_clock::now().time_since_epoch() ).count();
+}
+
+void SamplerWorkers::Semaphore::init()
+{
+#ifdef __APPLE__
+	__sem = dispatch_semaphore_create( 0 );
+#else
+	sem_init( &__sem, 0, 0 );
+#endif
+}
+
+void SamplerWorkers::Semaphore::destroy()
+{
+#ifdef __APPLE__
+	dispatch_release( __sem );
+#else
+	sem_destroy( &__sem );
+#endif
+}
+
+void SamplerWorkers::Semaphore::post()
+{
+#ifdef __APPLE__
+	dispatch_semaphore_signal( __sem );
+#else
+	sem_post( &__sem );
+#endif
+}
+
+void SamplerWorkers::Semaphore::wait()
+{
+#ifdef __APPLE__
+	dispatch_semaphore_wait( __sem, DISPATCH_TIME_FOREVER );
+#else
+	while ( sem_wait( &__sem ) != 0 && errno == EINTR ) {
+	}
+#endif
+}
+
+SamplerWorkers::SamplerWorkers( int nThreads, int nPriority )
+	: Object( __class_name ),
+	  __quit( false ),
+	  __generation( 0 ),
+	  __serial_runs( 0 ),
+	  __late_runs( 0 ),
+	  __claim( 0 ),
+	  __job( nullptr ),
+	  __context( nullptr ),
+	  __jobs( 0 ),
+	  __done( 0 )
+{
+	__finished.init();
+
+	// the threads keep a pointer to their entry
+	__threads.resize( nThreads );
+
+	for ( int i = 0; i < nThreads; ++i ) {
+		Thread* pThread = &__threads[ i ];
+		pThread->pWorkers = this;
+		pThread->nWorker = i + 1;
+		pThread->wake.init();
+
+		pthread_attr_t attr;
+		pthread_attr_init( &attr );
+		if ( nPriority > 0 ) {
+			struct sched_param sched;
+			sched.sched_priority = nPriority;
+			pthread_attr_setinheritsched( &attr, PTHREAD_EXPLICIT_SCHED );
+			pthread_attr_setschedpolicy( &attr, SCHED_FIFO );
+			pthread_attr_setschedparam( &attr, &sched );
+		}
+		int res = pthread_create( &pThread->thread, &attr, thread_func, pThread );
+		pthread_attr_destroy( &attr );
+		if ( res != 0 && nPriority > 0 ) {
+			WARNINGLOG( QString( "Can't set realtime scheduling for sampler worker %1" ).arg( pThread->nWorker ) );
+			res = pthread_create( &pThread->thread, nullptr, thread_func, pThread );
+		}
+		if ( res != 0 ) {
+			ERRORLOG( QString( "Can't create sampler worker %1" ).arg( pThread->nWorker ) );
+			pThread->wake.destroy();
+			__threads.resize( i );
+			break;
+		}
+	}
+	INFOLOG( QString( "%1 sampler workers started" ).arg( __threads.size() ) );
+}
+
+SamplerWorkers::~SamplerWorkers()
+{
+	__quit.store( true, std::memory_order_release );
+	for ( auto& thread : __threads ) {
+		thread.wake.post();
+	}
+	for ( auto& thread : __threads ) {
+		pthread_join( thread.thread, nullptr );
+		thread.wake.destroy();
+	}
+	__threads.clear();
+
+	__finished.destroy();
+}
+
+void* SamplerWorkers::thread_func( void* pParam )
+{
+	Thread* pThread = static_cast<Thread*>( pParam );
+	SamplerWorkers* pWorkers = pThread->pWorkers;
+	// logging from the jobs must not allocate
+	logger()->register_thread();
+
+	for ( ;; ) {
+		pThread->wake.wait();
+		if ( pWorkers->__quit.load( std::memory_order_acquire ) ) {
+			break;
+		}
+		// a worker woken late finds the jobs claimed, or the claim
+		// counter of a later run it will be woken for again
+		uint32_t nGeneration = pWorkers->__claim.load( std::memory_order_acquire ) >> 32;
+		if ( pWorkers->work( nGeneration, pThread->nWorker ) ) {
+			pWorkers->__finished.post();
+		}
+	}
+	return nullptr;
+}
+
+bool SamplerWorkers::work( uint32_t nGeneration, int nWorker )
+{
+	bool bLast = false;
+	uint64_t nClaim = __claim.load( std::memory_order_acquire );
+	for ( ;; ) {
+		// a late worker may see the next run, the generation keeps it
+		// from stealing jobs it has not been woken for
+		int nJobs = __jobs.load( std::memory_order_relaxed );
+		if ( ( uint32_t )( nClaim >> 32 ) != nGeneration || ( int )( uint32_t )nClaim >= nJobs ) {
+			return bLast;
+		}
+		if ( __claim.compare_exchange_weak( nClaim, nClaim + 1, std::memory_order_acq_rel, std::memory_order_acquire ) ) {
+			Job job = __job.load( std::memory_order_relaxed );
+			job( __context.load( std::memory_order_relaxed ), ( int )( uint32_t )nClaim, nWorker );
+			bLast = __done.fetch_add( 1, std::memory_order_acq_rel ) + 1 == nJobs;
+			nClaim = __claim.load( std::memory_order_acquire );
+		}
+	}
+}
+
+void SamplerWorkers::run( Job job, void* pContext, int nJobs )
+{
+	if ( nJobs <= 0 ) {
+		return;
+	}
+
+	if ( __threads.empty() || __serial_runs > 0 ) {
+		if ( __serial_runs > 0 ) {
+			--__serial_runs;
+		}
+		for ( int nJob = 0; nJob < nJobs; ++nJob ) {
+			job( pContext, nJob, 0 );
+		}
+		return;
+	}
+
+	__job.store( job, std::memory_order_relaxed );
+	__context.store( pContext, std::memory_order_relaxed );
+	__jobs.store( nJobs, std::memory_order_relaxed );
+	__done.store( 0, std::memory_order_relaxed );
+
+	// only the calling thread changes the generation
+	uint32_t nGeneration = ++__generation;
+	__claim.store( ( uint64_t )nGeneration << 32, std::memory_order_release );
+
+	for ( auto& thread : __threads ) {
+		thread.wake.post();
+	}
+
+	// the jobs no worker has started yet are rendered here
+	if ( work( nGeneration, 0 ) ) {
+		return;
+	}
+
+	// All the jobs are claimed, the workers are still rendering some
+	// of them. The one completing the last job posts #__finished.
+	uint64_t nStart = now();
+	uint64_t nWaited = 0;
+	while ( __done.load( std::memory_order_acquire ) < nJobs && nWaited < SAMPLER_WORKERS_SPIN_NS ) {
+		nWaited = now() - nStart;
+	}
+	__finished.wait();
+
+	nWaited = now() - nStart;
+	if ( nWaited > SAMPLER_WORKERS_LATE_NS ) {
+		__late_runs.fetch_add( 1, std::memory_order_relaxed );
+		__serial_runs = SAMPLER_WORKERS_SERIAL_RUNS;
+	}
+}
+
+};
+
+/* vim: set softtabstop=4 noexpandtab: */
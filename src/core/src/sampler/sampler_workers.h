@@ -0,0 +1,149 @@
+/*
+ * Hydrogen
+ * Copyright(c) 2002-2008 by Alex >Comix< Cominu [comix@users.sourceforge.net]
+ *
+ * http://www.hydrogen-music.org
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY, without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ */
+
+
+#ifndef H2C_SAMPLER_WORKERS_H
+#define H2C_SAMPLER_WORKERS_H
+
+#include <hydrogen/object.h>
+
+#include <atomic>
+#include <cstdint>
+#include <pthread.h>
+#include <vector>
+
+#ifdef __APPLE__
+#include <dispatch/dispatch.h>
+#else
+#include <semaphore.h>
+#endif
+
+namespace H2Core
+{
+
+/**
+ * Worker threads used by the Sampler to render voices in parallel.
+ *
+ * run() hands a number of independent jobs to the workers and to
+ * the calling thread, which takes part as worker 0, and returns once
+ * all of them are done. Jobs are claimed one by one from a shared
+ * counter, so which thread renders a job is not deterministic: a job
+ * must only write to memory owned by it. The calling thread claims
+ * jobs as well, so whatever no worker has started yet is rendered by
+ * it and it only ever waits for jobs already in progress.
+ *
+ * The workers run with real-time priority when the system allows it.
+ * They are woken by semaphores and left unpinned, so the scheduler
+ * is free to move a worker away from the core of the audio thread.
+ * The calling thread spins shortly for the jobs in progress, then
+ * blocks, leaving its core to them. If a run had to wait too long
+ * the following ones are rendered by the calling thread alone for a
+ * while, see get_late_runs().
+ */
+class SamplerWorkers : public H2Core::Object
+{
+		H2_OBJECT
+	public:
+		/** a job, \a nWorker is in [0;get_threads()] */
+		typedef void ( *Job )( void* pContext, int nJob, int nWorker );
+
+		/**
+		 * constructor, starts the threads
+		 * \param nThreads number of threads besides the calling one
+		 * \param nPriority SCHED_FIFO priority, 0 for normal scheduling
+		 */
+		SamplerWorkers( int nThreads, int nPriority );
+		/** destructor, joins the threads */
+		~SamplerWorkers();
+
+		/** number of threads besides the calling one */
+		int get_threads() const;
+
+		/**
+		 * run \a nJobs jobs and wait for them to complete
+		 * \param job the function called for each job
+		 * \param pContext passed to \a job
+		 * \param nJobs number of jobs
+		 */
+		void run( Job job, void* pContext, int nJobs );
+
+		/** \return number of runs the workers were late for */
+		int get_late_runs() const;
+
+	private:
+		/** counting semaphore, unnamed ones are not available on macOS */
+		class Semaphore {
+			public:
+				void init();
+				void destroy();
+				void post();
+				void wait();
+			private:
+#ifdef __APPLE__
+				dispatch_semaphore_t __sem;
+#else
+				sem_t __sem;
+#endif
+		};
+
+		struct Thread {
+			SamplerWorkers* pWorkers;
+			int nWorker;
+			pthread_t thread;
+			Semaphore wake;						///< posted once per run
+		};
+
+		static void* thread_func( void* pParam );
+		/**
+		 * claim and run jobs of generation \a nGeneration until none is left
+		 * \return true if the last job of the run was completed by this call
+		 */
+		bool work( uint32_t nGeneration, int nWorker );
+
+		std::vector<Thread> __threads;
+		Semaphore __finished;					///< posted by the worker completing the last job of a run
+		std::atomic<bool> __quit;
+		uint32_t __generation;					///< last started run, only used by the calling thread
+		int __serial_runs;						///< runs left to render without the workers
+		std::atomic<int> __late_runs;
+		std::atomic<uint64_t> __claim;			///< generation in the upper, next job in the lower 32 bits
+		std::atomic<Job> __job;
+		std::atomic<void*> __context;
+		std::atomic<int> __jobs;
+		std::atomic<int> __done;
+};
+
+inline int SamplerWorkers::get_threads() const
+{
+	return __threads.size();
+}
+
+inline int SamplerWorkers::get_late_runs() const
+{
+	return __late_runs.load( std::memory_order_relaxed );
+}
+
+};
+
+#endif // H2C_SAMPLER_WORKERS_H
+
+/* vim: set softtabstop=4 noexpandtab: */
@@ -54,6 +54,12 @@ AudioEngineInfoForm::AudioEngineInfoForm(QWidget* parent)
 
 	setWindowTitle( tr( "Audio Engine Info" ) );
 
+	QFont fixedFont( "Monospace" );
+	fixedFont.setStyleHint( QFont::TypeWriter );
+	m_pDspStagesLbl->setFont( fixedFont );
+	m_pDspVoicesLbl->setFont( fixedFont );
+	connect( m_pDspResetBtn, SIGNAL( clicked() ), this, SLOT( resetDspProfiler() ) );
+
 	updateInfo();
 
 	timer = new QTimer(this);
@@ -116,6 +122,8 @@ void AudioEngineInfoForm::updateInfo()
 	sprintf(tmp, "%#.2f / %#.2f  (%d%%)", pEngine->getProcessTime(), pEngine->getMaxProcessTime(), perc );
 	processTimeLbl->setText(tmp);
 
+	updateDspProfile();
+
 	// Song state
 	if (pSong == nullptr) {
 		songStateLbl->setText( "NULL song" );
@@ -200,7 +208,15 @@ void AudioEngineInfoForm::updateInfo()
 
 	// SAMPLER
 	Sampler *pSampler = AudioEngine::get_instance()->get_sampler();
-	sampler_playingNotesLbl->setText(QString( "%1 / %2" ).arg(pSampler->get_playing_notes_number()).arg(Preferences::get_instance()->m_nMaxNotes));
+	QString sPlayingNotes = QString( "%1 / %2" ).arg(pSampler->get_playing_notes_number()).arg(Preferences::get_instance()->m_nMaxNotes);
+	if ( pSampler->has_streams() ) {
+		sPlayingNotes += QString( ", %1 streamed, %2 underruns" )
+			.arg( pSampler->get_active_streams() ).arg( pSampler->get_stream_underruns() );
+	}
+	if ( pSampler->get_resampled_variants() > 0 ) {
+		sPlayingNotes += QString( ", %1 resampled" ).arg( pSampler->get_resampled_variants() );
+	}
+	sampler_playingNotesLbl->setText( sPlayingNotes );
 
 	// Synth
 	Synth *pSynth = AudioEngine::get_instance()->get_synth();
@@ -215,6 +231,69 @@ void AudioEngineInfoForm::updateInfo()
 /**
  * Update engineStateLbl with the current audio engine state
  */
+void AudioEngineInfoForm::updateDspProfile()
+{
+	DspProfiler* pProfiler = Hydrogen::get_instance()->getDspProfiler();
+	if ( pProfiler == nullptr ) {
+		m_pDspStagesLbl->setText( "N/A" );
+		m_pDspVoicesLbl->setText( "" );
+		return;
+	}
+
+	// p50 / p99 / max of every stage over the last cycles
+	QString sStages = QString( "%1 %2 %3 %4\n" )
+		.arg( "", -12 ).arg( "p50", 7 ).arg( "p99", 7 ).arg( "max", 7 );
+	for ( int nStage = 0; nStage < DspProfiler::STAGES; ++nStage ) {
+		DspProfiler::Stats stats = pProfiler->get_stats( nStage );
+		QString sName = DspProfiler::stage_name( nStage );
+		if ( nStage >= DspProfiler::LADSPA_SLOT && nStage < DspProfiler::METERING ) {
+			// only the slots which ran lately
+			if ( stats.samples == 0 ) {
+				continue;
+			}
+			sName = QString( "  FX %1" ).arg( nStage - DspProfiler::LADSPA_SLOT + 1 );
+		}
+		sStages += QString( "%1 %2 %3 %4\n" )
+			.arg( sName, -12 )
+			.arg( stats.p50, 7, 'f', 3 )
+			.arg( stats.p99, 7, 'f', 3 )
+			.arg( stats.max, 7, 'f', 3 );
+	}
+	m_pDspStagesLbl->setText( sStages );
+
+	// sampler timings by number of playing voices
+	QString sVoices = QString( "%1 %2 %3 %4\n" )
+		.arg( "Voices", -7 ).arg( "cycles", 8 ).arg( "mean", 7 ).arg( "max", 7 );
+	for ( int nBucket = 0; nBucket < DspProfiler::VOICE_BUCKETS; ++nBucket ) {
+		DspProfiler::VoiceBucket bucket = pProfiler->get_voice_bucket( nBucket );
+		QString sRange;
+		if ( nBucket == DspProfiler::VOICE_BUCKETS - 1 ) {
+			sRange = QString( "%1+" ).arg( bucket.min_voices );
+		} else if ( bucket.min_voices <= 1 ) {
+			sRange = QString::number( bucket.min_voices );
+		} else {
+			sRange = QString( "%1-%2" ).arg( bucket.min_voices ).arg( bucket.min_voices * 2 - 1 );
+		}
+		sVoices += QString( "%1 %2 %3 %4\n" )
+			.arg( sRange, -7 )
+			.arg( bucket.cycles, 8 )
+			.arg( bucket.mean, 7, 'f', 3 )
+			.arg( bucket.max, 7, 'f', 3 );
+	}
+	m_pDspVoicesLbl->setText( sVoices );
+}
+
+
+void AudioEngineInfoForm::resetDspProfiler()
+{
+	DspProfiler* pProfiler = Hydrogen::get_instance()->getDspProfiler();
+	if ( pProfiler != nullptr ) {
+		pProfiler->reset();
+	}
+	updateDspProfile();
+}
+
+
 void AudioEngineInfoForm::updateAudioEngineState() {
 	// Audio Engine state
 	QString stateTxt;
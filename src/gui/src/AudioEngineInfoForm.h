@@ -45,6 +45,8 @@ class AudioEngineInfoForm : public QWidget, public Ui_AudioEngineInfoForm_UI, pu
 		QTimer *timer;
 
 		virtual void updateAudioEngineState();
+		/// shows the stage timings of the audio engine DspProfiler
+		void updateDspProfile();
 
 		// EventListener implementation
 		virtual void stateChangedEvent(int nState);
@@ -60,6 +62,7 @@ class AudioEngineInfoForm : public QWidget, public Ui_AudioEngineInfoForm_UI, pu
 
 	public slots:
 		void updateInfo();
+		void resetDspProfiler();
 };
 
 #endif
@@ -23,9 +23,12 @@
 #include <hydrogen/basics/sample.h>
 #include <hydrogen/basics/song.h>
 #include <hydrogen/basics/instrument.h>
+#include <hydrogen/basics/sample_peak_cache.h>
+#include <hydrogen/basics/sample_peaks.h>
 using namespace H2Core;
 
 #include "SampleWaveDisplay.h"
+#include "../HydrogenApp.h"
 #include "../Skin.h"
 
 const char* SampleWaveDisplay::__class_name = "SampleWaveDisplay";
@@ -34,6 +37,7 @@ SampleWaveDisplay::SampleWaveDisplay(QWidget* pParent)
  : QWidget( pParent )
  , Object( __class_name )
  , m_sSampleName( "" )
+ , m_bPeaksPending( false )
 {
 //	setAttribute(Qt::WA_NoBackground);
 
@@ -48,7 +52,9 @@ SampleWaveDisplay::SampleWaveDisplay(QWidget* pParent)
 	}
 
 	m_pPeakData = new int[ w ];
+	memset( m_pPeakData, 0, w * sizeof( m_pPeakData[0] ) );
 
+	HydrogenApp::get_instance()->addEventListener( this );
 }
 
 
@@ -58,6 +64,7 @@ SampleWaveDisplay::~SampleWaveDisplay()
 {
 	//INFOLOG( "DESTROY" );
 
+	HydrogenApp::get_instance()->removeEventListener( this );
 	delete[] m_pPeakData;
 }
 
@@ -87,49 +94,43 @@ void SampleWaveDisplay::paintEvent(QPaintEvent *ev)
 
 void SampleWaveDisplay::updateDisplay( QString filename )
 {
+	m_sFilename = filename;
 
-	Sample *pNewSample = Sample::load( filename );
-
-	if ( pNewSample ) {
-		// Extract the filename from the complete path
-		QString sName = filename;
-		int nPos = sName.lastIndexOf( "/" );
-
-		if ( sName.endsWith("emptySample.wav")){
-			m_sSampleName = "";
-		}else
-		{
-			m_sSampleName = sName.mid( nPos + 1, sName.length() );
-		}
-
-//		INFOLOG( "[updateDisplay] sample: " + m_sSampleName  );
-
-		int nSampleLength = pNewSample->get_frames();
-		float nScaleFactor = nSampleLength / width();
-
-		float fGain = height() / 2.0 * 1.0;
-
-		float *pSampleData = pNewSample->get_data_l();
-
-		int nSamplePos =0;
-		int nVal;
-		for ( int i = 0; i < width(); ++i ){
-			nVal = 0;
-			for ( int j = 0; j < nScaleFactor; ++j ) {
-				if ( j < nSampleLength ) {
-					int newVal = static_cast<int>( pSampleData[ nSamplePos ] * fGain );
-					if ( newVal > nVal ) {
-						nVal = newVal;
-					}
-				}
-				++nSamplePos;
-			}
-			m_pPeakData[ i ] = nVal;
-		}
+	// Extract the filename from the complete path
+	QString sName = filename;
+	int nPos = sName.lastIndexOf( "/" );
+
+	if ( sName.endsWith("emptySample.wav")){
+		m_sSampleName = "";
+	}else
+	{
+		m_sSampleName = sName.mid( nPos + 1, sName.length() );
+	}
+
+//	INFOLOG( "[updateDisplay] sample: " + m_sSampleName  );
+
+	// summarized in the background without decoding the whole
+	// file, drawn once ready
+	std::shared_ptr<SamplePeaks> pPeaks = SamplePeakCache::get_instance()->get( filename );
+	m_bPeaksPending = pPeaks == nullptr;
+
+	float fGain = height() / 2.0 * 1.0;
+
+	std::vector<SamplePeaks::Peak> peaks( width(), SamplePeaks::Peak{ 0, 0, 0 } );
+	if ( pPeaks != nullptr ) {
+		pPeaks->get_peaks( 0, 0, pPeaks->get_frames() / ( double )width(), width(), peaks.data() );
+	}
+	for ( int i = 0; i < width(); ++i ){
+		m_pPeakData[ i ] = std::max( 0, static_cast<int>( peaks[ i ].max * fGain ) );
 	}
 
-	delete pNewSample;
 	update();
 
 }
 
+void SampleWaveDisplay::samplePeaksReadyEvent()
+{
+	if ( m_bPeaksPending ) {
+		updateDisplay( m_sFilename );
+	}
+}
@@ -28,10 +28,11 @@
 #  include <QtWidgets>
 #endif
 #include <hydrogen/object.h>
+#include "../EventListener.h"
 
 
 
-class SampleWaveDisplay : public QWidget, public H2Core::Object
+class SampleWaveDisplay : public QWidget, public H2Core::Object, public EventListener
 {
 	H2_OBJECT
 	Q_OBJECT
@@ -44,10 +45,15 @@ class SampleWaveDisplay : public QWidget, public H2Core::Object
 
 		void paintEvent(QPaintEvent *ev);
 
+		virtual void samplePeaksReadyEvent() override;
+
 	private:
 		QPixmap m_Background;
 		QString m_sSampleName;
 		int *	m_pPeakData;
+		QString m_sFilename;
+		/** the peaks of the file are being computed, see H2Core::SamplePeakCache */
+		bool	m_bPeaksPending;
 };
 
 
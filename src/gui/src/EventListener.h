@@ -40,12 +40,16 @@ class EventListener
 		virtual void metronomeEvent( int nValue ) { UNUSED( nValue ); }
 		virtual void rubberbandbpmchangeEvent() {}
 		virtual void progressEvent( int nValue ) { UNUSED( nValue ); }
+		virtual void progressRateEvent( int nValue ) { UNUSED( nValue ); }
 		virtual void jacksessionEvent( int nValue) { UNUSED( nValue ); }
 		virtual void playlistLoadSongEvent( int nIndex ){ UNUSED( nIndex ); }
 		virtual void undoRedoActionEvent( int nValue ){ UNUSED( nValue ); }
 		virtual void tempoChangedEvent( int nValue ){ UNUSED( nValue ); }
 		virtual void updateSongEvent( int nValue ){ UNUSED( nValue ); }
 		virtual void quitEvent( int nValue ){ UNUSED( nValue ); }
+		virtual void drumkitLoadProgressEvent( int nValue ){ UNUSED( nValue ); }
+		virtual void drumkitLoadedEvent( int nValue ){ UNUSED( nValue ); }
+		virtual void samplePeaksReadyEvent(){}
 
 		virtual ~EventListener() {}
 };
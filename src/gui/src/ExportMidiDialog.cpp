@@ -91,13 +91,13 @@ QString ExportMidiDialog::createDefaultFilename()
 	if( sDefaultFilename.isEmpty() ){
 		sDefaultFilename = m_pEngine->getSong()->__name;
 	} else {
-		// extracting filename from full path
+		// extracting filename without its extension from full path,
+		// either songs_ext or songs_bin_ext
 		QFileInfo qDefaultFile( sDefaultFilename ); 
-		sDefaultFilename = qDefaultFile.fileName();
+		sDefaultFilename = qDefaultFile.completeBaseName();
 	}
 
 	sDefaultFilename.replace( '*', "_" );
-	sDefaultFilename.replace( Filesystem::songs_ext, "" );
 	sDefaultFilename += m_sExtension;
 	return sDefaultFilename;
 }
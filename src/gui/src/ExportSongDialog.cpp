@@ -45,6 +45,7 @@
 #include <hydrogen/audio_engine.h>
 #include <hydrogen/sampler/Sampler.h>
 #include <hydrogen/event_queue.h>
+#include <hydrogen/fx/Effects.h>
 
 #include <memory>
 
@@ -136,13 +137,13 @@ QString ExportSongDialog::createDefaultFilename()
 	if( sDefaultFilename.isEmpty() ){
 		sDefaultFilename = m_pEngine->getSong()->__name;
 	} else {
-		// extracting filename from full path
+		// extracting filename without its extension from full path,
+		// either songs_ext or songs_bin_ext
 		QFileInfo qDefaultFile( sDefaultFilename ); 
-		sDefaultFilename = qDefaultFile.fileName();
+		sDefaultFilename = qDefaultFile.completeBaseName();
 	}
 
 	sDefaultFilename.replace( '*', "_" );
-	sDefaultFilename.replace( Filesystem::songs_ext, "" );
 	sDefaultFilename += m_sExtension;
 	return sDefaultFilename;
 }
@@ -295,8 +296,14 @@ void ExportSongDialog::on_okBtn_clicked()
 			}
 		}
 
+		// the tracks are rendered along with the song when possible
+		std::map<int, QString> stems;
 		if( exportTypeCombo->currentIndex() == EXPORT_TO_BOTH ){
-			m_bExportTrackouts = true;
+			if( canExportStemsInOnePass() ){
+				stems = stemFilenames();
+			} else {
+				m_bExportTrackouts = true;
+			}
 		}
 		
 		/* arm all tracks for export */
@@ -305,21 +312,30 @@ void ExportSongDialog::on_okBtn_clicked()
 		}
 		
 		m_pEngine->startExportSession( sampleRateCombo->currentText().toInt(), sampleDepthCombo->currentText().toInt());
-		m_pEngine->startExportSong( filename );
+		m_pEngine->startExportSong( filename, stems );
 
 		return;
 	}
 
 	if( exportTypeCombo->currentIndex() == EXPORT_TO_SEPARATE_TRACKS ){
-		m_bExportTrackouts = true;
 		m_pEngine->startExportSession(sampleRateCombo->currentText().toInt(), sampleDepthCombo->currentText().toInt());
+
+		if( canExportStemsInOnePass() ){
+			for (auto i = 0; i < pInstrumentList->size(); i++) {
+				pInstrumentList->get(i)->set_currently_exported( true );
+			}
+			m_pEngine->startExportSong( "", stemFilenames() );
+			return;
+		}
+
+		m_bExportTrackouts = true;
 		exportTracks();
 		return;
 	}
 
 }
 
-bool ExportSongDialog::currentInstrumentHasNotes()
+bool ExportSongDialog::instrumentHasNotes( Instrument* pInstrument )
 {
 	Song *pSong = m_pEngine->getSong();
 	unsigned nPatterns = pSong->get_pattern_list()->size();
@@ -333,7 +349,7 @@ bool ExportSongDialog::currentInstrumentHasNotes()
 			Note *pNote = it->second;
 			assert( pNote );
 
-			if( pNote->get_instrument()->get_id() == pSong->get_instrument_list()->get(m_nInstrument)->get_id() ){
+			if( pNote->get_instrument()->get_id() == pInstrument->get_id() ){
 				bInstrumentHasNotes = true;
 				break;
 			}
@@ -350,7 +366,7 @@ QString ExportSongDialog::findUniqueExportFilenameForInstrument(Instrument* pIns
 	
 	int instrumentOccurence = 0;
 	for(int i=0; i  < pSong->get_instrument_list()->size(); i++ ){
-		if( pSong->get_instrument_list()->get(m_nInstrument)->get_name() == pInstrument->get_name()){
+		if( pSong->get_instrument_list()->get(i)->get_name() == pInstrument->get_name()){
 			instrumentOccurence++;
 		}
 	}
@@ -364,6 +380,64 @@ QString ExportSongDialog::findUniqueExportFilenameForInstrument(Instrument* pIns
 	return uniqueInstrumentName;
 }
 
+QString ExportSongDialog::exportFilenameForInstrument( Instrument* pInstrument )
+{
+	QStringList filenameList =  exportNameTxt->text().split( m_sExtension );
+
+	QString firstItem;
+	if( !filenameList.isEmpty() ){
+		firstItem = filenameList.first();
+	}
+	QString newItem = firstItem + "-" + findUniqueExportFilenameForInstrument( pInstrument );
+
+	return newItem.append( m_sExtension );
+}
+
+bool ExportSongDialog::askToOverwrite( const QString& filename )
+{
+	if ( QFile( filename ).exists() == true && m_bQfileDialog == false && !m_bOverwriteFiles) {
+		int res = QMessageBox::information( this, "Hydrogen", tr( "The file %1 exists. \nOverwrite the existing file?").arg(filename), QMessageBox::Yes | QMessageBox::No | QMessageBox::YesToAll );
+		if (res == QMessageBox::No ) return false;
+		if (res == QMessageBox::YesToAll ) m_bOverwriteFiles = true;
+	}
+	return true;
+}
+
+bool ExportSongDialog::canExportStemsInOnePass()
+{
+#ifdef H2CORE_HAVE_LADSPA
+	// The returns of the effects are only mixed into the song, a
+	// track using them has to be rendered on its own.
+	for ( int nFX = 0; nFX < MAX_FX; nFX++ ) {
+		LadspaFX *pFX = Effects::get_instance()->getLadspaFX( nFX );
+		if ( pFX && pFX->isEnabled() ) {
+			return false;
+		}
+	}
+#endif
+	return true;
+}
+
+std::map<int, QString> ExportSongDialog::stemFilenames()
+{
+	InstrumentList *pInstrumentList = m_pEngine->getSong()->get_instrument_list();
+	std::map<int, QString> stems;
+
+	for ( int i = 0; i < pInstrumentList->size(); i++ ) {
+		Instrument *pInstrument = pInstrumentList->get( i );
+		if( !instrumentHasNotes( pInstrument ) ){
+			continue;
+		}
+
+		QString filename = exportFilenameForInstrument( pInstrument );
+		if( askToOverwrite( filename ) ){
+			stems[ pInstrument->get_id() ] = filename;
+		}
+	}
+
+	return stems;
+}
+
 void ExportSongDialog::exportTracks()
 {
 	Song *pSong = m_pEngine->getSong();
@@ -372,7 +446,7 @@ void ExportSongDialog::exportTracks()
 	if( m_nInstrument < pInstrumentList->size() ){
 		
 		//if a instrument contains no notes we jump to the next instrument
-		bool bInstrumentHasNotes = currentInstrumentHasNotes();
+		bool bInstrumentHasNotes = instrumentHasNotes( pInstrumentList->get( m_nInstrument ) );
 
 		if( !bInstrumentHasNotes ){
 			if( m_nInstrument == pInstrumentList->size() -1 ){
@@ -386,20 +460,10 @@ void ExportSongDialog::exportTracks()
 			}
 		}
 
-		QStringList filenameList =  exportNameTxt->text().split( m_sExtension );
-
-		QString firstItem;
-		if( !filenameList.isEmpty() ){
-			firstItem = filenameList.first();
-		}
-		QString newItem = firstItem + "-" + findUniqueExportFilenameForInstrument( pInstrumentList->get( m_nInstrument ) );
-
-		QString filename = newItem.append( m_sExtension );
+		QString filename = exportFilenameForInstrument( pInstrumentList->get( m_nInstrument ) );
 
-		if ( QFile( filename ).exists() == true && m_bQfileDialog == false && !m_bOverwriteFiles) {
-			int res = QMessageBox::information( this, "Hydrogen", tr( "The file %1 exists. \nOverwrite the existing file?").arg(filename), QMessageBox::Yes | QMessageBox::No | QMessageBox::YesToAll );
-			if (res == QMessageBox::No ) return;
-			if (res == QMessageBox::YesToAll ) m_bOverwriteFiles = true;
+		if ( !askToOverwrite( filename ) ) {
+			return;
 		}
 		
 		if( m_nInstrument > 0 ){
@@ -624,9 +688,23 @@ void ExportSongDialog::progressEvent( int nValue )
 	{
 		closeBtn->setEnabled(true);
 		resampleComboBox->setEnabled(true);
+		m_pProgressBar->setFormat( "%p%" );
 	}
 }
 
+void ExportSongDialog::progressRateEvent( int nValue )
+{
+	AudioOutput *pDriver = Hydrogen::get_instance()->getAudioOutput();
+	if ( pDriver == nullptr || pDriver->getSampleRate() == 0 ) {
+		return;
+	}
+
+	// Frames per second relative to the sample rate gives the speed
+	// of the export compared to realtime playback.
+	float fFactor = (float)nValue / (float)pDriver->getSampleRate();
+	m_pProgressBar->setFormat( QString( "%p% (%1x)" ).arg( fFactor, 0, 'f', 1 ) );
+}
+
 void ExportSongDialog::toggleRubberbandBatchMode(bool toggled)
 {
 	m_pPreferences->setRubberBandBatchMode(toggled);
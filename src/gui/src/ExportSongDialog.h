@@ -29,6 +29,8 @@
 #include "EventListener.h"
 #include <hydrogen/object.h>
 
+#include <map>
+
 namespace H2Core {
 	class Instrument;
 	class Hydrogen;
@@ -48,6 +50,7 @@ class ExportSongDialog : public QDialog, public Ui_ExportSongDialog_UI, public E
 		~ExportSongDialog();
 
 		virtual void progressEvent( int nValue );
+		virtual void progressRateEvent( int nValue );
 
 
 private slots:
@@ -69,9 +72,13 @@ private:
 	void		saveSettingsToPreferences();
 	void		restoreSettingsFromPreferences();
 	
-	bool		currentInstrumentHasNotes();
+	bool		instrumentHasNotes( H2Core::Instrument* pInstrument );
 	QString		findUniqueExportFilenameForInstrument(H2Core::Instrument* pInstrument);
+	QString		exportFilenameForInstrument( H2Core::Instrument* pInstrument );
+	bool		askToOverwrite( const QString& filename );
 
+	bool		canExportStemsInOnePass();
+	std::map<int, QString>	stemFilenames();
 	void		exportTracks();
 	bool 		validateUserInput();
 	QString		createDefaultFilename();
@@ -78,6 +78,7 @@ HydrogenApp::HydrogenApp( MainForm *pMainForm, Song *pFirstSong )
  , m_pPlaylistDialog( nullptr )
  , m_pSampleEditor( nullptr )
  , m_pDirector( nullptr )
+ , m_nDroppedEvents( 0 )
 
 {
 	m_pInstance = this;
@@ -480,8 +481,21 @@ void HydrogenApp::onEventQueueTimer()
 	// use the timer to do schedule instrument slaughter;
 	EventQueue *pQueue = EventQueue::get_instance();
 
-	Event event;
-	while ( ( event = pQueue->pop_event() ).type != EVENT_NONE ) {
+	if ( pQueue->get_dropped_events() != m_nDroppedEvents ) {
+		m_nDroppedEvents = pQueue->get_dropped_events();
+		WARNINGLOG( QString( "%1 events dropped so far, the queue held up to %2 of %3 events" )
+					.arg( m_nDroppedEvents ).arg( pQueue->get_high_water_mark() ).arg( MAX_EVENTS ) );
+	}
+
+	// note lengths recorded since the last timeout, it locks the song
+	Hydrogen::get_instance()->applyRecordedNoteLengths();
+
+	// Take everything queued since the last timeout at once. Events
+	// pushed while the listeners run are handled next time.
+	Event events[ MAX_EVENTS ];
+	int nEvents = pQueue->pop_events( events, MAX_EVENTS );
+	for ( int nEvent = 0; nEvent < nEvents; ++nEvent ) {
+		const Event& event = events[ nEvent ];
 		
 		// Provide the event to all EventListeners registered to
 		// HydrogenApp. By registering itself as EventListener and
@@ -547,6 +561,10 @@ void HydrogenApp::onEventQueueTimer()
 				pListener->progressEvent( event.value );
 				break;
 
+			case EVENT_PROGRESS_RATE:
+				pListener->progressRateEvent( event.value );
+				break;
+
 			case EVENT_JACK_SESSION:
 				pListener->jacksessionEvent( event.value );
 				break;
@@ -571,6 +589,18 @@ void HydrogenApp::onEventQueueTimer()
 				pListener->quitEvent( event.value );
 				break;
 
+			case EVENT_DRUMKIT_LOAD_PROGRESS:
+				pListener->drumkitLoadProgressEvent( event.value );
+				break;
+
+			case EVENT_DRUMKIT_LOADED:
+				pListener->drumkitLoadedEvent( event.value );
+				break;
+
+			case EVENT_SAMPLE_PEAKS_READY:
+				pListener->samplePeaksReadyEvent();
+				break;
+
 			default:
 				ERRORLOG( QString("[onEventQueueTimer] Unhandled event: %1").arg( event.type ) );
 			}
@@ -605,6 +635,25 @@ void HydrogenApp::onEventQueueTimer()
 		pQueue->m_addMidiNoteVector.erase(pQueue->m_addMidiNoteVector.begin());
 
 	}
+
+	updateMeters();
+}
+
+void HydrogenApp::updateMeters()
+{
+	Meters* pMeters = Hydrogen::get_instance()->getMeters();
+	if ( pMeters == nullptr ) {
+		return;
+	}
+	// the only reader of the meters, the peaks of the cycles it
+	// did not take are summed up by the audio thread meanwhile
+	const Meters::Frame* pLevels = pMeters->take();
+	if ( m_pMixer != nullptr && m_pMixer->isVisible() ) {
+		m_pMixer->updateMixer( pLevels );
+	}
+	if ( m_pSongEditorPanel != nullptr ) {
+		m_pSongEditorPanel->updatePlaybackFaderPeaks( pLevels );
+	}
 }
 
 
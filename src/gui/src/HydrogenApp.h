@@ -159,6 +159,8 @@ class HydrogenApp : public QObject, public EventListener, public H2Core::Object
 		     EventListener::rubberbandbpmchangeEvent()
 		 * - H2Core::EVENT_PROGRESS -> 
 		     EventListener::progressEvent()
+		 * - H2Core::EVENT_PROGRESS_RATE -> 
+		     EventListener::progressRateEvent()
 		 * - H2Core::EVENT_JACK_SESSION -> 
 		     EventListener::jacksessionEvent()
 		 * - H2Core::EVENT_PLAYLIST_LOADSONG -> 
@@ -174,12 +176,20 @@ class HydrogenApp : public QObject, public EventListener, public H2Core::Object
 		 * In addition, all MIDI notes in
 		 * H2Core::EventQueue::m_addMidiNoteVector will converted into
 		 * actions via SE_addNoteAction() and deleted from the
-		 * former array.
+		 * former array. Finally the meters are updated, see
+		 * updateMeters().
 		*/
 		void onEventQueueTimer();
 		void currentTabChanged(int);
 
 	private:
+		/**
+		 * Take the levels published by the audio engine since the
+		 * last call and hand them to the Mixer and the playback
+		 * track fader, called by onEventQueueTimer().
+		 */
+		void updateMeters();
+
 		static HydrogenApp *		m_pInstance;	///< HydrogenApp instance
 
 #ifdef H2CORE_HAVE_LADSPA
@@ -201,6 +211,8 @@ class HydrogenApp : public QObject, public EventListener, public H2Core::Object
 		Director *			m_pDirector;
 		QTimer *			m_pEventQueueTimer;
 		std::vector<EventListener*> 	m_EventListeners;
+		/** EventQueue::get_dropped_events() at the last warning. */
+		unsigned			m_nDroppedEvents;
 		QTabWidget *			m_pTab;
 		QSplitter *			m_pSplitter;
 
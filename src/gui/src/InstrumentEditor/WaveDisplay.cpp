@@ -24,9 +24,12 @@
 #include <hydrogen/basics/song.h>
 #include <hydrogen/basics/instrument.h>
 #include <hydrogen/basics/instrument_layer.h>
+#include <hydrogen/basics/sample_peak_cache.h>
+#include <hydrogen/basics/sample_peaks.h>
 using namespace H2Core;
 
 #include "WaveDisplay.h"
+#include "../HydrogenApp.h"
 #include "../Skin.h"
 
 const char* WaveDisplay::__class_name = "WaveDisplay";
@@ -37,6 +40,7 @@ WaveDisplay::WaveDisplay(QWidget* pParent)
  , m_nCurrentWidth( 0 )
  , m_sSampleName( "-" )
  , m_pLayer( nullptr )
+ , m_bPeaksPending( false )
  , m_SampleNameAlignment( Qt::AlignCenter )
 {
 	setAttribute(Qt::WA_NoBackground);
@@ -50,6 +54,8 @@ WaveDisplay::WaveDisplay(QWidget* pParent)
 
 	m_pPeakData = new int[ width() ];
 	memset( m_pPeakData, 0, width() * sizeof( m_pPeakData[0] ) );
+
+	HydrogenApp::get_instance()->addEventListener( this );
 }
 
 
@@ -59,6 +65,7 @@ WaveDisplay::~WaveDisplay()
 {
 	//INFOLOG( "DESTROY" );
 
+	HydrogenApp::get_instance()->removeEventListener( this );
 	delete[] m_pPeakData;
 }
 
@@ -131,31 +138,22 @@ void WaveDisplay::updateDisplay( H2Core::InstrumentLayer *pLayer )
 
 		//INFOLOG( "[updateDisplay] sample: " + m_sSampleName  );
 
-		int nSampleLength = pLayer->get_sample()->get_frames();
-		int nScaleFactor = nSampleLength / m_nCurrentWidth;
-
 		float fGain = height() / 2.0 * pLayer->get_gain();
 
-		float *pSampleData = pLayer->get_sample()->get_data_l();
-
-		int nSamplePos =0;
-		int nVal;
-		for ( int i = 0; i < width(); ++i ){
-			nVal = 0;
-			for ( int j = 0; j < nScaleFactor; ++j ) {
-				if ( j < nSampleLength ) {
-					int newVal = (int)( pSampleData[ nSamplePos ] * fGain );
-					if ( newVal > nVal ) {
-						nVal = newVal;
-					}
-				}
-				++nSamplePos;
-			}
-			m_pPeakData[ i ] = nVal;
+		// summarized in the background, drawn once ready
+		std::shared_ptr<SamplePeaks> pPeaks = SamplePeakCache::get_instance()->get( pLayer->get_sample() );
+		m_bPeaksPending = pPeaks == nullptr;
+		std::vector<SamplePeaks::Peak> peaks( m_nCurrentWidth, SamplePeaks::Peak{ 0, 0, 0 } );
+		if ( pPeaks != nullptr ) {
+			pPeaks->get_peaks( 0, 0, pPeaks->get_frames() / ( double )m_nCurrentWidth, m_nCurrentWidth, peaks.data() );
+		}
+		for ( int i = 0; i < m_nCurrentWidth; ++i ){
+			m_pPeakData[ i ] = std::max( 0, (int)( peaks[ i ].max * fGain ) );
 		}
 	}
 	else {
 		m_sSampleName = "-";
+		m_bPeaksPending = false;
 		for ( int i =0; i < m_nCurrentWidth; ++i ){
 			m_pPeakData[ i ] = 0;
 		}
@@ -165,6 +163,13 @@ void WaveDisplay::updateDisplay( H2Core::InstrumentLayer *pLayer )
 	update();
 }
 
+void WaveDisplay::samplePeaksReadyEvent()
+{
+	if ( m_bPeaksPending && m_pLayer != nullptr ) {
+		updateDisplay( m_pLayer );
+	}
+}
+
 void WaveDisplay::mouseDoubleClickEvent(QMouseEvent *ev)
 {
 	if (ev->button() == Qt::LeftButton) {
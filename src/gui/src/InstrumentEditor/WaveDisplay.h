@@ -28,13 +28,14 @@
 #  include <QtWidgets>
 #endif
 #include <hydrogen/object.h>
+#include "../EventListener.h"
 
 namespace H2Core
 {
 	class InstrumentLayer;
 }
 
-class WaveDisplay : public QWidget, public H2Core::Object
+class WaveDisplay : public QWidget, public H2Core::Object, public EventListener
 {
     H2_OBJECT
 	Q_OBJECT
@@ -51,6 +52,8 @@ class WaveDisplay : public QWidget, public H2Core::Object
 		
 		void			setSampleNameAlignment(Qt::AlignmentFlag flag);
 
+		virtual void	samplePeaksReadyEvent() override;
+
 	signals:
 		void doubleClicked(QWidget *pWidget);
 
@@ -67,6 +70,8 @@ class WaveDisplay : public QWidget, public H2Core::Object
 		int							m_nCurrentWidth;
 		
 		H2Core::InstrumentLayer *	m_pLayer;
+		/** the peaks of the sample are being computed, see H2Core::SamplePeakCache */
+		bool						m_bPeaksPending;
 };
 
 inline void WaveDisplay::setSampleNameAlignment(Qt::AlignmentFlag flag)
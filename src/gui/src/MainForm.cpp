@@ -24,6 +24,7 @@
 #include <hydrogen/version.h>
 #include <hydrogen/hydrogen.h>
 #include <hydrogen/audio_engine.h>
+#include <hydrogen/LocalFileMng.h>
 #include <hydrogen/smf/SMF.h>
 #include <hydrogen/Preferences.h>
 #include <hydrogen/timeline.h>
@@ -33,6 +34,7 @@
 #include <hydrogen/basics/instrument_list.h>
 #include <hydrogen/basics/instrument_layer.h>
 #include <hydrogen/basics/drumkit_component.h>
+#include <hydrogen/basics/drumkit_index.h>
 #include <hydrogen/basics/playlist.h>
 #include <hydrogen/lilypond/lilypond.h>
 
@@ -83,6 +85,7 @@
 
 #include <memory>
 #include <cassert>
+#include <system_error>
 
 using namespace std;
 using namespace H2Core;
@@ -221,6 +224,10 @@ MainForm::MainForm( QApplication *app, const QString& songFilename )
 
 MainForm::~MainForm()
 {
+	if ( m_saveThread.joinable() ) {
+		m_saveThread.join();
+	}
+
 	// remove the autosave file
 	QFile file( getAutoSaveFilename() );
 	file.remove();
@@ -446,6 +453,7 @@ void MainForm::onLashPollTimer()
 				filenameSong = QString::fromLocal8Bit( songFilename.c_str() );
 				song->set_filename( filenameSong );
 				action_file_save();
+				waitForSave();
 
 				client->sendEvent(LASH_Save_File);
 
@@ -579,7 +587,7 @@ void MainForm::action_file_save_as()
 
 	if ( !filename.isEmpty() ) {
 		QString sNewFilename = filename;
-		if ( sNewFilename.endsWith( Filesystem::songs_ext ) == false ) {
+		if ( sNewFilename.endsWith( Filesystem::songs_ext ) == false && sNewFilename.endsWith( Filesystem::songs_bin_ext ) == false ) {
 			filename += Filesystem::songs_ext;
 		}
 
@@ -602,24 +610,73 @@ void MainForm::action_file_save()
 		return action_file_save_as();
 	}
 
-	bool saved = false;
-	saved = pSong->save( filename );
+	saveSong( filename, false );
+}
+
+
+void MainForm::saveSong( const QString& sFilename, bool bAutosave )
+{
+	// one song written at a time, the previous one is usually done
+	waitForSave();
+
+	Song *pSong = Hydrogen::get_instance()->getSong();
+	SongWriter writer;
+	AudioEngine::get_instance()->lock_song();
+	QByteArray data = writer.serializeSong( pSong, sFilename );
+	if ( !bAutosave ) {
+		// edited while being written, the song is modified again
+		pSong->set_is_modified( false );
+	}
+	AudioEngine::get_instance()->unlock_song();
+
+	auto write = [this, sFilename, bAutosave, data]() {
+		bool bSaved = SongWriter::writeFile( sFilename, data ) == 0;
+		QMetaObject::invokeMethod( this, "onSongSaved", Qt::QueuedConnection,
+								   Q_ARG( QString, sFilename ), Q_ARG( bool, bAutosave ), Q_ARG( bool, bSaved ) );
+	};
+	try {
+		m_saveThread = std::thread( write );
+	} catch ( const std::system_error& e ) {
+		WARNINGLOG( QString( "Unable to start the save thread, writing %1 here: %2" ).arg( sFilename ).arg( e.what() ) );
+		write();
+	}
+}
+
+
+void MainForm::waitForSave()
+{
+	if ( m_saveThread.joinable() ) {
+		m_saveThread.join();
+	}
+	// reports it right away
+	QCoreApplication::sendPostedEvents( this, QEvent::MetaCall );
+}
 
 
-	if(! saved) {
+void MainForm::onSongSaved( const QString& sFilename, bool bAutosave, bool bSaved )
+{
+	if ( bAutosave ) {
+		return;
+	}
+
+	Song *pSong = Hydrogen::get_instance()->getSong();
+	if( !bSaved ) {
+		if ( pSong->get_filename() == sFilename ) {
+			pSong->set_is_modified( true );
+		}
 		QMessageBox::warning( this, "Hydrogen", tr("Could not save song.") );
 	} else {
-		Preferences::get_instance()->setLastSongFilename( pSong->get_filename() );
+		Preferences::get_instance()->setLastSongFilename( sFilename );
 
 		// add the new loaded song in the "last used song" vector
 		Preferences *pPref = Preferences::get_instance();
 		vector<QString> recentFiles = pPref->getRecentFiles();
-		recentFiles.insert( recentFiles.begin(), filename );
+		recentFiles.insert( recentFiles.begin(), sFilename );
 		pPref->setRecentFiles( recentFiles );
 
 		updateRecentUsedSongList();
 
-		h2app->setScrollStatusBarMessage( tr("Song saved.") + QString(" Into: ") + filename, 2000 );
+		h2app->setScrollStatusBarMessage( tr("Song saved.") + QString(" Into: ") + sFilename, 2000 );
 		EventQueue::get_instance()->push_event( EVENT_METRONOME, 3 );
 	}
 }
@@ -1033,38 +1090,9 @@ void MainForm::action_instruments_saveLibrary()
 	QString sDrumkitName = Hydrogen::get_instance()->getCurrentDrumkitname();
 	Drumkit *pDrumkitInfo = nullptr;
 
-	//User drumkit list
-	QStringList usr_dks = Filesystem::usr_drumkit_list();
-	for (int i = 0; i < usr_dks.size(); ++i) {
-		QString absPath = Filesystem::usr_drumkits_dir() + usr_dks[i];
-		Drumkit *pInfo = Drumkit::load( absPath, false );
-		if (pInfo) {
-			if ( QString(pInfo->get_name() ) == sDrumkitName ){
-				pDrumkitInfo = pInfo;
-				break;
-			}
-		}
-		
-		// Since Drumkit::load() calls New Drumkit() internally, we
-		// have to take care of destroying it manually.
-		delete pInfo;
-	}
-
-	// System drumkit list
-	QStringList sys_dks = Filesystem::sys_drumkit_list();
-	for (int i = 0; i < sys_dks.size(); ++i) {
-		QString absPath = Filesystem::sys_drumkits_dir() + sys_dks[i];
-		Drumkit *pInfo = Drumkit::load( absPath, false );
-		if (pInfo) {
-			if ( QString( pInfo->get_name() ) == sDrumkitName ){
-				pDrumkitInfo = pInfo;
-				break;
-			}
-		}
-		
-		// Since Drumkit::load() calls New Drumkit() internally, we
-		// have to take care of destroying it manually.
-		delete pInfo;
+	DrumkitIndex::Entry entry;
+	if ( DrumkitIndex::get_instance()->find( sDrumkitName, &entry ) ) {
+		pDrumkitInfo = Drumkit::load( entry.path, false );
 	}
 
 	if ( pDrumkitInfo != nullptr ){
@@ -1087,8 +1115,6 @@ void MainForm::action_instruments_saveLibrary()
 	//HydrogenApp::get_instance()->getInstrumentRack()->getSoundLibraryPanel()->test_expandedItems();
 	HydrogenApp::get_instance()->getInstrumentRack()->getSoundLibraryPanel()->updateDrumkitList();
 
-	// Cleaning up the last pInfo we did not deleted due to the break
-	// statement.
 	delete pDrumkitInfo;
 
 }
@@ -1752,6 +1778,7 @@ void MainForm::jacksessionEvent( int nEvent )
 	switch (nEvent){
 	case 0:
 		action_file_save();
+		waitForSave();
 		break;
 	case 1:
 		action_file_exit();
@@ -1806,10 +1833,11 @@ QString MainForm::getAutoSaveFilename()
 	Song *pSong = Hydrogen::get_instance()->getSong();
 	assert( pSong );
 	QString sOldFilename = pSong->get_filename();
-	QString newName = "autosave.h2song";
+	// the binary format keeps the autosave of large songs short
+	QString newName = "autosave" + Filesystem::songs_bin_ext;
 
 	if ( !sOldFilename.isEmpty() ) {
-		newName = sOldFilename.left( sOldFilename.length() - 7 ) + ".autosave.h2song";
+		newName = sOldFilename.left( sOldFilename.lastIndexOf( '.' ) ) + ".autosave" + Filesystem::songs_bin_ext;
 	}
 
 	return newName;
@@ -1820,13 +1848,7 @@ QString MainForm::getAutoSaveFilename()
 void MainForm::onAutoSaveTimer()
 {
 	//INFOLOG( "[onAutoSaveTimer]" );
-	Song *pSong = Hydrogen::get_instance()->getSong();
-	assert( pSong );
-	QString sOldFilename = pSong->get_filename();
-
-	pSong->save( getAutoSaveFilename() );
-
-	pSong->set_filename(sOldFilename);
+	saveSong( getAutoSaveFilename(), true );
 }
 
 
@@ -1873,7 +1895,7 @@ bool MainForm::handleUnsavedChanges()
 				// never been saved
 				action_file_save_as();
 			}
-			// save
+			waitForSave();
 			break;
 		case 1: // Discard clicked or Alt+D pressed
 			// don't save but exit
@@ -1972,38 +1994,9 @@ void MainForm::action_banks_properties()
 	QString sDrumkitName = Hydrogen::get_instance()->getCurrentDrumkitname();
 	Drumkit *pDrumkitInfo = nullptr;
 
-	//User drumkit list
-	QStringList usr_dks = Filesystem::usr_drumkit_list();
-	for (int i = 0; i < usr_dks.size(); ++i) {
-		QString absPath = Filesystem::usr_drumkits_dir() + usr_dks[i];
-		Drumkit *pInfo = Drumkit::load( absPath );
-		if (pInfo) {
-			if ( QString(pInfo->get_name() ) == sDrumkitName ){
-				pDrumkitInfo = pInfo;
-				break;
-			}
-		}
-		
-		// Since Drumkit::load() calls New Drumkit() internally, we
-		// have to take care of destroying it manually.
-		delete pInfo;
-	}
-
-	//System drumkit list
-	QStringList sys_dks = Filesystem::sys_drumkit_list();
-	for (int i = 0; i < sys_dks.size(); ++i) {
-		QString absPath = Filesystem::sys_drumkits_dir() + sys_dks[i];
-		Drumkit *pInfo = Drumkit::load( absPath );
-		if (pInfo) {
-			if ( QString( pInfo->get_name() ) == sDrumkitName ){
-				pDrumkitInfo = pInfo;
-				break;
-			}
-		}
-		
-		// Since Drumkit::load() calls New Drumkit() internally, we
-		// have to take care of destroying it manually.
-		delete pInfo;
+	DrumkitIndex::Entry entry;
+	if ( DrumkitIndex::get_instance()->find( sDrumkitName, &entry ) ) {
+		pDrumkitInfo = Drumkit::load( entry.path );
 	}
 
 	if( pDrumkitInfo )
@@ -2016,7 +2009,5 @@ void MainForm::action_banks_properties()
 		QMessageBox::information( this, "Hydrogen", tr("Retrieving information about drumkit '%1' failed: drumkit does not exist.").arg( sDrumkitName ) );
 	}
 
-	// Cleaning up the last pInfo we did not deleted due to the break
-	// statement.
 	delete pDrumkitInfo;
 }
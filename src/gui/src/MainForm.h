@@ -30,6 +30,7 @@
 #endif
 
 #include <map>
+#include <thread>
 #include <unistd.h>
 
 #include "EventListener.h"
@@ -144,6 +145,7 @@ public slots:
 		void onAutoSaveTimer();
 		void onPlaylistDisplayTimer();
 		void onFixMidiSetup();
+		void onSongSaved( const QString& sFilename, bool bAutosave, bool bSaved );
 
 	protected:
 		// Returns true if handled, false if aborted.
@@ -179,6 +181,17 @@ public slots:
 
 		QTimer		m_AutosaveTimer;
 
+		/** writes the song saved last, see saveSong() */
+		std::thread	m_saveThread;
+		/**
+		 * serializes the song under AudioEngine::lock_song() and
+		 * writes it into \a sFilename on #m_saveThread,
+		 * onSongSaved() reports the outcome
+		 */
+		void saveSong( const QString& sFilename, bool bAutosave );
+		/** waits for the song being written and reports it */
+		void waitForSave();
+
 		/** Create the menubar */
 		void createMenuBar();
 
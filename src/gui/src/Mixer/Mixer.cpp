@@ -149,17 +149,11 @@ Mixer::Mixer( QWidget* pParent )
 	pLayout->addWidget( m_pMasterLine );
 	this->setLayout( pLayout );
 
-
-	m_pUpdateTimer = new QTimer( this );
-	connect( m_pUpdateTimer, SIGNAL( timeout() ), this, SLOT( updateMixer() ) );
-	m_pUpdateTimer->start(50);
-
 	HydrogenApp::get_instance()->addEventListener( this );
 }
 
 Mixer::~Mixer()
 {
-	m_pUpdateTimer->stop();
 }
 
 MixerLine* Mixer::createMixerLine( int nInstr )
@@ -415,7 +409,16 @@ void Mixer::masterVolumeChanged(MasterMixerLine* ref)
 
 
 
-void Mixer::updateMixer()
+/// the published peak if higher than the shown one, else the shown one falling off
+static float fallOffPeak( float fOldPeak, float fNewPeak, float fFallOff )
+{
+	if ( fNewPeak >= fOldPeak ) {
+		return fNewPeak;
+	}
+	return fOldPeak / fFallOff;
+}
+
+void Mixer::updateMixer( const Meters::Frame* pLevels )
 {
 	Preferences *pPref = Preferences::get_instance();
 	bool bShowPeaks = pPref->showInstrumentPeaks();
@@ -462,12 +465,6 @@ void Mixer::updateMixer()
 			Instrument *pInstr = pInstrList->get( nInstr );
 			assert( pInstr );
 
-			float fNewPeak_L = pInstr->get_peak_l();
-			pInstr->set_peak_l( 0.0f );	// reset instrument peak
-
-			float fNewPeak_R = pInstr->get_peak_r();
-			pInstr->set_peak_r( 0.0f );	// reset instrument peak
-
 			float fNewVolume = pInstr->get_volume();
 			bool bMuted = pInstr->is_muted();
 
@@ -477,26 +474,9 @@ void Mixer::updateMixer()
 
 
 			// fader
-			float fOldPeak_L = pLine->getPeak_L();
-			float fOldPeak_R = pLine->getPeak_R();
-
-			if (!bShowPeaks) {
-				fNewPeak_L = 0.0f;
-				fNewPeak_R = 0.0f;
-			}
-
-			if ( fNewPeak_L >= fOldPeak_L) {	// LEFT peak
-				pLine->setPeak_L( fNewPeak_L );
-			}
-			else {
-				pLine->setPeak_L( fOldPeak_L / fallOff );
-			}
-			if ( fNewPeak_R >= fOldPeak_R) {	// Right peak
-				pLine->setPeak_R( fNewPeak_R );
-			}
-			else {
-				pLine->setPeak_R( fOldPeak_R / fallOff );
-			}
+			const Meters::Levels* pInstrLevels = bShowPeaks && pLevels ? pLevels->get( Meters::INSTRUMENT + nInstr ) : nullptr;
+			pLine->setPeak_L( fallOffPeak( pLine->getPeak_L(), pInstrLevels ? pInstrLevels->peak_l : 0.0f, fallOff ) );
+			pLine->setPeak_R( fallOffPeak( pLine->getPeak_R(), pInstrLevels ? pInstrLevels->peak_r : 0.0f, fallOff ) );
 
 			// fader position
 			pLine->setVolume( fNewVolume );
@@ -540,8 +520,8 @@ void Mixer::updateMixer()
 		}
 	}
 
-	for (std::vector<DrumkitComponent*>::iterator it = compoList->begin() ; it != compoList->end(); ++it) {
-		DrumkitComponent* p_compo = *it;
+	for ( int nCompoIdx = 0; nCompoIdx < nCompo; ++nCompoIdx ) {
+		DrumkitComponent* p_compo = ( *compoList )[ nCompoIdx ];
 
 		if( m_pComponentMixerLine.find(p_compo->get_id()) == m_pComponentMixerLine.end() ) {
 			// the mixerline doesn't exists..I'll create a new one!
@@ -556,37 +536,14 @@ void Mixer::updateMixer()
 
 		ComponentMixerLine *pLine = m_pComponentMixerLine[ p_compo->get_id() ];
 
-		float fNewPeak_L = p_compo->get_peak_l();
-		p_compo->set_peak_l( 0.0f );	// reset instrument peak
-
-		float fNewPeak_R = p_compo->get_peak_r();
-		p_compo->set_peak_r( 0.0f );	// reset instrument peak
-
 		float fNewVolume = p_compo->get_volume();
 		bool bMuted = p_compo->is_muted();
 
 		QString sName = p_compo->get_name();
 
-		float fOldPeak_L = pLine->getPeak_L();
-		float fOldPeak_R = pLine->getPeak_R();
-
-		if (!bShowPeaks) {
-			fNewPeak_L = 0.0f;
-			fNewPeak_R = 0.0f;
-		}
-
-		if ( fNewPeak_L >= fOldPeak_L) {	// LEFT peak
-			pLine->setPeak_L( fNewPeak_L );
-		}
-		else {
-			pLine->setPeak_L( fOldPeak_L / fallOff );
-		}
-		if ( fNewPeak_R >= fOldPeak_R) {	// Right peak
-			pLine->setPeak_R( fNewPeak_R );
-		}
-		else {
-			pLine->setPeak_R( fOldPeak_R / fallOff );
-		}
+		const Meters::Levels* pCompoLevels = bShowPeaks && pLevels ? pLevels->get( Meters::COMPONENT + nCompoIdx ) : nullptr;
+		pLine->setPeak_L( fallOffPeak( pLine->getPeak_L(), pCompoLevels ? pCompoLevels->peak_l : 0.0f, fallOff ) );
+		pLine->setPeak_R( fallOffPeak( pLine->getPeak_R(), pCompoLevels ? pCompoLevels->peak_r : 0.0f, fallOff ) );
 
 		// fader position
 		pLine->setVolume( fNewVolume );
@@ -649,30 +606,9 @@ void Mixer::updateMixer()
 
 
 	// update MasterPeak
-	float oldPeak_L = m_pMasterLine->getPeak_L();
-	float newPeak_L = pEngine->getMasterPeak_L();
-	pEngine->setMasterPeak_L(0.0);
-	float oldPeak_R = m_pMasterLine->getPeak_R();
-	float newPeak_R = pEngine->getMasterPeak_R();
-	pEngine->setMasterPeak_R(0.0);
-
-	if (!bShowPeaks) {
-		newPeak_L = 0.0;
-		newPeak_R = 0.0;
-	}
-
-	if (newPeak_L >= oldPeak_L) {
-		m_pMasterLine->setPeak_L( newPeak_L );
-	}
-	else {
-		m_pMasterLine->setPeak_L( oldPeak_L / fallOff );
-	}
-	if (newPeak_R >= oldPeak_R) {
-		m_pMasterLine->setPeak_R(newPeak_R);
-	}
-	else {
-		m_pMasterLine->setPeak_R( oldPeak_R / fallOff );
-	}
+	const Meters::Levels* pMasterLevels = bShowPeaks && pLevels ? pLevels->get( Meters::MASTER ) : nullptr;
+	m_pMasterLine->setPeak_L( fallOffPeak( m_pMasterLine->getPeak_L(), pMasterLevels ? pMasterLevels->peak_l : 0.0f, fallOff ) );
+	m_pMasterLine->setPeak_R( fallOffPeak( m_pMasterLine->getPeak_R(), pMasterLevels ? pMasterLevels->peak_r : 0.0f, fallOff ) );
 
 
 
@@ -692,16 +628,13 @@ void Mixer::updateMixer()
 		LadspaFX *pFX = Effects::get_instance()->getLadspaFX( nFX );
 		if ( pFX ) {
 			m_pLadspaFXLine[nFX]->setName( pFX->getPluginName() );
-			float fNewPeak_L = 0.0;
-			float fNewPeak_R = 0.0;
+			const Meters::Levels* pFXLevels = bShowPeaks && pLevels ? pLevels->get( Meters::FX + nFX ) : nullptr;
 
 			float fOldPeak_L = 0.0;
 			float fOldPeak_R = 0.0;
 			m_pLadspaFXLine[nFX]->getPeaks( &fOldPeak_L, &fOldPeak_R );
-
-			if (fNewPeak_L < fOldPeak_L)	fNewPeak_L = fOldPeak_L / fallOff;
-			if (fNewPeak_R < fOldPeak_R)	fNewPeak_R = fOldPeak_R / fallOff;
-			m_pLadspaFXLine[nFX]->setPeaks( fNewPeak_L, fNewPeak_R );
+			m_pLadspaFXLine[nFX]->setPeaks( fallOffPeak( fOldPeak_L, pFXLevels ? pFXLevels->peak_l : 0.0f, fallOff ),
+											fallOffPeak( fOldPeak_R, pFXLevels ? pFXLevels->peak_r : 0.0f, fallOff ) );
 			m_pLadspaFXLine[nFX]->setFxActive( pFX->isEnabled() );
 			m_pLadspaFXLine[nFX]->setVolume( pFX->getVolume() );
 		}
@@ -32,6 +32,7 @@
 
 #include <hydrogen/object.h>
 #include <hydrogen/globals.h>
+#include <hydrogen/meters.h>
 #include "../EventListener.h"
 
 class Button;
@@ -75,7 +76,12 @@ class Mixer : public QWidget, public EventListener, public H2Core::Object
 		void masterVolumeChanged(MasterMixerLine*);
 		void nameClicked(MixerLine* ref);
 		void nameSelected(MixerLine* ref);
-		void updateMixer();
+		/**
+		 * update all the lines at once
+		 * \param pLevels levels to show, nullptr to let the
+		 * peaks fall off, see HydrogenApp::updateMeters()
+		 */
+		void updateMixer( const H2Core::Meters::Frame* pLevels = nullptr );
 		void showFXPanelClicked(Button* ref);
 		void showPeaksBtnClicked(Button* ref);
 		void ladspaActiveBtnClicked( LadspaFXMixerLine* ref );
@@ -98,8 +104,6 @@ class Mixer : public QWidget, public EventListener, public H2Core::Object
 
 		PixmapWidget *			m_pFXFrame;
 
-		QTimer *				m_pUpdateTimer;
-
 		uint findMixerLineByRef(MixerLine* ref);
 		uint findCompoMixerLineByRef(ComponentMixerLine* ref);
 		MixerLine* createMixerLine( int );
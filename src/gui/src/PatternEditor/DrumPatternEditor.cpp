@@ -62,6 +62,8 @@ DrumPatternEditor::DrumPatternEditor(QWidget* parent, PatternEditorPanel *panel)
  , m_pDraggedNote( nullptr )
  , m_pPattern( nullptr )
  , m_pPatternEditorPanel( panel )
+ , m_pBackground( nullptr )
+ , m_bBackgroundChanged( true )
 {
 	setFocusPolicy(Qt::ClickFocus);
 
@@ -81,6 +83,7 @@ DrumPatternEditor::DrumPatternEditor(QWidget* parent, PatternEditorPanel *panel)
 
 DrumPatternEditor::~DrumPatternEditor()
 {
+	delete m_pBackground;
 }
 
 
@@ -118,6 +121,7 @@ void DrumPatternEditor::updateEditor()
 	resize( nEditorWidth, height() );
 
 	// redraw all
+	m_bBackgroundChanged = true;
 	update( 0, 0, width(), height() );
 }
 
@@ -264,9 +268,10 @@ void DrumPatternEditor::addOrDeleteNoteAction(	int nColumn,
 	Instrument *pSelectedInstrument = pSong->get_instrument_list()->get( row );
 	m_bRightBtnPressed = false;
 
-	AudioEngine::get_instance()->lock( RIGHT_HERE );	// lock the audio engine
+	AudioEngine::get_instance()->lock_song();	// the audio engine keeps playing
 
 	bool bNoteAlreadyExist = false;
+	Note *pPreviewNote = nullptr;
 	if(!isInstrumentMode){
 		Pattern::notes_t* notes = (Pattern::notes_t*)pPattern->get_notes();
 		FOREACH_NOTE_IT_BOUND(notes,it,nColumn) {
@@ -278,6 +283,7 @@ void DrumPatternEditor::addOrDeleteNoteAction(	int nColumn,
 				bNoteAlreadyExist = true;
 				delete pNote;
 				notes->erase( it );
+				pPattern->touch();
 				break;
 			}
 		}
@@ -324,12 +330,17 @@ void DrumPatternEditor::addOrDeleteNoteAction(	int nColumn,
 		}
 		// hear note
 		if ( listen && !isNoteOff ) {
-			Note *pNote2 = new Note( pSelectedInstrument, 0, fVelocity, fPan_L, fPan_R, nLength, fPitch);
-			AudioEngine::get_instance()->get_sampler()->note_on(pNote2);
+			pPreviewNote = new Note( pSelectedInstrument, 0, fVelocity, fPan_L, fPan_R, nLength, fPitch);
 		}
 	}
 	pSong->set_is_modified( true );
-	AudioEngine::get_instance()->unlock(); // unlock the audio engine
+	AudioEngine::get_instance()->unlock_song(); // publish the notes
+
+	if ( pPreviewNote != nullptr ) {
+		AudioEngine::get_instance()->lock( RIGHT_HERE );
+		AudioEngine::get_instance()->get_sampler()->note_on( pPreviewNote );
+		AudioEngine::get_instance()->unlock();
+	}
 
 	// update the selected line
 	int nSelectedInstrument = Hydrogen::get_instance()->getSelectedInstrumentNumber();
@@ -337,7 +348,7 @@ void DrumPatternEditor::addOrDeleteNoteAction(	int nColumn,
 		Hydrogen::get_instance()->setSelectedInstrumentNumber( row );
 	}
 	else {
-		update( 0, 0, width(), height() );
+		update( 0, row * m_nGridHeight, width(), m_nGridHeight );
 		m_pPatternEditorPanel->getVelocityEditor()->updateEditor();
 		m_pPatternEditorPanel->getPanEditor()->updateEditor();
 		m_pPatternEditorPanel->getLeadLagEditor()->updateEditor();
@@ -383,14 +394,15 @@ void DrumPatternEditor::editNoteLengthAction( int nColumn, int nRealColumn, int
 
 	Instrument *pSelectedInstrument = pSong->get_instrument_list()->get( row );
 
-	AudioEngine::get_instance()->lock( RIGHT_HERE );
+	AudioEngine::get_instance()->lock_song();
 	pDraggedNote = pPattern->find_note( nColumn, nRealColumn, pSelectedInstrument, false );
 	if( pDraggedNote ){
 		pDraggedNote->set_length( length );
+		pPattern->touch();
 	}
-	AudioEngine::get_instance()->unlock();
+	AudioEngine::get_instance()->unlock_song();
 
-	update( 0, 0, width(), height() );
+	update( 0, row * m_nGridHeight, width(), m_nGridHeight );
 
 	m_pPatternEditorPanel->getVelocityEditor()->updateEditor();
 	m_pPatternEditorPanel->getPanEditor()->updateEditor();
@@ -417,7 +429,7 @@ void DrumPatternEditor::mouseMoveEvent(QMouseEvent *ev)
 		if ( m_pDraggedNote->get_note_off() ) return;
 		int nTickColumn = getColumn( ev );
 
-		AudioEngine::get_instance()->lock( RIGHT_HERE );	// lock the audio engine
+		AudioEngine::get_instance()->lock_song();	// the audio engine keeps playing
 		int nLen = nTickColumn - (int)m_pDraggedNote->get_position();
 
 		if (nLen <= 0) {
@@ -433,12 +445,13 @@ void DrumPatternEditor::mouseMoveEvent(QMouseEvent *ev)
 			fStep = 1.0;
 		}
 		m_pDraggedNote->set_length( nLen * fStep);
+		m_pPattern->touch();
 
 		Hydrogen::get_instance()->getSong()->set_is_modified( true );
-		AudioEngine::get_instance()->unlock(); // unlock the audio engine
+		AudioEngine::get_instance()->unlock_song(); // publish the new length
 
 		//__draw_pattern();
-		update( 0, 0, width(), height() );
+		update( 0, __row * m_nGridHeight, width(), m_nGridHeight );
 		m_pPatternEditorPanel->getVelocityEditor()->updateEditor();
 		m_pPatternEditorPanel->getPanEditor()->updateEditor();
 		m_pPatternEditorPanel->getLeadLagEditor()->updateEditor();
@@ -457,32 +470,38 @@ void DrumPatternEditor::keyPressEvent (QKeyEvent *ev)
 
 
 ///
-/// Draws a pattern
+/// Draws the grid and the selected row, kept until they change
 ///
-void DrumPatternEditor::__draw_pattern(QPainter& painter)
+void DrumPatternEditor::__draw_background()
 {
 	const UIStyle *pStyle = Preferences::get_instance()->getDefaultUIStyle();
 	const QColor selectedRowColor( pStyle->m_patternEditor_selectedRowColor.getRed(), pStyle->m_patternEditor_selectedRowColor.getGreen(), pStyle->m_patternEditor_selectedRowColor.getBlue() );
 
-	__create_background( painter );
-
-	if (m_pPattern == nullptr) {
-		return;
-	}
-
-	int nNotes = m_pPattern->get_length();
-	int nSelectedInstrument = Hydrogen::get_instance()->getSelectedInstrumentNumber();
 	Song *pSong = Hydrogen::get_instance()->getSong();
-
 	InstrumentList * pInstrList = pSong->get_instrument_list();
 
-
 	if ( m_nEditorHeight != (int)( m_nGridHeight * pInstrList->size() ) ) {
 		// the number of instruments is changed...recreate all
 		m_nEditorHeight = m_nGridHeight * pInstrList->size();
 		resize( width(), m_nEditorHeight );
 	}
 
+	if ( m_pBackground == nullptr || m_pBackground->size() != size() ) {
+		delete m_pBackground;
+		m_pBackground = new QPixmap( size() );
+	}
+	m_bBackgroundChanged = false;
+
+	QPainter painter( m_pBackground );
+	__create_background( painter );
+
+	if (m_pPattern == nullptr) {
+		return;
+	}
+
+	int nNotes = m_pPattern->get_length();
+	int nSelectedInstrument = Hydrogen::get_instance()->getSelectedInstrumentNumber();
+
 	for ( uint nInstr = 0; nInstr < pInstrList->size(); ++nInstr ) {
 		uint y = m_nGridHeight * nInstr;
 		if ( nInstr == (uint)nSelectedInstrument ) {	// selected instrument
@@ -493,8 +512,15 @@ void DrumPatternEditor::__draw_pattern(QPainter& painter)
 
 	// draw the grid
 	__draw_grid( painter );
+}
+
 
 
+///
+/// Draws a pattern
+///
+void DrumPatternEditor::__draw_pattern( QPainter& painter, const QRect& rect )
+{
 	/*
 		BUGFIX
 
@@ -505,22 +531,33 @@ void DrumPatternEditor::__draw_pattern(QPainter& painter)
 	Hydrogen *pEngine = Hydrogen::get_instance();
 	PatternList *pPatternList = pEngine->getSong()->get_pattern_list();
 	int nSelectedPatternNumber = pEngine->getSelectedPatternNumber();
+	H2Core::Pattern *pPattern = nullptr;
 	if ( (nSelectedPatternNumber != -1) && ( (uint)nSelectedPatternNumber < pPatternList->size() ) ) {
-		m_pPattern = pPatternList->get( nSelectedPatternNumber );
+		pPattern = pPatternList->get( nSelectedPatternNumber );
 	}
-	else {
-		m_pPattern = nullptr;
+	if ( pPattern != m_pPattern ) {
+		m_pPattern = pPattern;
+		m_bBackgroundChanged = true;
 	}
 	// ~ FIX
 
+	if ( m_bBackgroundChanged || m_pBackground == nullptr || m_pBackground->size() != size() ) {
+		__draw_background();
+	}
+	painter.drawPixmap( rect, *m_pBackground, rect );
 
+	if ( m_pPattern == nullptr || m_pPattern->get_notes()->size() == 0 ) {
+		return;
+	}
 
-	if( m_pPattern->get_notes()->size() == 0) return;
-
+	// the notes are sorted, those right of rect are not drawn
 	const Pattern::notes_t* notes = m_pPattern->get_notes();
 	FOREACH_NOTE_CST_IT_BEGIN_END(notes,it) {
 		Note *note = it->second;
 		assert( note );
+		if ( 20 + note->get_position() * m_nGridWidth - 4 > rect.right() ) {
+			break;
+		}
 		__draw_note( note, painter );
 	}
 }
@@ -777,13 +814,13 @@ void DrumPatternEditor::__create_background( QPainter& p)
 
 
 
-void DrumPatternEditor::paintEvent( QPaintEvent* /*ev*/ )
+void DrumPatternEditor::paintEvent( QPaintEvent* ev )
 {
 	//INFOLOG( "paint" );
 	//QWidget::paintEvent(ev);
 
 	QPainter painter( this );
-	__draw_pattern( painter );
+	__draw_pattern( painter, ev->rect() );
 }
 
 
@@ -812,6 +849,7 @@ void DrumPatternEditor::setResolution(uint res, bool bUseTriplets)
 	this->m_bUseTriplets = bUseTriplets;
 
 	// redraw all
+	m_bBackgroundChanged = true;
 	update( 0, 0, width(), height() );
 	m_pPatternEditorPanel->getVelocityEditor()->updateEditor();
 	m_pPatternEditorPanel->getPanEditor()->updateEditor();
@@ -849,6 +887,7 @@ void DrumPatternEditor::zoom_out()
 
 void DrumPatternEditor::selectedInstrumentChangedEvent()
 {
+	m_bBackgroundChanged = true;
 	update( 0, 0, width(), height() );
 }
 
@@ -896,6 +935,7 @@ void DrumPatternEditor::undoRedoAction( int column,
 		pPattern = nullptr;
 	}
 
+	AudioEngine::get_instance()->lock_song();
     const Pattern::notes_t* notes = pPattern->get_notes();
     FOREACH_NOTE_CST_IT_BOUND(notes,it,column) {
 		Note *pNote = it->second;
@@ -922,10 +962,12 @@ void DrumPatternEditor::undoRedoAction( int column,
 		else if ( mode == "PROBABILITY" ){
 			pNote->set_probability( probability );
 		}
+		pPattern->touch();
 
 		pSong->set_is_modified( true );
 		break;
 	}
+	AudioEngine::get_instance()->unlock_song();
 	updateEditor();
 	m_pPatternEditorPanel->getVelocityEditor()->updateEditor();
 	m_pPatternEditorPanel->getPanEditor()->updateEditor();
@@ -960,6 +1002,7 @@ void DrumPatternEditor::functionClearNotesUndoAction( std::list< H2Core::Note* >
 	PatternList *pPatternList = H->getSong()->get_pattern_list();
 	Pattern *pPattern = pPatternList->get( patternNumber );
 
+	AudioEngine::get_instance()->lock_song();
 	std::list < H2Core::Note *>::const_iterator pos;
 	for ( pos = noteList.begin(); pos != noteList.end(); ++pos){
 		Note *pNote;
@@ -967,6 +1010,7 @@ void DrumPatternEditor::functionClearNotesUndoAction( std::list< H2Core::Note* >
 		assert( pNote );
 		pPattern->insert_note( pNote );
 	}
+	AudioEngine::get_instance()->unlock_song();
 	EventQueue::get_instance()->push_event( EVENT_SELECTED_INSTRUMENT_CHANGED, -1 );
 	updateEditor();
 	m_pPatternEditorPanel->getVelocityEditor()->updateEditor();
@@ -983,7 +1027,7 @@ void DrumPatternEditor::functionPasteNotesUndoAction(std::list<H2Core::Pattern*>
 	Hydrogen * H = Hydrogen::get_instance();
 	PatternList *patternList = H->getSong()->get_pattern_list();
 
-	AudioEngine::get_instance()->lock( RIGHT_HERE );	// lock the audio engine
+	AudioEngine::get_instance()->lock_song();	// the audio engine keeps playing
 
 	while (appliedList.size() > 0)
 	{
@@ -1013,6 +1057,7 @@ void DrumPatternEditor::functionPasteNotesUndoAction(std::list<H2Core::Pattern*>
 					{
 						notes->erase(it);
 						delete pFoundNote;
+						pat->touch();
 						break;
 					}
 				}
@@ -1025,7 +1070,7 @@ void DrumPatternEditor::functionPasteNotesUndoAction(std::list<H2Core::Pattern*>
 		appliedList.pop_front();
 	}
 
-	AudioEngine::get_instance()->unlock();	// unlock the audio engine
+	AudioEngine::get_instance()->unlock_song();	// publish the notes
 
 	// Update editors
 	EventQueue::get_instance()->push_event( EVENT_SELECTED_INSTRUMENT_CHANGED, -1 );
@@ -1042,7 +1087,7 @@ void DrumPatternEditor::functionPasteNotesRedoAction(std::list<H2Core::Pattern*>
 	Hydrogen * H = Hydrogen::get_instance();
 	PatternList *patternList = H->getSong()->get_pattern_list();
 
-	AudioEngine::get_instance()->lock( RIGHT_HERE );	// lock the audio engine
+	AudioEngine::get_instance()->lock_song();	// the audio engine keeps playing
 
 	// Add notes to pattern
 	std::list < H2Core::Pattern *>::iterator pos;
@@ -1096,7 +1141,7 @@ void DrumPatternEditor::functionPasteNotesRedoAction(std::list<H2Core::Pattern*>
 			appliedList.push_back(pApplied);
 		}
 	}
-	AudioEngine::get_instance()->unlock();	// unlock the audio engine
+	AudioEngine::get_instance()->unlock_song();	// publish the notes
 
 	// Update editors
 	EventQueue::get_instance()->push_event( EVENT_SELECTED_INSTRUMENT_CHANGED, -1 );
@@ -1117,7 +1162,7 @@ void DrumPatternEditor::functionFillNotesUndoAction( QStringList noteList, int n
 	Pattern *pPattern = pPatternList->get( patternNumber );
 	Instrument *pSelectedInstrument = H->getSong()->get_instrument_list()->get( nSelectedInstrument );
 
-	AudioEngine::get_instance()->lock( RIGHT_HERE );	// lock the audio engine
+	AudioEngine::get_instance()->lock_song();	// the audio engine keeps playing
 
 	for (int i = 0; i < noteList.size(); i++ ) {
 		int nColumn  = noteList.value(i).toInt();
@@ -1133,7 +1178,8 @@ void DrumPatternEditor::functionFillNotesUndoAction( QStringList noteList, int n
 			}
 		}
 	}
-	AudioEngine::get_instance()->unlock();	// unlock the audio engine
+	pPattern->touch();
+	AudioEngine::get_instance()->unlock_song();	// publish the notes
 
 	EventQueue::get_instance()->push_event( EVENT_SELECTED_INSTRUMENT_CHANGED, -1 );
 	updateEditor();
@@ -1158,7 +1204,7 @@ void DrumPatternEditor::functionFillNotesRedoAction( QStringList noteList, int n
 	const float fPitch = 0.0f;
 	const int nLength = -1;
 
-	AudioEngine::get_instance()->lock( RIGHT_HERE );	// lock the audio engine
+	AudioEngine::get_instance()->lock_song();	// the audio engine keeps playing
 	for (int i = 0; i < noteList.size(); i++ ) {
 
 		// create the new note
@@ -1166,7 +1212,7 @@ void DrumPatternEditor::functionFillNotesRedoAction( QStringList noteList, int n
 		Note *pNote = new Note( pSelectedInstrument, position, velocity, pan_L, pan_R, nLength, fPitch );
 		pPattern->insert_note( pNote );
 	}
-	AudioEngine::get_instance()->unlock();	// unlock the audio engine
+	AudioEngine::get_instance()->unlock_song();	// publish the notes
 
 	EventQueue::get_instance()->push_event( EVENT_SELECTED_INSTRUMENT_CHANGED, -1 );
 	updateEditor();
@@ -1186,7 +1232,7 @@ void DrumPatternEditor::functionRandomVelocityAction( QStringList noteVeloValue,
 	Instrument *pSelectedInstrument = H->getSong()->get_instrument_list()->get( nSelectedInstrument );
 
 
-	AudioEngine::get_instance()->lock( RIGHT_HERE );	// lock the audio engine
+	AudioEngine::get_instance()->lock_song();	// the audio engine keeps playing
 
 	int nBase;
 	if ( isUsingTriplets() ) {
@@ -1209,7 +1255,8 @@ void DrumPatternEditor::functionRandomVelocityAction( QStringList noteVeloValue,
 			}
 		}
 	}
-	AudioEngine::get_instance()->unlock();	// unlock the audio engine
+	pPattern->touch();
+	AudioEngine::get_instance()->unlock_song();	// publish the new velocities
 
 	EventQueue::get_instance()->push_event( EVENT_SELECTED_INSTRUMENT_CHANGED, -1 );
 	updateEditor();
@@ -126,8 +126,13 @@ class DrumPatternEditor : public QWidget, public EventListener, public H2Core::O
 
 		PatternEditorPanel *m_pPatternEditorPanel;
 
+		/// the grid, drawn again only when #m_bBackgroundChanged
+		QPixmap *m_pBackground;
+		bool m_bBackgroundChanged;
+
 		void __draw_note( H2Core::Note* note, QPainter& painter );
-		void __draw_pattern( QPainter& painter );
+		void __draw_background();
+		void __draw_pattern( QPainter& painter, const QRect& rect );
 		void __draw_grid( QPainter& painter );
 		void __create_background( QPainter& pointer );
 
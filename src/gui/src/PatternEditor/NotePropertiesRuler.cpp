@@ -22,6 +22,7 @@
 
 #include <hydrogen/Preferences.h>
 #include <hydrogen/hydrogen.h>
+#include <hydrogen/audio_engine.h>
 #include <hydrogen/basics/instrument.h>
 #include <hydrogen/basics/instrument_list.h>
 #include <hydrogen/basics/pattern.h>
@@ -47,6 +48,7 @@ NotePropertiesRuler::NotePropertiesRuler( QWidget *parent, PatternEditorPanel *p
  , m_Mode( mode )
  , m_pPatternEditorPanel( pPatternEditorPanel )
  , m_pPattern( nullptr )
+ , m_bNeedsUpdate( true )
 {
 	//infoLog("INIT");
 	//setAttribute(Qt::WA_NoBackground);
@@ -206,6 +208,11 @@ void NotePropertiesRuler::wheelEvent(QWheelEvent *ev )
 			__probability = val;
 
 		}
+		// let the audio engine play the changed note
+		AudioEngine::get_instance()->lock_song();
+		m_pPattern->touch();
+		AudioEngine::get_instance()->unlock_song();
+
 		pSong->set_is_modified( true );
 		startUndoAction();
 		updateEditor();
@@ -446,6 +453,10 @@ void NotePropertiesRuler::pressAction( int x, int y)
 				HydrogenApp::get_instance()->setStatusBarMessage( QString("Set note probability [%1]").arg( valueChar ), 2000 );
 			}
 
+			// let the audio engine play the changed note
+			AudioEngine::get_instance()->lock_song();
+			m_pPattern->touch();
+			AudioEngine::get_instance()->unlock_song();
 	
 			if( columnChange ){
 				__columnCheckOnXmouseMouve = column;
@@ -497,6 +508,11 @@ void NotePropertiesRuler::startUndoAction()
 
 void NotePropertiesRuler::paintEvent( QPaintEvent *ev)
 {
+	if ( m_bNeedsUpdate ) {
+		m_bNeedsUpdate = false;
+		drawBackground();
+	}
+
 	QPainter painter(this);
 	painter.drawPixmap( ev->rect(), *m_pBackground, ev->rect() );
 }
@@ -1225,9 +1241,20 @@ void NotePropertiesRuler::updateEditor()
 		editorWidth =  20 + MAX_NOTES * m_nGridWidth;
 	}
 	resize( editorWidth, height() );
-		
-	delete m_pBackground;
-	m_pBackground = new QPixmap( editorWidth, m_nEditorHeight );
+
+	// drawn once on the next paint, not for every call while hidden
+	m_bNeedsUpdate = true;
+	update();
+}
+
+
+
+void NotePropertiesRuler::drawBackground()
+{
+	if ( m_pBackground->width() != width() ) {
+		delete m_pBackground;
+		m_pBackground = new QPixmap( width(), m_nEditorHeight );
+	}
 
 	if ( m_Mode == VELOCITY || m_Mode == PROBABILITY ) {
 		createVelocityBackground( m_pBackground );
@@ -1241,9 +1268,6 @@ void NotePropertiesRuler::updateEditor()
 	else if ( m_Mode == NOTEKEY ) {
 		createNoteKeyBackground( m_pBackground );
 	}
-
-	// redraw all
-	update();
 }
 
 
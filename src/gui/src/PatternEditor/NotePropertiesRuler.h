@@ -75,7 +75,10 @@ class NotePropertiesRuler : public QWidget, public H2Core::Object, public EventL
 		uint m_nEditorHeight;
 
 		QPixmap *m_pBackground;
+		/// #m_pBackground is drawn again on the next paint
+		bool m_bNeedsUpdate;
 
+		void drawBackground();
 		void createVelocityBackground(QPixmap *pixmap);
 		void createPanBackground(QPixmap *pixmap);
 		void createLeadLagBackground(QPixmap *pixmap);
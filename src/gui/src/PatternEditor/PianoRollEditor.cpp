@@ -48,6 +48,8 @@ PianoRollEditor::PianoRollEditor( QWidget *pParent, PatternEditorPanel *panel )
 	, m_bRightBtnPressed( false )
 	, m_bUseTriplets( false )
 	, m_pPattern( nullptr )
+	, m_bBackgroundChanged( false )
+	, m_bNeedsUpdate( true )
 	, m_pPatternEditorPanel( panel )
 	, m_pDraggedNote( nullptr )
 {
@@ -85,26 +87,29 @@ void PianoRollEditor::setResolution(uint res, bool bUseTriplets)
 {
 	this->m_nResolution = res;
 	this->m_bUseTriplets = bUseTriplets;
+	m_bBackgroundChanged = true;
 	updateEditor();
 }
 
 
 void PianoRollEditor::updateEditor()
 {
-	//	uint nEditorWidth;
+	uint nEditorWidth;
 	if ( m_pPattern ) {
-		m_nEditorWidth = 20 + m_nGridWidth * m_pPattern->get_length();
+		nEditorWidth = 20 + m_nGridWidth * m_pPattern->get_length();
 	}
 	else {
-		m_nEditorWidth = 20 + m_nGridWidth * MAX_NOTES;
+		nEditorWidth = 20 + m_nGridWidth * MAX_NOTES;
+	}
+	if ( nEditorWidth != m_nEditorWidth ) {
+		m_nEditorWidth = nEditorWidth;
+		m_bBackgroundChanged = true;
 	}
 	resize( m_nEditorWidth, height() );
 
-	// redraw all
+	// drawn once on the next paint, not for every call while hidden
+	m_bNeedsUpdate = true;
 	update( 0, 0, width(), height() );
-
-	createBackground();
-	drawPattern();
 	//	ERRORLOG(QString("update editor %1").arg(m_nEditorWidth));
 }
 
@@ -145,6 +150,17 @@ void PianoRollEditor::selectedPatternChangedEvent()
 
 void PianoRollEditor::paintEvent(QPaintEvent *ev)
 {
+	// the grid only changes with the resolution or the width
+	if ( m_bBackgroundChanged ) {
+		m_bBackgroundChanged = false;
+		createBackground();
+		m_bNeedsUpdate = true;
+	}
+	if ( m_bNeedsUpdate ) {
+		m_bNeedsUpdate = false;
+		drawPattern();
+	}
+
 	QPainter painter( this );
 	painter.drawPixmap( ev->rect(), *m_pTemp, ev->rect() );
 }
@@ -384,6 +400,10 @@ void PianoRollEditor::drawPattern()
 	// copy the background image
 	p.drawPixmap( rect(), *m_pBackground, rect() );
 
+	if ( m_pPattern == nullptr ) {
+		return;
+	}
+
 
 	// for each note...
 	const Pattern::notes_t* notes = m_pPattern->get_notes();
@@ -647,7 +667,8 @@ void PianoRollEditor::addOrDeleteNoteAction( int nColumn,
 	m_bRightBtnPressed = false;
 
 	bool bNoteAlreadyExist = false;
-	AudioEngine::get_instance()->lock( RIGHT_HERE );	// lock the audio engine
+	Note *pPreviewNote = nullptr;
+	AudioEngine::get_instance()->lock_song();	// the audio engine keeps playing
 	Note* note = m_pPattern->find_note( nColumn, -1, pSelectedInstrument, pressednotekey, pressedoctave );
 	if( note ) {
 		// the note exists...remove it!
@@ -683,13 +704,18 @@ void PianoRollEditor::addOrDeleteNoteAction( int nColumn,
 		// hear note
 		Preferences *pref = Preferences::get_instance();
 		if ( pref->getHearNewNotes() && !noteOff ) {
-			Note *pNote2 = new Note( pSelectedInstrument, 0, fVelocity, fPan_L, fPan_R, nLength, fPitch);
-			pNote2->set_key_octave( pressednotekey, pressedoctave );
-			AudioEngine::get_instance()->get_sampler()->note_on(pNote2);
+			pPreviewNote = new Note( pSelectedInstrument, 0, fVelocity, fPan_L, fPan_R, nLength, fPitch);
+			pPreviewNote->set_key_octave( pressednotekey, pressedoctave );
 		}
 	}
 	pSong->set_is_modified( true );
-	AudioEngine::get_instance()->unlock(); // unlock the audio engine
+	AudioEngine::get_instance()->unlock_song(); // publish the notes
+
+	if ( pPreviewNote != nullptr ) {
+		AudioEngine::get_instance()->lock( RIGHT_HERE );
+		AudioEngine::get_instance()->get_sampler()->note_on( pPreviewNote );
+		AudioEngine::get_instance()->unlock();
+	}
 
 	updateEditor();
 	m_pPatternEditorPanel->getVelocityEditor()->updateEditor();
@@ -718,7 +744,7 @@ void PianoRollEditor::mouseMoveEvent(QMouseEvent *ev)
 		if ( m_pDraggedNote->get_note_off() ) return;
 		int nTickColumn = getColumn( ev );
 
-		AudioEngine::get_instance()->lock( RIGHT_HERE );	// lock the audio engine
+		AudioEngine::get_instance()->lock_song();	// the audio engine keeps playing
 		int nLen = nTickColumn - (int)m_pDraggedNote->get_position();
 
 		if (nLen <= 0) {
@@ -734,8 +760,9 @@ void PianoRollEditor::mouseMoveEvent(QMouseEvent *ev)
 		}
 		m_pDraggedNote->set_length( nLen * fStep);
 
+		m_pPattern->touch();
 		Hydrogen::get_instance()->getSong()->set_is_modified( true );
-		AudioEngine::get_instance()->unlock(); // unlock the audio engine
+		AudioEngine::get_instance()->unlock_song(); // publish the note
 
 		//__draw_pattern();
 		updateEditor();
@@ -751,7 +778,7 @@ void PianoRollEditor::mouseMoveEvent(QMouseEvent *ev)
 	if (m_bRightBtnPressed && m_pDraggedNote && selectedProperty == 0 ) { // Velocity
 		if ( m_pDraggedNote->get_note_off() ) return;
 
-		AudioEngine::get_instance()->lock( RIGHT_HERE );	// lock the audio engine
+		AudioEngine::get_instance()->lock_song();	// the audio engine keeps playing
 
 		float val = m_pDraggedNote->get_velocity();
 
@@ -769,8 +796,9 @@ void PianoRollEditor::mouseMoveEvent(QMouseEvent *ev)
 
 		__velocity = val;
 
+		m_pPattern->touch();
 		Hydrogen::get_instance()->getSong()->set_is_modified( true );
-		AudioEngine::get_instance()->unlock(); // unlock the audio engine
+		AudioEngine::get_instance()->unlock_song(); // publish the note
 
 		//__draw_pattern();
 		updateEditor();
@@ -785,7 +813,7 @@ void PianoRollEditor::mouseMoveEvent(QMouseEvent *ev)
 	if (m_bRightBtnPressed && m_pDraggedNote && selectedProperty == 1 ) { // Pan
 		if ( m_pDraggedNote->get_note_off() ) return;
 
-		AudioEngine::get_instance()->lock( RIGHT_HERE );	// lock the audio engine
+		AudioEngine::get_instance()->lock_song();	// the audio engine keeps playing
 
 		float pan_L, pan_R;
 		
@@ -810,8 +838,9 @@ void PianoRollEditor::mouseMoveEvent(QMouseEvent *ev)
 		__pan_L = pan_L;
 		__pan_R = pan_R;
 
+		m_pPattern->touch();
 		Hydrogen::get_instance()->getSong()->set_is_modified( true );
-		AudioEngine::get_instance()->unlock(); // unlock the audio engine
+		AudioEngine::get_instance()->unlock_song(); // publish the note
 
 		//__draw_pattern();
 		updateEditor();
@@ -826,7 +855,7 @@ void PianoRollEditor::mouseMoveEvent(QMouseEvent *ev)
 	if (m_bRightBtnPressed && m_pDraggedNote && selectedProperty ==  2 ) { // Lead and Lag
 		if ( m_pDraggedNote->get_note_off() ) return;
 
-		AudioEngine::get_instance()->lock( RIGHT_HERE );	// lock the audio engine
+		AudioEngine::get_instance()->lock_song();	// the audio engine keeps playing
 
 		
 		float val = ( m_pDraggedNote->get_lead_lag() - 1.0 ) / -2.0 ;
@@ -856,8 +885,9 @@ void PianoRollEditor::mouseMoveEvent(QMouseEvent *ev)
 			HydrogenApp::get_instance()->setStatusBarMessage( QString("Note on beat"), 2000 );
 		}
 
+		m_pPattern->touch();
 		Hydrogen::get_instance()->getSong()->set_is_modified( true );
-		AudioEngine::get_instance()->unlock(); // unlock the audio engine
+		AudioEngine::get_instance()->unlock_song(); // publish the note
 
 		//__draw_pattern();
 		updateEditor();
@@ -940,12 +970,13 @@ void PianoRollEditor::editNoteLengthAction( int nColumn,  int nRealColumn,  int
 	}
 
 	Note* pDraggedNote = nullptr;
-	AudioEngine::get_instance()->lock( RIGHT_HERE );
+	AudioEngine::get_instance()->lock_song();
 	pDraggedNote = m_pPattern->find_note( nColumn, nRealColumn, pSelectedInstrument, pressednotekey, pressedoctave, false );
 	if ( pDraggedNote ){
 		pDraggedNote->set_length( length );
+		m_pPattern->touch();
 	}
-	AudioEngine::get_instance()->unlock();
+	AudioEngine::get_instance()->unlock_song();
 	updateEditor();
 	m_pPatternEditorPanel->getVelocityEditor()->updateEditor();
 	m_pPatternEditorPanel->getPanEditor()->updateEditor();
@@ -995,15 +1026,16 @@ void PianoRollEditor::editNotePropertiesAction( int nColumn,
 	Instrument *pSelectedInstrument = pSong->get_instrument_list()->get( selectedInstrumentnumber );
 
 	Note* pDraggedNote = nullptr;
-	AudioEngine::get_instance()->lock( RIGHT_HERE );
+	AudioEngine::get_instance()->lock_song();
 	pDraggedNote = m_pPattern->find_note( nColumn, nRealColumn, pSelectedInstrument, pressednotekey, pressedoctave, false );
 	if ( pDraggedNote ){
 		pDraggedNote->set_velocity( velocity );
 		pDraggedNote->set_pan_l( pan_L );
 		pDraggedNote->set_pan_r( pan_R );
 		pDraggedNote->set_lead_lag( leadLag );
+		m_pPattern->touch();
 	}
-	AudioEngine::get_instance()->unlock();
+	AudioEngine::get_instance()->unlock_song();
 	updateEditor();
 	m_pPatternEditorPanel->getVelocityEditor()->updateEditor();
 	m_pPatternEditorPanel->getPanEditor()->updateEditor();
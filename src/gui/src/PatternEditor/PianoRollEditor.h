@@ -100,6 +100,10 @@ class PianoRollEditor: public QWidget, public EventListener, public H2Core::Obje
 		uint m_nEditorHeight;
 		QPixmap *m_pBackground;
 		QPixmap *m_pTemp;
+		/// #m_pBackground is drawn again on the next paint
+		bool m_bBackgroundChanged;
+		/// the notes are drawn on #m_pTemp again on the next paint
+		bool m_bNeedsUpdate;
 		int m_pOldPoint;
 
 		PatternEditorPanel *m_pPatternEditorPanel;
@@ -131,6 +131,7 @@ PreferencesDialog::PreferencesDialog(QWidget* parent)
 
 	// max voices
 	maxVoicesTxt->setValue( pPref->m_nMaxNotes );
+	voiceStealingComboBox->setCurrentIndex( pPref->m_nVoiceStealing );
 
 	// JACK
 	trackOutsCheckBox->setChecked( pPref->m_bJackTrackOuts );
@@ -423,6 +424,7 @@ void PreferencesDialog::on_okBtn_clicked()
 
 	// maxVoices
 	pPref->m_nMaxNotes = maxVoicesTxt->value();
+	pPref->m_nVoiceStealing = voiceStealingComboBox->currentIndex();
 
 	if ( m_pMidiDriverComboBox->currentText() == "ALSA" ) {
 		pPref->m_sMidiDriver = "ALSA";
@@ -34,6 +34,7 @@ DetailWaveDisplay::DetailWaveDisplay(QWidget* pParent )
  : QWidget( pParent )
  , Object( __class_name )
  , m_sSampleName( "" )
+ , m_pSample( nullptr )
 {
 //	setAttribute(Qt::WA_NoBackground);
 
@@ -59,8 +60,7 @@ DetailWaveDisplay::DetailWaveDisplay(QWidget* pParent )
 DetailWaveDisplay::~DetailWaveDisplay()
 {
 	//INFOLOG( "DESTROY" );
-	delete[] m_pPeakDatal;
-	delete[] m_pPeakDatar;
+	delete m_pSample;
 }
 
 
@@ -85,10 +85,26 @@ void DetailWaveDisplay::paintEvent(QPaintEvent *ev)
 //	int imagedetailframes = m_pnormalimagedetailframes / m_pzoomFactor;
 	int startpos = m_pDetailSamplePosition  - m_pNormalImageDetailFrames / 2 ;
 
+	// a frame per pixel, the frames before and past the sample are
+	// silent. Only those shown are read, whatever the length of the
+	// sample.
+	float fGain = height() / 4.0 * 1.0;
+	std::vector<float> peakDatal( width() + 1, 0 ), peakDatar( width() + 1, 0 );
+	if ( m_pSample != nullptr ) {
+		int nFirst = std::max( startpos - 1, 0 );
+		int nLast = std::min( startpos + width(), m_pSample->get_frames() );
+		if ( nLast > nFirst ) {
+			int nOffset = nFirst - ( startpos - 1 );
+			m_pSample->read_data( nFirst, nLast - nFirst, &peakDatal[ nOffset ], &peakDatar[ nOffset ] );
+		}
+	}
+
 	for ( int x = 0; x < width() ; x++ ) {
 		if ( (startpos) > 0 ){
-			painter.drawLine( x, (-m_pPeakDatal[startpos -1] *m_pZoomFactor) +VCenterl, x, (-m_pPeakDatal[startpos ] *m_pZoomFactor)+VCenterl );
-			painter.drawLine( x, (-m_pPeakDatar[startpos -1] *m_pZoomFactor) +VCenterr, x, (-m_pPeakDatar[startpos ] *m_pZoomFactor)+VCenterr );
+			int nPrevl = static_cast<int>( peakDatal[ x ] * fGain ), nVall = static_cast<int>( peakDatal[ x + 1 ] * fGain );
+			int nPrevr = static_cast<int>( peakDatar[ x ] * fGain ), nValr = static_cast<int>( peakDatar[ x + 1 ] * fGain );
+			painter.drawLine( x, (-nPrevl *m_pZoomFactor) +VCenterl, x, (-nVall *m_pZoomFactor)+VCenterl );
+			painter.drawLine( x, (-nPrevr *m_pZoomFactor) +VCenterr, x, (-nValr *m_pZoomFactor)+VCenterr );
 			//ERRORLOG( QString("startpos: %1").arg(startpos) )
 		}
 		else
@@ -124,33 +140,13 @@ void DetailWaveDisplay::updateDisplay( QString filename )
 {
 
 	Sample *pNewSample = Sample::load( filename );
-
-	if ( pNewSample ) {
-
-		int mSampleLength = pNewSample->get_frames();
-
-		m_pPeakDatal = new int[ mSampleLength + m_pNormalImageDetailFrames /2 ];
-		m_pPeakDatar = new int[ mSampleLength + m_pNormalImageDetailFrames /2 ];
-
-		for ( int i = 0 ; i < mSampleLength + m_pNormalImageDetailFrames /2 ; i++){
-			m_pPeakDatal[ i ] = 0;
-			m_pPeakDatar[ i ] = 0;
-		}
-
-		float fGain = height() / 4.0 * 1.0;
-
-		float *pSampleDatal = pNewSample->get_data_l();
-		float *pSampleDatar = pNewSample->get_data_r();
-
-		for ( int i = 0; i < mSampleLength; i++ ){
-			m_pPeakDatal[ i ] = static_cast<int>( pSampleDatal[ i ] * fGain );
-			m_pPeakDatar[ i ] = static_cast<int>( pSampleDatar[ i ] * fGain );
-		}
-
-
+	// the editor shows every frame, not only the head of a streamed sample
+	if ( pNewSample != nullptr && !pNewSample->unstream() ) {
+		delete pNewSample;
+		pNewSample = nullptr;
 	}
-	delete pNewSample;
-}
-
-
 
+	delete m_pSample;
+	m_pSample = pNewSample;
+	update();
+}
@@ -51,8 +51,8 @@ class DetailWaveDisplay : public QWidget, public H2Core::Object
 	private:
 		QPixmap m_background;
 		QString m_sSampleName;
-		int *m_pPeakDatal;
-		int *m_pPeakDatar;
+		/** the sample shown, only the frames drawn are read */
+		H2Core::Sample *m_pSample;
 		int m_pDetailSamplePosition;
 		int m_pNormalImageDetailFrames;
 		float m_pZoomFactor;
@@ -23,6 +23,8 @@
 #include <hydrogen/basics/sample.h>
 #include <hydrogen/basics/song.h>
 #include <hydrogen/basics/instrument.h>
+#include <hydrogen/basics/sample_peak_cache.h>
+#include <hydrogen/basics/sample_peaks.h>
 #include "HydrogenApp.h"
 #include "SampleEditor.h"
 using namespace H2Core;
@@ -50,6 +52,10 @@ MainSampleWaveDisplay::MainSampleWaveDisplay(QWidget* pParent)
 
 	m_pPeakDatal = new int[ w ];
 	m_pPeakDatar = new int[ w ];
+	memset( m_pPeakDatal, 0, w * sizeof( m_pPeakDatal[0] ) );
+	memset( m_pPeakDatar, 0, w * sizeof( m_pPeakDatar[0] ) );
+	m_pSampleLength = 0;
+	m_bPeaksPending = false;
 
 	m_pStartFramePosition = 25;
 	m_pLoopFramePosition = 25;
@@ -61,6 +67,8 @@ MainSampleWaveDisplay::MainSampleWaveDisplay(QWidget* pParent)
 	__startsliderismoved = false;
 	__loopsliderismoved = false;
 	__endsliderismoved = false;
+
+	HydrogenApp::get_instance()->addEventListener( this );
 }
 
 
@@ -70,6 +78,7 @@ MainSampleWaveDisplay::~MainSampleWaveDisplay()
 {
 	//INFOLOG( "DESTROY" );
 
+	HydrogenApp::get_instance()->removeEventListener( this );
 	delete[] m_pPeakDatal;
 	delete[] m_pPeakDatar;
 }
@@ -153,56 +162,50 @@ void MainSampleWaveDisplay::updateDisplayPointer()
 
 void MainSampleWaveDisplay::updateDisplay( const QString& filename )
 {
+	m_sFilename = filename;
+
+	// the editor shows every frame, not only the head of a streamed
+	// sample, they are summarized in the background without
+	// decoding the whole file
+	std::shared_ptr<SamplePeaks> pPeaks = SamplePeakCache::get_instance()->get( filename );
+	m_bPeaksPending = pPeaks == nullptr;
+	m_pSampleLength = pPeaks != nullptr ? pPeaks->get_frames() : 0;
+
+	float fFramesPerPixel = m_pSampleLength / (float)( width() - 50 );
+	if ( fFramesPerPixel < 1 ){
+		fFramesPerPixel = 1;
+	}
 
-	Sample *pNewSample = Sample::load( filename );
-	
-	if ( pNewSample ) {
+	float fGain = height() / 4.0 * 1.0;
 
-		int nSampleLength = pNewSample->get_frames();
-		m_pSampleLength = nSampleLength;
-		float nScaleFactor = nSampleLength / (width() -50);
-		if ( nScaleFactor < 1 ){
-			nScaleFactor = 1;
-		}
-
-		float fGain = height() / 4.0 * 1.0;
-
-		float *pSampleDatal = pNewSample->get_data_l();
-		float *pSampleDatar = pNewSample->get_data_r();
-
-		unsigned nSamplePos = 0;
-		int nVall = 0;
-		int nValr = 0;
-		int newVall = 0;
-		int newValr = 0;
-		for ( int i = 0; i < width(); ++i ){
-			for ( int j = 0; j < nScaleFactor; ++j ) {
-				if ( j < nSampleLength && nSamplePos < nSampleLength) {
-					if ( pSampleDatal[ nSamplePos ] && pSampleDatar[ nSamplePos ] ){
-						newVall = static_cast<int>( pSampleDatal[ nSamplePos ] * fGain );
-						newValr = static_cast<int>( pSampleDatar[ nSamplePos ] * fGain );
-						nVall = newVall;
-						nValr = newValr;
-					}else
-					{
-						nVall = 0;	
-						nValr = 0;
-					}
-				}
-				++nSamplePos;
-			}
-			m_pPeakDatal[ i ] = nVall;
-			m_pPeakDatar[ i ] = nValr;
-		}
+	std::vector<SamplePeaks::Peak> peaksl( width(), SamplePeaks::Peak{ 0, 0, 0 } );
+	std::vector<SamplePeaks::Peak> peaksr( width(), SamplePeaks::Peak{ 0, 0, 0 } );
+	if ( pPeaks != nullptr ) {
+		pPeaks->get_peaks( 0, 0, fFramesPerPixel, width(), peaksl.data() );
+		pPeaks->get_peaks( 1, 0, fFramesPerPixel, width(), peaksr.data() );
+	}
+	// the extreme of each range is drawn
+	for ( int i = 0; i < width(); ++i ){
+		float fVall = -peaksl[ i ].min > peaksl[ i ].max ? peaksl[ i ].min : peaksl[ i ].max;
+		float fValr = -peaksr[ i ].min > peaksr[ i ].max ? peaksr[ i ].min : peaksr[ i ].max;
+		m_pPeakDatal[ i ] = static_cast<int>( fVall * fGain );
+		m_pPeakDatar[ i ] = static_cast<int>( fValr * fGain );
 	}
-	delete pNewSample;
-	pNewSample = nullptr;
 	update();
 
 }
 
 
 
+void MainSampleWaveDisplay::samplePeaksReadyEvent()
+{
+	if ( m_bPeaksPending ) {
+		updateDisplay( m_sFilename );
+	}
+}
+
+
+
 void MainSampleWaveDisplay::testPositionFromSampleeditor()
 {
 	testPosition( nullptr );
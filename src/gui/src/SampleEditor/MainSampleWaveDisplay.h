@@ -28,10 +28,11 @@
 #  include <QtWidgets>
 #endif
 #include <hydrogen/object.h>
+#include "../EventListener.h"
 #include "SampleEditor.h"
 class SampleEditor;
 
-class MainSampleWaveDisplay : public QWidget, public H2Core::Object
+class MainSampleWaveDisplay : public QWidget, public H2Core::Object, public EventListener
 {
     H2_OBJECT
 	Q_OBJECT
@@ -54,6 +55,7 @@ class MainSampleWaveDisplay : public QWidget, public H2Core::Object
 		bool __loopsliderismoved;
 		bool __endsliderismoved;
 
+		virtual void samplePeaksReadyEvent() override;
 
 	private:
 		QPixmap m_background;
@@ -66,6 +68,9 @@ class MainSampleWaveDisplay : public QWidget, public H2Core::Object
 		int m_pSampleLength;
 		int m_plocator;
 		bool m_pupdateposi;
+		QString m_sFilename;
+		/** the peaks of the file are being computed, see H2Core::SamplePeakCache */
+		bool m_bPeaksPending;
 
 };
 
@@ -24,6 +24,8 @@
 #include <hydrogen/basics/song.h>
 #include <hydrogen/basics/instrument.h>
 #include <hydrogen/basics/instrument_layer.h>
+#include <hydrogen/basics/sample_peak_cache.h>
+#include <hydrogen/basics/sample_peaks.h>
 
 #include <memory>
 
@@ -61,12 +63,18 @@ TargetWaveDisplay::TargetWaveDisplay(QWidget* pParent)
 
 	m_pPeakData_Left = new int[ w ];
 	m_pPeakData_Right = new int[ w ];
+	memset( m_pPeakData_Left, 0, w * sizeof( m_pPeakData_Left[0] ) );
+	memset( m_pPeakData_Right, 0, w * sizeof( m_pPeakData_Right[0] ) );
+	m_pLayer = nullptr;
+	m_bPeaksPending = false;
 	m_VMove = false;
 	m_sInfo = "";
 	m_nX = -10;
 	m_nY = -10;
 	m_nLocator = -1;
 	m_UpdatePosition = false;
+
+	HydrogenApp::get_instance()->addEventListener( this );
 }
 
 
@@ -76,6 +84,7 @@ TargetWaveDisplay::~TargetWaveDisplay()
 {
 	//INFOLOG( "DESTROY" );
 
+	HydrogenApp::get_instance()->removeEventListener( this );
 	delete[] m_pPeakData_Left;
 	delete[] m_pPeakData_Right;
 }
@@ -193,44 +202,25 @@ void TargetWaveDisplay::paintLocatorEventTargetDisplay( int pos, bool updateposi
 
 void TargetWaveDisplay::updateDisplay( H2Core::InstrumentLayer *pLayer )
 {
+	m_pLayer = pLayer;
+	m_bPeaksPending = false;
 	if ( pLayer && pLayer->get_sample() ) {
 
-		int nSampleLength = pLayer->get_sample()->get_frames();
-		float nScaleFactor = nSampleLength / width();
-
 		float fGain = (height() - 8) / 2.0 * pLayer->get_gain();
 
-		float *pSampleDatal = pLayer->get_sample()->get_data_l();
-		float *pSampleDatar = pLayer->get_sample()->get_data_r();
-		int nSamplePos = 0;
-		int nVall;
-		int nValr;
+		// summarized in the background, drawn once ready
+		std::shared_ptr<SamplePeaks> pPeaks = SamplePeakCache::get_instance()->get( pLayer->get_sample() );
+		m_bPeaksPending = pPeaks == nullptr;
+		std::vector<SamplePeaks::Peak> peaksl( width(), SamplePeaks::Peak{ 0, 0, 0 } );
+		std::vector<SamplePeaks::Peak> peaksr( width(), SamplePeaks::Peak{ 0, 0, 0 } );
+		if ( pPeaks != nullptr ) {
+			pPeaks->get_peaks( 0, 0, pPeaks->get_frames() / ( double )width(), width(), peaksl.data() );
+			pPeaks->get_peaks( 1, 0, pPeaks->get_frames() / ( double )width(), width(), peaksr.data() );
+		}
+		// the left channel is drawn upwards, the right one downwards
 		for ( int i = 0; i < width(); ++i ){
-			nVall = 0;
-			nValr = 0;
-			for ( int j = 0; j < nScaleFactor; ++j ) {
-				if ( j < nSampleLength ) {
-					if ( pSampleDatal[ nSamplePos ] < 0 ){
-						int newVal = static_cast<int>( pSampleDatal[ nSamplePos ] * -fGain );
-						nVall = newVal;
-					}else
-					{
-						int newVal = static_cast<int>( pSampleDatal[ nSamplePos ] * fGain );
-						nVall = newVal;
-					}
-					if ( pSampleDatar[ nSamplePos ] > 0 ){
-						int newVal = static_cast<int>( pSampleDatar[ nSamplePos ] * -fGain );
-						nValr = newVal;
-					}else
-					{
-						int newVal = static_cast<int>( pSampleDatar[ nSamplePos ] * fGain );
-						nValr = newVal;
-					}
-				}
-				++nSamplePos;
-			}
-			m_pPeakData_Left[ i ] = nVall;
-			m_pPeakData_Right[ i ] = nValr;
+			m_pPeakData_Left[ i ] = static_cast<int>( std::max( -peaksl[ i ].min, peaksl[ i ].max ) * fGain );
+			m_pPeakData_Right[ i ] = static_cast<int>( std::max( -peaksr[ i ].min, peaksr[ i ].max ) * -fGain );
 		}
 	}
 
@@ -239,6 +229,14 @@ void TargetWaveDisplay::updateDisplay( H2Core::InstrumentLayer *pLayer )
 }
 
 
+void TargetWaveDisplay::samplePeaksReadyEvent()
+{
+	if ( m_bPeaksPending && m_pLayer != nullptr ) {
+		updateDisplay( m_pLayer );
+	}
+}
+
+
 void TargetWaveDisplay::mouseMoveEvent(QMouseEvent *ev)
 {
 	int snapradius = 10;
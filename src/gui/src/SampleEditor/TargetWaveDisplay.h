@@ -28,6 +28,7 @@
 #  include <QtWidgets>
 #endif
 #include <hydrogen/object.h>
+#include "../EventListener.h"
 #include <hydrogen/basics/sample.h>
 #include <memory>
 
@@ -39,7 +40,7 @@ namespace H2Core
 	class EnvelopePoint;
 }
 
-class TargetWaveDisplay : public QWidget, public H2Core::Object
+class TargetWaveDisplay : public QWidget, public H2Core::Object, public EventListener
 {
 	H2_OBJECT
 	Q_OBJECT
@@ -55,6 +56,8 @@ class TargetWaveDisplay : public QWidget, public H2Core::Object
 		H2Core::Sample::PanEnvelope* get_pan() { return &m_PanEnvelope; }
 		H2Core::Sample::VelocityEnvelope* get_velocity() { return &m_VelocityEnvelope; }
 
+		virtual void samplePeaksReadyEvent() override;
+
 	private:
 		QPixmap m_Background;
 
@@ -69,6 +72,9 @@ class TargetWaveDisplay : public QWidget, public H2Core::Object
 		int *m_pPeakData_Right;
 
 		unsigned m_nSampleLength;
+		H2Core::InstrumentLayer *m_pLayer;
+		/** the peaks of the sample are being computed, see H2Core::SamplePeakCache */
+		bool m_bPeaksPending;
 
 		bool m_VMove;
 		bool m_UpdatePosition;
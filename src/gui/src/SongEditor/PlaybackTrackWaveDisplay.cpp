@@ -28,6 +28,8 @@
 #include <hydrogen/basics/instrument_layer.h>
 #include <hydrogen/basics/pattern_list.h>
 #include <hydrogen/basics/pattern.h>
+#include <hydrogen/basics/sample_peak_cache.h>
+#include <hydrogen/basics/sample_peaks.h>
 using namespace H2Core;
 
 
@@ -110,8 +112,14 @@ void PlaybackTrackWaveDisplay::updateDisplay( H2Core::InstrumentLayer *pLayer )
 		m_pLayer = pLayer;
 		m_sSampleName = m_pLayer->get_sample()->get_filename();
 		
-		float *	pSampleData = pLayer->get_sample()->get_data_l();
 		int		nSampleLength = m_pLayer->get_sample()->get_frames();
+		// summarized in the background, drawn once ready
+		std::shared_ptr<SamplePeaks> pPeaks = SamplePeakCache::get_instance()->get( m_pLayer->get_sample() );
+		m_bPeaksPending = pPeaks == nullptr;
+		if ( pPeaks == nullptr ) {
+			update();
+			return;
+		}
 		float	fLengthOfPlaybackTrackInSecs = ( float )( nSampleLength / (float) m_pLayer->get_sample()->get_sample_rate() );
 		float	fRemainingLengthOfPlaybackTrack = fLengthOfPlaybackTrackInSecs;		
 		float	fGain = height() / 2.0 * pLayer->get_gain();
@@ -158,27 +166,13 @@ void PlaybackTrackWaveDisplay::updateDisplay( H2Core::InstrumentLayer *pLayer )
 				float nScaleFactor = fLengthOfCurrentPatternInSecs / fLengthOfPlaybackTrackInSecs;
 				int nSamplesToRender = nScaleFactor * nSampleLength;
 				
-				int nVal = 0;
-				
-				for ( int i = nRenderStartPosition; i < nRenderStartPosition + nSongEditorGridWith ; ++i ) {
-					if( i < m_nCurrentWidth ) {
-						nVal = 0;
-						
-						int nSamplesToRenderInThisStep =  (nSamplesToRender / nSongEditorGridWith);
-						for ( int j = 0; j < nSamplesToRenderInThisStep; ++j ) {
-							if ( nSamplePos < nSampleLength ) {
-								int newVal = (int)( pSampleData[ nSamplePos ] * fGain );
-								if ( newVal > nVal ) {
-									nVal = newVal;
-								}
-							}
-							
-							++nSamplePos;
-						}
-					
-						m_pPeakData[ i ] = nVal;
-					}
+				int nSamplesToRenderInThisStep = nSamplesToRender / nSongEditorGridWith;
+				std::vector<SamplePeaks::Peak> peaks( nSongEditorGridWith );
+				pPeaks->get_peaks( 0, nSamplePos, nSamplesToRenderInThisStep, nSongEditorGridWith, peaks.data() );
+				for ( int i = 0; i < nSongEditorGridWith && nRenderStartPosition + i < m_nCurrentWidth; ++i ) {
+					m_pPeakData[ nRenderStartPosition + i ] = std::max( 0, (int)( peaks[ i ].max * fGain ) );
 				}
+				nSamplePos += nSamplesToRenderInThisStep * nSongEditorGridWith;
 				
 				nRenderStartPosition += nSongEditorGridWith;
 				fRemainingLengthOfPlaybackTrack -= fLengthOfCurrentPatternInSecs;
@@ -186,6 +180,7 @@ void PlaybackTrackWaveDisplay::updateDisplay( H2Core::InstrumentLayer *pLayer )
 		}
 	} else {
 		m_sSampleName = "-";
+		m_bPeaksPending = false;
 		for ( int i =0; i < m_nCurrentWidth; ++i ){
 			m_pPeakData[ i ] = 0;
 		}
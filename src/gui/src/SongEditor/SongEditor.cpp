@@ -74,17 +74,16 @@ struct PatternDisplayInfo {
 };
 
 
-SongEditorGridRepresentationItem::SongEditorGridRepresentationItem(int x, int y, bool value)
-{
-	this->x = x;
-	this->y = y;
-	this->value = value;
-}
+/// side of the square tiles the grid is drawn in
+static const int SONG_EDITOR_TILE_SIZE = 256;
+/// at most 64 MB of tiles, enough to cover a 4k screen
+static const unsigned SONG_EDITOR_MAX_TILES = 256;
 
 
 SongEditor::SongEditor( QWidget *parent )
  : QWidget( parent )
  , Object( __class_name )
+ , m_nTileUse( 0 )
  , m_bSequenceChanged( true )
  , m_bIsMoving( false )
  , m_bShowLasso( false )
@@ -102,7 +101,7 @@ SongEditor::SongEditor( QWidget *parent )
 
 	this->resize( QSize(m_nInitialWidth, m_nInitialHeight) );
 
-	createBackground();	// create m_backgroundPixmap pixmap
+	createBackground();
 
 	update();
 }
@@ -126,6 +125,7 @@ void SongEditor::setGridWidth( uint width )
 {
 	if ( ( SONG_EDITOR_MIN_GRID_WIDTH <= width ) && ( SONG_EDITOR_MAX_GRID_WIDTH >= width ) ) {
 		m_nGridWidth = width;
+		m_tiles.clear();
 		this->resize ( 10 + m_nMaxPatternSequence * m_nGridWidth, height() );
 	}
 }
@@ -431,21 +431,14 @@ void SongEditor::mouseReleaseEvent( QMouseEvent *ev )
 		 * before the first move operation.
 		 */
 
-		SongEditorGridRepresentationItem* item;
 		m_existingCells.clear();
 		for ( uint i = 0; i < m_movingCells.size(); i++ )
 		{
 			QPoint cell = m_movingCells[ i ];
 
-			//looking for cell identified with (cell.x/cell.y) in the gridRepresentation
-			bool found = false;
-			foreach(item, gridRepresentation)
-			{
-				if(item->x == cell.x() && item->y == cell.y())
-				{
-					found = true;
-				}
-			}
+			//looking for cell identified with (cell.x/cell.y) in the grid
+			cells_t::const_iterator it = m_cells.find( std::make_pair( cell.x(), cell.y() ) );
+			bool found = it != m_cells.end() && ( it->second & ( CELL_ACTIVE | CELL_VIRTUAL ) );
 
 			if( found ){
 				m_existingCells.push_back(cell);
@@ -624,14 +617,19 @@ void SongEditor::paintEvent( QPaintEvent *ev )
 	);
 */
 
-	// ridisegno tutto solo se sono cambiate le note
+	// only the tiles of the cells changed are drawn again
 	if (m_bSequenceChanged) {
 		m_bSequenceChanged = false;
-		drawSequence();
+		updateCells();
 	}
 
 	QPainter painter(this);
-	painter.drawPixmap( ev->rect(), *m_pSequencePixmap, ev->rect() );
+	QRect rect = ev->rect();
+	for ( int nTileY = rect.top() / SONG_EDITOR_TILE_SIZE; nTileY <= rect.bottom() / SONG_EDITOR_TILE_SIZE; nTileY++ ) {
+		for ( int nTileX = rect.left() / SONG_EDITOR_TILE_SIZE; nTileX <= rect.right() / SONG_EDITOR_TILE_SIZE; nTileX++ ) {
+			painter.drawPixmap( nTileX * SONG_EDITOR_TILE_SIZE, nTileY * SONG_EDITOR_TILE_SIZE, getTile( nTileX, nTileY ) );
+		}
+	}
 
 	if ( m_bShowLasso ) {
 		QPen pen( Qt::white );
@@ -646,61 +644,73 @@ void SongEditor::paintEvent( QPaintEvent *ev )
 void SongEditor::createBackground()
 {
 	UIStyle *pStyle = Preferences::get_instance()->getDefaultUIStyle();
-	QColor backgroundColor( pStyle->m_songEditor_backgroundColor.getRed(), pStyle->m_songEditor_backgroundColor.getGreen(), pStyle->m_songEditor_backgroundColor.getBlue() );
-	QColor alternateRowColor( pStyle->m_songEditor_alternateRowColor.getRed(), pStyle->m_songEditor_alternateRowColor.getGreen(), pStyle->m_songEditor_alternateRowColor.getBlue() );
-	QColor linesColor( pStyle->m_songEditor_lineColor.getRed(), pStyle->m_songEditor_lineColor.getGreen(), pStyle->m_songEditor_lineColor.getBlue() );
+	Preferences *pref = Preferences::get_instance();
 
 	Hydrogen *pEngine = Hydrogen::get_instance();
 	Song *pSong = pEngine->getSong();
 
 	uint nPatterns = pSong->get_pattern_list()->size();
 
-	static int nOldHeight = -1;
 	int nNewHeight = m_nGridHeight * nPatterns;
-
-	if (nOldHeight != nNewHeight) {
-		// cambiamento di dimensioni...
-		if (nNewHeight == 0) {
-			nNewHeight = 1;	// the pixmap should not be empty
-		}
-
-		m_pBackgroundPixmap = new QPixmap( width(), nNewHeight );	// initialize the pixmap
-		m_pSequencePixmap = new QPixmap( width(), nNewHeight );	// initialize the pixmap
+	if (nNewHeight == 0) {
+		nNewHeight = 1;	// the widget should not be empty
+	}
+	if ( height() != nNewHeight ) {
 		this->resize( QSize( width(), nNewHeight ) );
 	}
 
-	m_pBackgroundPixmap->fill( alternateRowColor );
+	// the tiles are kept unless the grid looks different
+	std::vector<int> look;
+	look.push_back( nPatterns );
+	look.push_back( m_nGridWidth );
+	look.push_back( pref->getColoringMethod() );
+	look.push_back( pref->getColoringMethodAuxValue() );
+	look.push_back( QColor( pStyle->m_songEditor_backgroundColor.getRed(), pStyle->m_songEditor_backgroundColor.getGreen(), pStyle->m_songEditor_backgroundColor.getBlue() ).rgb() );
+	look.push_back( QColor( pStyle->m_songEditor_alternateRowColor.getRed(), pStyle->m_songEditor_alternateRowColor.getGreen(), pStyle->m_songEditor_alternateRowColor.getBlue() ).rgb() );
+	look.push_back( QColor( pStyle->m_songEditor_lineColor.getRed(), pStyle->m_songEditor_lineColor.getGreen(), pStyle->m_songEditor_lineColor.getBlue() ).rgb() );
+	look.push_back( QColor( pStyle->m_songEditor_pattern1Color.getRed(), pStyle->m_songEditor_pattern1Color.getGreen(), pStyle->m_songEditor_pattern1Color.getBlue() ).rgb() );
+	if ( look != m_tileLook ) {
+		m_tileLook = look;
+		m_tiles.clear();
+	}
 
-	QPainter p( m_pBackgroundPixmap );
-	p.setPen( linesColor );
+	m_bSequenceChanged = true;
+}
+
+
+
+void SongEditor::drawBackground( QPainter& p, const QRect& rect )
+{
+	UIStyle *pStyle = Preferences::get_instance()->getDefaultUIStyle();
+	QColor backgroundColor( pStyle->m_songEditor_backgroundColor.getRed(), pStyle->m_songEditor_backgroundColor.getGreen(), pStyle->m_songEditor_backgroundColor.getBlue() );
+	QColor alternateRowColor( pStyle->m_songEditor_alternateRowColor.getRed(), pStyle->m_songEditor_alternateRowColor.getGreen(), pStyle->m_songEditor_alternateRowColor.getBlue() );
+	QColor linesColor( pStyle->m_songEditor_lineColor.getRed(), pStyle->m_songEditor_lineColor.getGreen(), pStyle->m_songEditor_lineColor.getBlue() );
+
+	int nPatterns = Hydrogen::get_instance()->getSong()->get_pattern_list()->size();
+
+	// only the columns and rows crossing rect
+	int nFirstColumn = std::max( 0, ( rect.left() - 10 ) / (int)m_nGridWidth - 1 );
+	int nLastColumn = std::min( (int)m_nMaxPatternSequence, ( rect.right() - 10 ) / (int)m_nGridWidth + 1 );
+	int nFirstRow = std::max( 0, rect.top() / (int)m_nGridHeight - 1 );
+	int nLastRow = std::min( nPatterns, rect.bottom() / (int)m_nGridHeight + 1 );
+
+	p.fillRect( rect, alternateRowColor );
 
-/*	// sfondo per celle scure (alternato)
-	for (uint i = 0; i < nPatterns; i++) {
-		if ( ( i % 2) != 0) {
-			uint y = m_nGridHeight * i;
-			p.fillRect ( 0, y, m_nMaxPatternSequence * m_nGridWidth, 2, backgroundColor );
-			p.fillRect ( 0, y + 2, m_nMaxPatternSequence * m_nGridWidth, m_nGridHeight - 4, alternateRowColor );
-			p.fillRect ( 0, y + m_nGridHeight - 2, m_nMaxPatternSequence * m_nGridWidth, 2, backgroundColor );
-		}
-	}
-*/
 	// celle...
 	p.setPen( linesColor );
 
 	// vertical lines
-	for (uint i = 0; i < m_nMaxPatternSequence + 1; i++) {
-		uint x = 10 + i * m_nGridWidth;
-		int x1 = x;
-		int x2 = x + m_nGridWidth;
+	for ( int i = nFirstColumn; i <= nLastColumn; i++ ) {
+		int x1 = 10 + i * m_nGridWidth;
+		int x2 = x1 + m_nGridWidth;
 
 		p.drawLine( x1, 0, x1, m_nGridHeight * nPatterns );
 		p.drawLine( x2, 0, x2, m_nGridHeight * nPatterns );
 	}
 
-	p.setPen( linesColor );
 	// horizontal lines
-	for (uint i = 0; i < nPatterns; i++) {
-		uint y = m_nGridHeight * i;
+	for ( int i = nFirstRow; i < nLastRow; i++ ) {
+		int y = m_nGridHeight * i;
 
 		int y1 = y + 2;
 		int y2 = y + m_nGridHeight - 2;
@@ -712,41 +722,24 @@ void SongEditor::createBackground()
 
 	p.setPen( backgroundColor );
 	// horizontal lines (erase..)
-	for (uint i = 0; i < nPatterns + 1; i++) {
-		uint y = m_nGridHeight * i;
+	for ( int i = nFirstRow; i <= nLastRow; i++ ) {
+		int y = m_nGridHeight * i;
 
 		p.fillRect( 0, y, m_nMaxPatternSequence * m_nGridWidth, 2, backgroundColor );
 		p.drawLine( 0, y + m_nGridHeight - 1, m_nMaxPatternSequence * m_nGridWidth, y + m_nGridHeight - 1 );
 	}
-
 	//~ celle
-	m_bSequenceChanged = true;
 }
 
-void SongEditor::cleanUp(){
 
-	delete m_pBackgroundPixmap;
-	delete m_pSequencePixmap;
-}
 
-void SongEditor::drawSequence()
+void SongEditor::updateCells()
 {
-	QPainter p;
-	p.begin( m_pSequencePixmap );
-	p.drawPixmap( rect(), *m_pBackgroundPixmap, rect() );
-	p.end();
-
 	Song* song = Hydrogen::get_instance()->getSong();
 	PatternList *patList = song->get_pattern_list();
 	vector<PatternList*>* pColumns = song->get_pattern_group_vector();
-	uint listLength = patList->size();
-
-	//Drawing the pattern based on the gridRepresentation array
-
-	while (!gridRepresentation.isEmpty())
-		delete gridRepresentation.takeFirst();
-
 
+	cells_t cells;
 
 	for (uint i = 0; i < pColumns->size(); i++) {
 		PatternList* pColumn = (*pColumns)[ i ];
@@ -757,47 +750,128 @@ void SongEditor::drawSequence()
 			H2Core::Pattern *pat = pColumn->get( nPat );
 
 			if (drawnAsVirtual.find(pat) == drawnAsVirtual.end()) {
-				int position = -1;
-				// find the position in pattern list
-				for (uint j = 0; j < listLength; j++) {
-					H2Core::Pattern *pat2 = patList->get( j );
-					if (pat == pat2) {
-						position = j;
-						break;
-					}
-				}
+				int position = patList->index( pat );
 				if (position == -1) {
-					WARNINGLOG( QString("[drawSequence] position == -1, group = %1").arg( i ) );
+					WARNINGLOG( QString("[updateCells] position == -1, group = %1").arg( i ) );
 				}
 				//normal pattern
-
-				gridRepresentation.append(new SongEditorGridRepresentationItem(i,position,false));
+				cells[ std::make_pair( (int)i, position ) ] |= CELL_ACTIVE;
 			}//if
 
 			for ( Pattern::virtual_patterns_cst_it_t it = pat->get_flattened_virtual_patterns()->begin(); it != pat->get_flattened_virtual_patterns()->end(); ++it) {
 				if (drawnAsVirtual.find(*it) == drawnAsVirtual.end()) {
 					int position = patList->index(*it);
 					if (position == -1) {
-						WARNINGLOG( QString("[drawSequence] position == -1, group = %1").arg( i ) );
+						WARNINGLOG( QString("[updateCells] position == -1, group = %1").arg( i ) );
 					}
 					//virtual pattern
-					gridRepresentation.append(new SongEditorGridRepresentationItem(i,position,true));
+					cells[ std::make_pair( (int)i, position ) ] |= CELL_VIRTUAL;
 					drawnAsVirtual.insert(*it);
 				}
 			}
 		}
 	}
 
+	for ( uint i = 0; i < m_selectedCells.size(); i++ ) {
+		cells[ std::make_pair( m_selectedCells[ i ].x(), m_selectedCells[ i ].y() ) ] |= CELL_SELECTED;
+	}
+	for ( uint i = 0; i < m_movingCells.size(); i++ ) {
+		cells[ std::make_pair( m_movingCells[ i ].x(), m_movingCells[ i ].y() ) ] |= CELL_MOVING;
+	}
 
-	//Draw the patterns according to the gridRepresentation
-	SongEditorGridRepresentationItem* s;
-	foreach(s, gridRepresentation)
-	{
-		drawPattern( s->x, s->y, s->value);
+	// both maps are sorted, walk them side by side
+	cells_t::const_iterator itOld = m_cells.begin();
+	cells_t::const_iterator itNew = cells.begin();
+	while ( itOld != m_cells.end() || itNew != cells.end() ) {
+		std::pair<int, int> cell;
+		if ( itNew == cells.end() || ( itOld != m_cells.end() && itOld->first < itNew->first ) ) {
+			cell = itOld->first;
+			++itOld;
+		}
+		else if ( itOld == m_cells.end() || itNew->first < itOld->first ) {
+			cell = itNew->first;
+			++itNew;
+		}
+		else {
+			bool bSame = itOld->second == itNew->second;
+			cell = itOld->first;
+			++itOld;
+			++itNew;
+			if ( bSame ) {
+				continue;
+			}
+		}
+		invalidateTiles( QRect( 10 + m_nGridWidth * cell.first, m_nGridHeight * cell.second, m_nGridWidth + 1, m_nGridHeight ) );
+	}
+
+	m_cells.swap( cells );
+}
+
+
+
+void SongEditor::invalidateTiles( const QRect& rect )
+{
+	if ( rect.right() < 0 || rect.bottom() < 0 ) {
+		return;
+	}
+	int nFirstX = std::max( 0, rect.left() ) / SONG_EDITOR_TILE_SIZE;
+	int nFirstY = std::max( 0, rect.top() ) / SONG_EDITOR_TILE_SIZE;
+	for ( int nTileY = nFirstY; nTileY <= rect.bottom() / SONG_EDITOR_TILE_SIZE; nTileY++ ) {
+		for ( int nTileX = nFirstX; nTileX <= rect.right() / SONG_EDITOR_TILE_SIZE; nTileX++ ) {
+			m_tiles.erase( std::make_pair( nTileX, nTileY ) );
+		}
+	}
+}
+
+
+
+const QPixmap& SongEditor::getTile( int nTileX, int nTileY )
+{
+	tiles_t::iterator it = m_tiles.find( std::make_pair( nTileX, nTileY ) );
+	if ( it != m_tiles.end() ) {
+		it->second.nLastUse = ++m_nTileUse;
+		return it->second.pixmap;
+	}
+
+	if ( m_tiles.size() >= SONG_EDITOR_MAX_TILES ) {
+		// drop the tile not drawn for the longest time
+		tiles_t::iterator oldest = m_tiles.begin();
+		for ( tiles_t::iterator it = m_tiles.begin(); it != m_tiles.end(); ++it ) {
+			if ( it->second.nLastUse < oldest->second.nLastUse ) {
+				oldest = it;
+			}
+		}
+		m_tiles.erase( oldest );
+	}
+
+	QRect rect( nTileX * SONG_EDITOR_TILE_SIZE, nTileY * SONG_EDITOR_TILE_SIZE, SONG_EDITOR_TILE_SIZE, SONG_EDITOR_TILE_SIZE );
+	Tile& tile = m_tiles[ std::make_pair( nTileX, nTileY ) ];
+	tile.pixmap = QPixmap( SONG_EDITOR_TILE_SIZE, SONG_EDITOR_TILE_SIZE );
+	tile.nLastUse = ++m_nTileUse;
+
+	QPainter p( &tile.pixmap );
+	p.translate( -rect.left(), -rect.top() );
+	drawBackground( p, rect );
+
+	// the cells crossing the tile, moving ones may be out of the grid
+	int nFirstColumn = ( rect.left() - 10 ) / (int)m_nGridWidth - 1;
+	int nLastColumn = ( rect.right() - 10 ) / (int)m_nGridWidth + 1;
+	int nFirstRow = rect.top() / (int)m_nGridHeight - 1;
+	int nLastRow = rect.bottom() / (int)m_nGridHeight + 1;
+	cells_t::const_iterator first = m_cells.lower_bound( std::make_pair( nFirstColumn, nFirstRow ) );
+	cells_t::const_iterator last = m_cells.upper_bound( std::make_pair( nLastColumn, nLastRow ) );
+
+	for ( cells_t::const_iterator it = first; it != last; ++it ) {
+		int nRow = it->first.second;
+		if ( nRow < nFirstRow || nRow > nLastRow ) {
+			continue;
+		}
+		if ( it->second & ( CELL_ACTIVE | CELL_VIRTUAL ) ) {
+			drawPattern( p, it->first.first, nRow, it->second & CELL_VIRTUAL, it->second & CELL_SELECTED );
+		}
 	}
 
 	// Moving cells
-	p.begin( m_pSequencePixmap );
 //	p.setRasterOp( Qt::XorROP );
 
 // comix: this composition mode seems to be not available on Mac
@@ -805,24 +879,28 @@ void SongEditor::drawSequence()
 	QPen pen( Qt::gray );
 	pen.setStyle( Qt::DotLine );
 	p.setPen( pen );
-	for ( uint i = 0; i < m_movingCells.size(); i++ ) {
-		int x = 10 + m_nGridWidth * ( m_movingCells[ i ] ).x();
-		int y = m_nGridHeight * ( m_movingCells[ i ] ).y();
+	for ( cells_t::const_iterator it = first; it != last; ++it ) {
+		int nRow = it->first.second;
+		if ( nRow < nFirstRow || nRow > nLastRow || !( it->second & CELL_MOVING ) ) {
+			continue;
+		}
+		int x = 10 + m_nGridWidth * it->first.first;
+		int y = m_nGridHeight * nRow;
 
 		QColor patternColor;
 		patternColor.setRgb( 255, 255, 255 );
 		p.fillRect( x + 2, y + 4, m_nGridWidth - 3, m_nGridHeight - 7, patternColor );
 	}
 
+	return tile.pixmap;
 }
 
 
 
-void SongEditor::drawPattern( int pos, int number, bool invertColour )
+void SongEditor::drawPattern( QPainter& p, int pos, int number, bool invertColour, bool bIsSelected )
 {
 	Preferences *pref = Preferences::get_instance();
 	UIStyle *pStyle = pref->getDefaultUIStyle();
-	QPainter p( m_pSequencePixmap );
 	QColor patternColor( pStyle->m_songEditor_pattern1Color.getRed(), pStyle->m_songEditor_pattern1Color.getGreen(), pStyle->m_songEditor_pattern1Color.getBlue() );
 
 	/*
@@ -883,15 +961,6 @@ void SongEditor::drawPattern( int pos, int number, bool invertColour )
 		patternColor = patternColor.darker(200);
 	}//if
 
-	bool bIsSelected = false;
-	for ( uint i = 0; i < m_selectedCells.size(); i++ ) {
-		QPoint point = m_selectedCells[ i ];
-		if ( point.x() == pos && point.y() == number ) {
-			bIsSelected = true;
-			break;
-		}
-	}
-
 	if ( bIsSelected ) {
 		patternColor = patternColor.darker( 130 );
 	}
@@ -1860,6 +1929,7 @@ SongEditorPositionRuler::SongEditorPositionRuler( QWidget *parent )
  : QWidget( parent )
  , Object( __class_name )
  , m_bRightBtnPressed( false )
+ , m_nPlayheadX( -1 )
 {
 	setAttribute(Qt::WA_NoBackground);
 
@@ -1982,6 +2052,7 @@ void SongEditorPositionRuler::createBackground()
 	p.fillRect ( 0, height() - 27, width(), 1, QColor(35, 39, 51) );
 	p.fillRect ( 0, height() - 3, width(), 2, alternateRowColor );
 
+	update();
 }
 
 
@@ -2089,26 +2160,10 @@ void SongEditorPositionRuler::paintEvent( QPaintEvent *ev )
 
 	Hydrogen *pEngine = Hydrogen::get_instance();
 
-	float fPos = pEngine->getPatternPos();
 	int pIPos = Preferences::get_instance()->getPunchInPos();
 	int pOPos = Preferences::get_instance()->getPunchOutPos();
 
-	if ( pEngine->getCurrentPatternList()->size() != 0 ) {
-		H2Core::Pattern *pPattern = pEngine->getCurrentPatternList()->get( 0 );
-
-		if (pPattern != nullptr){
-			fPos += (float)pEngine->getTickPosition() / (float)pPattern->get_length();
-		} else {
-			fPos += (float)pEngine->getTickPosition() / (float)MAX_NOTES;
-		}
-	}
-	else {
-		// nessun pattern, uso la grandezza di default
-		fPos += (float)pEngine->getTickPosition() / (float)MAX_NOTES;
-	}
-
 	if ( pEngine->getSong()->get_mode() == Song::PATTERN_MODE ) {
-		fPos = -1;
 		pIPos = 0;
 		pOPos = -1;
 	}
@@ -2123,8 +2178,9 @@ void SongEditorPositionRuler::paintEvent( QPaintEvent *ev )
 	);
 	painter.drawPixmap( ev->rect(), *m_pBackgroundPixmap, srcRect );
 
-	if (fPos != -1) {
-		uint x = (int)( 10 + fPos * m_nGridWidth - 11 / 2 );
+	m_nPlayheadX = getPlayheadX();
+	if ( m_nPlayheadX != -1 ) {
+		int x = m_nPlayheadX;
 		painter.drawPixmap( QRect( x, height() / 2, 11, 8), m_tickPositionPixmap, QRect(0, 0, 11, 8) );
 		painter.setPen( QColor(35, 39, 51) );
 		painter.drawLine( x + 5 , 8, x +5 , 24 );
@@ -2143,9 +2199,52 @@ void SongEditorPositionRuler::paintEvent( QPaintEvent *ev )
 
 
 
+int SongEditorPositionRuler::getPlayheadX()
+{
+	Hydrogen *pEngine = Hydrogen::get_instance();
+
+	if ( pEngine->getSong()->get_mode() == Song::PATTERN_MODE ) {
+		return -1;
+	}
+
+	float fPos = pEngine->getPatternPos();
+
+	if ( pEngine->getCurrentPatternList()->size() != 0 ) {
+		H2Core::Pattern *pPattern = pEngine->getCurrentPatternList()->get( 0 );
+
+		if (pPattern != nullptr){
+			fPos += (float)pEngine->getTickPosition() / (float)pPattern->get_length();
+		} else {
+			fPos += (float)pEngine->getTickPosition() / (float)MAX_NOTES;
+		}
+	}
+	else {
+		// nessun pattern, uso la grandezza di default
+		fPos += (float)pEngine->getTickPosition() / (float)MAX_NOTES;
+	}
+
+	if ( fPos == -1 ) {
+		return -1;
+	}
+	return (int)( 10 + fPos * m_nGridWidth - 11 / 2 );
+}
+
+
+
 void SongEditorPositionRuler::updatePosition()
 {
-	update();
+	// only the old and the new place of the playhead are drawn again
+	int nPlayheadX = getPlayheadX();
+	if ( nPlayheadX == m_nPlayheadX ) {
+		return;
+	}
+	if ( m_nPlayheadX != -1 ) {
+		update( m_nPlayheadX, 0, 11, height() );
+	}
+	if ( nPlayheadX != -1 ) {
+		update( nPlayheadX, 0, 11, height() );
+	}
+	m_nPlayheadX = nPlayheadX;
 }
 
 
@@ -23,6 +23,8 @@
 #ifndef SONG_EDITOR_H
 #define SONG_EDITOR_H
 
+#include <map>
+#include <utility>
 #include <vector>
 #include <unistd.h>
 
@@ -47,18 +49,13 @@ static const uint SONG_EDITOR_MIN_GRID_WIDTH = 8;
 static const uint SONG_EDITOR_MAX_GRID_WIDTH = 16;
 
 
-class SongEditorGridRepresentationItem
-{
-    public:
-            SongEditorGridRepresentationItem(int x, int y, bool value);
-            int x;
-            int y;
-            bool value;
-};
-
 ///
 /// Song editor
 ///
+/// The grid is drawn in tiles which are kept until the cells they
+/// show change, so scrolling and editing only draw the tiles newly
+/// exposed or touched.
+///
 class SongEditor : public QWidget, public H2Core::Object
 {
     H2_OBJECT
@@ -69,8 +66,6 @@ class SongEditor : public QWidget, public H2Core::Object
 		~SongEditor();
 
 		void createBackground();
-		
-		void cleanUp();
 
 		int getGridWidth ();
 		void setGridWidth( uint width);
@@ -82,8 +77,28 @@ class SongEditor : public QWidget, public H2Core::Object
                 void movePatternCellAction( std::vector<QPoint> movingCells, std::vector<QPoint> selectedCells, std::vector<QPoint> m_existingCells, bool bIsCtrlPressed, bool undo);
 
 	private:
-                //holds a list for active patterns for each pattern
-                QList<SongEditorGridRepresentationItem*> gridRepresentation;
+		/// state of a cell of the grid, combined as flags
+		enum CellFlags {
+			CELL_ACTIVE = 1,	///< the pattern is played in this column
+			CELL_VIRTUAL = 2,	///< played as part of a virtual pattern
+			CELL_SELECTED = 4,
+			CELL_MOVING = 8
+		};
+		/// CellFlags of the cells not empty, by column and row
+		typedef std::map< std::pair<int, int>, int > cells_t;
+
+		struct Tile {
+			QPixmap pixmap;
+			unsigned nLastUse;
+		};
+		/// drawn tiles, by column and row of the tile
+		typedef std::map< std::pair<int, int>, Tile > tiles_t;
+
+		cells_t m_cells;
+		tiles_t m_tiles;
+		unsigned m_nTileUse;
+		/// what the tiles were drawn with, see createBackground()
+		std::vector<int> m_tileLook;
 
 		unsigned m_nGridHeight;
 		unsigned m_nGridWidth;
@@ -92,9 +107,6 @@ class SongEditor : public QWidget, public H2Core::Object
 		bool m_bIsMoving;
 		bool m_bIsCtrlPressed;
 
-		QPixmap *m_pBackgroundPixmap;
-		QPixmap *m_pSequencePixmap;
-
 		std::vector<QPoint> m_selectedCells;
 		std::vector<QPoint> m_movingCells;
                 std::vector<QPoint> m_existingCells;
@@ -109,8 +121,12 @@ class SongEditor : public QWidget, public H2Core::Object
 		virtual void keyPressEvent (QKeyEvent *ev);
 		virtual void paintEvent(QPaintEvent *ev);
 
-		void drawSequence();
-		void drawPattern( int pos, int number, bool invertColour );
+		/// find the cells changed since the last call and drop their tiles
+		void updateCells();
+		void invalidateTiles( const QRect& rect );
+		const QPixmap& getTile( int nTileX, int nTileY );
+		void drawBackground( QPainter& p, const QRect& rect );
+		void drawPattern( QPainter& p, int pos, int number, bool invertColour, bool bIsSelected );
 };
 
 
@@ -222,6 +238,11 @@ class SongEditorPositionRuler : public QWidget, public H2Core::Object
 		QPixmap *			m_pBackgroundPixmap;
 		QPixmap				m_tickPositionPixmap;
 		bool				m_bRightBtnPressed;
+		/// where the playhead was drawn last, -1 if it was not
+		int					m_nPlayheadX;
+
+		/// \return the left edge of the playhead, -1 if there is none
+		int getPlayheadX();
 		
 		virtual void mouseMoveEvent(QMouseEvent *ev);
 		virtual void mousePressEvent( QMouseEvent *ev );
@@ -385,7 +385,6 @@ SongEditorPanel::SongEditorPanel(QWidget *pParent)
 	m_pTimer = new QTimer(this);
 	
 	connect(m_pTimer, SIGNAL(timeout()), this, SLOT( updatePlayHeadPosition() ) );
-	connect(m_pTimer, SIGNAL(timeout()), this, SLOT( updatePlaybackFaderPeaks() ) );
 	
 	m_pTimer->start(100);
 }
@@ -424,13 +423,10 @@ void SongEditorPanel::updatePlayHeadPosition()
 	}
 }
 
-void SongEditorPanel::updatePlaybackFaderPeaks()
+void SongEditorPanel::updatePlaybackFaderPeaks( const Meters::Frame* pLevels )
 {
-	Sampler*		pSampler = AudioEngine::get_instance()->get_sampler();
 	Preferences *	pPref = Preferences::get_instance();
-	Instrument*		pInstrument = pSampler->__playback_instrument;
 
-	
 	bool bShowPeaks = pPref->showInstrumentPeaks();
 	float fallOff = pPref->getMixerFalloffSpeed();
 	
@@ -438,11 +434,9 @@ void SongEditorPanel::updatePlaybackFaderPeaks()
 	float fOldPeak_L = m_pPlaybackTrackFader->getPeak_L();
 	float fOldPeak_R = m_pPlaybackTrackFader->getPeak_R();
 	
-	float fNewPeak_L = pInstrument->get_peak_l();
-	pInstrument->set_peak_l( 0.0f );	// reset instrument peak
-
-	float fNewPeak_R = pInstrument->get_peak_r();
-	pInstrument->set_peak_r( 0.0f );	// reset instrument peak
+	const Meters::Levels* pTrackLevels = pLevels ? pLevels->get( Meters::PLAYBACK_TRACK ) : nullptr;
+	float fNewPeak_L = pTrackLevels ? pTrackLevels->peak_l : 0.0f;
+	float fNewPeak_R = pTrackLevels ? pTrackLevels->peak_r : 0.0f;
 
 	if (!bShowPeaks) {
 		fNewPeak_L = 0.0f;
@@ -502,8 +496,6 @@ void SongEditorPanel::updateAll()
 	m_pPatternList->createBackground();
 	m_pPatternList->update();
 
-	m_pSongEditor->cleanUp();
-
 	m_pSongEditor->createBackground();
 	m_pSongEditor->update();
 
@@ -27,6 +27,7 @@
 #include "../EventListener.h"
 #include <hydrogen/object.h>
 #include <hydrogen/basics/pattern.h>
+#include <hydrogen/meters.h>
 
 #include <QtGui>
 #if QT_VERSION >= 0x050000
@@ -73,6 +74,11 @@ class SongEditorPanel : public QWidget, public EventListener, public H2Core::Obj
 		void showTimeline();
 		void showPlaybackTrack();
 		void updatePlaybackTrackIfNecessary();		
+		/**
+		 * update the peaks of the playback track fader
+		 * \param pLevels see Mixer::updateMixer()
+		 */
+		void updatePlaybackFaderPeaks( const H2Core::Meters::Frame* pLevels );
 		
 		// Implements EventListener interface
 		virtual void selectedPatternChangedEvent();
@@ -92,7 +98,6 @@ class SongEditorPanel : public QWidget, public EventListener, public H2Core::Obj
 		void downBtnClicked( Button* );
 		void clearSequence( Button* );
 		
-		void updatePlaybackFaderPeaks();
 		void updatePlayHeadPosition();
 
 		void pointerActionBtnPressed( Button* pBtn );
@@ -48,6 +48,7 @@
 
 #include <hydrogen/LocalFileMng.h>
 #include <hydrogen/basics/adsr.h>
+#include <hydrogen/basics/drumkit_index.h>
 #include <hydrogen/audio_engine.h>
 #include <hydrogen/h2_exception.h>
 #include <hydrogen/hydrogen.h>
@@ -80,6 +81,8 @@ SoundLibraryPanel::SoundLibraryPanel( QWidget *pParent, bool bInItsOwnDialog )
  , __song_item( nullptr )
  , __pattern_item( nullptr )
  , __pattern_item_list( nullptr )
+ , __drumkit_watcher( nullptr )
+ , __drumkit_refresh_timer( nullptr )
 {
 
 	//INFOLOG( "INIT" );
@@ -132,22 +135,66 @@ SoundLibraryPanel::SoundLibraryPanel( QWidget *pParent, bool bInItsOwnDialog )
 	__expand_songs_list = Preferences::get_instance()->__expandSongItem;
 
 	updateDrumkitList();
+
+	// Installing or removing a drumkit behind our back changes the
+	// mtime of its parent directory. Several of them usually come at
+	// once, the list is rebuilt after they settled.
+	__drumkit_refresh_timer = new QTimer( this );
+	__drumkit_refresh_timer->setSingleShot( true );
+	__drumkit_refresh_timer->setInterval( 500 );
+	connect( __drumkit_refresh_timer, SIGNAL( timeout() ), this, SLOT( on_drumkitDirChanged() ) );
+	__drumkit_watcher = new QFileSystemWatcher( this );
+	__drumkit_watcher->addPath( Filesystem::sys_drumkits_dir() );
+	__drumkit_watcher->addPath( Filesystem::usr_drumkits_dir() );
+	connect( __drumkit_watcher, SIGNAL( directoryChanged( const QString& ) ), __drumkit_refresh_timer, SLOT( start() ) );
+
+	HydrogenApp::get_instance()->addEventListener( this );
 }
 
 
 
 SoundLibraryPanel::~SoundLibraryPanel()
 {
-	for (uint i = 0; i < __system_drumkit_info_list.size(); ++i ) {
-		delete __system_drumkit_info_list[i];
+	HydrogenApp::get_instance()->removeEventListener( this );
+
+	clear_drumkit_info();
+}
+
+
+
+H2Core::Drumkit* SoundLibraryPanel::get_drumkit_info( const QString& sName )
+{
+	auto it = __drumkit_info.find( sName );
+	if ( it != __drumkit_info.end() ) {
+		return it->second;
+	}
+	DrumkitIndex::Entry entry;
+	if ( !DrumkitIndex::get_instance()->find( sName, &entry ) ) {
+		return nullptr;
 	}
-	__system_drumkit_info_list.clear();
+	Drumkit* pInfo = Drumkit::load( entry.path, false );
+	if ( pInfo != nullptr ) {
+		__drumkit_info[ sName ] = pInfo;
+	}
+	return pInfo;
+}
 
-	for (uint i = 0; i < __user_drumkit_info_list.size(); ++i ) {
-		delete __user_drumkit_info_list[i];
+
+
+void SoundLibraryPanel::clear_drumkit_info()
+{
+	for ( auto& it : __drumkit_info ) {
+		delete it.second;
 	}
-	__user_drumkit_info_list.clear();
+	__drumkit_info.clear();
+}
+
 
+
+void SoundLibraryPanel::on_drumkitDirChanged()
+{
+	test_expandedItems();
+	updateDrumkitList();
 }
 
 
@@ -172,57 +219,36 @@ void SoundLibraryPanel::updateDrumkitList()
 
 	
 
-	for (uint i = 0; i < __system_drumkit_info_list.size(); ++i ) {
-		delete __system_drumkit_info_list[i];
-	}
-	__system_drumkit_info_list.clear();
-
-	for (uint i = 0; i < __user_drumkit_info_list.size(); ++i ) {
-		delete __user_drumkit_info_list[i];
-	}
-	__user_drumkit_info_list.clear();
+	// only the drumkits which changed since the last time are parsed
+	clear_drumkit_info();
+	DrumkitIndex* pIndex = DrumkitIndex::get_instance();
+	pIndex->refresh();
 
 	//User drumkit list
-	QStringList usr_dks = Filesystem::usr_drumkit_list();
-	for (int i = 0; i < usr_dks.size(); ++i) {
-		QString absPath = Filesystem::usr_drumkits_dir() + usr_dks[i];
-		Drumkit *pInfo = Drumkit::load( absPath, false );
-		if (pInfo) {
-			__user_drumkit_info_list.push_back( pInfo );
-			QTreeWidgetItem* pDrumkitItem = new QTreeWidgetItem( __user_drumkits_item );
-			pDrumkitItem->setText( 0, pInfo->get_name() );
-			if ( QString(pInfo->get_name() ) == currentSL ){
-				pDrumkitItem->setBackground( 0, QColor( 50, 50, 50) );
-			}
-			InstrumentList *pInstrList = pInfo->get_instruments();
-			for ( uint nInstr = 0; nInstr < pInstrList->size(); ++nInstr ) {
-				Instrument *pInstr = pInstrList->get( nInstr );
-				QTreeWidgetItem* pInstrumentItem = new QTreeWidgetItem( pDrumkitItem );
-				pInstrumentItem->setText( 0, QString( "[%1] " ).arg( nInstr + 1 ) + pInstr->get_name() );
-				pInstrumentItem->setToolTip( 0, pInstr->get_name() );
-			}
+	for ( const DrumkitIndex::Entry& entry : pIndex->get_drumkits( false ) ) {
+		QTreeWidgetItem* pDrumkitItem = new QTreeWidgetItem( __user_drumkits_item );
+		pDrumkitItem->setText( 0, entry.name );
+		if ( entry.name == currentSL ){
+			pDrumkitItem->setBackground( 0, QColor( 50, 50, 50) );
+		}
+		for ( int nInstr = 0; nInstr < entry.instruments.size(); ++nInstr ) {
+			QTreeWidgetItem* pInstrumentItem = new QTreeWidgetItem( pDrumkitItem );
+			pInstrumentItem->setText( 0, QString( "[%1] " ).arg( nInstr + 1 ) + entry.instruments[ nInstr ] );
+			pInstrumentItem->setToolTip( 0, entry.instruments[ nInstr ] );
 		}
 	}
 
 	//System drumkit list
-	QStringList sys_dks = Filesystem::sys_drumkit_list();
-	for (int i = 0; i < sys_dks.size(); ++i) {
-		QString absPath = Filesystem::sys_drumkits_dir() + sys_dks[i];
-		Drumkit *pInfo = Drumkit::load( absPath, false );
-		if (pInfo) {
-			__system_drumkit_info_list.push_back( pInfo );
-			QTreeWidgetItem* pDrumkitItem = new QTreeWidgetItem( __system_drumkits_item );
-			pDrumkitItem->setText( 0, pInfo->get_name() );
-			if ( QString( pInfo->get_name() ) == currentSL ){
-				pDrumkitItem->setBackground( 0, QColor( 50, 50, 50) );
-			}
-			InstrumentList *pInstrList = pInfo->get_instruments();
-			for ( uint nInstr = 0; nInstr < pInstrList->size(); ++nInstr ) {
-				Instrument *pInstr = pInstrList->get( nInstr );
-				QTreeWidgetItem* pInstrumentItem = new QTreeWidgetItem( pDrumkitItem );
-				pInstrumentItem->setText( 0, QString( "[%1] " ).arg( nInstr + 1 ) + pInstr->get_name() );
-				pInstrumentItem->setToolTip( 0, pInstr->get_name() );
-			}
+	for ( const DrumkitIndex::Entry& entry : pIndex->get_drumkits( true ) ) {
+		QTreeWidgetItem* pDrumkitItem = new QTreeWidgetItem( __system_drumkits_item );
+		pDrumkitItem->setText( 0, entry.name );
+		if ( entry.name == currentSL ){
+			pDrumkitItem->setBackground( 0, QColor( 50, 50, 50) );
+		}
+		for ( int nInstr = 0; nInstr < entry.instruments.size(); ++nInstr ) {
+			QTreeWidgetItem* pInstrumentItem = new QTreeWidgetItem( pDrumkitItem );
+			pInstrumentItem->setText( 0, QString( "[%1] " ).arg( nInstr + 1 ) + entry.instruments[ nInstr ] );
+			pInstrumentItem->setToolTip( 0, entry.instruments[ nInstr ] );
 		}
 	}
 	
@@ -476,23 +502,10 @@ void SoundLibraryPanel::on_drumkitLoadAction()
 
 	QString sDrumkitName = __sound_library_tree->currentItem()->text(0);
 
-	Drumkit *drumkitInfo = nullptr;
-
-	// find the drumkit in the list
-	for ( uint i = 0; i < __system_drumkit_info_list.size(); i++ ) {
-		Drumkit *pInfo = __system_drumkit_info_list[i];
-		if ( pInfo->get_name() == sDrumkitName ) {
-			drumkitInfo = pInfo;
-			break;
-		}
-	}
-	
-	for ( uint i = 0; i < __user_drumkit_info_list.size(); i++ ) {
-		Drumkit *pInfo = __user_drumkit_info_list[i];
-		if ( pInfo->get_name() == sDrumkitName ) {
-			drumkitInfo = pInfo;
-			break;
-		}
+	Drumkit *drumkitInfo = get_drumkit_info( sDrumkitName );
+	if ( drumkitInfo == nullptr ) {
+		QMessageBox::warning( this, "Hydrogen", tr( "Unable to load the drumkit" ) );
+		return;
 	}
 
 	InstrumentList *pSongInstrList = Hydrogen::get_instance()->getSong()->get_instrument_list();
@@ -561,20 +574,46 @@ void SoundLibraryPanel::on_drumkitLoadAction()
 
 	assert( drumkitInfo );
 
-	QApplication::setOverrideCursor(Qt::WaitCursor);
+	// The samples are decoded in the background while the current
+	// kit keeps on playing, drumkitLoadedEvent() swaps the new one in.
+	if ( !Hydrogen::get_instance()->loadDrumkitAsync( drumkitInfo, conditionalLoad ) ) {
+		QMessageBox::warning( this, "Hydrogen", tr( "Unable to load the drumkit" ) );
+		return;
+	}
+	__loading_drumkit = drumkitInfo->get_name();
+	HydrogenApp::get_instance()->setStatusBarMessage( tr( "Loading drumkit %1..." ).arg( __loading_drumkit ) );
+
+	__sound_library_tree->currentItem()->setBackground( 0, QColor( 50, 50, 50) );
+}
+
+void SoundLibraryPanel::drumkitLoadProgressEvent( int nValue )
+{
+	if ( __loading_drumkit.isEmpty() ) {
+		return;
+	}
+	HydrogenApp::get_instance()->setStatusBarMessage( tr( "Loading drumkit %1... %2%" ).arg( __loading_drumkit ).arg( nValue ) );
+}
 
+void SoundLibraryPanel::drumkitLoadedEvent( int nValue )
+{
+	UNUSED( nValue );
+	if ( __loading_drumkit.isEmpty() ) {
+		return;
+	}
 
-	Hydrogen::get_instance()->loadDrumkit( drumkitInfo, conditionalLoad );
-	Hydrogen::get_instance()->getSong()->set_is_modified( true );
-	HydrogenApp::get_instance()->onDrumkitLoad( drumkitInfo->get_name() );
+	Hydrogen* pHydrogen = Hydrogen::get_instance();
+	// an outdated notification, a more recent load is still running
+	if ( pHydrogen->finishDrumkitLoad() != 0 ) {
+		return;
+	}
+	__loading_drumkit.clear();
+
+	pHydrogen->getSong()->set_is_modified( true );
+	HydrogenApp::get_instance()->onDrumkitLoad( pHydrogen->getCurrentDrumkitname() );
 	HydrogenApp::get_instance()->getPatternEditorPanel()->getDrumPatternEditor()->updateEditor();
 	HydrogenApp::get_instance()->getPatternEditorPanel()->updatePianorollEditor();
 
 	InstrumentEditorPanel::get_instance()->notifyOfDrumkitChange();
-
-	__sound_library_tree->currentItem()->setBackground( 0, QColor( 50, 50, 50) );
-	QApplication::restoreOverrideCursor();
-
 }
 
 
@@ -666,46 +705,12 @@ void SoundLibraryPanel::on_drumkitPropertiesAction()
 {
 	QString sDrumkitName = __sound_library_tree->currentItem()->text(0);
 
-	Drumkit *drumkitInfo = nullptr;
-
-	// find the drumkit in the list
-	for ( uint i = 0; i < __system_drumkit_info_list.size(); i++ ) {
-		Drumkit *pInfo = __system_drumkit_info_list[i];
-		if ( pInfo->get_name() == sDrumkitName ) {
-			drumkitInfo = pInfo;
-			break;
-		}
-	}
-	for ( uint i = 0; i < __user_drumkit_info_list.size(); i++ ) {
-		Drumkit*pInfo = __user_drumkit_info_list[i];
-		if ( pInfo->get_name() == sDrumkitName ) {
-			drumkitInfo = pInfo;
-			break;
-		}
-	}
-
+	Drumkit *drumkitInfo = get_drumkit_info( sDrumkitName );
 	assert( drumkitInfo );
 
 	QString sPreDrumkitName = Hydrogen::get_instance()->getCurrentDrumkitname();
 
-	Drumkit *preDrumkitInfo = nullptr;
-	
-
-	// find the drumkit in the list
-	for ( uint i = 0; i < __system_drumkit_info_list.size(); i++ ) {
-		Drumkit *prInfo = __system_drumkit_info_list[i];
-		if ( prInfo->get_name() == sPreDrumkitName ) {
-			preDrumkitInfo = prInfo;
-			break;
-		}
-	}
-	for ( uint i = 0; i < __user_drumkit_info_list.size(); i++ ) {
-		Drumkit *prInfo = __user_drumkit_info_list[i];
-		if ( prInfo->get_name() == sPreDrumkitName ) {
-			preDrumkitInfo = prInfo;
-			break;
-		}
-	}
+	Drumkit *preDrumkitInfo = get_drumkit_info( sPreDrumkitName );
 
 	if ( preDrumkitInfo == nullptr ){
 		QMessageBox::warning( this, "Hydrogen", QString( "The current loaded song missing his soundlibrary.\nPlease load a existing soundlibrary first") );
@@ -728,7 +733,9 @@ void SoundLibraryPanel::on_instrumentDeleteAction()
 
 void SoundLibraryPanel::on_songLoadAction()
 {
-	QString sFilename = Filesystem::song_path( __sound_library_tree->currentItem()->text( 0 ) );
+	// the tooltip holds the file name, with the extension of a
+	// text or a binary song
+	QString sFilename = Filesystem::songs_dir() + __sound_library_tree->currentItem()->toolTip( 0 );
 
 	Hydrogen *pHydrogen = Hydrogen::get_instance();
 	if ( pHydrogen->getState() == STATE_PLAYING ) {
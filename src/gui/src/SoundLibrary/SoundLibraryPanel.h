@@ -29,9 +29,11 @@
 #  include <QtWidgets>
 #endif
 
+#include <map>
 #include <vector>
 
 #include <hydrogen/object.h>
+#include "../EventListener.h"
 
 namespace H2Core
 {
@@ -43,7 +45,7 @@ namespace H2Core
 class SoundLibraryTree;
 class ToggleButton;
 
-class SoundLibraryPanel : public QWidget, private H2Core::Object
+class SoundLibraryPanel : public QWidget, public EventListener, private H2Core::Object
 {
 	H2_OBJECT
 Q_OBJECT
@@ -55,6 +57,9 @@ public:
 	void test_expandedItems();
 	void update_background_color();
 
+	virtual void drumkitLoadProgressEvent( int nValue ) override;
+	virtual void drumkitLoadedEvent( int nValue ) override;
+
 public slots:
 	void on_drumkitLoadAction();
 
@@ -72,6 +77,7 @@ private slots:
 	void on_songLoadAction();
 	void on_patternLoadAction();
 	void on_patternDeleteAction();
+	void on_drumkitDirChanged();
 
 signals:
 	void item_changed(bool bDrumkitSelected);
@@ -93,10 +99,18 @@ private:
 	QTreeWidgetItem* __pattern_item;
 	QTreeWidgetItem* __pattern_item_list;
 
-	std::vector<H2Core::Drumkit*> __system_drumkit_info_list;
-	std::vector<H2Core::Drumkit*> __user_drumkit_info_list;
+	/** drumkits loaded from the index by get_drumkit_info(), by name */
+	std::map<QString, H2Core::Drumkit*> __drumkit_info;
+	/** watches the drumkits directories, see on_drumkitDirChanged() */
+	QFileSystemWatcher* __drumkit_watcher;
+	QTimer* __drumkit_refresh_timer;
 	bool __expand_pattern_list;
 	bool __expand_songs_list;
+	/** drumkit this panel is loading in the background, empty if none */
+	QString __loading_drumkit;
+	/** \return the drumkit named \a sName without its samples, loaded once */
+	H2Core::Drumkit* get_drumkit_info( const QString& sName );
+	void clear_drumkit_info();
 	void restore_background_color();
 	void change_background_color();
 
@@ -55,3 +55,25 @@ void ADSRTest::testRelease()
 	/* Idle */
 	CPPUNIT_ASSERT_DOUBLES_EQUAL( 0.0, m_adsr->get_value( 2.0 ), delta );
 }
+
+
+void ADSRTest::testGetValues()
+{
+	ADSR other( m_adsr );
+	float values[ 64 ];
+
+	/* Block values must match the ones computed frame by frame,
+	   across attack, decay, sustain and release */
+	m_adsr->get_values( values, 8, 0.5 );
+	for ( int i = 0; i < 8; ++i ) {
+		CPPUNIT_ASSERT_DOUBLES_EQUAL( other.get_value( 0.5 ), values[ i ], delta );
+	}
+
+	m_adsr->release();
+	other.release();
+	m_adsr->get_values( values, 64, 16.0 );
+	for ( int i = 0; i < 64; ++i ) {
+		CPPUNIT_ASSERT_DOUBLES_EQUAL( other.get_value( 16.0 ), values[ i ], delta );
+	}
+	CPPUNIT_ASSERT_DOUBLES_EQUAL( 0.0, values[ 63 ], delta );
+}
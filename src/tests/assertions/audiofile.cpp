@@ -23,6 +23,7 @@
 #include "audiofile.h"
 
 #include <sndfile.h>
+#include <cstdlib>
 #include <memory>
 
 static constexpr qint64 BUFFER_SIZE = 4096;
@@ -88,3 +89,55 @@ void H2Test::checkAudioFilesEqual(const QString &expected, const QString &actual
 		remainingSamples -= read1;
 	}
 }
+
+/** all the samples of \a fileName, interleaved */
+static std::vector<short> readAudioFile(const QString &fileName, SF_INFO &info, CppUnit::SourceLine sourceLine)
+{
+	info = {0};
+	std::unique_ptr<SNDFILE, decltype(&sf_close)>
+		f{ sf_open( fileName.toLocal8Bit().data(), SFM_READ, &info), sf_close };
+	if ( f == nullptr ) {
+		CppUnit::Message msg(
+			std::string("Can't open ") + fileName.toStdString(),
+			sf_strerror( nullptr )
+		);
+		throw CppUnit::Exception(msg, sourceLine);
+	}
+
+	std::vector<short> samples( info.frames * info.channels );
+	auto read = sf_read_short( f.get(), samples.data(), samples.size() );
+	if ( read != (sf_count_t)samples.size() ) throw CppUnit::Exception( CppUnit::Message( "Short read or read error" ), sourceLine );
+	return samples;
+}
+
+void H2Test::checkAudioFilesSum(const QString &expected, const std::vector<QString> &parts, int tolerance, CppUnit::SourceLine sourceLine)
+{
+	SF_INFO info;
+	std::vector<short> total = readAudioFile( expected, info, sourceLine );
+	std::vector<int> sum( total.size(), 0 );
+
+	for ( const QString &part : parts ) {
+		SF_INFO partInfo;
+		std::vector<short> samples = readAudioFile( part, partInfo, sourceLine );
+		if ( partInfo.frames != info.frames || partInfo.channels != info.channels ) {
+			CppUnit::Message msg(
+				"Number of samples different",
+				std::string("Expected: ") + expected.toStdString(),
+				std::string("Part    : ") + part.toStdString() );
+			throw CppUnit::Exception(msg, sourceLine);
+		}
+		for ( size_t i = 0; i < samples.size(); ++i ) {
+			sum[i] += samples[i];
+		}
+	}
+
+	for ( size_t i = 0; i < total.size(); ++i ) {
+		if ( std::abs( sum[i] - total[i] ) > tolerance ) {
+			CppUnit::Message msg(
+				std::string("Parts don't add up at sample ") + std::to_string(i + 1),
+				std::string("Expected: ") + std::to_string(total[i]),
+				std::string("Sum     : ") + std::to_string(sum[i]) );
+			throw CppUnit::Exception(msg, sourceLine);
+		}
+	}
+}
@@ -25,10 +25,12 @@
 
 #include <cppunit/extensions/HelperMacros.h>
 #include <QString>
+#include <vector>
 
 namespace H2Test {
 	
 	void checkAudioFilesEqual(const QString &expected, const QString &actual, CppUnit::SourceLine sourceLine);
+	void checkAudioFilesSum(const QString &expected, const std::vector<QString> &parts, int tolerance, CppUnit::SourceLine sourceLine);
 
 }
 
@@ -38,5 +40,12 @@ namespace H2Test {
 #define H2TEST_ASSERT_AUDIO_FILES_EQUAL(expected, actual) \
 	H2Test::checkAudioFilesEqual(expected, actual, CPPUNIT_SOURCELINE())
 
+/**
+ * \brief Assert that the samples of several files add up to the ones
+ * of another, each 16 bit sample within a tolerance
+ **/
+#define H2TEST_ASSERT_AUDIO_FILES_SUM(expected, parts, tolerance) \
+	H2Test::checkAudioFilesSum(expected, parts, tolerance, CPPUNIT_SOURCELINE())
+
 #endif
 
@@ -0,0 +1,119 @@
+#include <cppunit/extensions/HelperMacros.h>
+#include "test_helper.h"
+
+#include <QDir>
+#include <QFile>
+
+#include <hydrogen/basics/drumkit_index.h>
+#include <hydrogen/helpers/filesystem.h>
+
+using namespace H2Core;
+
+class DrumkitIndexTest : public CppUnit::TestCase {
+	CPPUNIT_TEST_SUITE( DrumkitIndexTest );
+	CPPUNIT_TEST( testRefresh );
+	CPPUNIT_TEST( testPersistence );
+	CPPUNIT_TEST_SUITE_END();
+
+	QString m_sDir;
+	QString m_sIndex;
+	QString m_sSysDir;
+	QString m_sUsrDir;
+
+	void copyKit( const QString& sName )
+	{
+		QString sDst = m_sUsrDir + sName;
+		CPPUNIT_ASSERT( Filesystem::mkdir( sDst ) );
+		const char* files[] = { "drumkit.xml", "crash.wav", "hh.wav", "kick.wav", "snare.wav" };
+		for ( const char* sFile : files ) {
+			CPPUNIT_ASSERT( Filesystem::file_copy( H2TEST_FILE( QString( "drumkits/baseKit/" ) + sFile ), sDst + "/" + sFile ) );
+		}
+	}
+
+	public:
+	void setUp()
+	{
+		m_sDir = Filesystem::tmp_dir() + "/drumkit_index";
+		m_sIndex = m_sDir + "/drumkits.idx";
+		m_sSysDir = m_sDir + "/sys/";
+		m_sUsrDir = m_sDir + "/usr/";
+		Filesystem::mkdir( m_sSysDir );
+		Filesystem::mkdir( m_sUsrDir );
+	}
+
+	void tearDown()
+	{
+		Filesystem::rm( m_sDir, true );
+	}
+
+	void testRefresh()
+	{
+		copyKit( "baseKit" );
+		DrumkitIndex index( m_sIndex, m_sSysDir, m_sUsrDir );
+		CPPUNIT_ASSERT( index.refresh() );
+		CPPUNIT_ASSERT_EQUAL( 1, index.get_parsed() );
+		CPPUNIT_ASSERT( index.get_drumkits( true ).empty() );
+
+		std::vector<DrumkitIndex::Entry> drumkits = index.get_drumkits( false );
+		CPPUNIT_ASSERT_EQUAL( (size_t)1, drumkits.size() );
+		const DrumkitIndex::Entry& entry = drumkits[ 0 ];
+		CPPUNIT_ASSERT( entry.path == m_sUsrDir + "baseKit" );
+		CPPUNIT_ASSERT( entry.name == "H2 test DK" );
+		CPPUNIT_ASSERT( entry.license == "MIT" );
+		CPPUNIT_ASSERT_EQUAL( 4, entry.instruments.size() );
+		CPPUNIT_ASSERT_EQUAL( 5, entry.samples.size() );
+		CPPUNIT_ASSERT( entry.samples_size > 0 );
+
+		// nothing changed
+		CPPUNIT_ASSERT( !index.refresh() );
+		CPPUNIT_ASSERT_EQUAL( 0, index.get_parsed() );
+
+		// only the modified drumkit is parsed again
+		copyKit( "otherKit" );
+		QFile file( m_sUsrDir + "baseKit/drumkit.xml" );
+		CPPUNIT_ASSERT( file.open( QIODevice::Append ) );
+		file.write( "\n" );
+		file.close();
+		CPPUNIT_ASSERT( index.refresh() );
+		CPPUNIT_ASSERT_EQUAL( 2, index.get_parsed() );
+		CPPUNIT_ASSERT_EQUAL( (size_t)2, index.get_drumkits( false ).size() );
+
+		CPPUNIT_ASSERT( Filesystem::rm( m_sUsrDir + "otherKit", true ) );
+		CPPUNIT_ASSERT( index.refresh() );
+		CPPUNIT_ASSERT_EQUAL( 0, index.get_parsed() );
+		CPPUNIT_ASSERT_EQUAL( (size_t)1, index.get_drumkits( false ).size() );
+
+		DrumkitIndex::Entry found;
+		CPPUNIT_ASSERT( index.find( "H2 test DK", &found ) );
+		CPPUNIT_ASSERT( found.path == m_sUsrDir + "baseKit" );
+		CPPUNIT_ASSERT( !index.find( "missing", &found ) );
+	}
+
+	void testPersistence()
+	{
+		copyKit( "baseKit" );
+		{
+			DrumkitIndex index( m_sIndex, m_sSysDir, m_sUsrDir );
+			CPPUNIT_ASSERT( index.refresh() );
+		}
+		CPPUNIT_ASSERT( QFile::exists( m_sIndex ) );
+
+		// a later session starts from the saved index
+		DrumkitIndex index( m_sIndex, m_sSysDir, m_sUsrDir );
+		CPPUNIT_ASSERT_EQUAL( (size_t)1, index.get_drumkits( false ).size() );
+		CPPUNIT_ASSERT( !index.refresh() );
+		CPPUNIT_ASSERT_EQUAL( 0, index.get_parsed() );
+		DrumkitIndex::Entry found;
+		CPPUNIT_ASSERT( index.find( "H2 test DK", &found ) );
+		CPPUNIT_ASSERT_EQUAL( 4, found.instruments.size() );
+
+		// a damaged index is dropped and rebuilt
+		QFile::resize( m_sIndex, 10 );
+		DrumkitIndex damaged( m_sIndex, m_sSysDir, m_sUsrDir );
+		CPPUNIT_ASSERT( damaged.get_drumkits( false ).empty() );
+		CPPUNIT_ASSERT( damaged.refresh() );
+		CPPUNIT_ASSERT_EQUAL( 1, damaged.get_parsed() );
+	}
+};
+
+CPPUNIT_TEST_SUITE_REGISTRATION( DrumkitIndexTest );
@@ -0,0 +1,138 @@
+#include <cppunit/extensions/HelperMacros.h>
+#include "test_helper.h"
+
+#include <unistd.h>
+
+#include <hydrogen/drumkit_loader.h>
+#include <hydrogen/basics/drumkit.h>
+#include <hydrogen/basics/drumkit_component.h>
+#include <hydrogen/basics/instrument.h>
+#include <hydrogen/basics/instrument_component.h>
+#include <hydrogen/basics/instrument_layer.h>
+#include <hydrogen/basics/instrument_list.h>
+#include <hydrogen/basics/note.h>
+#include <hydrogen/basics/note_pool.h>
+#include <hydrogen/basics/sample.h>
+#include <hydrogen/basics/song.h>
+#include <hydrogen/audio_engine.h>
+#include <hydrogen/hydrogen.h>
+#include <hydrogen/sampler/Sampler.h>
+
+using namespace H2Core;
+
+class DrumkitLoaderTest : public CppUnit::TestCase {
+	CPPUNIT_TEST_SUITE( DrumkitLoaderTest );
+	CPPUNIT_TEST( testRun );
+	CPPUNIT_TEST( testStart );
+	CPPUNIT_TEST( testCancel );
+	CPPUNIT_TEST( testTakeFrom );
+	CPPUNIT_TEST( testPublishStopsNotes );
+	CPPUNIT_TEST_SUITE_END();
+
+	Drumkit* m_pDrumkit;
+
+	public:
+	void setUp()
+	{
+		m_pDrumkit = Drumkit::load( H2TEST_FILE( "/drumkits/baseKit" ) );
+		CPPUNIT_ASSERT( m_pDrumkit != nullptr );
+	}
+
+	void tearDown()
+	{
+		delete m_pDrumkit;
+	}
+
+	void checkLoaded( DrumkitLoader* pLoader )
+	{
+		CPPUNIT_ASSERT( pLoader->is_done() );
+		InstrumentList* pInstrList = pLoader->get_instruments();
+		CPPUNIT_ASSERT_EQUAL( m_pDrumkit->get_instruments()->size(), pInstrList->size() );
+		CPPUNIT_ASSERT_EQUAL( m_pDrumkit->get_components()->size(), pLoader->get_components()->size() );
+
+		for ( int nInstr = 0; nInstr < pInstrList->size(); ++nInstr ) {
+			Instrument* pInstr = pInstrList->get( nInstr );
+			CPPUNIT_ASSERT( pInstr->get_name() == m_pDrumkit->get_instruments()->get( nInstr )->get_name() );
+			InstrumentLayer* pLayer = pInstr->get_components()->front()->get_layer( 0 );
+			CPPUNIT_ASSERT( pLayer != nullptr );
+			CPPUNIT_ASSERT( pLayer->get_sample()->get_frames() > 0 );
+			CPPUNIT_ASSERT( pLayer->get_sample()->is_shared() );
+		}
+	}
+
+	void testRun()
+	{
+		DrumkitLoader loader( m_pDrumkit, 3 );
+		// the loader works on a copy
+		delete m_pDrumkit;
+		m_pDrumkit = Drumkit::load( H2TEST_FILE( "/drumkits/baseKit" ) );
+
+		loader.run();
+		checkLoaded( &loader );
+	}
+
+	void testStart()
+	{
+		DrumkitLoader loader( m_pDrumkit );
+		CPPUNIT_ASSERT( loader.start() );
+		for ( int i = 0; i < 1000 && !loader.is_done(); i++ ) {
+			usleep( 10000 );
+		}
+		checkLoaded( &loader );
+	}
+
+	void testCancel()
+	{
+		DrumkitLoader* pLoader = new DrumkitLoader( m_pDrumkit );
+		CPPUNIT_ASSERT( pLoader->start() );
+		// joins the loader thread
+		delete pLoader;
+	}
+
+	void testTakeFrom()
+	{
+		DrumkitLoader loader( m_pDrumkit );
+		loader.run();
+
+		Instrument* pInstr = new Instrument( 42, "Old" );
+		std::vector<InstrumentComponent*>* pOldComponents = pInstr->get_components();
+		Instrument* pNewInstr = loader.get_instruments()->get( 0 );
+		std::vector<InstrumentComponent*>* pNewComponents = pNewInstr->get_components();
+
+		pInstr->take_from( pNewInstr );
+		CPPUNIT_ASSERT( pInstr->get_components() == pNewComponents );
+		CPPUNIT_ASSERT( pNewInstr->get_components() == pOldComponents );
+		CPPUNIT_ASSERT( pInstr->get_name() == pNewInstr->get_name() );
+		CPPUNIT_ASSERT_EQUAL( pNewInstr->get_id(), pInstr->get_id() );
+		delete pInstr;
+	}
+
+	void testPublishStopsNotes()
+	{
+		Hydrogen* pHydrogen = Hydrogen::get_instance();
+		AudioEngine* pEngine = AudioEngine::get_instance();
+		Sampler* pSampler = pEngine->get_sampler();
+		Song* pSong = Song::load( H2TEST_FILE( "functional/test.h2song" ) );
+		CPPUNIT_ASSERT( pSong != nullptr );
+		pHydrogen->setSong( pSong );
+
+		// the voice would read the layers of the replaced kit
+		Instrument* pInstr = pSong->get_instrument_list()->get( 0 );
+		pEngine->lock( RIGHT_HERE );
+		pSampler->note_on( NotePool::get_instance()->acquire( pInstr, 0, 0.8, 0.5, 0.5, -1, 0 ) );
+		bool bPlaying = pSampler->is_instrument_playing( pInstr );
+		pEngine->unlock();
+		CPPUNIT_ASSERT( bPlaying );
+
+		CPPUNIT_ASSERT_EQUAL( 0, pHydrogen->loadDrumkit( m_pDrumkit ) );
+		CPPUNIT_ASSERT( pSong->get_instrument_list()->get( 0 ) == pInstr );
+		pEngine->lock( RIGHT_HERE );
+		bPlaying = pSampler->is_instrument_playing( pInstr );
+		pEngine->unlock();
+		CPPUNIT_ASSERT( !bPlaying );
+
+		pHydrogen->setSong( Song::get_empty_song() );
+	}
+};
+
+CPPUNIT_TEST_SUITE_REGISTRATION( DrumkitLoaderTest );
@@ -0,0 +1,80 @@
+#include <cppunit/extensions/HelperMacros.h>
+
+#include <hydrogen/dsp_profiler.h>
+
+using namespace H2Core;
+
+class DspProfilerTest : public CppUnit::TestCase {
+	CPPUNIT_TEST_SUITE( DspProfilerTest );
+	CPPUNIT_TEST( testPercentiles );
+	CPPUNIT_TEST( testWindow );
+	CPPUNIT_TEST( testVoiceBuckets );
+	CPPUNIT_TEST_SUITE_END();
+
+	public:
+	void testPercentiles()
+	{
+		DspProfiler profiler;
+		DspProfiler::Stats stats = profiler.get_stats( DspProfiler::SAMPLER );
+		CPPUNIT_ASSERT_EQUAL( 0, stats.samples );
+
+		// 1..100 microseconds, in reverse order
+		for ( int i = 100; i > 0; --i ) {
+			profiler.record( DspProfiler::SAMPLER, 0, i * 1000 );
+		}
+		stats = profiler.get_stats( DspProfiler::SAMPLER );
+		CPPUNIT_ASSERT_EQUAL( 100, stats.samples );
+		CPPUNIT_ASSERT_DOUBLES_EQUAL( 0.050, stats.p50, 1e-6 );
+		CPPUNIT_ASSERT_DOUBLES_EQUAL( 0.099, stats.p99, 1e-6 );
+		CPPUNIT_ASSERT_DOUBLES_EQUAL( 0.100, stats.max, 1e-6 );
+		CPPUNIT_ASSERT_DOUBLES_EQUAL( 0.001, profiler.get_last( DspProfiler::SAMPLER ), 1e-6 );
+
+		// other stages are not affected
+		CPPUNIT_ASSERT_EQUAL( 0, profiler.get_stats( DspProfiler::SYNTH ).samples );
+
+		profiler.reset();
+		CPPUNIT_ASSERT_EQUAL( 0, profiler.get_stats( DspProfiler::SAMPLER ).samples );
+	}
+
+	void testWindow()
+	{
+		DspProfiler profiler;
+
+		// a spike falls out of the window after WINDOW cycles
+		profiler.record( DspProfiler::TOTAL, 0, 5000000 );
+		for ( int i = 0; i < DspProfiler::WINDOW; ++i ) {
+			profiler.record( DspProfiler::TOTAL, 1000, 2000 );
+		}
+		DspProfiler::Stats stats = profiler.get_stats( DspProfiler::TOTAL );
+		CPPUNIT_ASSERT_EQUAL( DspProfiler::WINDOW, stats.samples );
+		CPPUNIT_ASSERT_DOUBLES_EQUAL( 0.001, stats.max, 1e-6 );
+
+		// a clock going backwards is no negative duration
+		profiler.record( DspProfiler::TOTAL, 2000, 1000 );
+		CPPUNIT_ASSERT_DOUBLES_EQUAL( 0.0, profiler.get_last( DspProfiler::TOTAL ), 1e-9 );
+	}
+
+	void testVoiceBuckets()
+	{
+		DspProfiler profiler;
+		profiler.record_voices( 0, 0, 1000 );
+		profiler.record_voices( 5, 0, 1000 );
+		profiler.record_voices( 7, 0, 3000 );
+		profiler.record_voices( 1000, 0, 1000 );
+
+		CPPUNIT_ASSERT_EQUAL( 1, profiler.get_voice_bucket( 0 ).cycles );
+		CPPUNIT_ASSERT_EQUAL( 0, profiler.get_voice_bucket( 1 ).cycles );
+
+		DspProfiler::VoiceBucket bucket = profiler.get_voice_bucket( 3 );
+		CPPUNIT_ASSERT_EQUAL( 4, bucket.min_voices );
+		CPPUNIT_ASSERT_EQUAL( 2, bucket.cycles );
+		CPPUNIT_ASSERT_DOUBLES_EQUAL( 0.002, bucket.mean, 1e-6 );
+		CPPUNIT_ASSERT_DOUBLES_EQUAL( 0.003, bucket.max, 1e-6 );
+
+		bucket = profiler.get_voice_bucket( DspProfiler::VOICE_BUCKETS - 1 );
+		CPPUNIT_ASSERT_EQUAL( 128, bucket.min_voices );
+		CPPUNIT_ASSERT_EQUAL( 1, bucket.cycles );
+	}
+};
+
+CPPUNIT_TEST_SUITE_REGISTRATION( DspProfilerTest );
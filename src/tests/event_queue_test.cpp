@@ -0,0 +1,98 @@
+#include <cppunit/extensions/HelperMacros.h>
+
+#include <hydrogen/event_queue.h>
+
+#include <thread>
+#include <vector>
+
+using namespace H2Core;
+
+class EventQueueTest : public CppUnit::TestCase {
+	CPPUNIT_TEST_SUITE( EventQueueTest );
+	CPPUNIT_TEST( testProducers );
+	CPPUNIT_TEST( testOverflow );
+	CPPUNIT_TEST_SUITE_END();
+
+	EventQueue* m_pQueue;
+
+	public:
+	void setUp()
+	{
+		m_pQueue = EventQueue::get_instance();
+		drain();
+	}
+
+	void tearDown()
+	{
+		drain();
+	}
+
+	void drain()
+	{
+		while ( m_pQueue->pop_event().type != EVENT_NONE ) {
+		}
+	}
+
+	void testProducers()
+	{
+		const int nProducers = 4;
+		const int nEventsEach = 200;	// all of them fit into the queue
+
+		std::vector<std::thread> producers;
+		for ( int nProducer = 0; nProducer < nProducers; ++nProducer ) {
+			producers.push_back( std::thread( [this, nProducer, nEventsEach]() {
+				for ( int i = 0; i < nEventsEach; ++i ) {
+					m_pQueue->push_event( EVENT_UNDO_REDO, nProducer * nEventsEach + i );
+				}
+			} ) );
+		}
+		for ( auto& producer : producers ) {
+			producer.join();
+		}
+
+		// every event arrives once and in the order of its producer
+		std::vector<int> last( nProducers, -1 );
+		int nReceived = 0;
+		Event events[ 64 ];
+		int nEvents;
+		while ( ( nEvents = m_pQueue->pop_events( events, 64 ) ) > 0 ) {
+			for ( int n = 0; n < nEvents; ++n ) {
+				if ( events[ n ].type != EVENT_UNDO_REDO ) {
+					continue;
+				}
+				int nProducer = events[ n ].value / nEventsEach;
+				int nIndex = events[ n ].value % nEventsEach;
+				CPPUNIT_ASSERT_EQUAL( last[ nProducer ] + 1, nIndex );
+				last[ nProducer ] = nIndex;
+				++nReceived;
+			}
+		}
+		CPPUNIT_ASSERT_EQUAL( nProducers * nEventsEach, nReceived );
+	}
+
+	void testOverflow()
+	{
+		unsigned nDropped = m_pQueue->get_dropped_events();
+
+		for ( int i = 0; i < MAX_EVENTS + 10; ++i ) {
+			m_pQueue->push_event( EVENT_UNDO_REDO, i );
+		}
+		CPPUNIT_ASSERT( m_pQueue->get_dropped_events() - nDropped >= 10 );
+		CPPUNIT_ASSERT_EQUAL( (unsigned)MAX_EVENTS, m_pQueue->get_high_water_mark() );
+		CPPUNIT_ASSERT( !m_pQueue->push_event( EVENT_UNDO_REDO, 0 ) );
+
+		// the oldest events are kept
+		Event event;
+		do {
+			event = m_pQueue->pop_event();
+		} while ( event.type != EVENT_UNDO_REDO && event.type != EVENT_NONE );
+		CPPUNIT_ASSERT_EQUAL( 0, event.value );
+		CPPUNIT_ASSERT( m_pQueue->push_event( EVENT_UNDO_REDO, 0 ) );
+
+		drain();
+		m_pQueue->reset_high_water_mark();
+		CPPUNIT_ASSERT_EQUAL( 0u, m_pQueue->get_high_water_mark() );
+	}
+};
+
+CPPUNIT_TEST_SUITE_REGISTRATION( EventQueueTest );
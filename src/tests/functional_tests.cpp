@@ -35,7 +35,9 @@
 #include "assertions/audiofile.h"
 
 #include <chrono>
+#include <map>
 #include <memory>
+#include <vector>
 
 using namespace H2Core;
 
@@ -43,8 +45,10 @@ using namespace H2Core;
  * \brief Export Hydrogon song to audio file
  * \param songFile Path to Hydrogen file
  * \param fileName Output file name
+ * \param stems Output file name of the stem of each instrument id
  **/
-void exportSong( const QString &songFile, const QString &fileName )
+void exportSong( const QString &songFile, const QString &fileName,
+				 const std::map<int, QString> &stems = std::map<int, QString>() )
 {
 	auto t0 = std::chrono::high_resolution_clock::now();
 
@@ -61,7 +65,7 @@ void exportSong( const QString &songFile, const QString &fileName )
 	}
 
 	pHydrogen->startExportSession( 44100, 16 );
-	pHydrogen->startExportSong( fileName );
+	pHydrogen->startExportSong( fileName, stems );
 
 	bool done = false;
 	while ( ! done ) {
@@ -110,6 +114,7 @@ class FunctionalTest : public CppUnit::TestCase {
 	CPPUNIT_TEST( testExportMIDISMF1Multi );
 //	CPPUNIT_TEST( testExportMuteGroupsAudio ); // SKIP
 	CPPUNIT_TEST( testExportVelocityAutomationAudio );
+	CPPUNIT_TEST( testExportStemsAudio );
 	CPPUNIT_TEST( testExportVelocityAutomationMIDISMF0 );
 	CPPUNIT_TEST( testExportVelocityAutomationMIDISMF1 );
 	CPPUNIT_TEST_SUITE_END();
@@ -186,6 +191,35 @@ class FunctionalTest : public CppUnit::TestCase {
 		Filesystem::rm( outFile );
 	}
 
+	void testExportStemsAudio()
+	{
+		auto songFile = H2TEST_FILE("functional/velocityautomation.h2song");
+		auto outFile = Filesystem::tmp_file_path("stems.wav");
+		auto refFile = H2TEST_FILE("functional/velocityautomation.ref.flac");
+
+		// instruments 2 and 6 are the ones playing in the song
+		std::map<int, QString> stems;
+		stems[ 2 ] = Filesystem::tmp_file_path("stems-2.wav");
+		stems[ 6 ] = Filesystem::tmp_file_path("stems-6.wav");
+
+		// rendering the stems in the same pass leaves the song unchanged
+		exportSong( songFile, outFile, stems );
+		H2TEST_ASSERT_AUDIO_FILES_EQUAL( refFile, outFile );
+
+		// each stem holds the part of its instrument, up to the
+		// rounding of every file to 16 bits
+		std::vector<QString> stemFiles;
+		for ( auto it = stems.begin(); it != stems.end(); ++it ) {
+			stemFiles.push_back( it->second );
+		}
+		H2TEST_ASSERT_AUDIO_FILES_SUM( outFile, stemFiles, (int)stemFiles.size() + 1 );
+
+		Filesystem::rm( outFile );
+		for ( auto it = stems.begin(); it != stems.end(); ++it ) {
+			Filesystem::rm( it->second );
+		}
+	}
+
 	void testExportVelocityAutomationMIDISMF1()
 	{
 		auto songFile = H2TEST_FILE("functional/velocityautomation.h2song");
@@ -26,6 +26,8 @@ void setupEnvironment(unsigned log_level)
 	H2Core::Preferences::create_instance();
 	H2Core::Preferences* preferences = H2Core::Preferences::get_instance();
 	preferences->m_sAudioDriver = "Fake";
+	/* Decode the samples of each run, the disk cache has its own test */
+	preferences->m_bSampleDiskCache = false;
 	
 	H2Core::Hydrogen::create_instance();
 }
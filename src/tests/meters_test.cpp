@@ -0,0 +1,91 @@
+#include <cppunit/extensions/HelperMacros.h>
+
+#include <cmath>
+
+#include <hydrogen/meters.h>
+
+using namespace H2Core;
+
+class MetersTest : public CppUnit::TestCase {
+	CPPUNIT_TEST_SUITE( MetersTest );
+	CPPUNIT_TEST( testPublish );
+	CPPUNIT_TEST( testMissedCycles );
+	CPPUNIT_TEST( testHold );
+	CPPUNIT_TEST_SUITE_END();
+
+	public:
+	void testPublish()
+	{
+		Meters meters;
+		CPPUNIT_ASSERT( meters.take() == nullptr );
+
+		float left[] = { 0.5f, -0.5f };
+		float right[] = { -0.8f, 0.0f };
+		meters.add_buffer( Meters::MASTER, left, right, 2 );
+		meters.add_levels( Meters::INSTRUMENT + 1, 0.3f, 0.4f, 0.0f, 0.0f );
+		meters.publish( 2, 44100, 1, 2 );
+
+		const Meters::Frame* pFrame = meters.take();
+		CPPUNIT_ASSERT( pFrame != nullptr );
+		CPPUNIT_ASSERT_EQUAL( 1u, pFrame->cycles );
+		const Meters::Levels* pMaster = pFrame->get( Meters::MASTER );
+		CPPUNIT_ASSERT( pMaster != nullptr );
+		CPPUNIT_ASSERT_DOUBLES_EQUAL( 0.5, pMaster->peak_l, 1e-6 );
+		CPPUNIT_ASSERT_DOUBLES_EQUAL( 0.8, pMaster->peak_r, 1e-6 );
+		CPPUNIT_ASSERT_DOUBLES_EQUAL( 0.5, pMaster->rms_l, 1e-6 );
+		CPPUNIT_ASSERT_DOUBLES_EQUAL( std::sqrt( 0.32 ), pMaster->rms_r, 1e-6 );
+		CPPUNIT_ASSERT_DOUBLES_EQUAL( 0.4, pFrame->get( Meters::INSTRUMENT + 1 )->peak_r, 1e-6 );
+
+		// only the strips of the song are set
+		CPPUNIT_ASSERT( pFrame->get( Meters::COMPONENT ) != nullptr );
+		CPPUNIT_ASSERT( pFrame->get( Meters::COMPONENT + 1 ) == nullptr );
+		CPPUNIT_ASSERT( pFrame->get( Meters::INSTRUMENT + 2 ) == nullptr );
+
+		// nothing published since
+		CPPUNIT_ASSERT( meters.take() == nullptr );
+	}
+
+	void testMissedCycles()
+	{
+		Meters meters;
+		meters.add_levels( Meters::FX, 0.9f, 0.9f, 0.0f, 0.0f );
+		meters.publish( 64, 44100, 0, 0 );
+		meters.add_levels( Meters::FX, 0.1f, 0.1f, 0.0f, 0.0f );
+		meters.publish( 64, 44100, 0, 0 );
+
+		// the peak of the cycle not taken is kept
+		const Meters::Frame* pFrame = meters.take();
+		CPPUNIT_ASSERT_EQUAL( 2u, pFrame->cycles );
+		CPPUNIT_ASSERT_DOUBLES_EQUAL( 0.9, pFrame->get( Meters::FX )->peak_l, 1e-6 );
+
+		// and forgotten once taken
+		meters.add_levels( Meters::FX, 0.2f, 0.2f, 0.0f, 0.0f );
+		meters.publish( 64, 44100, 0, 0 );
+		pFrame = meters.take();
+		CPPUNIT_ASSERT_EQUAL( 1u, pFrame->cycles );
+		CPPUNIT_ASSERT_DOUBLES_EQUAL( 0.2, pFrame->get( Meters::FX )->peak_l, 1e-6 );
+	}
+
+	void testHold()
+	{
+		// cycles of one second, the peak is held for 1.5 s
+		Meters meters;
+		meters.add_levels( Meters::MASTER, 1.0f, 1.0f, 0.0f, 0.0f );
+		meters.publish( 1000, 1000, 0, 0 );
+		CPPUNIT_ASSERT_DOUBLES_EQUAL( 1.0, meters.take()->get( Meters::MASTER )->hold_l, 1e-6 );
+
+		for ( int i = 0; i < 2; ++i ) {
+			meters.add_levels( Meters::MASTER, 0.1f, 0.1f, 0.0f, 0.0f );
+			meters.publish( 1000, 1000, 0, 0 );
+			const Meters::Levels* pMaster = meters.take()->get( Meters::MASTER );
+			CPPUNIT_ASSERT_DOUBLES_EQUAL( 0.1, pMaster->peak_l, 1e-6 );
+			CPPUNIT_ASSERT_DOUBLES_EQUAL( 1.0, pMaster->hold_l, 1e-6 );
+		}
+
+		meters.add_levels( Meters::MASTER, 0.1f, 0.1f, 0.0f, 0.0f );
+		meters.publish( 1000, 1000, 0, 0 );
+		CPPUNIT_ASSERT_DOUBLES_EQUAL( 0.1, meters.take()->get( Meters::MASTER )->hold_l, 1e-6 );
+	}
+};
+
+CPPUNIT_TEST_SUITE_REGISTRATION( MetersTest );
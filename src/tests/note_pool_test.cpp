@@ -0,0 +1,91 @@
+#include <cppunit/extensions/HelperMacros.h>
+
+#include <hydrogen/basics/adsr.h>
+#include <hydrogen/basics/instrument.h>
+#include <hydrogen/basics/instrument_component.h>
+#include <hydrogen/basics/note.h>
+#include <hydrogen/basics/note_pool.h>
+
+using namespace H2Core;
+
+class NotePoolTest : public CppUnit::TestCase {
+	CPPUNIT_TEST_SUITE( NotePoolTest );
+	CPPUNIT_TEST( testRecycle );
+	CPPUNIT_TEST( testExhausted );
+	CPPUNIT_TEST( testLayers );
+	CPPUNIT_TEST_SUITE_END();
+
+	Instrument* m_pInstrument;
+
+	public:
+	void setUp()
+	{
+		m_pInstrument = new Instrument( 1, "pooled" );
+		m_pInstrument->get_components()->push_back( new InstrumentComponent( 3 ) );
+	}
+
+	void tearDown()
+	{
+		delete m_pInstrument;
+	}
+
+	void testRecycle()
+	{
+		NotePool pool( 2 );
+		CPPUNIT_ASSERT_EQUAL( 2, pool.get_available() );
+
+		Note* pNote = pool.acquire( m_pInstrument, 48, 0.8, 0.5, 0.5, -1, 0 );
+		ADSR* pADSR = pNote->get_adsr();
+		CPPUNIT_ASSERT_EQUAL( 1, pool.get_available() );
+		CPPUNIT_ASSERT_EQUAL( 48, pNote->get_position() );
+		pNote->set_note_off( true );
+		pool.release( pNote );
+		CPPUNIT_ASSERT_EQUAL( 2, pool.get_available() );
+
+		// the last released note comes back first, fully reset
+		Note* pCopy = pool.acquire( m_pInstrument, 0, 1.0, 0.5, 0.5, -1, 0 );
+		CPPUNIT_ASSERT( pCopy == pNote );
+		CPPUNIT_ASSERT( pCopy->get_adsr() == pADSR );
+		CPPUNIT_ASSERT( !pCopy->get_note_off() );
+		CPPUNIT_ASSERT_EQUAL( 0, pCopy->get_position() );
+		pool.release( pCopy );
+		CPPUNIT_ASSERT_EQUAL( 0, pool.get_exhausted_count() );
+	}
+
+	void testExhausted()
+	{
+		NotePool pool( 1 );
+		Note* pFirst = pool.acquire( m_pInstrument, 0, 1.0, 0.5, 0.5, -1, 0 );
+		Note* pSecond = pool.acquire( pFirst );
+		CPPUNIT_ASSERT_EQUAL( 0, pool.get_available() );
+		CPPUNIT_ASSERT_EQUAL( 1, pool.get_exhausted_count() );
+		CPPUNIT_ASSERT( pSecond->get_instrument() == m_pInstrument );
+
+		// heap notes are deleted, pooled ones go back to the free list
+		pool.release( pSecond );
+		pool.release( pFirst );
+		CPPUNIT_ASSERT_EQUAL( 1, pool.get_available() );
+	}
+
+	void testLayers()
+	{
+		NotePool pool( 1 );
+		Note* pNote = pool.acquire( m_pInstrument, 0, 1.0, 0.5, 0.5, -1, 0 );
+		SelectedLayerInfo* pInfo = pNote->get_layer_selected( 3 );
+		CPPUNIT_ASSERT( pInfo != nullptr );
+		CPPUNIT_ASSERT_EQUAL( -1, pInfo->SelectedLayer );
+		CPPUNIT_ASSERT( pNote->get_layer_selected( 0 ) == nullptr );
+
+		pInfo->SelectedLayer = 2;
+		pInfo->SamplePosition = 100;
+		pool.release( pNote );
+
+		pNote = pool.acquire( m_pInstrument, 0, 1.0, 0.5, 0.5, -1, 0 );
+		pInfo = pNote->get_layer_selected( 3 );
+		CPPUNIT_ASSERT_EQUAL( -1, pInfo->SelectedLayer );
+		CPPUNIT_ASSERT_EQUAL( 0.0f, pInfo->SamplePosition );
+		pool.release( pNote );
+	}
+};
+
+CPPUNIT_TEST_SUITE_REGISTRATION( NotePoolTest );
@@ -0,0 +1,100 @@
+#include <cppunit/extensions/HelperMacros.h>
+
+#include <hydrogen/realtime_note_queue.h>
+
+#include <thread>
+#include <vector>
+
+using namespace H2Core;
+
+class RealtimeNoteQueueTest : public CppUnit::TestCase {
+	CPPUNIT_TEST_SUITE( RealtimeNoteQueueTest );
+	CPPUNIT_TEST( testProducers );
+	CPPUNIT_TEST( testOverflow );
+	CPPUNIT_TEST( testFrameOffset );
+	CPPUNIT_TEST_SUITE_END();
+
+	static RealtimeNoteQueue::Event makeEvent( int nInstrument, int nKey )
+	{
+		RealtimeNoteQueue::Event event;
+		event.type = RealtimeNoteQueue::Event::NOTE_ON;
+		event.time = RealtimeNoteQueue::now();
+		event.instrument = nInstrument;
+		event.key = nKey;
+		event.velocity = 0.8f;
+		event.pan_L = 0.5f;
+		event.pan_R = 0.5f;
+		return event;
+	}
+
+	public:
+	void testProducers()
+	{
+		const int nProducers = 4;
+		const int nEventsEach = 60;	// all of them fit into the queue
+		RealtimeNoteQueue queue;
+
+		std::vector<std::thread> producers;
+		for ( int nProducer = 0; nProducer < nProducers; ++nProducer ) {
+			producers.push_back( std::thread( [&queue, nProducer, nEventsEach]() {
+				for ( int i = 0; i < nEventsEach; ++i ) {
+					queue.push( makeEvent( nProducer, i ) );
+				}
+			} ) );
+		}
+		for ( auto& producer : producers ) {
+			producer.join();
+		}
+
+		// every event arrives once and in the order of its producer
+		std::vector<int> last( nProducers, -1 );
+		int nReceived = 0;
+		const RealtimeNoteQueue::Event* pEvent;
+		while ( ( pEvent = queue.front() ) != nullptr ) {
+			CPPUNIT_ASSERT( pEvent->instrument >= 0 && pEvent->instrument < nProducers );
+			CPPUNIT_ASSERT_EQUAL( last[ pEvent->instrument ] + 1, pEvent->key );
+			last[ pEvent->instrument ] = pEvent->key;
+			queue.pop();
+			++nReceived;
+		}
+		CPPUNIT_ASSERT_EQUAL( nProducers * nEventsEach, nReceived );
+		CPPUNIT_ASSERT_EQUAL( 0u, queue.get_dropped() );
+	}
+
+	void testOverflow()
+	{
+		RealtimeNoteQueue queue;
+		for ( unsigned i = 0; i < RealtimeNoteQueue::SIZE; ++i ) {
+			CPPUNIT_ASSERT( queue.push( makeEvent( 0, i ) ) );
+		}
+		CPPUNIT_ASSERT( !queue.push( makeEvent( 0, -1 ) ) );
+		CPPUNIT_ASSERT_EQUAL( 1u, queue.get_dropped() );
+
+		// the oldest event is still the first one, and its slot is
+		// free again once taken
+		CPPUNIT_ASSERT_EQUAL( 0, queue.front()->key );
+		queue.pop();
+		CPPUNIT_ASSERT( queue.push( makeEvent( 0, 1000 ) ) );
+		for ( unsigned i = 1; i < RealtimeNoteQueue::SIZE; ++i ) {
+			queue.pop();
+		}
+		CPPUNIT_ASSERT_EQUAL( 1000, queue.front()->key );
+		queue.pop();
+		CPPUNIT_ASSERT( queue.front() == nullptr );
+	}
+
+	void testFrameOffset()
+	{
+		// 48 kHz, cycles of 256 frames, a window starting at 1 s
+		const uint64_t nStart = 1000000000ull;
+		CPPUNIT_ASSERT_EQUAL( 0, RealtimeNoteQueue::frame_offset( nStart, nStart, 48000, 256 ) );
+		CPPUNIT_ASSERT_EQUAL( 0, RealtimeNoteQueue::frame_offset( nStart - 1000, nStart, 48000, 256 ) );
+		// 2 ms later
+		CPPUNIT_ASSERT_EQUAL( 96, RealtimeNoteQueue::frame_offset( nStart + 2000000, nStart, 48000, 256 ) );
+		// past the cycle, or long after it
+		CPPUNIT_ASSERT_EQUAL( 255, RealtimeNoteQueue::frame_offset( nStart + 10000000, nStart, 48000, 256 ) );
+		CPPUNIT_ASSERT_EQUAL( 255, RealtimeNoteQueue::frame_offset( nStart * 3600, nStart, 48000, 256 ) );
+	}
+};
+
+CPPUNIT_TEST_SUITE_REGISTRATION( RealtimeNoteQueueTest );
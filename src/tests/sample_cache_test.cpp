@@ -0,0 +1,156 @@
+#include <cppunit/extensions/HelperMacros.h>
+#include "test_helper.h"
+
+#include <hydrogen/basics/sample.h>
+#include <hydrogen/basics/sample_cache.h>
+
+using namespace H2Core;
+
+class SampleCacheTest : public CppUnit::TestCase {
+	CPPUNIT_TEST_SUITE( SampleCacheTest );
+	CPPUNIT_TEST( testSharedData );
+	CPPUNIT_TEST( testCopyOnWrite );
+	CPPUNIT_TEST( testBudget );
+	CPPUNIT_TEST( testMono );
+	CPPUNIT_TEST( testCompact );
+	CPPUNIT_TEST_SUITE_END();
+
+	public:
+	void testSharedData()
+	{
+		Sample* pFirst = Sample::load( H2TEST_FILE( "drumkits/baseKit/kick.wav" ) );
+		Sample* pSecond = Sample::load( H2TEST_FILE( "drumkits/baseKit/kick.wav" ) );
+		CPPUNIT_ASSERT( pFirst != nullptr );
+		CPPUNIT_ASSERT( pSecond != nullptr );
+		CPPUNIT_ASSERT( pFirst->is_shared() );
+		CPPUNIT_ASSERT( pFirst->get_data_l() == pSecond->get_data_l() );
+		CPPUNIT_ASSERT( pFirst->get_data_r() == pSecond->get_data_r() );
+
+		Sample* pCopy = new Sample( pFirst );
+		CPPUNIT_ASSERT( pCopy->get_data_l() == pFirst->get_data_l() );
+
+		delete pFirst;
+		delete pSecond;
+		// the data outlives the samples it was loaded for
+		CPPUNIT_ASSERT( pCopy->is_shared() );
+		CPPUNIT_ASSERT( pCopy->get_frames() > 0 );
+		delete pCopy;
+	}
+
+	void testCopyOnWrite()
+	{
+		Sample* pFirst = Sample::load( H2TEST_FILE( "drumkits/baseKit/snare.wav" ) );
+		Sample* pSecond = Sample::load( H2TEST_FILE( "drumkits/baseKit/snare.wav" ) );
+		CPPUNIT_ASSERT( pFirst != nullptr && pSecond != nullptr );
+
+		int nFrames = pSecond->get_frames();
+		std::vector<float> original( pSecond->get_data_l(), pSecond->get_data_l() + nFrames );
+
+		Sample::VelocityEnvelope velocity;
+		velocity.push_back( std::make_unique<EnvelopePoint>( 0, 91 ) );
+		velocity.push_back( std::make_unique<EnvelopePoint>( 841, 91 ) );
+		pFirst->apply_velocity( velocity );
+
+		CPPUNIT_ASSERT( !pFirst->is_shared() );
+		CPPUNIT_ASSERT( pSecond->is_shared() );
+		CPPUNIT_ASSERT( pFirst->get_data_l() != pSecond->get_data_l() );
+		for ( int i = 0; i < nFrames; i++ ) {
+			CPPUNIT_ASSERT_EQUAL( original[ i ], pSecond->get_data_l()[ i ] );
+			CPPUNIT_ASSERT_EQUAL( 0.f, pFirst->get_data_l()[ i ] );
+		}
+
+		delete pFirst;
+		delete pSecond;
+	}
+
+	void testBudget()
+	{
+		SampleCache cache( 0 );
+
+		std::shared_ptr<SampleData> pKick = cache.load( H2TEST_FILE( "drumkits/baseKit/kick.wav" ) );
+		CPPUNIT_ASSERT( pKick != nullptr );
+		CPPUNIT_ASSERT( cache.load( H2TEST_FILE( "drumkits/baseKit/kick.wav" ) ) == pKick );
+		CPPUNIT_ASSERT_EQUAL( 1, cache.get_hits() );
+		CPPUNIT_ASSERT_EQUAL( 1, cache.get_misses() );
+
+		// data in use is kept beyond the budget
+		CPPUNIT_ASSERT_EQUAL( 1, cache.get_count() );
+		CPPUNIT_ASSERT_EQUAL( pKick->get_size(), cache.get_size() );
+
+		// unused data is dropped as soon as the budget is exceeded
+		pKick.reset();
+		std::shared_ptr<SampleData> pHh = cache.load( H2TEST_FILE( "drumkits/baseKit/hh.wav" ) );
+		CPPUNIT_ASSERT_EQUAL( 1, cache.get_count() );
+		CPPUNIT_ASSERT_EQUAL( 1, cache.get_evictions() );
+		CPPUNIT_ASSERT_EQUAL( pHh->get_size(), cache.get_size() );
+
+		pHh.reset();
+		cache.set_budget( 1024 * 1024 * 1024 );
+		cache.load( H2TEST_FILE( "drumkits/baseKit/kick.wav" ) );
+		cache.load( H2TEST_FILE( "drumkits/baseKit/snare.wav" ) );
+		CPPUNIT_ASSERT_EQUAL( 3, cache.get_count() );
+		cache.set_budget( 0 );
+		CPPUNIT_ASSERT_EQUAL( 0, cache.get_count() );
+		CPPUNIT_ASSERT_EQUAL( 0LL, cache.get_size() );
+
+		CPPUNIT_ASSERT( cache.load( H2TEST_FILE( "drumkits/baseKit/drumkit.xml" ) ) == nullptr );
+	}
+
+	void testMono()
+	{
+		std::shared_ptr<SampleData> pKick = SampleData::decode( H2TEST_FILE( "drumkits/baseKit/kick.wav" ) );
+		CPPUNIT_ASSERT( pKick != nullptr );
+		CPPUNIT_ASSERT( pKick->is_mono() );
+		CPPUNIT_ASSERT( pKick->data_r == pKick->data_l );
+		CPPUNIT_ASSERT_EQUAL( ( long long )pKick->frames * 4, pKick->get_size() );
+
+		Sample* pSample = Sample::load( H2TEST_FILE( "drumkits/baseKit/kick.wav" ) );
+		CPPUNIT_ASSERT( pSample->is_mono() );
+
+		// a private copy stays mono, panning splits the channels
+		Sample::VelocityEnvelope velocity;
+		velocity.push_back( std::make_unique<EnvelopePoint>( 0, 0 ) );
+		velocity.push_back( std::make_unique<EnvelopePoint>( 841, 0 ) );
+		pSample->apply_velocity( velocity );
+		CPPUNIT_ASSERT( !pSample->is_shared() );
+		CPPUNIT_ASSERT( pSample->is_mono() );
+		for ( int i = 0; i < pKick->frames; i++ ) {
+			CPPUNIT_ASSERT_EQUAL( pKick->data_l[ i ], pSample->get_data_l()[ i ] );
+		}
+
+		Sample::PanEnvelope pan;
+		pan.push_back( std::make_unique<EnvelopePoint>( 0, 90 ) );
+		pan.push_back( std::make_unique<EnvelopePoint>( 841, 90 ) );
+		pSample->apply_pan( pan );
+		CPPUNIT_ASSERT( !pSample->is_mono() );
+		delete pSample;
+	}
+
+	void testCompact()
+	{
+		SampleCache cache( 0, true );
+		CPPUNIT_ASSERT( cache.is_compact() );
+
+		const char* files[] = { "drumkits/baseKit/snare.wav", "drumkits/baseKit/kick.wav" };
+		for ( const char* sFile : files ) {
+			std::shared_ptr<SampleData> pFloat = SampleData::decode( H2TEST_FILE( sFile ) );
+			std::shared_ptr<SampleData> pCompact = cache.load( H2TEST_FILE( sFile ) );
+			CPPUNIT_ASSERT( pCompact != nullptr );
+			CPPUNIT_ASSERT_EQUAL( SampleData::INT16, pCompact->format );
+			CPPUNIT_ASSERT( pCompact->data_l == nullptr );
+			CPPUNIT_ASSERT_EQUAL( pFloat->frames, pCompact->frames );
+			CPPUNIT_ASSERT_EQUAL( pFloat->is_mono(), pCompact->is_mono() );
+			CPPUNIT_ASSERT_EQUAL( pFloat->get_size() / 2, pCompact->get_size() );
+
+			// converted exactly as libsndfile does
+			std::vector<float> data_l( pCompact->frames ), data_r( pCompact->frames );
+			pCompact->read( 0, pCompact->frames, data_l.data(), data_r.data() );
+			for ( int i = 0; i < pFloat->frames; i++ ) {
+				CPPUNIT_ASSERT_EQUAL( pFloat->data_l[ i ], data_l[ i ] );
+				CPPUNIT_ASSERT_EQUAL( pFloat->data_r[ i ], data_r[ i ] );
+			}
+		}
+	}
+};
+
+CPPUNIT_TEST_SUITE_REGISTRATION( SampleCacheTest );
@@ -0,0 +1,109 @@
+#include <cppunit/extensions/HelperMacros.h>
+#include "test_helper.h"
+
+#include <QDir>
+#include <QFile>
+
+#include <hydrogen/basics/sample_cache.h>
+#include <hydrogen/basics/sample_disk_cache.h>
+#include <hydrogen/helpers/filesystem.h>
+
+using namespace H2Core;
+
+class SampleDiskCacheTest : public CppUnit::TestCase {
+	CPPUNIT_TEST_SUITE( SampleDiskCacheTest );
+	CPPUNIT_TEST( testStoreAndMap );
+	CPPUNIT_TEST( testCompact );
+	CPPUNIT_TEST( testInvalidEntry );
+	CPPUNIT_TEST( testBudget );
+	CPPUNIT_TEST_SUITE_END();
+
+	QString m_sDir;
+
+	public:
+	void setUp()
+	{
+		m_sDir = Filesystem::tmp_dir() + "/sample_disk_cache";
+	}
+
+	void tearDown()
+	{
+		Filesystem::rm( m_sDir, true );
+	}
+
+	void testStoreAndMap()
+	{
+		SampleDiskCache cache( m_sDir, 1024 * 1024 * 1024 );
+		const char* files[] = { "drumkits/baseKit/snare.wav", "drumkits/baseKit/kick.wav" };
+		for ( const char* sFile : files ) {
+			std::shared_ptr<SampleData> pDecoded = SampleData::decode( H2TEST_FILE( sFile ) );
+			QString sKey = SampleCache::get_key( H2TEST_FILE( sFile ) );
+			CPPUNIT_ASSERT( cache.load( sKey ) == nullptr );
+			CPPUNIT_ASSERT( cache.store( sKey, *pDecoded ) );
+
+			std::shared_ptr<SampleData> pMapped = cache.load( sKey );
+			CPPUNIT_ASSERT( pMapped != nullptr );
+			CPPUNIT_ASSERT( pMapped->mapping != nullptr );
+			CPPUNIT_ASSERT_EQUAL( pDecoded->frames, pMapped->frames );
+			CPPUNIT_ASSERT_EQUAL( pDecoded->sample_rate, pMapped->sample_rate );
+			CPPUNIT_ASSERT_EQUAL( pDecoded->is_mono(), pMapped->is_mono() );
+			for ( int i = 0; i < pDecoded->frames; i++ ) {
+				CPPUNIT_ASSERT_EQUAL( pDecoded->data_l[ i ], pMapped->data_l[ i ] );
+				CPPUNIT_ASSERT_EQUAL( pDecoded->data_r[ i ], pMapped->data_r[ i ] );
+			}
+		}
+		CPPUNIT_ASSERT_EQUAL( 2, cache.get_hits() );
+		CPPUNIT_ASSERT_EQUAL( 2, cache.get_misses() );
+	}
+
+	void testCompact()
+	{
+		SampleDiskCache cache( m_sDir, 1024 * 1024 * 1024 );
+		std::shared_ptr<SampleData> pDecoded = SampleData::decode( H2TEST_FILE( "drumkits/baseKit/snare.wav" ), -1, true );
+		CPPUNIT_ASSERT_EQUAL( SampleData::INT16, pDecoded->format );
+		CPPUNIT_ASSERT( cache.store( "snare", *pDecoded ) );
+
+		std::shared_ptr<SampleData> pMapped = cache.load( "snare" );
+		CPPUNIT_ASSERT( pMapped != nullptr );
+		CPPUNIT_ASSERT_EQUAL( SampleData::INT16, pMapped->format );
+		CPPUNIT_ASSERT_EQUAL( pDecoded->get_size(), pMapped->get_size() );
+		std::vector<float> decoded( pDecoded->frames ), mapped( pDecoded->frames );
+		pDecoded->read( 0, pDecoded->frames, decoded.data(), nullptr );
+		pMapped->read( 0, pMapped->frames, mapped.data(), nullptr );
+		CPPUNIT_ASSERT( decoded == mapped );
+	}
+
+	void testInvalidEntry()
+	{
+		SampleDiskCache cache( m_sDir, 1024 * 1024 * 1024 );
+		std::shared_ptr<SampleData> pDecoded = SampleData::decode( H2TEST_FILE( "drumkits/baseKit/kick.wav" ) );
+		CPPUNIT_ASSERT( cache.store( "kick", *pDecoded ) );
+
+		// a truncated entry is ignored and replaced by the next store()
+		for ( const QString& sEntry : QDir( m_sDir ).entryList( QDir::Files ) ) {
+			QFile::resize( m_sDir + "/" + sEntry, 100 );
+		}
+		CPPUNIT_ASSERT( cache.load( "kick" ) == nullptr );
+		CPPUNIT_ASSERT( cache.store( "kick", *pDecoded ) );
+		std::shared_ptr<SampleData> pMapped = cache.load( "kick" );
+		CPPUNIT_ASSERT( pMapped != nullptr );
+		CPPUNIT_ASSERT_EQUAL( pDecoded->data_l[ pDecoded->frames - 1 ], pMapped->data_l[ pMapped->frames - 1 ] );
+	}
+
+	void testBudget()
+	{
+		std::shared_ptr<SampleData> pKick = SampleData::decode( H2TEST_FILE( "drumkits/baseKit/kick.wav" ) );
+		SampleDiskCache cache( m_sDir, pKick->get_size() + 1024 );
+		CPPUNIT_ASSERT( cache.store( "first", *pKick ) );
+		CPPUNIT_ASSERT( cache.get_size() > pKick->get_size() );
+		CPPUNIT_ASSERT( cache.store( "second", *pKick ) );
+		CPPUNIT_ASSERT( cache.get_size() <= pKick->get_size() + 1024 );
+		CPPUNIT_ASSERT_EQUAL( 1, QDir( m_sDir ).entryList( QDir::Files ).size() );
+
+		cache.clear();
+		CPPUNIT_ASSERT_EQUAL( 0LL, cache.get_size() );
+		CPPUNIT_ASSERT( cache.load( "second" ) == nullptr );
+	}
+};
+
+CPPUNIT_TEST_SUITE_REGISTRATION( SampleDiskCacheTest );
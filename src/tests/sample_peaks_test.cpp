@@ -0,0 +1,168 @@
+#include <cppunit/extensions/HelperMacros.h>
+#include "test_helper.h"
+
+#include <cmath>
+
+#include <QBuffer>
+
+#include <hydrogen/basics/sample_cache.h>
+#include <hydrogen/basics/sample_disk_cache.h>
+#include <hydrogen/basics/sample_peaks.h>
+#include <hydrogen/helpers/filesystem.h>
+
+using namespace H2Core;
+
+static const int FRAMES = 100000;
+
+class SamplePeaksTest : public CppUnit::TestCase {
+	CPPUNIT_TEST_SUITE( SamplePeaksTest );
+	CPPUNIT_TEST( testLevels );
+	CPPUNIT_TEST( testRanges );
+	CPPUNIT_TEST( testFile );
+	CPPUNIT_TEST( testPersistence );
+	CPPUNIT_TEST_SUITE_END();
+
+	/** left channel rising from 0 to 1, right one falling from 0 to -1 */
+	std::shared_ptr<SampleData> makeRamp()
+	{
+		std::shared_ptr<SampleData> pData = std::make_shared<SampleData>( FRAMES, 44100, 2 );
+		for ( int i = 0; i < FRAMES; i++ ) {
+			pData->data_l[ i ] = i / ( float )FRAMES;
+			pData->data_r[ i ] = -i / ( float )FRAMES;
+		}
+		return pData;
+	}
+
+	void assertEqual( const SamplePeaks& expected, const SamplePeaks& actual )
+	{
+		CPPUNIT_ASSERT_EQUAL( expected.get_frames(), actual.get_frames() );
+		CPPUNIT_ASSERT_EQUAL( expected.get_channels(), actual.get_channels() );
+		CPPUNIT_ASSERT_EQUAL( expected.get_levels(), actual.get_levels() );
+		std::vector<SamplePeaks::Peak> a( 500 ), b( 500 );
+		for ( int nChannel = 0; nChannel < 2; nChannel++ ) {
+			expected.get_peaks( nChannel, 0, expected.get_frames() / 500.0, 500, a.data() );
+			actual.get_peaks( nChannel, 0, actual.get_frames() / 500.0, 500, b.data() );
+			for ( int i = 0; i < 500; i++ ) {
+				CPPUNIT_ASSERT_EQUAL( a[ i ].min, b[ i ].min );
+				CPPUNIT_ASSERT_EQUAL( a[ i ].max, b[ i ].max );
+				CPPUNIT_ASSERT_EQUAL( a[ i ].rms, b[ i ].rms );
+			}
+		}
+	}
+
+	public:
+	void testLevels()
+	{
+		std::shared_ptr<SamplePeaks> pPeaks = SamplePeaks::compute( *makeRamp() );
+		CPPUNIT_ASSERT( pPeaks != nullptr );
+		CPPUNIT_ASSERT_EQUAL( FRAMES, pPeaks->get_frames() );
+		CPPUNIT_ASSERT_EQUAL( 2, pPeaks->get_channels() );
+		// a short sample keeps enough peaks to be drawn in detail
+		CPPUNIT_ASSERT_EQUAL( 32, pPeaks->get_bucket_frames() );
+		CPPUNIT_ASSERT( pPeaks->get_levels() > 10 );
+
+		// the whole sample, summarized by the top level
+		SamplePeaks::Peak peak;
+		pPeaks->get_peaks( 0, 0, FRAMES, 1, &peak );
+		CPPUNIT_ASSERT_DOUBLES_EQUAL( 0.0, peak.min, 1e-6 );
+		CPPUNIT_ASSERT_DOUBLES_EQUAL( ( FRAMES - 1 ) / ( float )FRAMES, peak.max, 1e-6 );
+		CPPUNIT_ASSERT_DOUBLES_EQUAL( std::sqrt( 1.0 / 3.0 ), peak.rms, 1e-3 );
+		pPeaks->get_peaks( 1, 0, FRAMES, 1, &peak );
+		CPPUNIT_ASSERT_DOUBLES_EQUAL( -( FRAMES - 1 ) / ( float )FRAMES, peak.min, 1e-6 );
+		CPPUNIT_ASSERT_DOUBLES_EQUAL( 0.0, peak.max, 1e-6 );
+
+		// a mono sample has the same peaks on both sides
+		SampleData mono( 1000, 44100, 1 );
+		for ( int i = 0; i < 1000; i++ ) {
+			mono.data_l[ i ] = 0.5;
+		}
+		pPeaks = SamplePeaks::compute( mono );
+		CPPUNIT_ASSERT_EQUAL( 1, pPeaks->get_channels() );
+		CPPUNIT_ASSERT_EQUAL( 1, pPeaks->get_bucket_frames() );
+		pPeaks->get_peaks( 1, 100, 300, 1, &peak );
+		CPPUNIT_ASSERT_DOUBLES_EQUAL( 0.5, peak.min, 1e-6 );
+		CPPUNIT_ASSERT_DOUBLES_EQUAL( 0.5, peak.max, 1e-6 );
+		CPPUNIT_ASSERT_DOUBLES_EQUAL( 0.5, peak.rms, 1e-6 );
+	}
+
+	void testRanges()
+	{
+		std::shared_ptr<SamplePeaks> pPeaks = SamplePeaks::compute( *makeRamp() );
+		const int nPixels = 10;
+		const double fFramesPerPixel = 1000;
+		std::vector<SamplePeaks::Peak> peaks( nPixels );
+		pPeaks->get_peaks( 0, 5000, fFramesPerPixel, nPixels, peaks.data() );
+		for ( int i = 0; i < nPixels; i++ ) {
+			// a range is covered by whole peaks of a level finer
+			// than itself
+			double fFirst = 5000 + i * fFramesPerPixel;
+			double fLast = fFirst + fFramesPerPixel - 1;
+			CPPUNIT_ASSERT( peaks[ i ].min <= fFirst / FRAMES + 1e-6 );
+			CPPUNIT_ASSERT( peaks[ i ].min >= ( fFirst - fFramesPerPixel ) / FRAMES - 1e-6 );
+			CPPUNIT_ASSERT( peaks[ i ].max >= fLast / FRAMES - 1e-6 );
+			CPPUNIT_ASSERT( peaks[ i ].max <= ( fLast + fFramesPerPixel ) / FRAMES + 1e-6 );
+		}
+
+		// the ranges outside of the sample are empty
+		pPeaks->get_peaks( 0, -3000, fFramesPerPixel, 2, peaks.data() );
+		CPPUNIT_ASSERT_EQUAL( 0.0f, peaks[ 0 ].max );
+		CPPUNIT_ASSERT_EQUAL( 0.0f, peaks[ 1 ].max );
+		pPeaks->get_peaks( 0, FRAMES, fFramesPerPixel, 2, peaks.data() );
+		CPPUNIT_ASSERT_EQUAL( 0.0f, peaks[ 0 ].max );
+		CPPUNIT_ASSERT_EQUAL( 0.0f, peaks[ 1 ].max );
+	}
+
+	void testFile()
+	{
+		// read a chunk at a time, as summarized once decoded
+		QString sPath = H2TEST_FILE( "drumkits/baseKit/kick.wav" );
+		std::shared_ptr<SamplePeaks> pRead = SamplePeaks::compute( sPath );
+		CPPUNIT_ASSERT( pRead != nullptr );
+		std::shared_ptr<SampleData> pDecoded = SampleData::decode( sPath );
+		std::shared_ptr<SamplePeaks> pPeaks = SamplePeaks::compute( *pDecoded );
+		assertEqual( *pPeaks, *pRead );
+
+		CPPUNIT_ASSERT( SamplePeaks::compute( H2TEST_FILE( "missing.wav" ) ) == nullptr );
+		std::atomic<bool> bCancel( true );
+		CPPUNIT_ASSERT( SamplePeaks::compute( *pDecoded, &bCancel ) == nullptr );
+	}
+
+	void testPersistence()
+	{
+		std::shared_ptr<SamplePeaks> pPeaks = SamplePeaks::compute( *makeRamp() );
+
+		QBuffer buffer;
+		buffer.open( QIODevice::ReadWrite );
+		CPPUNIT_ASSERT( pPeaks->write( &buffer ) );
+		buffer.seek( 0 );
+		std::shared_ptr<SamplePeaks> pRead = SamplePeaks::read( &buffer );
+		CPPUNIT_ASSERT( pRead != nullptr );
+		assertEqual( *pPeaks, *pRead );
+
+		// truncated
+		QBuffer truncated;
+		truncated.setData( buffer.data().left( buffer.size() - 4 ) );
+		truncated.open( QIODevice::ReadOnly );
+		CPPUNIT_ASSERT( SamplePeaks::read( &truncated ) == nullptr );
+
+		// stored beside the data
+		QString sDir = Filesystem::tmp_dir() + "/sample_peaks";
+		{
+			SampleDiskCache cache( sDir, 1024 * 1024 * 1024 );
+			CPPUNIT_ASSERT( cache.load_peaks( "ramp" ) == nullptr );
+			CPPUNIT_ASSERT( cache.store_peaks( "ramp", *pPeaks ) );
+			CPPUNIT_ASSERT_EQUAL( ( long long )buffer.size(), cache.get_size() );
+			CPPUNIT_ASSERT( cache.load( "ramp" ) == nullptr );
+		}
+		SampleDiskCache cache( sDir, 1024 * 1024 * 1024 );
+		CPPUNIT_ASSERT_EQUAL( ( long long )buffer.size(), cache.get_size() );
+		pRead = cache.load_peaks( "ramp" );
+		CPPUNIT_ASSERT( pRead != nullptr );
+		assertEqual( *pPeaks, *pRead );
+		cache.clear();
+		CPPUNIT_ASSERT( cache.load_peaks( "ramp" ) == nullptr );
+		Filesystem::rm( sDir, true );
+	}
+};
+
+CPPUNIT_TEST_SUITE_REGISTRATION( SamplePeaksTest );
@@ -0,0 +1,82 @@
+#include <cppunit/extensions/HelperMacros.h>
+#include "test_helper.h"
+
+#include <hydrogen/Preferences.h>
+#include <hydrogen/basics/sample.h>
+#include <hydrogen/basics/sample_cache.h>
+
+using namespace H2Core;
+
+class SampleStreamTest : public CppUnit::TestCase {
+	CPPUNIT_TEST_SUITE( SampleStreamTest );
+	CPPUNIT_TEST( testHead );
+	CPPUNIT_TEST( testUnstream );
+	CPPUNIT_TEST_SUITE_END();
+
+	unsigned m_nThreshold;
+
+	public:
+	void setUp()
+	{
+		// crash.wav takes a bit more than 1 MB once decoded
+		m_nThreshold = Preferences::get_instance()->m_nSampleStreamThreshold;
+		Preferences::get_instance()->m_nSampleStreamThreshold = 1;
+	}
+
+	void tearDown()
+	{
+		Preferences::get_instance()->m_nSampleStreamThreshold = m_nThreshold;
+	}
+
+	void testHead()
+	{
+		CPPUNIT_ASSERT( Sample::is_streamable( H2TEST_FILE( "drumkits/baseKit/crash.wav" ) ) );
+		CPPUNIT_ASSERT( !Sample::is_streamable( H2TEST_FILE( "drumkits/baseKit/kick.wav" ) ) );
+
+		std::shared_ptr<SampleData> pFull = SampleData::decode( H2TEST_FILE( "drumkits/baseKit/crash.wav" ) );
+		Sample* pSample = Sample::load( H2TEST_FILE( "drumkits/baseKit/crash.wav" ) );
+		CPPUNIT_ASSERT( pFull != nullptr && pSample != nullptr );
+		CPPUNIT_ASSERT( pSample->is_streamed() );
+		CPPUNIT_ASSERT_EQUAL( pFull->frames, pSample->get_frames() );
+		CPPUNIT_ASSERT_EQUAL( Sample::STREAM_HEAD_FRAMES, pSample->get_head_frames() );
+		for ( int i = 0; i < pSample->get_head_frames(); i++ ) {
+			CPPUNIT_ASSERT_EQUAL( pFull->data_l[ i ], pSample->get_data_l()[ i ] );
+			CPPUNIT_ASSERT_EQUAL( pFull->data_r[ i ], pSample->get_data_r()[ i ] );
+		}
+
+		Sample* pCopy = new Sample( pSample );
+		CPPUNIT_ASSERT( pCopy->is_streamed() );
+		CPPUNIT_ASSERT_EQUAL( pSample->get_head_frames(), pCopy->get_head_frames() );
+		delete pCopy;
+		delete pSample;
+	}
+
+	void testUnstream()
+	{
+		std::shared_ptr<SampleData> pFull = SampleData::decode( H2TEST_FILE( "drumkits/baseKit/crash.wav" ) );
+		Sample* pSample = Sample::load( H2TEST_FILE( "drumkits/baseKit/crash.wav" ) );
+		CPPUNIT_ASSERT( pSample != nullptr && pSample->is_streamed() );
+
+		CPPUNIT_ASSERT( pSample->unstream() );
+		CPPUNIT_ASSERT( !pSample->is_streamed() );
+		CPPUNIT_ASSERT_EQUAL( pFull->frames, pSample->get_frames() );
+		CPPUNIT_ASSERT_EQUAL( pFull->frames, pSample->get_head_frames() );
+		for ( int i = 0; i < pSample->get_frames(); i++ ) {
+			CPPUNIT_ASSERT_EQUAL( pFull->data_l[ i ], pSample->get_data_l()[ i ] );
+		}
+
+		// a transformation needs the whole data
+		Sample* pLooped = Sample::load( H2TEST_FILE( "drumkits/baseKit/crash.wav" ) );
+		Sample::Loops loops;
+		loops.end_frame = pLooped->get_frames();
+		loops.count = 1;
+		CPPUNIT_ASSERT( pLooped->apply_loops( loops ) );
+		CPPUNIT_ASSERT( !pLooped->is_streamed() );
+		CPPUNIT_ASSERT_EQUAL( 2 * pFull->frames, pLooped->get_frames() );
+
+		delete pLooped;
+		delete pSample;
+	}
+};
+
+CPPUNIT_TEST_SUITE_REGISTRATION( SampleStreamTest );
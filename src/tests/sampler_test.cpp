@@ -0,0 +1,376 @@
+#include <cppunit/extensions/HelperMacros.h>
+
+#include <hydrogen/basics/drumkit_component.h>
+#include <hydrogen/basics/instrument.h>
+#include <hydrogen/basics/instrument_component.h>
+#include <hydrogen/basics/instrument_layer.h>
+#include <hydrogen/basics/instrument_list.h>
+#include <hydrogen/basics/note.h>
+#include <hydrogen/basics/note_pool.h>
+#include <hydrogen/basics/sample.h>
+#include <hydrogen/basics/song.h>
+#include <hydrogen/hydrogen.h>
+#include <hydrogen/Preferences.h>
+#include <hydrogen/sampler/Sampler.h>
+#include "test_helper.h"
+
+#include <memory>
+#include <unistd.h>
+#include <vector>
+
+using namespace H2Core;
+
+class SamplerTest : public CppUnit::TestCase {
+	CPPUNIT_TEST_SUITE( SamplerTest );
+	CPPUNIT_TEST( testParallelRendering );
+	CPPUNIT_TEST( testPitchedStream );
+	CPPUNIT_TEST( testInstrumentRelease );
+	CPPUNIT_TEST( testMuteGroup );
+	CPPUNIT_TEST( testMidiKeyNoteOff );
+	CPPUNIT_TEST( testStealOldest );
+	CPPUNIT_TEST( testStealQuietest );
+	CPPUNIT_TEST( testStealSameInstrument );
+	CPPUNIT_TEST_SUITE_END();
+
+	Song* m_pSong;
+	std::vector<Instrument*> m_instruments;
+	unsigned m_nMaxNotes;
+	int m_nVoiceStealing;
+
+	/** a sampler rendering with \a nThreads workers */
+	static Sampler* createSampler( unsigned nThreads )
+	{
+		Preferences* pPref = Preferences::get_instance();
+		unsigned nOldThreads = pPref->m_nRenderThreads;
+		pPref->m_nRenderThreads = nThreads;
+		Sampler* pSampler = new Sampler();
+		pPref->m_nRenderThreads = nOldThreads;
+		return pSampler;
+	}
+
+	/** an instrument playing kick.wav, deleted by tearDown() */
+	Instrument* createInstrument( int nMuteGroup = -1 )
+	{
+		Instrument* pInstr = new Instrument( 100 + m_instruments.size(), "voice" );
+		InstrumentComponent* pCompo = new InstrumentComponent( m_pSong->get_components()->front()->get_id() );
+		pCompo->set_layer( new InstrumentLayer( Sample::load( H2TEST_FILE( "drumkits/baseKit/kick.wav" ) ) ), 0 );
+		pInstr->get_components()->push_back( pCompo );
+		pInstr->set_mute_group( nMuteGroup );
+		m_instruments.push_back( pInstr );
+		return pInstr;
+	}
+
+	Note* play( Sampler* pSampler, Instrument* pInstr, float fVelocity = 0.8, int nMidiKey = -1 )
+	{
+		Note* pNote = NotePool::get_instance()->acquire( pInstr, 0, fVelocity, 0.5, 0.5, -1, 0 );
+		pNote->set_midi_info( Note::C, Note::P8, nMidiKey );
+		pSampler->note_on( pNote );
+		return pNote;
+	}
+
+	Note* play( Sampler* pSampler, int nInstrument, float fVelocity = 0.8 )
+	{
+		return play( pSampler, m_pSong->get_instrument_list()->get( nInstrument ), fVelocity );
+	}
+
+	/** plays on until the envelopes of the released notes end */
+	void playReleases( Sampler* pSampler )
+	{
+		// a release lasts 1000 frames by default, kick.wav is much
+		// longer, its released notes play on silent till its end
+		for ( int nCycle = 0; nCycle < 16; ++nCycle ) {
+			pSampler->process( 256, m_pSong );
+		}
+	}
+
+	/** \return true once the envelope of \a pNote has ended */
+	static bool isReleased( Note* pNote )
+	{
+		return pNote->get_adsr()->get_level() == 0.0f;
+	}
+
+	/** every instrument of the song played at once, \a nCycles of 256 frames */
+	std::vector<float> render( unsigned nThreads, int nCycles )
+	{
+		std::unique_ptr<Sampler> pSampler { createSampler( nThreads ) };
+		for ( int i = 0; i < m_pSong->get_instrument_list()->size(); ++i ) {
+			play( pSampler.get(), i );
+		}
+
+		std::vector<float> out;
+		for ( int nCycle = 0; nCycle < nCycles; ++nCycle ) {
+			pSampler->process( 256, m_pSong );
+			out.insert( out.end(), pSampler->__main_out_L, pSampler->__main_out_L + 256 );
+			out.insert( out.end(), pSampler->__main_out_R, pSampler->__main_out_R + 256 );
+		}
+		pSampler->stop_playing_notes();
+		return out;
+	}
+
+	/** \a pSample played alone at \a fPitch, \a nCycles of 4096 frames */
+	std::vector<float> renderSample( Sampler* pSampler, Sample* pSample, float fPitch, int nCycles )
+	{
+		Instrument* pInstr = new Instrument( 100, "sample" );
+		InstrumentComponent* pCompo = new InstrumentComponent( m_pSong->get_components()->front()->get_id() );
+		pCompo->set_layer( new InstrumentLayer( pSample ), 0 );
+		pInstr->get_components()->push_back( pCompo );
+		pSampler->note_on( NotePool::get_instance()->acquire( pInstr, 0, 0.8, 0.5, 0.5, -1, fPitch ) );
+
+		std::vector<float> out;
+		for ( int nCycle = 0; nCycle < nCycles; ++nCycle ) {
+			pSampler->process( 4096, m_pSong );
+			out.insert( out.end(), pSampler->__main_out_L, pSampler->__main_out_L + 4096 );
+			out.insert( out.end(), pSampler->__main_out_R, pSampler->__main_out_R + 4096 );
+			// leaves the disk thread time to fill the stream
+			usleep( 50 * 1000 );
+		}
+		pSampler->stop_playing_notes();
+		delete pInstr;
+		return out;
+	}
+
+	public:
+	void setUp()
+	{
+		m_pSong = Song::load( H2TEST_FILE( "functional/test.h2song" ) );
+		CPPUNIT_ASSERT( m_pSong != nullptr );
+		Hydrogen::get_instance()->setSong( m_pSong );
+
+		Preferences* pPref = Preferences::get_instance();
+		m_nMaxNotes = pPref->m_nMaxNotes;
+		m_nVoiceStealing = pPref->m_nVoiceStealing;
+	}
+
+	void tearDown()
+	{
+		Preferences* pPref = Preferences::get_instance();
+		pPref->m_nMaxNotes = m_nMaxNotes;
+		pPref->m_nVoiceStealing = m_nVoiceStealing;
+
+		for ( Instrument* pInstr : m_instruments ) {
+			delete pInstr;
+		}
+		m_instruments.clear();
+		Hydrogen::get_instance()->setSong( Song::get_empty_song() );
+	}
+
+	void testParallelRendering()
+	{
+		std::vector<float> serial = render( 0, 64 );
+		std::vector<float> parallel = render( 3, 64 );
+
+		bool bSilent = true;
+		for ( float fValue : serial ) {
+			if ( fValue != 0.0f ) {
+				bSilent = false;
+				break;
+			}
+		}
+		CPPUNIT_ASSERT( !bSilent );
+
+		// the voices are mixed in the same order whoever renders them
+		CPPUNIT_ASSERT_EQUAL( serial.size(), parallel.size() );
+		for ( size_t i = 0; i < serial.size(); ++i ) {
+			CPPUNIT_ASSERT_EQUAL( serial[ i ], parallel[ i ] );
+		}
+	}
+
+	void testPitchedStream()
+	{
+		Preferences* pPref = Preferences::get_instance();
+		unsigned nThreshold = pPref->m_nSampleStreamThreshold;
+		bool bVariants = pPref->m_bResampleVariants;
+		pPref->m_bResampleVariants = false;
+
+		pPref->m_nSampleStreamThreshold = 0;
+		Sample* pFull = Sample::load( H2TEST_FILE( "drumkits/baseKit/crash.wav" ) );
+		// crash.wav takes a bit more than 1 MB once decoded
+		pPref->m_nSampleStreamThreshold = 1;
+		Sample* pStreamed = Sample::load( H2TEST_FILE( "drumkits/baseKit/crash.wav" ) );
+		std::unique_ptr<Sampler> pSampler { createSampler( 0 ) };
+		pPref->m_nSampleStreamThreshold = nThreshold;
+
+		CPPUNIT_ASSERT( pFull != nullptr && !pFull->is_streamed() );
+		CPPUNIT_ASSERT( pStreamed != nullptr && pStreamed->is_streamed() );
+		CPPUNIT_ASSERT( pSampler->has_streams() );
+
+		// Three octaves up, a cycle spans more frames of the sample
+		// than a stream window holds. The tail of the sample has to
+		// play as it does from memory rather than silent.
+		int nHeadFrames = pStreamed->get_head_frames();
+		std::vector<float> full = renderSample( pSampler.get(), pFull, 36.0, 8 );
+		std::vector<float> streamed = renderSample( pSampler.get(), pStreamed, 36.0, 8 );
+		pPref->m_bResampleVariants = bVariants;
+
+		CPPUNIT_ASSERT_EQUAL( full.size(), streamed.size() );
+		for ( size_t i = 0; i < full.size(); ++i ) {
+			CPPUNIT_ASSERT_DOUBLES_EQUAL( full[ i ], streamed[ i ], 1e-4 );
+		}
+
+		// from the first cycle past the head, 8 frames of the sample
+		// are played per frame
+		bool bTail = false;
+		for ( size_t i = 2 * 4096 * ( nHeadFrames / 8 / 4096 + 1 ); i < streamed.size(); ++i ) {
+			if ( streamed[ i ] != 0.0f ) {
+				bTail = true;
+				break;
+			}
+		}
+		CPPUNIT_ASSERT( bTail );
+	}
+
+	void testInstrumentRelease()
+	{
+		std::unique_ptr<Sampler> pSampler { createSampler( 0 ) };
+		Instrument* pFirst = createInstrument();
+		Instrument* pSecond = createInstrument();
+		Instrument* pThird = createInstrument();
+		Note* pFirst1 = play( pSampler.get(), pFirst );
+		Note* pFirst2 = play( pSampler.get(), pFirst );
+		Note* pSecond1 = play( pSampler.get(), pSecond );
+		Note* pThird1 = play( pSampler.get(), pThird );
+		CPPUNIT_ASSERT_EQUAL( 4, pSampler->get_playing_notes_number() );
+		CPPUNIT_ASSERT( pSampler->is_instrument_playing( pFirst ) );
+
+		// the notes of the first instrument are released
+		pSampler->note_off( NotePool::get_instance()->acquire( pFirst, 0, 0.8, 0.5, 0.5, -1, 0 ) );
+		// a note-off note releases the second one without playing
+		Note* pNoteOff = NotePool::get_instance()->acquire( pSecond, 0, 0.8, 0.5, 0.5, -1, 0 );
+		pNoteOff->set_note_off( true );
+		pSampler->note_on( pNoteOff );
+		NotePool::get_instance()->release( pNoteOff );
+		CPPUNIT_ASSERT_EQUAL( 4, pSampler->get_playing_notes_number() );
+
+		playReleases( pSampler.get() );
+		CPPUNIT_ASSERT( isReleased( pFirst1 ) );
+		CPPUNIT_ASSERT( isReleased( pFirst2 ) );
+		CPPUNIT_ASSERT( isReleased( pSecond1 ) );
+		CPPUNIT_ASSERT( !isReleased( pThird1 ) );
+
+		// stopped right away
+		pSampler->stop_playing_notes( pFirst );
+		CPPUNIT_ASSERT_EQUAL( 2, pSampler->get_playing_notes_number() );
+		CPPUNIT_ASSERT( !pSampler->is_instrument_playing( pFirst ) );
+		CPPUNIT_ASSERT( pSampler->is_instrument_playing( pSecond ) );
+		pSampler->stop_playing_notes();
+		CPPUNIT_ASSERT_EQUAL( 0, pSampler->get_playing_notes_number() );
+		CPPUNIT_ASSERT( !pSampler->is_instrument_playing( pThird ) );
+	}
+
+	void testMuteGroup()
+	{
+		std::unique_ptr<Sampler> pSampler { createSampler( 0 ) };
+		Instrument* pOpen = createInstrument( 1 );
+		Instrument* pClosed = createInstrument( 1 );
+		Instrument* pOther = createInstrument( 2 );
+		Note* pOpen1 = play( pSampler.get(), pOpen );
+		Note* pOther1 = play( pSampler.get(), pOther );
+		Note* pClosed1 = play( pSampler.get(), pClosed );
+		// the same instrument doesn't mute itself
+		Note* pClosed2 = play( pSampler.get(), pClosed );
+		playReleases( pSampler.get() );
+
+		CPPUNIT_ASSERT_EQUAL( 4, pSampler->get_playing_notes_number() );
+		CPPUNIT_ASSERT( isReleased( pOpen1 ) );
+		CPPUNIT_ASSERT( !isReleased( pOther1 ) );
+		CPPUNIT_ASSERT( !isReleased( pClosed1 ) );
+		CPPUNIT_ASSERT( !isReleased( pClosed2 ) );
+		pSampler->stop_playing_notes();
+	}
+
+	void testMidiKeyNoteOff()
+	{
+		std::unique_ptr<Sampler> pSampler { createSampler( 0 ) };
+		Instrument* pFirst = createInstrument();
+		Instrument* pSecond = createInstrument();
+		Note* pFirst36 = play( pSampler.get(), pFirst, 0.8, 36 );
+		Note* pSecond36 = play( pSampler.get(), pSecond, 0.8, 36 );
+		Note* pSecond38 = play( pSampler.get(), pSecond, 0.8, 38 );
+		Note* pFirstNoKey = play( pSampler.get(), pFirst );
+
+		pSampler->midi_keyboard_note_off( 36 );
+		playReleases( pSampler.get() );
+		CPPUNIT_ASSERT( isReleased( pFirst36 ) );
+		CPPUNIT_ASSERT( isReleased( pSecond36 ) );
+		CPPUNIT_ASSERT( !isReleased( pSecond38 ) );
+		CPPUNIT_ASSERT( !isReleased( pFirstNoKey ) );
+
+		pSampler->midi_keyboard_note_off( 38 );
+		playReleases( pSampler.get() );
+		CPPUNIT_ASSERT( isReleased( pSecond38 ) );
+		CPPUNIT_ASSERT( !isReleased( pFirstNoKey ) );
+		pSampler->stop_playing_notes();
+	}
+
+	void testStealOldest()
+	{
+		Preferences::get_instance()->m_nMaxNotes = 2;
+		Preferences::get_instance()->m_nVoiceStealing = Preferences::VOICE_STEALING_OLDEST;
+		std::unique_ptr<Sampler> pSampler { createSampler( 0 ) };
+		Instrument* pFirst = createInstrument();
+		Instrument* pSecond = createInstrument();
+		Instrument* pThird = createInstrument();
+		play( pSampler.get(), pFirst, 0.2 );
+		play( pSampler.get(), pSecond );
+		play( pSampler.get(), pThird );
+
+		CPPUNIT_ASSERT_EQUAL( 2, pSampler->get_playing_notes_number() );
+		CPPUNIT_ASSERT( !pSampler->is_instrument_playing( pFirst ) );
+		CPPUNIT_ASSERT( pSampler->is_instrument_playing( pSecond ) );
+		CPPUNIT_ASSERT( pSampler->is_instrument_playing( pThird ) );
+
+		// down to a lowered limit at the next cycle
+		Preferences::get_instance()->m_nMaxNotes = 1;
+		pSampler->process( 256, m_pSong );
+		CPPUNIT_ASSERT_EQUAL( 1, pSampler->get_playing_notes_number() );
+		CPPUNIT_ASSERT( pSampler->is_instrument_playing( pThird ) );
+		pSampler->stop_playing_notes();
+	}
+
+	void testStealQuietest()
+	{
+		Preferences::get_instance()->m_nMaxNotes = 2;
+		Preferences::get_instance()->m_nVoiceStealing = Preferences::VOICE_STEALING_QUIETEST;
+		std::unique_ptr<Sampler> pSampler { createSampler( 0 ) };
+		Instrument* pFirst = createInstrument();
+		Instrument* pSecond = createInstrument();
+		Instrument* pThird = createInstrument();
+		play( pSampler.get(), pFirst );
+		play( pSampler.get(), pSecond, 0.2 );
+		play( pSampler.get(), pThird );
+
+		CPPUNIT_ASSERT_EQUAL( 2, pSampler->get_playing_notes_number() );
+		CPPUNIT_ASSERT( pSampler->is_instrument_playing( pFirst ) );
+		CPPUNIT_ASSERT( !pSampler->is_instrument_playing( pSecond ) );
+		CPPUNIT_ASSERT( pSampler->is_instrument_playing( pThird ) );
+		pSampler->stop_playing_notes();
+	}
+
+	void testStealSameInstrument()
+	{
+		Preferences::get_instance()->m_nMaxNotes = 2;
+		Preferences::get_instance()->m_nVoiceStealing = Preferences::VOICE_STEALING_SAME_INSTRUMENT;
+		std::unique_ptr<Sampler> pSampler { createSampler( 0 ) };
+		Instrument* pFirst = createInstrument();
+		Instrument* pSecond = createInstrument();
+		Instrument* pThird = createInstrument();
+		play( pSampler.get(), pFirst );
+		play( pSampler.get(), pSecond );
+
+		// the older note of the instrument makes room, not the oldest
+		play( pSampler.get(), pSecond );
+		CPPUNIT_ASSERT_EQUAL( 2, pSampler->get_playing_notes_number() );
+		CPPUNIT_ASSERT( pSampler->is_instrument_playing( pFirst ) );
+		CPPUNIT_ASSERT( pSampler->is_instrument_playing( pSecond ) );
+
+		// none playing, the oldest one makes room
+		play( pSampler.get(), pThird );
+		CPPUNIT_ASSERT_EQUAL( 2, pSampler->get_playing_notes_number() );
+		CPPUNIT_ASSERT( !pSampler->is_instrument_playing( pFirst ) );
+		CPPUNIT_ASSERT( pSampler->is_instrument_playing( pSecond ) );
+		CPPUNIT_ASSERT( pSampler->is_instrument_playing( pThird ) );
+		pSampler->stop_playing_notes();
+	}
+};
+
+CPPUNIT_TEST_SUITE_REGISTRATION( SamplerTest );
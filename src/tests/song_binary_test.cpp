@@ -0,0 +1,109 @@
+#include <cppunit/extensions/HelperMacros.h>
+#include "test_helper.h"
+
+#include <QFile>
+
+#include <hydrogen/basics/instrument.h>
+#include <hydrogen/basics/instrument_list.h>
+#include <hydrogen/basics/note.h>
+#include <hydrogen/basics/pattern.h>
+#include <hydrogen/basics/pattern_list.h>
+#include <hydrogen/basics/song.h>
+#include <hydrogen/basics/song_binary.h>
+#include <hydrogen/helpers/filesystem.h>
+
+using namespace H2Core;
+
+class SongBinaryTest : public CppUnit::TestCase {
+	CPPUNIT_TEST_SUITE( SongBinaryTest );
+	CPPUNIT_TEST( testRoundTrip );
+	CPPUNIT_TEST( testTruncated );
+	CPPUNIT_TEST_SUITE_END();
+
+	QString m_sBinFile;
+	QString m_sXmlFile;
+
+	void assertSameSong( Song* pExpected, Song* pSong )
+	{
+		CPPUNIT_ASSERT_EQUAL( pExpected->get_instrument_list()->size(), pSong->get_instrument_list()->size() );
+		CPPUNIT_ASSERT_EQUAL( pExpected->get_pattern_group_vector()->size(), pSong->get_pattern_group_vector()->size() );
+		PatternList* pExpectedPatterns = pExpected->get_pattern_list();
+		PatternList* pPatterns = pSong->get_pattern_list();
+		CPPUNIT_ASSERT_EQUAL( pExpectedPatterns->size(), pPatterns->size() );
+		for ( int i = 0; i < pExpectedPatterns->size(); i++ ) {
+			Pattern* pExpectedPattern = pExpectedPatterns->get( i );
+			Pattern* pPattern = pPatterns->get( i );
+			CPPUNIT_ASSERT( pExpectedPattern->get_name() == pPattern->get_name() );
+			CPPUNIT_ASSERT( pExpectedPattern->get_info() == pPattern->get_info() );
+			CPPUNIT_ASSERT( pExpectedPattern->get_category() == pPattern->get_category() );
+			CPPUNIT_ASSERT_EQUAL( pExpectedPattern->get_length(), pPattern->get_length() );
+			CPPUNIT_ASSERT_EQUAL( pExpectedPattern->get_notes()->size(), pPattern->get_notes()->size() );
+			auto it = pPattern->get_notes()->begin();
+			for ( auto expected = pExpectedPattern->get_notes()->begin(); expected != pExpectedPattern->get_notes()->end(); ++expected, ++it ) {
+				Note* pExpectedNote = expected->second;
+				Note* pNote = it->second;
+				CPPUNIT_ASSERT_EQUAL( pExpectedNote->get_position(), pNote->get_position() );
+				CPPUNIT_ASSERT_EQUAL( pExpectedNote->get_length(), pNote->get_length() );
+				CPPUNIT_ASSERT_EQUAL( pExpectedNote->get_velocity(), pNote->get_velocity() );
+				CPPUNIT_ASSERT_EQUAL( pExpectedNote->get_pan_l(), pNote->get_pan_l() );
+				CPPUNIT_ASSERT_EQUAL( pExpectedNote->get_pan_r(), pNote->get_pan_r() );
+				CPPUNIT_ASSERT_EQUAL( pExpectedNote->get_pitch(), pNote->get_pitch() );
+				CPPUNIT_ASSERT_EQUAL( pExpectedNote->get_lead_lag(), pNote->get_lead_lag() );
+				CPPUNIT_ASSERT_EQUAL( pExpectedNote->get_probability(), pNote->get_probability() );
+				CPPUNIT_ASSERT_EQUAL( pExpectedNote->get_note_off(), pNote->get_note_off() );
+				CPPUNIT_ASSERT( pExpectedNote->key_to_string() == pNote->key_to_string() );
+				CPPUNIT_ASSERT_EQUAL( pExpectedNote->get_instrument()->get_id(), pNote->get_instrument()->get_id() );
+			}
+		}
+	}
+
+	public:
+	void setUp()
+	{
+		m_sBinFile = Filesystem::tmp_dir() + "/song_binary_test" + Filesystem::songs_bin_ext;
+		m_sXmlFile = Filesystem::tmp_dir() + "/song_binary_test" + Filesystem::songs_ext;
+	}
+
+	void tearDown()
+	{
+		QFile::remove( m_sBinFile );
+		QFile::remove( m_sXmlFile );
+	}
+
+	void testRoundTrip()
+	{
+		Song* pSong = Song::load( H2TEST_FILE( "functional/test.h2song" ) );
+		CPPUNIT_ASSERT( pSong != nullptr );
+		CPPUNIT_ASSERT( pSong->save( m_sBinFile ) );
+		CPPUNIT_ASSERT( SongBinary::is_binary( m_sBinFile ) );
+		CPPUNIT_ASSERT( !SongBinary::is_binary( H2TEST_FILE( "functional/test.h2song" ) ) );
+
+		Song* pBinary = Song::load( m_sBinFile );
+		CPPUNIT_ASSERT( pBinary != nullptr );
+		assertSameSong( pSong, pBinary );
+
+		// and back to XML
+		CPPUNIT_ASSERT( pBinary->save( m_sXmlFile ) );
+		CPPUNIT_ASSERT( !SongBinary::is_binary( m_sXmlFile ) );
+		Song* pXml = Song::load( m_sXmlFile );
+		CPPUNIT_ASSERT( pXml != nullptr );
+		assertSameSong( pSong, pXml );
+
+		delete pXml;
+		delete pBinary;
+		delete pSong;
+	}
+
+	void testTruncated()
+	{
+		Song* pSong = Song::load( H2TEST_FILE( "functional/test.h2song" ) );
+		CPPUNIT_ASSERT( pSong != nullptr );
+		CPPUNIT_ASSERT( pSong->save( m_sBinFile ) );
+		delete pSong;
+
+		QFile::resize( m_sBinFile, QFile( m_sBinFile ).size() / 2 );
+		CPPUNIT_ASSERT( Song::load( m_sBinFile ) == nullptr );
+	}
+};
+
+CPPUNIT_TEST_SUITE_REGISTRATION( SongBinaryTest );
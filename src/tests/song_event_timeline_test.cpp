@@ -0,0 +1,131 @@
+#include <cppunit/extensions/HelperMacros.h>
+
+#include <hydrogen/basics/instrument.h>
+#include <hydrogen/basics/note.h>
+#include <hydrogen/basics/pattern.h>
+#include <hydrogen/basics/pattern_list.h>
+#include <hydrogen/basics/song.h>
+#include <hydrogen/basics/song_event_timeline.h>
+
+using namespace H2Core;
+
+class SongEventTimelineTest : public CppUnit::TestCase {
+	CPPUNIT_TEST_SUITE( SongEventTimelineTest );
+	CPPUNIT_TEST( testFindColumn );
+	CPPUNIT_TEST( testEvents );
+	CPPUNIT_TEST( testIncrementalUpdate );
+	CPPUNIT_TEST_SUITE_END();
+
+	Instrument* m_pInstrument;
+	Pattern* m_pPatternA;
+	Pattern* m_pPatternB;
+	Song* m_pSong;
+
+	public:
+	void setUp()
+	{
+		m_pInstrument = new Instrument();
+
+		// A: 192 ticks, notes at 0 and 48. B: 96 ticks, note at 0.
+		m_pPatternA = new Pattern( "A", "", "", 192 );
+		m_pPatternA->insert_note( new Note( m_pInstrument, 0, 1.0, 0.5, 0.5, -1, 0 ) );
+		m_pPatternA->insert_note( new Note( m_pInstrument, 48, 1.0, 0.5, 0.5, -1, 0 ) );
+		m_pPatternB = new Pattern( "B", "", "", 96 );
+		m_pPatternB->insert_note( new Note( m_pInstrument, 0, 1.0, 0.5, 0.5, -1, 0 ) );
+
+		PatternList* pPatterns = new PatternList();
+		pPatterns->add( m_pPatternA );
+		pPatterns->add( m_pPatternB );
+
+		// Columns: [A], [B], [A, B]
+		std::vector<PatternList*>* pColumns = new std::vector<PatternList*>();
+		PatternList* pColumn = new PatternList();
+		pColumn->add( m_pPatternA );
+		pColumns->push_back( pColumn );
+		pColumn = new PatternList();
+		pColumn->add( m_pPatternB );
+		pColumns->push_back( pColumn );
+		pColumn = new PatternList();
+		pColumn->add( m_pPatternA );
+		pColumn->add( m_pPatternB );
+		pColumns->push_back( pColumn );
+
+		m_pSong = new Song( "timeline", "test", 120, 0.5 );
+		m_pSong->set_pattern_list( pPatterns );
+		m_pSong->set_pattern_group_vector( pColumns );
+	}
+
+	void tearDown()
+	{
+		delete m_pSong;
+		delete m_pInstrument;
+	}
+
+	void testFindColumn()
+	{
+		SongEventTimeline timeline;
+		CPPUNIT_ASSERT( timeline.update( m_pSong ) );
+		CPPUNIT_ASSERT( !timeline.update( m_pSong ) );
+		CPPUNIT_ASSERT_EQUAL( 480, timeline.get_song_size() );
+
+		int nStart, nSongSize;
+		CPPUNIT_ASSERT_EQUAL( 0, timeline.find_column( 0, false, &nStart, &nSongSize ) );
+		CPPUNIT_ASSERT_EQUAL( 0, nStart );
+		CPPUNIT_ASSERT_EQUAL( 1, timeline.find_column( 200, false, &nStart, &nSongSize ) );
+		CPPUNIT_ASSERT_EQUAL( 192, nStart );
+		CPPUNIT_ASSERT_EQUAL( 2, timeline.find_column( 479, false, &nStart, &nSongSize ) );
+		CPPUNIT_ASSERT_EQUAL( 288, nStart );
+		CPPUNIT_ASSERT_EQUAL( 0, nSongSize );
+		CPPUNIT_ASSERT_EQUAL( -1, timeline.find_column( 480, false, &nStart, &nSongSize ) );
+
+		// second turn in loop mode
+		CPPUNIT_ASSERT_EQUAL( 1, timeline.find_column( 480 + 200, true, &nStart, &nSongSize ) );
+		CPPUNIT_ASSERT_EQUAL( 192, nStart );
+		CPPUNIT_ASSERT_EQUAL( 480, nSongSize );
+	}
+
+	void testEvents()
+	{
+		SongEventTimeline timeline;
+		timeline.update( m_pSong );
+
+		// both patterns play at the start of the last column
+		int nFirst, nLast;
+		timeline.get_events( 2, 0, &nFirst, &nLast );
+		CPPUNIT_ASSERT_EQUAL( 2, nLast - nFirst );
+		const SongEventTimeline::Column* pColumn = timeline.get_column( 2 );
+		CPPUNIT_ASSERT( pColumn->patterns[ pColumn->events[ nFirst ].pattern ] == m_pPatternA );
+		CPPUNIT_ASSERT( pColumn->patterns[ pColumn->events[ nFirst + 1 ].pattern ] == m_pPatternB );
+
+		// consecutive ticks through the cursor
+		timeline.get_events( 2, 1, &nFirst, &nLast );
+		CPPUNIT_ASSERT_EQUAL( 0, nLast - nFirst );
+		timeline.get_events( 2, 48, &nFirst, &nLast );
+		CPPUNIT_ASSERT_EQUAL( 1, nLast - nFirst );
+
+		// notes past the length of the column are not played
+		timeline.get_events( 1, 48, &nFirst, &nLast );
+		CPPUNIT_ASSERT_EQUAL( 0, nLast - nFirst );
+	}
+
+	void testIncrementalUpdate()
+	{
+		SongEventTimeline timeline;
+		timeline.update( m_pSong );
+
+		int nFirst, nLast;
+		timeline.get_events( 1, 24, &nFirst, &nLast );
+		CPPUNIT_ASSERT_EQUAL( 0, nLast - nFirst );
+
+		m_pPatternB->insert_note( new Note( m_pInstrument, 24, 1.0, 0.5, 0.5, -1, 0 ) );
+		CPPUNIT_ASSERT( timeline.update( m_pSong ) );
+		timeline.get_events( 1, 24, &nFirst, &nLast );
+		CPPUNIT_ASSERT_EQUAL( 1, nLast - nFirst );
+
+		m_pPatternB->set_length( 48 );
+		CPPUNIT_ASSERT( timeline.update( m_pSong ) );
+		CPPUNIT_ASSERT_EQUAL( 192 + 48 + 192, timeline.get_song_size() );
+	}
+};
+
+CPPUNIT_TEST_SUITE_REGISTRATION( SongEventTimelineTest );
@@ -0,0 +1,158 @@
+#include <cppunit/extensions/HelperMacros.h>
+
+#include <hydrogen/basics/instrument.h>
+#include <hydrogen/basics/note.h>
+#include <hydrogen/basics/pattern.h>
+#include <hydrogen/basics/pattern_list.h>
+#include <hydrogen/basics/song.h>
+#include <hydrogen/basics/song_snapshot.h>
+
+using namespace H2Core;
+
+class SongSnapshotTest : public CppUnit::TestCase {
+	CPPUNIT_TEST_SUITE( SongSnapshotTest );
+	CPPUNIT_TEST( testNotes );
+	CPPUNIT_TEST( testReuse );
+	CPPUNIT_TEST( testJustRecorded );
+	CPPUNIT_TEST( testNoSong );
+	CPPUNIT_TEST_SUITE_END();
+
+	Instrument* m_pInstrument;
+	Pattern* m_pPatternA;
+	Pattern* m_pPatternB;
+	Song* m_pSong;
+
+	public:
+	void setUp()
+	{
+		m_pInstrument = new Instrument();
+
+		// A: notes at 0, 48 and 48. B: note at 0.
+		m_pPatternA = new Pattern( "A", "", "", 192 );
+		m_pPatternA->insert_note( new Note( m_pInstrument, 0, 1.0, 0.5, 0.5, -1, 0 ) );
+		m_pPatternA->insert_note( new Note( m_pInstrument, 48, 0.8, 0.5, 0.5, -1, 0 ) );
+		m_pPatternA->insert_note( new Note( m_pInstrument, 48, 0.6, 0.5, 0.5, -1, 0 ) );
+		m_pPatternB = new Pattern( "B", "", "", 96 );
+		m_pPatternB->insert_note( new Note( m_pInstrument, 0, 1.0, 0.5, 0.5, -1, 0 ) );
+
+		PatternList* pPatterns = new PatternList();
+		pPatterns->add( m_pPatternA );
+		pPatterns->add( m_pPatternB );
+
+		// Columns: [A], [A, B]
+		std::vector<PatternList*>* pColumns = new std::vector<PatternList*>();
+		PatternList* pColumn = new PatternList();
+		pColumn->add( m_pPatternA );
+		pColumns->push_back( pColumn );
+		pColumn = new PatternList();
+		pColumn->add( m_pPatternA );
+		pColumn->add( m_pPatternB );
+		pColumns->push_back( pColumn );
+
+		m_pSong = new Song( "snapshot", "test", 120, 0.5 );
+		m_pSong->set_pattern_list( pPatterns );
+		m_pSong->set_pattern_group_vector( pColumns );
+	}
+
+	void tearDown()
+	{
+		delete m_pSong;
+		delete m_pInstrument;
+	}
+
+	void testNotes()
+	{
+		SongSnapshot snapshot( m_pSong, nullptr, 1 );
+		CPPUNIT_ASSERT( snapshot.has_changed() );
+		CPPUNIT_ASSERT_EQUAL( 1, snapshot.get_version() );
+		CPPUNIT_ASSERT_EQUAL( 2, snapshot.get_timeline()->size() );
+
+		const SongSnapshot::PatternNotes* pNotes = snapshot.get_notes( m_pPatternA );
+		CPPUNIT_ASSERT( pNotes != nullptr );
+		CPPUNIT_ASSERT_EQUAL( 3, pNotes->size() );
+		CPPUNIT_ASSERT_EQUAL( m_pPatternA->get_revision(), pNotes->get_revision() );
+
+		int nFirst, nLast;
+		pNotes->get_range( 48, &nFirst, &nLast );
+		CPPUNIT_ASSERT_EQUAL( 1, nFirst );
+		CPPUNIT_ASSERT_EQUAL( 3, nLast );
+		CPPUNIT_ASSERT_EQUAL( 48, pNotes->get_note( nFirst )->get_position() );
+		pNotes->get_range( 24, &nFirst, &nLast );
+		CPPUNIT_ASSERT_EQUAL( nFirst, nLast );
+
+		// the notes are copies
+		Note* pNote = m_pPatternA->find_note( 0, -1, m_pInstrument );
+		CPPUNIT_ASSERT( pNote != nullptr );
+		pNotes->get_range( 0, &nFirst, &nLast );
+		CPPUNIT_ASSERT( pNotes->get_note( nFirst ) != pNote );
+		pNote->set_velocity( 0.1 );
+		CPPUNIT_ASSERT_DOUBLES_EQUAL( 1.0, pNotes->get_note( nFirst )->get_velocity(), 0.001 );
+
+		CPPUNIT_ASSERT( snapshot.get_notes( nullptr ) == nullptr );
+	}
+
+	void testReuse()
+	{
+		SongSnapshot first( m_pSong, nullptr, 1 );
+
+		// nothing changed
+		SongSnapshot second( m_pSong, &first, 2 );
+		CPPUNIT_ASSERT( !second.has_changed() );
+		CPPUNIT_ASSERT( second.get_notes( m_pPatternA ) == first.get_notes( m_pPatternA ) );
+
+		// only the edited pattern is copied again
+		m_pPatternB->insert_note( new Note( m_pInstrument, 48, 1.0, 0.5, 0.5, -1, 0 ) );
+		SongSnapshot third( m_pSong, &second, 3 );
+		CPPUNIT_ASSERT( third.has_changed() );
+		CPPUNIT_ASSERT( third.get_notes( m_pPatternA ) == first.get_notes( m_pPatternA ) );
+		CPPUNIT_ASSERT( third.get_notes( m_pPatternB ) != first.get_notes( m_pPatternB ) );
+		CPPUNIT_ASSERT_EQUAL( 2, third.get_notes( m_pPatternB )->size() );
+
+		// notes changed in place are only seen once touched
+		Note* pNote = m_pPatternA->find_note( 0, -1, m_pInstrument );
+		pNote->set_velocity( 0.1 );
+		m_pPatternA->touch();
+		SongSnapshot fourth( m_pSong, &third, 4 );
+		CPPUNIT_ASSERT( fourth.has_changed() );
+		const SongSnapshot::PatternNotes* pNotes = fourth.get_notes( m_pPatternA );
+		int nFirst, nLast;
+		pNotes->get_range( 0, &nFirst, &nLast );
+		CPPUNIT_ASSERT_DOUBLES_EQUAL( 0.1, pNotes->get_note( nFirst )->get_velocity(), 0.001 );
+	}
+
+	void testJustRecorded()
+	{
+		Note* pNote = m_pPatternB->find_note( 0, -1, m_pInstrument );
+		pNote->set_just_recorded( true );
+
+		SongSnapshot snapshot( m_pSong, nullptr, 1 );
+		const SongSnapshot::PatternNotes* pNotes = snapshot.get_notes( m_pPatternB );
+		CPPUNIT_ASSERT( pNotes->is_just_recorded( 0 ) );
+
+		// played by the audio thread, handed back to the pattern
+		pNotes->set_played( 0 );
+		CPPUNIT_ASSERT( !pNotes->is_just_recorded( 0 ) );
+		CPPUNIT_ASSERT( pNote->get_just_recorded() );
+		snapshot.sync_played();
+		CPPUNIT_ASSERT( !pNote->get_just_recorded() );
+	}
+
+	void testNoSong()
+	{
+		SongSnapshot empty( nullptr, nullptr, 1 );
+		CPPUNIT_ASSERT( empty.has_changed() );
+		CPPUNIT_ASSERT_EQUAL( 0, empty.get_timeline()->size() );
+		CPPUNIT_ASSERT( empty.get_notes( m_pPatternA ) == nullptr );
+
+		SongSnapshot still_empty( nullptr, &empty, 2 );
+		CPPUNIT_ASSERT( !still_empty.has_changed() );
+
+		SongSnapshot song( m_pSong, &still_empty, 3 );
+		CPPUNIT_ASSERT( song.has_changed() );
+		SongSnapshot removed( nullptr, &song, 4 );
+		CPPUNIT_ASSERT( removed.has_changed() );
+		CPPUNIT_ASSERT_EQUAL( 0, removed.get_timeline()->size() );
+	}
+};
+
+CPPUNIT_TEST_SUITE_REGISTRATION( SongSnapshotTest );
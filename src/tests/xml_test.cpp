@@ -3,7 +3,10 @@
 #include <unistd.h>
 
 #include <hydrogen/basics/drumkit.h>
+#include <hydrogen/basics/note.h>
 #include <hydrogen/basics/pattern.h>
+#include <hydrogen/basics/pattern_list.h>
+#include <hydrogen/basics/song.h>
 #include <hydrogen/basics/instrument.h>
 #include <hydrogen/basics/instrument_list.h>
 #include <hydrogen/basics/instrument_layer.h>
@@ -163,3 +166,40 @@ void XmlTest::testPattern()
 	delete dk0;
 }
 
+// The streaming reader has to build the same patterns as the
+// document based one.
+void XmlTest::testSongStream()
+{
+	const char* songs[] = { "song/test_song_0.9.6.h2song", "song/test_song_0.9.7.h2song", "functional/test.h2song" };
+	for ( const char* sSong : songs ) {
+		H2Core::SongReader reader;
+		H2Core::Song* pStreamed = reader.readSong( H2TEST_FILE( sSong ) );
+		H2Core::Song* pDocument = reader.readSongDocument( H2TEST_FILE( sSong ) );
+		CPPUNIT_ASSERT( pStreamed != nullptr );
+		CPPUNIT_ASSERT( pDocument != nullptr );
+		CPPUNIT_ASSERT_EQUAL( pDocument->get_instrument_list()->size(), pStreamed->get_instrument_list()->size() );
+		CPPUNIT_ASSERT_EQUAL( pDocument->get_pattern_group_vector()->size(), pStreamed->get_pattern_group_vector()->size() );
+
+		H2Core::PatternList* pStreamedPatterns = pStreamed->get_pattern_list();
+		H2Core::PatternList* pDocumentPatterns = pDocument->get_pattern_list();
+		CPPUNIT_ASSERT_EQUAL( pDocumentPatterns->size(), pStreamedPatterns->size() );
+		for ( int i = 0; i < pDocumentPatterns->size(); i++ ) {
+			H2Core::Pattern* pStreamedPattern = pStreamedPatterns->get( i );
+			H2Core::Pattern* pDocumentPattern = pDocumentPatterns->get( i );
+			CPPUNIT_ASSERT( pDocumentPattern->get_name() == pStreamedPattern->get_name() );
+			CPPUNIT_ASSERT_EQUAL( pDocumentPattern->get_length(), pStreamedPattern->get_length() );
+			CPPUNIT_ASSERT_EQUAL( pDocumentPattern->get_notes()->size(), pStreamedPattern->get_notes()->size() );
+			auto streamed = pStreamedPattern->get_notes()->begin();
+			for ( auto it = pDocumentPattern->get_notes()->begin(); it != pDocumentPattern->get_notes()->end(); ++it, ++streamed ) {
+				H2Core::Note* pNote = it->second;
+				H2Core::Note* pStreamedNote = streamed->second;
+				CPPUNIT_ASSERT_EQUAL( pNote->get_position(), pStreamedNote->get_position() );
+				CPPUNIT_ASSERT_EQUAL( pNote->get_velocity(), pStreamedNote->get_velocity() );
+				CPPUNIT_ASSERT_EQUAL( pNote->get_length(), pStreamedNote->get_length() );
+				CPPUNIT_ASSERT_EQUAL( pNote->get_instrument()->get_id(), pStreamedNote->get_instrument()->get_id() );
+			}
+		}
+		delete pStreamed;
+		delete pDocument;
+	}
+}
@@ -8,12 +8,14 @@ class XmlTest : public CppUnit::TestCase {
 	CPPUNIT_TEST(testDrumkit);
 	CPPUNIT_TEST(testDrumkit_UpgradeInvalidADSRValues);
 	CPPUNIT_TEST(testPattern);
+	CPPUNIT_TEST(testSongStream);
 	CPPUNIT_TEST_SUITE_END();
 
 	public:
 		void testDrumkit();
 		void testDrumkit_UpgradeInvalidADSRValues();
 		void testPattern();
+		void testSongStream();
 	
 };
 